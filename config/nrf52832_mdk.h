@@ -34,18 +34,62 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "nrf_gpio.h"
+#include "app_util.h"
+
+// Pin descriptors for nRF52832-MDK: (port, pin, active level, pull, GPIOTE channel).
+// Everything below is derived from them at compile time, so pin numbers, masks and
+// the LED and button accessors cannot disagree. BOARD_GPIOTE_NONE leaves the pin
+// to whatever the driver picks (the PORT event for app_button).
+#define BOARD_GPIOTE_NONE          0xFF
+
+#define BOARD_LED_1_DESC           (0, 22, 0, NRF_GPIO_PIN_NOPULL, BOARD_GPIOTE_NONE)
+#define BOARD_LED_2_DESC           (0, 23, 0, NRF_GPIO_PIN_NOPULL, BOARD_GPIOTE_NONE)
+#define BOARD_LED_3_DESC           (0, 24, 0, NRF_GPIO_PIN_NOPULL, BOARD_GPIOTE_NONE)
+
+// Grove-Buttons at Base Dock Grove Port#1 to #4
+#define BOARD_BUTTON_1_DESC        (0, 27, 1, NRF_GPIO_PIN_PULLDOWN, BOARD_GPIOTE_NONE)
+#define BOARD_BUTTON_2_DESC        (0, 29, 1, NRF_GPIO_PIN_PULLDOWN, BOARD_GPIOTE_NONE)
+#define BOARD_BUTTON_3_DESC        (0, 31, 1, NRF_GPIO_PIN_PULLDOWN, BOARD_GPIOTE_NONE)
+#define BOARD_BUTTON_4_DESC        (0, 3,  1, NRF_GPIO_PIN_PULLDOWN, BOARD_GPIOTE_NONE)
+
+// UART to the DAPLink interface
+#define BOARD_UART_RX_DESC         (0, 19, 1, NRF_GPIO_PIN_NOPULL, BOARD_GPIOTE_NONE)
+#define BOARD_UART_TX_DESC         (0, 20, 1, NRF_GPIO_PIN_NOPULL, BOARD_GPIOTE_NONE)
+
+#define BOARD_DESC_PORT_(port, pin, active, pull, gpiote)     (port)
+#define BOARD_DESC_PIN_(port, pin, active, pull, gpiote)      NRF_GPIO_PIN_MAP(port, pin)
+#define BOARD_DESC_ACTIVE_(port, pin, active, pull, gpiote)   (active)
+#define BOARD_DESC_PULL_(port, pin, active, pull, gpiote)     (pull)
+#define BOARD_DESC_GPIOTE_(port, pin, active, pull, gpiote)   (gpiote)
+
+#define BOARD_DESC_PORT(desc)      BOARD_DESC_PORT_ desc
+#define BOARD_DESC_PIN(desc)       BOARD_DESC_PIN_ desc
+#define BOARD_DESC_ACTIVE(desc)    BOARD_DESC_ACTIVE_ desc
+#define BOARD_DESC_PULL(desc)      BOARD_DESC_PULL_ desc
+#define BOARD_DESC_GPIOTE(desc)    BOARD_DESC_GPIOTE_ desc
+#define BOARD_DESC_MASK(desc)      (1UL << BOARD_DESC_PIN(desc))
+
+// Accessors on a descriptor; each compiles to a single register access.
+#define BOARD_PIN_CFG_OUTPUT(desc) nrf_gpio_cfg_output(BOARD_DESC_PIN(desc))
+#define BOARD_PIN_CFG_INPUT(desc)  nrf_gpio_cfg_input(BOARD_DESC_PIN(desc), BOARD_DESC_PULL(desc))
+#define BOARD_PIN_ON(desc)         nrf_gpio_pin_write(BOARD_DESC_PIN(desc), BOARD_DESC_ACTIVE(desc))
+#define BOARD_PIN_OFF(desc)        nrf_gpio_pin_write(BOARD_DESC_PIN(desc), !BOARD_DESC_ACTIVE(desc))
+#define BOARD_PIN_TOGGLE(desc)     nrf_gpio_pin_toggle(BOARD_DESC_PIN(desc))
+#define BOARD_PIN_IS_ACTIVE(desc)  (nrf_gpio_pin_read(BOARD_DESC_PIN(desc)) == BOARD_DESC_ACTIVE(desc))
 
 // LEDs definitions for nRF52832-MDK
 #define LEDS_NUMBER    3
 
-#define LED_START      22
-#define LED_1          22
-#define LED_2          23
-#define LED_3          24
-#define LED_STOP       24
+#define LED_START      LED_1
+#define LED_1          BOARD_DESC_PIN(BOARD_LED_1_DESC)
+#define LED_2          BOARD_DESC_PIN(BOARD_LED_2_DESC)
+#define LED_3          BOARD_DESC_PIN(BOARD_LED_3_DESC)
+#define LED_STOP       LED_3
 
-#define LEDS_ACTIVE_STATE 0
+#define LEDS_ACTIVE_STATE BOARD_DESC_ACTIVE(BOARD_LED_1_DESC)
 
 #define LEDS_INV_MASK  LEDS_MASK
 
@@ -56,14 +100,14 @@ extern "C" {
 #define BSP_LED_2      LED_3
 
 #define BUTTONS_NUMBER 4
-#define BUTTON_1       27    // Connect Grove-Button at Base Dock Grove Port#1
-#define BUTTON_2       29    // Connect Grove-Button at Base Dock Grove Port#2
-#define BUTTON_3       31    // Connect Grove-Button at Base Dock Grove Port#3
-#define BUTTON_4       3     // Connect Grove-Button at Base Dock Grove Port#4
+#define BUTTON_1       BOARD_DESC_PIN(BOARD_BUTTON_1_DESC)
+#define BUTTON_2       BOARD_DESC_PIN(BOARD_BUTTON_2_DESC)
+#define BUTTON_3       BOARD_DESC_PIN(BOARD_BUTTON_3_DESC)
+#define BUTTON_4       BOARD_DESC_PIN(BOARD_BUTTON_4_DESC)
 
-#define BUTTON_PULL    NRF_GPIO_PIN_PULLDOWN
+#define BUTTON_PULL    BOARD_DESC_PULL(BOARD_BUTTON_1_DESC)
 
-#define BUTTONS_ACTIVE_STATE 1
+#define BUTTONS_ACTIVE_STATE BOARD_DESC_ACTIVE(BOARD_BUTTON_1_DESC)
 
 #define BUTTONS_LIST { BUTTON_1, BUTTON_2, BUTTON_3, BUTTON_4}
 
@@ -73,10 +117,75 @@ extern "C" {
 #define BSP_BUTTON_3   BUTTON_4
 
 
-#define RX_PIN_NUMBER  19
-#define TX_PIN_NUMBER  20
+#define RX_PIN_NUMBER  BOARD_DESC_PIN(BOARD_UART_RX_DESC)
+#define TX_PIN_NUMBER  BOARD_DESC_PIN(BOARD_UART_TX_DESC)
 #define HWFC           false
 
+// Pins taken by the board, for the conflict checks below.
+#define BOARD_LEDS_PIN_MASK        (BOARD_DESC_MASK(BOARD_LED_1_DESC) | \
+                                    BOARD_DESC_MASK(BOARD_LED_2_DESC) | \
+                                    BOARD_DESC_MASK(BOARD_LED_3_DESC))
+#define BOARD_BUTTONS_PIN_MASK     (BOARD_DESC_MASK(BOARD_BUTTON_1_DESC) | \
+                                    BOARD_DESC_MASK(BOARD_BUTTON_2_DESC) | \
+                                    BOARD_DESC_MASK(BOARD_BUTTON_3_DESC) | \
+                                    BOARD_DESC_MASK(BOARD_BUTTON_4_DESC))
+#define BOARD_UART_PIN_MASK        (BOARD_DESC_MASK(BOARD_UART_RX_DESC) | \
+                                    BOARD_DESC_MASK(BOARD_UART_TX_DESC))
+#define BOARD_NFC_PIN_MASK         ((1UL << 9) | (1UL << 10))  // NFC1/NFC2 unless CONFIG_NFCT_PINS_AS_GPIOS
+#define BOARD_RESET_PIN_MASK       (1UL << 21)                 // nRESET with CONFIG_GPIO_AS_PINRESET
+
+// Analog inputs AIN0-AIN7 are P0.02-P0.05 and P0.28-P0.31.
+#define BOARD_AIN_PIN(n)           (((n) < 4) ? (2 + (n)) : (24 + (n)))
+#define BOARD_AIN_MASK(n)          (1UL << BOARD_AIN_PIN(n))
+
+/**@brief Fail the build when an example claims a pin that the board resources in
+ *        'used' already take, e.g.
+ *        BOARD_PINS_CLAIM(SPI_PINS_MASK, BOARD_LEDS_PIN_MASK | BOARD_BUTTONS_PIN_MASK);
+ */
+#define BOARD_PINS_CLAIM(mask, used) \
+    STATIC_ASSERT(((mask) & (used)) == 0, "pin already used by the board")
+
+STATIC_ASSERT((BOARD_LEDS_PIN_MASK & BOARD_BUTTONS_PIN_MASK) == 0, "LED and button pins overlap");
+STATIC_ASSERT(((BOARD_LEDS_PIN_MASK | BOARD_BUTTONS_PIN_MASK) &
+               (BOARD_UART_PIN_MASK | BOARD_NFC_PIN_MASK | BOARD_RESET_PIN_MASK)) == 0,
+              "LED or button pin on a UART, NFC or reset pin");
+
+/**@brief Function for getting the pin of an LED.
+ *
+ * @details Folds to a constant when @p led_idx is one, so the accessors below need
+ *          no table lookup, unlike bsp_board_led_*().
+ */
+__STATIC_INLINE uint32_t board_led_pin(uint32_t led_idx)
+{
+    return (led_idx == 0) ? LED_1 : (led_idx == 1) ? LED_2 : LED_3;
+}
+
+__STATIC_INLINE uint32_t board_button_pin(uint32_t button_idx)
+{
+    return (button_idx == 0) ? BUTTON_1 : (button_idx == 1) ? BUTTON_2 :
+           (button_idx == 2) ? BUTTON_3 : BUTTON_4;
+}
+
+__STATIC_INLINE void board_led_on(uint32_t led_idx)
+{
+    nrf_gpio_pin_write(board_led_pin(led_idx), LEDS_ACTIVE_STATE);
+}
+
+__STATIC_INLINE void board_led_off(uint32_t led_idx)
+{
+    nrf_gpio_pin_write(board_led_pin(led_idx), !LEDS_ACTIVE_STATE);
+}
+
+__STATIC_INLINE void board_led_invert(uint32_t led_idx)
+{
+    nrf_gpio_pin_toggle(board_led_pin(led_idx));
+}
+
+__STATIC_INLINE bool board_button_pressed(uint32_t button_idx)
+{
+    return nrf_gpio_pin_read(board_button_pin(button_idx)) == BUTTONS_ACTIVE_STATE;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@
 #include "ble/BLE.h"
 #include "ble/Gap.h"
 #include "ble/services/BatteryService.h"
+#include "StaticInstance.h"
 
 DigitalOut led1(LED1, 1);
 
@@ -27,8 +28,10 @@ static const uint16_t uuid16_list[] = {GattService::UUID_BATTERY_SERVICE};
 
 static uint8_t batteryLevel = 50;
 static BatteryService* batteryServicePtr;
+static StaticInstance<BatteryService> batteryService;
 
-static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
+static unsigned char eventQueueBuffer[/* event count */ 16 * EVENTS_EVENT_SIZE];
+static EventQueue    eventQueue(sizeof(eventQueueBuffer), eventQueueBuffer);
 
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
 {
@@ -97,7 +100,7 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
     ble.gap().onDisconnection(disconnectionCallback);
 
     /* Setup primary service */
-    batteryServicePtr = new BatteryService(ble, batteryLevel);
+    batteryServicePtr = new (batteryService.allocate()) BatteryService(ble, batteryLevel);
 
     /* Setup advertising */
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
@@ -18,10 +18,55 @@
 #include <mbed.h>
 #include "ble/BLE.h"
 #include "ble/services/iBeacon.h"
+#include "StaticInstance.h"
 
 static iBeacon* ibeaconPtr;
+static StaticInstance<iBeacon> ibeacon;
 
-static EventQueue eventQueue(/* event count */ 4 * EVENTS_EVENT_SIZE);
+static unsigned char eventQueueBuffer[/* event count */ 4 * EVENTS_EVENT_SIZE];
+static EventQueue    eventQueue(sizeof(eventQueueBuffer), eventQueueBuffer);
+
+#if defined(RTOS_BENCH)
+#define BENCH_REPORT(key, value) printf("BENCH " key " %lu\r\n", (unsigned long)(value))
+#include "rtos_bench.h"
+
+/* The latency test of tools/rtos_bench runs in its own thread */
+MBED_ALIGN(8) static unsigned char benchThreadStack[1024];
+static Thread    benchThread(osPriorityNormal, sizeof(benchThreadStack), benchThreadStack, "bench");
+static Semaphore benchAdv(0);
+static Semaphore benchWake(0);
+static InterruptIn benchStimIn((PinName)BENCH_STIM_IN_PIN, PullDown);
+
+void benchPinHandler(void)
+{
+    bench_isr();
+    benchWake.release();
+}
+
+void benchStopAdvertising(void)
+{
+    BLE::Instance().gap().stopAdvertising();
+}
+
+void benchRun(void)
+{
+    benchStimIn.rise(benchPinHandler);
+
+    benchAdv.wait();
+
+    do {
+        wait_ms(BENCH_GAP_MS);
+        bench_stimulus();
+        benchWake.wait();
+    } while (!bench_thread());
+
+    benchStimIn.rise(NULL);
+    bench_report();
+
+    /* Idle phase: nothing left running */
+    eventQueue.call(benchStopAdvertising);
+}
+#endif
 
 /**
  * This function is called when the ble initialization process has failled
@@ -76,10 +121,14 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
     uint16_t majorNumber = 1122;
     uint16_t minorNumber = 3344;
     uint16_t txPower     = 0xC8;
-    ibeaconPtr = new iBeacon(ble, uuid, majorNumber, minorNumber, txPower);
+    ibeaconPtr = new (ibeacon.allocate()) iBeacon(ble, uuid, majorNumber, minorNumber, txPower);
 
     ble.gap().setAdvertisingInterval(1000); /* 1000ms. */
     ble.gap().startAdvertising();
+#if defined(RTOS_BENCH)
+    bench_adv_started();
+    benchAdv.release();
+#endif
 
     printMacAddress();
 }
@@ -91,6 +140,11 @@ void scheduleBleEventsProcessing(BLE::OnEventsToProcessCallbackContext* context)
 
 int main()
 {
+#if defined(RTOS_BENCH)
+    bench_main_entry();
+    benchThread.start(benchRun);
+#endif
+
     BLE &ble = BLE::Instance();
     ble.onEventsToProcess(scheduleBleEventsProcessing);
     ble.init(bleInitComplete);
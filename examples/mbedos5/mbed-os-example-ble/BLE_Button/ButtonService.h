@@ -17,26 +17,52 @@
 #ifndef __BLE_BUTTON_SERVICE_H__
 #define __BLE_BUTTON_SERVICE_H__
 
+#include "CoalescedValue.h"
+#include "GattServiceBuilder.h"
+
 class ButtonService {
 public:
     const static uint16_t BUTTON_SERVICE_UUID              = 0xA000;
     const static uint16_t BUTTON_STATE_CHARACTERISTIC_UUID = 0xA001;
+    const static uint16_t BUTTON_PRESS_COUNT_UUID          = 0xA002;
+
+    typedef GattCharacteristicSpec<BUTTON_STATE_CHARACTERISTIC_UUID, bool,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY> ButtonStateCharacteristic;
+    typedef GattCharacteristicSpec<BUTTON_PRESS_COUNT_UUID, uint16_t,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY> PressCountCharacteristic;
+    typedef GattServiceBuilder<BUTTON_SERVICE_UUID, ButtonStateCharacteristic, PressCountCharacteristic> Service;
 
-    ButtonService(BLE &_ble, bool buttonPressedInitial) :
-        ble(_ble), buttonState(BUTTON_STATE_CHARACTERISTIC_UUID, &buttonPressedInitial, GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY)
+    /* Updates are coalesced: a client may miss short presses in the state
+     * characteristic, the optional press counter tells it how many there were. */
+    ButtonService(BLE &_ble, EventQueue &queue, bool buttonPressedInitial, bool withPressCount = true) :
+        service(buttonPressedInitial, 0),
+        state(_ble, queue, service.characteristic<0>(), buttonPressedInitial),
+        presses(_ble, queue, service.characteristic<1>(), 0),
+        count(0)
     {
-        GattCharacteristic *charTable[] = {&buttonState};
-        GattService         buttonService(ButtonService::BUTTON_SERVICE_UUID, charTable, sizeof(charTable) / sizeof(GattCharacteristic *));
-        ble.gattServer().addService(buttonService);
+        service.add(_ble, withPressCount ? Service::COUNT : 1);
     }
 
+    /* Safe to call from interrupt context. */
     void updateButtonState(bool newState) {
-        ble.gattServer().write(buttonState.getValueHandle(), (uint8_t *)&newState, sizeof(bool));
+        if (newState && !state.get()) {
+            presses.set(++count);
+        }
+        state.set(newState);
+    }
+
+    void onDisconnection(void) {
+        state.reset();
+        presses.reset();
     }
 
 private:
-    BLE                              &ble;
-    ReadOnlyGattCharacteristic<bool>  buttonState;
+    Service                   service;
+    CoalescedValue<bool>      state;
+    CoalescedValue<uint16_t>  presses;
+    uint16_t                  count;
 };
 
 #endif /* #ifndef __BLE_BUTTON_SERVICE_H__ */
@@ -0,0 +1,141 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_GATT_SERVICE_BUILDER_H__
+#define __BLE_GATT_SERVICE_BUILDER_H__
+
+#include <mbed.h>
+#include "ble/BLE.h"
+
+/* Header-only builder for GATT services with 16-bit UUIDs.
+ *
+ * Characteristics are declared as types:
+ *
+ *     typedef GattCharacteristicSpec<0xA001, bool, GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ> State;
+ *     typedef GattServiceBuilder<0xA000, State> Service;
+ *
+ * The service object holds the values, the GattCharacteristic objects and the
+ * table passed to the stack inline, so declaring it static puts the whole
+ * service in .bss with nothing taken from the heap. The characteristic count
+ * and the position of each characteristic are resolved at compile time;
+ * valueHandle<I>() is a plain member access once add() has run, as the stack
+ * assigns the handles in addService. Written for the C++98 toolchains of
+ * mbed OS 5, hence the fixed number of optional parameters rather than a
+ * variadic list. */
+
+struct GattNoCharacteristic {
+    typedef uint8_t value_type;
+};
+
+template <uint16_t UUID_, typename T, uint8_t PROPERTIES_>
+struct GattCharacteristicSpec {
+    static const uint16_t UUID       = UUID_;
+    static const uint8_t  PROPERTIES = PROPERTIES_;
+    typedef T value_type;
+};
+
+namespace gatt_service_builder {
+
+template <typename C>
+struct Slot {
+    explicit Slot(typename C::value_type initial) :
+        value(initial),
+        characteristic(C::UUID, reinterpret_cast<uint8_t *>(&value), sizeof(value), sizeof(value), C::PROPERTIES, NULL, 0, false) { }
+
+    GattCharacteristic *pointer(void) {
+        return &characteristic;
+    }
+
+    typename C::value_type value;
+    GattCharacteristic     characteristic;
+};
+
+template <>
+struct Slot<GattNoCharacteristic> {
+    explicit Slot(GattNoCharacteristic::value_type) { }
+
+    GattCharacteristic *pointer(void) {
+        return NULL;
+    }
+};
+
+template <typename C> struct IsPresent                       { static const unsigned value = 1; };
+template <>           struct IsPresent<GattNoCharacteristic> { static const unsigned value = 0; };
+
+template <unsigned I> struct Index { };
+
+} // namespace gatt_service_builder
+
+template <uint16_t SERVICE_UUID, typename C0,
+          typename C1 = GattNoCharacteristic, typename C2 = GattNoCharacteristic, typename C3 = GattNoCharacteristic>
+class GattServiceBuilder {
+public:
+    static const unsigned COUNT = gatt_service_builder::IsPresent<C0>::value + gatt_service_builder::IsPresent<C1>::value +
+                                  gatt_service_builder::IsPresent<C2>::value + gatt_service_builder::IsPresent<C3>::value;
+
+    GattServiceBuilder(typename C0::value_type v0 = typename C0::value_type(),
+                       typename C1::value_type v1 = typename C1::value_type(),
+                       typename C2::value_type v2 = typename C2::value_type(),
+                       typename C3::value_type v3 = typename C3::value_type()) :
+        s0(v0), s1(v1), s2(v2), s3(v3)
+    {
+        table[0] = s0.pointer();
+        table[1] = s1.pointer();
+        table[2] = s2.pointer();
+        table[3] = s3.pointer();
+    }
+
+    /* Registers the first count characteristics, all of them by default. */
+    ble_error_t add(BLE &ble, unsigned count = COUNT) {
+        GattService service(SERVICE_UUID, table, (count < COUNT) ? count : COUNT);
+        return ble.gattServer().addService(service);
+    }
+
+    template <unsigned I>
+    GattCharacteristic &characteristic(void) {
+        return at(gatt_service_builder::Index<I>());
+    }
+
+    template <unsigned I>
+    GattAttribute::Handle_t valueHandle(void) const {
+        return at(gatt_service_builder::Index<I>()).getValueHandle();
+    }
+
+private:
+    /* Only instantiated when used, so asking for a missing characteristic fails to compile. */
+    GattCharacteristic &at(gatt_service_builder::Index<0>) { return s0.characteristic; }
+    GattCharacteristic &at(gatt_service_builder::Index<1>) { return s1.characteristic; }
+    GattCharacteristic &at(gatt_service_builder::Index<2>) { return s2.characteristic; }
+    GattCharacteristic &at(gatt_service_builder::Index<3>) { return s3.characteristic; }
+
+    const GattCharacteristic &at(gatt_service_builder::Index<0>) const { return s0.characteristic; }
+    const GattCharacteristic &at(gatt_service_builder::Index<1>) const { return s1.characteristic; }
+    const GattCharacteristic &at(gatt_service_builder::Index<2>) const { return s2.characteristic; }
+    const GattCharacteristic &at(gatt_service_builder::Index<3>) const { return s3.characteristic; }
+
+    /* Absent characteristics must come last, the table is passed as its first COUNT entries. */
+    MBED_STRUCT_STATIC_ASSERT(gatt_service_builder::IsPresent<C1>::value >= gatt_service_builder::IsPresent<C2>::value &&
+                              gatt_service_builder::IsPresent<C2>::value >= gatt_service_builder::IsPresent<C3>::value,
+                              "GattServiceBuilder characteristics must be contiguous");
+
+    gatt_service_builder::Slot<C0> s0;
+    gatt_service_builder::Slot<C1> s1;
+    gatt_service_builder::Slot<C2> s2;
+    gatt_service_builder::Slot<C3> s3;
+    GattCharacteristic            *table[4];
+};
+
+#endif /* #ifndef __BLE_GATT_SERVICE_BUILDER_H__ */
@@ -19,29 +19,35 @@
 #include "ble/BLE.h"
 #include "ble/Gap.h"
 #include "ButtonService.h"
+#include "StaticInstance.h"
 
 DigitalOut  led1(LED1, 1);
 InterruptIn button(BLE_BUTTON_PIN_NAME, PullDown);
 
-static EventQueue eventQueue(/* event count */ 10 * EVENTS_EVENT_SIZE);
+static unsigned char eventQueueBuffer[/* event count */ 10 * EVENTS_EVENT_SIZE];
+static EventQueue    eventQueue(sizeof(eventQueueBuffer), eventQueueBuffer);
 
 const static char     DEVICE_NAME[] = "Button";
 static const uint16_t uuid16_list[] = {ButtonService::BUTTON_SERVICE_UUID};
 
 ButtonService *buttonServicePtr;
+static StaticInstance<ButtonService> buttonService;
 
+/* ButtonService coalesces the edges itself, so it is updated straight from
+ * the interrupt instead of queuing one event per edge. */
 void buttonPressedCallback(void)
 {
-    eventQueue.call(Callback<void(bool)>(buttonServicePtr, &ButtonService::updateButtonState), true);
+    buttonServicePtr->updateButtonState(true);
 }
 
 void buttonReleasedCallback(void)
 {
-    eventQueue.call(Callback<void(bool)>(buttonServicePtr, &ButtonService::updateButtonState), false);
+    buttonServicePtr->updateButtonState(false);
 }
 
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
 {
+    buttonServicePtr->onDisconnection();
     BLE::Instance().gap().startAdvertising(); // restart advertising
 }
 
@@ -86,12 +92,12 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
 
     ble.gap().onDisconnection(disconnectionCallback);
 
+    /* Setup primary service. */
+    buttonServicePtr = new (buttonService.allocate()) ButtonService(ble, eventQueue, false /* initial value for button pressed */);
+
     button.fall(buttonPressedCallback);
     button.rise(buttonReleasedCallback);
 
-    /* Setup primary service. */
-    buttonServicePtr = new ButtonService(ble, false /* initial value for button pressed */);
-
     /* setup advertising */
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, (uint8_t *)uuid16_list, sizeof(uuid16_list));
@@ -0,0 +1,105 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_GAP_BUTTON_PAYLOAD_H__
+#define __BLE_GAP_BUTTON_PAYLOAD_H__
+
+#include "ble/BLE.h"
+
+/* Advertising payload of the GAPButton: flags, complete local name, the 16-bit
+ * service UUID list and a SERVICE_DATA field carrying the click count.
+ *
+ * All AD structures are encoded once by build(), into two static payloads.
+ * update() only rewrites the SERVICE_DATA bytes of the spare payload, which
+ * keeps its length and offset so nothing else in the buffer moves, and hands
+ * it to the stack. The payloads are only swapped once the stack accepted the
+ * new one, so the active payload always matches what is on air and a failed
+ * update leaves it untouched. Nothing is allocated after build(). */
+class GAPButtonPayload {
+public:
+    GAPButtonPayload(BLE &_ble, const char *_name, uint16_t _uuid) :
+        ble(_ble), name(_name), uuid(_uuid), active(0)
+    {
+        serviceData[0] = uuid & 0xff;
+        serviceData[1] = uuid >> 8;
+        serviceData[2] = 0;
+    }
+
+    ble_error_t build(uint8_t count) {
+        serviceData[2] = count;
+
+        for (unsigned i = 0; i < 2; i++) {
+            GapAdvertisingData &payload = payloads[i];
+            ble_error_t         err;
+
+            payload.clear();
+
+            err = payload.addFlags(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
+            if (err != BLE_ERROR_NONE) {
+                return err;
+            }
+
+            err = payload.addData(GapAdvertisingData::COMPLETE_LOCAL_NAME, (const uint8_t *)name, strlen(name) + 1);
+            if (err != BLE_ERROR_NONE) {
+                return err;
+            }
+
+            err = payload.addData(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, (const uint8_t *)&uuid, sizeof(uuid));
+            if (err != BLE_ERROR_NONE) {
+                return err;
+            }
+
+            err = payload.addData(GapAdvertisingData::SERVICE_DATA, serviceData, sizeof(serviceData));
+            if (err != BLE_ERROR_NONE) {
+                return err;
+            }
+        }
+
+        active = 0;
+        return ble.gap().setAdvertisingPayload(payloads[active]);
+    }
+
+    ble_error_t update(uint8_t count) {
+        unsigned    spare = active ^ 1;
+        ble_error_t err;
+
+        serviceData[2] = count;
+
+        // Same type and length as the field written in build(): patched in place.
+        err = payloads[spare].updateData(GapAdvertisingData::SERVICE_DATA, serviceData, sizeof(serviceData));
+        if (err != BLE_ERROR_NONE) {
+            return err;
+        }
+
+        err = ble.gap().setAdvertisingPayload(payloads[spare]);
+        if (err != BLE_ERROR_NONE) {
+            return err;
+        }
+
+        active = spare;
+        return BLE_ERROR_NONE;
+    }
+
+private:
+    BLE                &ble;
+    const char         *name;
+    uint16_t            uuid;
+    uint8_t             serviceData[3];
+    GapAdvertisingData  payloads[2];
+    unsigned            active;
+};
+
+#endif /* #ifndef __BLE_GAP_BUTTON_PAYLOAD_H__ */
@@ -17,6 +17,7 @@
 #include <events/mbed_events.h>
 #include <mbed.h>
 #include "ble/BLE.h"
+#include "GAPButtonPayload.h"
 
 DigitalOut  led1(LED1, 1);
 InterruptIn button(BLE_BUTTON_PIN_NAME, PullDown);
@@ -29,9 +30,11 @@ const char DEVICE_NAME[] = "GAPButton";
  * as long as it does not overlap with the UUIDs defined here:
  * https://developer.bluetooth.org/gatt/services/Pages/ServicesHome.aspx */
 #define GAPButtonUUID 0xAA00
-const uint16_t uuid16_list[] = {GAPButtonUUID};
 
-static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
+static GAPButtonPayload advPayload(BLE::Instance(), DEVICE_NAME, GAPButtonUUID);
+
+static unsigned char eventQueueBuffer[/* event count */ 16 * EVENTS_EVENT_SIZE];
+static EventQueue    eventQueue(sizeof(eventQueueBuffer), eventQueueBuffer);
 
 void print_error(ble_error_t error, const char* msg)
 {
@@ -83,11 +86,7 @@ void print_error(ble_error_t error, const char* msg)
 void updatePayload(void)
 {
     // Update the count in the SERVICE_DATA field of the advertising payload
-    uint8_t service_data[3];
-    service_data[0] = GAPButtonUUID & 0xff;
-    service_data[1] = GAPButtonUUID >> 8;
-    service_data[2] = cnt; // Put the button click count in the third byte
-    ble_error_t err = BLE::Instance().gap().updateAdvertisingPayload(GapAdvertisingData::SERVICE_DATA, (uint8_t *)service_data, sizeof(service_data));
+    ble_error_t err = advPayload.update(cnt);
     if (err != BLE_ERROR_NONE) {
         print_error(err, "Updating payload failed");
     }
@@ -130,38 +129,12 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *context)
         return;
     }
 
-    // Set up the advertising flags. Note: not all combination of flags are valid
-    // BREDR_NOT_SUPPORTED: Device does not support Basic Rate or Enchanced Data Rate, It is Low Energy only.
-    // LE_GENERAL_DISCOVERABLE: Peripheral device is discoverable at any moment
-    err = ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
-    if (err != BLE_ERROR_NONE) {
-        print_error(err, "Setting GAP flags failed");
-        return;
-    }
-
-    // Put the device name in the advertising payload
-    err = ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::COMPLETE_LOCAL_NAME, (uint8_t *)DEVICE_NAME, sizeof(DEVICE_NAME));
-    if (err != BLE_ERROR_NONE) {
-        print_error(err, "Setting device name failed");
-        return;
-    }
-
-    err = ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, (uint8_t *)uuid16_list, sizeof(uuid16_list));
-    if (err != BLE_ERROR_NONE) {
-        print_error(err, "Setting service UUID failed");
-        return;
-    }
-
-    // The Service Data data type consists of a service UUID with the data associated with that service.
-    // We will encode the number of button clicks in the Service Data field
-    // First two bytes of SERVICE_DATA field should contain the UUID of the service
-    uint8_t service_data[3];
-    service_data[0] = GAPButtonUUID & 0xff;
-    service_data[1] = GAPButtonUUID >> 8;
-    service_data[2] = cnt; // Put the button click count in the third byte
-    err = ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::SERVICE_DATA, (uint8_t *)service_data, sizeof(service_data));
+    // Encode the flags (BREDR_NOT_SUPPORTED, LE_GENERAL_DISCOVERABLE), the device name, the
+    // service UUID list and the SERVICE_DATA field once. The Service Data data type consists of
+    // the service UUID followed by the number of button clicks; later presses only patch that byte.
+    err = advPayload.build(cnt);
     if (err != BLE_ERROR_NONE) {
-        print_error(err, "Setting service data failed");
+        print_error(err, "Setting advertising payload failed");
         return;
     }
 
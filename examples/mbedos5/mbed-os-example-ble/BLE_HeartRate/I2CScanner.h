@@ -0,0 +1,152 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef I2C_SCANNER_H
+#define I2C_SCANNER_H
+
+#include "mbed.h"
+
+/**
+ *  Non-blocking I2C bus scanner and bus-health check.
+ *
+ *  Probes every valid 7-bit address (0x08-0x77; the reserved ranges at
+ *  either end are skipped) with a zero-length write. The address is ACKed or
+ *  NACKed without any data byte moving. Each probe is an asynchronous
+ *  I2C::transfer, which the nRF52 HAL runs on TWIM with EasyDMA. Completions
+ *  arrive in interrupt context, where the I2C driver cannot be used, so the
+ *  next probe is posted to the event queue given to start(). At 400 kHz a
+ *  full scan takes a few milliseconds and never blocks the caller.
+ *
+ *  The scan doubles as a bus-health check. A probe failing with anything
+ *  other than a NACK marks the bus as faulty. A scan that has not finished
+ *  within SCAN_TIMEOUT_MS (a slave holding SCL low, for instance) is aborted
+ *  and reported as stuck.
+ */
+class I2CScanner {
+public:
+    static const uint8_t  FIRST_ADDRESS   = 0x08;
+    static const uint8_t  LAST_ADDRESS    = 0x77;
+    static const int      SCAN_TIMEOUT_MS = 100;
+
+    enum BusState {
+        BUS_OK,
+        BUS_ERROR,     /* a probe failed with something other than a NACK */
+        BUS_STUCK      /* the scan timed out and was aborted */
+    };
+
+    struct Result {
+        BusState state;
+        uint8_t  count;
+        uint32_t duration_us;
+        uint8_t  present[128 / 8]; /* bit n set if 7-bit address n ACKed */
+
+        bool has(uint8_t address) const
+        {
+            return (address < 128) && (present[address / 8] & (1 << (address % 8)));
+        }
+    };
+
+    I2CScanner(I2C &i2c) : i2c(i2c), queue(NULL), address(0), busy(false), timeout_id(0)
+    {
+    }
+
+    /**
+     *  Start a scan; done is called from queue once it completes. Returns
+     *  false if a scan is already running.
+     */
+    bool start(EventQueue &event_queue, Callback<void(const Result &)> scan_done)
+    {
+        if (busy) {
+            return false;
+        }
+
+        busy = true;
+        queue = &event_queue;
+        done = scan_done;
+
+        memset(&result, 0, sizeof(result));
+        result.state = BUS_OK;
+        address = FIRST_ADDRESS;
+
+        i2c.frequency(400000);
+        timer.reset();
+        timer.start();
+        timeout_id = queue->call_in(SCAN_TIMEOUT_MS, this, &I2CScanner::on_timeout);
+
+        probe();
+        return true;
+    }
+
+private:
+    void probe(void)
+    {
+        if (!busy) {
+            return;
+        }
+
+        if (address > LAST_ADDRESS) {
+            finish();
+            return;
+        }
+
+        if (i2c.transfer(address << 1, &dummy, 0, NULL, 0,
+                         event_callback_t(this, &I2CScanner::on_probe_done), I2C_EVENT_ALL) != 0) {
+            result.state = BUS_ERROR;
+            finish();
+        }
+    }
+
+    /* Interrupt context */
+    void on_probe_done(int event)
+    {
+        if (event & I2C_EVENT_TRANSFER_COMPLETE) {
+            result.present[address / 8] |= 1 << (address % 8);
+            result.count++;
+        } else if (!(event & (I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK))) {
+            result.state = BUS_ERROR;
+        }
+
+        address++;
+        queue->call(this, &I2CScanner::probe);
+    }
+
+    void on_timeout(void)
+    {
+        timeout_id = 0;
+        if (busy) {
+            i2c.abort_transfer();
+            result.state = BUS_STUCK;
+            finish();
+        }
+    }
+
+    void finish(void)
+    {
+        if (timeout_id) {
+            queue->cancel(timeout_id);
+            timeout_id = 0;
+        }
+
+        timer.stop();
+        result.duration_us = timer.read_us();
+        busy = false;
+
+        if (done) {
+            done(result);
+        }
+    }
+
+    I2C &i2c;
+    EventQueue *queue;
+    Callback<void(const Result &)> done;
+    Timer timer;
+    Result result;
+    volatile uint8_t address;
+    volatile bool busy;
+    int timeout_id;
+    char dummy;
+};
+
+#endif // I2C_SCANNER_H
@@ -0,0 +1,160 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MAX30102_H
+#define MAX30102_H
+
+#include "SensorDriver.h"
+
+/**
+ *  Maxim MAX30102 pulse sensor in heart-rate mode (red LED only).
+ *
+ *  The part samples at 100 Hz and averages 4 samples into each FIFO entry,
+ *  so the 32-entry FIFO holds 1.28 s of data. poll() does not read the FIFO
+ *  entry by entry. It fetches the write, overflow and read pointers in one
+ *  3-byte burst and then drains every pending entry in a single burst, so
+ *  polling every 500 ms costs two transactions. Beats are detected on the
+ *  falling zero crossings of the signal once its DC component is removed.
+ */
+class Max30102 : public SensorDriver {
+public:
+    static const uint8_t DEFAULT_ADDRESS = 0x57;
+
+    Max30102(I2C &i2c, uint8_t address = DEFAULT_ADDRESS) :
+        SensorDriver(i2c, address), dc(0), prev_ac(0), since_beat(0),
+        interval_count(0), interval_next(0), rate(0)
+    {
+    }
+
+    virtual const char *name() const
+    {
+        return "MAX30102";
+    }
+
+    virtual bool init()
+    {
+        uint8_t part_id;
+
+        if (!read_registers(REG_PART_ID, &part_id, 1) || (part_id != PART_ID)) {
+            return false;
+        }
+
+        if (!write_register(REG_MODE_CONFIG, 0x40)) {         // reset
+            return false;
+        }
+        wait_ms(1);
+
+        return write_register(REG_FIFO_CONFIG, 0x40 | 0x10)   // average 4, roll over
+            && write_register(REG_SPO2_CONFIG, 0x20 | 0x04 | 0x03) // 4096 nA, 100 Hz, 411 us
+            && write_register(REG_LED1_PA, 0x24)              // ~7 mA
+            && write_register(REG_FIFO_WR_PTR, 0)
+            && write_register(REG_OVF_COUNTER, 0)
+            && write_register(REG_FIFO_RD_PTR, 0)
+            && write_register(REG_MODE_CONFIG, 0x02);         // heart rate mode
+    }
+
+    virtual bool poll()
+    {
+        uint8_t pointers[3];
+        uint8_t fifo[FIFO_DEPTH * BYTES_PER_SAMPLE];
+
+        if (!read_registers(REG_FIFO_WR_PTR, pointers, sizeof(pointers))) {
+            return false;
+        }
+
+        int pending = (pointers[0] - pointers[2]) & (FIFO_DEPTH - 1);
+        if (pointers[1] != 0) {
+            pending = FIFO_DEPTH;
+        }
+        if (pending == 0) {
+            return true;
+        }
+
+        if (!read_registers(REG_FIFO_DATA, fifo, pending * BYTES_PER_SAMPLE)) {
+            return false;
+        }
+
+        for (int i = 0; i < pending; i++) {
+            const uint8_t *s = &fifo[i * BYTES_PER_SAMPLE];
+            add_sample((((uint32_t)s[0] << 16) | (s[1] << 8) | s[2]) & 0x3FFFF);
+        }
+        return true;
+    }
+
+    /** Beats per minute averaged over the last few beats; 0 if unknown. */
+    uint8_t bpm() const
+    {
+        return rate;
+    }
+
+private:
+    static const uint8_t REG_FIFO_WR_PTR = 0x04;
+    static const uint8_t REG_OVF_COUNTER = 0x05;
+    static const uint8_t REG_FIFO_RD_PTR = 0x06;
+    static const uint8_t REG_FIFO_DATA   = 0x07;
+    static const uint8_t REG_FIFO_CONFIG = 0x08;
+    static const uint8_t REG_MODE_CONFIG = 0x09;
+    static const uint8_t REG_SPO2_CONFIG = 0x0A;
+    static const uint8_t REG_LED1_PA     = 0x0C;
+    static const uint8_t REG_PART_ID     = 0xFF;
+    static const uint8_t PART_ID         = 0x15;
+
+    static const int FIFO_DEPTH       = 32;
+    static const int BYTES_PER_SAMPLE = 3;
+    static const int SAMPLE_RATE      = 25;               // 100 Hz averaged by 4
+    static const int MIN_INTERVAL     = SAMPLE_RATE * 60 / 200;
+    static const int MAX_INTERVAL     = SAMPLE_RATE * 60 / 40;
+    static const uint32_t NO_FINGER   = 30000;            // reflected light below this
+    static const uint8_t INTERVALS    = 4;
+
+    void add_sample(uint32_t x)
+    {
+        if (x < NO_FINGER) {
+            dc = 0;
+            interval_count = 0;
+            interval_next = 0;
+            rate = 0;
+            return;
+        }
+
+        if (dc == 0) {
+            dc = (int32_t)x << 4;
+        }
+        dc += (((int32_t)x << 4) - dc) >> 4;
+
+        int32_t ac = (int32_t)x - (dc >> 4);
+        if (since_beat < 0xFFFF) {
+            since_beat++;
+        }
+
+        if ((prev_ac >= 0) && (ac < 0) && (since_beat >= MIN_INTERVAL)) {
+            if (since_beat <= MAX_INTERVAL) {
+                intervals[interval_next] = since_beat;
+                interval_next = (interval_next + 1) % INTERVALS;
+                if (interval_count < INTERVALS) {
+                    interval_count++;
+                }
+
+                uint32_t sum = 0;
+                for (uint8_t i = 0; i < interval_count; i++) {
+                    sum += intervals[i];
+                }
+                rate = (uint8_t)((SAMPLE_RATE * 60 * interval_count) / sum);
+            }
+            since_beat = 0;
+        }
+        prev_ac = ac;
+    }
+
+    int32_t  dc;        // DC level, 28.4 fixed point
+    int32_t  prev_ac;
+    uint16_t since_beat;
+    uint16_t intervals[INTERVALS];
+    uint8_t  interval_count;
+    uint8_t  interval_next;
+    uint8_t  rate;
+};
+
+#endif // MAX30102_H
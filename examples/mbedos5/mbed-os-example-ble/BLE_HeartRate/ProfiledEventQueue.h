@@ -0,0 +1,223 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_PROFILED_EVENT_QUEUE_H__
+#define __BLE_PROFILED_EVENT_QUEUE_H__
+
+#include <events/mbed_events.h>
+#include <mbed.h>
+
+/* EventQueue that profiles every callback posted through it.
+ *
+ * Each call site is given a name. For every site the queue keeps a log2
+ * histogram of the enqueue-to-dispatch latency and of the execution time,
+ * and it tracks the high-water mark of pending one-shot events, so a queue
+ * sized in units of EVENT_SIZE can be trimmed to what the application really
+ * needs.
+ *
+ * Only calls made through the named call()/call_every() below are profiled;
+ * code holding the queue as a plain EventQueue& (the services, for example)
+ * still posts unprofiled events. Latency of periodic events is measured
+ * against their due time in queue ticks, so it has millisecond resolution. */
+class ProfiledEventQueue : public EventQueue {
+    struct Site;
+
+    struct ProbeHeader {
+        ProfiledEventQueue *queue;
+        Site               *site;
+        uint32_t            stamp;    /* us_ticker at post, or due tick for periodic events */
+        uint32_t            periodMs; /* 0 for one-shot events */
+    };
+
+    template <typename F>
+    struct Probe {
+        ProbeHeader header;
+        F           f;
+
+        void operator()() {
+            uint32_t start = header.queue->begin(header);
+            f();
+            header.queue->end(header, start);
+        }
+    };
+
+public:
+    const static unsigned MAX_SITES = 8;
+    const static unsigned BUCKETS   = 12; /* <16us, <32us, ... <16ms, >=16ms */
+
+    /* Storage taken by one profiled event; size the queue buffer with it. */
+    const static unsigned EVENT_SIZE = EVENTS_EVENT_SIZE + sizeof(ProbeHeader);
+
+    ProfiledEventQueue(unsigned size, unsigned char *buffer) :
+        EventQueue(size, buffer), sitesUsed(0), pending(0), pendingHighWater(0)
+    {
+    }
+
+    template <typename F>
+    int call(const char *name, F f) {
+        Site *site = findSite(name);
+        Probe<F> probe = { { this, site, us_ticker_read(), 0 }, f };
+
+        core_util_critical_section_enter();
+        int id = EventQueue::call(probe);
+        if (id) {
+            if (++pending > pendingHighWater) {
+                pendingHighWater = pending;
+            }
+        } else if (site) {
+            site->dropped++;
+        }
+        core_util_critical_section_exit();
+
+        return id;
+    }
+
+    template <typename F>
+    int call_every(const char *name, int ms, F f) {
+        Site *site = findSite(name);
+        Probe<F> probe = { { this, site, tick() + ms, (uint32_t)ms }, f };
+
+        int id = EventQueue::call_every(ms, probe);
+        if (!id && site) {
+            site->dropped++;
+        }
+
+        return id;
+    }
+
+    /* Print the per-site histograms and the high-water mark. */
+    void report(void) {
+        printf("============== EVENT QUEUE STATS ============\r\n");
+        printf("Pending high-water: %u events\r\n", pendingHighWater);
+
+        for (unsigned i = 0; i < sitesUsed; i++) {
+            const Site &site = sites[i];
+            printf("%s: %lu calls, %lu dropped\r\n", site.name,
+                   (unsigned long)site.latency.count, (unsigned long)site.dropped);
+            site.latency.print("  latency");
+            site.exec.print("  exec   ");
+        }
+    }
+
+    /* Restart the histograms and the high-water mark. */
+    void reset(void) {
+        core_util_critical_section_enter();
+        for (unsigned i = 0; i < sitesUsed; i++) {
+            sites[i].latency = Histogram();
+            sites[i].exec    = Histogram();
+            sites[i].dropped = 0;
+        }
+        pendingHighWater = pending;
+        core_util_critical_section_exit();
+    }
+
+private:
+    struct Histogram {
+        uint16_t buckets[BUCKETS];
+        uint32_t count;
+        uint32_t maxUs;
+
+        Histogram() : count(0), maxUs(0) {
+            memset(buckets, 0, sizeof(buckets));
+        }
+
+        void add(uint32_t us) {
+            unsigned bucket = 0;
+            for (uint32_t edge = 16; (bucket < BUCKETS - 1) && (us >= edge); edge <<= 1) {
+                bucket++;
+            }
+            if (buckets[bucket] != 0xFFFF) {
+                buckets[bucket]++;
+            }
+            count++;
+            if (us > maxUs) {
+                maxUs = us;
+            }
+        }
+
+        void print(const char *label) const {
+            printf("%s max %lu us |", label, (unsigned long)maxUs);
+            for (unsigned i = 0; i < BUCKETS; i++) {
+                printf(" %u", buckets[i]);
+            }
+            printf("\r\n");
+        }
+    };
+
+    struct Site {
+        const char *name;
+        uint32_t    dropped;
+        Histogram   latency;
+        Histogram   exec;
+    };
+
+    /* Sites are matched by pointer, so pass the same string literal from a
+     * given call site. Calls past MAX_SITES are dispatched unprofiled. */
+    Site *findSite(const char *name) {
+        Site *site = NULL;
+
+        core_util_critical_section_enter();
+        for (unsigned i = 0; i < sitesUsed; i++) {
+            if (sites[i].name == name) {
+                site = &sites[i];
+                break;
+            }
+        }
+        if (!site && (sitesUsed < MAX_SITES)) {
+            site = &sites[sitesUsed++];
+            site->name    = name;
+            site->dropped = 0;
+        }
+        core_util_critical_section_exit();
+
+        return site;
+    }
+
+    uint32_t begin(ProbeHeader &header) {
+        uint32_t start = us_ticker_read();
+        uint32_t latencyUs;
+
+        if (header.periodMs == 0) {
+            latencyUs = start - header.stamp;
+            core_util_critical_section_enter();
+            pending--;
+            core_util_critical_section_exit();
+        } else {
+            int32_t lateMs = (int32_t)(tick() - header.stamp);
+            latencyUs = (lateMs > 0) ? (uint32_t)lateMs * 1000 : 0;
+            header.stamp += header.periodMs;
+        }
+
+        if (header.site) {
+            header.site->latency.add(latencyUs);
+        }
+
+        return start;
+    }
+
+    void end(const ProbeHeader &header, uint32_t start) {
+        if (header.site) {
+            header.site->exec.add(us_ticker_read() - start);
+        }
+    }
+
+    Site     sites[MAX_SITES];
+    unsigned sitesUsed;
+    unsigned pending;
+    unsigned pendingHighWater;
+};
+
+#endif /* #ifndef __BLE_PROFILED_EVENT_QUEUE_H__ */
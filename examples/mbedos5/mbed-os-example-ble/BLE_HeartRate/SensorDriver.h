@@ -0,0 +1,119 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SENSOR_DRIVER_H
+#define SENSOR_DRIVER_H
+
+#include "mbed.h"
+#include "I2CScanner.h"
+
+/**
+ *  Base class of the I2C sensor drivers.
+ *
+ *  A driver is bound by SensorBus once the scanner has seen its address ACK
+ *  and init() has recognised and configured the part. Register access goes
+ *  through read_registers(), which fetches any number of consecutive
+ *  registers, or a whole FIFO, in one write-address/repeated-start/read
+ *  transaction instead of one transaction per byte.
+ *
+ *  Drivers use the blocking I2C API and must be polled from a thread, never
+ *  from interrupt context.
+ */
+class SensorDriver {
+public:
+    SensorDriver(I2C &i2c, uint8_t address) : i2c(i2c), address(address), is_bound(false)
+    {
+    }
+
+    virtual ~SensorDriver()
+    {
+    }
+
+    virtual const char *name() const = 0;
+
+    /** Check the part's identity and configure it; false if it is not ours. */
+    virtual bool init() = 0;
+
+    /** Fetch whatever the part has ready; false on a bus error. */
+    virtual bool poll() = 0;
+
+    uint8_t get_address() const
+    {
+        return address;
+    }
+
+    bool bound() const
+    {
+        return is_bound;
+    }
+
+protected:
+    bool read_registers(uint8_t reg, uint8_t *data, int length)
+    {
+        if (i2c.write(address << 1, (const char *)&reg, 1, true) != 0) {
+            return false;
+        }
+        return i2c.read(address << 1, (char *)data, length) == 0;
+    }
+
+    bool write_register(uint8_t reg, uint8_t value)
+    {
+        char frame[2] = { (char)reg, (char)value };
+        return i2c.write(address << 1, frame, sizeof(frame)) == 0;
+    }
+
+    I2C &i2c;
+    const uint8_t address;
+
+private:
+    friend class SensorBus;
+    bool is_bound;
+};
+
+/**
+ *  Binds the drivers an application supports to the devices found by
+ *  I2CScanner.
+ */
+class SensorBus {
+public:
+    SensorBus(SensorDriver *const *drivers, uint8_t count) : drivers(drivers), count(count)
+    {
+    }
+
+    /** Returns the number of drivers bound. */
+    uint8_t bind(const I2CScanner::Result &scan)
+    {
+        uint8_t bound = 0;
+
+        for (uint8_t i = 0; i < count; i++) {
+            SensorDriver *driver = drivers[i];
+            driver->is_bound = scan.has(driver->get_address()) && driver->init();
+            if (driver->is_bound) {
+                printf("Sensor %s bound at 0x%x.\r\n", driver->name(), driver->get_address());
+                bound++;
+            }
+        }
+
+        return bound;
+    }
+
+    /** Poll every bound driver; a driver that fails is unbound. */
+    void poll()
+    {
+        for (uint8_t i = 0; i < count; i++) {
+            SensorDriver *driver = drivers[i];
+            if (driver->is_bound && !driver->poll()) {
+                printf("Sensor %s stopped responding.\r\n", driver->name());
+                driver->is_bound = false;
+            }
+        }
+    }
+
+private:
+    SensorDriver *const *drivers;
+    const uint8_t count;
+};
+
+#endif // SENSOR_DRIVER_H
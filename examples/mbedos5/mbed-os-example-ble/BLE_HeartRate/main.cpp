@@ -20,6 +20,11 @@
 #include "ble/BLE.h"
 #include "ble/Gap.h"
 #include "ble/services/HeartRateService.h"
+#include "StaticInstance.h"
+#include "ProfiledEventQueue.h"
+#include "stats_report.h"
+#include "I2CScanner.h"
+#include "Max30102.h"
 
 DigitalOut led1(LED1, 1);
 
@@ -27,35 +32,120 @@ const static char     DEVICE_NAME[] = "HRM";
 static const uint16_t uuid16_list[] = {GattService::UUID_HEART_RATE_SERVICE};
 
 static uint8_t hrmCounter = 100; // init HRM to 100bps
+
+/* A MAX30102 found on the I2C bus at boot replaces the simulated readings */
+static I2C          i2c(I2C_SDA0, I2C_SCL0);
+static I2CScanner   scanner(i2c);
+static Max30102     hrm(i2c);
+static SensorDriver *const sensorDrivers[] = { &hrm };
+static SensorBus    sensors(sensorDrivers, sizeof(sensorDrivers) / sizeof(sensorDrivers[0]));
 static HeartRateService *hrServicePtr;
+static StaticInstance<HeartRateService> hrService;
+
+/* BLE::processEvents and every other BLE API call run on bleQueue, which is
+ * dispatched by bleThread above the application's priority. Sensor polling,
+ * LED blinking and console output run on appQueue in the main thread, so slow
+ * application work never sits in front of radio event handling. The BLE API
+ * is not thread safe: application code hands results back through bleQueue
+ * instead of calling the stack itself. */
+static unsigned char      bleQueueBuffer[/* event count */ 8 * ProfiledEventQueue::EVENT_SIZE];
+static ProfiledEventQueue bleQueue(sizeof(bleQueueBuffer), bleQueueBuffer);
+static unsigned char      appQueueBuffer[/* event count */ 16 * ProfiledEventQueue::EVENT_SIZE];
+static ProfiledEventQueue appQueue(sizeof(appQueueBuffer), appQueueBuffer);
+
+MBED_ALIGN(8) static unsigned char bleThreadStack[2048];
+static Thread bleThread(osPriorityAboveNormal, sizeof(bleThreadStack), bleThreadStack, "ble");
+
+static volatile bool connected;     /* Written on bleQueue, read on appQueue */
+static volatile bool publishPending;
+static uint32_t      appDropped;
+
+/* Post work from the BLE side to the application. When appQueue is full the
+ * work is dropped and counted rather than waited for, so the BLE thread
+ * never blocks on the application. */
+template <typename F>
+static void postToApp(const char *name, F f)
+{
+    if (!appQueue.call(name, f)) {
+        appDropped++;
+    }
+}
+
+void printConnectionState(void)
+{
+    printf("%s (app events dropped: %lu)\r\n", connected ? "Connected" : "Disconnected",
+           (unsigned long)appDropped);
+}
 
-static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
+void connectionCallback(const Gap::ConnectionCallbackParams_t *params)
+{
+    connected = true;
+    postToApp("printConnectionState", printConnectionState);
+}
 
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
 {
+    connected = false;
     BLE::Instance().gap().startAdvertising(); // restart advertising
+    postToApp("printConnectionState", printConnectionState);
 }
 
-void updateSensorValue() {
-    // Do blocking calls or whatever is necessary for sensor polling.
-    // In our case, we simply update the HRM measurement.
+void publishHeartRate(void)
+{
+    publishPending = false;
+    hrServicePtr->updateHeartRate(hrmCounter);
+}
+
+void onSensorScanDone(const I2CScanner::Result &result)
+{
+    if (result.state == I2CScanner::BUS_OK) {
+        sensors.bind(result);
+    }
+}
+
+/* Returns true when hrmCounter holds a reading worth publishing */
+bool readSensorValue() {
+    if (hrm.bound()) {
+        /* Drains the sensor FIFO in one burst; polled even while
+         * disconnected so beat detection stays in step. */
+        sensors.poll();
+        if (hrm.bpm() == 0) {
+            return false;
+        }
+        hrmCounter = hrm.bpm();
+        return true;
+    }
+
+    // No sensor, so simply update the simulated HRM measurement.
     hrmCounter++;
 
     //  100 <= HRM bps <=175
     if (hrmCounter == 175) {
         hrmCounter = 100;
     }
+    return true;
+}
 
-    hrServicePtr->updateHeartRate(hrmCounter);
+void updateSensorValue() {
+    if (!readSensorValue() || !connected) {
+        return;
+    }
+
+    /* Back-pressure: while the previous value is still waiting on bleQueue
+     * the new one simply replaces it in hrmCounter. */
+    if (!publishPending) {
+        publishPending = true;
+        if (!bleQueue.call("publishHeartRate", publishHeartRate)) {
+            publishPending = false;
+        }
+    }
 }
 
 void periodicCallback(void)
 {
     led1 = !led1; /* Do blinky on LED1 while we're waiting for BLE events */
 
-    if (BLE::Instance().getGapState().connected) {
-        eventQueue.call(updateSensorValue);
-    }
+    updateSensorValue();
 }
 
 void onBleInitError(BLE &ble, ble_error_t error)
@@ -65,12 +155,11 @@ void onBleInitError(BLE &ble, ble_error_t error)
    /* Initialization error handling should go here */
 }
 
+static Gap::Address_t address;
+
 void printMacAddress()
 {
     /* Print out device MAC address to the console*/
-    Gap::AddressType_t addr_type;
-    Gap::Address_t address;
-    BLE::Instance().gap().getAddress(&addr_type, address);
     printf("DEVICE MAC ADDRESS: ");
     for (int i = 5; i >= 1; i--){
         printf("%02x:", address[i]);
@@ -92,10 +181,11 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
         return;
     }
 
+    ble.gap().onConnection(connectionCallback);
     ble.gap().onDisconnection(disconnectionCallback);
 
     /* Setup primary service. */
-    hrServicePtr = new HeartRateService(ble, hrmCounter, HeartRateService::LOCATION_FINGER);
+    hrServicePtr = new (hrService.allocate()) HeartRateService(ble, hrmCounter, HeartRateService::LOCATION_FINGER);
 
     /* Setup advertising. */
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
@@ -106,23 +196,51 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
     ble.gap().setAdvertisingInterval(1000); /* 1000ms */
     ble.gap().startAdvertising();
 
-    printMacAddress();
+    Gap::AddressType_t addr_type;
+    ble.gap().getAddress(&addr_type, address);
+    postToApp("printMacAddress", printMacAddress);
 }
 
 void scheduleBleEventsProcessing(BLE::OnEventsToProcessCallbackContext* context) {
     BLE &ble = BLE::Instance();
-    eventQueue.call(Callback<void()>(&ble, &BLE::processEvents));
+    bleQueue.call("processEvents", Callback<void()>(&ble, &BLE::processEvents));
 }
 
-int main()
+void reportEventQueues(void)
 {
-    eventQueue.call_every(500, periodicCallback);
+    printf("BLE queue:\r\n");
+    bleQueue.report();
+    printf("Application queue (%lu dropped from BLE):\r\n", (unsigned long)appDropped);
+    appQueue.report();
+}
 
+void initBle(void)
+{
     BLE &ble = BLE::Instance();
     ble.onEventsToProcess(scheduleBleEventsProcessing);
     ble.init(bleInitComplete);
+}
 
-    eventQueue.dispatch_forever();
+int main()
+{
+    scanner.start(appQueue, onSensorScanDone);
+    appQueue.call_every("periodicCallback", 500, periodicCallback);
+
+#if MBED_CONF_APP_STATS_REPORT_MS
+    /* The report runs on appQueue, so its printf cost only shows up in the
+     * latency of application work, never in processEvents. */
+    static SystemReport systemReport(MBED_CONF_APP_STATS_REPORT_MS);
+    systemReport.attach(reportEventQueues);
+    appQueue.call_every("report_state", MBED_CONF_APP_STATS_REPORT_MS,
+                        Callback<void()>(&systemReport, &SystemReport::report_state));
+#endif
+
+    /* BLE is initialised from its own thread so that every stack callback,
+     * including bleInitComplete, runs there. */
+    bleQueue.call("initBle", initBle);
+    bleThread.start(callback(&bleQueue, &EventQueue::dispatch_forever));
+
+    appQueue.dispatch_forever();
 
     return 0;
 }
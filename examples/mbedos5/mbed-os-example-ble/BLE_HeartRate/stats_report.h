@@ -0,0 +1,213 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STATS_REPORT_H
+#define STATS_REPORT_H
+
+#include "mbed.h"
+#include "stats_stream.h"
+
+#ifndef MBED_CONF_APP_STATS_BINARY
+#define MBED_CONF_APP_STATS_BINARY 0
+#endif
+
+/**
+ *  System Reporting library. Provides runtime information on device:
+ *      - CPU active, sleep and deep sleep time, and deep sleep lock state
+ *      - Heap and stack usage
+ *      - Thread information
+ *      - Static system information
+ *      - Anything registered with attach(), e.g. ProfiledEventQueue::report
+ *
+ *  With stats-binary set the samples are streamed as compact binary frames
+ *  (see StatsStream) instead of being printed, so the reporter can stay
+ *  enabled without skewing the CPU figures it reports.
+ */
+class SystemReport {
+    mbed_stats_heap_t   heap_stats;
+    mbed_stats_cpu_t    cpu_stats;
+    mbed_stats_sys_t    sys_stats;
+
+    static const uint8_t max_thread_count = 8;
+
+    mbed_stats_thread_t thread_stats[max_thread_count];
+    uint8_t   thread_count;
+    uint32_t  sample_time_ms;
+
+    mbed_stats_cpu_t    prev_cpu_stats;
+    uint32_t            deep_sleep_locked_samples;
+
+    Callback<void()>    extra_report;
+
+    static uint32_t per_mille(uint64_t part, uint64_t whole)
+    {
+        if (whole == 0) {
+            return 0;
+        }
+        return (uint32_t)((part * 1000 + whole / 2) / whole);
+    }
+
+#if MBED_CONF_APP_STATS_BINARY
+    StatsStream stream;
+#endif
+
+public:
+    /**
+     *  SystemReport - Sample rate in ms is the nominal reporting interval; the
+     *  CPU figures are computed over the measured uptime between samples
+     */
+    SystemReport(uint32_t sample_rate) : sample_time_ms(sample_rate), deep_sleep_locked_samples(0)
+    {
+        // Start the first CPU sample from the current counters
+        mbed_stats_cpu_get(&prev_cpu_stats);
+
+        // Collect the static system information
+        mbed_stats_sys_get(&sys_stats);
+
+        printf("=============================== SYSTEM INFO  ================================\r\n");
+        printf("Mbed OS Version: %ld \r\n", sys_stats.os_version);
+        printf("CPU ID: 0x%lx \r\n", sys_stats.cpu_id);
+        printf("Compiler ID: %d \r\n", sys_stats.compiler_id);
+        printf("Compiler Version: %ld \r\n", sys_stats.compiler_version);
+    }
+
+    /**
+     *  Register an extra report printed after the platform stats, so modules
+     *  with their own statistics can share the reporting cadence. Text mode
+     *  only; the binary stream carries the platform stats alone
+     */
+    void attach(Callback<void()> report)
+    {
+        extra_report = report;
+    }
+
+    /**
+     *  Report on each Mbed OS Platform stats API
+     */
+    void report_state(void)
+    {
+#if MBED_CONF_APP_STATS_BINARY
+        mbed_stats_cpu_get(&cpu_stats);
+        mbed_stats_heap_get(&heap_stats);
+        int count = mbed_stats_thread_get_each(thread_stats, max_thread_count);
+        sample_deep_sleep_lock();
+        stream.send(cpu_stats, heap_stats, thread_stats, count, deep_sleep_locked_samples);
+#else
+        report_cpu_stats();
+        report_heap_stats();
+        report_thread_stats();
+
+        if (extra_report) {
+            extra_report();
+        }
+
+        // Clear next line to separate subsequent report logs
+        printf("\r\n");
+#endif
+    }
+
+    /**
+     *  Report how the time since the previous sample was split between
+     *  running, sleep and deep sleep. The interval is taken from the uptime
+     *  counter rather than sample_time_ms, so the printf and scheduling
+     *  overhead of the reporter itself is accounted for.
+     */
+    void report_cpu_stats(void)
+    {
+        printf("================= CPU STATS =================\r\n");
+
+        // Collect and print cpu stats
+        mbed_stats_cpu_get(&cpu_stats);
+
+        uint64_t period = cpu_stats.uptime - prev_cpu_stats.uptime;
+        uint64_t sleep = cpu_stats.sleep_time - prev_cpu_stats.sleep_time;
+        uint64_t deep_sleep = cpu_stats.deep_sleep_time - prev_cpu_stats.deep_sleep_time;
+        uint64_t idle = cpu_stats.idle_time - prev_cpu_stats.idle_time;
+        uint64_t active = period > idle ? period - idle : 0;
+        prev_cpu_stats = cpu_stats;
+
+        uint32_t active_pm = per_mille(active, period);
+        uint32_t sleep_pm = per_mille(sleep, period);
+        uint32_t deep_sleep_pm = per_mille(deep_sleep, period);
+
+        printf("Period: %lu us\r\n", (unsigned long)period);
+        printf("Active: %lu.%lu%% Sleep: %lu.%lu%% Deep sleep: %lu.%lu%%\r\n",
+               active_pm / 10, active_pm % 10,
+               sleep_pm / 10, sleep_pm % 10,
+               deep_sleep_pm / 10, deep_sleep_pm % 10);
+
+        report_deep_sleep_lock();
+    }
+
+    /**
+     *  Report whether something is currently holding the deep sleep lock and
+     *  for how many consecutive samples it has been held. Building with
+     *  MBED_SLEEP_TRACING_ENABLED makes the sleep manager print the file name
+     *  of every lock holder each time the system goes to sleep.
+     */
+    void report_deep_sleep_lock(void)
+    {
+        uint32_t previous = sample_deep_sleep_lock();
+
+        if (deep_sleep_locked_samples) {
+            printf("Deep sleep: locked for %lu samples\r\n",
+                   (unsigned long)deep_sleep_locked_samples);
+        } else if (previous) {
+            printf("Deep sleep: unlocked after %lu samples\r\n",
+                   (unsigned long)previous);
+        }
+    }
+
+    /**
+     *  Count the consecutive samples taken with the deep sleep lock held, for
+     *  the text report and the binary stream alike. Returns the count before
+     *  this sample
+     */
+    uint32_t sample_deep_sleep_lock(void)
+    {
+        uint32_t previous = deep_sleep_locked_samples;
+
+        deep_sleep_locked_samples = sleep_manager_can_deep_sleep() ? 0 : previous + 1;
+        return previous;
+    }
+
+    /**
+     *  Report current heap stats. Current heap refers to the current amount of
+     *  allocated heap. Max heap refers to the highest amount of heap allocated
+     *  since reset.
+     */
+    void report_heap_stats(void)
+    {
+        printf("================ HEAP STATS =================\r\n");
+
+        // Collect and print heap stats
+        mbed_stats_heap_get(&heap_stats);
+
+        printf("Current heap: %lu\r\n", heap_stats.current_size);
+        printf("Max heap size: %lu\r\n", heap_stats.max_size);
+    }
+
+    /**
+     *  Report active thread stats
+     */
+    void report_thread_stats(void)
+    {
+        printf("================ THREAD STATS ===============\r\n");
+
+        // Collect and print running thread stats
+        int count = mbed_stats_thread_get_each(thread_stats, max_thread_count);
+
+        for (int i = 0; i < count; i++) {
+            printf("ID: 0x%lx \r\n",        thread_stats[i].id);
+            printf("Name: %s \r\n",         thread_stats[i].name);
+            printf("State: %ld \r\n",       thread_stats[i].state);
+            printf("Priority: %ld \r\n",    thread_stats[i].priority);
+            printf("Stack Size: %ld \r\n",  thread_stats[i].stack_size);
+            printf("Stack Space: %ld \r\n", thread_stats[i].stack_space);
+        }
+    }
+};
+
+#endif // STATS_REPORT_H
\ No newline at end of file
@@ -0,0 +1,221 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STATS_STREAM_H
+#define STATS_STREAM_H
+
+#include "mbed.h"
+#if DEVICE_ITM
+#include "hal/itm_api.h"
+#endif
+
+#ifndef MBED_CONF_APP_STATS_DELTA
+#define MBED_CONF_APP_STATS_DELTA 1
+#endif
+
+#ifndef MBED_CONF_APP_STATS_ITM
+#define MBED_CONF_APP_STATS_ITM 0
+#endif
+
+/**
+ *  Binary snapshots of the platform stats, decoded on the host by
+ *  tools/mbed_stats_bin/mbed_stats_bin.py.
+ *
+ *  Replaces the text report, which spends more time in printf than the
+ *  figures it prints can tolerate. A snapshot is a handful of integers
+ *  serialised into one frame; in delta mode only the fields and thread
+ *  entries that changed since the previous frame are sent, with a full frame
+ *  every STATS_FULL_EVERY frames and whenever the set of threads changes so
+ *  a host attaching late can sync.
+ *
+ *  Frame layout, little-endian:
+ *      0       u8   sync, STATS_FRAME_SYNC
+ *      1       u8   kind, STATS_FRAME_FULL or STATS_FRAME_DELTA
+ *      2       u8   payload length n
+ *      3       u8   sequence number
+ *      4       n    payload
+ *      4 + n   u8   checksum, makes the byte sum of the frame zero
+ *
+ *  Full payload: STATS_FIELD_COUNT u32 fields, then one entry per thread.
+ *  Delta payload: u16 mask of the fields that follow as u32, u8 mask of the
+ *  thread entries that follow. A thread entry is id u32, name address u32,
+ *  state u8, priority u8, stack size u16, unused stack u16.
+ *
+ *  The frames go to ITM stimulus port 0 when stats-itm is set and the target
+ *  has ITM, otherwise raw to stdout.
+ */
+class StatsStream {
+public:
+    static const uint8_t STATS_FRAME_SYNC  = 0xA5;
+    static const uint8_t STATS_FRAME_FULL  = 0x12;  /* Change with the fields */
+    static const uint8_t STATS_FRAME_DELTA = 0x13;
+    static const uint8_t STATS_FULL_EVERY  = 16;
+    static const uint8_t MAX_THREADS       = 8;
+
+    enum Field {
+        FIELD_PERIOD_US,         /* Uptime elapsed since the previous snapshot */
+        FIELD_IDLE_US,           /* Idle time in that period */
+        FIELD_SLEEP_US,
+        FIELD_DEEP_SLEEP_US,
+        FIELD_HEAP_CURRENT,
+        FIELD_HEAP_MAX,
+        FIELD_HEAP_ALLOC_COUNT,
+        FIELD_HEAP_ALLOC_FAILS,
+        FIELD_THREAD_COUNT,
+        FIELD_DEEP_SLEEP_LOCKED, /* Consecutive snapshots taken with deep sleep locked, 0 if unlocked */
+        STATS_FIELD_COUNT
+    };
+
+    StatsStream() : sequence(0), sinceFull(STATS_FULL_EVERY), threadCount(0)
+    {
+        memset(fields, 0, sizeof(fields));
+        memset(&prevCpu, 0, sizeof(prevCpu));
+#if DEVICE_ITM && MBED_CONF_APP_STATS_ITM
+        mbed_itm_init();
+#endif
+    }
+
+    void send(const mbed_stats_cpu_t &cpu, const mbed_stats_heap_t &heap,
+              const mbed_stats_thread_t *threads, unsigned count, uint32_t deep_sleep_locked)
+    {
+        uint32_t next[STATS_FIELD_COUNT];
+
+        if (count > MAX_THREADS) {
+            count = MAX_THREADS;
+        }
+
+        next[FIELD_PERIOD_US]        = (uint32_t)(cpu.uptime - prevCpu.uptime);
+        next[FIELD_IDLE_US]          = (uint32_t)(cpu.idle_time - prevCpu.idle_time);
+        next[FIELD_SLEEP_US]         = (uint32_t)(cpu.sleep_time - prevCpu.sleep_time);
+        next[FIELD_DEEP_SLEEP_US]    = (uint32_t)(cpu.deep_sleep_time - prevCpu.deep_sleep_time);
+        next[FIELD_HEAP_CURRENT]     = heap.current_size;
+        next[FIELD_HEAP_MAX]         = heap.max_size;
+        next[FIELD_HEAP_ALLOC_COUNT] = heap.alloc_cnt;
+        next[FIELD_HEAP_ALLOC_FAILS] = heap.alloc_fail_cnt;
+        next[FIELD_THREAD_COUNT]     = count;
+        next[FIELD_DEEP_SLEEP_LOCKED] = deep_sleep_locked;
+        prevCpu = cpu;
+
+        bool full = !MBED_CONF_APP_STATS_DELTA || (sinceFull >= STATS_FULL_EVERY) || (count != threadCount);
+        for (unsigned i = 0; !full && (i < count); i++) {
+            full = (threads[i].id != prevThreads[i].id);
+        }
+
+        begin(full ? STATS_FRAME_FULL : STATS_FRAME_DELTA);
+        if (full) {
+            for (unsigned i = 0; i < STATS_FIELD_COUNT; i++) {
+                put32(next[i]);
+            }
+            for (unsigned i = 0; i < count; i++) {
+                putThread(threads[i]);
+            }
+            sinceFull = 0;
+        } else {
+            uint16_t fieldMask  = 0;
+            uint8_t  threadMask = 0;
+
+            for (unsigned i = 0; i < STATS_FIELD_COUNT; i++) {
+                if (next[i] != fields[i]) {
+                    fieldMask |= 1 << i;
+                }
+            }
+            for (unsigned i = 0; i < count; i++) {
+                if (threadChanged(threads[i], prevThreads[i])) {
+                    threadMask |= 1 << i;
+                }
+            }
+
+            put16(fieldMask);
+            for (unsigned i = 0; i < STATS_FIELD_COUNT; i++) {
+                if (fieldMask & (1 << i)) {
+                    put32(next[i]);
+                }
+            }
+            put8(threadMask);
+            for (unsigned i = 0; i < count; i++) {
+                if (threadMask & (1 << i)) {
+                    putThread(threads[i]);
+                }
+            }
+            sinceFull++;
+        }
+        end();
+
+        memcpy(fields, next, sizeof(fields));
+        memcpy(prevThreads, threads, count * sizeof(mbed_stats_thread_t));
+        threadCount = count;
+    }
+
+private:
+    static bool threadChanged(const mbed_stats_thread_t &a, const mbed_stats_thread_t &b)
+    {
+        return (a.state != b.state) || (a.priority != b.priority) || (a.stack_space != b.stack_space);
+    }
+
+    void begin(uint8_t kind)
+    {
+        length    = 4;
+        frame[0]  = STATS_FRAME_SYNC;
+        frame[1]  = kind;
+        frame[3]  = sequence++;
+    }
+
+    void put8(uint8_t v)
+    {
+        frame[length++] = v;
+    }
+
+    void put16(uint16_t v)
+    {
+        put8(v);
+        put8(v >> 8);
+    }
+
+    void put32(uint32_t v)
+    {
+        put16(v);
+        put16(v >> 16);
+    }
+
+    void putThread(const mbed_stats_thread_t &t)
+    {
+        put32(t.id);
+        put32((uint32_t)(uintptr_t)t.name);
+        put8(t.state);
+        put8(t.priority);
+        put16(t.stack_size);
+        put16(t.stack_space);
+    }
+
+    void end(void)
+    {
+        uint8_t sum = 0;
+
+        frame[2] = length - 4;
+        for (unsigned i = 0; i < length; i++) {
+            sum += frame[i];
+        }
+        frame[length++] = (uint8_t)(0 - sum);
+
+#if DEVICE_ITM && MBED_CONF_APP_STATS_ITM
+        mbed_itm_send_block(ITM_PORT_SWO, frame, length);
+#else
+        fwrite(frame, 1, length, stdout);
+        fflush(stdout);
+#endif
+    }
+
+    /* Header, all fields, MAX_THREADS entries of 14 bytes and the checksum */
+    uint8_t             frame[4 + STATS_FIELD_COUNT * 4 + MAX_THREADS * 14 + 1];
+    unsigned            length;
+    uint8_t             sequence;
+    uint8_t             sinceFull;
+    uint32_t            fields[STATS_FIELD_COUNT];
+    mbed_stats_cpu_t    prevCpu;
+    mbed_stats_thread_t prevThreads[MAX_THREADS];
+    unsigned            threadCount;
+};
+
+#endif // STATS_STREAM_H
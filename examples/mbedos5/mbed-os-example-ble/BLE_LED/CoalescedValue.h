@@ -0,0 +1,199 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_COALESCED_VALUE_H__
+#define __BLE_COALESCED_VALUE_H__
+
+#include <events/mbed_events.h>
+#include <mbed.h>
+#include "ble/BLE.h"
+
+/* Notifications of every CoalescedValue, sent or waiting for a TX buffer.
+ *
+ * GattServer::onDataSent only reports how many notifications went out, not
+ * which ones. The stack sends them in the order they were queued, so the
+ * values with one in flight are kept in that order and the count is taken off
+ * the front. This only holds if every notification the GATT server sends goes
+ * through a CoalescedValue, for a single connection. */
+class CoalescedValueBase {
+protected:
+    CoalescedValueBase(BLE &ble) : inFlight(false), waiting(false), next(NULL) {
+        Sender &s = sender();
+        nextInstance = s.instances;
+        s.instances  = this;
+        if (!s.registered) {
+            s.registered = true;
+            ble.gattServer().onDataSent(&CoalescedValueBase::onDataSent);
+        }
+    }
+
+    /* A notification of the value was queued. */
+    void queued(void) {
+        Sender &s = sender();
+        inFlight = true;
+        next     = NULL;
+        if (s.tail != NULL) {
+            s.tail->next = this;
+        } else {
+            s.head = this;
+        }
+        s.tail = this;
+    }
+
+    /* The stack had no TX buffer: try again once any notification is sent. */
+    void busy(void) {
+        waiting = true;
+    }
+
+    /* Nothing is in flight any more, for any value: to be called on disconnection. */
+    static void resetAll(void) {
+        Sender &s = sender();
+        s.head = s.tail = NULL;
+        for (CoalescedValueBase *v = s.instances; v != NULL; v = v->nextInstance) {
+            v->inFlight = false;
+            v->waiting  = false;
+            v->next     = NULL;
+        }
+    }
+
+    /* Writes the latest value again if it was not published. */
+    virtual void retry(void) = 0;
+
+    bool inFlight;
+
+private:
+    struct Sender {
+        CoalescedValueBase *head;       /* Oldest notification in flight */
+        CoalescedValueBase *tail;
+        CoalescedValueBase *instances;
+        bool                registered;
+    };
+
+    static Sender &sender(void) {
+        static Sender s = { NULL, NULL, NULL, false };
+        return s;
+    }
+
+    static void onDataSent(unsigned count) {
+        Sender &s = sender();
+
+        while ((count-- > 0) && (s.head != NULL)) {
+            CoalescedValueBase *v = s.head;
+            s.head = v->next;
+            if (s.head == NULL) {
+                s.tail = NULL;
+            }
+            v->next     = NULL;
+            v->inFlight = false;
+            v->retry();
+        }
+
+        for (CoalescedValueBase *v = s.instances; v != NULL; v = v->nextInstance) {
+            if (v->waiting) {
+                v->waiting = false;
+                v->retry();
+            }
+        }
+    }
+
+    bool                waiting;
+    CoalescedValueBase *next;           /* Next notification in flight */
+    CoalescedValueBase *nextInstance;
+};
+
+/* Latest-value-wins updates of a characteristic value.
+ *
+ * set() may be called from interrupt context and any number of times: it only
+ * records the value and, if no flush is queued yet, queues one. The flush
+ * writes the value to the GATT server unless it equals the one published last.
+ * While a notification of this value is in flight no other write of it is
+ * made; the next one goes out once that notification is sent, so there is at
+ * most one update per value and connection event and intermediate values are
+ * dropped. T must be a type the CPU reads and writes in one access (bool,
+ * uint8_t, uint16_t, uint32_t). See CoalescedValueBase for the limits. */
+template <typename T>
+class CoalescedValue : private CoalescedValueBase {
+public:
+    CoalescedValue(BLE &_ble, EventQueue &_queue, GattCharacteristic &_characteristic, T initial) :
+        CoalescedValueBase(_ble), ble(_ble), queue(_queue), characteristic(_characteristic),
+        latest(initial), published(initial), flushQueued(false)
+    {
+    }
+
+    void set(T value) {
+        latest = value;
+        if (!flushQueued) {
+            flushQueued = true;
+            queue.call(this, &CoalescedValue::flush);
+        }
+    }
+
+    T get(void) const {
+        return latest;
+    }
+
+    /* The value was changed by a client write: it is already in the GATT server. */
+    void written(T value) {
+        latest    = value;
+        published = value;
+    }
+
+    /* To be called on disconnection: nothing is in flight any more. */
+    void reset(void) {
+        resetAll();
+    }
+
+private:
+    void flush(void) {
+        flushQueued = false;  /* Cleared before reading latest, so a later set() queues again. */
+
+        T value = latest;
+        if ((value == published) || inFlight) {
+            return;
+        }
+
+        ble_error_t err = ble.gattServer().write(characteristic.getValueHandle(), (const uint8_t *)&value, sizeof(T));
+        if (err != BLE_ERROR_NONE) {
+            /* No TX buffer: the value is still newer than published, retried once one is free. */
+            if (err == BLE_STACK_BUSY) {
+                busy();
+            }
+            return;
+        }
+        published = value;
+
+        bool notifying = false;
+        ble.gattServer().areUpdatesEnabled(characteristic, &notifying);
+        if (notifying) {
+            queued();
+        }
+    }
+
+    virtual void retry(void) {
+        if (latest != published) {
+            set(latest);
+        }
+    }
+
+    BLE                &ble;
+    EventQueue         &queue;
+    GattCharacteristic &characteristic;
+    volatile T          latest;
+    T                   published;
+    volatile bool       flushQueued;
+};
+
+#endif /* #ifndef __BLE_COALESCED_VALUE_H__ */
@@ -17,27 +17,50 @@
 #ifndef __BLE_LED_SERVICE_H__
 #define __BLE_LED_SERVICE_H__
 
+#include "CoalescedValue.h"
+#include "GattServiceBuilder.h"
+
 class LEDService {
 public:
     const static uint16_t LED_SERVICE_UUID              = 0xA000;
     const static uint16_t LED_STATE_CHARACTERISTIC_UUID = 0xA001;
 
-    LEDService(BLEDevice &_ble, bool initialValueForLEDCharacteristic) :
-        ble(_ble), ledState(LED_STATE_CHARACTERISTIC_UUID, &initialValueForLEDCharacteristic)
+    typedef GattCharacteristicSpec<LED_STATE_CHARACTERISTIC_UUID, bool,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY> LEDStateCharacteristic;
+    typedef GattServiceBuilder<LED_SERVICE_UUID, LEDStateCharacteristic> Service;
+
+    LEDService(BLEDevice &_ble, EventQueue &queue, bool initialValueForLEDCharacteristic) :
+        service(initialValueForLEDCharacteristic),
+        state(_ble, queue, service.characteristic<0>(), initialValueForLEDCharacteristic)
     {
-        GattCharacteristic *charTable[] = {&ledState};
-        GattService         ledService(LED_SERVICE_UUID, charTable, sizeof(charTable) / sizeof(GattCharacteristic *));
-        ble.addService(ledService);
+        service.add(_ble);
     }
 
     GattAttribute::Handle_t getValueHandle() const
     {
-        return ledState.getValueHandle();
+        return service.valueHandle<0>();
+    }
+
+    /* For changes made locally, e.g. by a button; safe from interrupt context. */
+    void updateLedState(bool newState) {
+        state.set(newState);
+    }
+
+    /* A client write changed the value: keeps the coalescer from sending it back. */
+    void onClientWrite(bool newState) {
+        state.written(newState);
+    }
+
+    void onDisconnection(void) {
+        state.reset();
     }
 
 private:
-    BLEDevice                         &ble;
-    ReadWriteGattCharacteristic<bool> ledState;
+    Service              service;
+    CoalescedValue<bool> state;
 };
 
 #endif /* #ifndef __BLE_LED_SERVICE_H__ */
@@ -0,0 +1,71 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATIC_INSTANCE_H__
+#define __STATIC_INSTANCE_H__
+
+#include <new>
+#include <mbed.h>
+
+/* Statically allocated storage for one object of type T that can only be
+ * constructed at run time, e.g. a service that needs an initialised BLE
+ * instance. The storage is sized and aligned for T at compile time and lives
+ * in .bss, so the object does not show up in mbed_stats_heap:
+ *
+ *     static StaticInstance<HeartRateService> hrService;
+ *     ...
+ *     hrServicePtr = new (hrService.allocate()) HeartRateService(ble, ...);
+ *
+ * Placement new is used rather than forwarding constructor arguments because
+ * mbed OS 5 builds C++98, which cannot forward references to any arity. */
+template <typename T>
+class StaticInstance {
+public:
+    StaticInstance() : object(NULL) { }
+
+    /* Returns the storage to construct T in; may only be called once until destroy(). */
+    void *allocate(void) {
+        MBED_ASSERT(object == NULL);
+        object = reinterpret_cast<T *>(storage.bytes);
+        return storage.bytes;
+    }
+
+    T *get(void) const {
+        return object;
+    }
+
+    T *operator->(void) const {
+        return object;
+    }
+
+    void destroy(void) {
+        if (object != NULL) {
+            object->~T();
+            object = NULL;
+        }
+    }
+
+private:
+    union {
+        unsigned char bytes[sizeof(T)];
+        long long     alignLongLong;
+        double        alignDouble;
+        void         *alignPointer;
+    } storage;
+    T *object;
+};
+
+#endif /* #ifndef __STATIC_INSTANCE_H__ */
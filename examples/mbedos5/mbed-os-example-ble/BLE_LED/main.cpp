@@ -18,6 +18,7 @@
 #include <mbed.h>
 #include "ble/BLE.h"
 #include "LEDService.h"
+#include "StaticInstance.h"
 
 DigitalOut alivenessLED(LED1, 0);
 DigitalOut actuatedLED(LED2, 0);
@@ -25,13 +26,16 @@ DigitalOut actuatedLED(LED2, 0);
 const static char     DEVICE_NAME[] = "LED";
 static const uint16_t uuid16_list[] = {LEDService::LED_SERVICE_UUID};
 
-static EventQueue eventQueue(/* event count */ 10 * EVENTS_EVENT_SIZE);
+static unsigned char eventQueueBuffer[/* event count */ 10 * EVENTS_EVENT_SIZE];
+static EventQueue    eventQueue(sizeof(eventQueueBuffer), eventQueueBuffer);
 
 LEDService *ledServicePtr;
+static StaticInstance<LEDService> ledService;
 
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *params)
 {
     (void) params;
+    ledServicePtr->onDisconnection();
     BLE::Instance().gap().startAdvertising();
 }
 
@@ -49,6 +53,7 @@ void blinkCallback(void)
 void onDataWrittenCallback(const GattWriteCallbackParams *params) {
     if ((params->handle == ledServicePtr->getValueHandle()) && (params->len == 1)) {
         actuatedLED = *(params->data);
+        ledServicePtr->onClientWrite(*(params->data));
     }
 }
 
@@ -96,7 +101,7 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
     ble.gattServer().onDataWritten(onDataWrittenCallback);
 
     bool initialValueForLEDCharacteristic = false;
-    ledServicePtr = new LEDService(ble, initialValueForLEDCharacteristic);
+    ledServicePtr = new (ledService.allocate()) LEDService(ble, eventQueue, initialValueForLEDCharacteristic);
 
     /* setup advertising */
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
@@ -0,0 +1,243 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_GATT_HANDLE_CACHE_H__
+#define __BLE_GATT_HANDLE_CACHE_H__
+
+#include <mbed.h>
+#include "ble/BLE.h"
+
+#ifndef MBED_CONF_APP_GATT_CACHE_FLASH_ADDRESS
+#define MBED_CONF_APP_GATT_CACHE_FLASH_ADDRESS 0
+#endif
+
+/* Attribute handles discovered on a peer, kept in flash so that a reconnect
+ * can use them straight away instead of running service discovery again.
+ *
+ * The cache owns one flash sector, the last one unless gatt_cache_flash_address
+ * is set in mbed_app.json. Records are appended; the newest record for an
+ * address wins and a record with a zero LED handle removes the peer. When the
+ * sector is full it is erased and rewritten with the live entries, which are
+ * also held in RAM so lookups never touch flash. So it is when loading finds a
+ * record torn by a reset or written with an older record layout.
+ *
+ * The entries are kept in the order they were stored, oldest first, in RAM
+ * and in flash. A new peer stored while the cache is full replaces the peer
+ * stored longest ago; storing unchanged handles does not count. */
+class GattHandleCache {
+public:
+    const static unsigned PEER_COUNT = 4;
+
+    struct Entry {
+        BLEProtocol::AddressBytes_t address;
+        GattAttribute::Handle_t     ledValueHandle;
+        GattAttribute::Handle_t     serviceChangedHandle;  /* 0: the server has no Service Changed characteristic. */
+        GattAttribute::Handle_t     serviceChangedCccd;    /* 0: Service Changed cannot be subscribed to. */
+    };
+
+    GattHandleCache() : base(0), sectorSize(0), writeOffset(0), sequence(0), used(0), ready(false) { }
+
+    void init(void) {
+        if (flash.init() != 0) {
+            return;
+        }
+
+        base = MBED_CONF_APP_GATT_CACHE_FLASH_ADDRESS;
+        if (base == 0) {
+            uint32_t end = flash.get_flash_start() + flash.get_flash_size();
+            base = end - flash.get_sector_size(end - 1);
+        }
+        sectorSize = flash.get_sector_size(base);
+        load();
+        ready = true;
+    }
+
+    const Entry *find(const BLEProtocol::AddressBytes_t address) const {
+        int index = indexOf(address);
+        return (index < 0) ? NULL : &entries[index];
+    }
+
+    void store(const Entry &entry) {
+        int index = indexOf(entry.address);
+
+        if (index >= 0) {
+            if (memcmp(&entries[index], &entry, sizeof(Entry)) == 0) {
+                return;
+            }
+            erase(index);
+        }
+        insert(entry);
+        append(entry);
+    }
+
+    void remove(const BLEProtocol::AddressBytes_t address) {
+        int index = indexOf(address);
+
+        if (index < 0) {
+            return;
+        }
+
+        Entry removed = entries[index];
+        removed.ledValueHandle = 0;
+
+        erase(index);
+        append(removed);
+    }
+
+private:
+    const static uint16_t MAGIC = 0x6764;  /* Changes with the layout of Record */
+
+    /* Flash record, 20 bytes: a multiple of the program unit of the targets we run on. */
+    struct Record {
+        uint16_t magic;
+        uint16_t sequence;
+        Entry    entry;
+        uint16_t reserved;
+        uint16_t check;
+    };
+    MBED_STRUCT_STATIC_ASSERT((sizeof(Record) % 4) == 0, "Record must be a multiple of the flash program unit");
+
+    static uint16_t checkOf(const Record &record) {
+        const uint8_t *p     = (const uint8_t *)&record;
+        uint16_t       check = 0xffff;
+        for (unsigned i = 0; i < offsetof(Record, check); i++) {
+            check = (check << 1 | check >> 15) ^ p[i];
+        }
+        return check;
+    }
+
+    int indexOf(const BLEProtocol::AddressBytes_t address) const {
+        for (unsigned i = 0; i < used; i++) {
+            if (memcmp(entries[i].address, address, sizeof(BLEProtocol::AddressBytes_t)) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /* Removes an entry, keeping the others in order. */
+    void erase(unsigned index) {
+        memmove(&entries[index], &entries[index + 1], (used - index - 1) * sizeof(Entry));
+        used--;
+    }
+
+    /* Adds the newest entry, dropping the oldest one if the cache is full. */
+    void insert(const Entry &entry) {
+        if (used == PEER_COUNT) {
+            erase(0);
+        }
+        entries[used++] = entry;
+    }
+
+    /* Replays a flash record, in the order the records were written. */
+    void apply(const Entry &entry) {
+        int index = indexOf(entry.address);
+
+        if (index >= 0) {
+            erase(index);
+        }
+        if (entry.ledValueHandle != 0) {
+            insert(entry);
+        }
+    }
+
+    void load(void) {
+        Record record;
+
+        used        = 0;
+        writeOffset = 0;
+        sequence    = 0;
+
+        while ((writeOffset + sizeof(Record)) <= sectorSize) {
+            if (flash.read(&record, base + writeOffset, sizeof(Record)) != 0) {
+                break;
+            }
+            if ((record.magic != MAGIC) || (record.check != checkOf(record))) {
+                /* Erased space, or else a record torn by a reset or of an older layout, which
+                 * new records cannot be programmed over. */
+                if (!isErased(record)) {
+                    compact();
+                }
+                break;
+            }
+            apply(record.entry);
+            sequence     = record.sequence + 1;
+            writeOffset += sizeof(Record);
+        }
+    }
+
+    bool program(const Entry &entry) {
+        Record record;
+
+        if ((writeOffset + sizeof(Record)) > sectorSize) {
+            return false;
+        }
+
+        record.magic    = MAGIC;
+        record.sequence = sequence;
+        record.entry    = entry;
+        record.reserved = 0xffff;
+        record.check    = checkOf(record);
+
+        if (flash.program(&record, base + writeOffset, sizeof(Record)) != 0) {
+            return false;
+        }
+        sequence++;
+        writeOffset += sizeof(Record);
+        return true;
+    }
+
+    static bool isErased(const Record &record) {
+        const uint8_t *p = (const uint8_t *)&record;
+        for (unsigned i = 0; i < sizeof(Record); i++) {
+            if (p[i] != 0xff) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /* Erases the sector and writes the live entries back. */
+    void compact(void) {
+        if (flash.erase(base, sectorSize) != 0) {
+            return;
+        }
+        writeOffset = 0;
+        for (unsigned i = 0; i < used; i++) {
+            program(entries[i]);
+        }
+    }
+
+    void append(const Entry &entry) {
+        if (!ready || program(entry)) {
+            return;
+        }
+
+        /* Sector full */
+        compact();
+    }
+
+    FlashIAP flash;
+    uint32_t base;
+    uint32_t sectorSize;
+    uint32_t writeOffset;
+    uint16_t sequence;
+    Entry    entries[PEER_COUNT];
+    unsigned used;
+    bool     ready;
+};
+
+#endif /* #ifndef __BLE_GATT_HANDLE_CACHE_H__ */
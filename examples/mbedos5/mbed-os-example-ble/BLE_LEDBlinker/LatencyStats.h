@@ -0,0 +1,91 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_LATENCY_STATS_H__
+#define __BLE_LATENCY_STATS_H__
+
+#include <mbed.h>
+
+/* Operation rate and latency percentiles over a reporting period.
+ *
+ * Keeps the last SAMPLES latencies of the period; percentiles are taken by
+ * sorting a copy when the report is printed, so record() stays O(1) on the
+ * GATT callback path. */
+class LatencyStats {
+public:
+    const static unsigned SAMPLES = 64;
+
+    LatencyStats() : ops(0), count(0), next(0), maxUs(0)
+    {
+        periodTimer.start();
+    }
+
+    void addOps(uint32_t n) {
+        ops += n;
+    }
+
+    void record(uint32_t latencyUs) {
+        samples[next] = latencyUs;
+        next = (next + 1) % SAMPLES;
+        count++;
+        if (latencyUs > maxUs) {
+            maxUs = latencyUs;
+        }
+    }
+
+    /* Prints and restarts the period. */
+    void report(const char *label) {
+        uint32_t elapsedMs = periodTimer.read_ms();
+        unsigned n = (count < SAMPLES) ? count : SAMPLES;
+        uint32_t sorted[SAMPLES];
+
+        periodTimer.reset();
+
+        memcpy(sorted, samples, n * sizeof(uint32_t));
+        for (unsigned i = 1; i < n; i++) {
+            uint32_t v = sorted[i];
+            unsigned j = i;
+            for (; (j > 0) && (sorted[j - 1] > v); j--) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = v;
+        }
+
+        if (n == 0) {
+            printf("%s: %lu ops in %lu ms\r\n", label, (unsigned long)ops, (unsigned long)elapsedMs);
+        } else {
+            printf("%s: %lu ops/s, latency us p50 %lu p90 %lu p99 %lu max %lu (%lu samples)\r\n", label,
+                   (unsigned long)(elapsedMs ? (ops * 1000ULL) / elapsedMs : 0),
+                   (unsigned long)sorted[(n * 50) / 100], (unsigned long)sorted[(n * 90) / 100],
+                   (unsigned long)sorted[(n * 99) / 100], (unsigned long)maxUs, (unsigned long)count);
+        }
+
+        ops   = 0;
+        count = 0;
+        next  = 0;
+        maxUs = 0;
+    }
+
+private:
+    Timer    periodTimer;
+    uint32_t ops;
+    uint32_t count;
+    unsigned next;
+    uint32_t maxUs;
+    uint32_t samples[SAMPLES];
+};
+
+#endif /* #ifndef __BLE_LATENCY_STATS_H__ */
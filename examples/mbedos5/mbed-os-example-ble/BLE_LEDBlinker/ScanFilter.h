@@ -0,0 +1,137 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_SCAN_FILTER_H__
+#define __BLE_SCAN_FILTER_H__
+
+#include <mbed.h>
+#include "ble/BLE.h"
+
+#ifndef MBED_CONF_APP_DEDUP_TABLE_SIZE
+#define MBED_CONF_APP_DEDUP_TABLE_SIZE 64
+#endif
+
+/* Set of advertisers seen recently, used to drop repeated advertisements
+ * before their payload is parsed.
+ *
+ * Open addressing over a fixed table of address hashes, each with the time
+ * it was last inserted. Entries older than the window count as free, so the
+ * table never needs to be cleared. Lookup cost does not depend on how many
+ * devices are advertising around us.
+ *
+ * Up to SIZE advertisers, set by dedup_table_size in mbed_app.json, are
+ * deduplicated at once; fewer if their hashes crowd the same probe run. When
+ * the probed slots are all live, the one seen longest ago is replaced: with more
+ * advertisers in range than the table holds, the least recently seen ones are
+ * evicted and parsed again when they next advertise. */
+class AdvertiserSet {
+public:
+    const static unsigned SIZE  = MBED_CONF_APP_DEDUP_TABLE_SIZE;
+    const static unsigned PROBE = 4;   /* Slots probed before evicting. */
+
+    AdvertiserSet(uint32_t _windowMs) : windowMs(_windowMs)
+    {
+        clear();
+    }
+
+    void clear(void) {
+        memset(entries, 0, sizeof(entries));
+    }
+
+    /* Returns true if the address was already seen within the window,
+     * otherwise records it and returns false. */
+    bool testAndInsert(const BLEProtocol::AddressBytes_t address, uint32_t nowMs) {
+        uint32_t hash = hashOf(address);
+        unsigned slot = hash & (SIZE - 1);
+        unsigned freeSlot = slot;
+        bool     freeFound = false;
+        uint32_t oldestAge = 0;
+
+        for (unsigned i = 0; i < PROBE; i++) {
+            Entry   &entry = entries[(slot + i) & (SIZE - 1)];
+            uint32_t age   = nowMs - entry.seenMs;
+            bool     live  = (entry.hash != 0) && (age < windowMs);
+
+            if (live && (entry.hash == hash)) {
+                return true;
+            }
+            if (freeFound) {
+                continue;
+            }
+            if (!live) {
+                freeSlot  = (slot + i) & (SIZE - 1);
+                freeFound = true;
+            } else if (age >= oldestAge) {
+                /* Least recently seen so far, in case no slot is free. */
+                freeSlot  = (slot + i) & (SIZE - 1);
+                oldestAge = age;
+            }
+        }
+
+        entries[freeSlot].hash   = hash;
+        entries[freeSlot].seenMs = nowMs;
+        return false;
+    }
+
+private:
+    struct Entry {
+        uint32_t hash;   /* 0 marks an empty slot. */
+        uint32_t seenMs;
+    };
+    MBED_STRUCT_STATIC_ASSERT((SIZE >= PROBE) && ((SIZE & (SIZE - 1)) == 0),
+                              "dedup_table_size must be a power of two, at least PROBE");
+
+    /* FNV-1a over the six address bytes. */
+    static uint32_t hashOf(const BLEProtocol::AddressBytes_t address) {
+        uint32_t hash = 2166136261UL;
+        for (unsigned i = 0; i < sizeof(BLEProtocol::AddressBytes_t); i++) {
+            hash = (hash ^ address[i]) * 16777619UL;
+        }
+        return hash ? hash : 1;
+    }
+
+    uint32_t windowMs;
+    Entry    entries[SIZE];
+};
+
+/* Finds the AD structure of the given type in an advertising payload.
+ * Walks the length bytes only, so fields of other types are skipped without
+ * being looked at. Returns NULL if the type is absent or the payload is
+ * malformed. */
+static inline const uint8_t *findAdvertisingField(const uint8_t *payload, uint8_t payloadLen,
+                                                  GapAdvertisingData::DataType_t type, uint8_t *valueLen) {
+    uint8_t i = 0;
+
+    while ((i + 1) < payloadLen) {
+        const uint8_t recordLen = payload[i];
+
+        if (recordLen == 0) {
+            break;  /* Early end of significant data. */
+        }
+        if ((unsigned)i + 1 + recordLen > payloadLen) {
+            break;
+        }
+        if (payload[i + 1] == type) {
+            *valueLen = recordLen - 1;
+            return &payload[i + 2];
+        }
+        i += recordLen + 1;
+    }
+
+    return NULL;
+}
+
+#endif /* #ifndef __BLE_SCAN_FILTER_H__ */
@@ -19,47 +19,153 @@
 #include "ble/BLE.h"
 #include "ble/DiscoveredCharacteristic.h"
 #include "ble/DiscoveredService.h"
+#include "ScanFilter.h"
+#include "GattHandleCache.h"
+#include "LatencyStats.h"
 
 DigitalOut alivenessLED(LED1, 1);
-static DiscoveredCharacteristic ledCharacteristic;
 static bool triggerLedCharacteristic;
 static const char PEER_NAME[] = "LED";
 
-static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
+/* Declared ahead of the throughput mode code, which reschedules itself on it */
+static unsigned char eventQueueBuffer[/* event count */ 16 * EVENTS_EVENT_SIZE];
+static EventQueue    eventQueue(sizeof(eventQueueBuffer), eventQueueBuffer);
+
+/* Advertisers that were already looked at are ignored for this long */
+static const uint32_t DEDUP_WINDOW_MS = 1000;
+
+static AdvertiserSet          seenAdvertisers(DEDUP_WINDOW_MS);
+static Timer                  scanClock;
+static BLEProtocol::Address_t peerWhitelist[1];
+
+/* Handles of the connected peer, from the cache or from service discovery */
+static GattHandleCache         handleCache;
+static GattHandleCache::Entry  peer;
+static Gap::Handle_t           peerConnection;
+static bool                    peerFromCache;
+static bool                    discoveringServiceChanged;  /* Second discovery pass, of the GATT service */
+static DiscoveredCharacteristic serviceChangedCharacteristic;  /* Its descriptors hold the CCCD */
+
+static const uint16_t GATT_SERVICE_UUID = 0x1801;  /* Generic Attribute service, holds Service Changed */
+
+#if MBED_CONF_APP_THROUGHPUT_MODE
+/* Throughput mode: instead of the read, write, read chain, keep the link busy
+ * with Write Without Response. After every batch of writes a read request is
+ * queued as a fence; ATT handles requests in order, so its response means the
+ * whole batch reached the peer and its round trip is the latency recorded. */
+static const unsigned BENCH_WRITES_PER_FENCE = MBED_CONF_APP_THROUGHPUT_WRITES_PER_FENCE;
+static const int      BENCH_RETRY_MS         = 5;  /* TX buffers full: try again after this long */
+
+static LatencyStats benchStats;
+static Timer        benchClock;
+static bool         benchActive;
+static bool         benchFencePending;
+static unsigned     benchBatch;        /* Writes queued since the last fence */
+static unsigned     benchFenceOps;     /* Operations covered by the pending fence */
+static uint32_t     benchFenceStartUs;
+static uint8_t      benchValue;
+
+void benchPump(void) {
+    GattClient &client = BLE::Instance().gattClient();
+
+    if (!benchActive) {
+        return;
+    }
+
+    /* The next batch may be queued while the previous fence is outstanding */
+    while (benchBatch < BENCH_WRITES_PER_FENCE) {
+        uint8_t value = benchValue ^ 0x1;
+        if (client.write(GattClient::GATT_OP_WRITE_CMD, peerConnection, peer.ledValueHandle, 1, &value) != BLE_ERROR_NONE) {
+            eventQueue.call_in(BENCH_RETRY_MS, benchPump);
+            return;
+        }
+        benchValue = value;
+        benchBatch++;
+    }
+
+    if (!benchFencePending) {
+        if (client.read(peerConnection, peer.ledValueHandle, 0) != BLE_ERROR_NONE) {
+            eventQueue.call_in(BENCH_RETRY_MS, benchPump);
+            return;
+        }
+        benchFencePending = true;
+        benchFenceOps     = benchBatch + 1;
+        benchFenceStartUs = benchClock.read_us();
+        benchBatch        = 0;
+    }
+}
+
+void benchFenceDone(void) {
+    benchStats.record(benchClock.read_us() - benchFenceStartUs);
+    benchStats.addOps(benchFenceOps);
+    benchFencePending = false;
+    benchPump();
+}
+
+void benchStart(void) {
+    printf("throughput mode, %u writes per fence\r\n", BENCH_WRITES_PER_FENCE);
+    benchActive       = true;
+    benchFencePending = false;
+    benchBatch        = 0;
+    benchPump();
+}
+
+void benchReport(void) {
+    if (benchActive) {
+        benchStats.report("throughput");
+    }
+}
+#endif
 
 void periodicCallback(void) {
     alivenessLED = !alivenessLED; /* Do blinky on LED1 while we're waiting for BLE events */
 }
 
+/* Once the peer has been found by name, let the controller drop every other
+ * advertiser: the next scans only report advertisements from its address. */
+void rememberPeer(const BLEProtocol::AddressBytes_t address) {
+    Gap &gap = BLE::Instance().gap();
+    Gap::Whitelist_t whitelist;
+
+    peerWhitelist[0] = BLEProtocol::Address_t(BLEProtocol::AddressType::RANDOM_STATIC, address);
+    whitelist.addresses = peerWhitelist;
+    whitelist.size      = 1;
+    whitelist.capacity  = 1;
+
+    if ((gap.getMaxWhitelistSize() == 0) || (gap.setWhitelist(whitelist) != BLE_ERROR_NONE)) {
+        printf("whitelist not supported, scanning unfiltered\r\n");
+        return;
+    }
+
+    /* Applies from the next startScan() */
+    gap.setScanningPolicyMode(Gap::SCAN_POLICY_FILTER_ALL_ADV);
+}
+
 void advertisementCallback(const Gap::AdvertisementCallbackParams_t *params) {
-    // parse the advertising payload, looking for data type COMPLETE_LOCAL_NAME
-    // The advertising payload is a collection of key/value records where
-    // byte 0: length of the record excluding this byte
-    // byte 1: The key, it is the type of the data
-    // byte [2..N] The value. N is equal to byte0 - 1
-    for (uint8_t i = 0; i < params->advertisingDataLen; ++i) {
-
-        const uint8_t record_length = params->advertisingData[i];
-        if (record_length == 0) {
-            continue;
-        }
-        const uint8_t type = params->advertisingData[i + 1];
-        const uint8_t* value = params->advertisingData + i + 2;
-        const uint8_t value_length = record_length - 1;
-
-        if(type == GapAdvertisingData::COMPLETE_LOCAL_NAME) {
-            if ((value_length == sizeof(PEER_NAME)) && (memcmp(value, PEER_NAME, value_length) == 0)) {
-                printf(
-                    "adv peerAddr[%02x %02x %02x %02x %02x %02x] rssi %d, isScanResponse %u, AdvertisementType %u\r\n",
-                    params->peerAddr[5], params->peerAddr[4], params->peerAddr[3], params->peerAddr[2],
-                    params->peerAddr[1], params->peerAddr[0], params->rssi, params->isScanResponse, params->type
-                );
-                BLE::Instance().gap().connect(params->peerAddr, Gap::ADDR_TYPE_RANDOM_STATIC, NULL, NULL);
-                break;
-            }
-        }
-        i += record_length;
+    /* Only a connectable advertiser can be our peer */
+    if (params->isScanResponse || (params->type != GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED)) {
+        return;
+    }
+
+    /* Each advertiser is parsed at most once per window however often it advertises */
+    if (seenAdvertisers.testAndInsert(params->peerAddr, scanClock.read_ms())) {
+        return;
     }
+
+    uint8_t name_length = 0;
+    const uint8_t *name = findAdvertisingField(params->advertisingData, params->advertisingDataLen,
+                                               GapAdvertisingData::COMPLETE_LOCAL_NAME, &name_length);
+    if ((name == NULL) || (name_length != sizeof(PEER_NAME)) || (memcmp(name, PEER_NAME, name_length) != 0)) {
+        return;
+    }
+
+    printf(
+        "adv peerAddr[%02x %02x %02x %02x %02x %02x] rssi %d, isScanResponse %u, AdvertisementType %u\r\n",
+        params->peerAddr[5], params->peerAddr[4], params->peerAddr[3], params->peerAddr[2],
+        params->peerAddr[1], params->peerAddr[0], params->rssi, params->isScanResponse, params->type
+    );
+    rememberPeer(params->peerAddr);
+    BLE::Instance().gap().connect(params->peerAddr, Gap::ADDR_TYPE_RANDOM_STATIC, NULL, NULL);
 }
 
 void serviceDiscoveryCallback(const DiscoveredService *service) {
@@ -77,36 +183,145 @@ void serviceDiscoveryCallback(const DiscoveredService *service) {
 
 void updateLedCharacteristic(void) {
     if (!BLE::Instance().gattClient().isServiceDiscoveryActive()) {
-        ledCharacteristic.read();
+#if MBED_CONF_APP_THROUGHPUT_MODE
+        if (!benchActive) {
+            benchStart();
+        }
+#else
+        BLE::Instance().gattClient().read(peerConnection, peer.ledValueHandle, 0);
+#endif
     }
 }
 
 void characteristicDiscoveryCallback(const DiscoveredCharacteristic *characteristicP) {
     printf("  C UUID-%x valueAttr[%u] props[%x]\r\n", characteristicP->getUUID().getShortUUID(), characteristicP->getValueHandle(), (uint8_t)characteristicP->getProperties().broadcast());
-    if (characteristicP->getUUID().getShortUUID() == 0xa001) { /* !ALERT! Alter this filter to suit your device. */
-        ledCharacteristic        = *characteristicP;
+    if (discoveringServiceChanged) {
+        peer.serviceChangedHandle    = characteristicP->getValueHandle();
+        serviceChangedCharacteristic = *characteristicP;
+    } else if (characteristicP->getUUID().getShortUUID() == 0xa001) { /* !ALERT! Alter this filter to suit your device. */
+        peer.ledValueHandle      = characteristicP->getValueHandle();
         triggerLedCharacteristic = true;
     }
 }
 
+/* Subscribes to Service Changed indications, then starts on the LED. Without
+ * bonding the server forgets the subscription, so it is written on every
+ * connection; the LED read follows the write response, as ATT takes one
+ * request at a time. */
+void subscribeServiceChanged(void) {
+    static const uint8_t indicate[2] = { 0x02, 0x00 };  /* CCCD value: indications enabled */
+
+    if ((peer.serviceChangedCccd == 0) ||
+        (BLE::Instance().gattClient().write(GattClient::GATT_OP_WRITE_REQ, peerConnection, peer.serviceChangedCccd,
+                                            sizeof(indicate), indicate) != BLE_ERROR_NONE)) {
+        updateLedCharacteristic();
+    }
+}
+
+void discoveryDone(void) {
+    handleCache.store(peer);
+    subscribeServiceChanged();
+}
+
+void descriptorDiscoveryCallback(const CharacteristicDescriptorDiscovery::DiscoveryCallbackParams_t *params) {
+    if (params->descriptor.getUUID() == UUID(GattCharacteristic::BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)) {
+        peer.serviceChangedCccd = params->descriptor.getAttributeHandle();
+    }
+}
+
+void descriptorTerminationCallback(const CharacteristicDescriptorDiscovery::TerminationCallbackParams_t *) {
+    eventQueue.call(discoveryDone);
+}
+
 void discoveryTerminationCallback(Gap::Handle_t connectionHandle) {
     printf("terminated SD for handle %u\r\n", connectionHandle);
-    if (triggerLedCharacteristic) {
-        triggerLedCharacteristic = false;
-        eventQueue.call(updateLedCharacteristic);
+    if (!triggerLedCharacteristic) {
+        return;
+    }
+
+    /* The LED service was found: look for Service Changed in the GATT service next */
+    if (!discoveringServiceChanged) {
+        discoveringServiceChanged = true;
+        if (BLE::Instance().gattClient().launchServiceDiscovery(peerConnection, serviceDiscoveryCallback, characteristicDiscoveryCallback,
+                                                                 GATT_SERVICE_UUID, GattCharacteristic::UUID_SERVICE_CHANGED_CHAR) == BLE_ERROR_NONE) {
+            return;
+        }
     }
+
+    discoveringServiceChanged = false;
+    triggerLedCharacteristic  = false;
+
+    /* Then for its CCCD, once service discovery has ended */
+    if ((peer.serviceChangedHandle != 0) &&
+        (serviceChangedCharacteristic.discoverDescriptors(descriptorDiscoveryCallback, descriptorTerminationCallback) == BLE_ERROR_NONE)) {
+        return;
+    }
+    eventQueue.call(discoveryDone);
+}
+
+/* Discovers the LED service, then the Service Changed characteristic and its
+ * CCCD so that a change of the peer's database can be noticed on later
+ * connections. Each pass is filtered on its service and characteristic UUIDs. */
+void discoverPeer(void) {
+    printf("discovering handles\r\n");
+    peerFromCache             = false;
+    discoveringServiceChanged = false;
+    peer.ledValueHandle       = 0;
+    peer.serviceChangedHandle = 0;
+    peer.serviceChangedCccd   = 0;
+    BLE::Instance().gattClient().launchServiceDiscovery(peerConnection, serviceDiscoveryCallback, characteristicDiscoveryCallback, 0xa000, 0xa001);
+}
+
+/* The cached handles turned out to be stale: forget them and discover again */
+void invalidatePeer(void) {
+    printf("cached handles rejected by peer\r\n");
+    handleCache.remove(peer.address);
+    discoverPeer();
 }
 
 void connectionCallback(const Gap::ConnectionCallbackParams_t *params) {
     if (params->role == Gap::CENTRAL) {
         BLE &ble = BLE::Instance();
         ble.gattClient().onServiceDiscoveryTermination(discoveryTerminationCallback);
-        ble.gattClient().launchServiceDiscovery(params->handle, serviceDiscoveryCallback, characteristicDiscoveryCallback, 0xa000, 0xa001);
+
+        peerConnection = params->handle;
+        memcpy(peer.address, params->peerAddr, sizeof(peer.address));
+
+        const GattHandleCache::Entry *cached = handleCache.find(params->peerAddr);
+        if (cached != NULL) {
+            /* First request goes out in the first connection event; a stale
+             * handle is caught by its error response. */
+            printf("using cached handles\r\n");
+            peer          = *cached;
+            peerFromCache = true;
+            subscribeServiceChanged();
+        } else {
+            discoverPeer();
+        }
+    }
+}
+
+void serviceChangedCallback(const GattHVXCallbackParams *params) {
+    if ((params->connHandle == peerConnection) && (peer.serviceChangedHandle != 0) &&
+        (params->handle == peer.serviceChangedHandle)) {
+        invalidatePeer();
     }
 }
 
 void triggerToggledWrite(const GattReadCallbackParams *response) {
-    if (response->handle == ledCharacteristic.getValueHandle()) {
+    if (response->handle == peer.ledValueHandle) {
+        if ((response->status != BLE_ERROR_NONE) || (response->len != 1)) {
+            if (peerFromCache) {
+                invalidatePeer();
+            }
+            return;
+        }
+#if MBED_CONF_APP_THROUGHPUT_MODE
+        peerFromCache = false;
+        benchFenceDone();
+        return;
+#endif
+
         printf("triggerToggledWrite: handle %u, offset %u, len %u\r\n", response->handle, response->offset, response->len);
         for (unsigned index = 0; index < response->len; index++) {
             printf("%c[%02x]", response->data[index], response->data[index]);
@@ -114,19 +329,40 @@ void triggerToggledWrite(const GattReadCallbackParams *response) {
         printf("\r\n");
 
         uint8_t toggledValue = response->data[0] ^ 0x1;
-        ledCharacteristic.write(1, &toggledValue);
+        BLE::Instance().gattClient().write(GattClient::GATT_OP_WRITE_REQ, peerConnection, peer.ledValueHandle, 1, &toggledValue);
     }
 }
 
 void triggerRead(const GattWriteCallbackParams *response) {
-    if (response->handle == ledCharacteristic.getValueHandle()) {
-        ledCharacteristic.read();
+    if ((response->handle == peer.serviceChangedCccd) && (response->handle != 0)) {
+        if ((response->status != BLE_ERROR_NONE) && peerFromCache) {
+            invalidatePeer();
+            return;
+        }
+        updateLedCharacteristic();
+        return;
+    }
+
+    if (response->handle == peer.ledValueHandle) {
+        if (response->status != BLE_ERROR_NONE) {
+            if (peerFromCache) {
+                invalidatePeer();
+            }
+            return;
+        }
+        /* The peer accepted a request on these handles: they are current */
+        peerFromCache = false;
+        updateLedCharacteristic();
     }
 }
 
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *) {
     printf("disconnected\r\n");
+#if MBED_CONF_APP_THROUGHPUT_MODE
+    benchActive = false;
+#endif
     /* Start scanning and try to connect again */
+    seenAdvertisers.clear();
     BLE::Instance().gap().startScan(advertisementCallback);
 }
 
@@ -169,11 +405,15 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
 
     ble.gattClient().onDataRead(triggerToggledWrite);
     ble.gattClient().onDataWrite(triggerRead);
+    ble.gattClient().onHVX(serviceChangedCallback);
+
+    handleCache.init();
 
     // scan interval: 400ms and scan window: 400ms.
     // Every 400ms the device will scan for 400ms
     // This means that the device will scan continuously.
-    ble.gap().setScanParams(400, 400);
+    // Passive scanning: the peer name is in the advertising data, scan responses are not needed.
+    ble.gap().setScanParams(400, 400, 0, false);
     ble.gap().startScan(advertisementCallback);
 
     printMacAddress();
@@ -187,7 +427,12 @@ void scheduleBleEventsProcessing(BLE::OnEventsToProcessCallbackContext* context)
 int main()
 {
     triggerLedCharacteristic = false;
+    scanClock.start();
     eventQueue.call_every(500, periodicCallback);
+#if MBED_CONF_APP_THROUGHPUT_MODE
+    benchClock.start();
+    eventQueue.call_every(MBED_CONF_APP_THROUGHPUT_REPORT_MS, benchReport);
+#endif
 
     BLE &ble = BLE::Instance();
     ble.onEventsToProcess(scheduleBleEventsProcessing);
@@ -17,27 +17,31 @@
 #ifndef __BLE_LED_SERVICE_H__
 #define __BLE_LED_SERVICE_H__
 
+#include "GattServiceBuilder.h"
+
 class LEDService {
 public:
     const static uint16_t LED_SERVICE_UUID              = 0xA000;
     const static uint16_t LED_STATE_CHARACTERISTIC_UUID = 0xA001;
 
+    typedef GattCharacteristicSpec<LED_STATE_CHARACTERISTIC_UUID, bool,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE> LEDStateCharacteristic;
+    typedef GattServiceBuilder<LED_SERVICE_UUID, LEDStateCharacteristic> Service;
+
     LEDService(BLEDevice &_ble, bool initialValueForLEDCharacteristic) :
-        ble(_ble), ledState(LED_STATE_CHARACTERISTIC_UUID, &initialValueForLEDCharacteristic)
+        service(initialValueForLEDCharacteristic)
     {
-        GattCharacteristic *charTable[] = {&ledState};
-        GattService         ledService(LED_SERVICE_UUID, charTable, sizeof(charTable) / sizeof(GattCharacteristic *));
-        ble.addService(ledService);
+        service.add(_ble);
     }
 
     GattAttribute::Handle_t getValueHandle() const
     {
-        return ledState.getValueHandle();
+        return service.valueHandle<0>();
     }
 
 private:
-    BLEDevice                         &ble;
-    ReadWriteGattCharacteristic<bool> ledState;
+    Service service;
 };
 
 #endif /* #ifndef __BLE_LED_SERVICE_H__ */
@@ -0,0 +1,285 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SSD1306DmaSpi.h"
+
+#define SSD1306_SETCONTRAST         0x81
+#define SSD1306_DISPLAYALLON_RESUME 0xA4
+#define SSD1306_NORMALDISPLAY       0xA6
+#define SSD1306_DISPLAYOFF          0xAE
+#define SSD1306_DISPLAYON           0xAF
+#define SSD1306_SETDISPLAYOFFSET    0xD3
+#define SSD1306_SETCOMPINS          0xDA
+#define SSD1306_SETVCOMDETECT       0xDB
+#define SSD1306_SETDISPLAYCLOCKDIV  0xD5
+#define SSD1306_SETPRECHARGE        0xD9
+#define SSD1306_SETMULTIPLEX        0xA8
+#define SSD1306_SETSTARTLINE        0x40
+#define SSD1306_MEMORYMODE          0x20
+#define SSD1306_COLUMNADDR          0x21
+#define SSD1306_PAGEADDR            0x22
+#define SSD1306_COMSCANDEC          0xC8
+#define SSD1306_SEGREMAP            0xA0
+#define SSD1306_CHARGEPUMP          0x8D
+
+SSD1306DmaSpi::SSD1306DmaSpi(SPI &spi, events::EventQueue &queue, PinName dc, PinName rst, PinName cs,
+                             uint8_t rawHeight, uint8_t rawWidth) :
+    Adafruit_GFX(rawWidth, rawHeight),
+    _spi(spi),
+    _queue(queue),
+    _dc(dc, 0),
+    _rst(rst, 1),
+    _cs(cs, 1),
+    _rawWidth(rawWidth),
+    _pages(rawHeight / 8),
+    _busy(false),
+    _again(false),
+    _resend(false),
+    _page(0),
+    _x0(0),
+    _x1(0)
+{
+    MBED_ASSERT((rawWidth <= MAX_WIDTH) && (_pages <= MAX_PAGES) && (_pages > 0));
+    clearDisplay();
+}
+
+void SSD1306DmaSpi::begin()
+{
+    _spi.format(8, 3);
+    _spi.frequency(8000000);
+
+    _rst = 1;
+    wait_ms(1);
+    _rst = 0;
+    wait_ms(10);
+    _rst = 1;
+
+    command(SSD1306_DISPLAYOFF);
+    command(SSD1306_SETDISPLAYCLOCKDIV);
+    command(0x80);
+    command(SSD1306_SETMULTIPLEX);
+    command(_pages * 8 - 1);
+    command(SSD1306_SETDISPLAYOFFSET);
+    command(0x00);
+    command(SSD1306_SETSTARTLINE | 0x0);
+    command(SSD1306_CHARGEPUMP);
+    command(0x14);
+    command(SSD1306_MEMORYMODE);
+    command(0x00); /* horizontal addressing, so a column/page window fills in order */
+    command(SSD1306_SEGREMAP | 0x1);
+    command(SSD1306_COMSCANDEC);
+    command(SSD1306_SETCOMPINS);
+    command((_pages == 4) ? 0x02 : 0x12);
+    command(SSD1306_SETCONTRAST);
+    command(0x8F);
+    command(SSD1306_SETPRECHARGE);
+    command(0xF1);
+    command(SSD1306_SETVCOMDETECT);
+    command(0x40);
+    command(SSD1306_DISPLAYALLON_RESUME);
+    command(SSD1306_NORMALDISPLAY);
+    command(SSD1306_DISPLAYON);
+}
+
+void SSD1306DmaSpi::command(uint8_t c)
+{
+    _cs = 1;
+    _dc = 0;
+    _cs = 0;
+    _spi.write(c);
+    _cs = 1;
+}
+
+void SSD1306DmaSpi::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    if ((x < 0) || (x >= _rawWidth) || (y < 0) || (y >= _pages * 8)) {
+        return;
+    }
+
+    uint8_t page = y / 8;
+    uint8_t mask = 1 << (y & 7);
+    uint8_t &cell = _buffer[page * _rawWidth + x];
+    uint8_t old = cell;
+
+    switch (color) {
+        case WHITE:   cell |= mask;  break;
+        case BLACK:   cell &= ~mask; break;
+        case INVERSE: cell ^= mask;  break;
+    }
+
+    if (cell != old) {
+        markDirty(page, x, x);
+    }
+}
+
+void SSD1306DmaSpi::clearDisplay()
+{
+    memset(_buffer, 0, sizeof(_buffer));
+    for (uint8_t page = 0; page < _pages; page++) {
+        _dirtyX0[page] = 0;
+        _dirtyX1[page] = _rawWidth - 1;
+    }
+}
+
+void SSD1306DmaSpi::markDirty(uint8_t page, uint8_t x0, uint8_t x1)
+{
+    if (_dirtyX0[page] > _dirtyX1[page]) {
+        _dirtyX0[page] = x0;
+        _dirtyX1[page] = x1;
+        return;
+    }
+    if (x0 < _dirtyX0[page]) {
+        _dirtyX0[page] = x0;
+    }
+    if (x1 > _dirtyX1[page]) {
+        _dirtyX1[page] = x1;
+    }
+}
+
+bool SSD1306DmaSpi::takeDirtyPage(uint8_t &page, uint8_t &x0, uint8_t &x1)
+{
+    for (; page < _pages; page++) {
+        if (_dirtyX0[page] <= _dirtyX1[page]) {
+            x0 = _dirtyX0[page];
+            x1 = _dirtyX1[page];
+            /* Mark clean before sending so pixels drawn meanwhile re-dirty it */
+            _dirtyX0[page] = 0xFF;
+            _dirtyX1[page] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SSD1306DmaSpi::display(Callback<void()> done)
+{
+    if (done) {
+        _done = done;
+    }
+
+    if (_busy) {
+        _again = true;
+        return;
+    }
+
+    if (_resend) {
+        _resend = false;
+        markDirty(_page, _x0, _x1);
+    }
+
+    _busy = true;
+    _page = 0;
+    flushNextPage();
+}
+
+void SSD1306DmaSpi::flushNextPage()
+{
+    if (!takeDirtyPage(_page, _x0, _x1)) {
+        if (_again) {
+            _again = false;
+            _page = 0;
+            if (_queue.call(this, &SSD1306DmaSpi::flushNextPage) == 0) {
+                flushDone();  /* what is still dirty goes with the next display() */
+            }
+        } else {
+            flushDone();
+        }
+        return;
+    }
+
+    _cmd[0] = SSD1306_COLUMNADDR;
+    _cmd[1] = _x0;
+    _cmd[2] = _x1;
+    _cmd[3] = SSD1306_PAGEADDR;
+    _cmd[4] = _page;
+    _cmd[5] = _page;
+
+    _dc = 0;
+    _cs = 0;
+#if DEVICE_SPI_ASYNCH
+    if (_spi.transfer(_cmd, sizeof(_cmd), (uint8_t *)NULL, 0,
+                      event_callback_t(this, &SSD1306DmaSpi::onCommandSent)) != 0) {
+        flushFailed();
+    }
+#else
+    for (unsigned i = 0; i < sizeof(_cmd); i++) {
+        _spi.write(_cmd[i]);
+    }
+    sendPageData();
+#endif
+}
+
+void SSD1306DmaSpi::sendPageData()
+{
+    const uint8_t *data = &_buffer[_page * _rawWidth + _x0];
+    int length = _x1 - _x0 + 1;
+
+    _dc = 1;
+#if DEVICE_SPI_ASYNCH
+    if (_spi.transfer(data, length, (uint8_t *)NULL, 0,
+                      event_callback_t(this, &SSD1306DmaSpi::onDataSent)) != 0) {
+        flushFailed();
+    }
+#else
+    for (int i = 0; i < length; i++) {
+        _spi.write(data[i]);
+    }
+    onDataSent(0);
+#endif
+}
+
+/* Transfer completions arrive in interrupt context, where the SPI driver
+ * cannot be used, so the next step is handed back to the queue. If the queue
+ * is full the refresh stops there and the next display() picks it up. */
+void SSD1306DmaSpi::onCommandSent(int event)
+{
+    (void)event;
+    if (_queue.call(this, &SSD1306DmaSpi::sendPageData) == 0) {
+        _cs = 1;
+        _resend = true;
+        _busy = false;
+    }
+}
+
+void SSD1306DmaSpi::onDataSent(int event)
+{
+    (void)event;
+    _cs = 1;
+    _page++;
+    if (_queue.call(this, &SSD1306DmaSpi::flushNextPage) == 0) {
+        _busy = false;
+    }
+}
+
+/* A transfer of the page could not be started: the page is drawn again by
+ * the next display(), and this refresh ends here. */
+void SSD1306DmaSpi::flushFailed()
+{
+    _cs = 1;
+    _resend = true;
+    flushDone();
+}
+
+void SSD1306DmaSpi::flushDone()
+{
+    _busy = false;
+
+    if (_done) {
+        Callback<void()> done = _done;
+        _done = Callback<void()>();
+        done();
+    }
+}
@@ -0,0 +1,107 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SSD1306_DMA_SPI_H__
+#define __SSD1306_DMA_SPI_H__
+
+#include <events/mbed_events.h>
+#include <mbed.h>
+#include "Adafruit_GFX.h"
+
+/** SSD1306 SPI display with dirty-region flushing.
+ *
+ *  Drawing only touches the RAM framebuffer and records, per 8-pixel page,
+ *  the span of columns that changed. display() then sends just those spans,
+ *  one page at a time. Each page is split into a short command transfer that
+ *  sets the column/page window and a data transfer straight from the
+ *  framebuffer. With DEVICE_SPI_ASYNCH both are asynchronous SPI transfers,
+ *  which the nRF52 HAL runs on SPIM EasyDMA. Each step is chained through
+ *  the event queue passed to the constructor, so other events are dispatched
+ *  between pages. Without it each page is written with the blocking API,
+ *  still one queue event per page.
+ *
+ *  Drawing and display() must be called from the thread that dispatches that
+ *  queue. Pixels drawn while a flush is running are picked up by a second
+ *  pass once the current one completes.
+ */
+class SSD1306DmaSpi : public Adafruit_GFX
+{
+public:
+    enum {
+        BLACK = 0,
+        WHITE = 1,
+        INVERSE = 2
+    };
+
+    SSD1306DmaSpi(SPI &spi, events::EventQueue &queue, PinName dc, PinName rst, PinName cs,
+                  uint8_t rawHeight = 32, uint8_t rawWidth = 128);
+
+    /** Reset and configure the controller; blocking, call once at start up. */
+    void begin();
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color);
+
+    /** Clear the framebuffer; the whole display is flushed on the next display(). */
+    void clearDisplay();
+
+    /** Start sending the dirty regions. Returns immediately; done, if set, is
+     *  called from the event queue once everything drawn so far is on the
+     *  panel. */
+    void display(Callback<void()> done = Callback<void()>());
+
+    bool busy() const { return _busy; }
+
+private:
+    static const uint8_t MAX_WIDTH = 128;
+    static const uint8_t MAX_PAGES = 64 / 8;
+
+    void command(uint8_t c);
+    void markDirty(uint8_t page, uint8_t x0, uint8_t x1);
+    bool takeDirtyPage(uint8_t &page, uint8_t &x0, uint8_t &x1);
+
+    void flushNextPage();
+    void sendPageData();
+    void onCommandSent(int event);
+    void onDataSent(int event);
+    void flushFailed();
+    void flushDone();
+
+    SPI &_spi;
+    events::EventQueue &_queue;
+    DigitalOut _dc;
+    DigitalOut _rst;
+    DigitalOut _cs;
+
+    uint8_t _rawWidth;
+    uint8_t _pages;
+
+    volatile bool _busy;
+    bool _again;
+    volatile bool _resend; /* the page below was taken but not sent */
+    Callback<void()> _done;
+
+    /* Page being sent and its column span */
+    uint8_t _page;
+    uint8_t _x0;
+    uint8_t _x1;
+    uint8_t _cmd[6]; /* in RAM, EasyDMA cannot read from flash */
+
+    uint8_t _dirtyX0[MAX_PAGES]; /* a page is clean when x0 > x1 */
+    uint8_t _dirtyX1[MAX_PAGES];
+    uint8_t _buffer[MAX_WIDTH * MAX_PAGES];
+};
+
+#endif /* __SSD1306_DMA_SPI_H__ */
@@ -19,8 +19,8 @@
 #include "ble/BLE.h"
 #include "SecurityManager.h"
 #include "LEDService.h"
-#include "Adafruit_GFX.h"
-#include "Adafruit_SSD1306.h"
+#include "SSD1306DmaSpi.h"
+#include "StaticInstance.h"
 
 
 /** This example demonstrates all the basic setup required
@@ -38,8 +38,21 @@ static const uint8_t DEVICE_NAME[] = "SM_device";
 static const uint16_t uuid16_list[] = {LEDService::LED_SERVICE_UUID};
 
 LEDService *ledServicePtr;
+static StaticInstance<LEDService> ledService;
 SPI mySPI(p5, p6, p7); // mosi, miso, sclk
-Adafruit_SSD1306_Spi *display;
+SSD1306DmaSpi *display;
+static StaticInstance<SSD1306DmaSpi> displayInstance;
+MBED_ALIGN(8) static unsigned char bleThreadStack[4096];
+
+/** Show a status line on the display. Runs on the application queue; only
+ *  the pixels that changed are sent, without blocking the queue. */
+static void show_status(const char *status)
+{
+    display->fillRect(0, 0, display->width(), 8, SSD1306DmaSpi::BLACK);
+    display->setTextCursor(0, 0);
+    display->printf("%s", status);
+    display->display();
+}
 
 /** Base class for both peripheral and central. The same class that provides
  *  the logic for the application also implements the SecurityManagerEventHandler
@@ -52,10 +65,18 @@ class SMDevice : private mbed::NonCopyable<SMDevice>,
 {
 
 public:
-    SMDevice(BLE &ble, events::EventQueue &event_queue) :
+    /** BLE processing and all BLE API calls run on event_queue, which is
+     *  dispatched by a thread above the application's priority. The LED and
+     *  console status run on app_queue in the calling thread, so they never
+     *  hold up radio events. */
+    SMDevice(BLE &ble, events::EventQueue &event_queue, events::EventQueue &app_queue) :
         _led1(LED1, 0),
+        _ble_thread(osPriorityAboveNormal, sizeof(bleThreadStack), bleThreadStack, "ble"),
+        _advertising(false),
+        _connected(false),
         _ble(ble),
         _event_queue(event_queue),
+        _app_queue(app_queue),
         _handle(0),
         _is_connecting(false) { };
 
@@ -71,31 +92,15 @@ public:
     {
         printf("SMDevice:run: ENTER\r\n");
 
-        ble_error_t error;
-
         /* to show we're running we'll blink every 500ms */
-        _event_queue.call_every(500, this, &SMDevice::blink);
-
-        if (_ble.hasInitialized()) {
-            printf("Ble instance already initialised.\r\n");
-            return;
-        }
-
-        /* this will inform us off all events so we can schedule their handling
-         * using our event queue */
-        _ble.onEventsToProcess(
-            makeFunctionPointer(this, &SMDevice::schedule_ble_events)
-        );
+        _app_queue.call_every(500, this, &SMDevice::blink);
 
-        error = _ble.init(this, &SMDevice::on_init_complete);
-
-        if (error) {
-            printf("Error returned by BLE::init.\r\n");
-            return;
-        }
+        /* initialise from the BLE thread so every stack callback runs there */
+        _event_queue.call(this, &SMDevice::init_ble);
+        _ble_thread.start(callback(&_event_queue, &events::EventQueue::dispatch_forever));
 
         /* this will not return until shutdown */
-        _event_queue.dispatch_forever();
+        _app_queue.dispatch_forever();
 
         printf("SMDevice:run: EXIT\r\n");
     };
@@ -120,8 +125,10 @@ public:
         printf("SMDevice:pairingResult: ENTER\r\n");
         if (result == SecurityManager::SEC_STATUS_SUCCESS) {
             printf("Pairing successful\r\n");
+            _app_queue.call(show_status, "Paired");
         } else {
             printf("Pairing failed\r\n");
+            _app_queue.call(show_status, "Pairing failed");
         }
 
         // /* disconnect in 500 ms */
@@ -141,15 +148,40 @@ public:
         printf("SMDevice:linkEncryptionResult: ENTER\r\n");
         if (result == ble::link_encryption_t::ENCRYPTED) {
             printf("Link ENCRYPTED\r\n");
+            _app_queue.call(show_status, "Encrypted");
         } else if (result == ble::link_encryption_t::ENCRYPTED_WITH_MITM) {
             printf("Link ENCRYPTED_WITH_MITM\r\n");
+            _app_queue.call(show_status, "Encrypted, MITM");
         } else if (result == ble::link_encryption_t::NOT_ENCRYPTED) {
             printf("Link NOT_ENCRYPTED\r\n");
+            _app_queue.call(show_status, "Not encrypted");
         }
         printf("SMDevice:linkEncryptionResult: EXIT\r\n");
     }
 
 private:
+    void init_ble()
+    {
+        ble_error_t error;
+
+        if (_ble.hasInitialized()) {
+            printf("Ble instance already initialised.\r\n");
+            return;
+        }
+
+        /* this will inform us off all events so we can schedule their handling
+         * using our event queue */
+        _ble.onEventsToProcess(
+            makeFunctionPointer(this, &SMDevice::schedule_ble_events)
+        );
+
+        error = _ble.init(this, &SMDevice::on_init_complete);
+
+        if (error) {
+            printf("Error returned by BLE::init.\r\n");
+        }
+    }
+
     /** Override to start chosen activity when initialisation completes */
     virtual void start() = 0;
 
@@ -202,7 +234,7 @@ private:
 
         /* when scanning we want to connect to a peer device so we need to
          * attach callbacks that are used by Gap to notify us of events */
-        _ble.gap().onConnection(this, &SMDevice::on_connect);
+        _ble.gap().onConnection(this, &SMDevice::on_connect_event);
         _ble.gap().onDisconnection(this, &SMDevice::on_disconnect);
 
         /* handle timeouts, for example when connection attempts fail */
@@ -211,7 +243,7 @@ private:
         _ble.gattServer().onDataWritten(this, &SMDevice::onDataWrittenCallback);
         
         bool initialValueForLEDCharacteristic = false;
-        ledServicePtr = new LEDService(_ble, initialValueForLEDCharacteristic);
+        ledServicePtr = new (ledService.allocate()) LEDService(_ble, initialValueForLEDCharacteristic);
 
         /* start test in 500 ms */
         _event_queue.call_in(500, this, &SMDevice::start);
@@ -222,6 +254,13 @@ private:
     /** This is called by Gap to notify the application we connected */
     virtual void on_connect(const Gap::ConnectionCallbackParams_t *connection_event) = 0;
 
+    void on_connect_event(const Gap::ConnectionCallbackParams_t *connection_event)
+    {
+        _advertising = false;
+        _connected = true;
+        on_connect(connection_event);
+    }
+
     /** This is called by Gap to notify the application we disconnected,
      *  in our case it ends the demonstration. */
     void on_disconnect(const Gap::DisconnectionCallbackParams_t *event)
@@ -230,7 +269,8 @@ private:
         printf("SMDevice:on_disconnect: Reason=0x%X\r\n", event->reason);
         // printf("Disconnected - demonstration ended \r\n");
         // _event_queue.break_dispatch();
-        BLE::Instance().gap().startAdvertising();
+        _connected = false;
+        _advertising = (BLE::Instance().gap().startAdvertising() == BLE_ERROR_NONE);
         printf("SMDevice:on_disconnect: EXIT\r\n");
     };
 
@@ -252,27 +292,34 @@ private:
         // printf("SMDevice:schedule_ble_events: EXIT\r\n");
     };
 
-    /** Blink LED to show we're running */
+    /** Blink LED to show we're running. Runs on the application queue, so
+     *  it works from the state mirrored by the BLE callbacks instead of
+     *  calling into the stack. */
     void blink(void)
     {
-        Gap::GapState_t gapState = _ble.gap().getState();
-        printf("Gap State:Advertising=%s, connected=%s\r\n", gapState.advertising ? "On" : "Off", gapState.connected ? "Yes" : "No");
+        bool advertising = _advertising;
+        bool connected = _connected;
+        printf("Gap State:Advertising=%s, connected=%s\r\n", advertising ? "On" : "Off", connected ? "Yes" : "No");
 
         // Solid led if advertising
-        if (gapState.advertising) {
+        if (advertising) {
             _led1.write(0);
         }
-        else if (gapState.connected) {
+        else if (connected) {
             _led1 = !_led1;
         }
     };
 
 private:
     DigitalOut _led1;
+    rtos::Thread _ble_thread;
 
 protected:
+    volatile bool _advertising;
+    volatile bool _connected;
     BLE &_ble;
     events::EventQueue &_event_queue;
+    events::EventQueue &_app_queue;
     ble::connection_handle_t _handle;
     bool _is_connecting;
 };
@@ -281,8 +328,8 @@ protected:
  * a change in link security. */
 class SMDevicePeripheral : public SMDevice {
 public:
-    SMDevicePeripheral(BLE &ble, events::EventQueue &event_queue)
-        : SMDevice(ble, event_queue) { }
+    SMDevicePeripheral(BLE &ble, events::EventQueue &event_queue, events::EventQueue &app_queue)
+        : SMDevice(ble, event_queue, app_queue) { }
 
     virtual void start()
     {
@@ -320,6 +367,7 @@ public:
             printf("Error during Gap::startAdvertising.\r\n");
             return;
         }
+        _advertising = true;
 
         /** This tells the stack to generate a pairingRequest event
          * which will require this application to respond before pairing
@@ -360,14 +408,19 @@ public:
 
 int main()
 {
-    display = new Adafruit_SSD1306_Spi(mySPI, p0, p1, p2, 32, 128);
-
     printf("\r\n main: ENTER \r\n\r\n");
     BLE& ble = BLE::Instance();
-    events::EventQueue queue;
+    static unsigned char queueBuffer[EVENTS_QUEUE_SIZE];
+    events::EventQueue queue(sizeof(queueBuffer), queueBuffer);
+    static unsigned char appQueueBuffer[EVENTS_QUEUE_SIZE];
+    events::EventQueue app_queue(sizeof(appQueueBuffer), appQueueBuffer);
+
+    display = new (displayInstance.allocate()) SSD1306DmaSpi(mySPI, app_queue, p0, p1, p2, 32, 128);
+    display->begin();
+    show_status("Waiting");
 
     printf("\r\n PERIPHERAL \r\n\r\n");
-    SMDevicePeripheral peripheral(ble, queue);
+    SMDevicePeripheral peripheral(ble, queue, app_queue);
     peripheral.run();
 
     printf("\r\n main: EXIT \r\n\r\n");
@@ -0,0 +1,91 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DIE_TEMPERATURE_H__
+#define __DIE_TEMPERATURE_H__
+
+#include <events/mbed_events.h>
+#include <mbed.h>
+#include "nrf.h"
+#if defined(SOFTDEVICE_PRESENT)
+#include "nrf_soc.h"
+#endif
+
+/* nRF52 on-die TEMP sensor, 0.25 C resolution.
+ *
+ * start() triggers a conversion and returns; the result is delivered on the
+ * event queue. Without a SoftDevice the TEMP peripheral is driven directly
+ * and completes through its DATARDY interrupt, so the CPU is free for the
+ * ~36 us conversion. The SoftDevice reserves TEMP: with it the conversion
+ * goes through sd_temp_get(), which blocks for the same time, and the result
+ * is still handed over through the queue so callers see the same behaviour. */
+class DieTemperature {
+public:
+    DieTemperature(EventQueue &queue) : queue(queue), busy(false)
+    {
+        instance() = this;
+    }
+
+    /* Returns false if a conversion is already running. */
+    bool start(Callback<void(float)> callback) {
+        if (busy) {
+            return false;
+        }
+        busy = true;
+        done = callback;
+
+#if defined(SOFTDEVICE_PRESENT)
+        int32_t raw;
+        if (sd_temp_get(&raw) != NRF_SUCCESS) {
+            busy = false;
+            return false;
+        }
+        complete(raw);
+#else
+        NRF_TEMP->EVENTS_DATARDY = 0;
+        NRF_TEMP->INTENSET = TEMP_INTENSET_DATARDY_Msk;
+        NVIC_SetVector(TEMP_IRQn, (uint32_t)&DieTemperature::irqHandler);
+        NVIC_ClearPendingIRQ(TEMP_IRQn);
+        NVIC_EnableIRQ(TEMP_IRQn);
+        NRF_TEMP->TASKS_START = 1;
+#endif
+        return true;
+    }
+
+private:
+    static void irqHandler(void) {
+        NRF_TEMP->EVENTS_DATARDY = 0;
+        NRF_TEMP->TASKS_STOP = 1;
+        instance()->complete((int32_t)NRF_TEMP->TEMP);
+    }
+
+    void complete(int32_t raw) {
+        busy = false;
+        queue.call(done, raw * 0.25f);
+    }
+
+    /* The vector takes a plain function, so the handler finds the object here */
+    static DieTemperature *&instance(void) {
+        static DieTemperature *current;
+        return current;
+    }
+
+    EventQueue           &queue;
+    volatile bool         busy;
+    Callback<void(float)> done;
+};
+
+#endif /* #ifndef __DIE_TEMPERATURE_H__ */
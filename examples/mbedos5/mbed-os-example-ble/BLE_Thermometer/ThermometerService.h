@@ -0,0 +1,114 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_THERMOMETER_SERVICE_H__
+#define __BLE_THERMOMETER_SERVICE_H__
+
+#include "GattServiceBuilder.h"
+
+/* Health Thermometer service with the optional Measurement Interval
+ * characteristic, which the stock HealthThermometerService lacks. The
+ * interval is in seconds and writable by the client; the application sees the
+ * writes through onDataWritten and passes them to onIntervalWritten(). */
+class ThermometerService {
+public:
+    /* Temperature Type values */
+    enum SensorLocation {
+        LOCATION_ARMPIT = 1,
+        LOCATION_BODY,
+        LOCATION_EAR,
+        LOCATION_FINGER,
+        LOCATION_GI_TRACT,
+        LOCATION_MOUTH,
+        LOCATION_RECTUM,
+        LOCATION_TOE,
+        LOCATION_EAR_DRUM,
+    };
+
+    const static uint16_t MIN_INTERVAL_SECONDS = 1;
+    const static uint16_t MAX_INTERVAL_SECONDS = 3600;
+
+    /* Flags byte followed by an IEEE-11073 32-bit FLOAT, in Celsius. */
+    struct TemperatureMeasurement {
+        uint8_t flags;
+        uint8_t value[4];
+    };
+
+    typedef GattCharacteristicSpec<GattCharacteristic::UUID_TEMPERATURE_MEASUREMENT_CHAR, TemperatureMeasurement,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE> MeasurementCharacteristic;
+    typedef GattCharacteristicSpec<GattCharacteristic::UUID_TEMPERATURE_TYPE_CHAR, uint8_t,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ> TypeCharacteristic;
+    typedef GattCharacteristicSpec<0x2A21 /* Measurement Interval */, uint16_t,
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE> IntervalCharacteristic;
+    typedef GattServiceBuilder<GattService::UUID_HEALTH_THERMOMETER_SERVICE,
+                               MeasurementCharacteristic, TypeCharacteristic, IntervalCharacteristic> Service;
+
+    ThermometerService(BLE &_ble, float initialTemp, uint8_t location, uint16_t intervalSeconds) :
+        ble(_ble),
+        service(encode(initialTemp), location, clampInterval(intervalSeconds))
+    {
+        service.add(ble);
+    }
+
+    /* BLE thread only, like every other BLE API call. */
+    void updateTemperature(float temperature) {
+        TemperatureMeasurement measurement = encode(temperature);
+        ble.gattServer().write(service.valueHandle<0>(), reinterpret_cast<uint8_t *>(&measurement), sizeof(measurement));
+    }
+
+    GattAttribute::Handle_t getIntervalHandle() const {
+        return service.valueHandle<2>();
+    }
+
+    /* Returns the accepted interval. Out of range writes are clamped and the
+     * clamped value is written back so the client can read what took effect. */
+    uint16_t onIntervalWritten(const uint8_t *data, uint16_t len) {
+        uint16_t requested = (len >= 2) ? (uint16_t)(data[0] | (data[1] << 8)) : 0;
+        uint16_t accepted  = clampInterval(requested);
+
+        if ((accepted != requested) || (len != 2)) {
+            ble.gattServer().write(getIntervalHandle(), reinterpret_cast<uint8_t *>(&accepted), sizeof(accepted));
+        }
+        return accepted;
+    }
+
+    static uint16_t clampInterval(uint16_t seconds) {
+        if (seconds < MIN_INTERVAL_SECONDS) {
+            return MIN_INTERVAL_SECONDS;
+        }
+        return (seconds > MAX_INTERVAL_SECONDS) ? MAX_INTERVAL_SECONDS : seconds;
+    }
+
+private:
+    /* Exponent -2, so the mantissa is the temperature in hundredths. */
+    static TemperatureMeasurement encode(float temperature) {
+        int32_t centi = (int32_t)((temperature * 100.0f) + ((temperature < 0) ? -0.5f : 0.5f));
+        TemperatureMeasurement measurement;
+
+        measurement.flags    = 0; /* Celsius, no time stamp, no type */
+        measurement.value[0] = (uint8_t)centi;
+        measurement.value[1] = (uint8_t)(centi >> 8);
+        measurement.value[2] = (uint8_t)(centi >> 16);
+        measurement.value[3] = (uint8_t)-2;
+        return measurement;
+    }
+
+    BLE     &ble;
+    Service service;
+};
+
+#endif /* #ifndef __BLE_THERMOMETER_SERVICE_H__ */
@@ -17,38 +17,152 @@
 #include <events/mbed_events.h>
 #include "mbed.h"
 #include "ble/BLE.h"
-#include "ble/services/HealthThermometerService.h"
+#include "ThermometerService.h"
+#include "DieTemperature.h"
+#include "StaticInstance.h"
+#include "I2CScanner.h"
+#include "Tmp102.h"
 
 DigitalOut led1(LED1, 1);
 
 const static char     DEVICE_NAME[]        = "Therm";
 static const uint16_t uuid16_list[]        = {GattService::UUID_HEALTH_THERMOMETER_SERVICE};
 
-static float                     currentTemperature   = 39.6;
-static HealthThermometerService *thermometerServicePtr;
+#ifndef MBED_CONF_APP_MEASUREMENT_INTERVAL
+#define MBED_CONF_APP_MEASUREMENT_INTERVAL 1
+#endif
+
+#ifndef MBED_CONF_APP_TEMPERATURE_HYSTERESIS
+#define MBED_CONF_APP_TEMPERATURE_HYSTERESIS 20
+#endif
+
+/* Readings closer than this to the last one sent are not indicated */
+static const float HYSTERESIS = MBED_CONF_APP_TEMPERATURE_HYSTERESIS / 100.0f;
+
+static float               currentTemperature   = 39.6;
+static ThermometerService *thermometerServicePtr;
+static StaticInstance<ThermometerService> thermometerService;
+
+/* A TMP102 found on the I2C bus at boot is used instead of the on-die sensor */
+static I2C          i2c(I2C_SDA0, I2C_SCL0);
+static I2CScanner   scanner(i2c);
+static Tmp102       thermometer(i2c);
+static SensorDriver *const sensorDrivers[] = { &thermometer };
+static SensorBus    sensors(sensorDrivers, sizeof(sensorDrivers) / sizeof(sensorDrivers[0]));
+
+/* BLE::processEvents and every other BLE API call run on bleQueue, which is
+ * dispatched by bleThread above the application's priority. Sensor polling,
+ * LED blinking and console output run on appQueue in the main thread, and
+ * hand their results back to the stack through bleQueue. */
+static unsigned char bleQueueBuffer[/* event count */ 8 * EVENTS_EVENT_SIZE];
+static EventQueue    bleQueue(sizeof(bleQueueBuffer), bleQueueBuffer);
+static unsigned char appQueueBuffer[/* event count */ 16 * EVENTS_EVENT_SIZE];
+static EventQueue    appQueue(sizeof(appQueueBuffer), appQueueBuffer);
+
+MBED_ALIGN(8) static unsigned char bleThreadStack[2048];
+static Thread bleThread(osPriorityAboveNormal, sizeof(bleThreadStack), bleThreadStack, "ble");
+
+static DieTemperature dieTemperature(appQueue);
+static int            samplingId;
+static float          publishedTemperature;
+
+static volatile bool connected;     /* Written on bleQueue, read on appQueue */
+static volatile bool publishForced; /* Send the next reading regardless of hysteresis */
+static volatile bool publishPending;
+static uint32_t      appDropped;
+
+/* Post work from the BLE side to the application; drop it rather than block
+ * the BLE thread when appQueue is full. */
+template <typename F>
+static void postToApp(F f)
+{
+    if (!appQueue.call(f)) {
+        appDropped++;
+    }
+}
 
-static EventQueue eventQueue(/* event count */ 16 * EVENTS_EVENT_SIZE);
+void connectionCallback(const Gap::ConnectionCallbackParams_t *)
+{
+    publishForced = true;
+    connected = true;
+}
 
 /* Restart Advertising on disconnection*/
 void disconnectionCallback(const Gap::DisconnectionCallbackParams_t *)
 {
+    connected = false;
     BLE::Instance().gap().startAdvertising();
 }
 
-void updateSensorValue(void) {
-    /* Do blocking calls or whatever is necessary for sensor polling.
-       In our case, we simply update the Temperature measurement. */
-    currentTemperature = (currentTemperature + 0.1 > 43.0) ? 39.6 : currentTemperature + 0.1;
+void publishTemperature(void)
+{
+    publishPending = false;
     thermometerServicePtr->updateTemperature(currentTemperature);
 }
 
-void periodicCallback(void)
+void onSensorScanDone(const I2CScanner::Result &result)
 {
-    led1 = !led1; /* Do blinky on LED1 while we're waiting for BLE events */
+    if (result.state == I2CScanner::BUS_OK) {
+        sensors.bind(result);
+    }
+}
+
+void onTemperature(float temperature) {
+    currentTemperature = temperature;
+
+    if (!connected) {
+        return;
+    }
+
+    float change = temperature - publishedTemperature;
+    if (!publishForced && (change < HYSTERESIS) && (change > -HYSTERESIS)) {
+        return;
+    }
+    publishForced = false;
+    publishedTemperature = temperature;
+
+    /* Back-pressure: a value still waiting on bleQueue is superseded by the
+     * new reading instead of queuing a second update. */
+    if (!publishPending) {
+        publishPending = true;
+        if (!bleQueue.call(publishTemperature)) {
+            publishPending = false;
+        }
+    }
+}
+
+/* Runs every measurement interval, connected or not, so the first reading
+ * after a connection is current. */
+void updateSensorValue(void) {
+    if (thermometer.bound()) {
+        sensors.poll();
+        onTemperature(thermometer.temperature());
+    } else {
+        dieTemperature.start(onTemperature);
+    }
+}
 
-    if (BLE::Instance().gap().getState().connected) {
-        eventQueue.call(updateSensorValue);
+void setMeasurementInterval(uint16_t seconds)
+{
+    if (samplingId) {
+        appQueue.cancel(samplingId);
     }
+    samplingId = appQueue.call_every(seconds * 1000, updateSensorValue);
+}
+
+void dataWrittenCallback(const GattWriteCallbackParams *params)
+{
+    if (params->handle == thermometerServicePtr->getIntervalHandle()) {
+        uint16_t seconds = thermometerServicePtr->onIntervalWritten(params->data, params->len);
+        if (!appQueue.call(setMeasurementInterval, seconds)) {
+            appDropped++;
+        }
+    }
+}
+
+void periodicCallback(void)
+{
+    led1 = !led1; /* Do blinky on LED1 while we're waiting for BLE events */
 }
 
 void onBleInitError(BLE &ble, ble_error_t error)
@@ -56,12 +170,11 @@ void onBleInitError(BLE &ble, ble_error_t error)
    /* Initialization error handling should go here */
 }
 
+static Gap::Address_t address;
+
 void printMacAddress()
 {
     /* Print out device MAC address to the console*/
-    Gap::AddressType_t addr_type;
-    Gap::Address_t address;
-    BLE::Instance().gap().getAddress(&addr_type, address);
     printf("DEVICE MAC ADDRESS: ");
     for (int i = 5; i >= 1; i--){
         printf("%02x:", address[i]);
@@ -83,10 +196,13 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
         return;
     }
 
+    ble.gap().onConnection(connectionCallback);
     ble.gap().onDisconnection(disconnectionCallback);
+    ble.gattServer().onDataWritten(dataWrittenCallback);
 
     /* Setup primary service. */
-    thermometerServicePtr = new HealthThermometerService(ble, currentTemperature, HealthThermometerService::LOCATION_EAR);
+    thermometerServicePtr = new (thermometerService.allocate()) ThermometerService(ble, currentTemperature, ThermometerService::LOCATION_EAR,
+                                                                                   MBED_CONF_APP_MEASUREMENT_INTERVAL);
 
     /* setup advertising */
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
@@ -97,23 +213,35 @@ void bleInitComplete(BLE::InitializationCompleteCallbackContext *params)
     ble.gap().setAdvertisingInterval(1000); /* 1000ms */
     ble.gap().startAdvertising();
 
-    printMacAddress();
+    Gap::AddressType_t addr_type;
+    ble.gap().getAddress(&addr_type, address);
+    postToApp(printMacAddress);
 }
 
 void scheduleBleEventsProcessing(BLE::OnEventsToProcessCallbackContext* context) {
     BLE &ble = BLE::Instance();
-    eventQueue.call(Callback<void()>(&ble, &BLE::processEvents));
+    bleQueue.call(Callback<void()>(&ble, &BLE::processEvents));
 }
 
-int main()
+void initBle(void)
 {
-    eventQueue.call_every(500, periodicCallback);
-
     BLE &ble = BLE::Instance();
     ble.onEventsToProcess(scheduleBleEventsProcessing);
     ble.init(bleInitComplete);
+}
+
+int main()
+{
+    scanner.start(appQueue, onSensorScanDone);
+    appQueue.call_every(500, periodicCallback);
+    setMeasurementInterval(ThermometerService::clampInterval(MBED_CONF_APP_MEASUREMENT_INTERVAL));
+
+    /* BLE is initialised from its own thread so that every stack callback
+     * runs there. */
+    bleQueue.call(initBle);
+    bleThread.start(callback(&bleQueue, &EventQueue::dispatch_forever));
 
-    eventQueue.dispatch_forever();
+    appQueue.dispatch_forever();
 
     return 0;
 }
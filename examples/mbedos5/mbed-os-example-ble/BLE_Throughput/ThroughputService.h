@@ -0,0 +1,390 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BLE_THROUGHPUT_SERVICE_H__
+#define __BLE_THROUGHPUT_SERVICE_H__
+
+#include <mbed.h>
+#include "ble/BLE.h"
+
+/* Throughput benchmark service driven by tools/ble_bench, with the same UUIDs,
+ * commands and statistics as ble_tput.h of the nRF5 SDK ble_app_blinky:
+ *
+ *   ...0002 control point  write, write without response, notify
+ *   ...0003 data           notify, write without response as a sink
+ *   ...0004 statistics     read, 42 bytes little endian
+ *
+ * Commands are an opcode and parameters; the reply is notified on the control
+ * point as the opcode | 0x80 and a status byte:
+ *
+ *   0x01 RESET                   clear the statistics, stop a notification run
+ *   0x02 NOTIFY u32 bytes, u16 length
+ *                                notifications start with a u32 sequence number;
+ *                                a last one of fewer than 4 bytes is padded to 4
+ *   0x03 ECHO u32 token          the token comes back in the reply
+ *   0x04 LINK u8 phy, u16 interval, u16 slave latency
+ *
+ * A command written while the reply to the previous one is still waiting for a
+ * notification buffer is dropped.
+ *
+ * onDataSent reports the notifications acknowledged in one connection event,
+ * so the transmit side counts connection events as on the SoftDevice. This
+ * version of the BLE API has no PHY update and no connection parameter update
+ * complete event: LINK only takes the 1M PHY, and the statistics show the
+ * interval requested last. The ATT MTU stays at the default 23 bytes. */
+class ThroughputService {
+public:
+    enum {
+        OP_RESET  = 0x01,
+        OP_NOTIFY = 0x02,
+        OP_ECHO   = 0x03,
+        OP_LINK   = 0x04,
+        OP_REPLY  = 0x80
+    };
+
+    enum {
+        STATUS_SUCCESS     = 0x00,
+        STATUS_UNSUPPORTED = 0x01,
+        STATUS_INVALID     = 0x02,
+        STATUS_BUSY        = 0x03,
+        STATUS_FAILED      = 0x04
+    };
+
+    static const uint16_t ATT_MTU     = 23;
+    static const uint16_t PAYLOAD_MAX = ATT_MTU - 3;
+    static const uint16_t CONTROL_MAX = 8;
+    static const uint16_t STATS_LEN   = 42;
+
+    ThroughputService(BLE &_ble) :
+        ble(_ble),
+        controlChar(UUID("7a2f0002-a1c4-4e5b-9f0d-3c6b8e1d2a47"), controlValue, 0, CONTROL_MAX,
+                    GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE |
+                    GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE |
+                    GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY),
+        dataChar(UUID("7a2f0003-a1c4-4e5b-9f0d-3c6b8e1d2a47"), payload, 0, PAYLOAD_MAX,
+                 GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE |
+                 GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY),
+        statsChar(UUID("7a2f0004-a1c4-4e5b-9f0d-3c6b8e1d2a47"), encoded, STATS_LEN, STATS_LEN,
+                  GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ, NULL, 0, false),
+        connHandle(0), interval(0), slaveLatency(0),
+        replyLen(0), txActive(false), txRemaining(0), txLength(0), txSeq(0), inFlight(0)
+    {
+        for (unsigned i = 0; i < sizeof(payload); i++) {
+            payload[i] = (uint8_t)i;
+        }
+        reset();
+
+        statsChar.setReadAuthorizationCallback(this, &ThroughputService::onStatsRead);
+
+        GattCharacteristic *table[] = {&controlChar, &dataChar, &statsChar};
+        GattService service(UUID("7a2f0001-a1c4-4e5b-9f0d-3c6b8e1d2a47"), table,
+                            sizeof(table) / sizeof(table[0]));
+        ble.gattServer().addService(service);
+
+        ble.gattServer().onDataWritten(this, &ThroughputService::onDataWritten);
+        ble.gattServer().onDataSent(this, &ThroughputService::onDataSent);
+
+        timer.start();
+    }
+
+    void onConnection(const Gap::ConnectionCallbackParams_t *params) {
+        connHandle   = params->handle;
+        interval     = params->connectionParams->maxConnectionInterval;
+        slaveLatency = params->connectionParams->slaveLatency;
+        inFlight     = 0;
+        replyLen     = 0;
+        reset();
+    }
+
+    void onDisconnection(void) {
+        inFlight = 0;
+        replyLen = 0;
+        reset();
+    }
+
+private:
+    void reset(void) {
+        rxBytes = rxPackets = rxElapsed = rxEvents = 0;
+        txBytes = txPackets = txElapsed = txEvents = 0;
+        txRemaining = 0;
+        txSeq       = 0;
+        txActive    = false;
+    }
+
+    /* Returns false when the stack has no free notification buffer. Without a
+     * subscription write() would only set the value, so nothing is sent. */
+    bool notify(GattCharacteristic &characteristic, const uint8_t *data, uint16_t len, bool *sent) {
+        bool notifying = false;
+
+        ble.gattServer().areUpdatesEnabled(characteristic, &notifying);
+        if (!notifying) {
+            *sent = false;
+            return true;
+        }
+
+        ble_error_t err = ble.gattServer().write(characteristic.getValueHandle(), data, len);
+        *sent = (err == BLE_ERROR_NONE);
+        if (*sent) {
+            inFlight++;
+        }
+        return (err != BLE_STACK_BUSY);
+    }
+
+    /* Sends the waiting reply, then as much of the notification run as the stack takes. */
+    void pump(void) {
+        bool sent;
+
+        if (replyLen > 0) {
+            if (!notify(controlChar, reply, replyLen, &sent)) {
+                return;
+            }
+            replyLen = 0;
+        }
+
+        while (txRemaining > 0) {
+            uint16_t len = (txRemaining < txLength) ? (uint16_t)txRemaining : txLength;
+
+            /* The last notification still carries the whole sequence number. */
+            if (len < 4) {
+                len = 4;
+            }
+
+            encode32(txSeq, payload);
+            if (!notify(dataChar, payload, len, &sent)) {
+                return;
+            }
+            if (!sent) {
+                txRemaining = 0;
+                txActive    = (inFlight > 0);
+                return;
+            }
+
+            if (txSeq == 0) {
+                txFirst = timer.read_us();
+            }
+            txSeq++;
+            txRemaining -= (len < txRemaining) ? len : txRemaining;
+            txBytes     += len;
+            txPackets++;
+        }
+    }
+
+    void sendReply(uint8_t op, uint8_t status, const uint8_t *data = NULL, uint16_t len = 0) {
+        reply[0] = op | OP_REPLY;
+        reply[1] = status;
+        if (len > 0) {
+            memcpy(&reply[2], data, len);
+        }
+        replyLen = 2 + len;
+        pump();
+    }
+
+    uint8_t startNotify(const uint8_t *params, uint16_t len) {
+        if (len != 6) {
+            return STATUS_INVALID;
+        }
+        uint32_t bytes  = decode32(&params[0]);
+        uint16_t length = decode16(&params[4]);
+
+        if ((bytes == 0) || (length < 4) || (length > PAYLOAD_MAX)) {
+            return STATUS_INVALID;
+        }
+        if (txActive) {
+            return STATUS_BUSY;
+        }
+
+        txBytes = txPackets = txElapsed = txEvents = 0;
+        txRemaining = bytes;
+        txLength    = length;
+        txSeq       = 0;
+        txActive    = true;
+        return STATUS_SUCCESS;
+    }
+
+    uint8_t requestLink(const uint8_t *params, uint16_t len) {
+        Gap::ConnectionParams_t connParams;
+
+        if (len != 5) {
+            return STATUS_INVALID;
+        }
+        if (params[0] != BLE_PHY_1M) {
+            return STATUS_INVALID;
+        }
+
+        connParams.minConnectionInterval = decode16(&params[1]);
+        connParams.maxConnectionInterval = connParams.minConnectionInterval;
+        connParams.slaveLatency          = decode16(&params[3]);
+
+        /* More than twice the time between two events the slave listens to, and at least 4 s. */
+        uint32_t timeout = ((1 + connParams.slaveLatency) * connParams.maxConnectionInterval * 250 + 999) / 1000 + 1;
+        connParams.connectionSupervisionTimeout = (timeout > 400) ? timeout : 400;
+
+        if (ble.gap().updateConnectionParams(connHandle, &connParams) != BLE_ERROR_NONE) {
+            return STATUS_FAILED;
+        }
+        interval     = connParams.maxConnectionInterval;
+        slaveLatency = connParams.slaveLatency;
+        return STATUS_SUCCESS;
+    }
+
+    void onControlWrite(const uint8_t *data, uint16_t len) {
+        uint8_t status;
+
+        if (len == 0) {
+            return;
+        }
+
+        /* There is room for one reply: a command written before the last one was sent is dropped. */
+        if (replyLen > 0) {
+            return;
+        }
+
+        switch (data[0]) {
+            case OP_RESET:
+                reset();
+                status = STATUS_SUCCESS;
+                break;
+            case OP_NOTIFY:
+                status = startNotify(&data[1], len - 1);
+                break;
+            case OP_ECHO:
+                if (len != 5) {
+                    status = STATUS_INVALID;
+                    break;
+                }
+                sendReply(data[0], STATUS_SUCCESS, &data[1], 4);
+                return;
+            case OP_LINK:
+                status = requestLink(&data[1], len - 1);
+                break;
+            default:
+                status = STATUS_UNSUPPORTED;
+                break;
+        }
+        sendReply(data[0], status);
+    }
+
+    /* Writes closer than half a connection interval are counted in one event. */
+    void onDataWrite(uint16_t len) {
+        uint32_t now = timer.read_us();
+
+        if (rxPackets == 0) {
+            rxFirst  = now;
+            rxEvents = 1;
+        } else if ((now - rxLast) > (interval * 1250UL) / 2) {
+            rxEvents++;
+        }
+        rxLast = now;
+
+        rxPackets++;
+        rxBytes  += len;
+        rxElapsed = rxLast - rxFirst;
+    }
+
+    void onDataWritten(const GattWriteCallbackParams *params) {
+        if (params->handle == controlChar.getValueHandle()) {
+            onControlWrite(params->data, params->len);
+        } else if (params->handle == dataChar.getValueHandle()) {
+            onDataWrite(params->len);
+        }
+    }
+
+    void onDataSent(unsigned count) {
+        inFlight -= (count < inFlight) ? count : inFlight;
+
+        if (txActive) {
+            txEvents++;
+            txElapsed = timer.read_us() - txFirst;
+            if ((txRemaining == 0) && (inFlight == 0)) {
+                txActive = false;
+            }
+        }
+        pump();
+    }
+
+    /* A long read comes back with a non-zero offset; it keeps the values of its first part. */
+    void onStatsRead(GattReadAuthCallbackParams *params) {
+        if (params->offset == 0) {
+            uint8_t *p = encoded;
+
+            p = encode32(rxBytes, p);
+            p = encode32(rxPackets, p);
+            p = encode32(rxElapsed, p);
+            p = encode32(rxEvents, p);
+            p = encode32(txBytes, p);
+            p = encode32(txPackets, p);
+            p = encode32(txElapsed, p);
+            p = encode32(txEvents, p);
+            p = encode16(interval, p);
+            p = encode16(slaveLatency, p);
+            p = encode16(ATT_MTU, p);
+            p = encode16(27, p);  /* No data length extension in this stack. */
+            *p++ = BLE_PHY_1M;
+            *p++ = BLE_PHY_1M;
+        }
+
+        params->data               = encoded;
+        params->len                = STATS_LEN;
+        params->authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
+    }
+
+    static uint8_t *encode16(uint16_t value, uint8_t *p) {
+        p[0] = (uint8_t)value;
+        p[1] = (uint8_t)(value >> 8);
+        return p + 2;
+    }
+
+    static uint8_t *encode32(uint32_t value, uint8_t *p) {
+        return encode16((uint16_t)(value >> 16), encode16((uint16_t)value, p));
+    }
+
+    static uint16_t decode16(const uint8_t *p) {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    static uint32_t decode32(const uint8_t *p) {
+        return decode16(p) | ((uint32_t)decode16(p + 2) << 16);
+    }
+
+    /* BLE_GAP_PHY_1MBPS of the SoftDevice, as carried by LINK and the statistics. */
+    static const uint8_t BLE_PHY_1M = 0x01;
+
+    BLE                &ble;
+    uint8_t             controlValue[CONTROL_MAX];
+    uint8_t             payload[PAYLOAD_MAX];
+    uint8_t             encoded[STATS_LEN];
+    GattCharacteristic  controlChar;
+    GattCharacteristic  dataChar;
+    GattCharacteristic  statsChar;
+    Timer               timer;
+
+    Gap::Handle_t connHandle;
+    uint16_t      interval;
+    uint16_t      slaveLatency;
+
+    uint8_t  reply[CONTROL_MAX];
+    uint16_t replyLen;
+
+    uint32_t rxBytes, rxPackets, rxElapsed, rxEvents, rxFirst, rxLast;
+    uint32_t txBytes, txPackets, txElapsed, txEvents, txFirst;
+    bool     txActive;
+    uint32_t txRemaining;
+    uint16_t txLength;
+    uint32_t txSeq;
+    unsigned inFlight;
+};
+
+#endif /* #ifndef __BLE_THROUGHPUT_SERVICE_H__ */
@@ -0,0 +1,64 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TMP102_H
+#define TMP102_H
+
+#include "SensorDriver.h"
+
+/**
+ *  TI TMP102 temperature sensor, left in its default 4 Hz continuous
+ *  conversion mode. poll() reads the 12-bit result in one two-byte burst.
+ */
+class Tmp102 : public SensorDriver {
+public:
+    static const uint8_t DEFAULT_ADDRESS = 0x48;
+
+    Tmp102(I2C &i2c, uint8_t address = DEFAULT_ADDRESS) : SensorDriver(i2c, address), value(0)
+    {
+    }
+
+    virtual const char *name() const
+    {
+        return "TMP102";
+    }
+
+    /** The part has no ID register; the read-only resolution bits of the
+     *  configuration register always read back as 11. */
+    virtual bool init()
+    {
+        uint8_t config[2];
+
+        if (!read_registers(REG_CONFIG, config, sizeof(config))) {
+            return false;
+        }
+        return (config[0] & 0x60) == 0x60;
+    }
+
+    virtual bool poll()
+    {
+        uint8_t raw[2];
+
+        if (!read_registers(REG_TEMPERATURE, raw, sizeof(raw))) {
+            return false;
+        }
+        value = (int16_t)((raw[0] << 8) | raw[1]) >> 4;
+        return true;
+    }
+
+    /** Last reading in degrees Celsius. */
+    float temperature() const
+    {
+        return value * 0.0625f;
+    }
+
+private:
+    static const uint8_t REG_TEMPERATURE = 0x00;
+    static const uint8_t REG_CONFIG      = 0x01;
+
+    int16_t value;
+};
+
+#endif // TMP102_H
@@ -4,42 +4,77 @@
  */
 
 #include "mbed.h"
-
-/* Number of possible I2C addresses. */
-#define I2C_ADDRESSES      255
+#include "I2CScanner.h"
+#include "SensorDriver.h"
+#include "Max30102.h"
+#include "Tmp102.h"
 
 DigitalOut led1(LED1);
 
-I2C i2c(I2C_SDA0, I2C_SCL0); 
+I2C i2c(I2C_SDA0, I2C_SCL0);
 
+I2CScanner scanner(i2c);
 
-// main() runs in its own thread in the OS
-int main()
-{
-    int address;
-    char sample_data;
-    bool detected_device = false;
+/* Drivers for the parts this board setup may carry; bound after the scan */
+Max30102 hrm(i2c);
+Tmp102   thermometer(i2c);
+SensorDriver *const drivers[] = { &hrm, &thermometer };
+SensorBus sensors(drivers, sizeof(drivers) / sizeof(drivers[0]));
 
-    int rslt;
+static unsigned char queueBuffer[/* event count */ 8 * EVENTS_EVENT_SIZE];
+static EventQueue    queue(sizeof(queueBuffer), queueBuffer);
 
-    for (address = 1; address <= I2C_ADDRESSES; address++)
-    {
-    	rslt = i2c.read(address, &sample_data, sizeof(sample_data));
+void scanDone(const I2CScanner::Result &result)
+{
+    static const char *const states[] = { "OK", "ERROR", "STUCK" };
 
-    	if(rslt == 0) //0 on success (ack)
-    	{
-    		detected_device = true;
-    		printf("I2C device detected at address 0x%x.\r\n", address);
-    	}
+    for (int address = I2CScanner::FIRST_ADDRESS; address <= I2CScanner::LAST_ADDRESS; address++) {
+        if (result.has(address)) {
+            printf("I2C device detected at address 0x%x.\r\n", address);
+        }
+    }
+    if (result.count == 0) {
+        printf("No device was found.\r\n");
     }
-    if (!detected_device)
-    {
-    	printf("No device was found.\r\n");
+
+    printf("I2C bus %s, %d device(s), scan took %lu us.\r\n",
+           states[result.state], result.count, (unsigned long)result.duration_us);
+
+    if (result.state == I2CScanner::BUS_OK) {
+        sensors.bind(result);
     }
+}
 
-    while (true) {
-        // Blink LED and wait 0.5 seconds
-        led1 = !led1;
-        wait(0.5f);
+void pollSensors(void)
+{
+    sensors.poll();
+
+    if (hrm.bound()) {
+        printf("Heart rate: %d bpm\r\n", hrm.bpm());
+    }
+    if (thermometer.bound()) {
+        int centi = (int)(thermometer.temperature() * 100);
+        printf("Temperature: %s%d.%02d C\r\n", (centi < 0) ? "-" : "",
+               abs(centi) / 100, abs(centi) % 100);
     }
 }
+
+void blink(void)
+{
+    led1 = !led1;
+}
+
+// main() runs in its own thread in the OS
+int main()
+{
+    // The scan runs in the background; the rest of start up does not wait for it
+    scanner.start(queue, scanDone);
+
+    // Blink LED every 0.5 seconds
+    queue.call_every(500, blink);
+
+    // Bound sensors drain their FIFOs in one burst every 500 ms
+    queue.call_every(500, pollSensors);
+
+    queue.dispatch_forever();
+}
@@ -30,6 +30,40 @@
 
 static volatile int g_task1_loops;
 
+#if MYNEWT_VAL(BLINKY_POWER_STATS)
+/* Incremented by the idle task each time it wakes up */
+extern uint32_t g_os_idle_ctr;
+
+/**
+ * Idle wakeups, for comparing power builds. Every wakeup of the idle
+ * task is the CPU leaving sleep: with the tick running that happens
+ * OS_TICKS_PER_SEC times a blink, with tickless idle about once.
+ */
+struct blinky_power {
+    uint32_t blinks;
+    uint32_t wakeups;           /* since boot */
+    uint32_t wakeups_last;      /* during the last blink period */
+    uint32_t wakeups_max;       /* worst blink period so far */
+};
+
+volatile struct blinky_power g_blinky_power;
+
+static void
+blinky_power_update(void)
+{
+    static uint32_t idle_prev;
+    uint32_t idle = g_os_idle_ctr;
+
+    g_blinky_power.blinks++;
+    g_blinky_power.wakeups_last = idle - idle_prev;
+    g_blinky_power.wakeups += g_blinky_power.wakeups_last;
+    if (g_blinky_power.wakeups_last > g_blinky_power.wakeups_max) {
+        g_blinky_power.wakeups_max = g_blinky_power.wakeups_last;
+    }
+    idle_prev = idle;
+}
+#endif
+
 /* For LED toggling */
 int g_led_pin;
 
@@ -63,6 +97,10 @@ main(int argc, char **argv)
 
         /* Toggle the LED */
         hal_gpio_toggle(g_led_pin);
+
+#if MYNEWT_VAL(BLINKY_POWER_STATS)
+        blinky_power_update();
+#endif
     }
     assert(0);
 
@@ -0,0 +1,142 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "sysinit/sysinit.h"
+#include "os/os.h"
+#include "bsp/bsp.h"
+#include "hal/hal_gpio.h"
+#include "console/console.h"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+
+#define BENCH_REPORT(key, value) \
+    console_printf("BENCH " key " %lu\n", (unsigned long)(value))
+#include "rtos_bench.h"
+
+#define BENCH_TASK_PRIO         10
+#define BENCH_STACK_SIZE        OS_STACK_ALIGN(256)
+
+static struct os_task bench_task;
+static os_stack_t bench_stack[BENCH_STACK_SIZE];
+static struct os_sem bench_adv_sem;
+static struct os_sem bench_wake_sem;
+
+static void
+bench_adv_start(void)
+{
+    struct ble_gap_adv_params adv_params;
+    struct ble_hs_adv_fields fields;
+    uint8_t own_addr_type;
+    int rc;
+
+    rc = ble_hs_util_ensure_addr(0);
+    assert(rc == 0);
+    rc = ble_hs_id_infer_auto(0, &own_addr_type);
+    assert(rc == 0);
+
+    memset(&fields, 0, sizeof(fields));
+    fields.flags = BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.name = (uint8_t *)"rtos_bench";
+    fields.name_len = strlen((char *)fields.name);
+    fields.name_is_complete = 1;
+    rc = ble_gap_adv_set_fields(&fields);
+    assert(rc == 0);
+
+    memset(&adv_params, 0, sizeof(adv_params));
+    adv_params.conn_mode = BLE_GAP_CONN_MODE_NON;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    rc = ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER, &adv_params,
+                           NULL, NULL);
+    assert(rc == 0);
+
+    bench_adv_started();
+    os_sem_release(&bench_adv_sem);
+}
+
+static void
+bench_pin_handler(void *arg)
+{
+    bench_isr();
+    os_sem_release(&bench_wake_sem);
+}
+
+/**
+ * The latency test: raise the stimulus, wait for the interrupt to wake
+ * this task and time both.
+ */
+static void
+bench_task_handler(void *arg)
+{
+    os_sem_pend(&bench_adv_sem, OS_TIMEOUT_NEVER);
+
+    hal_gpio_irq_init(BENCH_STIM_IN_PIN, bench_pin_handler, NULL,
+                      HAL_GPIO_TRIG_RISING, HAL_GPIO_PULL_DOWN);
+    hal_gpio_irq_enable(BENCH_STIM_IN_PIN);
+
+    do {
+        os_time_delay(os_time_ms_to_ticks32(BENCH_GAP_MS));
+        bench_stimulus();
+        os_sem_pend(&bench_wake_sem, OS_TIMEOUT_NEVER);
+    } while (!bench_thread());
+
+    hal_gpio_irq_release(BENCH_STIM_IN_PIN);
+    bench_report();
+
+    /* Idle phase: nothing left running */
+    ble_gap_adv_stop();
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/**
+ * main
+ *
+ * Runs the boot time and wake latency scenario of tools/rtos_bench. The
+ * marker goes high before anything else runs and low once NimBLE is
+ * advertising; the latency test then runs in its own task.
+ *
+ * @return int NOTE: this function should never return!
+ */
+int
+main(int argc, char **argv)
+{
+    bench_main_entry();
+
+    sysinit();
+
+    os_sem_init(&bench_adv_sem, 0);
+    os_sem_init(&bench_wake_sem, 0);
+    os_task_init(&bench_task, "bench", bench_task_handler, NULL,
+                 BENCH_TASK_PRIO, OS_WAIT_FOREVER, bench_stack,
+                 BENCH_STACK_SIZE);
+
+    ble_hs_cfg.sync_cb = bench_adv_start;
+
+    while (1) {
+        os_eventq_run(os_eventq_dflt_get());
+    }
+    assert(0);
+
+    return 0;
+}
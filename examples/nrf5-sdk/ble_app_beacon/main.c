@@ -49,6 +49,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "nordic_common.h"
 #include "bsp.h"
 #include "nrf_soc.h"
@@ -57,11 +58,27 @@
 #include "ble_advdata.h"
 #include "app_timer.h"
 #include "nrf_pwr_mgmt.h"
+#include "retained.h"
+#include "crc16.h"
+#if defined(USE_RADIO_NOTIFICATION_FOR_SENSOR_DATA)
+#include "ble_radio_notification.h"
+#endif
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
+#if defined(RTOS_BENCH)
+#include "nrf_drv_gpiote.h"
+
+#define BENCH_REPORT(key, value) NRF_LOG_INFO("BENCH " key " %u", (value))
+#include "rtos_bench.h"
+
+BOARD_PINS_CLAIM((1UL << BENCH_MARKER_PIN) | (1UL << BENCH_STIM_OUT_PIN) | (1UL << BENCH_STIM_IN_PIN),
+                 BOARD_LEDS_PIN_MASK | BOARD_BUTTONS_PIN_MASK | BOARD_UART_PIN_MASK |
+                 BOARD_NFC_PIN_MASK | BOARD_RESET_PIN_MASK);
+#endif
+
 
 #define APP_BLE_CONN_CFG_TAG            1                                  /**< A tag identifying the SoftDevice BLE configuration. */
 
@@ -81,21 +98,35 @@
 
 #define DEAD_BEEF                       0xDEADBEEF                         /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
+#define ADV_CACHE_VERSION               2                                  /**< Layout version of the retained advertising set. Change it when adv_cache_t changes. */
+
 #if defined(USE_UICR_FOR_MAJ_MIN_VALUES)
 #define MAJ_VAL_OFFSET_IN_BEACON_INFO   18                                 /**< Position of the MSB of the Major Value in m_beacon_info array. */
 #define UICR_ADDRESS                    0x10001080                         /**< Address of the UICR register used by this example. The major and minor versions to be encoded into the advertising data will be picked up from this location. */
 #endif
 
+#if defined(USE_RADIO_NOTIFICATION_FOR_SENSOR_DATA)
+#define MIN_VAL_OFFSET_IN_BEACON_INFO   20                                 /**< Position of the MSB of the Minor Value in m_beacon_info array. */
+#define RADIO_NOTIFICATION_IRQ_PRIORITY 6                                  /**< Priority of the radio notification interrupt. Must be low enough to call the SoftDevice. */
+#define RADIO_NOTIFICATION_DISTANCE     NRF_RADIO_NOTIFICATION_DISTANCE_800US /**< Time between the ACTIVE signal and the start of the advertising event. */
+#endif
+
 static ble_gap_adv_params_t m_adv_params;                                  /**< Parameters to be passed to the stack when starting advertising. */
 static uint8_t              m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET; /**< Advertising handle used to identify an advertising set. */
-static uint8_t              m_enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];  /**< Buffer for storing an encoded advertising set. */
+#if defined(USE_RADIO_NOTIFICATION_FOR_SENSOR_DATA)
+static uint8_t              m_enc_advdata[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX]; /**< Encoded advertising sets; the SoftDevice keeps using one while the other is updated. */
+static uint8_t              m_enc_advdata_idx;                             /**< Index of the buffer currently in use by the SoftDevice. */
+static uint16_t             m_beacon_info_offset;                          /**< Position of m_beacon_info in the encoded advertising set. */
+#else
+static uint8_t              m_enc_advdata[1][BLE_GAP_ADV_SET_DATA_SIZE_MAX]; /**< Buffer for storing an encoded advertising set. */
+#endif
 
 /**@brief Struct that contains pointers to the encoded advertising data. */
 static ble_gap_adv_data_t m_adv_data =
 {
     .adv_data =
     {
-        .p_data = m_enc_advdata,
+        .p_data = m_enc_advdata[0],
         .len    = BLE_GAP_ADV_SET_DATA_SIZE_MAX
     },
     .scan_rsp_data =
@@ -120,6 +151,16 @@ static uint8_t m_beacon_info[APP_BEACON_INFO_LENGTH] =                    /**< I
                          // this implementation.
 };
 
+/**@brief Advertising set kept in retained RAM, so that a warm boot does not encode it again. */
+typedef struct
+{
+    uint16_t input_crc;                                 /**< CRC16 of the encoder input the set was built from. */
+    uint16_t len;                                       /**< Length of the encoded set. */
+    uint8_t  enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+} adv_cache_t;
+
+RETAINED_DEF(m_adv_cache, adv_cache_t);
+
 
 /**@brief Callback function for asserts in the SoftDevice.
  *
@@ -137,6 +178,82 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
     app_error_handler(DEAD_BEEF, line_num, p_file_name);
 }
 
+#if defined(USE_RADIO_NOTIFICATION_FOR_SENSOR_DATA)
+/**@brief Function for reading the sensor data advertised in place of the minor value.
+ *
+ * @details The die temperature is used here, in 0.25 degree Celsius steps. Replace this with the
+ *          application's own sensor; it runs in the radio notification interrupt, so it has to
+ *          finish well within @ref RADIO_NOTIFICATION_DISTANCE.
+ */
+static uint16_t sensor_read(void)
+{
+    int32_t temp = 0;
+
+    (void)sd_temp_get(&temp);
+
+    return (uint16_t)temp;
+}
+
+
+/**@brief Function for handling the radio notification signal.
+ *
+ * @details On ACTIVE, shortly before each advertising event, the sensor is read and, if its value
+ *          changed, written into the buffer the SoftDevice is not using. The SoftDevice switches to
+ *          the new buffer through sd_ble_gap_adv_set_configure, so a packet never carries a
+ *          partially written payload.
+ *
+ * @param[in]   radio_active   True right before the radio event, false once it has ended.
+ */
+static void radio_notification_handler(bool radio_active)
+{
+    ret_code_t err_code;
+    uint16_t   value;
+    uint8_t    next;
+    uint8_t  * p_info;
+
+    if (!radio_active)
+    {
+        return;
+    }
+
+    value = sensor_read();
+    if ((m_beacon_info[MIN_VAL_OFFSET_IN_BEACON_INFO]     == MSB_16(value)) &&
+        (m_beacon_info[MIN_VAL_OFFSET_IN_BEACON_INFO + 1] == LSB_16(value)))
+    {
+        return;
+    }
+
+    m_beacon_info[MIN_VAL_OFFSET_IN_BEACON_INFO]     = MSB_16(value);
+    m_beacon_info[MIN_VAL_OFFSET_IN_BEACON_INFO + 1] = LSB_16(value);
+
+    next   = m_enc_advdata_idx ^ 1;
+    p_info = &m_enc_advdata[next][m_beacon_info_offset];
+    memcpy(p_info, m_beacon_info, APP_BEACON_INFO_LENGTH);
+
+    m_adv_data.adv_data.p_data = m_enc_advdata[next];
+
+    // The advertising parameters must be NULL when only the data of a running set is updated.
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    m_enc_advdata_idx = next;
+}
+
+
+/**@brief Function for initializing the radio notification, used to refresh the sensor data.
+ */
+static void radio_notification_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = ble_radio_notification_init(RADIO_NOTIFICATION_IRQ_PRIORITY,
+                                           RADIO_NOTIFICATION_DISTANCE,
+                                           radio_notification_handler);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
 /**@brief Function for initializing the Advertising functionality.
  *
  * @details Encodes the required advertising data and passes it to the stack.
@@ -150,6 +267,8 @@ static void advertising_init(void)
 
     ble_advdata_manuf_data_t manuf_specific_data;
 
+    // Zeroed with its padding, as it is part of the CRC keying the retained set.
+    memset(&manuf_specific_data, 0, sizeof(manuf_specific_data));
     manuf_specific_data.company_identifier = APP_COMPANY_IDENTIFIER;
 
 #if defined(USE_UICR_FOR_MAJ_MIN_VALUES)
@@ -193,8 +312,38 @@ static void advertising_init(void)
     m_adv_params.interval        = NON_CONNECTABLE_ADV_INTERVAL;
     m_adv_params.duration        = 0;       // Never time out.
 
-    err_code = ble_advdata_encode(&advdata, m_adv_data.adv_data.p_data, &m_adv_data.adv_data.len);
-    APP_ERROR_CHECK(err_code);
+    // The retained set is only used if it was encoded from the same input, which after a reflash
+    // or a UICR write may have changed without a power cycle. The CRC covers advdata and the
+    // manufacturer specific data it points to; advdata holds pointers to the stack, so a rebuild
+    // that moves them only costs one more encoding.
+    uint16_t input_crc = crc16_compute((uint8_t const *)&advdata, sizeof(advdata), NULL);
+    input_crc = crc16_compute((uint8_t const *)&manuf_specific_data, sizeof(manuf_specific_data), &input_crc);
+    input_crc = crc16_compute(m_beacon_info, APP_BEACON_INFO_LENGTH, &input_crc);
+
+    if (RETAINED_IS_VALID(m_adv_cache, ADV_CACHE_VERSION) && (m_adv_cache.data.input_crc == input_crc))
+    {
+        memcpy(m_adv_data.adv_data.p_data, m_adv_cache.data.enc_advdata, m_adv_cache.data.len);
+        m_adv_data.adv_data.len = m_adv_cache.data.len;
+        NRF_LOG_INFO("Advertising set restored from retained RAM.");
+    }
+    else
+    {
+        err_code = ble_advdata_encode(&advdata, m_adv_data.adv_data.p_data, &m_adv_data.adv_data.len);
+        APP_ERROR_CHECK(err_code);
+
+        m_adv_cache.data.input_crc = input_crc;
+        memcpy(m_adv_cache.data.enc_advdata, m_adv_data.adv_data.p_data, m_adv_data.adv_data.len);
+        m_adv_cache.data.len = m_adv_data.adv_data.len;
+        RETAINED_STORE(m_adv_cache, ADV_CACHE_VERSION);
+    }
+
+#if defined(USE_RADIO_NOTIFICATION_FOR_SENSOR_DATA)
+    // The manufacturer specific data is the last field encoded, and both buffers only ever
+    // differ in the part of it taken from m_beacon_info.
+    m_beacon_info_offset = m_adv_data.adv_data.len - APP_BEACON_INFO_LENGTH;
+    memcpy(m_enc_advdata[1], m_enc_advdata[0], m_adv_data.adv_data.len);
+    m_enc_advdata_idx = 0;
+#endif
 
     err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data, &m_adv_params);
     APP_ERROR_CHECK(err_code);
@@ -235,6 +384,9 @@ static void ble_stack_init(void)
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
+
+    // Lowest RAM start for this SoftDevice configuration; read by tools/nrf_ram_layout.
+    NRF_LOG_INFO("Application RAM can start at 0x%x.", ram_start);
 }
 
 
@@ -263,6 +415,82 @@ static void timers_init(void)
 }
 
 
+#if defined(RTOS_BENCH)
+APP_TIMER_DEF(m_bench_timer);                                              /**< Raises the latency test stimulus every BENCH_GAP_MS. */
+static volatile bool m_bench_woken;                                        /**< Set by the stimulus interrupt, cleared by the main loop. */
+
+
+/**@brief Function for handling the latency test stimulus (GPIOTE interrupt). */
+static void bench_pin_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    bench_isr();
+    m_bench_woken = true;
+}
+
+
+static void bench_timer_handler(void * p_context)
+{
+    bench_stimulus();
+}
+
+
+/**@brief Function for starting the latency test of tools/rtos_bench.
+ *
+ * @details Bare metal has no threads: the main loop, woken from sd_app_evt_wait() by the
+ *          stimulus interrupt, stands in for the thread of the RTOS ports.
+ */
+static void bench_start(void)
+{
+    ret_code_t err_code;
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(true);
+    config.pull = NRF_GPIO_PIN_PULLDOWN;
+
+    err_code = nrf_drv_gpiote_in_init(BENCH_STIM_IN_PIN, &config, bench_pin_handler);
+    APP_ERROR_CHECK(err_code);
+    nrf_drv_gpiote_in_event_enable(BENCH_STIM_IN_PIN, true);
+
+    err_code = app_timer_create(&m_bench_timer, APP_TIMER_MODE_REPEATED, bench_timer_handler);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_start(m_bench_timer, APP_TIMER_TICKS(BENCH_GAP_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for timing a stimulus wakeup, and ending the test after the last one. */
+static void bench_poll(void)
+{
+    ret_code_t err_code;
+
+    if (!m_bench_woken)
+    {
+        return;
+    }
+    m_bench_woken = false;
+
+    if (bench_thread())
+    {
+        err_code = app_timer_stop(m_bench_timer);
+        APP_ERROR_CHECK(err_code);
+        nrf_drv_gpiote_in_event_disable(BENCH_STIM_IN_PIN);
+
+        bench_report();
+
+        // Idle phase: nothing left running.
+        err_code = sd_ble_gap_adv_stop(m_adv_handle);
+        APP_ERROR_CHECK(err_code);
+        bsp_board_leds_off();
+    }
+}
+#endif
+
+
 /**@brief Function for initializing power management.
  */
 static void power_management_init(void)
@@ -291,21 +519,36 @@ static void idle_state_handle(void)
  */
 int main(void)
 {
+#if defined(RTOS_BENCH)
+    bench_main_entry();
+#endif
+
     // Initialize.
+    retained_init();
     log_init();
     timers_init();
     leds_init();
     power_management_init();
     ble_stack_init();
     advertising_init();
+#if defined(USE_RADIO_NOTIFICATION_FOR_SENSOR_DATA)
+    radio_notification_init();
+#endif
 
     // Start execution.
     NRF_LOG_INFO("Beacon example started.");
     advertising_start();
+#if defined(RTOS_BENCH)
+    bench_adv_started();
+    bench_start();
+#endif
 
     // Enter main loop.
     for (;; )
     {
+#if defined(RTOS_BENCH)
+        bench_poll();
+#endif
         idle_state_handle();
     }
 }
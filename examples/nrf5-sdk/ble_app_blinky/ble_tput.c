@@ -0,0 +1,603 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include <string.h>
+#include "ble_tput.h"
+#include "ble_srv_common.h"
+#include "ble_conn_params.h"
+#include "nrf_sdh_ble.h"
+#include "app_timer.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+
+#define PAYLOAD_MAX         (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)     /**< Largest notification or write on the data characteristic. */
+#define CONTROL_MAX         8                                       /**< Largest command or reply on the control point. */
+#define SUP_TIMEOUT_MIN     MSEC_TO_UNITS(4000, UNIT_10_MS)         /**< Shortest supervision timeout requested with LINK. */
+
+static uint16_t                 m_service_handle = BLE_GATT_HANDLE_INVALID; /**< Service handle. Invalid until @ref ble_tput_init. */
+static ble_gatts_char_handles_t m_control_handles;                          /**< Control point handles. */
+static ble_gatts_char_handles_t m_data_handles;                             /**< Data characteristic handles. */
+static ble_gatts_char_handles_t m_stats_handles;                            /**< Statistics characteristic handles. */
+static uint16_t                 m_conn_handle = BLE_CONN_HANDLE_INVALID;    /**< Handle of the current connection. */
+
+static ble_tput_stats_t m_stats;                                    /**< Statistics of the current run and link parameters. */
+static uint32_t         m_rx_first;                                 /**< Tick of the first write of the run. */
+static uint32_t         m_rx_last;                                  /**< Tick of the last write of the run. */
+static uint32_t         m_tx_first;                                 /**< Tick of the first notification of the run. */
+
+static bool     m_tx_active;                                        /**< A notification run has been started and not fully acknowledged. */
+static uint32_t m_tx_remaining;                                     /**< Bytes of the run still to be queued. */
+static uint16_t m_tx_length;                                        /**< Length of the notifications of the run. */
+static uint32_t m_tx_seq;                                           /**< Sequence number of the next notification. */
+static uint8_t  m_in_flight;                                        /**< Notifications queued with the SoftDevice, replies included. */
+
+static uint8_t  m_payload[PAYLOAD_MAX];                             /**< Notification payload; the sequence number is written over the first 4 bytes. */
+static uint8_t  m_reply[CONTROL_MAX];                               /**< Control point reply waiting for a free notification buffer. */
+static uint16_t m_reply_len;                                        /**< Length of m_reply. 0 if no reply is waiting. */
+
+NRF_SDH_BLE_OBSERVER(m_ble_tput_obs, BLE_TPUT_BLE_OBSERVER_PRIO, ble_tput_on_ble_evt, NULL);
+
+
+/**@brief Function for converting a number of app_timer ticks to microseconds. */
+static uint32_t ticks_to_us(uint32_t ticks)
+{
+    return (uint32_t)(((uint64_t)ticks * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1) * 1000000)
+                      / APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**@brief Function for the time between two app_timer counter values, in microseconds.
+ *
+ * @note The counter is 24 bits wide and wraps after 512 seconds at the default prescaler, which
+ *       bounds the length of a run.
+ */
+static uint32_t elapsed_us(uint32_t from, uint32_t to)
+{
+    return ticks_to_us(app_timer_cnt_diff_compute(to, from));
+}
+
+
+/**@brief Function for sending a notification.
+ *
+ * @return The error code of sd_ble_gatts_hvx.
+ */
+static uint32_t notify(uint16_t value_handle, uint8_t const * p_data, uint16_t len)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    uint32_t               err_code;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = p_data;
+
+    err_code = sd_ble_gatts_hvx(m_conn_handle, &hvx_params);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_in_flight++;
+    }
+    return err_code;
+}
+
+
+/**@brief Function for queueing the waiting reply and as much of the notification run as the
+ *        SoftDevice takes.
+ */
+static void tx_pump(void)
+{
+    uint32_t err_code;
+
+    if (m_reply_len > 0)
+    {
+        err_code = notify(m_control_handles.value_handle, m_reply, m_reply_len);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            return;
+        }
+        // Anything else means the peer is gone, or has not enabled notifications.
+        m_reply_len = 0;
+    }
+
+    while (m_tx_remaining > 0)
+    {
+        uint16_t len = (uint16_t)MIN(m_tx_remaining, m_tx_length);
+
+        // The last notification still carries the whole sequence number.
+        len = MAX(len, sizeof(uint32_t));
+
+        (void)uint32_encode(m_tx_seq, m_payload);
+
+        err_code = notify(m_data_handles.value_handle, m_payload, len);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            return;
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+            NRF_LOG_INFO("Notification run stopped, error 0x%x.", err_code);
+            m_tx_remaining = 0;
+            m_tx_active    = (m_in_flight > 0);
+            return;
+        }
+
+        if (m_tx_seq == 0)
+        {
+            m_tx_first = app_timer_cnt_get();
+        }
+        m_tx_seq++;
+        m_tx_remaining    -= MIN(m_tx_remaining, len);
+        m_stats.tx_bytes  += len;
+        m_stats.tx_packets++;
+    }
+}
+
+
+/**@brief Function for replying on the control point.
+ *
+ * @param[in] op      Opcode of the command.
+ * @param[in] status  Status of the command.
+ * @param[in] p_data  Reply parameters, or NULL.
+ * @param[in] len     Length of the reply parameters.
+ */
+static void reply(uint8_t op, ble_tput_status_t status, uint8_t const * p_data, uint16_t len)
+{
+    m_reply[0] = op | BLE_TPUT_OP_REPLY;
+    m_reply[1] = status;
+    if (len > 0)
+    {
+        memcpy(&m_reply[2], p_data, len);
+    }
+    m_reply_len = 2 + len;
+
+    tx_pump();
+}
+
+
+/**@brief Function for clearing the statistics of a run, keeping the link parameters. */
+static void run_reset(void)
+{
+    m_stats.rx_bytes      = 0;
+    m_stats.rx_packets    = 0;
+    m_stats.rx_elapsed_us = 0;
+    m_stats.rx_events     = 0;
+    m_stats.tx_bytes      = 0;
+    m_stats.tx_packets    = 0;
+    m_stats.tx_elapsed_us = 0;
+    m_stats.tx_events     = 0;
+
+    m_tx_remaining = 0;
+    m_tx_seq       = 0;
+    m_tx_active    = false;
+}
+
+
+/**@brief Function for starting a notification run. */
+static ble_tput_status_t notify_start(uint8_t const * p_params, uint16_t len)
+{
+    uint32_t bytes;
+    uint16_t length;
+
+    if (len != 6)
+    {
+        return BLE_TPUT_STATUS_INVALID;
+    }
+    bytes  = uint32_decode(&p_params[0]);
+    length = uint16_decode(&p_params[4]);
+
+    if ((bytes == 0) || (length < sizeof(uint32_t)) || (length > m_stats.att_mtu - 3))
+    {
+        return BLE_TPUT_STATUS_INVALID;
+    }
+    if (m_tx_active)
+    {
+        return BLE_TPUT_STATUS_BUSY;
+    }
+
+    m_stats.tx_bytes      = 0;
+    m_stats.tx_packets    = 0;
+    m_stats.tx_elapsed_us = 0;
+    m_stats.tx_events     = 0;
+
+    m_tx_remaining = bytes;
+    m_tx_length    = length;
+    m_tx_seq       = 0;
+    m_tx_active    = true;
+
+    NRF_LOG_INFO("Notifying %u bytes in %u-byte notifications.", bytes, length);
+    return BLE_TPUT_STATUS_SUCCESS;
+}
+
+
+/**@brief Function for requesting a PHY and connection parameters. */
+static ble_tput_status_t link_request(uint8_t const * p_params, uint16_t len)
+{
+    ble_gap_conn_params_t conn_params;
+    ble_gap_phys_t        phys;
+    uint32_t              err_code;
+    uint32_t              sup_timeout;
+
+    if (len != 5)
+    {
+        return BLE_TPUT_STATUS_INVALID;
+    }
+
+    phys.tx_phys = p_params[0];
+    phys.rx_phys = p_params[0];
+
+    conn_params.min_conn_interval = uint16_decode(&p_params[1]);
+    conn_params.max_conn_interval = conn_params.min_conn_interval;
+    conn_params.slave_latency     = uint16_decode(&p_params[3]);
+
+    // The timeout must exceed twice the time between two events the slave listens to.
+    sup_timeout = ((1 + conn_params.slave_latency) * conn_params.max_conn_interval * 250 + 999)
+                  / 1000 + 1;
+    conn_params.conn_sup_timeout = (uint16_t)MAX(sup_timeout, SUP_TIMEOUT_MIN);
+
+    if (((phys.tx_phys != BLE_GAP_PHY_1MBPS) && (phys.tx_phys != BLE_GAP_PHY_2MBPS)) ||
+        (conn_params.min_conn_interval < BLE_GAP_CP_MIN_CONN_INTVL_MIN)                 ||
+        (conn_params.max_conn_interval > BLE_GAP_CP_MAX_CONN_INTVL_MAX)                 ||
+        (conn_params.slave_latency     > BLE_GAP_CP_SLAVE_LATENCY_MAX)                  ||
+        (conn_params.conn_sup_timeout  > BLE_GAP_CP_CONN_SUP_TIMEOUT_MAX))
+    {
+        return BLE_TPUT_STATUS_INVALID;
+    }
+
+    err_code = sd_ble_gap_phy_update(m_conn_handle, &phys);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("PHY update failed, error 0x%x.", err_code);
+        return BLE_TPUT_STATUS_FAILED;
+    }
+
+    // Through the Connection Parameters module, so that it does not negotiate them back.
+    err_code = ble_conn_params_change_conn_params(m_conn_handle, &conn_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("Connection parameter update failed, error 0x%x.", err_code);
+        return BLE_TPUT_STATUS_FAILED;
+    }
+
+    return BLE_TPUT_STATUS_SUCCESS;
+}
+
+
+/**@brief Function for handling a command written to the control point. */
+static void on_control_write(uint8_t const * p_data, uint16_t len)
+{
+    ble_tput_status_t status;
+    uint8_t           op;
+
+    if (len == 0)
+    {
+        return;
+    }
+    op = p_data[0];
+
+    // There is room for one reply: a command written before the last one was notified is dropped.
+    if (m_reply_len > 0)
+    {
+        NRF_LOG_INFO("Command 0x%02x dropped, a reply is still waiting.", op);
+        return;
+    }
+
+    switch (op)
+    {
+        case BLE_TPUT_OP_RESET:
+            run_reset();
+            status = BLE_TPUT_STATUS_SUCCESS;
+            break;
+
+        case BLE_TPUT_OP_NOTIFY:
+            status = notify_start(&p_data[1], len - 1);
+            break;
+
+        case BLE_TPUT_OP_ECHO:
+            if (len != 5)
+            {
+                status = BLE_TPUT_STATUS_INVALID;
+                break;
+            }
+            reply(op, BLE_TPUT_STATUS_SUCCESS, &p_data[1], 4);
+            return;
+
+        case BLE_TPUT_OP_LINK:
+            status = link_request(&p_data[1], len - 1);
+            break;
+
+        default:
+            status = BLE_TPUT_STATUS_UNSUPPORTED;
+            break;
+    }
+
+    reply(op, status, NULL, 0);
+}
+
+
+/**@brief Function for counting a write to the data characteristic. */
+static void on_data_write(uint16_t len)
+{
+    uint32_t now = app_timer_cnt_get();
+
+    if (m_stats.rx_packets == 0)
+    {
+        m_rx_first        = now;
+        m_stats.rx_events = 1;
+    }
+    else if (elapsed_us(m_rx_last, now) > (m_stats.interval * 1250UL) / 2)
+    {
+        m_stats.rx_events++;
+    }
+    m_rx_last = now;
+
+    m_stats.rx_packets++;
+    m_stats.rx_bytes     += len;
+    m_stats.rx_elapsed_us = elapsed_us(m_rx_first, m_rx_last);
+}
+
+
+/**@brief Function for handling the acknowledgement of queued notifications. */
+static void on_hvn_tx_complete(uint8_t count)
+{
+    m_in_flight -= MIN(count, m_in_flight);
+
+    if (m_tx_active)
+    {
+        m_stats.tx_events++;
+        m_stats.tx_elapsed_us = elapsed_us(m_tx_first, app_timer_cnt_get());
+
+        if ((m_tx_remaining == 0) && (m_in_flight == 0))
+        {
+            m_tx_active = false;
+            NRF_LOG_INFO("Notified %u bytes in %u us, %u connection events.",
+                         m_stats.tx_bytes, m_stats.tx_elapsed_us, m_stats.tx_events);
+        }
+    }
+
+    tx_pump();
+}
+
+
+/**@brief Function for answering a read of the statistics with the current values. */
+static void on_stats_read(ble_gatts_evt_read_t const * p_read)
+{
+    static uint8_t                        encoded[BLE_TPUT_STATS_LEN];
+    ble_gatts_rw_authorize_reply_params_t reply_params;
+    uint32_t                              err_code;
+
+    // A long read comes back with a non-zero offset; keep the values of its first part.
+    if (p_read->offset == 0)
+    {
+        uint8_t * p = encoded;
+
+        p += uint32_encode(m_stats.rx_bytes,      p);
+        p += uint32_encode(m_stats.rx_packets,    p);
+        p += uint32_encode(m_stats.rx_elapsed_us, p);
+        p += uint32_encode(m_stats.rx_events,     p);
+        p += uint32_encode(m_stats.tx_bytes,      p);
+        p += uint32_encode(m_stats.tx_packets,    p);
+        p += uint32_encode(m_stats.tx_elapsed_us, p);
+        p += uint32_encode(m_stats.tx_events,     p);
+        p += uint16_encode(m_stats.interval,      p);
+        p += uint16_encode(m_stats.slave_latency, p);
+        p += uint16_encode(m_stats.att_mtu,       p);
+        p += uint16_encode(m_stats.data_length,   p);
+        *p++ = m_stats.tx_phy;
+        *p++ = m_stats.rx_phy;
+    }
+
+    memset(&reply_params, 0, sizeof(reply_params));
+    reply_params.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    reply_params.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    reply_params.params.read.update      = 1;
+    reply_params.params.read.offset      = 0;
+    reply_params.params.read.len         = sizeof(encoded);
+    reply_params.params.read.p_data      = encoded;
+
+    err_code = sd_ble_gatts_rw_authorize_reply(m_conn_handle, &reply_params);
+    if (err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for tracking the effective ATT MTU after an exchange. */
+static void on_mtu_exchange(uint16_t peer_mtu)
+{
+    m_stats.att_mtu = MAX(MIN(peer_mtu, NRF_SDH_BLE_GATT_MAX_MTU_SIZE), BLE_GATT_ATT_MTU_DEFAULT);
+}
+
+
+/**@brief Function for adding a characteristic to the service. */
+static ret_code_t char_add(uint16_t uuid, uint8_t uuid_type, ble_add_char_params_t * p_params,
+                           ble_gatts_char_handles_t * p_handles)
+{
+    p_params->uuid              = uuid;
+    p_params->uuid_type         = uuid_type;
+    p_params->read_access       = SEC_OPEN;
+    p_params->write_access      = SEC_OPEN;
+    p_params->cccd_write_access = SEC_OPEN;
+
+    return characteristic_add(m_service_handle, p_params, p_handles);
+}
+
+
+ret_code_t ble_tput_init(void)
+{
+    ble_uuid128_t         base_uuid = {BLE_TPUT_UUID_BASE};
+    ble_uuid_t            ble_uuid;
+    ble_add_char_params_t add_char_params;
+    ret_code_t            err_code;
+
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &ble_uuid.type);
+    VERIFY_SUCCESS(err_code);
+
+    ble_uuid.uuid = BLE_TPUT_UUID_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &m_service_handle);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.max_len                  = CONTROL_MAX;
+    add_char_params.is_var_len               = true;
+    add_char_params.char_props.write         = 1;
+    add_char_params.char_props.write_wo_resp = 1;
+    add_char_params.char_props.notify        = 1;
+
+    err_code = char_add(BLE_TPUT_UUID_CONTROL_CHAR, ble_uuid.type, &add_char_params,
+                        &m_control_handles);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.max_len                  = PAYLOAD_MAX;
+    add_char_params.is_var_len               = true;
+    add_char_params.char_props.write_wo_resp = 1;
+    add_char_params.char_props.notify        = 1;
+
+    err_code = char_add(BLE_TPUT_UUID_DATA_CHAR, ble_uuid.type, &add_char_params,
+                        &m_data_handles);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.max_len         = BLE_TPUT_STATS_LEN;
+    add_char_params.init_len        = BLE_TPUT_STATS_LEN;
+    add_char_params.char_props.read = 1;
+    add_char_params.is_defered_read = true;
+
+    err_code = char_add(BLE_TPUT_UUID_STATS_CHAR, ble_uuid.type, &add_char_params,
+                        &m_stats_handles);
+    VERIFY_SUCCESS(err_code);
+
+    for (uint32_t i = 0; i < sizeof(m_payload); i++)
+    {
+        m_payload[i] = (uint8_t)i;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+void ble_tput_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    if (m_service_handle == BLE_GATT_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            ble_gap_conn_params_t const * p_params =
+                &p_ble_evt->evt.gap_evt.params.connected.conn_params;
+
+            m_conn_handle         = p_ble_evt->evt.gap_evt.conn_handle;
+            m_in_flight           = 0;
+            m_reply_len           = 0;
+            m_stats.interval      = p_params->max_conn_interval;
+            m_stats.slave_latency = p_params->slave_latency;
+            m_stats.att_mtu       = BLE_GATT_ATT_MTU_DEFAULT;
+            m_stats.data_length   = BLE_GAP_DATA_LENGTH_DEFAULT;
+            m_stats.tx_phy        = BLE_GAP_PHY_1MBPS;
+            m_stats.rx_phy        = BLE_GAP_PHY_1MBPS;
+            run_reset();
+        } break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            m_in_flight   = 0;
+            m_reply_len   = 0;
+            run_reset();
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            m_stats.interval      = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval;
+            m_stats.slave_latency = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.slave_latency;
+            NRF_LOG_INFO("Connection interval %u x 1.25 ms.", m_stats.interval);
+            break;
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+            if (p_ble_evt->evt.gap_evt.params.phy_update.status == BLE_HCI_STATUS_CODE_SUCCESS)
+            {
+                m_stats.tx_phy = p_ble_evt->evt.gap_evt.params.phy_update.tx_phy;
+                m_stats.rx_phy = p_ble_evt->evt.gap_evt.params.phy_update.rx_phy;
+                NRF_LOG_INFO("PHY tx %u rx %u.", m_stats.tx_phy, m_stats.rx_phy);
+            }
+            break;
+
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE:
+            m_stats.data_length =
+                p_ble_evt->evt.gap_evt.params.data_length_update.effective_params.max_tx_octets;
+            break;
+
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+            on_mtu_exchange(p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu);
+            break;
+
+        case BLE_GATTC_EVT_EXCHANGE_MTU_RSP:
+            on_mtu_exchange(p_ble_evt->evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu);
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+        {
+            ble_gatts_evt_write_t const * p_write = &p_ble_evt->evt.gatts_evt.params.write;
+
+            if (p_write->handle == m_control_handles.value_handle)
+            {
+                on_control_write(p_write->data, p_write->len);
+            }
+            else if (p_write->handle == m_data_handles.value_handle)
+            {
+                on_data_write(p_write->len);
+            }
+        } break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        {
+            ble_gatts_evt_rw_authorize_request_t const * p_auth =
+                &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+            if ((p_auth->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+                (p_auth->request.read.handle == m_stats_handles.value_handle))
+            {
+                on_stats_read(&p_auth->request.read);
+            }
+        } break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            on_hvn_tx_complete(p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,156 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup ble_tput Throughput benchmark service
+ * @{
+ * @brief GATT service driven by tools/ble_bench to measure goodput, round-trip latency and
+ *        packets per connection event.
+ *
+ * @details The service has three characteristics under the base UUID
+ *          7a2f0000-a1c4-4e5b-9f0d-3c6b8e1d2a47:
+ *
+ *          - 0x0002 control point: write, write without response and notify. Each command is an
+ *            opcode byte and its parameters, little endian; the reply is notified on the same
+ *            characteristic as the opcode with bit 7 set and a status byte. A command written
+ *            while the reply to the previous one is still waiting to be notified is dropped.
+ *          - 0x0003 data: notify, and write without response as a sink.
+ *          - 0x0004 statistics: read, @ref ble_tput_stats_t of the current run, encoded in field
+ *            order, little endian and unpadded (@ref BLE_TPUT_STATS_LEN bytes).
+ *
+ *          Commands:
+ *          - RESET: clear the statistics and stop a notification run.
+ *          - NOTIFY {u32 bytes, u16 length}: notify @p bytes on the data characteristic, in
+ *            notifications of @p length bytes starting with a u32 sequence number. A last
+ *            notification of fewer than 4 bytes is padded to 4.
+ *          - ECHO {u32 token}: notify the token back, for round-trip time.
+ *          - LINK {u8 phy, u16 interval, u16 slave latency}: request a PHY (BLE_GAP_PHY_*) and
+ *            a connection interval (in units of 1.25 ms). A central stack such as BlueZ does
+ *            not let the host choose either, so the peripheral asks for them; the statistics
+ *            show what was granted.
+ *
+ *          The SoftDevice reports one BLE_GATTS_EVT_HVN_TX_COMPLETE per connection event in
+ *          which notifications were acknowledged, so the transmit side counts connection events
+ *          exactly. The SoftDevice does not report connection events for received writes;
+ *          writes closer than half a connection interval to the previous one are counted in
+ *          the same event.
+ *
+ * @note    Build with `make TPUT=1` for a 247-byte ATT MTU, 251-byte data length and long
+ *          connection events; the default sdk_config.h keeps one 27-byte packet per event.
+ */
+#ifndef BLE_TPUT_H__
+#define BLE_TPUT_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLE_TPUT_BLE_OBSERVER_PRIO
+#define BLE_TPUT_BLE_OBSERVER_PRIO      2       /**< Priority of the module's BLE event observer. */
+#endif
+
+#define BLE_TPUT_HVN_TX_QUEUE_SIZE      8       /**< Notifications queued in the SoftDevice, given to sd_ble_cfg_set by the application. */
+
+#define BLE_TPUT_UUID_BASE              {0x47, 0x2A, 0x1D, 0x8E, 0x6B, 0x3C, 0x0D, 0x9F, \
+                                         0x5B, 0x4E, 0xC4, 0xA1, 0x00, 0x00, 0x2F, 0x7A}
+#define BLE_TPUT_UUID_SERVICE           0x0001  /**< Service UUID. */
+#define BLE_TPUT_UUID_CONTROL_CHAR      0x0002  /**< Control point characteristic UUID. */
+#define BLE_TPUT_UUID_DATA_CHAR         0x0003  /**< Data characteristic UUID. */
+#define BLE_TPUT_UUID_STATS_CHAR        0x0004  /**< Statistics characteristic UUID. */
+
+/**@brief Control point opcodes. Replies carry the opcode with @ref BLE_TPUT_OP_REPLY set. */
+typedef enum
+{
+    BLE_TPUT_OP_RESET  = 0x01,
+    BLE_TPUT_OP_NOTIFY = 0x02,
+    BLE_TPUT_OP_ECHO   = 0x03,
+    BLE_TPUT_OP_LINK   = 0x04,
+    BLE_TPUT_OP_REPLY  = 0x80,
+} ble_tput_op_t;
+
+/**@brief Control point reply status. */
+typedef enum
+{
+    BLE_TPUT_STATUS_SUCCESS     = 0x00,
+    BLE_TPUT_STATUS_UNSUPPORTED = 0x01, /**< Unknown opcode. */
+    BLE_TPUT_STATUS_INVALID     = 0x02, /**< Wrong parameter length or value. */
+    BLE_TPUT_STATUS_BUSY        = 0x03, /**< A notification run is in progress. */
+    BLE_TPUT_STATUS_FAILED      = 0x04, /**< The SoftDevice refused the request. */
+} ble_tput_status_t;
+
+/**@brief Statistics of a run. */
+typedef struct
+{
+    uint32_t rx_bytes;                  /**< Bytes written to the data characteristic. */
+    uint32_t rx_packets;                /**< Writes to the data characteristic. */
+    uint32_t rx_elapsed_us;             /**< Time from the first write to the last. */
+    uint32_t rx_events;                 /**< Connection events with writes, estimated. */
+    uint32_t tx_bytes;                  /**< Bytes notified and acknowledged. */
+    uint32_t tx_packets;                /**< Notifications acknowledged. */
+    uint32_t tx_elapsed_us;             /**< Time from the first notification queued to the last acknowledged. */
+    uint32_t tx_events;                 /**< Connection events with acknowledged notifications. */
+    uint16_t interval;                  /**< Connection interval, in units of 1.25 ms. */
+    uint16_t slave_latency;             /**< Slave latency, in connection events. */
+    uint16_t att_mtu;                   /**< Effective ATT MTU. */
+    uint16_t data_length;               /**< Link layer payload length for transmission, in octets. */
+    uint8_t  tx_phy;                    /**< Transmit PHY, BLE_GAP_PHY_*. */
+    uint8_t  rx_phy;                    /**< Receive PHY, BLE_GAP_PHY_*. */
+} ble_tput_stats_t;
+
+#define BLE_TPUT_STATS_LEN              42      /**< Length of the encoded statistics. */
+
+
+/**@brief Function for adding the service.
+ *
+ * @retval NRF_SUCCESS  Service was added.
+ * @return Other error codes returned by the SoftDevice.
+ */
+ret_code_t ble_tput_init(void);
+
+
+/**@brief Function for handling BLE events. Registered by the module itself.
+ *
+ * @param[in] p_ble_evt  BLE event.
+ * @param[in] p_context  Unused.
+ */
+void ble_tput_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_TPUT_H__
+
+/** @} */
@@ -2424,7 +2424,7 @@
 // <e> NRFX_PPI_ENABLED - nrfx_ppi - PPI peripheral allocator
 //==========================================================
 #ifndef NRFX_PPI_ENABLED
-#define NRFX_PPI_ENABLED 0
+#define NRFX_PPI_ENABLED 1
 #endif
 // <e> NRFX_PPI_CONFIG_LOG_ENABLED - Enables logging in the module.
 //==========================================================
@@ -3677,7 +3677,7 @@
 // <e> NRFX_TIMER_ENABLED - nrfx_timer - TIMER periperal driver
 //==========================================================
 #ifndef NRFX_TIMER_ENABLED
-#define NRFX_TIMER_ENABLED 0
+#define NRFX_TIMER_ENABLED 1
 #endif
 // <q> NRFX_TIMER0_ENABLED  - Enable TIMER0 instance
  
@@ -3697,7 +3697,7 @@
  
 
 #ifndef NRFX_TIMER2_ENABLED
-#define NRFX_TIMER2_ENABLED 0
+#define NRFX_TIMER2_ENABLED 1
 #endif
 
 // <q> NRFX_TIMER3_ENABLED  - Enable TIMER3 instance
@@ -4642,7 +4642,7 @@
  
 
 #ifndef PPI_ENABLED
-#define PPI_ENABLED 0
+#define PPI_ENABLED 1
 #endif
 
 // <e> PWM_ENABLED - nrf_drv_pwm - PWM peripheral driver - legacy layer
@@ -5372,7 +5372,7 @@
 // <e> TIMER_ENABLED - nrf_drv_timer - TIMER periperal driver - legacy layer
 //==========================================================
 #ifndef TIMER_ENABLED
-#define TIMER_ENABLED 0
+#define TIMER_ENABLED 1
 #endif
 // <o> TIMER_DEFAULT_CONFIG_FREQUENCY  - Timer frequency if in Timer mode
  
@@ -5446,7 +5446,7 @@
  
 
 #ifndef TIMER2_ENABLED
-#define TIMER2_ENABLED 0
+#define TIMER2_ENABLED 1
 #endif
 
 // <q> TIMER3_ENABLED  - Enable TIMER3 instance
@@ -7327,6 +7327,38 @@
 // <h> nRF_Log 
 
 //==========================================================
+// <e> NRF_LOG_BACKEND_BIN_ENABLED - nrf_log_backend_bin - Binary log backend, decoded on the host
+//==========================================================
+#ifndef NRF_LOG_BACKEND_BIN_ENABLED
+#define NRF_LOG_BACKEND_BIN_ENABLED 0
+#endif
+// <q> NRF_LOG_BACKEND_BIN_USE_UART  - Send frames over UART instead of RTT
+ 
+
+// <i> The UART pin and baud rate are taken from the UART backend settings.
+// <i> The UART backend must be disabled when this option is set.
+
+#ifndef NRF_LOG_BACKEND_BIN_USE_UART
+#define NRF_LOG_BACKEND_BIN_USE_UART 0
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_RTT_CHANNEL - RTT up channel used for binary frames 
+#ifndef NRF_LOG_BACKEND_BIN_RTT_CHANNEL
+#define NRF_LOG_BACKEND_BIN_RTT_CHANNEL 1
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE - Size of the RTT up buffer for binary frames 
+#ifndef NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE
+#define NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE 512
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_HEXDUMP_MAX - Longest hexdump sent, in bytes 
+#ifndef NRF_LOG_BACKEND_BIN_HEXDUMP_MAX
+#define NRF_LOG_BACKEND_BIN_HEXDUMP_MAX 64
+#endif
+
+// </e>
+
 // <e> NRF_LOG_BACKEND_RTT_ENABLED - nrf_log_backend_rtt - Log RTT backend
 //==========================================================
 #ifndef NRF_LOG_BACKEND_RTT_ENABLED
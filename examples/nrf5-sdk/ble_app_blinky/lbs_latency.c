@@ -0,0 +1,298 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include <string.h>
+#include "lbs_latency.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_drv_timer.h"
+#include "nrf_gpio.h"
+#include "nrf_sdh_ble.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+
+
+/**@brief Latency samples of one connection parameter set. */
+typedef struct
+{
+    uint16_t interval;                          /**< Connection interval, in units of 1.25 ms. 0 if the set is unused. */
+    uint16_t slave_latency;                     /**< Slave latency, in connection events. */
+    uint32_t count;                             /**< Samples taken, including those overwritten. */
+    uint32_t samples[LBS_LATENCY_SAMPLES];      /**< Last samples, in microseconds. */
+} latency_set_t;
+
+static const nrf_drv_timer_t m_timer = NRF_DRV_TIMER_INSTANCE(1);   /**< Free-running 1 MHz timestamp timer. */
+
+static lbs_latency_button_handler_t m_handler;                      /**< Application button handler. */
+static uint32_t                     m_pin;                          /**< Button pin. */
+static bool                         m_pressed;                      /**< Last accepted button state. */
+static uint32_t                     m_last_edge;                    /**< Timestamp of the last accepted edge. */
+
+static uint32_t      m_pending[LBS_LATENCY_PENDING];                /**< Edge timestamps of the notifications in flight, oldest first. */
+static uint8_t       m_pending_head;                                /**< Index of the oldest notification in flight. */
+static uint8_t       m_pending_count;                               /**< Number of notifications in flight. */
+static uint32_t      m_dropped;                                     /**< Notifications not timed because m_pending was full or no set was free. */
+
+static latency_set_t   m_sets[LBS_LATENCY_SETS];                    /**< Samples per connection parameter set. */
+static latency_set_t * m_p_set;                                     /**< Set of the current connection parameters. NULL if none. */
+
+NRF_SDH_BLE_OBSERVER(m_lbs_latency_obs, LBS_LATENCY_BLE_OBSERVER_PRIO, lbs_latency_on_ble_evt, NULL);
+
+
+/**@brief Function for selecting the sample set of a connection parameter set, claiming a free
+ *        one the first time the parameters are seen.
+ */
+static void set_select(ble_gap_conn_params_t const * p_params)
+{
+    m_p_set = NULL;
+
+    for (uint32_t i = 0; i < LBS_LATENCY_SETS; i++)
+    {
+        latency_set_t * p_set = &m_sets[i];
+
+        if (p_set->interval == 0)
+        {
+            p_set->interval      = p_params->max_conn_interval;
+            p_set->slave_latency = p_params->slave_latency;
+        }
+        if ((p_set->interval      == p_params->max_conn_interval) &&
+            (p_set->slave_latency == p_params->slave_latency))
+        {
+            m_p_set = p_set;
+            return;
+        }
+    }
+}
+
+
+/**@brief Function for recording the latency of the oldest notifications in flight.
+ *
+ * @param[in] now    Timestamp of the transmission complete event.
+ * @param[in] count  Number of notifications completed.
+ */
+static void pending_complete(uint32_t now, uint8_t count)
+{
+    while ((count-- > 0) && (m_pending_count > 0))
+    {
+        uint32_t latency = now - m_pending[m_pending_head];
+
+        m_pending_head = (m_pending_head + 1) % LBS_LATENCY_PENDING;
+        m_pending_count--;
+
+        if (m_p_set == NULL)
+        {
+            m_dropped++;
+            continue;
+        }
+
+        m_p_set->samples[m_p_set->count % LBS_LATENCY_SAMPLES] = latency;
+        m_p_set->count++;
+        NRF_LOG_DEBUG("Press-to-air %u us", latency);
+    }
+}
+
+
+/**@brief Function for handling the GPIOTE event of the button pin.
+ *
+ * @details The edge time was latched into CC[0] by PPI when the event fired. Edges within
+ *          @ref LBS_LATENCY_LOCKOUT_US of the last accepted one, and edges that leave the
+ *          state unchanged, are taken as bounces.
+ */
+static void gpiote_evt_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    uint32_t edge    = nrf_drv_timer_capture_get(&m_timer, NRF_TIMER_CC_CHANNEL0);
+    bool     pressed = (nrf_gpio_pin_read(m_pin) == 0);
+
+    if ((pressed == m_pressed) || ((edge - m_last_edge) < LBS_LATENCY_LOCKOUT_US))
+    {
+        return;
+    }
+    m_pressed   = pressed;
+    m_last_edge = edge;
+
+    if (!m_handler(pressed))
+    {
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if (m_pending_count < LBS_LATENCY_PENDING)
+    {
+        m_pending[(m_pending_head + m_pending_count) % LBS_LATENCY_PENDING] = edge;
+        m_pending_count++;
+    }
+    else
+    {
+        m_dropped++;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Timer event handler. The timer runs without interrupts. */
+static void timer_evt_handler(nrf_timer_event_t event_type, void * p_context)
+{
+}
+
+
+ret_code_t lbs_latency_init(uint32_t pin, lbs_latency_button_handler_t handler)
+{
+    ret_code_t         err_code;
+    nrf_ppi_channel_t  ppi_channel;
+
+    VERIFY_PARAM_NOT_NULL(handler);
+
+    m_handler = handler;
+    m_pin     = pin;
+    m_pressed = false;
+
+    nrf_drv_timer_config_t timer_config = NRF_DRV_TIMER_DEFAULT_CONFIG;
+    timer_config.frequency = NRF_TIMER_FREQ_1MHz;
+    timer_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    timer_config.mode      = NRF_TIMER_MODE_TIMER;
+
+    err_code = nrf_drv_timer_init(&m_timer, &timer_config, timer_evt_handler);
+    VERIFY_SUCCESS(err_code);
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        VERIFY_SUCCESS(err_code);
+    }
+
+    nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_TOGGLE(true);
+    in_config.pull = NRF_GPIO_PIN_PULLUP;
+
+    err_code = nrf_drv_gpiote_in_init(pin, &in_config, gpiote_evt_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_drv_ppi_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED))
+    {
+        return err_code;
+    }
+
+    err_code = nrf_drv_ppi_channel_alloc(&ppi_channel);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_drv_ppi_channel_assign(ppi_channel,
+                                          nrf_drv_gpiote_in_event_addr_get(pin),
+                                          nrf_drv_timer_capture_task_address_get(&m_timer,
+                                                                                 NRF_TIMER_CC_CHANNEL0));
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_drv_ppi_channel_enable(ppi_channel);
+    VERIFY_SUCCESS(err_code);
+
+    nrf_drv_timer_enable(&m_timer);
+
+    // Start the lockout from now so that the first edge is always accepted.
+    m_last_edge = nrf_drv_timer_capture(&m_timer, NRF_TIMER_CC_CHANNEL0) - LBS_LATENCY_LOCKOUT_US;
+
+    nrf_drv_gpiote_in_event_enable(pin, true);
+
+    return NRF_SUCCESS;
+}
+
+
+void lbs_latency_report(void)
+{
+    static uint32_t sorted[LBS_LATENCY_SAMPLES];
+
+    for (uint32_t i = 0; i < LBS_LATENCY_SETS; i++)
+    {
+        latency_set_t const * p_set = &m_sets[i];
+        uint32_t              n     = MIN(p_set->count, LBS_LATENCY_SAMPLES);
+
+        if (n == 0)
+        {
+            continue;
+        }
+
+        // Insertion sort; the set is small and this runs once per connection.
+        for (uint32_t j = 0; j < n; j++)
+        {
+            uint32_t value = p_set->samples[j];
+            uint32_t k     = j;
+
+            while ((k > 0) && (sorted[k - 1] > value))
+            {
+                sorted[k] = sorted[k - 1];
+                k--;
+            }
+            sorted[k] = value;
+        }
+
+        NRF_LOG_INFO("Interval %u x 1.25 ms, slave latency %u: %u samples (last %u kept)",
+                     p_set->interval, p_set->slave_latency, p_set->count, n);
+        NRF_LOG_INFO("  p50 %u us, p90 %u us, p99 %u us, max %u us",
+                     sorted[(n * 50) / 100], sorted[(n * 90) / 100],
+                     sorted[(n * 99) / 100], sorted[n - 1]);
+    }
+
+    if (m_dropped > 0)
+    {
+        NRF_LOG_INFO("%u notifications not timed", m_dropped);
+    }
+}
+
+
+void lbs_latency_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            set_select(&p_ble_evt->evt.gap_evt.params.connected.conn_params);
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            set_select(&p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params);
+            break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        {
+            uint32_t now = nrf_drv_timer_capture(&m_timer, NRF_TIMER_CC_CHANNEL1);
+
+            CRITICAL_REGION_ENTER();
+            pending_complete(now, p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count);
+            CRITICAL_REGION_EXIT();
+        } break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            CRITICAL_REGION_ENTER();
+            m_dropped      += m_pending_count;
+            m_pending_count = 0;
+            CRITICAL_REGION_EXIT();
+            m_p_set = NULL;
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,120 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup lbs_latency LED Button Service latency benchmark
+ * @{
+ * @brief Measures the time from a button edge to the acknowledgement of its notification.
+ *
+ * @details The button pin is sensed by a GPIOTE IN channel whose event captures a free-running
+ *          1 MHz TIMER through PPI, so the edge is timestamped in hardware whatever the CPU is
+ *          doing. No debouncing delay is applied. When the application has queued the button
+ *          notification, the edge time is kept until the SoftDevice reports the notification as
+ *          sent with BLE_GATTS_EVT_HVN_TX_COMPLETE, which is timestamped from the same TIMER. The
+ *          difference is the press-to-air latency, including the wait for the next connection
+ *          event and the acknowledgement from the peer.
+ *
+ *          Samples are kept per connection parameter set (interval and slave latency), as
+ *          negotiated at connection and on each parameter update, and @ref lbs_latency_report
+ *          logs their percentiles. A peer that timestamps the notifications it receives can be
+ *          lined up against the per-sample log lines to split the figure into the two sides.
+ *
+ * @note    Drive the pin from a clean signal (a second board or a signal generator). With a
+ *          mechanical button the capture can land on a later bounce than the first edge.
+ *          GPIOTE IN channels draw more current than the port event used by app_button, so this
+ *          is a test mode only.
+ */
+#ifndef LBS_LATENCY_H__
+#define LBS_LATENCY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LBS_LATENCY_BLE_OBSERVER_PRIO
+#define LBS_LATENCY_BLE_OBSERVER_PRIO   2       /**< Priority of the module's BLE event observer. */
+#endif
+
+#define LBS_LATENCY_SETS                4       /**< Number of connection parameter sets tracked. */
+#define LBS_LATENCY_SAMPLES             128     /**< Samples kept per set; older ones are overwritten. */
+#define LBS_LATENCY_PENDING             8       /**< Button notifications that can be in flight at once. */
+#define LBS_LATENCY_LOCKOUT_US          5000    /**< Edges closer than this to the previous accepted edge are ignored. */
+
+/**@brief Button handler type.
+ *
+ * @details Called from the GPIOTE interrupt on every accepted edge.
+ *
+ * @param[in] pressed  New button state.
+ *
+ * @return true if a button notification was queued with the SoftDevice.
+ */
+typedef bool (*lbs_latency_button_handler_t)(bool pressed);
+
+
+/**@brief Function for starting the capture of the button pin.
+ *
+ * @details Takes over the pin, a GPIOTE IN channel, a PPI channel and TIMER1. The pin must not be
+ *          configured through app_button.
+ *
+ * @param[in] pin      Button pin, active low with the internal pull-up enabled.
+ * @param[in] handler  Button handler. Can not be NULL.
+ *
+ * @retval NRF_SUCCESS     Capture was started.
+ * @retval NRF_ERROR_NULL  No handler was given.
+ * @return Other error codes returned by the TIMER, PPI or GPIOTE drivers.
+ */
+ret_code_t lbs_latency_init(uint32_t pin, lbs_latency_button_handler_t handler);
+
+
+/**@brief Function for logging the latency percentiles of every connection parameter set.
+ */
+void lbs_latency_report(void);
+
+
+/**@brief Function for handling BLE events. Registered by the module itself.
+ *
+ * @param[in] p_ble_evt  BLE event.
+ * @param[in] p_context  Unused.
+ */
+void lbs_latency_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LBS_LATENCY_H__
+
+/** @} */
@@ -63,10 +63,17 @@
 #include "nrf_ble_gatt.h"
 #include "nrf_ble_qwr.h"
 #include "nrf_pwr_mgmt.h"
+#include "ble_adv_tiers.h"
+#if LATENCY_TEST_ENABLED
+#include "lbs_latency.h"
+#endif
+#include "ble_tput.h"
+#include "button_debounce.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
+#include "nrf_log_backend_bin.h"
 
 
 #define ADVERTISING_LED                 BSP_BOARD_LED_0                         /**< Is on when device is advertising. */
@@ -79,8 +86,13 @@
 #define APP_BLE_OBSERVER_PRIO           3                                       /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG            1                                       /**< A tag identifying the SoftDevice BLE configuration. */
 
-#define APP_ADV_INTERVAL                64                                      /**< The advertising interval (in units of 0.625 ms; this value corresponds to 40 ms). */
-#define APP_ADV_DURATION                BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED   /**< The advertising time-out (in units of seconds). When set to 0, we will never time out. */
+#define APP_ADV_FAST_INTERVAL           64                                      /**< The fast advertising interval (in units of 0.625 ms; this value corresponds to 40 ms). */
+#define APP_ADV_FAST_DURATION           3000                                    /**< The fast advertising duration (30 seconds) in units of 10 milliseconds. */
+#define APP_ADV_SLOW_INTERVAL           800                                     /**< The slow advertising interval (in units of 0.625 ms; this value corresponds to 500 ms). */
+#define APP_ADV_SLOW_DURATION           30000                                   /**< The slow advertising duration (5 minutes) in units of 10 milliseconds. */
+#define APP_ADV_VERY_SLOW_INTERVAL      3200                                    /**< The very slow advertising interval (in units of 0.625 ms; this value corresponds to 2 seconds). */
+#define APP_ADV_VERY_SLOW_DURATION      0                                       /**< Very slow advertising lasts until a central connects. */
+#define APP_ADV_EVENT_CHARGE_NC         8000                                    /**< Estimated charge of one connectable advertising event with scan response at 0 dBm, in nanocoulombs. */
 
 
 #define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)        /**< Minimum acceptable connection interval (0.5 seconds). */
@@ -93,6 +105,14 @@
 #define MAX_CONN_PARAMS_UPDATE_COUNT    3                                       /**< Number of attempts before giving up the connection parameter negotiation. */
 
 #define BUTTON_DETECTION_DELAY          APP_TIMER_TICKS(50)                     /**< Delay from a GPIOTE event until a button is reported as pushed (in number of timer ticks). */
+#define BUTTON_DEBOUNCE_HW_ENABLED      0                                       /**< Set to 1 to debounce the button with GPIOTE, PPI and TIMER2 instead of app_button's app_timer delay. */
+#define BUTTON_DEBOUNCE_DELAY_US        50000                                   /**< Time the button must be stable before a change is reported by the hardware debounce (in microseconds). */
+#ifndef LATENCY_TEST_ENABLED
+#define LATENCY_TEST_ENABLED            0                                       /**< Set to 1 (make LATENCY=1) to time the button with GPIOTE, PPI and TIMER1 instead of app_button, and log press-to-air latency on disconnect. */
+#endif
+#ifndef TPUT_TEST_ENABLED
+#define TPUT_TEST_ENABLED               0                                       /**< Set to 1 (make TPUT=1) to add the throughput service driven by tools/ble_bench. */
+#endif
 
 #define DEAD_BEEF                       0xDEADBEEF                              /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
@@ -100,10 +120,10 @@
 BLE_LBS_DEF(m_lbs);                                                             /**< LED Button Service instance. */
 NRF_BLE_GATT_DEF(m_gatt);                                                       /**< GATT module instance. */
 NRF_BLE_QWR_DEF(m_qwr);                                                         /**< Context for the Queued Write module.*/
+BLE_ADV_TIERS_DEF(m_adv_tiers);                                                 /**< Tiered advertising instance. */
 
 static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID;                        /**< Handle of the current connection. */
 
-static uint8_t m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET;                   /**< Advertising handle used to identify an advertising set. */
 static uint8_t m_enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];                    /**< Buffer for storing an encoded advertising set. */
 static uint8_t m_enc_scan_response_data[BLE_GAP_ADV_SET_DATA_SIZE_MAX];         /**< Buffer for storing an encoded scan data. */
 
@@ -123,6 +143,14 @@ static ble_gap_adv_data_t m_adv_data =
     }
 };
 
+/**@brief Advertising tiers, stepped through while no central connects. */
+static ble_adv_tier_t const m_adv_tier[] =
+{
+    {.interval = APP_ADV_FAST_INTERVAL,      .duration = APP_ADV_FAST_DURATION},
+    {.interval = APP_ADV_SLOW_INTERVAL,      .duration = APP_ADV_SLOW_DURATION},
+    {.interval = APP_ADV_VERY_SLOW_INTERVAL, .duration = APP_ADV_VERY_SLOW_DURATION},
+};
+
 /**@brief Function for assert macro callback.
  *
  * @details This function will be called in case of an assert in the SoftDevice.
@@ -201,16 +229,46 @@ static void gatt_init(void)
 }
 
 
+/**@brief Function for handling tiered advertising events.
+ *
+ * @param[in] p_tiers  Tiered advertising instance.
+ * @param[in] p_evt    Event.
+ */
+static void adv_tiers_evt_handler(ble_adv_tiers_t * p_tiers, ble_adv_tiers_evt_t const * p_evt)
+{
+    if (p_evt->type == BLE_ADV_TIERS_EVT_TIER)
+    {
+        NRF_LOG_INFO("Advertising in tier %d.", p_evt->tier);
+    }
+}
+
+
+/**@brief Function for logging the time and charge spent in each advertising tier.
+ */
+static void adv_tiers_report(void)
+{
+    ble_adv_tiers_stats_t stats;
+
+    for (uint8_t tier = 0; tier < ARRAY_SIZE(m_adv_tier); tier++)
+    {
+        ble_adv_tiers_stats_get(&m_adv_tiers, tier, &stats);
+        NRF_LOG_INFO("Tier %d: %d ms, %d events, %d uC.",
+                     tier, stats.time_ms, stats.events, stats.charge_uc);
+    }
+}
+
+
 /**@brief Function for initializing the Advertising functionality.
  *
- * @details Encodes the required advertising data and passes it to the stack.
- *          Also builds a structure to be passed to the stack when starting advertising.
+ * @details Encodes the required advertising data and hands it to the tiered advertising module,
+ *          which configures the advertising set.
  */
 static void advertising_init(void)
 {
-    ret_code_t    err_code;
-    ble_advdata_t advdata;
-    ble_advdata_t srdata;
+    ret_code_t           err_code;
+    ble_advdata_t        advdata;
+    ble_advdata_t        srdata;
+    ble_adv_tiers_init_t tiers_init;
 
     ble_uuid_t adv_uuids[] = {{LBS_UUID_SERVICE, m_lbs.uuid_type}};
 
@@ -232,19 +290,16 @@ static void advertising_init(void)
     err_code = ble_advdata_encode(&srdata, m_adv_data.scan_rsp_data.p_data, &m_adv_data.scan_rsp_data.len);
     APP_ERROR_CHECK(err_code);
 
-    ble_gap_adv_params_t adv_params;
-
-    // Set advertising parameters.
-    memset(&adv_params, 0, sizeof(adv_params));
+    memset(&tiers_init, 0, sizeof(tiers_init));
 
-    adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
-    adv_params.duration        = APP_ADV_DURATION;
-    adv_params.properties.type = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
-    adv_params.p_peer_addr     = NULL;
-    adv_params.filter_policy   = BLE_GAP_ADV_FP_ANY;
-    adv_params.interval        = APP_ADV_INTERVAL;
+    tiers_init.p_adv_data      = &m_adv_data;
+    tiers_init.p_tier          = m_adv_tier;
+    tiers_init.tier_count      = ARRAY_SIZE(m_adv_tier);
+    tiers_init.conn_cfg_tag    = APP_BLE_CONN_CFG_TAG;
+    tiers_init.event_charge_nc = APP_ADV_EVENT_CHARGE_NC;
+    tiers_init.evt_handler     = adv_tiers_evt_handler;
 
-    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data, &adv_params);
+    err_code = ble_adv_tiers_init(&m_adv_tiers, &tiers_init);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -301,6 +356,11 @@ static void services_init(void)
 
     err_code = ble_lbs_init(&m_lbs, &init);
     APP_ERROR_CHECK(err_code);
+
+#if TPUT_TEST_ENABLED
+    err_code = ble_tput_init();
+    APP_ERROR_CHECK(err_code);
+#endif
 }
 
 
@@ -360,13 +420,13 @@ static void conn_params_init(void)
 }
 
 
-/**@brief Function for starting advertising.
+/**@brief Function for starting advertising, from the fast tier.
  */
 static void advertising_start(void)
 {
     ret_code_t           err_code;
 
-    err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
+    err_code = ble_adv_tiers_start(&m_adv_tiers);
     APP_ERROR_CHECK(err_code);
 
     bsp_board_led_on(ADVERTISING_LED);
@@ -386,21 +446,21 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
     {
         case BLE_GAP_EVT_CONNECTED:
             NRF_LOG_INFO("Connected");
+            adv_tiers_report();
             bsp_board_led_on(CONNECTED_LED);
             bsp_board_led_off(ADVERTISING_LED);
             m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
             err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
             APP_ERROR_CHECK(err_code);
-            err_code = app_button_enable();
-            APP_ERROR_CHECK(err_code);
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
             NRF_LOG_INFO("Disconnected");
             bsp_board_led_off(CONNECTED_LED);
             m_conn_handle = BLE_CONN_HANDLE_INVALID;
-            err_code = app_button_disable();
-            APP_ERROR_CHECK(err_code);
+#if LATENCY_TEST_ENABLED
+            lbs_latency_report();
+#endif
             advertising_start();
             break;
 
@@ -471,15 +531,64 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     APP_ERROR_CHECK(err_code);
 
+#if TPUT_TEST_ENABLED
+    // Let the throughput service keep several notifications queued per connection event.
+    ble_cfg_t ble_cfg;
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag                            = APP_BLE_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = BLE_TPUT_HVN_TX_QUEUE_SIZE;
+
+    err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+#endif
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // Lowest RAM start for this SoftDevice configuration; read by tools/nrf_ram_layout.
+    NRF_LOG_INFO("Application RAM can start at 0x%x.", ram_start);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
 
 
+/**@brief Function for handling a change of the LED Button Service button.
+ *
+ * @param[in] pressed  New button state.
+ *
+ * @return true if a notification of the new state was queued.
+ */
+static bool button_change(bool pressed)
+{
+    ret_code_t err_code;
+
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        // Someone is at the device: go back to fast advertising.
+        if (pressed)
+        {
+            advertising_start();
+        }
+        return false;
+    }
+
+    NRF_LOG_INFO("Send button state change.");
+    err_code = ble_lbs_on_button_change(m_conn_handle, &m_lbs, pressed);
+    if (err_code != NRF_SUCCESS &&
+        err_code != BLE_ERROR_INVALID_CONN_HANDLE &&
+        err_code != NRF_ERROR_INVALID_STATE &&
+        err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+    return (err_code == NRF_SUCCESS);
+}
+
+
+#if !LATENCY_TEST_ENABLED
 /**@brief Function for handling events from the button handler module.
  *
  * @param[in] pin_no        The pin that the event applies to.
@@ -487,20 +596,10 @@ static void ble_stack_init(void)
  */
 static void button_event_handler(uint8_t pin_no, uint8_t button_action)
 {
-    ret_code_t err_code;
-
     switch (pin_no)
     {
         case LEDBUTTON_BUTTON:
-            NRF_LOG_INFO("Send button state change.");
-            err_code = ble_lbs_on_button_change(m_conn_handle, &m_lbs, button_action);
-            if (err_code != NRF_SUCCESS &&
-                err_code != BLE_ERROR_INVALID_CONN_HANDLE &&
-                err_code != NRF_ERROR_INVALID_STATE &&
-                err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-            {
-                APP_ERROR_CHECK(err_code);
-            }
+            (void)button_change(button_action == APP_BUTTON_PUSH);
             break;
 
         default:
@@ -508,23 +607,44 @@ static void button_event_handler(uint8_t pin_no, uint8_t button_action)
             break;
     }
 }
+#endif
 
 
 /**@brief Function for initializing the button handler module.
+ *
+ * @details In latency test mode the button is sensed by the lbs_latency module instead, which
+ *          timestamps every edge in hardware and skips the app_button detection delay.
  */
 static void buttons_init(void)
 {
     ret_code_t err_code;
 
+#if LATENCY_TEST_ENABLED
+    err_code = lbs_latency_init(LEDBUTTON_BUTTON, button_change);
+    APP_ERROR_CHECK(err_code);
+#else
     //The array must be static because a pointer to it will be saved in the button handler module.
     static app_button_cfg_t buttons[] =
     {
         {LEDBUTTON_BUTTON, false, BUTTON_PULL, button_event_handler}
     };
 
+#if BUTTON_DEBOUNCE_HW_ENABLED
+    err_code = button_debounce_init(buttons, ARRAY_SIZE(buttons), BUTTON_DEBOUNCE_DELAY_US);
+    APP_ERROR_CHECK(err_code);
+
+    // The button is also used while advertising, to return to the fast tier.
+    button_debounce_enable();
+#else
     err_code = app_button_init(buttons, ARRAY_SIZE(buttons),
                                BUTTON_DETECTION_DELAY);
     APP_ERROR_CHECK(err_code);
+
+    // The button is also used while advertising, to return to the fast tier.
+    err_code = app_button_enable();
+    APP_ERROR_CHECK(err_code);
+#endif
+#endif
 }
 
 
@@ -533,7 +653,12 @@ static void log_init(void)
     ret_code_t err_code = NRF_LOG_INIT(NULL);
     APP_ERROR_CHECK(err_code);
 
+#if NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN)
+    err_code = nrf_log_backend_bin_init();
+    APP_ERROR_CHECK(err_code);
+#else
     NRF_LOG_DEFAULT_BACKENDS_INIT();
+#endif
 }
 
 
@@ -0,0 +1,117 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @brief Eddystone TLM frame encoder reading from the @ref tlm_cache.
+ *
+ * @details Replaces the SDK's es_tlm.c, which refreshes the battery voltage and the temperature
+ *          from inside @ref es_tlm_tlm_get and so performs a blocking SAADC conversion while the
+ *          frame is being prepared for the next advertising event. Here the frame only copies the
+ *          cached values and updates the uptime from the app_timer RTC counter.
+ */
+#include <string.h>
+#include "app_error.h"
+#include "app_timer.h"
+#include "es.h"
+#include "es_tlm.h"
+#include "tlm_cache.h"
+
+#define TICKS_100_MS APP_TIMER_TICKS(100) //!< Resolution of the TLM time-since-boot counter.
+
+static es_tlm_frame_t m_tlm;
+static uint32_t       m_le_adv_cnt;       //!< Number of advertising PDUs sent since boot.
+static uint32_t       m_time_100_ms;      //!< Time since boot, in 100 ms units.
+static uint32_t       m_ticks_last;       //!< RTC counter at the last uptime update.
+static uint32_t       m_ticks_remainder;  //!< Ticks not yet accounted for in m_time_100_ms.
+
+
+static void uint16_be_put(int8_t * p_dst, uint16_t value)
+{
+    p_dst[0] = (int8_t)(value >> 8);
+    p_dst[1] = (int8_t)(value);
+}
+
+
+static void uint32_be_put(int8_t * p_dst, uint32_t value)
+{
+    p_dst[0] = (int8_t)(value >> 24);
+    p_dst[1] = (int8_t)(value >> 16);
+    p_dst[2] = (int8_t)(value >> 8);
+    p_dst[3] = (int8_t)(value);
+}
+
+
+static void update_time(void)
+{
+    uint32_t ticks = app_timer_cnt_get();
+
+    m_ticks_remainder += app_timer_cnt_diff_compute(ticks, m_ticks_last);
+    m_ticks_last       = ticks;
+
+    m_time_100_ms     += m_ticks_remainder / TICKS_100_MS;
+    m_ticks_remainder  = m_ticks_remainder % TICKS_100_MS;
+}
+
+
+void es_tlm_tlm_get(es_tlm_frame_t * p_tlm_frame)
+{
+    // Frame type and TLM version are set in es_tlm_init.
+    update_time();
+
+    uint16_be_put(m_tlm.vbatt, tlm_cache_vbatt_get());
+    uint16_be_put(m_tlm.temp, (uint16_t)tlm_cache_temp_get());
+    uint32_be_put(m_tlm.adv_cnt, m_le_adv_cnt);
+    uint32_be_put(m_tlm.sec_cnt, m_time_100_ms);
+
+    memcpy(p_tlm_frame, &m_tlm, sizeof(es_tlm_frame_t));
+}
+
+
+void es_tlm_adv_cnt_inc(void)
+{
+    m_le_adv_cnt++;
+}
+
+
+void es_tlm_init(void)
+{
+    ret_code_t err_code;
+
+    memset(&m_tlm, 0, sizeof(m_tlm));
+    m_tlm.frame_type  = ES_FRAME_TYPE_TLM;
+    m_tlm.version     = ES_TLM_VERSION_TLM;
+    m_le_adv_cnt      = 0;
+    m_time_100_ms     = 0;
+    m_ticks_remainder = 0;
+    m_ticks_last      = app_timer_cnt_get();
+
+    err_code = tlm_cache_init();
+    APP_ERROR_CHECK(err_code);
+}
@@ -220,6 +220,9 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // Lowest RAM start for this SoftDevice configuration; read by tools/nrf_ram_layout.
+    NRF_LOG_INFO("Application RAM can start at 0x%x.", ram_start);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
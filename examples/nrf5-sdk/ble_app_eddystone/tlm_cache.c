@@ -0,0 +1,214 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "tlm_cache.h"
+
+#include <stdbool.h>
+#include "app_error.h"
+#include "app_timer.h"
+#include "battery_gauge.h"
+#include "es_app_config.h"
+#include "es_battery_voltage.h"
+#include "nrf_drv_saadc.h"
+#include "nrf_soc.h"
+
+
+#define TLM_CACHE_VBATT_INTERVAL    APP_TIMER_TICKS(APP_CONFIG_TLM_VBATT_INTERVAL_SECONDS * 1000)  //!< Time between two supply voltage conversions.
+#define TLM_CACHE_TEMP_INTERVAL     APP_TIMER_TICKS(APP_CONFIG_TLM_TEMP_INTERVAL_SECONDS * 1000)   //!< Time between two temperature readings.
+#define TLM_CACHE_SAADC_CHANNEL     0                                                              //!< SAADC channel used for the VDD measurement.
+
+/**@brief Gauge configuration for a coin cell powering VDD directly, sampled with gain 1/6 and
+ *        the internal 0.6 V reference.
+ */
+#define TLM_CACHE_GAUGE_CONFIG                              \
+{                                                           \
+    .full_scale_mv   = 3600,                                \
+    .divider         = 1,                                   \
+    .resolution_bits = 8 + 2 * SAADC_CONFIG_RESOLUTION,     \
+    .alpha_q15       = BATTERY_GAUGE_ALPHA_Q15(1, 4),       \
+    .min_mv          = 1700,                                \
+    .max_mv          = 3600,                                \
+    .max_step_mv     = 300,                                 \
+    .max_rejects     = 4,                                   \
+    .empty_mv        = 2000,                                \
+    .full_mv         = 3000,                                \
+}
+
+APP_TIMER_DEF(m_vbatt_timer);
+APP_TIMER_DEF(m_temp_timer);
+
+static battery_gauge_t   m_gauge;
+static nrf_saadc_value_t m_sample;
+static volatile bool     m_busy;                            //!< A conversion is in progress.
+static bool              m_initialized;
+static volatile uint16_t m_vbatt_mv = TLM_CACHE_VBATT_UNKNOWN;
+static volatile int16_t  m_temp     = TLM_CACHE_TEMP_UNKNOWN;
+
+
+static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_event)
+{
+    if (p_event->type != NRF_DRV_SAADC_EVT_DONE)
+    {
+        return;
+    }
+
+    (void)battery_gauge_sample_add(&m_gauge, p_event->data.done.p_buffer[0]);
+    if (battery_gauge_is_valid(&m_gauge))
+    {
+        m_vbatt_mv = battery_gauge_mv_get(&m_gauge);
+    }
+    m_busy = false;
+}
+
+
+/**@brief Function for starting a single non-blocking VDD conversion.
+ *
+ * @details The result is delivered in @ref saadc_event_handler. A request made while the previous
+ *          conversion is still running is dropped.
+ */
+static ret_code_t vbatt_sample(void)
+{
+    ret_code_t err_code;
+
+    if (m_busy)
+    {
+        return NRF_SUCCESS;
+    }
+
+    err_code = nrf_drv_saadc_buffer_convert(&m_sample, 1);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_busy   = true;
+    err_code = nrf_drv_saadc_sample();
+    if (err_code != NRF_SUCCESS)
+    {
+        m_busy = false;
+    }
+
+    return err_code;
+}
+
+
+static void temp_sample(void)
+{
+    int32_t temp;
+
+    // The TEMP peripheral returns 0.25 degree steps; 8.8 fixed point is 64 times that.
+    if (sd_temp_get(&temp) == NRF_SUCCESS)
+    {
+        m_temp = (int16_t)(temp * 64);
+    }
+}
+
+
+static void vbatt_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    ret_code_t err_code = vbatt_sample();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+static void temp_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    temp_sample();
+}
+
+
+ret_code_t tlm_cache_init(void)
+{
+    ret_code_t                   err_code;
+    battery_gauge_config_t const gauge_config = TLM_CACHE_GAUGE_CONFIG;
+    nrf_saadc_channel_config_t   channel_config =
+        NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_VDD);
+
+    if (m_initialized)
+    {
+        return NRF_SUCCESS;
+    }
+
+    battery_gauge_init(&m_gauge, &gauge_config);
+
+    err_code = nrf_drv_saadc_init(NULL, saadc_event_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_drv_saadc_channel_init(TLM_CACHE_SAADC_CHANNEL, &channel_config);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_vbatt_timer, APP_TIMER_MODE_REPEATED, vbatt_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_temp_timer, APP_TIMER_MODE_REPEATED, temp_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_start(m_vbatt_timer, TLM_CACHE_VBATT_INTERVAL, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_start(m_temp_timer, TLM_CACHE_TEMP_INTERVAL, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    m_initialized = true;
+
+    temp_sample();
+    return vbatt_sample();
+}
+
+
+uint16_t tlm_cache_vbatt_get(void)
+{
+    return m_vbatt_mv;
+}
+
+
+int16_t tlm_cache_temp_get(void)
+{
+    return m_temp;
+}
+
+
+/**@brief Replacement for the SDK's blocking es_battery_voltage_saadc.c, for modules that still
+ *        use the es_battery_voltage.h interface.
+ */
+void es_battery_voltage_init(void)
+{
+    ret_code_t err_code = tlm_cache_init();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+void es_battery_voltage_get(uint16_t * p_vbatt)
+{
+    *p_vbatt = tlm_cache_vbatt_get();
+}
@@ -0,0 +1,84 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup tlm_cache Eddystone TLM telemetry cache
+ * @{
+ * @ingroup nrf5_sdk_for_eddystone
+ * @brief Slow-rate sampling of the values advertised in the Eddystone TLM frame.
+ *
+ * @details The supply voltage is converted by the SAADC in non-blocking mode and filtered through
+ *          the @ref battery_gauge, and the die temperature is read with @c sd_temp_get. Both are
+ *          sampled from app_timer handlers, which run from the scheduler in thread mode, at the
+ *          rates given by @ref APP_CONFIG_TLM_VBATT_INTERVAL_SECONDS and
+ *          @ref APP_CONFIG_TLM_TEMP_INTERVAL_SECONDS. The getters only return the last cached
+ *          value, so the TLM frame can be built from the radio notification handler without
+ *          waiting on a peripheral.
+ */
+#ifndef TLM_CACHE_H__
+#define TLM_CACHE_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TLM_CACHE_VBATT_UNKNOWN     0           //!< Battery voltage reported before the first accepted conversion, as mandated by the TLM specification.
+#define TLM_CACHE_TEMP_UNKNOWN      INT16_MIN   //!< Temperature reported before the first reading (-128 °C in 8.8 fixed point).
+
+/**@brief Function for starting the telemetry sampling.
+ *
+ * @details Takes a first reading of both values right away. Calling it again has no effect.
+ *
+ * @return NRF_SUCCESS or an error code returned by the SAADC driver or app_timer.
+ */
+ret_code_t tlm_cache_init(void);
+
+/**@brief Function for getting the cached battery voltage.
+ *
+ * @return Filtered supply voltage in millivolts, or @ref TLM_CACHE_VBATT_UNKNOWN.
+ */
+uint16_t tlm_cache_vbatt_get(void);
+
+/**@brief Function for getting the cached beacon temperature.
+ *
+ * @return Die temperature in degrees Celsius, signed 8.8 fixed point, or @ref TLM_CACHE_TEMP_UNKNOWN.
+ */
+int16_t tlm_cache_temp_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TLM_CACHE_H__
+
+/** @} */
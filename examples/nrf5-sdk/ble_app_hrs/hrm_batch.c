@@ -0,0 +1,145 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "hrm_batch.h"
+
+#include <string.h>
+#include "app_util.h"
+#include "nrf_sdh_ble.h"
+#include "energy_marker.h"
+
+#define HRM_FLAG_MASK_HR_VALUE_16BIT            (0x01 << 0)     /**< Heart Rate Value Format bit. */
+#define HRM_FLAG_MASK_SENSOR_CONTACT_DETECTED   (0x01 << 1)     /**< Sensor Contact Detected bit. */
+#define HRM_FLAG_MASK_SENSOR_CONTACT_SUPPORTED  (0x01 << 2)     /**< Sensor Contact Supported bit. */
+#define HRM_FLAG_MASK_RR_INTERVAL_INCLUDED      (0x01 << 4)     /**< RR-Interval bit. */
+
+#define HRM_HEADER_MAX_LEN  3   /**< Flags and a 16-bit heart rate. */
+#define HRM_MAX_LEN         (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)
+
+STATIC_ASSERT(IS_POWER_OF_TWO(HRM_BATCH_CAPACITY));
+STATIC_ASSERT(HRM_BATCH_CAPACITY <= UINT16_MAX);
+
+static uint16_t m_rr[HRM_BATCH_CAPACITY];   /**< RR interval ring. */
+static uint32_t m_head;                     /**< Free-running write index. */
+static uint32_t m_tail;                     /**< Free-running read index. */
+static uint32_t m_overwritten;              /**< RR intervals dropped because the ring was full. */
+
+static uint8_t  m_encoded[HRM_MAX_LEN];     /**< Encoding buffer; the SoftDevice copies it in sd_ble_gatts_hvx. */
+
+
+void hrm_batch_rr_add(uint16_t rr_interval)
+{
+    if ((m_head - m_tail) == HRM_BATCH_CAPACITY)
+    {
+        m_tail++;
+        m_overwritten++;
+    }
+
+    m_rr[m_head & (HRM_BATCH_CAPACITY - 1)] = rr_interval;
+    m_head++;
+}
+
+
+uint16_t hrm_batch_pending(void)
+{
+    return (uint16_t)(m_head - m_tail);
+}
+
+
+uint16_t hrm_batch_rr_per_notification(ble_hrs_t const * p_hrs)
+{
+    uint16_t max_len = MIN(p_hrs->max_hrm_len, HRM_MAX_LEN);
+
+    return (max_len - HRM_HEADER_MAX_LEN) / sizeof(uint16_t);
+}
+
+
+uint32_t hrm_batch_overwritten_count(void)
+{
+    return m_overwritten;
+}
+
+
+ret_code_t hrm_batch_send(ble_hrs_t const * p_hrs, uint16_t heart_rate)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    uint8_t                flags = 0;
+    uint16_t               len   = 1;
+    uint16_t               rr_count;
+    ret_code_t             err_code;
+    energy_phase_t         phase = energy_marker_begin(ENERGY_PHASE_NOTIFY);
+
+    if (p_hrs->is_sensor_contact_supported)
+    {
+        flags |= HRM_FLAG_MASK_SENSOR_CONTACT_SUPPORTED;
+    }
+    if (p_hrs->is_sensor_contact_detected)
+    {
+        flags |= HRM_FLAG_MASK_SENSOR_CONTACT_DETECTED;
+    }
+
+    if (heart_rate > 0xFF)
+    {
+        flags |= HRM_FLAG_MASK_HR_VALUE_16BIT;
+        len   += uint16_encode(heart_rate, &m_encoded[len]);
+    }
+    else
+    {
+        m_encoded[len++] = (uint8_t)heart_rate;
+    }
+
+    rr_count = MIN(hrm_batch_pending(), hrm_batch_rr_per_notification(p_hrs));
+    if (rr_count > 0)
+    {
+        flags |= HRM_FLAG_MASK_RR_INTERVAL_INCLUDED;
+    }
+    for (uint16_t i = 0; i < rr_count; i++)
+    {
+        len += uint16_encode(m_rr[(m_tail + i) & (HRM_BATCH_CAPACITY - 1)], &m_encoded[len]);
+    }
+
+    m_encoded[0] = flags;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = p_hrs->hrm_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = m_encoded;
+
+    err_code = sd_ble_gatts_hvx(p_hrs->conn_handle, &hvx_params);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_tail += rr_count;
+    }
+
+    energy_marker_end(phase);
+    return err_code;
+}
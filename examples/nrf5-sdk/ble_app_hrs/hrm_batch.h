@@ -0,0 +1,105 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup hrm_batch Batched Heart Rate Measurement notifications
+ * @{
+ * @brief RR interval accumulator that packs as many RR intervals per notification as the MTU allows.
+ *
+ * @details The Heart Rate Service keeps at most BLE_HRS_MAX_BUFFERED_RR_INTERVALS RR intervals,
+ *          which is far less than one notification can carry with a 247-byte ATT MTU. This module
+ *          keeps its own ring of RR intervals, encodes the Heart Rate Measurement itself using
+ *          the characteristic handles and sensor contact state of the @ref ble_hrs_t instance,
+ *          and removes RR intervals from the ring only after the SoftDevice has accepted the
+ *          notification. RR intervals recorded while no peer is subscribed are therefore kept
+ *          until the ring wraps, and are sent on the next connection.
+ *
+ * @note    All functions must be called from the same interrupt priority (the app_timer and
+ *          SoftDevice event handlers in this example both run at priority 6).
+ */
+#ifndef HRM_BATCH_H__
+#define HRM_BATCH_H__
+
+#include <stdint.h>
+#include "ble_hrs.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef HRM_BATCH_CAPACITY
+#define HRM_BATCH_CAPACITY  2048    /**< Number of RR intervals kept. Must be a power of two. */
+#endif
+
+
+/**@brief Function for adding an RR interval to the accumulator.
+ *
+ * @details When the ring is full the oldest RR interval is overwritten.
+ *
+ * @param[in] rr_interval  RR interval, in 1/1024 seconds.
+ */
+void hrm_batch_rr_add(uint16_t rr_interval);
+
+
+/**@brief Function for sending one Heart Rate Measurement carrying as many of the oldest RR
+ *        intervals as fit in the current ATT MTU.
+ *
+ * @param[in] p_hrs       Heart Rate Service providing the handles, MTU and sensor contact state.
+ * @param[in] heart_rate  Heart rate to report.
+ *
+ * @retval NRF_SUCCESS  The notification was queued and its RR intervals removed from the ring.
+ * @return Error codes returned by sd_ble_gatts_hvx; the RR intervals stay in the ring.
+ */
+ret_code_t hrm_batch_send(ble_hrs_t const * p_hrs, uint16_t heart_rate);
+
+
+/**@brief Function for getting the number of RR intervals waiting to be sent. */
+uint16_t hrm_batch_pending(void);
+
+
+/**@brief Function for getting the number of RR intervals that fit in one notification.
+ *
+ * @param[in] p_hrs  Heart Rate Service whose current ATT MTU is used.
+ */
+uint16_t hrm_batch_rr_per_notification(ble_hrs_t const * p_hrs);
+
+
+/**@brief Function for getting the number of RR intervals lost because the ring was full. */
+uint32_t hrm_batch_overwritten_count(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HRM_BATCH_H__
+
+/** @} */
@@ -57,7 +57,6 @@
 #include "ble_hci.h"
 #include "ble_srv_common.h"
 #include "ble_advdata.h"
-#include "ble_advertising.h"
 #include "ble_bas.h"
 #include "ble_hrs.h"
 #include "ble_dis.h"
@@ -67,6 +66,7 @@
 #include "nrf_sdh_ble.h"
 #include "nrf_sdh_soc.h"
 #include "app_timer.h"
+#include "app_util_platform.h"
 #include "bsp_btn_ble.h"
 #include "peer_manager.h"
 #include "peer_manager_handler.h"
@@ -76,42 +76,75 @@
 #include "nrf_ble_qwr.h"
 #include "ble_conn_state.h"
 #include "nrf_pwr_mgmt.h"
+#include "nrf_drv_saadc.h"
+#include "battery_gauge.h"
+#include "ble_conn_profile.h"
+#include "ble_adv_tiers.h"
+#include "hrm_batch.h"
+#include "tick_sched.h"
+#include "nfc_oob_wake.h"
+#include "retained.h"
+#include "energy_marker.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
+#include "nrf_log_backend_bin.h"
 
 
 #define DEVICE_NAME                         "Nordic_HRM"                            /**< Name of device. Will be included in the advertising data. */
 #define MANUFACTURER_NAME                   "NordicSemiconductor"                   /**< Manufacturer. Will be passed to Device Information Service. */
-#define APP_ADV_INTERVAL                    300                                     /**< The advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
+#define APP_ADV_FAST_INTERVAL               40                                      /**< The fast advertising interval (in units of 0.625 ms. This value corresponds to 25 ms). */
+#define APP_ADV_FAST_DURATION               3000                                    /**< The fast advertising duration (30 seconds) in units of 10 milliseconds. */
+#define APP_ADV_SLOW_INTERVAL               300                                     /**< The slow advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
+#define APP_ADV_SLOW_DURATION               15000                                   /**< The slow advertising duration (150 seconds) in units of 10 milliseconds. */
+#define APP_ADV_VERY_SLOW_INTERVAL          1600                                    /**< The very slow advertising interval (in units of 0.625 ms. This value corresponds to 1 second). */
+#define APP_ADV_VERY_SLOW_DURATION          60000                                   /**< The very slow advertising duration (10 minutes) in units of 10 milliseconds, after which the device goes to System OFF. */
+#define APP_ADV_EVENT_CHARGE_NC             8000                                    /**< Estimated charge of one connectable advertising event at 0 dBm, in nanocoulombs. */
 
-#define APP_ADV_DURATION                    18000                                   /**< The advertising duration (180 seconds) in units of 10 milliseconds. */
+#define APP_NFC_WAKE_ENABLED                1                                       /**< Set to 1 to keep the radio off until the NFC tag is read, and to offer OOB pairing data in the tag. Set to 0 to advertise on start-up and after each disconnection. */
 
 #define APP_BLE_CONN_CFG_TAG                1                                       /**< A tag identifying the SoftDevice BLE configuration. */
 #define APP_BLE_OBSERVER_PRIO               3                                       /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 
-#define BATTERY_LEVEL_MEAS_INTERVAL         APP_TIMER_TICKS(2000)                   /**< Battery level measurement interval (ticks). */
+#define BATTERY_LEVEL_MEAS_INTERVAL         TICK_SCHED_MS_TO_SLOTS(2000)            /**< Battery level measurement interval (scheduler slots). */
 #define MIN_BATTERY_LEVEL                   81                                      /**< Minimum simulated battery level. */
 #define MAX_BATTERY_LEVEL                   100                                     /**< Maximum simulated 7battery level. */
 #define BATTERY_LEVEL_INCREMENT             1                                       /**< Increment between each simulated battery level measurement. */
 
-#define HEART_RATE_MEAS_INTERVAL            APP_TIMER_TICKS(1000)                   /**< Heart rate measurement interval (ticks). */
+#define BATTERY_SAADC_ENABLED               1                                       /**< Set to 0 to report the simulated battery level instead of the SAADC measurement. */
+#define BATTERY_SAADC_INPUT                 NRF_SAADC_INPUT_AIN2                    /**< SAADC input connected to the battery divider on the Base Dock. */
+
+#if BATTERY_SAADC_ENABLED
+// The battery divider must not share a pin with the LEDs or the Grove-Buttons.
+BOARD_PINS_CLAIM(BOARD_AIN_MASK(BATTERY_SAADC_INPUT - NRF_SAADC_INPUT_AIN0),
+                 BOARD_LEDS_PIN_MASK | BOARD_BUTTONS_PIN_MASK);
+#endif
+
 #define MIN_HEART_RATE                      140                                     /**< Minimum heart rate as returned by the simulated measurement function. */
 #define MAX_HEART_RATE                      300                                     /**< Maximum heart rate as returned by the simulated measurement function. */
 #define HEART_RATE_INCREMENT                10                                      /**< Value by which the heart rate is incremented/decremented for each call to the simulated measurement function. */
 
-#define RR_INTERVAL_INTERVAL                APP_TIMER_TICKS(300)                    /**< RR interval interval (ticks). */
+#define HEART_RATE_MEAS_INTERVAL            TICK_SCHED_MS_TO_SLOTS(1000)            /**< Heart rate measurement interval (scheduler slots). */
+
+#define RR_INTERVALS_PER_TICK               20                                      /**< Number of simulated RR intervals recorded per heart rate measurement. */
 #define MIN_RR_INTERVAL                     100                                     /**< Minimum RR interval as returned by the simulated measurement function. */
 #define MAX_RR_INTERVAL                     500                                     /**< Maximum RR interval as returned by the simulated measurement function. */
 #define RR_INTERVAL_INCREMENT               1                                       /**< Value by which the RR interval is incremented/decremented for each call to the simulated measurement function. */
 
-#define SENSOR_CONTACT_DETECTED_INTERVAL    APP_TIMER_TICKS(5000)                   /**< Sensor Contact Detected toggle interval (ticks). */
+#define SENSOR_CONTACT_DETECTED_INTERVAL    TICK_SCHED_MS_TO_SLOTS(5000)            /**< Sensor Contact Detected toggle interval (scheduler slots). */
 
-#define MIN_CONN_INTERVAL                   MSEC_TO_UNITS(400, UNIT_1_25_MS)        /**< Minimum acceptable connection interval (0.4 seconds). */
-#define MAX_CONN_INTERVAL                   MSEC_TO_UNITS(650, UNIT_1_25_MS)        /**< Maximum acceptable connection interval (0.65 second). */
-#define SLAVE_LATENCY                       0                                       /**< Slave latency. */
-#define CONN_SUP_TIMEOUT                    MSEC_TO_UNITS(4000, UNIT_10_MS)         /**< Connection supervisory timeout (4 seconds). */
+#define MIN_CONN_INTERVAL                   MSEC_TO_UNITS(400, UNIT_1_25_MS)        /**< Minimum acceptable connection interval in the idle profile (0.4 seconds). */
+#define MAX_CONN_INTERVAL                   MSEC_TO_UNITS(650, UNIT_1_25_MS)        /**< Maximum acceptable connection interval in the idle profile (0.65 second). */
+#define SLAVE_LATENCY                       3                                       /**< Slave latency in the idle profile. */
+#define CONN_SUP_TIMEOUT                    MSEC_TO_UNITS(6000, UNIT_10_MS)         /**< Connection supervisory timeout (6 seconds), long enough for the idle profile's latency. */
+
+#define BULK_MIN_CONN_INTERVAL              MSEC_TO_UNITS(7.5, UNIT_1_25_MS)        /**< Minimum acceptable connection interval in the bulk profile (7.5 ms). */
+#define BULK_MAX_CONN_INTERVAL              MSEC_TO_UNITS(15, UNIT_1_25_MS)         /**< Maximum acceptable connection interval in the bulk profile (15 ms). */
+#define BULK_SLAVE_LATENCY                  0                                       /**< Slave latency in the bulk profile. */
+#define BULK_ENTER_LEVEL                    480                                     /**< Number of buffered RR intervals (four full notifications at the maximum MTU) at which the bulk profile is selected. */
+#define BULK_EXIT_LEVEL                     RR_INTERVALS_PER_TICK                   /**< Number of buffered RR intervals at or below which the link may return to the idle profile. */
+#define BULK_IDLE_DELAY                     APP_TIMER_TICKS(10000)                  /**< Time the RR backlog must stay drained before returning to the idle profile (10 seconds). */
 
 #define FIRST_CONN_PARAMS_UPDATE_DELAY      APP_TIMER_TICKS(5000)                   /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY       APP_TIMER_TICKS(30000)                  /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
@@ -124,25 +157,59 @@
 #define SEC_PARAM_LESC                      1                                       /**< LE Secure Connections enabled. */
 #define SEC_PARAM_KEYPRESS                  0                                       /**< Keypress notifications not enabled. */
 #define SEC_PARAM_IO_CAPABILITIES           BLE_GAP_IO_CAPS_NONE                    /**< No I/O capabilities. */
-#define SEC_PARAM_OOB                       0                                       /**< Out Of Band data not available. */
+#define SEC_PARAM_OOB                       APP_NFC_WAKE_ENABLED                    /**< Out Of Band data available when exchanged over NFC. */
 #define SEC_PARAM_MIN_KEY_SIZE              7                                       /**< Minimum encryption key size. */
 #define SEC_PARAM_MAX_KEY_SIZE              16                                      /**< Maximum encryption key size. */
 
+#define APP_BOND_MAX                        8                                       /**< Bonds kept; the least recently used peer is deleted to make room. At most the size of the SoftDevice whitelist and device identity list. */
+
 #define DEAD_BEEF                           0xDEADBEEF                              /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
+#define RETAINED_VERSION                    1                                       /**< Layout version of the records kept in retained RAM. Change it when battery_gauge_t changes. */
+
 
 BLE_HRS_DEF(m_hrs);                                                 /**< Heart rate service instance. */
 BLE_BAS_DEF(m_bas);                                                 /**< Structure used to identify the battery service. */
 NRF_BLE_GATT_DEF(m_gatt);                                           /**< GATT module instance. */
 NRF_BLE_QWR_DEF(m_qwr);                                             /**< Context for the Queued Write module.*/
-BLE_ADVERTISING_DEF(m_advertising);                                 /**< Advertising module instance. */
-APP_TIMER_DEF(m_battery_timer_id);                                  /**< Battery timer. */
-APP_TIMER_DEF(m_heart_rate_timer_id);                               /**< Heart rate measurement timer. */
-APP_TIMER_DEF(m_rr_interval_timer_id);                              /**< RR interval timer. */
-APP_TIMER_DEF(m_sensor_contact_timer_id);                           /**< Sensor contact detected timer. */
+BLE_ADV_TIERS_DEF(m_adv_tiers);                                     /**< Tiered advertising instance. */
+BLE_CONN_PROFILE_DEF(m_conn_profile);                               /**< Connection parameter profile switching. */
 
 static uint16_t m_conn_handle         = BLE_CONN_HANDLE_INVALID;    /**< Handle of the current connection. */
 static bool     m_rr_interval_enabled = true;                       /**< Flag for enabling and disabling the registration of new RR interval measurements (the purpose of disabling this is just to test sending HRM without RR interval data. */
+static uint16_t m_heart_rate;                                       /**< Last heart rate measurement, repeated in the notifications that drain the RR interval backlog. */
+static volatile bool m_lesc_keys_used;                              /**< The LESC key pair has been used in a pairing and is replaced once the link is down. */
+static volatile bool m_adv_deferred;                                /**< Advertising was requested while the key pair was being replaced. */
+static volatile bool m_adv_deferred_open;                           /**< One of the deferred requests was for advertising without the whitelist. */
+static volatile bool m_adv_restarting;                              /**< The main loop is starting the deferred advertising. */
+static bool     m_peer_lists_stale     = true;                      /**< The whitelist and device identity list must be set again before advertising. */
+static uint32_t m_whitelist_count;                                  /**< Number of peers in the whitelist. */
+
+static ble_conn_profile_params_t const m_idle_profile =             /**< Low-power link settings, matching the PPCP. */
+{
+    .conn_params  =
+    {
+        .min_conn_interval = MIN_CONN_INTERVAL,
+        .max_conn_interval = MAX_CONN_INTERVAL,
+        .slave_latency     = SLAVE_LATENCY,
+        .conn_sup_timeout  = CONN_SUP_TIMEOUT,
+    },
+    .phys         = BLE_GAP_PHY_AUTO,
+    .conn_evt_ext = false,
+};
+
+static ble_conn_profile_params_t const m_bulk_profile =             /**< High-throughput link settings. */
+{
+    .conn_params  =
+    {
+        .min_conn_interval = BULK_MIN_CONN_INTERVAL,
+        .max_conn_interval = BULK_MAX_CONN_INTERVAL,
+        .slave_latency     = BULK_SLAVE_LATENCY,
+        .conn_sup_timeout  = CONN_SUP_TIMEOUT,
+    },
+    .phys         = BLE_GAP_PHY_2MBPS,
+    .conn_evt_ext = true,
+};
 
 static sensorsim_cfg_t   m_battery_sim_cfg;                         /**< Battery Level sensor simulator configuration. */
 static sensorsim_state_t m_battery_sim_state;                       /**< Battery Level sensor simulator state. */
@@ -151,6 +218,12 @@ static sensorsim_state_t m_heart_rate_sim_state;                    /**< Heart R
 static sensorsim_cfg_t   m_rr_interval_sim_cfg;                     /**< RR Interval sensor simulator configuration. */
 static sensorsim_state_t m_rr_interval_sim_state;                   /**< RR Interval sensor simulator state. */
 
+#if BATTERY_SAADC_ENABLED
+static nrf_saadc_value_t m_battery_adc_buf[2];                      /**< SAADC buffers, one sample each. */
+static battery_gauge_t   m_battery_gauge;                           /**< Filtered battery voltage. */
+RETAINED_DEF(m_retained_gauge, battery_gauge_t);                    /**< Gauge state saved on entering System OFF. */
+#endif
+
 static ble_uuid_t m_adv_uuids[] =                                   /**< Universally unique service identifiers. */
 {
     {BLE_UUID_HEART_RATE_SERVICE,           BLE_UUID_TYPE_BLE},
@@ -158,6 +231,24 @@ static ble_uuid_t m_adv_uuids[] =                                   /**< Univers
     {BLE_UUID_DEVICE_INFORMATION_SERVICE,   BLE_UUID_TYPE_BLE}
 };
 
+static uint8_t m_enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];        /**< Buffer for storing an encoded advertising set. */
+
+static ble_gap_adv_data_t m_adv_data =                              /**< Encoded advertising data; there is no scan response. */
+{
+    .adv_data =
+    {
+        .p_data = m_enc_advdata,
+        .len    = BLE_GAP_ADV_SET_DATA_SIZE_MAX
+    },
+};
+
+static ble_adv_tier_t const m_adv_tier[] =                          /**< Advertising tiers, stepped through while no central connects. */
+{
+    {.interval = APP_ADV_FAST_INTERVAL,      .duration = APP_ADV_FAST_DURATION},
+    {.interval = APP_ADV_SLOW_INTERVAL,      .duration = APP_ADV_SLOW_DURATION},
+    {.interval = APP_ADV_VERY_SLOW_INTERVAL, .duration = APP_ADV_VERY_SLOW_DURATION},
+};
+
 
 /**@brief Callback function for asserts in the SoftDevice.
  *
@@ -189,6 +280,142 @@ static void delete_bonds(void)
 }
 
 
+/**@brief Function for giving the SoftDevice the bonded peers' addresses and IRKs.
+ *
+ * @details With the IRKs in the device identity list, the controller resolves private addresses
+ *          in hardware, for the whitelist as well as on connection. The Peer Manager then finds
+ *          the peer by its identity address instead of trying each stored IRK in turn. The lists
+ *          can only be set while advertising is stopped.
+ */
+static void peer_lists_set(void)
+{
+    pm_peer_id_t peer_ids[APP_BOND_MAX];
+    uint32_t     peer_id_count;
+    ret_code_t   err_code;
+
+    peer_id_count = APP_BOND_MAX;
+    err_code = pm_peer_id_list(peer_ids, &peer_id_count, PM_PEER_ID_INVALID,
+                               PM_PEER_ID_LIST_SKIP_NO_ID_ADDR);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = pm_whitelist_set((peer_id_count > 0) ? peer_ids : NULL, peer_id_count);
+    APP_ERROR_CHECK(err_code);
+    m_whitelist_count = peer_id_count;
+
+    peer_id_count = APP_BOND_MAX;
+    err_code = pm_peer_id_list(peer_ids, &peer_id_count, PM_PEER_ID_INVALID,
+                               PM_PEER_ID_LIST_SKIP_NO_IRK);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = pm_device_identities_list_set((peer_id_count > 0) ? peer_ids : NULL, peer_id_count);
+    if (err_code != NRF_ERROR_NOT_SUPPORTED)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    m_peer_lists_stale = false;
+}
+
+
+/**@brief Function for deleting the least recently used bond other than the given peer.
+ *
+ * @details Peers are ranked each time their link is secured. A bond without a rank record has
+ *          never been ranked and is taken as the oldest.
+ *
+ * @param[in] keep  Peer just bonded, which must not be deleted.
+ */
+static void bond_evict_lru(pm_peer_id_t keep)
+{
+    pm_peer_id_t peer_id  = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+    pm_peer_id_t lru      = PM_PEER_ID_INVALID;
+    uint32_t     lru_rank = UINT32_MAX;
+    ret_code_t   err_code;
+
+    while (peer_id != PM_PEER_ID_INVALID)
+    {
+        uint32_t rank = 0;
+        uint32_t len  = sizeof(rank);
+
+        if (peer_id != keep)
+        {
+            err_code = pm_peer_data_load(peer_id, PM_PEER_DATA_ID_PEER_RANK, &rank, &len);
+            if (err_code == NRF_ERROR_NOT_FOUND)
+            {
+                rank = 0;
+            }
+            else
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+
+            if (rank < lru_rank)
+            {
+                lru      = peer_id;
+                lru_rank = rank;
+            }
+        }
+        peer_id = pm_next_peer_id_get(peer_id);
+    }
+
+    if (lru != PM_PEER_ID_INVALID)
+    {
+        NRF_LOG_INFO("Bond limit reached, deleting peer %d.", lru);
+        err_code = pm_peer_delete(lru);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for starting advertising in the fast tier, or returning to it, without
+ *        deferring the start.
+ *
+ * @param[in] whitelist  Only accept connections from bonded peers, if there are any.
+ */
+static void adv_tiers_restart_now(bool whitelist)
+{
+    ret_code_t err_code;
+
+    err_code = ble_adv_tiers_stop(&m_adv_tiers);
+    APP_ERROR_CHECK(err_code);
+
+    if (m_peer_lists_stale)
+    {
+        peer_lists_set();
+    }
+
+    ble_adv_tiers_filter_policy_set(&m_adv_tiers,
+                                    (whitelist && (m_whitelist_count > 0))
+                                    ? BLE_GAP_ADV_FP_FILTER_CONNREQ
+                                    : BLE_GAP_ADV_FP_ANY);
+
+    err_code = ble_adv_tiers_start(&m_adv_tiers);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for starting advertising in the fast tier, or returning to it.
+ *
+ * @details While a used LESC key pair is waiting to be replaced, the start is deferred to
+ *          @ref lesc_keys_refresh, so no peer can connect and pair against a key pair that is
+ *          being overwritten. The whitelist and device identity list are brought up to date
+ *          first if the bonds have changed.
+ *
+ * @param[in] whitelist  Only accept connections from bonded peers, if there are any. Other
+ *                       devices can still scan.
+ */
+static void adv_tiers_restart(bool whitelist)
+{
+    if (m_lesc_keys_used || m_adv_restarting)
+    {
+        m_adv_deferred       = true;
+        m_adv_deferred_open |= !whitelist;
+        return;
+    }
+
+    adv_tiers_restart_now(whitelist);
+}
+
+
 /**@brief Function for starting advertising.
  */
 void advertising_start(bool erase_bonds)
@@ -200,12 +427,33 @@ void advertising_start(bool erase_bonds)
     }
     else
     {
-        ret_code_t err_code;
+#if APP_NFC_WAKE_ENABLED
+        // Advertising is started from nfc_field_handler().
+        NRF_LOG_INFO("Waiting for an NFC tap.");
+#else
+        adv_tiers_restart(true);
+#endif
+    }
+}
 
-        err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
-        APP_ERROR_CHECK(err_code);
+
+#if APP_NFC_WAKE_ENABLED
+/**@brief Function for handling an NFC tap.
+ *
+ * @details Starts advertising in the fast tier, or returns to it, unless a peer is connected. The
+ *          phone that read the tag has the address and OOB data and connects right away.
+ */
+static void nfc_field_handler(void)
+{
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        return;
     }
+
+    // A new phone may be tapping to pair.
+    adv_tiers_restart(false);
 }
+#endif
 
 
 /**@brief Function for handling Peer Manager events.
@@ -214,12 +462,41 @@ void advertising_start(bool erase_bonds)
  */
 static void pm_evt_handler(pm_evt_t const * p_evt)
 {
+    ret_code_t err_code;
+
     pm_handler_on_pm_evt(p_evt);
     pm_handler_flash_clean(p_evt);
 
     switch (p_evt->evt_id)
     {
+        case PM_EVT_CONN_SEC_SUCCEEDED:
+            // Most recently used peers rank highest.
+            err_code = pm_peer_rank_highest(p_evt->peer_id);
+            if (err_code != NRF_ERROR_BUSY)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+
+            if ((p_evt->params.conn_sec_succeeded.procedure == PM_CONN_SEC_PROCEDURE_BONDING) &&
+                (pm_peer_count() > APP_BOND_MAX))
+            {
+                bond_evict_lru(p_evt->peer_id);
+            }
+            break;
+
+        case PM_EVT_PEER_DATA_UPDATE_SUCCEEDED:
+            if (p_evt->params.peer_data_update_succeeded.data_id == PM_PEER_DATA_ID_BONDING)
+            {
+                m_peer_lists_stale = true;
+            }
+            break;
+
+        case PM_EVT_PEER_DELETE_SUCCEEDED:
+            m_peer_lists_stale = true;
+            break;
+
         case PM_EVT_PEERS_DELETE_SUCCEEDED:
+            m_peer_lists_stale = true;
             advertising_start(false);
             break;
 
@@ -237,7 +514,19 @@ static void battery_level_update(void)
     ret_code_t err_code;
     uint8_t  battery_level;
 
+#if BATTERY_SAADC_ENABLED
+    // Start the next conversion; its result is filtered in saadc_event_handler().
+    err_code = nrf_drv_saadc_sample();
+    APP_ERROR_CHECK(err_code);
+
+    if (!battery_gauge_is_valid(&m_battery_gauge))
+    {
+        return;
+    }
+    battery_level = battery_gauge_level_get(&m_battery_gauge);
+#else
     battery_level = (uint8_t)sensorsim_measure(&m_battery_sim_state, &m_battery_sim_cfg);
+#endif
 
     err_code = ble_bas_battery_level_update(&m_bas, battery_level, BLE_CONN_HANDLE_ALL);
     if ((err_code != NRF_SUCCESS) &&
@@ -252,102 +541,160 @@ static void battery_level_update(void)
 }
 
 
-/**@brief Function for handling the Battery measurement timer timeout.
+#if BATTERY_SAADC_ENABLED
+/**@brief Function for handling the SAADC events.
  *
- * @details This function will be called each time the battery level measurement timer expires.
+ * @details Only feeds the battery gauge; the Battery Level characteristic is updated from the
+ *          battery measurement task.
  *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
+ * @param[in] p_event  SAADC event.
  */
-static void battery_level_meas_timeout_handler(void * p_context)
+static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_event)
 {
-    UNUSED_PARAMETER(p_context);
-    battery_level_update();
+    if (p_event->type == NRF_DRV_SAADC_EVT_DONE)
+    {
+        ret_code_t err_code;
+
+        battery_gauge_buffer_add(&m_battery_gauge,
+                                 p_event->data.done.p_buffer,
+                                 p_event->data.done.size);
+
+        err_code = nrf_drv_saadc_buffer_convert(p_event->data.done.p_buffer, 1);
+        APP_ERROR_CHECK(err_code);
+    }
 }
 
 
-/**@brief Function for handling the Heart rate measurement timer timeout.
- *
- * @details This function will be called each time the heart rate measurement timer expires.
- *          It will exclude RR Interval data from every third measurement.
- *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
+/**@brief Function for configuring the SAADC to measure the battery voltage.
  */
-static void heart_rate_meas_timeout_handler(void * p_context)
+static void battery_saadc_init(void)
 {
-    static uint32_t cnt = 0;
-    ret_code_t      err_code;
-    uint16_t        heart_rate;
+    ret_code_t                   err_code;
+    battery_gauge_config_t const gauge_config   = BATTERY_GAUGE_DEFAULT_CONFIG;
+    nrf_saadc_channel_config_t   channel_config =
+        NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(BATTERY_SAADC_INPUT);
+
+    // After System OFF the average carries on from where it was, instead of being reseeded from
+    // a single reading. The record is used once; any other reset reseeds the gauge.
+    if (retained_wakeup_from_off() && RETAINED_IS_VALID(m_retained_gauge, RETAINED_VERSION))
+    {
+        m_battery_gauge = m_retained_gauge.data;
+    }
+    else
+    {
+        battery_gauge_init(&m_battery_gauge, &gauge_config);
+    }
+    RETAINED_INVALIDATE(m_retained_gauge);
 
-    UNUSED_PARAMETER(p_context);
+    err_code = nrf_drv_saadc_init(NULL, saadc_event_handler);
+    APP_ERROR_CHECK(err_code);
 
-    heart_rate = (uint16_t)sensorsim_measure(&m_heart_rate_sim_state, &m_heart_rate_sim_cfg);
+    err_code = nrf_drv_saadc_channel_init(0, &channel_config);
+    APP_ERROR_CHECK(err_code);
 
-    cnt++;
-    err_code = ble_hrs_heart_rate_measurement_send(&m_hrs, heart_rate);
+    err_code = nrf_drv_saadc_buffer_convert(&m_battery_adc_buf[0], 1);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_drv_saadc_buffer_convert(&m_battery_adc_buf[1], 1);
+    APP_ERROR_CHECK(err_code);
+}
+#endif // BATTERY_SAADC_ENABLED
+
+
+/**@brief Function for passing the RR interval backlog to the connection profile switching.
+ */
+static void conn_profile_level_update(void)
+{
+    ret_code_t err_code = ble_conn_profile_tx_level_update(&m_conn_profile, hrm_batch_pending());
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for sending a Heart Rate Measurement with the last heart rate and as many
+ *        buffered RR intervals as fit in the ATT MTU.
+ */
+static void heart_rate_measurement_send(void)
+{
+    ret_code_t err_code;
+
+    err_code = hrm_batch_send(&m_hrs, m_heart_rate);
     if ((err_code != NRF_SUCCESS) &&
         (err_code != NRF_ERROR_INVALID_STATE) &&
         (err_code != NRF_ERROR_RESOURCES) &&
         (err_code != NRF_ERROR_BUSY) &&
+        (err_code != BLE_ERROR_INVALID_CONN_HANDLE) &&
         (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
        )
     {
         APP_ERROR_HANDLER(err_code);
     }
 
-    // Disable RR Interval recording every third heart rate measurement.
-    // NOTE: An application will normally not do this. It is done here just for testing generation
-    // of messages without RR Interval measurements.
-    m_rr_interval_enabled = ((cnt % 3) != 0);
+    conn_profile_level_update();
 }
 
 
-/**@brief Function for handling the RR interval timer timeout.
- *
- * @details This function will be called each time the RR interval timer expires.
- *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
+/**@brief Function for recording the RR intervals measured since the last tick.
  */
-static void rr_interval_timeout_handler(void * p_context)
+static void rr_intervals_record(void)
 {
-    UNUSED_PARAMETER(p_context);
-
     if (m_rr_interval_enabled)
     {
-        uint16_t rr_interval;
-
-        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                  &m_rr_interval_sim_cfg);
-        ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                  &m_rr_interval_sim_cfg);
-        ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                  &m_rr_interval_sim_cfg);
-        ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                  &m_rr_interval_sim_cfg);
-        ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                  &m_rr_interval_sim_cfg);
-        ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                  &m_rr_interval_sim_cfg);
-        ble_hrs_rr_interval_add(&m_hrs, rr_interval);
+        for (uint32_t i = 0; i < RR_INTERVALS_PER_TICK; i++)
+        {
+            uint16_t rr_interval;
+
+            rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
+                                                      &m_rr_interval_sim_cfg);
+            hrm_batch_rr_add(rr_interval);
+        }
     }
 }
 
 
-/**@brief Function for handling the Sensor Contact Detected timer timeout.
+/**@brief Function for handling the Battery measurement task.
+ *
+ * @param[in] p_context  Unused.
+ */
+static void battery_level_meas_task(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    battery_level_update();
+}
+
+
+/**@brief Function for handling the Heart rate measurement task.
  *
- * @details This function will be called each time the Sensor Contact Detected timer expires.
+ * @details All RR intervals recorded since the previous measurement leave in the same
+ *          notification as the heart rate. RR Interval data is excluded from every third
+ *          measurement.
  *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
+ * @param[in] p_context  Unused.
  */
-static void sensor_contact_detected_timeout_handler(void * p_context)
+static void heart_rate_meas_task(void * p_context)
+{
+    static uint32_t cnt = 0;
+
+    UNUSED_PARAMETER(p_context);
+
+    rr_intervals_record();
+
+    m_heart_rate = (uint16_t)sensorsim_measure(&m_heart_rate_sim_state, &m_heart_rate_sim_cfg);
+    heart_rate_measurement_send();
+
+    cnt++;
+
+    // Disable RR Interval recording every third heart rate measurement.
+    // NOTE: An application will normally not do this. It is done here just for testing generation
+    // of messages without RR Interval measurements.
+    m_rr_interval_enabled = ((cnt % 3) != 0);
+}
+
+
+/**@brief Function for handling the Sensor Contact Detected task.
+ *
+ * @param[in] p_context  Unused.
+ */
+static void sensor_contact_detected_task(void * p_context)
 {
     static bool sensor_contact_detected = false;
 
@@ -360,35 +707,45 @@ static void sensor_contact_detected_timeout_handler(void * p_context)
 
 /**@brief Function for the Timer initialization.
  *
- * @details Initializes the timer module. This creates and starts application timers.
+ * @details Initializes the timer module, used by the SDK libraries, and the tick scheduler that
+ *          runs the periodic sensor tasks. All tasks share slot 0 as their phase, so the battery
+ *          and sensor contact tasks always run in the same wakeup as a heart rate measurement.
  */
 static void timers_init(void)
 {
+    static tick_sched_task_t heart_rate_task =
+    {
+        .handler = heart_rate_meas_task,
+        .period  = HEART_RATE_MEAS_INTERVAL,
+    };
+    static tick_sched_task_t battery_task =
+    {
+        .handler = battery_level_meas_task,
+        .period  = BATTERY_LEVEL_MEAS_INTERVAL,
+    };
+    static tick_sched_task_t sensor_contact_task =
+    {
+        .handler = sensor_contact_detected_task,
+        .period  = SENSOR_CONTACT_DETECTED_INTERVAL,
+    };
+
     ret_code_t err_code;
 
     // Initialize timer module.
     err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
 
-    // Create timers.
-    err_code = app_timer_create(&m_battery_timer_id,
-                                APP_TIMER_MODE_REPEATED,
-                                battery_level_meas_timeout_handler);
+    // Initialize the scheduler and add the sensor tasks.
+    err_code = tick_sched_init();
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_create(&m_heart_rate_timer_id,
-                                APP_TIMER_MODE_REPEATED,
-                                heart_rate_meas_timeout_handler);
+    err_code = tick_sched_task_add(&heart_rate_task);
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_create(&m_rr_interval_timer_id,
-                                APP_TIMER_MODE_REPEATED,
-                                rr_interval_timeout_handler);
+    err_code = tick_sched_task_add(&battery_task);
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_create(&m_sensor_contact_timer_id,
-                                APP_TIMER_MODE_REPEATED,
-                                sensor_contact_detected_timeout_handler);
+    err_code = tick_sched_task_add(&sensor_contact_task);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -559,17 +916,8 @@ static void application_timers_start(void)
 {
     ret_code_t err_code;
 
-    // Start application timers.
-    err_code = app_timer_start(m_battery_timer_id, BATTERY_LEVEL_MEAS_INTERVAL, NULL);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = app_timer_start(m_heart_rate_timer_id, HEART_RATE_MEAS_INTERVAL, NULL);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = app_timer_start(m_rr_interval_timer_id, RR_INTERVAL_INTERVAL, NULL);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = app_timer_start(m_sensor_contact_timer_id, SENSOR_CONTACT_DETECTED_INTERVAL, NULL);
+    // Start the sensor tasks.
+    err_code = tick_sched_start();
     APP_ERROR_CHECK(err_code);
 }
 
@@ -629,6 +977,44 @@ static void conn_params_init(void)
 }
 
 
+/**@brief Function for handling connection profile changes.
+ *
+ * @param[in] p_profile  Connection profile instance.
+ * @param[in] id         Profile now active.
+ */
+static void on_conn_profile_evt(ble_conn_profile_t * p_profile, ble_conn_profile_id_t id)
+{
+    UNUSED_PARAMETER(p_profile);
+
+    NRF_LOG_INFO("Connection profile: %s.", (id == BLE_CONN_PROFILE_BULK) ? "bulk" : "idle");
+}
+
+
+/**@brief Function for initializing the connection profile switching.
+ *
+ * @details The link runs in the idle profile until the RR interval backlog reaches
+ *          BULK_ENTER_LEVEL, then moves to the bulk profile and drains it with back-to-back
+ *          notifications.
+ */
+static void conn_profile_init(void)
+{
+    ret_code_t              err_code;
+    ble_conn_profile_init_t init;
+
+    memset(&init, 0, sizeof(init));
+
+    init.p_idle           = &m_idle_profile;
+    init.p_bulk           = &m_bulk_profile;
+    init.bulk_enter_level = BULK_ENTER_LEVEL;
+    init.bulk_exit_level  = BULK_EXIT_LEVEL;
+    init.idle_delay       = BULK_IDLE_DELAY;
+    init.evt_handler      = on_conn_profile_evt;
+
+    err_code = ble_conn_profile_init(&m_conn_profile, &init);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for putting the chip into sleep mode.
  *
  * @note This function will not return.
@@ -644,31 +1030,41 @@ static void sleep_mode_enter(void)
     err_code = bsp_btn_ble_sleep_mode_prepare();
     APP_ERROR_CHECK(err_code);
 
+#if BATTERY_SAADC_ENABLED
+    m_retained_gauge.data = m_battery_gauge;
+    RETAINED_STORE(m_retained_gauge, RETAINED_VERSION);
+#endif
+
+    // Keep the retained records powered, and only those, for the next boot.
+    err_code = retained_ram_retain();
+    APP_ERROR_CHECK(err_code);
+
     // Go to system-off mode (this function will not return; wakeup will cause a reset).
+    // With APP_NFC_WAKE_ENABLED the NFCT peripheral stays in sense mode, so a tap also wakes the chip.
     err_code = sd_power_system_off();
     APP_ERROR_CHECK(err_code);
 }
 
 
-/**@brief Function for handling advertising events.
+/**@brief Function for handling tiered advertising events.
  *
- * @details This function will be called for advertising events which are passed to the application.
- *
- * @param[in] ble_adv_evt  Advertising event.
+ * @param[in] p_tiers  Tiered advertising instance.
+ * @param[in] p_evt    Event.
  */
-static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
+static void adv_tiers_evt_handler(ble_adv_tiers_t * p_tiers, ble_adv_tiers_evt_t const * p_evt)
 {
     ret_code_t err_code;
 
-    switch (ble_adv_evt)
+    switch (p_evt->type)
     {
-        case BLE_ADV_EVT_FAST:
-            NRF_LOG_INFO("Fast advertising.");
-            err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+        case BLE_ADV_TIERS_EVT_TIER:
+            NRF_LOG_INFO("Advertising in tier %d.", p_evt->tier);
+            err_code = bsp_indication_set((p_evt->tier == 0) ? BSP_INDICATE_ADVERTISING
+                                                             : BSP_INDICATE_ADVERTISING_SLOW);
             APP_ERROR_CHECK(err_code);
             break;
 
-        case BLE_ADV_EVT_IDLE:
+        case BLE_ADV_TIERS_EVT_IDLE:
             sleep_mode_enter();
             break;
 
@@ -678,6 +1074,21 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 }
 
 
+/**@brief Function for logging the time and charge spent in each advertising tier.
+ */
+static void adv_tiers_report(void)
+{
+    ble_adv_tiers_stats_t stats;
+
+    for (uint8_t tier = 0; tier < ARRAY_SIZE(m_adv_tier); tier++)
+    {
+        ble_adv_tiers_stats_get(&m_adv_tiers, tier, &stats);
+        NRF_LOG_INFO("Advertising tier %d: %d ms, %d events, %d uC.",
+                     tier, stats.time_ms, stats.events, stats.charge_uc);
+    }
+}
+
+
 /**@brief Function for handling BLE events.
  *
  * @param[in]   p_ble_evt   Bluetooth stack event.
@@ -690,31 +1101,47 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_CONNECTED:
-            NRF_LOG_INFO("Connected.");
+            NRF_LOG_INFO("Connected, %d RR intervals pending (%d overwritten).",
+                         hrm_batch_pending(),
+                         hrm_batch_overwritten_count());
             err_code = bsp_indication_set(BSP_INDICATE_CONNECTED);
             APP_ERROR_CHECK(err_code);
+            adv_tiers_report();
             m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
             err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
             APP_ERROR_CHECK(err_code);
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
+        {
+            tick_sched_stats_t stats;
+
             NRF_LOG_INFO("Disconnected, reason %d.",
                           p_ble_evt->evt.gap_evt.params.disconnected.reason);
+
+            tick_sched_stats_get(&stats);
+            NRF_LOG_INFO("Sensor tasks: %d runs in %d wakeups (%d coalesced).",
+                         stats.task_runs, stats.wakeups, stats.coalesced);
             m_conn_handle = BLE_CONN_HANDLE_INVALID;
-            break;
+
+#if !APP_NFC_WAKE_ENABLED
+            adv_tiers_restart(true);
+#endif
+        } break;
 
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
-        {
+            // Answered by the connection profile module with the PHYs of the active profile.
             NRF_LOG_DEBUG("PHY update request.");
-            ble_gap_phys_t const phys =
+            break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            // In the bulk profile, keep the SoftDevice queue busy until the RR backlog is drained.
+            if ((ble_conn_profile_active_get(&m_conn_profile) == BLE_CONN_PROFILE_BULK) &&
+                (hrm_batch_pending() > 0))
             {
-                .rx_phys = BLE_GAP_PHY_AUTO,
-                .tx_phys = BLE_GAP_PHY_AUTO,
-            };
-            err_code = sd_ble_gap_phy_update(p_ble_evt->evt.gap_evt.conn_handle, &phys);
-            APP_ERROR_CHECK(err_code);
-        } break;
+                heart_rate_measurement_send();
+            }
+            break;
 
         case BLE_GATTC_EVT_TIMEOUT:
             // Disconnect on GATT Client timeout event.
@@ -737,11 +1164,18 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             break;
         
         case BLE_GAP_EVT_AUTH_KEY_REQUEST:
+            // OOB keys are answered by the nfc_oob_wake module.
             NRF_LOG_INFO("BLE_GAP_EVT_AUTH_KEY_REQUEST");
             break;
 
         case BLE_GAP_EVT_LESC_DHKEY_REQUEST:
+            // The DHKey is computed by nrf_ble_lesc_request_handler() in the main loop.
             NRF_LOG_INFO("BLE_GAP_EVT_LESC_DHKEY_REQUEST");
+            m_lesc_keys_used = true;
+#if APP_NFC_WAKE_ENABLED
+            // The tag is refreshed once the new key pair is generated, not on disconnection.
+            nfc_oob_wake_refresh_defer();
+#endif
             break;
 
          case BLE_GAP_EVT_AUTH_STATUS:
@@ -781,6 +1215,9 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // Lowest RAM start for this SoftDevice configuration; read by tools/nrf_ram_layout.
+    NRF_LOG_INFO("Application RAM can start at 0x%x.", ram_start);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
@@ -810,13 +1247,10 @@ void bsp_event_handler(bsp_event_t event)
             break;
 
         case BSP_EVENT_WHITELIST_OFF:
+            // No whitelist is used; the button returns advertising to the fast tier.
             if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
             {
-                err_code = ble_advertising_restart_without_whitelist(&m_advertising);
-                if (err_code != NRF_ERROR_INVALID_STATE)
-                {
-                    APP_ERROR_CHECK(err_code);
-                }
+                adv_tiers_restart(false);
             }
             break;
 
@@ -864,28 +1298,48 @@ static void peer_manager_init(void)
  */
 static void advertising_init(void)
 {
-    ret_code_t             err_code;
-    ble_advertising_init_t init;
+    ret_code_t           err_code;
+    ble_advdata_t        advdata;
+    ble_adv_tiers_init_t tiers_init;
 
-    memset(&init, 0, sizeof(init));
+    memset(&advdata, 0, sizeof(advdata));
 
-    init.advdata.name_type               = BLE_ADVDATA_FULL_NAME;
-    init.advdata.include_appearance      = true;
-    init.advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-    init.advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
-    init.advdata.uuids_complete.p_uuids  = m_adv_uuids;
+    advdata.name_type               = BLE_ADVDATA_FULL_NAME;
+    advdata.include_appearance      = true;
+    advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+    advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+    advdata.uuids_complete.p_uuids  = m_adv_uuids;
 
-    init.config.ble_adv_fast_enabled  = true;
-    init.config.ble_adv_fast_interval = APP_ADV_INTERVAL;
-    init.config.ble_adv_fast_timeout  = APP_ADV_DURATION;
+    err_code = ble_advdata_encode(&advdata, m_adv_data.adv_data.p_data, &m_adv_data.adv_data.len);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&tiers_init, 0, sizeof(tiers_init));
 
-    init.evt_handler = on_adv_evt;
+    tiers_init.p_adv_data      = &m_adv_data;
+    tiers_init.p_tier          = m_adv_tier;
+    tiers_init.tier_count      = ARRAY_SIZE(m_adv_tier);
+    tiers_init.conn_cfg_tag    = APP_BLE_CONN_CFG_TAG;
+    tiers_init.event_charge_nc = APP_ADV_EVENT_CHARGE_NC;
+    tiers_init.evt_handler     = adv_tiers_evt_handler;
 
-    err_code = ble_advertising_init(&m_advertising, &init);
+    err_code = ble_adv_tiers_init(&m_adv_tiers, &tiers_init);
     APP_ERROR_CHECK(err_code);
+}
+
+
+#if APP_NFC_WAKE_ENABLED
+/**@brief Function for initializing the NFC tag.
+ *
+ * @details Must run after the Peer Manager, which generates the LESC key pair.
+ */
+static void nfc_wake_init(void)
+{
+    ret_code_t err_code;
 
-    ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
+    err_code = nfc_oob_wake_init(nfc_field_handler);
+    APP_ERROR_CHECK(err_code);
 }
+#endif
 
 
 /**@brief Function for initializing buttons and leds.
@@ -914,7 +1368,12 @@ static void log_init(void)
     ret_code_t err_code = NRF_LOG_INIT(NULL);
     APP_ERROR_CHECK(err_code);
 
+#if NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN)
+    err_code = nrf_log_backend_bin_init();
+    APP_ERROR_CHECK(err_code);
+#else
     NRF_LOG_DEFAULT_BACKENDS_INIT();
+#endif
 }
 
 
@@ -928,9 +1387,71 @@ static void power_management_init(void)
 }
 
 
+/**@brief Function for replacing the LESC key pair once it has been used in a pairing.
+ *
+ * @details The Peer Manager generates the first key pair at init, before any peer can pair. A new
+ *          one is generated here, in the main loop, after the link on which the key pair was used
+ *          is down. Every interrupt, including SoftDevice events and the sensor tasks, preempts
+ *          the computation. Advertising requested meanwhile is started once the key pair is ready.
+ */
+static void lesc_keys_refresh(void)
+{
+    ret_code_t err_code;
+    bool       adv_start;
+    bool       adv_open;
+
+    if (!m_lesc_keys_used || (m_conn_handle != BLE_CONN_HANDLE_INVALID))
+    {
+        return;
+    }
+
+    err_code = nrf_ble_lesc_keypair_generate();
+    APP_ERROR_CHECK(err_code);
+    NRF_LOG_INFO("New LESC key pair generated.");
+
+#if APP_NFC_WAKE_ENABLED
+    // The confirmation value on the tag depends on the public key.
+    nfc_oob_wake_refresh();
+#endif
+
+    // Only the flags are handled with interrupts masked. While m_adv_restarting is set, a request
+    // from an interrupt is deferred again instead of restarting advertising in the middle of the
+    // restart made here. If the new key pair is used before the requests are drained, the rest
+    // waits for the next refresh.
+    CRITICAL_REGION_ENTER();
+    m_lesc_keys_used = false;
+    m_adv_restarting = true;
+    CRITICAL_REGION_EXIT();
+
+    for (;;)
+    {
+        CRITICAL_REGION_ENTER();
+        adv_start = m_adv_deferred && !m_lesc_keys_used;
+        adv_open  = m_adv_deferred_open;
+        if (adv_start)
+        {
+            m_adv_deferred      = false;
+            m_adv_deferred_open = false;
+        }
+        else
+        {
+            m_adv_restarting = false;
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (!adv_start)
+        {
+            break;
+        }
+        adv_tiers_restart_now(!adv_open);
+    }
+}
+
+
 /**@brief Function for handling the idle state (main loop).
  *
- * @details If there is no pending log operation, then sleep until next the next event occurs.
+ * @details Runs the LESC computations, which take tens of milliseconds, at the lowest priority.
+ *          If there is no pending log operation, then sleep until next the next event occurs.
  */
 static void idle_state_handle(void)
 {
@@ -939,9 +1460,13 @@ static void idle_state_handle(void)
     err_code = nrf_ble_lesc_request_handler();
     APP_ERROR_CHECK(err_code);
 
+    lesc_keys_refresh();
+
     if (NRF_LOG_PROCESS() == false)
     {
+        energy_phase_t phase = energy_marker_begin(ENERGY_PHASE_SLEEP);
         nrf_pwr_mgmt_run();
+        energy_marker_end(phase);
     }
 }
 
@@ -953,21 +1478,34 @@ int main(void)
     bool erase_bonds;
 
     // Initialize.
+    retained_init();
     log_init();
     timers_init();
     buttons_leds_init(&erase_bonds);
     power_management_init();
     ble_stack_init();
+    energy_marker_init();
     gap_params_init();
     gatt_init();
     advertising_init();
     services_init();
     sensor_simulator_init();
+#if BATTERY_SAADC_ENABLED
+    battery_saadc_init();
+#endif
     conn_params_init();
+    conn_profile_init();
     peer_manager_init();
+#if APP_NFC_WAKE_ENABLED
+    nfc_wake_init();
+#endif
 
     // Start execution.
     NRF_LOG_INFO("Heart Rate Sensor example started.");
+    if (retained_wakeup_from_off())
+    {
+        NRF_LOG_INFO("Woken from System OFF, reset reason 0x%08x.", retained_reset_reason_get());
+    }
     application_timers_start();
     advertising_start(erase_bonds);
 
@@ -0,0 +1,277 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "nfc_oob_wake.h"
+
+#include <stdbool.h>
+#include "nfc_t2t_lib.h"
+#include "nfc_ble_pair_msg.h"
+#include "nrf_ble_lesc.h"
+#include "nrf_sdh_ble.h"
+#include "nrf_soc.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "sdk_macros.h"
+
+#define NFC_OOB_WAKE_MSG_BUF_SIZE   256     /**< Size of the NDEF message buffer; a full LE OOB message takes about 100 bytes. */
+
+NRF_SDH_BLE_OBSERVER(m_nfc_oob_wake_obs, NFC_OOB_WAKE_BLE_OBSERVER_PRIO, nfc_oob_wake_on_ble_evt, NULL);
+
+static nfc_oob_wake_handler_t m_field_handler;                          /**< Application tap handler; NULL until the module is initialized. */
+static uint8_t                m_ndef_msg_buf[NFC_OOB_WAKE_MSG_BUF_SIZE]; /**< Encoded Connection Handover message. */
+static ble_advdata_tk_value_t m_tk;                                     /**< Temporary Key for LE legacy OOB pairing, as written into the tag. */
+
+/* The NFCT interrupt and the SoftDevice event handler both run at priority 6 and never preempt
+ * each other. The main loop only tests and sets the flags in a critical region, and replaces the
+ * OOB data with m_refresh_busy set, outside of it. */
+static volatile bool          m_field_on;                               /**< A reader field is present. */
+static volatile bool          m_refresh_pending;                        /**< New OOB data is due once the field goes off. */
+static volatile bool          m_refresh_busy;                           /**< The main loop is replacing the OOB data. */
+static bool                   m_refresh_deferred;                       /**< The application refreshes the OOB data after the next disconnection. */
+
+
+/**@brief Function for filling the Temporary Key from the SoftDevice random pool.
+ */
+static ret_code_t tk_generate(void)
+{
+    ret_code_t err_code;
+    uint8_t    available;
+
+    do
+    {
+        err_code = sd_rand_application_bytes_available_get(&available);
+        VERIFY_SUCCESS(err_code);
+    } while (available < sizeof(m_tk.tk));
+
+    return sd_rand_application_vector_get(m_tk.tk, sizeof(m_tk.tk));
+}
+
+
+/**@brief Function for generating new OOB values and making them the tag payload.
+ *
+ * @details Emulation must be stopped.
+ */
+static ret_code_t oob_payload_set(void)
+{
+    ret_code_t err_code;
+    uint32_t   len = sizeof(m_ndef_msg_buf);
+
+    err_code = tk_generate();
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_ble_lesc_own_oob_data_generate();
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nfc_ble_pair_default_msg_encode(NFC_BLE_PAIR_MSG_BLUETOOTH_LE_SHORT,
+                                               &m_tk,
+                                               nrf_ble_lesc_own_oob_data_get(),
+                                               m_ndef_msg_buf,
+                                               &len);
+    VERIFY_SUCCESS(err_code);
+
+    return nfc_t2t_payload_set(m_ndef_msg_buf, len);
+}
+
+
+/**@brief Function for replacing the OOB data of a running tag.
+ *
+ * @details Only called while no reader field is present.
+ */
+static ret_code_t oob_payload_refresh(void)
+{
+    ret_code_t err_code;
+
+    m_refresh_pending = false;
+
+    err_code = nfc_t2t_emulation_stop();
+    VERIFY_SUCCESS(err_code);
+
+    err_code = oob_payload_set();
+    VERIFY_SUCCESS(err_code);
+
+    return nfc_t2t_emulation_start();
+}
+
+
+/**@brief Function for refreshing the OOB data now, or once the reader field is gone.
+ */
+static void refresh_request(void)
+{
+    ret_code_t err_code;
+
+    if (m_field_on || m_refresh_busy)
+    {
+        m_refresh_pending = true;
+    }
+    else
+    {
+        err_code = oob_payload_refresh();
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for handling NFC events.
+ */
+static void nfc_callback(void * p_context, nfc_t2t_event_t event, uint8_t const * p_data, size_t data_length)
+{
+    ret_code_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(data_length);
+
+    switch (event)
+    {
+        case NFC_T2T_EVENT_FIELD_ON:
+            m_field_on = true;
+            m_field_handler();
+            break;
+
+        case NFC_T2T_EVENT_FIELD_OFF:
+            m_field_on = false;
+            if (m_refresh_pending && !m_refresh_busy)
+            {
+                err_code = oob_payload_refresh();
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t nfc_oob_wake_init(nfc_oob_wake_handler_t field_handler)
+{
+    ret_code_t err_code;
+
+    VERIFY_PARAM_NOT_NULL(field_handler);
+
+    err_code = nfc_t2t_setup(nfc_callback, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = oob_payload_set();
+    VERIFY_SUCCESS(err_code);
+
+    m_field_handler = field_handler;
+
+    return nfc_t2t_emulation_start();
+}
+
+
+void nfc_oob_wake_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ret_code_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    if (m_field_handler == NULL)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_AUTH_KEY_REQUEST:
+            if (p_ble_evt->evt.gap_evt.params.auth_key_request.key_type == BLE_GAP_AUTH_KEY_TYPE_OOB)
+            {
+                err_code = sd_ble_gap_auth_key_reply(p_ble_evt->evt.gap_evt.conn_handle,
+                                                     BLE_GAP_AUTH_KEY_TYPE_OOB,
+                                                     m_tk.tk);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            // The values just used must not be accepted again.
+            if (m_refresh_deferred)
+            {
+                m_refresh_deferred = false;
+            }
+            else
+            {
+                refresh_request();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void nfc_oob_wake_refresh(void)
+{
+    ret_code_t err_code;
+    bool       run;
+
+    if (m_field_handler == NULL)
+    {
+        return;
+    }
+
+    // Only the flags are handled with interrupts masked. While the OOB data is replaced, a
+    // refresh requested by the NFCT or BLE event handlers is left pending and made afterwards.
+    do
+    {
+        CRITICAL_REGION_ENTER();
+        run = !m_field_on;
+        if (run)
+        {
+            m_refresh_busy = true;
+        }
+        else
+        {
+            m_refresh_pending = true;
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (!run)
+        {
+            return;
+        }
+
+        err_code = oob_payload_refresh();
+        APP_ERROR_CHECK(err_code);
+
+        CRITICAL_REGION_ENTER();
+        m_refresh_busy = false;
+        run = m_refresh_pending && !m_field_on;
+        CRITICAL_REGION_EXIT();
+    } while (run);
+}
+
+
+void nfc_oob_wake_refresh_defer(void)
+{
+    m_refresh_deferred = true;
+}
@@ -0,0 +1,121 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup nfc_oob_wake NFC tap to advertise, with OOB pairing data
+ * @{
+ * @brief Keeps the radio off until a phone reads the NFC tag, then hands it the pairing data.
+ *
+ * @details The NFCT peripheral is left in sense mode, which draws next to nothing and also works
+ *          as a wakeup source from System OFF. The tag carries a Bluetooth LE Connection Handover
+ *          message (@ref NFC_BLE_PAIR_MSG_BLUETOOTH_LE_SHORT) with the device address and name,
+ *          the LE Secure Connections confirmation and random values and a Temporary Key for LE
+ *          legacy OOB pairing. A phone that reads it connects to us and pairs with the OOB method,
+ *          so the pairing gets MITM protection although the device has no I/O capabilities.
+ *
+ *          The application is told about every tap through the handler given at init and starts
+ *          advertising from there. After each disconnection new OOB values are generated, so a
+ *          message read once cannot be reused. The T2T library takes a new payload only while
+ *          emulation is stopped; if a reader is present at that point the update waits for
+ *          @ref NFC_T2T_EVENT_FIELD_OFF, so a reader never sees a tag that stops responding.
+ *
+ * @note    The LESC key pair must exist before @ref nfc_oob_wake_init is called, that is after
+ *          the Peer Manager is initialized, and the device name must have been set. The Peer
+ *          Manager security parameters must have the OOB flag set for legacy OOB pairing.
+ */
+#ifndef NFC_OOB_WAKE_H__
+#define NFC_OOB_WAKE_H__
+
+#include "ble.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NFC_OOB_WAKE_BLE_OBSERVER_PRIO
+#define NFC_OOB_WAKE_BLE_OBSERVER_PRIO  2   /**< Priority of the module's BLE event observer. */
+#endif
+
+/**@brief NFC field handler type.
+ *
+ * @details Called from the NFCT interrupt (NFCT_CONFIG_IRQ_PRIORITY) each time a reader field
+ *          is detected.
+ */
+typedef void (*nfc_oob_wake_handler_t)(void);
+
+
+/**@brief Function for generating the OOB data, encoding it into the tag and starting tag emulation.
+ *
+ * @param[in] field_handler  Handler called on every tap. Can not be NULL.
+ *
+ * @retval NRF_SUCCESS     Emulation was started.
+ * @retval NRF_ERROR_NULL  No handler was given.
+ * @return Other error codes returned by the LESC module, the NDEF encoder or the T2T library.
+ */
+ret_code_t nfc_oob_wake_init(nfc_oob_wake_handler_t field_handler);
+
+
+/**@brief Function for generating new OOB data and encoding it into the tag.
+ *
+ * @details Must be called whenever the LESC key pair changes, since the confirmation value on
+ *          the tag is derived from the public key. If a reader is present, the update is made
+ *          once it leaves. Can be called from the main loop.
+ */
+void nfc_oob_wake_refresh(void);
+
+
+/**@brief Function for leaving out the refresh made on the next disconnection.
+ *
+ * @details For an application that calls @ref nfc_oob_wake_refresh after that disconnection
+ *          anyway, such as when it replaces a LESC key pair used in the pairing, so the tag is
+ *          not rewritten twice. Until then the tag keeps the values just used. Called from the
+ *          SoftDevice event handler, during the connection.
+ */
+void nfc_oob_wake_refresh_defer(void);
+
+
+/**@brief Function for handling BLE events. Registered by the module itself.
+ *
+ * @details Answers OOB Temporary Key requests and refreshes the OOB data on disconnection.
+ *
+ * @param[in] p_ble_evt  BLE event.
+ * @param[in] p_context  Unused.
+ */
+void nfc_oob_wake_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NFC_OOB_WAKE_H__
+
+/** @} */
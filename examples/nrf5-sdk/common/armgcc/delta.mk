@@ -0,0 +1,23 @@
+# Delta images for field updates. Included by the armgcc/Makefile of the
+# examples that run the SoftDevice, after Makefile.common.
+#
+# A delta rebuilds the new application from the release already on the
+# device, so it is sent instead of the full image when only a few kB changed.
+# The base is the merged hex of that release, by default the one in hex/:
+#
+#   make delta                          delta of the last build against hex/$(PROJECT_NAME).hex
+#   make delta DELTA_BASE=old.hex       delta against another release
+#   make delta-check                    rebuild the image from the delta and compare
+#
+# Applying on the device is done by ../common/delta_apply.c.
+
+DELTA_TOOL := python3 $(MDK_ROOT)/tools/nrf_delta/nrf_delta.py
+DELTA_BASE ?= $(PROJ_DIR)/hex/$(PROJECT_NAME).hex
+
+.PHONY: delta delta-check
+
+delta:
+	$(foreach target, $(TARGETS), $(DELTA_TOOL) make $(DELTA_BASE) $(OUTPUT_DIRECTORY)/$(target).hex -o $(OUTPUT_DIRECTORY)/$(target).delta;)
+
+delta-check:
+	$(foreach target, $(TARGETS), $(DELTA_TOOL) check $(DELTA_BASE) $(OUTPUT_DIRECTORY)/$(target).hex $(OUTPUT_DIRECTORY)/$(target).delta;)
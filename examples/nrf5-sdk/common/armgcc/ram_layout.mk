@@ -0,0 +1,26 @@
+# RAM layout targets for the examples that run the SoftDevice. Included by
+# their armgcc/Makefile after Makefile.common.
+#
+# The lowest RAM start the SoftDevice accepts is only known to the
+# SoftDevice; the application logs it at start-up. Capture the log and run
+#
+#   make ram-layout RAM_LOG=capture.txt    (or RAM_START=0x20002a98)
+#
+# to shrink or grow the RAM region of the linker script to fit.
+#
+#   make ram-check    tell whether sdk_config.h changed since it was measured
+#   make ram-report   SoftDevice, static, heap, stack and free RAM of the build
+
+RAM_LAYOUT := python3 $(MDK_ROOT)/tools/nrf_ram_layout/nrf_ram_layout.py
+
+.PHONY: ram-layout ram-check ram-report
+
+ram-layout:
+	$(RAM_LAYOUT) set $(LINKER_SCRIPT) $(SDK_CONFIG_FILE) \
+	  $(if $(RAM_START),--ram-start $(RAM_START),--log $(RAM_LOG))
+
+ram-check:
+	-@$(RAM_LAYOUT) check $(LINKER_SCRIPT) $(SDK_CONFIG_FILE)
+
+ram-report:
+	$(foreach target, $(TARGETS), $(if $(wildcard $(OUTPUT_DIRECTORY)/$(target).map), $(RAM_LAYOUT) report $(OUTPUT_DIRECTORY)/$(target).map;))
@@ -0,0 +1,35 @@
+# Build variants shared by the nRF5 SDK examples. Included by each example's
+# armgcc/Makefile after Makefile.common and the target definitions.
+#
+# OPT_SPEED_FILES and OPT_SIZE_FILES list source file names, without their
+# directory, that are built with -O3 or -Os whatever OPT is. GCC records the
+# optimization level per function, so the overrides also hold through link
+# time optimization.
+#
+#   make release-lto   build with -Os and -flto in _build_lto, then report sizes
+#   make size-report   size by module of the build in OUTPUT_DIRECTORY
+#
+# The linker scripts KEEP every section the SDK registers items in
+# (SoftDevice observers, log, power management, ...). LTO does not need
+# anything more, since the items are also marked used.
+
+RELEASE_LTO_DIRECTORY := _build_lto
+RELEASE_LTO_OPT       := -Os -g3 -flto
+SIZE_REPORT           := python3 $(MDK_ROOT)/tools/nrf_size_report/nrf_size_report.py
+
+$(foreach target, $(TARGETS), \
+  $(foreach file, $(OPT_SPEED_FILES), \
+    $(eval $(OUTPUT_DIRECTORY)/$(target)/$(file).o: CFLAGS += -O3)) \
+  $(foreach file, $(OPT_SIZE_FILES), \
+    $(eval $(OUTPUT_DIRECTORY)/$(target)/$(file).o: CFLAGS += -Os)))
+
+.PHONY: release-lto size-report
+
+release-lto:
+	$(MAKE) --no-print-directory OPT="$(RELEASE_LTO_OPT)" OUTPUT_DIRECTORY=$(RELEASE_LTO_DIRECTORY) default
+	$(MAKE) --no-print-directory OUTPUT_DIRECTORY=$(RELEASE_LTO_DIRECTORY) size-report
+
+SIZE_REPORT_CMD = $(SIZE_REPORT) $(OUTPUT_DIRECTORY)/$(1).map --objects $(OUTPUT_DIRECTORY)/$(1) --nm $(GNU_INSTALL_ROOT)$(GNU_PREFIX)-gcc-nm
+
+size-report:
+	$(foreach target, $(TARGETS), $(if $(wildcard $(OUTPUT_DIRECTORY)/$(target).map), $(call SIZE_REPORT_CMD,$(target));))
@@ -0,0 +1,134 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "battery_gauge.h"
+
+#include <string.h>
+
+
+/**@brief Function for converting a voltage at the battery to raw SAADC units. */
+static int16_t mv_to_raw(battery_gauge_t const * p_gauge, uint16_t mv)
+{
+    return (int16_t)((((uint32_t)mv << 16) + (p_gauge->scale_q16 / 2)) / p_gauge->scale_q16);
+}
+
+
+void battery_gauge_init(battery_gauge_t * p_gauge, battery_gauge_config_t const * p_config)
+{
+    memset(p_gauge, 0, sizeof(*p_gauge));
+
+    p_gauge->scale_q16   = ((uint32_t)p_config->full_scale_mv * p_config->divider << 16)
+                           >> p_config->resolution_bits;
+    p_gauge->raw_min     = mv_to_raw(p_gauge, p_config->min_mv);
+    p_gauge->raw_max     = mv_to_raw(p_gauge, p_config->max_mv);
+    p_gauge->raw_step    = mv_to_raw(p_gauge, p_config->max_step_mv);
+    p_gauge->alpha_q15   = p_config->alpha_q15;
+    p_gauge->max_rejects = p_config->max_rejects;
+    p_gauge->empty_mv    = p_config->empty_mv;
+    p_gauge->full_mv     = p_config->full_mv;
+}
+
+
+bool battery_gauge_sample_add(battery_gauge_t * p_gauge, int16_t raw)
+{
+    int32_t const sample_q15 = (int32_t)raw << 15;
+
+    if ((raw < p_gauge->raw_min) || (raw > p_gauge->raw_max))
+    {
+        p_gauge->rejected_total++;
+        return false;
+    }
+
+    if (!p_gauge->seeded)
+    {
+        p_gauge->avg_q15 = sample_q15;
+        p_gauge->seeded  = true;
+        return true;
+    }
+
+    int32_t const delta_q15 = sample_q15 - p_gauge->avg_q15;
+
+    if ((delta_q15 > ((int32_t)p_gauge->raw_step << 15)) ||
+        (delta_q15 < -((int32_t)p_gauge->raw_step << 15)))
+    {
+        // A lasting step (charger plugged in, load switched) is real: follow it after a while.
+        p_gauge->rejected_total++;
+        if (++p_gauge->rejects >= p_gauge->max_rejects)
+        {
+            p_gauge->avg_q15 = sample_q15;
+            p_gauge->rejects = 0;
+            return true;
+        }
+        return false;
+    }
+
+    p_gauge->rejects  = 0;
+    p_gauge->avg_q15 += (int32_t)(((int64_t)delta_q15 * p_gauge->alpha_q15) >> 15);
+
+    return true;
+}
+
+
+void battery_gauge_buffer_add(battery_gauge_t * p_gauge, int16_t const * p_raw, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        (void)battery_gauge_sample_add(p_gauge, p_raw[i]);
+    }
+}
+
+
+bool battery_gauge_is_valid(battery_gauge_t const * p_gauge)
+{
+    return p_gauge->seeded;
+}
+
+
+uint16_t battery_gauge_mv_get(battery_gauge_t const * p_gauge)
+{
+    // Q15 average times Q16 scale gives millivolts in Q31.
+    return (uint16_t)(((uint64_t)p_gauge->avg_q15 * p_gauge->scale_q16 + (1UL << 30)) >> 31);
+}
+
+
+uint8_t battery_gauge_level_get(battery_gauge_t const * p_gauge)
+{
+    uint16_t const mv = battery_gauge_mv_get(p_gauge);
+
+    if (mv <= p_gauge->empty_mv)
+    {
+        return 0;
+    }
+    if (mv >= p_gauge->full_mv)
+    {
+        return 100;
+    }
+
+    return (uint8_t)(((uint32_t)(mv - p_gauge->empty_mv) * 100) / (p_gauge->full_mv - p_gauge->empty_mv));
+}
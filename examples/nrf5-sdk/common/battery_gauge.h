@@ -0,0 +1,138 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup battery_gauge Battery gauge
+ * @{
+ * @brief Fixed-point battery voltage filter fed from raw SAADC samples.
+ *
+ * @details Raw samples are checked against a plausibility window and folded into an exponential
+ *          moving average kept in Q15 fixed point. All thresholds are converted to raw SAADC
+ *          units in @ref battery_gauge_init, so @ref battery_gauge_sample_add is safe to call from
+ *          the SAADC interrupt and performs no division. Conversion to millivolts uses a scale
+ *          factor precomputed at init and is only done when the value is read.
+ */
+#ifndef BATTERY_GAUGE_H__
+#define BATTERY_GAUGE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATTERY_GAUGE_ALPHA_Q15(_num, _den)  ((uint16_t)((32768UL * (_num)) / (_den)))  /**< EMA weight of a new sample as a fraction, in Q15. */
+
+/**@brief Default configuration: LiPo cell on the Base Dock, sampled through a 1/2 divider on AIN2
+ *        with gain 1/6 and the internal 0.6 V reference at 10-bit resolution.
+ */
+#define BATTERY_GAUGE_DEFAULT_CONFIG                        \
+{                                                           \
+    .full_scale_mv   = 3600,                                \
+    .divider         = 2,                                   \
+    .resolution_bits = 10,                                  \
+    .alpha_q15       = BATTERY_GAUGE_ALPHA_Q15(1, 16),      \
+    .min_mv          = 2500,                                \
+    .max_mv          = 4500,                                \
+    .max_step_mv     = 200,                                 \
+    .max_rejects     = 8,                                   \
+    .empty_mv        = 3300,                                \
+    .full_mv         = 4200,                                \
+}
+
+/**@brief Battery gauge configuration. */
+typedef struct
+{
+    uint16_t full_scale_mv;   /**< Input voltage giving a full-scale SAADC reading (reference divided by gain). */
+    uint8_t  divider;         /**< Ratio of the external voltage divider in front of the SAADC input. */
+    uint8_t  resolution_bits; /**< SAADC resolution, in bits. */
+    uint16_t alpha_q15;       /**< Weight of a new sample in the moving average, in Q15. */
+    uint16_t min_mv;          /**< Readings below this voltage are rejected. */
+    uint16_t max_mv;          /**< Readings above this voltage are rejected. */
+    uint16_t max_step_mv;     /**< Readings further than this from the average are rejected. */
+    uint8_t  max_rejects;     /**< Consecutive step rejections after which the average is reseeded. */
+    uint16_t empty_mv;        /**< Voltage reported as 0 % battery level. */
+    uint16_t full_mv;         /**< Voltage reported as 100 % battery level. */
+} battery_gauge_config_t;
+
+/**@brief Battery gauge instance. */
+typedef struct
+{
+    int32_t  avg_q15;         /**< Moving average of the raw reading, in Q15. */
+    uint32_t scale_q16;       /**< Millivolts per raw LSB, in Q16. */
+    int16_t  raw_min;         /**< Plausibility window, in raw units. */
+    int16_t  raw_max;
+    int16_t  raw_step;
+    uint16_t alpha_q15;
+    uint8_t  max_rejects;
+    uint8_t  rejects;         /**< Consecutive step rejections. */
+    uint16_t empty_mv;
+    uint16_t full_mv;
+    uint32_t rejected_total;  /**< Number of rejected readings since init. */
+    bool     seeded;          /**< True once the first plausible reading has been seen. */
+} battery_gauge_t;
+
+/**@brief Function for initializing a battery gauge.
+ *
+ * @param[out] p_gauge   Gauge instance.
+ * @param[in]  p_config  Gauge configuration.
+ */
+void battery_gauge_init(battery_gauge_t * p_gauge, battery_gauge_config_t const * p_config);
+
+/**@brief Function for adding one raw SAADC reading.
+ *
+ * @param[in,out] p_gauge  Gauge instance.
+ * @param[in]     raw      Raw SAADC reading.
+ *
+ * @retval true   If the reading was accepted.
+ * @retval false  If the reading was rejected by the plausibility filter.
+ */
+bool battery_gauge_sample_add(battery_gauge_t * p_gauge, int16_t raw);
+
+/**@brief Function for adding a buffer of raw SAADC readings. */
+void battery_gauge_buffer_add(battery_gauge_t * p_gauge, int16_t const * p_raw, uint16_t count);
+
+/**@brief Function for checking if the gauge holds a valid reading. */
+bool battery_gauge_is_valid(battery_gauge_t const * p_gauge);
+
+/**@brief Function for getting the filtered battery voltage, in millivolts. */
+uint16_t battery_gauge_mv_get(battery_gauge_t const * p_gauge);
+
+/**@brief Function for getting the battery level, in percent, for the Battery Service. */
+uint8_t battery_gauge_level_get(battery_gauge_t const * p_gauge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BATTERY_GAUGE_H__
+
+/** @} */
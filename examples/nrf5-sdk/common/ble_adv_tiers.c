@@ -0,0 +1,294 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "ble_adv_tiers.h"
+
+#include <string.h>
+#include "app_timer.h"
+#include "app_error.h"
+#include "nordic_common.h"
+#include "sdk_macros.h"
+
+#define TIMER_TICKS_PER_SECOND  (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+
+
+/**@brief Function for adding the part of the running period that has elapsed to the current tier.
+ */
+static void segment_account(ble_adv_tiers_t * p_tiers)
+{
+    uint32_t ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), p_tiers->segment_start);
+    uint32_t ms    = (uint32_t)(((uint64_t)ticks * 1000) / TIMER_TICKS_PER_SECOND);
+
+    p_tiers->time_ms[p_tiers->current] += MIN(ms, p_tiers->segment * 10);
+}
+
+
+/**@brief Function for starting the next advertising period of the current tier.
+ */
+static ret_code_t segment_start(ble_adv_tiers_t * p_tiers)
+{
+    ble_adv_tier_t const * p_tier = &p_tiers->p_tier[p_tiers->current];
+    ble_gap_adv_params_t   adv_params;
+    uint32_t               segment;
+    ret_code_t             err_code;
+
+    segment = ((p_tier->duration == 0) || (p_tiers->remaining > BLE_ADV_TIERS_SEGMENT_MAX))
+              ? BLE_ADV_TIERS_SEGMENT_MAX
+              : p_tiers->remaining;
+
+    memset(&adv_params, 0, sizeof(adv_params));
+
+    adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
+    adv_params.duration        = segment;
+    adv_params.properties.type = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
+    adv_params.p_peer_addr     = NULL;
+    adv_params.filter_policy   = p_tiers->filter_policy;
+    adv_params.interval        = p_tier->interval;
+
+    err_code = sd_ble_gap_adv_set_configure(&p_tiers->adv_handle, p_tiers->p_adv_data, &adv_params);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = sd_ble_gap_adv_start(p_tiers->adv_handle, p_tiers->conn_cfg_tag);
+    VERIFY_SUCCESS(err_code);
+
+    if (p_tier->duration != 0)
+    {
+        p_tiers->remaining -= segment;
+    }
+    p_tiers->segment       = segment;
+    p_tiers->segment_start = app_timer_cnt_get();
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for entering a tier and reporting it.
+ */
+static ret_code_t tier_enter(ble_adv_tiers_t * p_tiers, uint8_t tier)
+{
+    ret_code_t err_code;
+
+    p_tiers->current   = tier;
+    p_tiers->remaining = p_tiers->p_tier[tier].duration;
+
+    err_code = segment_start(p_tiers);
+    if (err_code != NRF_SUCCESS)
+    {
+        p_tiers->current = BLE_ADV_TIERS_IDLE;
+        return err_code;
+    }
+
+    if (p_tiers->evt_handler != NULL)
+    {
+        ble_adv_tiers_evt_t const evt = {.type = BLE_ADV_TIERS_EVT_TIER, .tier = tier};
+
+        p_tiers->evt_handler(p_tiers, &evt);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for handling the end of an advertising period.
+ */
+static void on_timeout(ble_adv_tiers_t * p_tiers)
+{
+    uint8_t const tier = p_tiers->current;
+
+    p_tiers->time_ms[tier] += p_tiers->segment * 10;
+
+    if ((p_tiers->p_tier[tier].duration == 0) || (p_tiers->remaining > 0))
+    {
+        APP_ERROR_CHECK(segment_start(p_tiers));
+    }
+    else if (tier + 1 < p_tiers->tier_count)
+    {
+        APP_ERROR_CHECK(tier_enter(p_tiers, tier + 1));
+    }
+    else
+    {
+        p_tiers->current = BLE_ADV_TIERS_IDLE;
+
+        if (p_tiers->evt_handler != NULL)
+        {
+            ble_adv_tiers_evt_t const evt = {.type = BLE_ADV_TIERS_EVT_IDLE, .tier = BLE_ADV_TIERS_IDLE};
+
+            p_tiers->evt_handler(p_tiers, &evt);
+        }
+    }
+}
+
+
+ret_code_t ble_adv_tiers_init(ble_adv_tiers_t * p_tiers, ble_adv_tiers_init_t const * p_init)
+{
+    ble_gap_adv_params_t adv_params;
+
+    VERIFY_PARAM_NOT_NULL(p_init->p_adv_data);
+    VERIFY_PARAM_NOT_NULL(p_init->p_tier);
+
+    if ((p_init->tier_count == 0) || (p_init->tier_count > BLE_ADV_TIERS_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memset(p_tiers, 0, sizeof(*p_tiers));
+
+    p_tiers->p_tier          = p_init->p_tier;
+    p_tiers->tier_count      = p_init->tier_count;
+    p_tiers->conn_cfg_tag    = p_init->conn_cfg_tag;
+    p_tiers->adv_handle      = BLE_GAP_ADV_SET_HANDLE_NOT_SET;
+    p_tiers->current         = BLE_ADV_TIERS_IDLE;
+    p_tiers->event_charge_nc = p_init->event_charge_nc;
+    p_tiers->evt_handler     = p_init->evt_handler;
+    p_tiers->p_adv_data      = p_init->p_adv_data;
+    p_tiers->filter_policy   = BLE_GAP_ADV_FP_ANY;
+
+    // Configure the set once to get its handle and have the data checked right away.
+    memset(&adv_params, 0, sizeof(adv_params));
+
+    adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
+    adv_params.duration        = BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED;
+    adv_params.properties.type = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
+    adv_params.p_peer_addr     = NULL;
+    adv_params.filter_policy   = BLE_GAP_ADV_FP_ANY;
+    adv_params.interval        = p_tiers->p_tier[0].interval;
+
+    return sd_ble_gap_adv_set_configure(&p_tiers->adv_handle, p_tiers->p_adv_data, &adv_params);
+}
+
+
+ret_code_t ble_adv_tiers_start(ble_adv_tiers_t * p_tiers)
+{
+    ret_code_t err_code = ble_adv_tiers_stop(p_tiers);
+    VERIFY_SUCCESS(err_code);
+
+    return tier_enter(p_tiers, 0);
+}
+
+
+void ble_adv_tiers_filter_policy_set(ble_adv_tiers_t * p_tiers, uint8_t filter_policy)
+{
+    p_tiers->filter_policy = filter_policy;
+}
+
+
+ret_code_t ble_adv_tiers_stop(ble_adv_tiers_t * p_tiers)
+{
+    ret_code_t err_code;
+
+    if (p_tiers->current == BLE_ADV_TIERS_IDLE)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // NRF_ERROR_INVALID_STATE: the period ended and its event is still pending; it must not
+    // be taken for the end of the period started next.
+    err_code = sd_ble_gap_adv_stop(p_tiers->adv_handle);
+    if (err_code == NRF_ERROR_INVALID_STATE)
+    {
+        p_tiers->stale_timeouts++;
+    }
+    else if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    segment_account(p_tiers);
+    p_tiers->current = BLE_ADV_TIERS_IDLE;
+
+    return NRF_SUCCESS;
+}
+
+
+uint8_t ble_adv_tiers_current_get(ble_adv_tiers_t const * p_tiers)
+{
+    return p_tiers->current;
+}
+
+
+void ble_adv_tiers_stats_get(ble_adv_tiers_t const * p_tiers, uint8_t tier, ble_adv_tiers_stats_t * p_stats)
+{
+    memset(p_stats, 0, sizeof(*p_stats));
+
+    if (tier >= p_tiers->tier_count)
+    {
+        return;
+    }
+
+    // One event per interval (0.625 ms units, so 5/8 ms each). The SoftDevice adds a random
+    // delay of up to 10 ms to every interval, so this is an upper bound.
+    p_stats->time_ms   = p_tiers->time_ms[tier];
+    p_stats->events    = (uint32_t)(((uint64_t)p_stats->time_ms * 8) / (p_tiers->p_tier[tier].interval * 5));
+    p_stats->charge_uc = (uint32_t)(((uint64_t)p_stats->events * p_tiers->event_charge_nc) / 1000);
+}
+
+
+void ble_adv_tiers_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_adv_tiers_t * p_tiers = p_context;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            if (p_ble_evt->evt.gap_evt.params.connected.adv_handle != p_tiers->adv_handle)
+            {
+                break;
+            }
+            if (p_tiers->stale_timeouts > 0)
+            {
+                // A stopped period ended with a connection rather than a timeout.
+                p_tiers->stale_timeouts--;
+            }
+            if (p_tiers->current != BLE_ADV_TIERS_IDLE)
+            {
+                segment_account(p_tiers);
+                p_tiers->current = BLE_ADV_TIERS_IDLE;
+            }
+            break;
+
+        case BLE_GAP_EVT_ADV_SET_TERMINATED:
+            if ((p_ble_evt->evt.gap_evt.params.adv_set_terminated.adv_handle == p_tiers->adv_handle) &&
+                (p_ble_evt->evt.gap_evt.params.adv_set_terminated.reason ==
+                 BLE_GAP_EVT_ADV_SET_TERMINATED_REASON_TIMEOUT))
+            {
+                if (p_tiers->stale_timeouts > 0)
+                {
+                    p_tiers->stale_timeouts--;
+                }
+                else if (p_tiers->current != BLE_ADV_TIERS_IDLE)
+                {
+                    on_timeout(p_tiers);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,234 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup ble_adv_tiers Tiered advertising
+ * @{
+ * @brief Steps a connectable advertising set through progressively slower intervals.
+ *
+ * @details Advertising starts in the first (fastest) tier and moves to the next one each time a
+ *          tier's duration has run out, so a device nobody connects to spends most of its time in
+ *          the cheapest tier instead of advertising fast forever. A tier with a duration of 0
+ *          lasts until a connection is made. When the last tier has a duration, advertising stops
+ *          after it and @ref BLE_ADV_TIERS_EVT_IDLE is reported. @ref ble_adv_tiers_start, called
+ *          on a button press or an NFC tap for example, always starts over from the first tier.
+ *
+ *          Each tier runs as one or more SoftDevice advertising periods of at most
+ *          @ref BLE_ADV_TIERS_SEGMENT_MAX, so the time spent in a tier can be measured with the
+ *          24-bit app_timer counter without wrapping. The module accumulates that time per tier
+ *          and derives the number of advertising events and an estimate of the charge used from
+ *          it, given the charge of one advertising event at init.
+ *
+ *          The module configures the advertising set itself; the application encodes the
+ *          advertising and scan response data and must not start advertising on its own.
+ */
+#ifndef BLE_ADV_TIERS_H__
+#define BLE_ADV_TIERS_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "ble_gap.h"
+#include "nrf_sdh_ble.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLE_ADV_TIERS_BLE_OBSERVER_PRIO
+#define BLE_ADV_TIERS_BLE_OBSERVER_PRIO 1       /**< Priority of the module's BLE event observer. */
+#endif
+
+#define BLE_ADV_TIERS_MAX           4           /**< Maximum number of tiers. */
+#define BLE_ADV_TIERS_IDLE          0xFF        /**< Tier index reported while not advertising. */
+#define BLE_ADV_TIERS_SEGMENT_MAX   30000       /**< Longest single advertising period (300 seconds) in units of 10 milliseconds. */
+
+/**@brief Macro for defining a ble_adv_tiers instance.
+ *
+ * @param[in] _name  Name of the instance.
+ */
+#define BLE_ADV_TIERS_DEF(_name)                                                                    \
+    static ble_adv_tiers_t _name;                                                                   \
+    NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                             \
+                         BLE_ADV_TIERS_BLE_OBSERVER_PRIO,                                           \
+                         ble_adv_tiers_on_ble_evt, &_name)
+
+
+/**@brief Advertising settings of one tier. */
+typedef struct
+{
+    uint32_t interval;  /**< Advertising interval in units of 0.625 ms. */
+    uint32_t duration;  /**< Time spent in the tier in units of 10 ms; 0 to stay until connected. */
+} ble_adv_tier_t;
+
+/**@brief Event types. */
+typedef enum
+{
+    BLE_ADV_TIERS_EVT_TIER, /**< Advertising entered the tier given in the event. */
+    BLE_ADV_TIERS_EVT_IDLE, /**< The last tier ran out and advertising stopped. */
+} ble_adv_tiers_evt_type_t;
+
+/**@brief Event structure. */
+typedef struct
+{
+    ble_adv_tiers_evt_type_t type;  /**< Event type. */
+    uint8_t                  tier;  /**< Tier entered; @ref BLE_ADV_TIERS_IDLE for @ref BLE_ADV_TIERS_EVT_IDLE. */
+} ble_adv_tiers_evt_t;
+
+typedef struct ble_adv_tiers_s ble_adv_tiers_t;
+
+/**@brief Event handler type.
+ *
+ * @param[in] p_tiers  Instance that generated the event.
+ * @param[in] p_evt    Event.
+ */
+typedef void (*ble_adv_tiers_evt_handler_t)(ble_adv_tiers_t * p_tiers, ble_adv_tiers_evt_t const * p_evt);
+
+/**@brief Initialization parameters. */
+typedef struct
+{
+    ble_gap_adv_data_t const *  p_adv_data;         /**< Encoded advertising and scan response data. Must stay valid. */
+    ble_adv_tier_t const *      p_tier;             /**< Tiers, fastest first. Must stay valid. */
+    uint8_t                     tier_count;         /**< Number of tiers, up to @ref BLE_ADV_TIERS_MAX. */
+    uint8_t                     conn_cfg_tag;       /**< SoftDevice connection configuration tag. */
+    uint32_t                    event_charge_nc;    /**< Estimated charge of one advertising event, in nanocoulombs. */
+    ble_adv_tiers_evt_handler_t evt_handler;        /**< Event handler. Can be NULL. */
+} ble_adv_tiers_init_t;
+
+/**@brief Time and charge spent in one tier since init. */
+typedef struct
+{
+    uint32_t time_ms;       /**< Time spent advertising in the tier. */
+    uint32_t events;        /**< Advertising events sent, derived from the time and interval. */
+    uint32_t charge_uc;     /**< Estimated charge used by those events, in microcoulombs. */
+} ble_adv_tiers_stats_t;
+
+/**@brief Instance structure. Fields are private. */
+struct ble_adv_tiers_s
+{
+    ble_adv_tier_t const *      p_tier;
+    uint8_t                     tier_count;
+    uint8_t                     conn_cfg_tag;
+    uint8_t                     adv_handle;
+    uint8_t                     current;
+    uint8_t                     stale_timeouts;     /**< Timeout events still to come for periods that were stopped. */
+    uint8_t                     filter_policy;      /**< BLE_GAP_ADV_FP_* used for the periods started next. */
+    uint32_t                    event_charge_nc;
+    ble_adv_tiers_evt_handler_t evt_handler;
+    ble_gap_adv_data_t const *  p_adv_data;
+    uint32_t                    remaining;          /**< Duration left in the current tier, excluding the running period. */
+    uint32_t                    segment;            /**< Duration of the running period. */
+    uint32_t                    segment_start;      /**< app_timer counter value at the start of the running period. */
+    uint32_t                    time_ms[BLE_ADV_TIERS_MAX];
+};
+
+
+/**@brief Function for initializing the module and configuring the advertising set.
+ *
+ * @param[in] p_tiers  Instance defined with @ref BLE_ADV_TIERS_DEF.
+ * @param[in] p_init   Initialization parameters.
+ *
+ * @retval NRF_SUCCESS             The module was initialized.
+ * @retval NRF_ERROR_NULL          The data or the tiers were not given.
+ * @retval NRF_ERROR_INVALID_PARAM The number of tiers is 0 or above @ref BLE_ADV_TIERS_MAX.
+ * @return Other error codes returned by sd_ble_gap_adv_set_configure.
+ */
+ret_code_t ble_adv_tiers_init(ble_adv_tiers_t * p_tiers, ble_adv_tiers_init_t const * p_init);
+
+
+/**@brief Function for starting advertising in the first tier.
+ *
+ * @details Restarts from the first tier if advertising is already running.
+ *
+ * @param[in] p_tiers  Instance.
+ *
+ * @retval NRF_SUCCESS  Advertising was started.
+ * @return Other error codes returned by the SoftDevice.
+ */
+ret_code_t ble_adv_tiers_start(ble_adv_tiers_t * p_tiers);
+
+
+/**@brief Function for setting the advertising filter policy.
+ *
+ * @details Applies to the advertising periods started from then on, so it is normally set before
+ *          @ref ble_adv_tiers_start. The whitelist must have been set with the SoftDevice or the
+ *          Peer Manager while advertising was stopped. The default is @c BLE_GAP_ADV_FP_ANY.
+ *
+ * @param[in] p_tiers        Instance.
+ * @param[in] filter_policy  One of the BLE_GAP_ADV_FP_* values.
+ */
+void ble_adv_tiers_filter_policy_set(ble_adv_tiers_t * p_tiers, uint8_t filter_policy);
+
+
+/**@brief Function for stopping advertising.
+ *
+ * @param[in] p_tiers  Instance.
+ *
+ * @retval NRF_SUCCESS  Advertising was stopped or was not running.
+ * @return Other error codes returned by sd_ble_gap_adv_stop.
+ */
+ret_code_t ble_adv_tiers_stop(ble_adv_tiers_t * p_tiers);
+
+
+/**@brief Function for getting the tier advertising is in.
+ *
+ * @param[in] p_tiers  Instance.
+ *
+ * @return Tier index, or @ref BLE_ADV_TIERS_IDLE while not advertising.
+ */
+uint8_t ble_adv_tiers_current_get(ble_adv_tiers_t const * p_tiers);
+
+
+/**@brief Function for getting the time and charge spent in a tier.
+ *
+ * @details The running period is only accounted for once it ends.
+ *
+ * @param[in]  p_tiers  Instance.
+ * @param[in]  tier     Tier index.
+ * @param[out] p_stats  Statistics; all zero for a tier that does not exist.
+ */
+void ble_adv_tiers_stats_get(ble_adv_tiers_t const * p_tiers, uint8_t tier, ble_adv_tiers_stats_t * p_stats);
+
+
+/**@brief Function for handling BLE events. Registered by @ref BLE_ADV_TIERS_DEF.
+ *
+ * @param[in] p_ble_evt  BLE event.
+ * @param[in] p_context  Instance.
+ */
+void ble_adv_tiers_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_ADV_TIERS_H__
+
+/** @} */
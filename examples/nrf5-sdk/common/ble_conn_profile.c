@@ -0,0 +1,210 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "ble_conn_profile.h"
+
+#include "ble_conn_params.h"
+#include "nrf_error.h"
+#include "ble_err.h"
+#include "app_error.h"
+
+
+/**@brief Function for checking whether a SoftDevice call failed only because a procedure was
+ *        already running or the link went away.
+ */
+static bool is_transient(ret_code_t err_code)
+{
+    return (err_code == NRF_ERROR_BUSY)          ||
+           (err_code == NRF_ERROR_INVALID_STATE) ||
+           (err_code == BLE_ERROR_INVALID_CONN_HANDLE);
+}
+
+
+/**@brief Function for moving the link to a profile. */
+static ret_code_t profile_apply(ble_conn_profile_t * p_profile, ble_conn_profile_id_t id)
+{
+    ble_conn_profile_params_t const * p_params = (id == BLE_CONN_PROFILE_BULK) ? p_profile->p_bulk
+                                                                                : p_profile->p_idle;
+    ble_gap_conn_params_t conn_params = p_params->conn_params;
+    ble_gap_phys_t const  phys        = {.tx_phys = p_params->phys, .rx_phys = p_params->phys};
+    ble_opt_t             opt         = {0};
+    ret_code_t            err_code;
+
+    // The event length extension is a global option; set it first so the first bulk
+    // connection event can already use it.
+    opt.common_opt.conn_evt_ext.enable = p_params->conn_evt_ext;
+    err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = ble_conn_params_change_conn_params(p_profile->conn_handle, &conn_params);
+    if ((err_code != NRF_SUCCESS) && !is_transient(err_code))
+    {
+        return err_code;
+    }
+
+    err_code = sd_ble_gap_phy_update(p_profile->conn_handle, &phys);
+    if ((err_code != NRF_SUCCESS) && !is_transient(err_code))
+    {
+        return err_code;
+    }
+
+    p_profile->active = id;
+
+    if (p_profile->evt_handler != NULL)
+    {
+        p_profile->evt_handler(p_profile, id);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for handling the idle delay timeout. */
+static void idle_timeout_handler(void * p_context)
+{
+    ble_conn_profile_t * p_profile = p_context;
+
+    p_profile->idle_pending = false;
+
+    if ((p_profile->conn_handle != BLE_CONN_HANDLE_INVALID) &&
+        (p_profile->active == BLE_CONN_PROFILE_BULK))
+    {
+        APP_ERROR_CHECK(profile_apply(p_profile, BLE_CONN_PROFILE_IDLE));
+    }
+}
+
+
+/**@brief Function for cancelling a pending return to the idle profile. */
+static void idle_cancel(ble_conn_profile_t * p_profile)
+{
+    if (p_profile->idle_pending)
+    {
+        (void)app_timer_stop(*p_profile->p_idle_timer);
+        p_profile->idle_pending = false;
+    }
+}
+
+
+ret_code_t ble_conn_profile_init(ble_conn_profile_t            * p_profile,
+                                 ble_conn_profile_init_t const * p_init)
+{
+    VERIFY_PARAM_NOT_NULL(p_init->p_idle);
+    VERIFY_PARAM_NOT_NULL(p_init->p_bulk);
+
+    if (p_init->bulk_exit_level >= p_init->bulk_enter_level)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_profile->p_idle           = p_init->p_idle;
+    p_profile->p_bulk           = p_init->p_bulk;
+    p_profile->bulk_enter_level = p_init->bulk_enter_level;
+    p_profile->bulk_exit_level  = p_init->bulk_exit_level;
+    p_profile->idle_delay       = p_init->idle_delay;
+    p_profile->evt_handler      = p_init->evt_handler;
+    p_profile->conn_handle      = BLE_CONN_HANDLE_INVALID;
+    p_profile->active           = BLE_CONN_PROFILE_IDLE;
+    p_profile->idle_pending     = false;
+
+    return app_timer_create(p_profile->p_idle_timer, APP_TIMER_MODE_SINGLE_SHOT, idle_timeout_handler);
+}
+
+
+ret_code_t ble_conn_profile_tx_level_update(ble_conn_profile_t * p_profile, uint16_t level)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    if (p_profile->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_SUCCESS;
+    }
+
+    if (p_profile->active == BLE_CONN_PROFILE_IDLE)
+    {
+        if (level >= p_profile->bulk_enter_level)
+        {
+            err_code = profile_apply(p_profile, BLE_CONN_PROFILE_BULK);
+        }
+    }
+    else if (level > p_profile->bulk_exit_level)
+    {
+        idle_cancel(p_profile);
+    }
+    else if (!p_profile->idle_pending)
+    {
+        err_code = app_timer_start(*p_profile->p_idle_timer, p_profile->idle_delay, p_profile);
+        p_profile->idle_pending = (err_code == NRF_SUCCESS);
+    }
+
+    return err_code;
+}
+
+
+ble_conn_profile_id_t ble_conn_profile_active_get(ble_conn_profile_t const * p_profile)
+{
+    return p_profile->active;
+}
+
+
+void ble_conn_profile_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_conn_profile_t * p_profile = p_context;
+    ret_code_t           err_code;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            // The central starts from the PPCP, which is the idle profile.
+            p_profile->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            p_profile->active      = BLE_CONN_PROFILE_IDLE;
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_profile->conn_handle)
+            {
+                idle_cancel(p_profile);
+                p_profile->conn_handle = BLE_CONN_HANDLE_INVALID;
+                p_profile->active      = BLE_CONN_PROFILE_IDLE;
+            }
+            break;
+
+        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        {
+            uint8_t const phys = (p_profile->active == BLE_CONN_PROFILE_BULK) ? p_profile->p_bulk->phys
+                                                                               : p_profile->p_idle->phys;
+            ble_gap_phys_t const gap_phys = {.tx_phys = phys, .rx_phys = phys};
+
+            err_code = sd_ble_gap_phy_update(p_ble_evt->evt.gap_evt.conn_handle, &gap_phys);
+            APP_ERROR_CHECK(err_code);
+        } break;
+
+        default:
+            break;
+    }
+}
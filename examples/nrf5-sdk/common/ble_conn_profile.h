@@ -0,0 +1,188 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup ble_conn_profile Connection parameter profiles
+ * @{
+ * @brief Switches a peripheral link between a low-power and a high-throughput profile.
+ *
+ * @details The application reports how much data it has waiting to be sent. When the level reaches
+ *          @ref ble_conn_profile_init_t::bulk_enter_level the link is moved to the bulk profile
+ *          (short connection interval, 2 Mbps PHY, connection event length extension). When the
+ *          level stays at or below @ref ble_conn_profile_init_t::bulk_exit_level for
+ *          @ref ble_conn_profile_init_t::idle_delay the link returns to the idle profile (long
+ *          interval, slave latency). The delay keeps a bursty source from renegotiating the
+ *          connection on every burst.
+ *
+ *          Connection parameters are changed through the Connection Parameters module, so it keeps
+ *          negotiating towards the active profile instead of the PPCP set at init. The module also
+ *          answers PHY update requests from the peer with the PHYs of the active profile; the
+ *          application must not handle BLE_GAP_EVT_PHY_UPDATE_REQUEST itself.
+ *
+ *          Data length and ATT MTU are negotiated once per connection by the GATT module, up to
+ *          NRF_SDH_BLE_GAP_DATA_LENGTH and NRF_SDH_BLE_GATT_MAX_MTU_SIZE, and are not part of a
+ *          profile.
+ */
+#ifndef BLE_CONN_PROFILE_H__
+#define BLE_CONN_PROFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_gap.h"
+#include "app_timer.h"
+#include "nrf_sdh_ble.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLE_CONN_PROFILE_BLE_OBSERVER_PRIO
+#define BLE_CONN_PROFILE_BLE_OBSERVER_PRIO 2    /**< Priority of the module's BLE event observer. */
+#endif
+
+/**@brief Macro for defining a ble_conn_profile instance.
+ *
+ * @param[in] _name  Name of the instance.
+ */
+#define BLE_CONN_PROFILE_DEF(_name)                                                                 \
+    APP_TIMER_DEF(_name ## _idle_timer);                                                            \
+    static ble_conn_profile_t _name = {.p_idle_timer = &_name ## _idle_timer};                      \
+    NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                             \
+                         BLE_CONN_PROFILE_BLE_OBSERVER_PRIO,                                        \
+                         ble_conn_profile_on_ble_evt, &_name)
+
+
+/**@brief Profile identifiers. */
+typedef enum
+{
+    BLE_CONN_PROFILE_IDLE,  /**< Low-power profile, used when little data is pending. */
+    BLE_CONN_PROFILE_BULK,  /**< High-throughput profile, used while a backlog is drained. */
+} ble_conn_profile_id_t;
+
+/**@brief Link settings belonging to one profile. */
+typedef struct
+{
+    ble_gap_conn_params_t conn_params;  /**< Connection parameters to negotiate. */
+    uint8_t               phys;         /**< Preferred PHYs, see @ref BLE_GAP_PHYS. */
+    bool                  conn_evt_ext; /**< Whether connection events may be extended while data is pending. */
+} ble_conn_profile_params_t;
+
+typedef struct ble_conn_profile_s ble_conn_profile_t;
+
+/**@brief Profile change handler type.
+ *
+ * @param[in] p_profile  Instance that changed profile.
+ * @param[in] id         Profile now active.
+ */
+typedef void (*ble_conn_profile_evt_handler_t)(ble_conn_profile_t * p_profile,
+                                               ble_conn_profile_id_t id);
+
+/**@brief Initialization parameters. */
+typedef struct
+{
+    ble_conn_profile_params_t const * p_idle;           /**< Idle profile. Its connection parameters should match the PPCP. */
+    ble_conn_profile_params_t const * p_bulk;           /**< Bulk profile. */
+    uint16_t                          bulk_enter_level; /**< Pending-data level at which the bulk profile is selected. */
+    uint16_t                          bulk_exit_level;  /**< Pending-data level at or below which the idle delay starts. */
+    uint32_t                          idle_delay;       /**< Time to stay at or below the exit level before going idle, in app_timer ticks. */
+    ble_conn_profile_evt_handler_t    evt_handler;      /**< Called after each profile change. Can be NULL. */
+} ble_conn_profile_init_t;
+
+/**@brief Instance structure. Fields are private. */
+struct ble_conn_profile_s
+{
+    app_timer_id_t const *            p_idle_timer;
+    ble_conn_profile_params_t const * p_idle;
+    ble_conn_profile_params_t const * p_bulk;
+    uint16_t                          bulk_enter_level;
+    uint16_t                          bulk_exit_level;
+    uint32_t                          idle_delay;
+    ble_conn_profile_evt_handler_t    evt_handler;
+    uint16_t                          conn_handle;
+    ble_conn_profile_id_t             active;
+    bool                              idle_pending;
+};
+
+
+/**@brief Function for initializing the module.
+ *
+ * @param[in] p_profile  Instance defined with @ref BLE_CONN_PROFILE_DEF.
+ * @param[in] p_init     Initialization parameters.
+ *
+ * @retval NRF_SUCCESS             The module was initialized.
+ * @retval NRF_ERROR_NULL          A profile was not given.
+ * @retval NRF_ERROR_INVALID_PARAM The exit level is not below the enter level.
+ * @return Other error codes returned by app_timer_create.
+ */
+ret_code_t ble_conn_profile_init(ble_conn_profile_t            * p_profile,
+                                 ble_conn_profile_init_t const * p_init);
+
+
+/**@brief Function for reporting the amount of data waiting to be sent.
+ *
+ * @details The unit is up to the application (bytes, records, notifications) as long as it matches
+ *          the levels given at init. Call whenever the level changes; calls without an open
+ *          connection are ignored.
+ *
+ * @param[in] p_profile  Instance.
+ * @param[in] level      Current pending-data level.
+ *
+ * @retval NRF_SUCCESS  The level was processed.
+ * @return Other error codes returned when applying a profile.
+ */
+ret_code_t ble_conn_profile_tx_level_update(ble_conn_profile_t * p_profile, uint16_t level);
+
+
+/**@brief Function for getting the active profile.
+ *
+ * @param[in] p_profile  Instance.
+ *
+ * @return Active profile; @ref BLE_CONN_PROFILE_IDLE while disconnected.
+ */
+ble_conn_profile_id_t ble_conn_profile_active_get(ble_conn_profile_t const * p_profile);
+
+
+/**@brief Function for handling BLE events. Registered by @ref BLE_CONN_PROFILE_DEF.
+ *
+ * @param[in] p_ble_evt  BLE event.
+ * @param[in] p_context  Instance.
+ */
+void ble_conn_profile_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_CONN_PROFILE_H__
+
+/** @} */
@@ -0,0 +1,195 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "button_debounce.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_drv_timer.h"
+#include "nrf_gpio.h"
+#include "app_error.h"
+#include "sdk_macros.h"
+
+
+static const nrf_drv_timer_t m_timer = NRF_DRV_TIMER_INSTANCE(BUTTON_DEBOUNCE_TIMER_INSTANCE);
+
+static app_button_cfg_t const * mp_buttons;                             /**< Button configurations. */
+static uint8_t                  m_count;                                /**< Number of buttons. */
+static nrf_ppi_channel_t        m_ppi[BUTTON_DEBOUNCE_MAX_BUTTONS];     /**< PPI channel of each button. */
+static uint32_t                 m_states;                               /**< Last reported state of each button, one bit per button; set if pushed. */
+static button_debounce_stats_t  m_stats;                                /**< Statistics. */
+
+
+/**@brief Function for reading the state of every button, one bit per button; set if pushed. */
+static uint32_t states_read(void)
+{
+    uint32_t states = 0;
+
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        bool level = (nrf_gpio_pin_read(mp_buttons[i].pin_no) != 0);
+
+        if (level == mp_buttons[i].active_state)
+        {
+            states |= (1UL << i);
+        }
+    }
+
+    return states;
+}
+
+
+/**@brief Function for handling the TIMER compare, reached once the pins have settled. */
+static void timer_evt_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    uint32_t states  = states_read();
+    uint32_t changed = states ^ m_states;
+
+    m_stats.wakeups++;
+    m_states = states;
+
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        if (changed & (1UL << i))
+        {
+            m_stats.events++;
+            mp_buttons[i].button_handler(mp_buttons[i].pin_no,
+                                         (states & (1UL << i)) ? APP_BUTTON_PUSH : APP_BUTTON_RELEASE);
+        }
+    }
+}
+
+
+/**@brief GPIOTE handler. The IN events are used without their interrupt, so it is never called. */
+static void gpiote_evt_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+}
+
+
+ret_code_t button_debounce_init(app_button_cfg_t const * p_buttons,
+                                uint8_t                  count,
+                                uint32_t                 delay_us)
+{
+    ret_code_t err_code;
+
+    VERIFY_PARAM_NOT_NULL(p_buttons);
+    if ((count == 0) || (count > BUTTON_DEBOUNCE_MAX_BUTTONS) ||
+        (delay_us == 0) || (delay_us > BUTTON_DEBOUNCE_MAX_DELAY_US))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    mp_buttons = p_buttons;
+    m_count    = count;
+
+    nrf_drv_timer_config_t timer_config = NRF_DRV_TIMER_DEFAULT_CONFIG;
+    timer_config.frequency = NRF_TIMER_FREQ_31250Hz;
+    timer_config.bit_width = NRF_TIMER_BIT_WIDTH_16;
+    timer_config.mode      = NRF_TIMER_MODE_TIMER;
+
+    err_code = nrf_drv_timer_init(&m_timer, &timer_config, timer_evt_handler);
+    VERIFY_SUCCESS(err_code);
+
+    // Stop and clear on the compare, so the next edge starts a fresh delay. The timer is not
+    // enabled here; only the PPI channels start it.
+    nrf_drv_timer_extended_compare(&m_timer,
+                                   NRF_TIMER_CC_CHANNEL0,
+                                   nrf_drv_timer_us_to_ticks(&m_timer, delay_us),
+                                   NRF_TIMER_SHORT_COMPARE0_STOP_MASK |
+                                   NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK,
+                                   true);
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        VERIFY_SUCCESS(err_code);
+    }
+
+    err_code = nrf_drv_ppi_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED))
+    {
+        return err_code;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_TOGGLE(true);
+        in_config.pull = p_buttons[i].pull_cfg;
+
+        err_code = nrf_drv_gpiote_in_init(p_buttons[i].pin_no, &in_config, gpiote_evt_handler);
+        VERIFY_SUCCESS(err_code);
+
+        err_code = nrf_drv_ppi_channel_alloc(&m_ppi[i]);
+        VERIFY_SUCCESS(err_code);
+
+        err_code = nrf_drv_ppi_channel_assign(m_ppi[i],
+                                              nrf_drv_gpiote_in_event_addr_get(p_buttons[i].pin_no),
+                                              nrf_drv_timer_task_address_get(&m_timer,
+                                                                             NRF_TIMER_TASK_CLEAR));
+        VERIFY_SUCCESS(err_code);
+
+        err_code = nrf_drv_ppi_channel_fork_assign(m_ppi[i],
+                                                   nrf_drv_timer_task_address_get(&m_timer,
+                                                                                  NRF_TIMER_TASK_START));
+        VERIFY_SUCCESS(err_code);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+void button_debounce_enable(void)
+{
+    m_states = states_read();
+
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        // Event only: the edges go to the PPI, not to the CPU.
+        nrf_drv_gpiote_in_event_enable(mp_buttons[i].pin_no, false);
+        APP_ERROR_CHECK(nrf_drv_ppi_channel_enable(m_ppi[i]));
+    }
+}
+
+
+void button_debounce_disable(void)
+{
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        APP_ERROR_CHECK(nrf_drv_ppi_channel_disable(m_ppi[i]));
+        nrf_drv_gpiote_in_event_disable(mp_buttons[i].pin_no);
+    }
+
+    nrf_drv_timer_pause(&m_timer);
+    nrf_drv_timer_clear(&m_timer);
+}
+
+
+void button_debounce_stats_get(button_debounce_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
@@ -0,0 +1,122 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup button_debounce Hardware button debounce
+ * @{
+ * @brief Debounces buttons in hardware and reports only settled state changes.
+ *
+ * @details A drop-in alternative to app_button for applications that take the button
+ *          configuration from an @ref app_button_cfg_t array. Each button gets a GPIOTE IN channel
+ *          whose toggle event clears and starts a TIMER through a PPI channel and its fork. The
+ *          TIMER interrupts when no edge has been seen for the detection delay, and stops itself
+ *          through a short. Bounces therefore only restart the TIMER and never reach the CPU.
+ *          app_button instead takes a port interrupt on every edge and then runs an app_timer
+ *          delay. The compare interrupt reads the settled pin levels and calls the button handler
+ *          for each button whose state has changed. A glitch shorter than the delay that leaves
+ *          every level unchanged costs one interrupt and reports nothing.
+ *
+ *          Because the edges are caught by the GPIOTE, presses are not lost while the SoftDevice
+ *          holds the CPU. The handlers run in the TIMER interrupt, at
+ *          TIMER_DEFAULT_CONFIG_IRQ_PRIORITY.
+ *
+ * @note    A GPIOTE IN channel draws more idle current than the PORT event used by app_button,
+ *          and the TIMER keeps the high-frequency clock requested during the detection delay.
+ *          The backend saves CPU wakeups, not idle current.
+ */
+#ifndef BUTTON_DEBOUNCE_H__
+#define BUTTON_DEBOUNCE_H__
+
+#include <stdint.h>
+#include "app_button.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BUTTON_DEBOUNCE_TIMER_INSTANCE
+#define BUTTON_DEBOUNCE_TIMER_INSTANCE  2       /**< TIMER used for the detection delay. TIMER0 belongs to the SoftDevice. */
+#endif
+
+#define BUTTON_DEBOUNCE_MAX_BUTTONS     4       /**< Maximum number of buttons; each takes a GPIOTE and a PPI channel. */
+#define BUTTON_DEBOUNCE_MAX_DELAY_US    2000000 /**< Longest detection delay, set by the 16-bit TIMER at 31.25 kHz. */
+
+/**@brief Debounce statistics. */
+typedef struct
+{
+    uint32_t wakeups;   /**< TIMER interrupts taken. */
+    uint32_t events;    /**< Button handler calls made. */
+} button_debounce_stats_t;
+
+
+/**@brief Function for initializing the buttons and the debounce hardware.
+ *
+ * @param[in] p_buttons  Button configurations. The array must stay valid, as with app_button.
+ * @param[in] count      Number of buttons, at most @ref BUTTON_DEBOUNCE_MAX_BUTTONS.
+ * @param[in] delay_us   Time a pin must be stable before its state is reported, in microseconds.
+ *
+ * @retval NRF_SUCCESS              The buttons were initialized. They are reported once enabled.
+ * @retval NRF_ERROR_NULL           No button configuration was given.
+ * @retval NRF_ERROR_INVALID_PARAM  No buttons, too many buttons or a delay out of range.
+ * @return Other error codes returned by the TIMER, PPI or GPIOTE drivers.
+ */
+ret_code_t button_debounce_init(app_button_cfg_t const * p_buttons,
+                                uint8_t                  count,
+                                uint32_t                 delay_us);
+
+
+/**@brief Function for enabling button detection.
+ *
+ * @details The current pin levels become the reference states, so a button held down while it is
+ *          enabled is reported only once it is released.
+ */
+void button_debounce_enable(void);
+
+
+/**@brief Function for disabling button detection.
+ */
+void button_debounce_disable(void);
+
+
+/**@brief Function for reading the debounce statistics.
+ *
+ * @param[out] p_stats  Statistics since initialization.
+ */
+void button_debounce_stats_get(button_debounce_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUTTON_DEBOUNCE_H__
+
+/** @} */
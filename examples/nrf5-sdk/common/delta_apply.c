@@ -0,0 +1,406 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "delta_apply.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "nrf.h"
+#include "nordic_common.h"
+#include "app_util.h"
+#include "crc32.h"
+#include "nrf_fstorage.h"
+#if defined(SOFTDEVICE_PRESENT)
+#include "nrf_fstorage_sd.h"
+#else
+#include "nrf_fstorage_nvmc.h"
+#endif
+
+#define DELTA_MAGIC         0x544C444EUL    /**< "NDLT". */
+#define DELTA_VERSION       1
+#define DELTA_PAGE_SHIFT    12
+#define DELTA_PAGE_SIZE     (1UL << DELTA_PAGE_SHIFT)
+
+#define OP_COPY             0x01            /**< Bytes copied from the base. */
+#define OP_PATCH            0x02            /**< Bytes copied from the base, with single bytes replaced. */
+#define OP_LIT              0x03            /**< Bytes given in full. */
+#define OP_FILL             0x04            /**< One byte repeated. */
+
+STATIC_ASSERT(DELTA_PAGE_SIZE == CODE_PAGE_SIZE);
+
+/**@brief Delta header, as written by nrf_delta.py. */
+typedef struct
+{
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  page_shift;
+    uint16_t reserved;
+    uint32_t start;         /**< Address of the base and new application. */
+    uint32_t base_size;
+    uint32_t base_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+    uint32_t body_size;
+    uint32_t body_crc;
+    uint32_t header_crc;    /**< CRC32 of the fields above. */
+} delta_header_t;
+
+STATIC_ASSERT(sizeof(delta_header_t) == 40);
+
+/**@brief Position in the delta body. */
+typedef struct
+{
+    uint8_t const * p_pos;
+    uint8_t const * p_end;
+} reader_t;
+
+static void fs_evt_handler(nrf_fstorage_evt_t * p_evt);
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t m_fs) =
+{
+    .evt_handler = fs_evt_handler,
+};
+
+static delta_apply_evt_handler_t m_evt_handler;
+static delta_header_t            m_header;
+static reader_t                  m_reader;
+static uint32_t                  m_scratch_addr;
+static uint32_t                  m_page;                        /**< Page being built. */
+static uint32_t                  m_page_len;                    /**< Bytes of the new image in m_page. */
+static bool                      m_busy;
+static uint8_t                   m_buf[DELTA_PAGE_SIZE] __ALIGN(4); /**< Page being built; fstorage writes from it. */
+
+
+static bool read_byte(reader_t * p_reader, uint8_t * p_value)
+{
+    if (p_reader->p_pos >= p_reader->p_end)
+    {
+        return false;
+    }
+    *p_value = *p_reader->p_pos++;
+    return true;
+}
+
+
+/**@brief Function for reading a LEB128 number of up to 28 bits. */
+static bool read_number(reader_t * p_reader, uint32_t * p_value)
+{
+    uint8_t byte;
+
+    *p_value = 0;
+    for (uint32_t shift = 0; shift <= 21; shift += 7)
+    {
+        if (!read_byte(p_reader, &byte))
+        {
+            return false;
+        }
+        *p_value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**@brief Function for rebuilding m_page in m_buf and checking it against its CRC.
+ *
+ * @retval NRF_SUCCESS             The page is in m_buf.
+ * @retval NRF_ERROR_INVALID_DATA  An operation is malformed or the CRC does not match.
+ */
+static ret_code_t page_build(void)
+{
+    uint8_t const * p_base = (uint8_t const *)m_header.start;
+    uint32_t        len    = 0;
+    uint32_t        crc;
+
+    while (len < m_page_len)
+    {
+        uint8_t  op;
+        uint32_t src    = 0;
+        uint32_t length = 0;
+
+        if (!read_byte(&m_reader, &op))
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+        if (((op == OP_COPY) || (op == OP_PATCH)) && !read_number(&m_reader, &src))
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+        if (!read_number(&m_reader, &length) || (length > m_page_len - len))
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+
+        switch (op)
+        {
+            case OP_COPY:
+            case OP_PATCH:
+                if ((src > m_header.base_size) || (length > m_header.base_size - src))
+                {
+                    return NRF_ERROR_INVALID_DATA;
+                }
+                memcpy(&m_buf[len], &p_base[src], length);
+
+                if (op == OP_PATCH)
+                {
+                    uint32_t count;
+                    uint32_t offset = 0;
+                    uint32_t gap;
+
+                    if (!read_number(&m_reader, &count))
+                    {
+                        return NRF_ERROR_INVALID_DATA;
+                    }
+                    while (count--)
+                    {
+                        if (!read_number(&m_reader, &gap) || (gap >= length - offset) ||
+                            !read_byte(&m_reader, &m_buf[len + offset + gap]))
+                        {
+                            return NRF_ERROR_INVALID_DATA;
+                        }
+                        offset += gap;
+                    }
+                }
+                break;
+
+            case OP_LIT:
+                if ((uint32_t)(m_reader.p_end - m_reader.p_pos) < length)
+                {
+                    return NRF_ERROR_INVALID_DATA;
+                }
+                memcpy(&m_buf[len], m_reader.p_pos, length);
+                m_reader.p_pos += length;
+                break;
+
+            case OP_FILL:
+            {
+                uint8_t value;
+
+                if (!read_byte(&m_reader, &value))
+                {
+                    return NRF_ERROR_INVALID_DATA;
+                }
+                memset(&m_buf[len], value, length);
+                break;
+            }
+
+            default:
+                return NRF_ERROR_INVALID_DATA;
+        }
+        len += length;
+    }
+
+    if ((m_reader.p_end - m_reader.p_pos) < (int32_t)sizeof(crc))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+    memcpy(&crc, m_reader.p_pos, sizeof(crc));
+    m_reader.p_pos += sizeof(crc);
+
+    return (crc32_compute(m_buf, m_page_len, NULL) == crc) ? NRF_SUCCESS : NRF_ERROR_INVALID_DATA;
+}
+
+
+static void evt_send(delta_apply_evt_type_t type, ret_code_t err_code)
+{
+    delta_apply_evt_t evt =
+    {
+        .type     = type,
+        .err_code = err_code,
+        .page     = m_page,
+        .size     = m_header.new_size,
+    };
+
+    m_busy = false;
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(&evt);
+    }
+}
+
+
+/**@brief Function for building the next page and erasing its scratch page, or finishing. */
+static void page_next(void)
+{
+    ret_code_t err_code;
+    uint32_t   offset = m_page * DELTA_PAGE_SIZE;
+
+    if (offset >= m_header.new_size)
+    {
+        if (crc32_compute((uint8_t const *)m_scratch_addr, m_header.new_size, NULL) != m_header.new_crc)
+        {
+            evt_send(DELTA_APPLY_EVT_ERROR, NRF_ERROR_INTERNAL);
+            return;
+        }
+        evt_send(DELTA_APPLY_EVT_DONE, NRF_SUCCESS);
+        return;
+    }
+
+    m_page_len = MIN(DELTA_PAGE_SIZE, m_header.new_size - offset);
+
+    err_code = page_build();
+    if (err_code != NRF_SUCCESS)
+    {
+        evt_send(DELTA_APPLY_EVT_ERROR, err_code);
+        return;
+    }
+
+    // fstorage writes whole words; the end of the last page reads as erased flash.
+    memset(&m_buf[m_page_len], 0xFF, ALIGN_NUM(4, m_page_len) - m_page_len);
+
+    err_code = nrf_fstorage_erase(&m_fs, m_scratch_addr + offset, 1, NULL);
+    if (err_code != NRF_SUCCESS)
+    {
+        evt_send(DELTA_APPLY_EVT_ERROR, err_code);
+    }
+}
+
+
+static void fs_evt_handler(nrf_fstorage_evt_t * p_evt)
+{
+    ret_code_t err_code;
+
+    if (!m_busy)
+    {
+        return;
+    }
+    if (p_evt->result != NRF_SUCCESS)
+    {
+        evt_send(DELTA_APPLY_EVT_ERROR, p_evt->result);
+        return;
+    }
+
+    switch (p_evt->id)
+    {
+        case NRF_FSTORAGE_EVT_ERASE_RESULT:
+            err_code = nrf_fstorage_write(&m_fs, p_evt->addr, m_buf, ALIGN_NUM(4, m_page_len), NULL);
+            if (err_code != NRF_SUCCESS)
+            {
+                evt_send(DELTA_APPLY_EVT_ERROR, err_code);
+            }
+            break;
+
+        case NRF_FSTORAGE_EVT_WRITE_RESULT:
+            if (memcmp((void const *)p_evt->addr, m_buf, m_page_len) != 0)
+            {
+                evt_send(DELTA_APPLY_EVT_ERROR, NRF_ERROR_INTERNAL);
+                return;
+            }
+            m_page++;
+            page_next();
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t delta_apply_init(delta_apply_evt_handler_t evt_handler)
+{
+    m_evt_handler = evt_handler;
+
+#if defined(SOFTDEVICE_PRESENT)
+    return nrf_fstorage_init(&m_fs, &nrf_fstorage_sd, NULL);
+#else
+    return nrf_fstorage_init(&m_fs, &nrf_fstorage_nvmc, NULL);
+#endif
+}
+
+
+ret_code_t delta_apply_start(uint8_t const * p_delta, uint32_t delta_size,
+                             uint32_t scratch_addr, uint32_t scratch_size)
+{
+    uint32_t delta_addr = (uint32_t)p_delta;
+
+    if (m_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    // Check the delta itself.
+    if (delta_size < sizeof(m_header))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+    memcpy(&m_header, p_delta, sizeof(m_header));
+    if ((m_header.magic      != DELTA_MAGIC)      ||
+        (m_header.version    != DELTA_VERSION)    ||
+        (m_header.page_shift != DELTA_PAGE_SHIFT) ||
+        (m_header.header_crc != crc32_compute(p_delta, offsetof(delta_header_t, header_crc), NULL)) ||
+        (m_header.body_size  != delta_size - sizeof(m_header)) ||
+        (m_header.body_crc   != crc32_compute(p_delta + sizeof(m_header), m_header.body_size, NULL)))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    // Check that the application in flash is the base.
+    if (crc32_compute((uint8_t const *)m_header.start, m_header.base_size, NULL) != m_header.base_crc)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // Check the scratch bank.
+    if ((scratch_addr % DELTA_PAGE_SIZE) != 0)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_header.new_size > scratch_size)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    if (((scratch_addr < m_header.start + m_header.base_size) &&
+         (m_header.start < scratch_addr + scratch_size)) ||
+        ((scratch_addr < delta_addr + delta_size) &&
+         (delta_addr < scratch_addr + scratch_size)))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    m_fs.start_addr   = scratch_addr;
+    m_fs.end_addr     = scratch_addr + scratch_size;
+    m_scratch_addr    = scratch_addr;
+    m_reader.p_pos    = p_delta + sizeof(m_header);
+    m_reader.p_end    = p_delta + delta_size;
+    m_page            = 0;
+    m_busy            = true;
+
+    page_next();
+
+    return NRF_SUCCESS;
+}
+
+
+bool delta_apply_is_busy(void)
+{
+    return m_busy;
+}
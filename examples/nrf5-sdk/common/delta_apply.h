@@ -0,0 +1,121 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup delta_apply Delta image applier
+ * @{
+ * @brief Rebuilds a new application image in a scratch bank from the application in flash and a delta.
+ *
+ * @details The delta is made at build time by tools/nrf_delta/nrf_delta.py, which also documents
+ *          the format. It must already be in flash, for example staged there by the DFU transport.
+ *          It is read in place.
+ *
+ *          @ref delta_apply_start first checks the delta header and body CRCs. It then checks the
+ *          CRC of the base application in flash against the one the delta was made for. Only then
+ *          is the scratch bank touched. The new image is then built one flash page at a time:
+ *          - the page is rebuilt in RAM and checked against its CRC from the delta,
+ *          - the scratch page is erased and written,
+ *          - the page is read back and compared with RAM before the next one is started.
+ *          When all pages are written, the CRC of the whole scratch image is checked against the
+ *          one in the header.
+ *
+ *          Pages are built from the flash event handler, in the context fstorage reports its
+ *          events in. Activating the new image, by copying the scratch bank over the application,
+ *          is left to the bootloader, as for a dual-bank DFU.
+ */
+#ifndef DELTA_APPLY_H__
+#define DELTA_APPLY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Delta applier event types. */
+typedef enum
+{
+    DELTA_APPLY_EVT_DONE,       /**< The new image is in the scratch bank and its CRC matches the delta. */
+    DELTA_APPLY_EVT_ERROR,      /**< Applying stopped; the scratch bank holds an incomplete image. */
+} delta_apply_evt_type_t;
+
+/**@brief Delta applier event. */
+typedef struct
+{
+    delta_apply_evt_type_t type;
+    ret_code_t             err_code;    /**< Reason of an @ref DELTA_APPLY_EVT_ERROR. */
+    uint32_t               page;        /**< Page being built when the error occurred. */
+    uint32_t               size;        /**< Size of the new image. */
+} delta_apply_evt_t;
+
+/**@brief Delta applier event handler type. */
+typedef void (*delta_apply_evt_handler_t)(delta_apply_evt_t const * p_evt);
+
+
+/**@brief Function for initializing the module.
+ *
+ * @param[in] evt_handler  Handler called when applying ends.
+ *
+ * @return NRF_SUCCESS, or the error returned by nrf_fstorage_init.
+ */
+ret_code_t delta_apply_init(delta_apply_evt_handler_t evt_handler);
+
+
+/**@brief Function for starting to apply a delta.
+ *
+ * @param[in] p_delta       Delta, in flash.
+ * @param[in] delta_size    Size of the delta.
+ * @param[in] scratch_addr  Start of the scratch bank, on a page boundary.
+ * @param[in] scratch_size  Size of the scratch bank.
+ *
+ * @retval NRF_SUCCESS              Applying started; the result comes as an event.
+ * @retval NRF_ERROR_BUSY           A delta is being applied.
+ * @retval NRF_ERROR_INVALID_DATA   The delta is damaged or of an unknown version.
+ * @retval NRF_ERROR_INVALID_STATE  The application in flash is not the base the delta was made against.
+ * @retval NRF_ERROR_INVALID_ADDR   The scratch bank is not page aligned or overlaps the base or the delta.
+ * @retval NRF_ERROR_NO_MEM         The new image does not fit in the scratch bank.
+ */
+ret_code_t delta_apply_start(uint8_t const * p_delta, uint32_t delta_size,
+                             uint32_t scratch_addr, uint32_t scratch_size);
+
+
+/**@brief Function for checking whether a delta is being applied. */
+bool delta_apply_is_busy(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DELTA_APPLY_H__
+
+/** @} */
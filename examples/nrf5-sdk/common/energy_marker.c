@@ -0,0 +1,90 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "energy_marker.h"
+
+#if ENERGY_MARKER_ENABLED
+#include "app_error.h"
+#include "boards.h"
+#if defined(SOFTDEVICE_PRESENT)
+#include "nrf_sdh.h"
+#include "nrf_soc.h"
+#endif
+
+BOARD_PINS_CLAIM(ENERGY_MARKER_PIN_MASK,
+                 BOARD_LEDS_PIN_MASK | BOARD_BUTTONS_PIN_MASK | BOARD_UART_PIN_MASK |
+                 BOARD_NFC_PIN_MASK | BOARD_RESET_PIN_MASK);
+
+/* S132 reserves PPI channels 17 to 31, and the GPIOTE driver hands out channels from 0. */
+STATIC_ASSERT(ENERGY_MARKER_PPI_CH_READY < 17 && ENERGY_MARKER_PPI_CH_DISABLED < 17);
+STATIC_ASSERT(ENERGY_MARKER_GPIOTE_CH < GPIOTE_CH_NUM);
+
+#define PPI_CH_MASK     ((1UL << ENERGY_MARKER_PPI_CH_READY) | (1UL << ENERGY_MARKER_PPI_CH_DISABLED))
+
+
+void energy_marker_init(void)
+{
+    NRF_P0->OUTCLR = ENERGY_MARKER_ID_MASK;
+    NRF_P0->DIRSET = ENERGY_MARKER_ID_MASK;
+
+    /* The task mode sets the pin as an output; SET and CLR ignore the polarity. */
+    NRF_GPIOTE->CONFIG[ENERGY_MARKER_GPIOTE_CH] =
+        (GPIOTE_CONFIG_MODE_Task       << GPIOTE_CONFIG_MODE_Pos)     |
+        (ENERGY_MARKER_RADIO_PIN       << GPIOTE_CONFIG_PSEL_Pos)     |
+        (GPIOTE_CONFIG_POLARITY_Toggle << GPIOTE_CONFIG_POLARITY_Pos) |
+        (GPIOTE_CONFIG_OUTINIT_Low     << GPIOTE_CONFIG_OUTINIT_Pos);
+
+#if defined(SOFTDEVICE_PRESENT)
+    if (nrf_sdh_is_enabled())
+    {
+        ret_code_t err_code;
+
+        err_code = sd_ppi_channel_assign(ENERGY_MARKER_PPI_CH_READY,
+                                         &NRF_RADIO->EVENTS_READY,
+                                         &NRF_GPIOTE->TASKS_SET[ENERGY_MARKER_GPIOTE_CH]);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = sd_ppi_channel_assign(ENERGY_MARKER_PPI_CH_DISABLED,
+                                         &NRF_RADIO->EVENTS_DISABLED,
+                                         &NRF_GPIOTE->TASKS_CLR[ENERGY_MARKER_GPIOTE_CH]);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = sd_ppi_channel_enable_set(PPI_CH_MASK);
+        APP_ERROR_CHECK(err_code);
+        return;
+    }
+#endif
+
+    NRF_PPI->CH[ENERGY_MARKER_PPI_CH_READY].EEP    = (uint32_t)&NRF_RADIO->EVENTS_READY;
+    NRF_PPI->CH[ENERGY_MARKER_PPI_CH_READY].TEP    = (uint32_t)&NRF_GPIOTE->TASKS_SET[ENERGY_MARKER_GPIOTE_CH];
+    NRF_PPI->CH[ENERGY_MARKER_PPI_CH_DISABLED].EEP = (uint32_t)&NRF_RADIO->EVENTS_DISABLED;
+    NRF_PPI->CH[ENERGY_MARKER_PPI_CH_DISABLED].TEP = (uint32_t)&NRF_GPIOTE->TASKS_CLR[ENERGY_MARKER_GPIOTE_CH];
+    NRF_PPI->CHENSET = PPI_CH_MASK;
+}
+#endif // ENERGY_MARKER_ENABLED
@@ -0,0 +1,163 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup energy_marker Energy markers
+ * @{
+ * @brief Phase markers on debug GPIOs, for attributing a current capture to operations.
+ *
+ * @details The markers are meant to be captured on the digital inputs of a Power Profiler Kit or
+ *          a logic analyzer next to the current, and decoded with tools/energy_marker into charge
+ *          and energy per operation.
+ *
+ *          - Radio: @ref ENERGY_MARKER_RADIO_PIN is high while the radio is enabled, from
+ *            EVENTS_READY to EVENTS_DISABLED. Two PPI channels drive the SET and CLR tasks of a
+ *            GPIOTE channel, so the marker costs no CPU time and sees the SoftDevice's radio
+ *            activity. The ramp up before EVENTS_READY is not marked.
+ *          - Phase: the @ref ENERGY_MARKER_ID_BITS pins from @ref ENERGY_MARKER_ID_PIN hold the
+ *            @ref energy_phase_t of the code running. Phases are set by the application around
+ *            the code to measure with @ref energy_marker_begin and @ref energy_marker_end, and
+ *            nest: the inner phase is shown until it ends.
+ *
+ *          A phase ID is written with two stores to the GPIO port, OUTCLR then OUTSET. Through
+ *          GPIOTE it would take a channel per pin and a task trigger per changed bit, so only the
+ *          radio, which the CPU does not see, goes through PPI. Between the two stores the pins
+ *          hold the bits the two IDs have in common; the decoder drops such glitches.
+ *
+ * @note    The markers are built in with ENERGY_MARKER_ENABLED set to 1 (`make ENERGY=1`). By
+ *          default the functions compile to nothing and the pins are left alone.
+ */
+#ifndef ENERGY_MARKER_H__
+#define ENERGY_MARKER_H__
+
+#include <stdint.h>
+#include "nrf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ENERGY_MARKER_ENABLED
+#define ENERGY_MARKER_ENABLED           0   /**< Set to 1 to drive the markers. */
+#endif
+
+#ifndef ENERGY_MARKER_RADIO_PIN
+#define ENERGY_MARKER_RADIO_PIN         14  /**< High while the radio is enabled. */
+#endif
+
+#ifndef ENERGY_MARKER_ID_PIN
+#define ENERGY_MARKER_ID_PIN            15  /**< Least significant bit of the phase ID. */
+#endif
+
+#define ENERGY_MARKER_ID_BITS           3   /**< Pins of the phase ID, contiguous from @ref ENERGY_MARKER_ID_PIN. */
+
+#define ENERGY_MARKER_ID_MASK           (((1UL << ENERGY_MARKER_ID_BITS) - 1) << ENERGY_MARKER_ID_PIN)
+#define ENERGY_MARKER_PIN_MASK          ((1UL << ENERGY_MARKER_RADIO_PIN) | ENERGY_MARKER_ID_MASK)
+
+#ifndef ENERGY_MARKER_GPIOTE_CH
+#define ENERGY_MARKER_GPIOTE_CH         7   /**< GPIOTE channel of the radio marker. Not reserved in the GPIOTE driver, which hands out channels from 0: the application must leave it free. */
+#endif
+
+#ifndef ENERGY_MARKER_PPI_CH_READY
+#define ENERGY_MARKER_PPI_CH_READY      15  /**< PPI channel from RADIO EVENTS_READY to GPIOTE TASKS_SET. */
+#endif
+
+#ifndef ENERGY_MARKER_PPI_CH_DISABLED
+#define ENERGY_MARKER_PPI_CH_DISABLED   16  /**< PPI channel from RADIO EVENTS_DISABLED to GPIOTE TASKS_CLR. */
+#endif
+
+/**@brief Phase IDs, as read on the phase pins. The decoder names them the same way. */
+typedef enum
+{
+    ENERGY_PHASE_NONE      = 0,     /**< No phase marked. */
+    ENERGY_PHASE_SAADC     = 1,     /**< Handling of SAADC samples, saadc_callback. */
+    ENERGY_PHASE_FDS_WRITE = 2,     /**< An FDS record written or updated. */
+    ENERGY_PHASE_NOTIFY    = 3,     /**< A notification encoded and queued; the radio marker shows it sent. */
+    ENERGY_PHASE_SLEEP     = 4,     /**< nrf_pwr_mgmt_run, with the interrupts it wakes for that mark no phase. */
+    ENERGY_PHASE_APP_1     = 5,     /**< Free for the application. */
+    ENERGY_PHASE_APP_2     = 6,     /**< Free for the application. */
+    ENERGY_PHASE_APP_3     = 7,     /**< Free for the application. */
+} energy_phase_t;
+
+
+#if ENERGY_MARKER_ENABLED
+/**@brief Function for setting up the marker pins and the radio marker.
+ *
+ * @details With a SoftDevice, the PPI channels are assigned through it when it is enabled, so
+ *          the function can be called before or after nrf_sdh_enable_request.
+ */
+void energy_marker_init(void);
+#else
+__STATIC_INLINE void energy_marker_init(void)
+{
+}
+#endif
+
+
+/**@brief Function for entering a phase.
+ *
+ * @param[in] phase  Phase entered.
+ *
+ * @return The phase left, to give to @ref energy_marker_end.
+ */
+__STATIC_INLINE energy_phase_t energy_marker_begin(energy_phase_t phase)
+{
+#if ENERGY_MARKER_ENABLED
+    uint32_t const out = NRF_P0->OUT;
+    uint32_t const id  = ((uint32_t)phase << ENERGY_MARKER_ID_PIN) & ENERGY_MARKER_ID_MASK;
+
+    NRF_P0->OUTCLR = ENERGY_MARKER_ID_MASK & ~id;
+    NRF_P0->OUTSET = id;
+
+    return (energy_phase_t)((out & ENERGY_MARKER_ID_MASK) >> ENERGY_MARKER_ID_PIN);
+#else
+    (void)phase;
+    return ENERGY_PHASE_NONE;
+#endif
+}
+
+
+/**@brief Function for leaving a phase.
+ *
+ * @param[in] previous  Phase returned by the matching @ref energy_marker_begin.
+ */
+__STATIC_INLINE void energy_marker_end(energy_phase_t previous)
+{
+    (void)energy_marker_begin(previous);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENERGY_MARKER_H__
+
+/** @} */
@@ -0,0 +1,187 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "sdk_common.h"
+#if NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN)
+#include "nrf_log_backend_bin.h"
+
+#include <string.h>
+#include "nrf_log_ctrl.h"
+#include "nrf_log_backend_interface.h"
+#include "nrf_log_internal.h"
+#include "nrf_memobj.h"
+#include "app_util_platform.h"
+
+#if NRF_LOG_BACKEND_BIN_USE_UART
+#include "nrf_drv_uart.h"
+#else
+#include "SEGGER_RTT.h"
+#endif
+
+#define STD_PAYLOAD_MAX     (sizeof(uint32_t) * (1 + NRF_LOG_MAX_NUM_OF_ARGS))
+#define FRAME_PAYLOAD_MAX   MAX(STD_PAYLOAD_MAX, NRF_LOG_BACKEND_BIN_HEXDUMP_MAX)
+
+STATIC_ASSERT(FRAME_PAYLOAD_MAX <= UINT8_MAX);
+
+
+static uint8_t m_frame[NRF_LOG_BACKEND_BIN_HEADER_SIZE + FRAME_PAYLOAD_MAX + 1];
+
+#if NRF_LOG_BACKEND_BIN_USE_UART
+static nrf_drv_uart_t m_uart = NRF_DRV_UART_INSTANCE(0);
+#else
+STATIC_ASSERT(NRF_LOG_BACKEND_BIN_RTT_CHANNEL < SEGGER_RTT_MAX_NUM_UP_BUFFERS);
+
+static uint8_t m_rtt_buffer[NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE];
+#endif
+
+
+/**@brief Function for handing a complete frame to the transport. */
+static void frame_write(uint32_t length)
+{
+#if NRF_LOG_BACKEND_BIN_USE_UART
+    // The driver is used in blocking mode, so the frame buffer can be reused on return.
+    (void)nrf_drv_uart_tx(&m_uart, m_frame, length);
+#else
+    // Skip mode: a frame is either written whole or not at all, so the stream never desyncs.
+    (void)SEGGER_RTT_Write(NRF_LOG_BACKEND_BIN_RTT_CHANNEL, m_frame, length);
+#endif
+}
+
+
+static void nrf_log_backend_bin_put(nrf_log_backend_t const * p_backend, nrf_log_entry_t * p_msg)
+{
+    nrf_log_header_t header = {0};
+    size_t           offset = HEADER_SIZE * sizeof(uint32_t);
+    uint8_t        * p_payload = &m_frame[NRF_LOG_BACKEND_BIN_HEADER_SIZE];
+    uint32_t         length;
+    uint8_t          kind;
+
+    nrf_memobj_get(p_msg);
+    nrf_memobj_read(p_msg, &header, HEADER_SIZE * sizeof(uint32_t), 0);
+
+    if (header.base.generic.type == HEADER_TYPE_STD)
+    {
+        uint32_t addr = header.base.std.addr;
+
+        memcpy(p_payload, &addr, sizeof(addr));
+        length = header.base.std.nargs * sizeof(uint32_t);
+        nrf_memobj_read(p_msg, p_payload + sizeof(addr), length, offset);
+        length += sizeof(addr);
+        kind    = NRF_LOG_BACKEND_BIN_KIND_STD;
+    }
+    else if (header.base.generic.type == HEADER_TYPE_HEXDUMP)
+    {
+        length = MIN(header.base.hexdump.len, NRF_LOG_BACKEND_BIN_HEXDUMP_MAX);
+        nrf_memobj_read(p_msg, p_payload, length, offset);
+        kind   = NRF_LOG_BACKEND_BIN_KIND_HEXDUMP;
+    }
+    else
+    {
+        nrf_memobj_put(p_msg);
+        return;
+    }
+
+    m_frame[0] = NRF_LOG_BACKEND_BIN_SYNC;
+    m_frame[1] = kind;
+    m_frame[2] = (uint8_t)header.base.std.severity;
+    m_frame[3] = (uint8_t)length;
+    (void)uint16_encode(header.module_id, &m_frame[4]);
+    (void)uint16_encode(header.dropped, &m_frame[6]);
+    (void)uint32_encode(header.timestamp, &m_frame[8]);
+
+    length += NRF_LOG_BACKEND_BIN_HEADER_SIZE;
+
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        sum += m_frame[i];
+    }
+    m_frame[length++] = (uint8_t)(0 - sum);
+
+    frame_write(length);
+
+    nrf_memobj_put(p_msg);
+}
+
+
+static void nrf_log_backend_bin_flush(nrf_log_backend_t const * p_backend)
+{
+    // Frames are written as soon as they are put.
+}
+
+
+static void nrf_log_backend_bin_panic_set(nrf_log_backend_t const * p_backend)
+{
+    // Both transports already write synchronously.
+}
+
+
+const nrf_log_backend_api_t nrf_log_backend_bin_api = {
+        .put       = nrf_log_backend_bin_put,
+        .flush     = nrf_log_backend_bin_flush,
+        .panic_set = nrf_log_backend_bin_panic_set,
+};
+
+NRF_LOG_BACKEND_DEF(m_log_backend_bin, nrf_log_backend_bin_api, NULL);
+
+
+ret_code_t nrf_log_backend_bin_init(void)
+{
+#if NRF_LOG_BACKEND_BIN_USE_UART
+    nrf_drv_uart_config_t config = NRF_DRV_UART_DEFAULT_CONFIG;
+
+    config.pseltxd  = NRF_LOG_BACKEND_UART_TX_PIN;
+    config.pselrxd  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselcts  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselrts  = NRF_UART_PSEL_DISCONNECTED;
+    config.baudrate = (nrf_uart_baudrate_t)NRF_LOG_BACKEND_UART_BAUDRATE;
+
+    // No event handler: blocking mode.
+    ret_code_t err_code = nrf_drv_uart_init(&m_uart, &config, NULL);
+    VERIFY_SUCCESS(err_code);
+#else
+    (void)SEGGER_RTT_ConfigUpBuffer(NRF_LOG_BACKEND_BIN_RTT_CHANNEL,
+                                    "nrf_log_bin",
+                                    m_rtt_buffer,
+                                    sizeof(m_rtt_buffer),
+                                    SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+
+    int32_t backend_id = nrf_log_backend_add(&m_log_backend_bin, NRF_LOG_SEVERITY_DEBUG);
+    if (backend_id < 0)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    nrf_log_backend_enable(&m_log_backend_bin);
+
+    return NRF_SUCCESS;
+}
+
+#endif // NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN)
@@ -0,0 +1,105 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup nrf_log_backend_bin Binary log backend
+ * @{
+ * @ingroup  nrf_log
+ * @brief    nrf_log backend that ships log entries undecoded, for formatting on the host.
+ *
+ * @details In deferred mode the logger frontend only stores the address of the format string and
+ *          the raw 32-bit arguments. This backend copies that data into a small binary frame and
+ *          writes it to an RTT up channel or to the UART, so no string formatting is done on the
+ *          device at all. The host tool in tools/nrf_log_bin resolves the format string and the
+ *          module name from the ELF file of the running firmware.
+ *
+ *          Frame layout, little-endian:
+ *          | Offset | Size | Field                                              |
+ *          |--------|------|----------------------------------------------------|
+ *          | 0      | 1    | Sync byte, @ref NRF_LOG_BACKEND_BIN_SYNC           |
+ *          | 1      | 1    | Entry kind, @ref nrf_log_backend_bin_kind_t        |
+ *          | 2      | 1    | Severity level                                     |
+ *          | 3      | 1    | Payload length in bytes                            |
+ *          | 4      | 2    | Module ID (index in the log_const_data section)    |
+ *          | 6      | 2    | Number of entries dropped before this one          |
+ *          | 8      | 4    | Timestamp (0 if NRF_LOG_USES_TIMESTAMP is off)     |
+ *          | 12     | n    | Payload                                            |
+ *          | 12 + n | 1    | Checksum, makes the byte sum of the frame zero     |
+ *
+ *          The payload of a standard entry is the format string address followed by the
+ *          arguments, 4 bytes each. The payload of a hexdump entry is the data, truncated to
+ *          @ref NRF_LOG_BACKEND_BIN_HEXDUMP_MAX bytes.
+ *
+ * @note    String arguments (%s) are sent as pointers. Strings in flash are resolved by the host
+ *          tool; strings in RAM, including those pushed with NRF_LOG_PUSH, are not.
+ */
+#ifndef NRF_LOG_BACKEND_BIN_H__
+#define NRF_LOG_BACKEND_BIN_H__
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NRF_LOG_BACKEND_BIN_SYNC         0xA5   /**< First byte of every frame. */
+#define NRF_LOG_BACKEND_BIN_HEADER_SIZE  12     /**< Size of the frame header, in bytes. */
+
+#ifndef NRF_LOG_BACKEND_BIN_HEXDUMP_MAX
+#define NRF_LOG_BACKEND_BIN_HEXDUMP_MAX  64     /**< Hexdump entries longer than this are truncated. */
+#endif
+
+/**@brief Kind of log entry carried in a frame. */
+typedef enum
+{
+    NRF_LOG_BACKEND_BIN_KIND_STD     = 0,   /**< Format string address and arguments. */
+    NRF_LOG_BACKEND_BIN_KIND_HEXDUMP = 1,   /**< Raw data bytes. */
+} nrf_log_backend_bin_kind_t;
+
+
+/**@brief Function for initializing the transport and registering the backend with the logger.
+ *
+ * @details Call after @c NRF_LOG_INIT, instead of @c NRF_LOG_DEFAULT_BACKENDS_INIT. The backend
+ *          is enabled for all severity levels; filtering is left to the frontend.
+ *
+ * @retval NRF_SUCCESS      The backend was registered and enabled.
+ * @retval NRF_ERROR_NO_MEM The logger has no free backend slot.
+ * @return Other error codes returned by the UART driver.
+ */
+ret_code_t nrf_log_backend_bin_init(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_LOG_BACKEND_BIN_H__
+
+/** @} */
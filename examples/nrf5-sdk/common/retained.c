@@ -0,0 +1,130 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "retained.h"
+
+#include <string.h>
+#include "nrf.h"
+#include "crc16.h"
+#include "sdk_macros.h"
+#if defined(SOFTDEVICE_PRESENT)
+#include "nrf_sdh.h"
+#include "nrf_soc.h"
+#endif
+
+#define RAM_BASE            0x20000000UL    /**< Start of the data RAM. */
+#define RAM_SECTION_SIZE    0x1000UL        /**< Each RAM block has two sections of 4 kB that are retained separately. */
+#define RAM_BLOCK_SECTIONS  2
+
+extern uint8_t __start_noinit[];            /**< Provided by the linker script. */
+extern uint8_t __stop_noinit[];
+
+static uint32_t m_reset_reason;             /**< RESETREAS at boot. */
+
+
+void retained_init(void)
+{
+    m_reset_reason = NRF_POWER->RESETREAS;
+
+    // The register is cumulative; clear it so the next boot sees only its own reason.
+    NRF_POWER->RESETREAS = m_reset_reason;
+
+    if (m_reset_reason == 0)
+    {
+        // Power-on or brownout: the RAM content is undefined.
+        memset(__start_noinit, 0, __stop_noinit - __start_noinit);
+    }
+}
+
+
+uint32_t retained_reset_reason_get(void)
+{
+    return m_reset_reason;
+}
+
+
+bool retained_wakeup_from_off(void)
+{
+    return (m_reset_reason & (POWER_RESETREAS_OFF_Msk  |
+                              POWER_RESETREAS_NFC_Msk  |
+                              POWER_RESETREAS_DIF_Msk  |
+                              POWER_RESETREAS_LPCOMP_Msk)) != 0;
+}
+
+
+bool retained_is_valid(retained_hdr_t const * p_hdr, void const * p_data, uint16_t size, uint16_t version)
+{
+    return (p_hdr->magic   == RETAINED_MAGIC) &&
+           (p_hdr->size    == size)           &&
+           (p_hdr->version == version)        &&
+           (p_hdr->crc     == crc16_compute(p_data, size, NULL));
+}
+
+
+void retained_store(retained_hdr_t * p_hdr, void const * p_data, uint16_t size, uint16_t version)
+{
+    // Invalidate first, so a reset between the two writes leaves no stale header behind.
+    p_hdr->magic   = 0;
+    p_hdr->size    = size;
+    p_hdr->version = version;
+    p_hdr->crc     = crc16_compute(p_data, size, NULL);
+    p_hdr->magic   = RETAINED_MAGIC;
+}
+
+
+void retained_invalidate(retained_hdr_t * p_hdr)
+{
+    p_hdr->magic = 0;
+}
+
+
+ret_code_t retained_ram_retain(void)
+{
+    uint32_t start = (uint32_t)__start_noinit - RAM_BASE;
+    uint32_t end   = (uint32_t)__stop_noinit - RAM_BASE;
+
+    for (uint32_t section = start / RAM_SECTION_SIZE; section * RAM_SECTION_SIZE < end; section++)
+    {
+        uint8_t  block = section / RAM_BLOCK_SECTIONS;
+        uint32_t mask  = (section % RAM_BLOCK_SECTIONS) ? POWER_RAM_POWERSET_S1RETENTION_Msk
+                                                        : POWER_RAM_POWERSET_S0RETENTION_Msk;
+
+#if defined(SOFTDEVICE_PRESENT)
+        if (nrf_sdh_is_enabled())
+        {
+            ret_code_t err_code = sd_power_ram_power_set(block, mask);
+            VERIFY_SUCCESS(err_code);
+            continue;
+        }
+#endif
+        NRF_POWER->RAM[block].POWERSET = mask;
+    }
+
+    return NRF_SUCCESS;
+}
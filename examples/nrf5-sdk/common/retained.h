@@ -0,0 +1,153 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup retained Retained RAM records
+ * @{
+ * @brief State kept in RAM across System OFF and resets, so a warm boot can skip rebuilding it.
+ *
+ * @details Records are defined with @ref RETAINED_DEF and placed in the .noinit section, which the
+ *          startup code neither copies nor zeroes. Each record carries a header with a magic
+ *          value, its size, a version and a CRC16 of its data. A record is only used after
+ *          @ref retained_is_valid has checked the header against the data, so anything from a power-on
+ *          reset, an older firmware or a write cut short by a reset is rebuilt as on a cold boot.
+ *
+ *          On a power-on or brownout reset @ref retained_init clears the whole section.
+ *          RAM is not retained in System OFF by default. @ref retained_ram_retain must be called just
+ *          before entering System OFF. It turns on retention for the RAM sections that hold .noinit
+ *          and for no others.
+ *
+ *          The linker script must provide a .noinit (NOLOAD) section placed after .bss, bounded by
+ *          __start_noinit and __stop_noinit.
+ */
+#ifndef RETAINED_H__
+#define RETAINED_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Header of a retained record. */
+typedef struct
+{
+    uint32_t magic;     /**< @ref RETAINED_MAGIC while the record holds data. */
+    uint16_t size;      /**< Size of the data, in bytes. */
+    uint16_t version;   /**< Layout version given when the data was stored. */
+    uint16_t crc;       /**< CRC16 of the data. */
+    uint16_t reserved;
+} retained_hdr_t;
+
+#define RETAINED_MAGIC  0x4E544552UL    /**< "RETN". */
+
+/**@brief Macro for defining a retained record.
+ *
+ * @param[in] _name  Name of the record.
+ * @param[in] _type  Type of the data held by the record.
+ */
+#define RETAINED_DEF(_name, _type)                                              \
+    static struct                                                               \
+    {                                                                           \
+        retained_hdr_t hdr;                                                     \
+        _type          data;                                                    \
+    } _name __attribute__((section(".noinit"), aligned(4)))
+
+/**@brief Macro for checking a record defined with @ref RETAINED_DEF. */
+#define RETAINED_IS_VALID(_name, _version) \
+    retained_is_valid(&(_name).hdr, &(_name).data, sizeof((_name).data), (_version))
+
+/**@brief Macro for sealing a record defined with @ref RETAINED_DEF after its data was written. */
+#define RETAINED_STORE(_name, _version) \
+    retained_store(&(_name).hdr, &(_name).data, sizeof((_name).data), (_version))
+
+/**@brief Macro for invalidating a record defined with @ref RETAINED_DEF. */
+#define RETAINED_INVALIDATE(_name) \
+    retained_invalidate(&(_name).hdr)
+
+
+/**@brief Function for initializing the module.
+ *
+ * @details Reads and clears RESETREAS, and clears all records after a power-on or brownout reset.
+ *          Must be called before the SoftDevice is enabled.
+ */
+void retained_init(void);
+
+
+/**@brief Function for getting the reset reason read by @ref retained_init.
+ *
+ * @return Value of RESETREAS, 0 for a power-on or brownout reset.
+ */
+uint32_t retained_reset_reason_get(void);
+
+
+/**@brief Function for checking whether the boot is a wake-up from System OFF. */
+bool retained_wakeup_from_off(void);
+
+
+/**@brief Function for checking a record.
+ *
+ * @param[in] p_hdr    Header of the record.
+ * @param[in] p_data   Data of the record.
+ * @param[in] size     Size of the data.
+ * @param[in] version  Layout version expected by the caller.
+ *
+ * @retval true   The data was stored with the same size and version and is intact.
+ * @retval false  The data must be rebuilt.
+ */
+bool retained_is_valid(retained_hdr_t const * p_hdr, void const * p_data, uint16_t size, uint16_t version);
+
+
+/**@brief Function for sealing a record after its data was written. */
+void retained_store(retained_hdr_t * p_hdr, void const * p_data, uint16_t size, uint16_t version);
+
+
+/**@brief Function for invalidating a record. */
+void retained_invalidate(retained_hdr_t * p_hdr);
+
+
+/**@brief Function for retaining the RAM sections holding the records in System OFF.
+ *
+ * @details Goes through the SoftDevice when it is enabled.
+ *
+ * @return NRF_SUCCESS, or the error returned by the SoftDevice.
+ */
+ret_code_t retained_ram_retain(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RETAINED_H__
+
+/** @} */
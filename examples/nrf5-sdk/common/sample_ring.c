@@ -0,0 +1,154 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "sample_ring.h"
+
+#include <stddef.h>
+#include "nrf.h"
+#include "nrf_assert.h"
+
+
+static uint8_t * block_get(sample_ring_t const * p_ring, uint32_t seq)
+{
+    return &p_ring->p_blocks[(seq & (p_ring->block_count - 1)) * p_ring->block_size];
+}
+
+
+/**@brief Function for getting the number of published blocks the producer has not taken back. */
+static uint32_t window_get(sample_ring_t const * p_ring)
+{
+    return p_ring->block_count - p_ring->reserve;
+}
+
+
+ret_code_t sample_ring_reserve_set(sample_ring_t * p_ring, uint8_t reserve)
+{
+    if ((reserve == 0) || (reserve >= p_ring->block_count))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_ring->reserve = reserve;
+    return NRF_SUCCESS;
+}
+
+
+void * sample_ring_write_get(sample_ring_t const * p_ring, uint32_t ahead)
+{
+    ASSERT(ahead < p_ring->reserve);
+
+    return block_get(p_ring, p_ring->head + ahead);
+}
+
+
+void sample_ring_publish(sample_ring_t * p_ring)
+{
+    // The block must be complete before it is seen as published.
+    __DMB();
+    p_ring->head++;
+}
+
+
+ret_code_t sample_ring_consumer_add(sample_ring_t * p_ring, uint8_t * p_consumer)
+{
+    for (uint8_t i = 0; i < p_ring->consumer_max; i++)
+    {
+        sample_ring_cursor_t * p_cursor = &p_ring->p_cursors[i];
+
+        if (!p_cursor->in_use)
+        {
+            p_cursor->seq      = p_ring->head;
+            p_cursor->overruns = 0;
+            p_cursor->in_use   = true;
+            *p_consumer        = i;
+            return NRF_SUCCESS;
+        }
+    }
+
+    return NRF_ERROR_NO_MEM;
+}
+
+
+void const * sample_ring_peek(sample_ring_t * p_ring, uint8_t consumer, uint32_t * p_seq)
+{
+    sample_ring_cursor_t * p_cursor = &p_ring->p_cursors[consumer];
+    uint32_t               head     = p_ring->head;
+    uint32_t               window   = window_get(p_ring);
+
+    ASSERT(consumer < p_ring->consumer_max);
+
+    if (head - p_cursor->seq > window)
+    {
+        // The producer has lapped this consumer: skip to the oldest block it has not taken back.
+        p_cursor->overruns += (head - window) - p_cursor->seq;
+        p_cursor->seq       = head - window;
+    }
+
+    if (p_cursor->seq == head)
+    {
+        return NULL;
+    }
+
+    // Do not read the block before the count that published it.
+    __DMB();
+
+    if (p_seq != NULL)
+    {
+        *p_seq = p_cursor->seq;
+    }
+    return block_get(p_ring, p_cursor->seq);
+}
+
+
+bool sample_ring_release(sample_ring_t * p_ring, uint8_t consumer)
+{
+    sample_ring_cursor_t * p_cursor = &p_ring->p_cursors[consumer];
+    bool                   intact;
+
+    ASSERT(consumer < p_ring->consumer_max);
+
+    // Every read of the block must be done before the count is checked again. The producer
+    // counts a block as published before it takes back the one a full window older.
+    __DMB();
+    intact = (p_ring->head - p_cursor->seq) <= window_get(p_ring);
+
+    if (!intact)
+    {
+        p_cursor->overruns++;
+    }
+    p_cursor->seq++;
+
+    return intact;
+}
+
+
+uint32_t sample_ring_overruns_get(sample_ring_t const * p_ring, uint8_t consumer)
+{
+    return p_ring->p_cursors[consumer].overruns;
+}
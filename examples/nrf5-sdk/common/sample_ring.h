@@ -0,0 +1,174 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup sample_ring Sample block ring
+ * @{
+ * @brief Single-producer, multi-consumer ring of fixed-size sample blocks, read in place.
+ *
+ * @details The producer fills blocks in order, DMA writing straight into them if it likes, and
+ *          publishes each one when it is complete. It never waits for the consumers. Each consumer
+ *          has its own read cursor and gets the blocks by reference with @ref sample_ring_peek,
+ *          so the samples are not copied for anyone. When it is done with a block it calls
+ *          @ref sample_ring_release.
+ *
+ *          The producer holds the @ref sample_ring_t::reserve blocks after the last published one,
+ *          because a DMA producer works on a current and a next buffer. Of the other blocks,
+ *          the published ones stay stable until the producer wraps around to them. A consumer
+ *          that falls further behind skips to the oldest stable block. The blocks it missed are
+ *          added to its overrun count. A block that the producer took back while it was being read
+ *          makes @ref sample_ring_release return false, and it is counted as an overrun too. That
+ *          also covers a consumer that keeps the block until an asynchronous user of it, such as
+ *          fds_record_write, has completed.
+ *
+ *          Nothing is locked. The published count is only written by the producer and each
+ *          cursor only by its consumer, so the producer may run in an interrupt. Each consumer
+ *          must be used from one context only.
+ */
+#ifndef SAMPLE_RING_H__
+#define SAMPLE_RING_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "app_util.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Read cursor of a consumer. */
+typedef struct
+{
+    uint32_t seq;           /**< Sequence number of the next block to read. */
+    uint32_t overruns;      /**< Blocks lost because the producer overwrote them first. */
+    bool     in_use;
+} sample_ring_cursor_t;
+
+/**@brief Ring instance. Use @ref SAMPLE_RING_DEF to define one. */
+typedef struct
+{
+    uint8_t              * p_blocks;
+    sample_ring_cursor_t * p_cursors;
+    uint16_t               block_size;      /**< Size of a block, in bytes. */
+    uint16_t               block_count;     /**< Number of blocks, a power of two. */
+    uint8_t                consumer_max;
+    uint8_t                reserve;         /**< Blocks held by the producer after the last published one. */
+    volatile uint32_t      head;            /**< Number of blocks published. */
+} sample_ring_t;
+
+/**@brief Macro for defining a ring.
+ *
+ * @param[in] _name          Name of the instance.
+ * @param[in] _block_size    Size of a block, in bytes; a multiple of 4.
+ * @param[in] _block_count   Number of blocks, a power of two.
+ * @param[in] _consumer_max  Maximum number of consumers.
+ */
+#define SAMPLE_RING_DEF(_name, _block_size, _block_count, _consumer_max)                \
+    STATIC_ASSERT(IS_POWER_OF_TWO(_block_count) && (((_block_size) % 4) == 0));          \
+    static uint8_t CONCAT_2(_name, _blocks)[(_block_count) * (_block_size)] __ALIGN(4);  \
+    static sample_ring_cursor_t CONCAT_2(_name, _cursors)[(_consumer_max)];              \
+    static sample_ring_t _name =                                                         \
+    {                                                                                    \
+        .p_blocks     = CONCAT_2(_name, _blocks),                                        \
+        .p_cursors    = CONCAT_2(_name, _cursors),                                       \
+        .block_size   = (_block_size),                                                   \
+        .block_count  = (_block_count),                                                  \
+        .consumer_max = (_consumer_max),                                                 \
+        .reserve      = 1,                                                               \
+    }
+
+
+/**@brief Function for setting how many blocks the producer holds.
+ *
+ * @details Must be called before the producer starts.
+ *
+ * @retval NRF_SUCCESS              The reserve was set.
+ * @retval NRF_ERROR_INVALID_PARAM  The reserve leaves no block for the consumers.
+ */
+ret_code_t sample_ring_reserve_set(sample_ring_t * p_ring, uint8_t reserve);
+
+
+/**@brief Function for getting a block held by the producer.
+ *
+ * @param[in] p_ring  Ring instance.
+ * @param[in] ahead   0 for the block published next, up to the reserve minus one.
+ *
+ * @return Start of the block.
+ */
+void * sample_ring_write_get(sample_ring_t const * p_ring, uint32_t ahead);
+
+
+/**@brief Function for publishing the block at @p ahead 0 to the consumers. */
+void sample_ring_publish(sample_ring_t * p_ring);
+
+
+/**@brief Function for adding a consumer. It reads blocks published from now on.
+ *
+ * @param[in]  p_ring      Ring instance.
+ * @param[out] p_consumer  Identifier of the consumer.
+ *
+ * @retval NRF_SUCCESS       The consumer was added.
+ * @retval NRF_ERROR_NO_MEM  The ring already has its maximum number of consumers.
+ */
+ret_code_t sample_ring_consumer_add(sample_ring_t * p_ring, uint8_t * p_consumer);
+
+
+/**@brief Function for getting the oldest block a consumer has not read.
+ *
+ * @param[in]  p_ring    Ring instance.
+ * @param[in]  consumer  Identifier of the consumer.
+ * @param[out] p_seq     Sequence number of the block. Can be NULL.
+ *
+ * @return Start of the block, or NULL if the consumer has read every published block.
+ */
+void const * sample_ring_peek(sample_ring_t * p_ring, uint8_t consumer, uint32_t * p_seq);
+
+
+/**@brief Function for releasing the block returned by @ref sample_ring_peek.
+ *
+ * @retval true   The block was not touched while the consumer had it.
+ * @retval false  The producer took the block back meanwhile; what was read from it is not
+ *                reliable.
+ */
+bool sample_ring_release(sample_ring_t * p_ring, uint8_t consumer);
+
+
+/**@brief Function for getting the number of blocks a consumer lost. */
+uint32_t sample_ring_overruns_get(sample_ring_t const * p_ring, uint8_t consumer);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAMPLE_RING_H__
+
+/** @} */
@@ -0,0 +1,197 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "tick_sched.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "nrf_drv_rtc.h"
+#include "app_util_platform.h"
+
+#define RTC_COUNTER_MASK    0x00FFFFFFUL                                            /**< The RTC counter is 24 bits wide. */
+#define SLOT_COUNTS         ROUNDED_DIV(TICK_SCHED_SLOT_MS * 32768UL, 1000)         /**< RTC counts per slot, at prescaler 0. */
+#define MAX_PERIOD          ((RTC_COUNTER_MASK / 2) / SLOT_COUNTS)                  /**< Longest period that leaves room to detect an overrun. */
+
+static const nrf_drv_rtc_t m_rtc = NRF_DRV_RTC_INSTANCE(TICK_SCHED_RTC_INSTANCE);
+
+static tick_sched_task_t * m_tasks[TICK_SCHED_MAX_TASKS];   /**< Tasks, in order of addition. */
+static uint32_t            m_task_count;                    /**< Number of tasks added. */
+static uint32_t            m_slot;                          /**< Slot being, or last, run. */
+static uint32_t            m_cc;                            /**< Counter value at the start of m_slot. */
+static bool                m_running;                       /**< Whether the scheduler was started. */
+static tick_sched_stats_t  m_stats;                         /**< Statistics. */
+
+
+/**@brief Function for running all tasks due in the current slot.
+ *
+ * @return Number of tasks run.
+ */
+static uint32_t slot_run(void)
+{
+    uint32_t ran = 0;
+
+    for (uint32_t i = 0; i < m_task_count; i++)
+    {
+        tick_sched_task_t * p_task = m_tasks[i];
+
+        if (p_task->next_due == m_slot)
+        {
+            p_task->handler(p_task->p_context);
+            p_task->next_due += p_task->period;
+            ran++;
+        }
+    }
+
+    return ran;
+}
+
+
+/**@brief Function for moving to the next slot in which a task is due and setting the compare.
+ *
+ * @retval true  The compare is set.
+ * @retval false The slot has already started; it must be run without waiting for the compare.
+ */
+static bool next_slot_schedule(void)
+{
+    uint32_t next = m_tasks[0]->next_due;
+
+    for (uint32_t i = 1; i < m_task_count; i++)
+    {
+        if ((int32_t)(m_tasks[i]->next_due - next) < 0)
+        {
+            next = m_tasks[i]->next_due;
+        }
+    }
+
+    uint32_t const delta = (next - m_slot) * SLOT_COUNTS;
+
+    m_slot = next;
+    m_cc   = (m_cc + delta) & RTC_COUNTER_MASK;
+
+    // The compare does not fire if it is set less than two counts ahead of the counter.
+    uint32_t const ahead = (m_cc - nrf_drv_rtc_counter_get(&m_rtc)) & RTC_COUNTER_MASK;
+    if ((ahead < 2) || (ahead > delta))
+    {
+        return false;
+    }
+
+    (void)nrf_drv_rtc_cc_set(&m_rtc, 0, m_cc, true);
+    return true;
+}
+
+
+/**@brief Function for handling the RTC interrupt. */
+static void rtc_handler(nrf_drv_rtc_int_type_t int_type)
+{
+    if (int_type != NRF_DRV_RTC_INT_COMPARE0)
+    {
+        return;
+    }
+
+    m_stats.wakeups++;
+
+    uint32_t ran = 0;
+    do
+    {
+        ran += slot_run();
+    } while (!next_slot_schedule());
+
+    m_stats.task_runs += ran;
+    if (ran > 1)
+    {
+        m_stats.coalesced += ran - 1;
+    }
+}
+
+
+ret_code_t tick_sched_init(void)
+{
+    nrf_drv_rtc_config_t config = NRF_DRV_RTC_DEFAULT_CONFIG;
+
+    config.prescaler = 0;
+
+    m_task_count = 0;
+    m_running    = false;
+
+    return nrf_drv_rtc_init(&m_rtc, &config, rtc_handler);
+}
+
+
+ret_code_t tick_sched_task_add(tick_sched_task_t * p_task)
+{
+    if (m_running)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_task->period == 0) || (p_task->period > MAX_PERIOD) || (p_task->phase >= p_task->period))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_task_count == TICK_SCHED_MAX_TASKS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_task->next_due = (p_task->phase == 0) ? p_task->period : p_task->phase;
+
+    m_tasks[m_task_count++] = p_task;
+
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t tick_sched_start(void)
+{
+    if (m_running || (m_task_count == 0))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    nrf_drv_rtc_counter_clear(&m_rtc);
+    m_slot    = 0;
+    m_cc      = 0;
+    m_running = true;
+
+    // The counter is stopped, so the first compare is always far enough ahead.
+    (void)next_slot_schedule();
+
+    nrf_drv_rtc_enable(&m_rtc);
+
+    return NRF_SUCCESS;
+}
+
+
+void tick_sched_stats_get(tick_sched_stats_t * p_stats)
+{
+    CRITICAL_REGION_ENTER();
+    *p_stats = m_stats;
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,143 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup tick_sched Aligned tick scheduler
+ * @{
+ * @brief Cooperative scheduler for periodic tasks, driven by a single RTC compare.
+ *
+ * @details Time is divided into slots of @ref TICK_SCHED_SLOT_MS. Each task runs every
+ *          @ref tick_sched_task_t::period slots, offset by @ref tick_sched_task_t::phase slots,
+ *          so all tasks share one grid and never drift against each other. The RTC compare is
+ *          set directly to the next slot in which any task is due, so empty slots cost nothing.
+ *          Tasks due in the same slot run back to back from one interrupt, in the order in which
+ *          they were added.
+ *
+ *          Tasks run in the RTC interrupt, at RTC_DEFAULT_CONFIG_IRQ_PRIORITY.
+ *
+ *          The compare values are accumulated rather than read back from the counter, so the grid
+ *          does not slip when a task runs long. If the tasks overrun the next slot, that
+ *          slot is run straight away from the same interrupt.
+ */
+#ifndef TICK_SCHED_H__
+#define TICK_SCHED_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TICK_SCHED_RTC_INSTANCE
+#define TICK_SCHED_RTC_INSTANCE 2       /**< RTC used by the scheduler. RTC0 belongs to the SoftDevice and RTC1 to app_timer. */
+#endif
+
+#ifndef TICK_SCHED_SLOT_MS
+#define TICK_SCHED_SLOT_MS      100     /**< Length of a slot, in milliseconds. */
+#endif
+
+#ifndef TICK_SCHED_MAX_TASKS
+#define TICK_SCHED_MAX_TASKS    8       /**< Maximum number of tasks. */
+#endif
+
+/**@brief Macro for converting milliseconds to slots. The value should be a multiple of
+ *        @ref TICK_SCHED_SLOT_MS. */
+#define TICK_SCHED_MS_TO_SLOTS(_ms)  ((uint16_t)((_ms) / TICK_SCHED_SLOT_MS))
+
+/**@brief Task handler type.
+ *
+ * @param[in] p_context  Context given in the task.
+ */
+typedef void (*tick_sched_handler_t)(void * p_context);
+
+/**@brief Periodic task. Must stay valid while the scheduler runs. */
+typedef struct
+{
+    tick_sched_handler_t handler;   /**< Function to run. */
+    void               * p_context; /**< Argument passed to the handler. */
+    uint16_t             period;    /**< Period, in slots. */
+    uint16_t             phase;     /**< Offset of the runs within the period, in slots. Must be less than the period. */
+    uint32_t             next_due;  /**< Private: slot of the next run. */
+} tick_sched_task_t;
+
+/**@brief Scheduler statistics. */
+typedef struct
+{
+    uint32_t wakeups;   /**< RTC interrupts taken. */
+    uint32_t task_runs; /**< Task handlers run. */
+    uint32_t coalesced; /**< Task runs that shared a wakeup with an earlier task, i.e. wakeups saved compared to one timer per task. */
+} tick_sched_stats_t;
+
+
+/**@brief Function for initializing the scheduler and its RTC.
+ *
+ * @details The low-frequency clock must be running; with a SoftDevice it always is.
+ *
+ * @retval NRF_SUCCESS  The scheduler was initialized.
+ * @return Error codes returned by nrf_drv_rtc_init.
+ */
+ret_code_t tick_sched_init(void);
+
+
+/**@brief Function for adding a task. Tasks can only be added before @ref tick_sched_start.
+ *
+ * @param[in] p_task  Task. Its first run is in slot @p phase, or in slot @p period if the phase is 0.
+ *
+ * @retval NRF_SUCCESS             The task was added.
+ * @retval NRF_ERROR_INVALID_PARAM The period is zero, too long for the RTC, or not above the phase.
+ * @retval NRF_ERROR_INVALID_STATE The scheduler is already running.
+ * @retval NRF_ERROR_NO_MEM        @ref TICK_SCHED_MAX_TASKS tasks were already added.
+ */
+ret_code_t tick_sched_task_add(tick_sched_task_t * p_task);
+
+
+/**@brief Function for starting the scheduler. Slot 0 begins now.
+ *
+ * @retval NRF_SUCCESS             The scheduler was started.
+ * @retval NRF_ERROR_INVALID_STATE No tasks were added, or the scheduler is already running.
+ */
+ret_code_t tick_sched_start(void);
+
+
+/**@brief Function for reading the scheduler statistics.
+ *
+ * @param[out] p_stats  Statistics since @ref tick_sched_start.
+ */
+void tick_sched_stats_get(tick_sched_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TICK_SCHED_H__
+
+/** @} */
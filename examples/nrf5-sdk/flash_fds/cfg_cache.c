@@ -0,0 +1,289 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "cfg_cache.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_pwr_mgmt.h"
+#include "fds.h"
+#include "fds_index.h"
+#include "energy_marker.h"
+
+static struct
+{
+    configuration_t   shadow;                   //!< The configuration.
+    configuration_t   flash_copy;               //!< Data of the record being written; FDS reads it until the write completes.
+    bool     volatile dirty;                    //!< @ref shadow differs from flash.
+    bool     volatile in_flight;                //!< A write is queued in FDS.
+    bool     volatile flush_asap;               //!< Write again as soon as the write in progress completes.
+    bool     volatile shutdown_pending;         //!< nrf_pwr_mgmt waits for the write.
+    energy_phase_t    write_phase;              //!< Phase to go back to when the write completes.
+    uint32_t          changes;
+    uint32_t          writes;
+} m_cache;
+
+APP_TIMER_DEF(m_quiet_timer);
+
+
+static void quiet_timer_restart(void)
+{
+    (void) app_timer_stop(m_quiet_timer);
+    (void) app_timer_start(m_quiet_timer, APP_TIMER_TICKS(CFG_CACHE_QUIET_MS), NULL);
+}
+
+
+static void quiet_timer_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (cfg_cache_flush() != NRF_SUCCESS)
+    {
+        /* Most likely the FDS queue is full; try again later. */
+        quiet_timer_restart();
+    }
+}
+
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    if (   ((p_evt->id != FDS_EVT_WRITE) && (p_evt->id != FDS_EVT_UPDATE))
+        || (p_evt->write.file_id    != CONFIG_FILE)
+        || (p_evt->write.record_key != CONFIG_REC_KEY)
+        || !m_cache.in_flight)
+    {
+        return;
+    }
+
+    m_cache.in_flight = false;
+    energy_marker_end(m_cache.write_phase);
+
+    if (p_evt->result != FDS_SUCCESS)
+    {
+        m_cache.dirty = true;
+    }
+
+    if (m_cache.dirty)
+    {
+        if (m_cache.flush_asap || m_cache.shutdown_pending)
+        {
+            m_cache.flush_asap = false;
+            if (cfg_cache_flush() == NRF_SUCCESS)
+            {
+                return;
+            }
+
+            /* Most likely the FDS queue is full; try again later. */
+            quiet_timer_restart();
+        }
+        else
+        {
+            quiet_timer_restart();
+            return;
+        }
+    }
+
+    if (m_cache.shutdown_pending)
+    {
+        /* Written, or it cannot be written: let the shutdown go on either way. */
+        m_cache.shutdown_pending = false;
+        nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_CONTINUE);
+    }
+}
+
+
+static bool shutdown_handler(nrf_pwr_mgmt_evt_t event)
+{
+    UNUSED_PARAMETER(event);
+
+    if (!m_cache.dirty && !m_cache.in_flight)
+    {
+        return true;
+    }
+
+    m_cache.shutdown_pending = true;
+
+    if (cfg_cache_flush() != NRF_SUCCESS)
+    {
+        /* The configuration cannot be saved; do not hold up the shutdown. */
+        m_cache.shutdown_pending = false;
+        return true;
+    }
+
+    /* fds_evt_handler continues the shutdown once the record is written. */
+    return false;
+}
+
+NRF_PWR_MGMT_HANDLER_REGISTER(shutdown_handler, CFG_CACHE_SHUTDOWN_PRIO);
+
+
+ret_code_t cfg_cache_init(void)
+{
+    ret_code_t rc;
+
+    memset(&m_cache, 0, sizeof(m_cache));
+
+    rc = app_timer_create(&m_quiet_timer, APP_TIMER_MODE_SINGLE_SHOT, quiet_timer_handler);
+    VERIFY_SUCCESS(rc);
+
+    return fds_register(fds_evt_handler);
+}
+
+
+ret_code_t cfg_cache_load(configuration_t const * p_default)
+{
+    fds_record_desc_t  desc = {0};
+    fds_flash_record_t frec = {0};
+
+    if (   (fds_index_find(CONFIG_FILE, CONFIG_REC_KEY, &desc) == FDS_SUCCESS)
+        && (fds_record_open(&desc, &frec) == FDS_SUCCESS))
+    {
+        memcpy(&m_cache.shadow, frec.p_data, sizeof(configuration_t));
+        (void) fds_record_close(&desc);
+
+        return FDS_SUCCESS;
+    }
+
+    m_cache.shadow = *p_default;
+    m_cache.dirty  = true;
+    quiet_timer_restart();
+
+    return FDS_ERR_NOT_FOUND;
+}
+
+
+configuration_t const * cfg_cache_get(void)
+{
+    return &m_cache.shadow;
+}
+
+
+void cfg_cache_set(configuration_t const * p_cfg)
+{
+    bool changed;
+
+    CRITICAL_REGION_ENTER();
+
+    changed = (memcmp(&m_cache.shadow, p_cfg, sizeof(configuration_t)) != 0);
+    if (changed)
+    {
+        m_cache.shadow = *p_cfg;
+        m_cache.dirty  = true;
+        m_cache.changes++;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    if (changed)
+    {
+        quiet_timer_restart();
+    }
+}
+
+
+ret_code_t cfg_cache_flush(void)
+{
+    bool start = false;
+
+    /* Called from the main loop, the quiet timer and the FDS event handler. */
+    CRITICAL_REGION_ENTER();
+
+    if (m_cache.dirty)
+    {
+        if (m_cache.in_flight)
+        {
+            m_cache.flush_asap = true;
+        }
+        else
+        {
+            m_cache.flash_copy = m_cache.shadow;
+            m_cache.dirty      = false;
+            m_cache.in_flight  = true;
+            start              = true;
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    if (!start)
+    {
+        return NRF_SUCCESS;
+    }
+
+    (void) app_timer_stop(m_quiet_timer);
+
+    ret_code_t         rc;
+    fds_record_desc_t  desc = {0};
+    fds_record_t const rec  =
+    {
+        .file_id           = CONFIG_FILE,
+        .key               = CONFIG_REC_KEY,
+        .data.p_data       = &m_cache.flash_copy,
+        /* The length of a record is always expressed in 4-byte units (words). */
+        .data.length_words = (sizeof(configuration_t) + 3) / sizeof(uint32_t),
+    };
+
+    /* Marked until the FDS event: queued from an FDS event handler, the write only runs once the
+     * handler has returned. */
+    m_cache.write_phase = energy_marker_begin(ENERGY_PHASE_FDS_WRITE);
+    if (fds_index_find(CONFIG_FILE, CONFIG_REC_KEY, &desc) == FDS_SUCCESS)
+    {
+        rc = fds_record_update(&desc, &rec);
+    }
+    else
+    {
+        rc = fds_record_write(&desc, &rec);
+    }
+
+    if (rc == FDS_SUCCESS)
+    {
+        m_cache.writes++;
+    }
+    else
+    {
+        energy_marker_end(m_cache.write_phase);
+
+        CRITICAL_REGION_ENTER();
+        m_cache.in_flight = false;
+        m_cache.dirty     = true;
+        CRITICAL_REGION_EXIT();
+    }
+
+    return rc;
+}
+
+
+void cfg_cache_stat(cfg_cache_stat_t * p_stat)
+{
+    p_stat->changes = m_cache.changes;
+    p_stat->writes  = m_cache.writes;
+    p_stat->dirty   = m_cache.dirty || m_cache.in_flight;
+}
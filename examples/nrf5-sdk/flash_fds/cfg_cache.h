@@ -0,0 +1,126 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup cfg_cache Configuration write-back cache
+ * @{
+ * @brief RAM copy of the configuration record, written to flash only once changes settle.
+ *
+ * @details The application reads and changes the configuration in RAM. A change marks the copy
+ *          dirty and restarts a quiet-period timer; the record is written when the timer expires,
+ *          so a burst of changes costs one flash write. The cache can also be flushed explicitly,
+ *          for example when the battery runs low, and it is flushed before the device shuts down
+ *          through nrf_pwr_mgmt.
+ *
+ *          Changes made while a write is in progress are written once it has completed.
+ */
+#ifndef CFG_CACHE_H__
+#define CFG_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "fds_example.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CFG_CACHE_QUIET_MS
+#define CFG_CACHE_QUIET_MS          5000    /**< Time without changes before the configuration is written. */
+#endif
+
+#ifndef CFG_CACHE_SHUTDOWN_PRIO
+#define CFG_CACHE_SHUTDOWN_PRIO     0       /**< nrf_pwr_mgmt shutdown handler priority. */
+#endif
+
+
+/**@brief Cache statistics. */
+typedef struct
+{
+    uint32_t changes;   /**< Calls to @ref cfg_cache_set that changed the configuration. */
+    uint32_t writes;    /**< Flash writes of the configuration record. */
+    bool     dirty;     /**< The configuration in RAM has not been written yet. */
+} cfg_cache_stat_t;
+
+
+/**@brief Function for initializing the cache. Registers an FDS event handler.
+ *
+ * @details Must be called after the app_timer is initialized.
+ *
+ * @retval NRF_SUCCESS                 The cache was initialized.
+ * @retval FDS_ERR_USER_LIMIT_REACHED  FDS_MAX_USERS handlers are already registered.
+ * @return Any error from app_timer_create.
+ */
+ret_code_t cfg_cache_init(void);
+
+
+/**@brief Function for loading the configuration from flash. Call it once FDS is initialized.
+ *
+ * @param[in] p_default  Configuration to use, and write, if there is none in flash.
+ *
+ * @retval FDS_SUCCESS        The configuration was loaded from flash.
+ * @retval FDS_ERR_NOT_FOUND  There was no configuration record; the default is used.
+ */
+ret_code_t cfg_cache_load(configuration_t const * p_default);
+
+
+/**@brief Function for getting the cached configuration. */
+configuration_t const * cfg_cache_get(void);
+
+
+/**@brief Function for changing the configuration.
+ *
+ * @details The configuration is copied. Nothing is written if it did not change.
+ *
+ * @param[in] p_cfg  New configuration.
+ */
+void cfg_cache_set(configuration_t const * p_cfg);
+
+
+/**@brief Function for writing the configuration now, if it is dirty.
+ *
+ * @retval NRF_SUCCESS  The write was queued, will follow the write in progress, or was not needed.
+ * @return Any error from fds_record_update or fds_record_write. The cache stays dirty.
+ */
+ret_code_t cfg_cache_flush(void);
+
+
+/**@brief Function for getting the cache statistics. */
+void cfg_cache_stat(cfg_cache_stat_t * p_stat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CFG_CACHE_H__
+
+/** @} */
@@ -38,6 +38,7 @@
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "app_error.h"
@@ -47,8 +48,15 @@
 #include "nrf_drv_uart.h"
 #include "fds.h"
 #include "nrf_soc.h"
+#include "sdk_common.h"
 #include "sdk_config.h"
 #include "fds_example.h"
+#include "fds_batch.h"
+#include "fds_index.h"
+#include "ts_log.h"
+#include "gc_sched.h"
+#include "cfg_cache.h"
+#include "nrf_pwr_mgmt.h"
 
 
 #define PRINT_HELP  "print records\r\n"                                                             \
@@ -66,6 +74,12 @@
                     "- key:\trecord key, in HEX\r\n"                                                \
                     "- data:\trecord contents"
 
+#define WRITE_BATCH_HELP    "write many records with consecutive keys in one batch\r\n"             \
+                            "usage: write_batch file_id key count\r\n"                              \
+                            "- file_id:\tfile ID, in HEX\r\n"                                       \
+                            "- key:\tkey of the first record, in HEX\r\n"                           \
+                            "- count:\tnumber of records, at most " STRINGIFY(WRITE_BATCH_MAX)
+
 #define DELETE_HELP "delete a record\r\n"                                                           \
                     "usage: delete file_id key\r\n"                                                 \
                     "- file_id:\tfile ID, in HEX\r\n"                                               \
@@ -80,9 +94,31 @@
 #define STAT_HELP   "print statistics\r\n"                                                          \
                     "usage: stat"
 
+#define SHUTDOWN_HELP   "write the configuration if needed and go to System OFF\r\n"                   \
+                        "usage: shutdown"
+
 #define GC_HELP     "run garbage collection\r\n"                                                    \
                     "usage: gc"
 
+#define TS_HELP     "time-series log\r\n"                                                           \
+                    "usage: ts add|flush|print|stat"
+
+#define TS_ADD_HELP "append synthetic samples, one per second\r\n"                                  \
+                    "usage: ts add count"
+
+#define TS_FLUSH_HELP   "write the current block even if it is not full\r\n"                        \
+                        "usage: ts flush"
+
+#define TS_PRINT_HELP   "print the blocks in flash\r\n"                                             \
+                        "usage: ts print [samples]"
+
+#define TS_STAT_HELP    "print log statistics\r\n"                                                  \
+                        "usage: ts stat"
+
+
+/* Largest number of records written by one write_batch command. */
+#define WRITE_BATCH_MAX     256
+
 
 NRF_CLI_UART_DEF(cli_uart, 0, 64, 16);
 NRF_CLI_DEF(m_cli_uart, "fds example:~$ ", &cli_uart.transport, '\r', 4);
@@ -99,7 +135,10 @@ void cli_init(void)
     uart_config.pselrxd               = RX_PIN_NUMBER;
     uart_config.hwfc                  = NRF_UART_HWFC_DISABLED;
 
-    ret_code_t rc = nrf_cli_init(&m_cli_uart, &uart_config, true, true, NRF_LOG_SEVERITY_INFO);
+    // With the binary log backend the CLI no longer doubles as the (text) log backend.
+    ret_code_t rc = nrf_cli_init(&m_cli_uart, &uart_config, true,
+                                 !NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN),
+                                 NRF_LOG_SEVERITY_INFO);
     APP_ERROR_CHECK(rc);
 }
 
@@ -171,39 +210,8 @@ static void record_write(nrf_cli_t const * p_cli,
 }
 
 
-static void record_update(nrf_cli_t const * p_cli, configuration_t const * p_cfg)
-{
-    fds_record_desc_t desc = {0};
-    fds_find_token_t  ftok = {0};
-
-    if (fds_record_find(CONFIG_FILE, CONFIG_REC_KEY, &desc, &ftok) == FDS_SUCCESS)
-    {
-        fds_record_t const rec =
-        {
-            .file_id           = CONFIG_FILE,
-            .key               = CONFIG_REC_KEY,
-            .data.p_data       = p_cfg,
-            .data.length_words = (sizeof(configuration_t) + 3) / sizeof(uint32_t)
-        };
-
-        ret_code_t rc = fds_record_update(&desc, &rec);
-        if (rc != FDS_SUCCESS)
-        {
-            nrf_cli_fprintf(p_cli, NRF_CLI_ERROR,
-                            "error: fds_record_update() returned %s.\r\n",
-                            fds_err_str[rc]);
-        }
-    }
-    else
-    {
-        nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "error: could not find config file.\r\n");
-    }
-}
-
-
 static void record_delete(nrf_cli_t const * p_cli, uint32_t fid, uint32_t key)
 {
-    fds_find_token_t tok   = {0};
     fds_record_desc_t desc = {0};
 
     nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
@@ -212,7 +220,7 @@ static void record_delete(nrf_cli_t const * p_cli, uint32_t fid, uint32_t key)
                     fid,
                     key);
 
-    if (fds_record_find(fid, key, &desc, &tok) == FDS_SUCCESS)
+    if (fds_index_find(fid, key, &desc) == FDS_SUCCESS)
     {
         ret_code_t rc = fds_record_delete(&desc);
         if (rc != FDS_SUCCESS)
@@ -232,29 +240,6 @@ static void record_delete(nrf_cli_t const * p_cli, uint32_t fid, uint32_t key)
 }
 
 
-bool record_delete_next(void)
-{
-    fds_find_token_t  tok   = {0};
-    fds_record_desc_t desc  = {0};
-
-    if (fds_record_iterate(&desc, &tok) == FDS_SUCCESS)
-    {
-        ret_code_t rc = fds_record_delete(&desc);
-        if (rc != FDS_SUCCESS)
-        {
-            return false;
-        }
-
-        return true;
-    }
-    else
-    {
-        /* No records left to delete. */
-        return false;
-    }
-}
-
-
 static void print_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
 {
     if (nrf_cli_help_requested(p_cli))
@@ -274,53 +259,23 @@ static void print_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
 
 static void print_cfg_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
 {
-    fds_record_desc_t desc = {0};
-    fds_find_token_t  tok  = {0};
-
-    while (fds_record_find(CONFIG_FILE, CONFIG_REC_KEY, &desc, &tok) == FDS_SUCCESS)
-    {
-        ret_code_t rc;
-        fds_flash_record_t frec = {0};
-
-        rc = fds_record_open(&desc, &frec);
-        switch (rc)
-        {
-            case FDS_SUCCESS:
-                break;
+    /* The cache holds the configuration; flash is behind it while it is dirty. */
+    configuration_t const * p_cfg = cfg_cache_get();
+    cfg_cache_stat_t        stat;
 
-            case FDS_ERR_CRC_CHECK_FAILED:
-                nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "error: CRC check failed!\r\n");
-                continue;
+    cfg_cache_stat(&stat);
 
-            case FDS_ERR_NOT_FOUND:
-                nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "error: record not found!\r\n");
-                continue;
-
-            default:
-            {
-                nrf_cli_fprintf(p_cli, NRF_CLI_ERROR,
-                                "error: unexpecte error %s.\r\n",
-                                fds_err_str[rc]);
-
-                continue;
-            }
-        }
-
-        configuration_t * p_cfg = (configuration_t *)(frec.p_data);
-
-        nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
-                        "config1:\t%s\r\n"
-                        "config2:\t%s\r\n"
-                        "boot count:\t%u\r\n"
-                        "device name:\t%s\r\n",
-                        p_cfg->config1_on ? "on" : "off",
-                        p_cfg->config2_on ? "on" : "off",
-                        p_cfg->boot_count,
-                        p_cfg->device_name);
-
-        rc = fds_record_close(&desc);
-        APP_ERROR_CHECK(rc);
-    }
+    nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                    "config1:\t%s\r\n"
+                    "config2:\t%s\r\n"
+                    "boot count:\t%u\r\n"
+                    "device name:\t%s\r\n"
+                    "in flash:\t%s\r\n",
+                    p_cfg->config1_on ? "on" : "off",
+                    p_cfg->config2_on ? "on" : "off",
+                    p_cfg->boot_count,
+                    p_cfg->device_name,
+                    stat.dirty ? "no, write pending" : "yes");
 }
 
 
@@ -413,6 +368,57 @@ static void write_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
 }
 
 
+static void write_batch_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+    }
+    else if (argc != 4)
+    {
+        cli_wrong_param_count_help(p_cli, "write_batch");
+    }
+    else
+    {
+        /* Must be statically allocated, because they are read until the batch completes. */
+        static fds_record_t m_recs[WRITE_BATCH_MAX];
+        static uint32_t     m_data[WRITE_BATCH_MAX];
+
+        if (fds_batch_in_progress())
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "error: a batch is already running.\r\n");
+            return;
+        }
+
+        uint16_t const fid   = strtol(argv[1], NULL, 16);
+        uint16_t const key   = strtol(argv[2], NULL, 16);
+        uint32_t const count = MIN(strtoul(argv[3], NULL, 10), WRITE_BATCH_MAX);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            /* Each record holds its index, like a sequence number of a sensor sample. */
+            m_data[i] = i;
+
+            m_recs[i].file_id           = fid;
+            m_recs[i].key               = key + i;
+            m_recs[i].data.p_data       = &m_data[i];
+            m_recs[i].data.length_words = 1;
+        }
+
+        nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                        "writing %u records to flash...\r\n", count);
+
+        ret_code_t rc = fds_batch_write(m_recs, count);
+        if (rc != FDS_SUCCESS)
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_ERROR,
+                            "error: fds_batch_write() returned %s.\r\n",
+                            fds_err_str[rc]);
+        }
+    }
+}
+
+
 static void update_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
 {
     if (nrf_cli_help_requested(p_cli))
@@ -425,8 +431,8 @@ static void update_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
     }
     else
     {
-        /* Must be statically allocated, because it is going to be written in flash. */
-        static configuration_t cfg = {0};
+        /* The cache copies it, so it can live on the stack. */
+        configuration_t cfg;
 
         memset(&cfg, 0x00, sizeof(configuration_t));
 
@@ -446,7 +452,11 @@ static void update_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
             cfg.boot_count,
             cfg.device_name);
 
-        record_update(p_cli, &cfg);
+        cfg_cache_set(&cfg);
+
+        nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                        "configuration is written after %u ms without changes.\r\n",
+                        CFG_CACHE_QUIET_MS);
     }
 }
 
@@ -508,21 +518,191 @@ static void stat_cmd(nrf_cli_t const * p_cli, size_t argc, char **argv)
                         "valid records:\t%u\r\n"
                         "dirty records:\t%u\r\n"
                         "largest contig:\t%u\r\n"
-                        "freeable words:\t%u (%u bytes)\r\n",
+                        "freeable words:\t%u (%u bytes)\r\n"
+                        "indexed:\t%u%s\r\n",
                         stat.pages_available,
                         stat.valid_records + stat.dirty_records,
                         stat.valid_records,
                         stat.dirty_records,
                         stat.largest_contig,
                         stat.freeable_words,
-                        stat.freeable_words * sizeof(uint32_t));
+                        stat.freeable_words * sizeof(uint32_t),
+                        fds_index_count(),
+                        fds_index_is_complete() ? "" : " (index full)");
+
+        /* Print the configuration cache statistics. */
+        cfg_cache_stat_t cfg_stat;
+
+        cfg_cache_stat(&cfg_stat);
+
+        nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                        "config changes:\t%u\r\n"
+                        "config writes:\t%u\r\n",
+                        cfg_stat.changes,
+                        cfg_stat.writes);
+
+        /* Print the garbage collection scheduler statistics. */
+        static uint32_t const bounds_ms[] = GC_SCHED_HIST_BOUNDS_MS;
+        gc_sched_stat_t gc_stat;
+
+        gc_sched_stat(&gc_stat);
+
+        nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                        "gc runs:\t%u auto, %u manual\r\n"
+                        "gc windows missed:\t%u\r\n"
+                        "gc longest:\t%u ms\r\n",
+                        gc_stat.runs,
+                        gc_stat.manual_runs,
+                        gc_stat.windows_missed,
+                        gc_stat.max_ms);
+
+        for (uint32_t i = 0; i < GC_SCHED_HIST_BINS; i++)
+        {
+            if (i < ARRAY_SIZE(bounds_ms))
+            {
+                nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                                "gc < %3u ms:\t%u\r\n", bounds_ms[i], gc_stat.hist[i]);
+            }
+            else
+            {
+                nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                                "gc >= %u ms:\t%u\r\n", bounds_ms[i - 1], gc_stat.hist[i]);
+            }
+        }
     }
 }
 
 
+static void ts_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+    }
+    else if (argc != 2)
+    {
+        cli_wrong_param_count_help(p_cli, "ts");
+    }
+    else
+    {
+        cli_unknown_param_help(p_cli, argv[1], "ts");
+    }
+}
+
+
+static void ts_add_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    /* A slowly drifting signal, like a temperature in hundredths of a degree. */
+    static ts_log_sample_t m_sample = {.timestamp = 0, .value = 2100};
+
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+        return;
+    }
+    else if (argc != 2)
+    {
+        cli_wrong_param_count_help(p_cli, "ts add");
+        return;
+    }
+
+    uint32_t const count = strtoul(argv[1], NULL, 10);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ret_code_t rc = ts_log_append(m_sample.timestamp, m_sample.value);
+        if (rc != NRF_SUCCESS)
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_ERROR,
+                            "error: ts_log_append() returned 0x%x after %u samples.\r\n",
+                            rc, i);
+            return;
+        }
+
+        m_sample.timestamp++;
+        m_sample.value += (int32_t)(rand() % 7) - 3;
+    }
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT, "%u samples added.\r\n", count);
+}
+
+
+static void ts_flush_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    ret_code_t rc = ts_log_flush();
+    if (rc != NRF_SUCCESS)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "error: ts_log_flush() returned 0x%x.\r\n", rc);
+    }
+}
+
+
+static void ts_print_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    ts_log_reader_t        reader  = {0};
+    ts_log_block_t const * p_block = NULL;
+    bool const             samples = (argc == 2) && (strcmp(argv[1], "samples") == 0);
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT, "seq\tsamples\tbytes\tfirst\r\n");
+
+    while (ts_log_reader_next(&reader, &p_block) == FDS_SUCCESS)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                        "%u\t%u\t%u\tt=%u v=%d\r\n",
+                        p_block->seq,
+                        p_block->count,
+                        p_block->len,
+                        p_block->t0,
+                        p_block->v0);
+
+        if (samples)
+        {
+            ts_log_cursor_t cursor;
+            ts_log_sample_t sample;
+
+            ts_log_cursor_init(&cursor, p_block);
+            while (ts_log_cursor_next(&cursor, &sample))
+            {
+                nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                                "\t%u\t%d\r\n",
+                                sample.timestamp,
+                                sample.value);
+            }
+        }
+    }
+}
+
+
+static void ts_stat_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    ts_log_stat_t stat;
+
+    ts_log_stat(&stat);
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT,
+                    "next block:\t%u\r\n"
+                    "blocks written:\t%u\r\n"
+                    "buffered:\t%u samples\r\n"
+                    "block size:\t%u bytes\r\n",
+                    stat.next_seq,
+                    stat.blocks_written,
+                    stat.samples_buffered,
+                    sizeof(ts_log_block_t));
+}
+
+
+static void shutdown_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    nrf_cli_fprintf(p_cli, NRF_CLI_DEFAULT, "shutting down...\r\n");
+
+    /* The configuration cache delays the shutdown until its record is written. */
+    nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF);
+}
+
+
 static void gc_cmd(nrf_cli_t const * p_cli, size_t argc, char ** argv)
 {
-    ret_code_t rc = fds_gc();
+    ret_code_t rc = gc_sched_run_now();
     switch (rc)
     {
         case FDS_SUCCESS:
@@ -544,10 +724,23 @@ NRF_CLI_CREATE_STATIC_SUBCMD_SET(m_print)
 };
 
 
+NRF_CLI_CREATE_STATIC_SUBCMD_SET(m_ts)
+{
+    NRF_CLI_CMD(add,    NULL, TS_ADD_HELP,   ts_add_cmd),
+    NRF_CLI_CMD(flush,  NULL, TS_FLUSH_HELP, ts_flush_cmd),
+    NRF_CLI_CMD(print,  NULL, TS_PRINT_HELP, ts_print_cmd),
+    NRF_CLI_CMD(stat,   NULL, TS_STAT_HELP,  ts_stat_cmd),
+    NRF_CLI_SUBCMD_SET_END
+};
+
+
 NRF_CLI_CMD_REGISTER(print,      &m_print, PRINT_HELP,      print_cmd);
 NRF_CLI_CMD_REGISTER(write,      NULL,     WRITE_HELP,      write_cmd);
+NRF_CLI_CMD_REGISTER(write_batch, NULL,    WRITE_BATCH_HELP, write_batch_cmd);
 NRF_CLI_CMD_REGISTER(update,     NULL,     UPDATE_HELP,     update_cmd);
 NRF_CLI_CMD_REGISTER(delete,     NULL,     DELETE_HELP,     delete_cmd);
 NRF_CLI_CMD_REGISTER(delete_all, NULL,     DELETE_ALL_HELP, delete_all_cmd);
 NRF_CLI_CMD_REGISTER(gc,         NULL,     GC_HELP,         gc_cmd);
+NRF_CLI_CMD_REGISTER(shutdown,   NULL,     SHUTDOWN_HELP,   shutdown_cmd);
 NRF_CLI_CMD_REGISTER(stat,       NULL,     STAT_HELP,       stat_cmd);
+NRF_CLI_CMD_REGISTER(ts,         &m_ts,    TS_HELP,         ts_cmd);
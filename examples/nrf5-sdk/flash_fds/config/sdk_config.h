@@ -827,7 +827,7 @@
 //==========================================================
 // <o> FDS_MAX_USERS - Maximum number of callbacks that can be registered. 
 #ifndef FDS_MAX_USERS
-#define FDS_MAX_USERS 4
+#define FDS_MAX_USERS 8
 #endif
 
 // </h> 
@@ -1211,6 +1211,38 @@
 // <h> nRF_Log 
 
 //==========================================================
+// <e> NRF_LOG_BACKEND_BIN_ENABLED - nrf_log_backend_bin - Binary log backend, decoded on the host
+//==========================================================
+#ifndef NRF_LOG_BACKEND_BIN_ENABLED
+#define NRF_LOG_BACKEND_BIN_ENABLED 0
+#endif
+// <q> NRF_LOG_BACKEND_BIN_USE_UART  - Send frames over UART instead of RTT
+ 
+
+// <i> The UART pin and baud rate are taken from the UART backend settings.
+// <i> The UART backend must be disabled when this option is set.
+
+#ifndef NRF_LOG_BACKEND_BIN_USE_UART
+#define NRF_LOG_BACKEND_BIN_USE_UART 0
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_RTT_CHANNEL - RTT up channel used for binary frames 
+#ifndef NRF_LOG_BACKEND_BIN_RTT_CHANNEL
+#define NRF_LOG_BACKEND_BIN_RTT_CHANNEL 1
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE - Size of the RTT up buffer for binary frames 
+#ifndef NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE
+#define NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE 512
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_HEXDUMP_MAX - Longest hexdump sent, in bytes 
+#ifndef NRF_LOG_BACKEND_BIN_HEXDUMP_MAX
+#define NRF_LOG_BACKEND_BIN_HEXDUMP_MAX 64
+#endif
+
+// </e>
+
 // <e> NRF_LOG_BACKEND_UART_ENABLED - nrf_log_backend_uart - Log UART backend
 //==========================================================
 #ifndef NRF_LOG_BACKEND_UART_ENABLED
@@ -4087,6 +4119,56 @@
 // </h> 
 //==========================================================
 
+// <h> nRF_Segger_RTT 
+
+//==========================================================
+// <h> segger_rtt - SEGGER RTT
+
+//==========================================================
+// <o> SEGGER_RTT_CONFIG_BUFFER_SIZE_UP - Size of upstream buffer. 
+// <i> Note that either @ref NRF_LOG_BACKEND_RTT_OUTPUT_BUFFER_SIZE
+// <i> or this value is actually used. It depends on which one is bigger.
+
+#ifndef SEGGER_RTT_CONFIG_BUFFER_SIZE_UP
+#define SEGGER_RTT_CONFIG_BUFFER_SIZE_UP 512
+#endif
+
+// <o> SEGGER_RTT_CONFIG_MAX_NUM_UP_BUFFERS - Size of upstream buffer. 
+#ifndef SEGGER_RTT_CONFIG_MAX_NUM_UP_BUFFERS
+#define SEGGER_RTT_CONFIG_MAX_NUM_UP_BUFFERS 2
+#endif
+
+// <o> SEGGER_RTT_CONFIG_BUFFER_SIZE_DOWN - Size of upstream buffer. 
+#ifndef SEGGER_RTT_CONFIG_BUFFER_SIZE_DOWN
+#define SEGGER_RTT_CONFIG_BUFFER_SIZE_DOWN 16
+#endif
+
+// <o> SEGGER_RTT_CONFIG_MAX_NUM_DOWN_BUFFERS - Size of upstream buffer. 
+#ifndef SEGGER_RTT_CONFIG_MAX_NUM_DOWN_BUFFERS
+#define SEGGER_RTT_CONFIG_MAX_NUM_DOWN_BUFFERS 2
+#endif
+
+// <o> SEGGER_RTT_CONFIG_DEFAULT_MODE  - RTT behavior if the buffer is full.
+ 
+
+// <i> The following modes are supported:
+// <i> - SKIP  - Do not block, output nothing.
+// <i> - TRIM  - Do not block, output as much as fits.
+// <i> - BLOCK - Wait until there is space in the buffer.
+// <0=> SKIP 
+// <1=> TRIM 
+// <2=> BLOCK_IF_FIFO_FULL 
+
+#ifndef SEGGER_RTT_CONFIG_DEFAULT_MODE
+#define SEGGER_RTT_CONFIG_DEFAULT_MODE 0
+#endif
+
+// </h> 
+//==========================================================
+
+// </h> 
+//==========================================================
+
 // <<< end of configuration section >>>
 #endif //SDK_CONFIG_H
 
@@ -0,0 +1,426 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "fds_batch.h"
+
+#include <string.h>
+#include "sdk_config.h"
+#include "energy_marker.h"
+
+#define NO_RECORD   0   /**< FDS never assigns record ID 0. */
+
+/* With the energy markers, writes are queued one at a time so that each has its own phase. */
+#define WRITES_IN_FLIGHT_MAX    (ENERGY_MARKER_ENABLED ? 1 : FDS_OP_QUEUE_SIZE)
+
+static struct
+{
+    fds_batch_evt_handler_t   evt_handler;
+    bool                      active;
+    fds_batch_type_t          type;
+    fds_record_t      const * p_records;
+    fds_record_desc_t const * p_descs;
+    fds_find_token_t          tok;                          //!< Iteration state of a delete all batch.
+    uint32_t                  count;                        //!< Operations in the batch; UINT32_MAX for delete all until iteration ends.
+    uint32_t                  next;                         //!< Index of the next operation to queue.
+    uint32_t                  done;
+    uint32_t                  failed;
+    ret_code_t                result;
+    uint32_t                  in_flight[FDS_OP_QUEUE_SIZE]; //!< Record IDs of the queued operations.
+    uint32_t                  in_flight_count;
+    bool                      queuing;                      //!< An FDS call of @ref op_queue is running.
+    bool                      queued_done;                  //!< The write being queued completed inside the call.
+    energy_phase_t            write_phase;                  //!< Phase to go back to when the write in flight completes.
+} m_batch;
+
+
+/**@brief   Remember that an operation on a record is queued. */
+static void in_flight_add(uint32_t record_id)
+{
+    for (uint32_t i = 0; i < FDS_OP_QUEUE_SIZE; i++)
+    {
+        if (m_batch.in_flight[i] == NO_RECORD)
+        {
+            m_batch.in_flight[i] = record_id;
+            m_batch.in_flight_count++;
+            return;
+        }
+    }
+}
+
+
+/**@brief   Find a queued operation.
+ *
+ * @return  Index of the record in the in-flight list, or FDS_OP_QUEUE_SIZE if this module has
+ *          no operation queued on it.
+ */
+static uint32_t in_flight_find(uint32_t record_id)
+{
+    for (uint32_t i = 0; i < FDS_OP_QUEUE_SIZE; i++)
+    {
+        if ((record_id != NO_RECORD) && (m_batch.in_flight[i] == record_id))
+        {
+            return i;
+        }
+    }
+
+    return FDS_OP_QUEUE_SIZE;
+}
+
+
+/**@brief   Forget a queued operation.
+ *
+ * @return  Whether the record had an operation queued by this module.
+ */
+static bool in_flight_remove(uint32_t record_id)
+{
+    uint32_t const i = in_flight_find(record_id);
+
+    if (i == FDS_OP_QUEUE_SIZE)
+    {
+        return false;
+    }
+
+    m_batch.in_flight[i] = NO_RECORD;
+    m_batch.in_flight_count--;
+    return true;
+}
+
+
+/**@brief   Get the record an FDS event completes an operation on, or NO_RECORD. */
+static uint32_t evt_record_id(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_WRITE:
+            return p_evt->write.record_id;
+
+        case FDS_EVT_DEL_RECORD:
+            return p_evt->del.record_id;
+
+        default:
+            return NO_RECORD;
+    }
+}
+
+
+/**@brief   Count a completed operation of the batch. */
+static void op_done(ret_code_t result)
+{
+    if (m_batch.type == FDS_BATCH_WRITE)
+    {
+        energy_marker_end(m_batch.write_phase);
+    }
+
+    if (result == FDS_SUCCESS)
+    {
+        m_batch.done++;
+    }
+    else
+    {
+        m_batch.failed++;
+        if (m_batch.result == FDS_SUCCESS)
+        {
+            m_batch.result = result;
+        }
+    }
+}
+
+
+/**@brief   Check whether an event completes the write @ref op_queue is queuing.
+ *
+ * @details Its record ID is only known once fds_record_write returns. FDS runs its queue in
+ *          order, so the write of the queued file and key is the one just queued.
+ */
+static bool queuing_own(fds_evt_t const * p_evt)
+{
+    return m_batch.queuing
+        && (m_batch.type == FDS_BATCH_WRITE)
+        && (p_evt->id == FDS_EVT_WRITE)
+        && (p_evt->write.file_id == m_batch.p_records[m_batch.next].file_id)
+        && (p_evt->write.record_key == m_batch.p_records[m_batch.next].key);
+}
+
+
+/**@brief   Delete a record, remembering it first: the NVMC backend deletes it, and sends the
+ *          event, before fds_record_delete returns.
+ */
+static ret_code_t op_delete(fds_record_desc_t * p_desc)
+{
+    ret_code_t rc;
+
+    in_flight_add(p_desc->record_id);
+    rc = fds_record_delete(p_desc);
+    if (rc != FDS_SUCCESS)
+    {
+        (void)in_flight_remove(p_desc->record_id);
+    }
+
+    return rc;
+}
+
+
+/**@brief   Queue the next operation of the batch.
+ *
+ * @details With the NVMC backend the operation, and its FDS event, may complete inside the FDS
+ *          call. The event is counted there, but the batch is not continued from it: this loop
+ *          does, once the call has returned.
+ *
+ * @return  FDS_SUCCESS, FDS_ERR_NOT_FOUND when a delete all batch runs out of records, or the
+ *          error returned by FDS.
+ */
+static ret_code_t op_queue(void)
+{
+    fds_record_desc_t desc = {0};
+    ret_code_t        rc;
+
+    m_batch.queuing     = true;
+    m_batch.queued_done = false;
+
+    switch (m_batch.type)
+    {
+        case FDS_BATCH_WRITE:
+        {
+            /* Marked until the FDS event: queued from an FDS event handler, the write only
+             * runs once the handler has returned. */
+            m_batch.write_phase = energy_marker_begin(ENERGY_PHASE_FDS_WRITE);
+            rc = fds_record_write(&desc, &m_batch.p_records[m_batch.next]);
+
+            if (rc != FDS_SUCCESS)
+            {
+                energy_marker_end(m_batch.write_phase);
+            }
+            else if (!m_batch.queued_done)
+            {
+                in_flight_add(desc.record_id);
+            }
+        } break;
+
+        case FDS_BATCH_DELETE:
+            desc = m_batch.p_descs[m_batch.next];
+            rc   = op_delete(&desc);
+            break;
+
+        case FDS_BATCH_DELETE_ALL:
+        default:
+        {
+            /* Keep a copy of the token: if the queue is full the same record is retried. */
+            fds_find_token_t tok = m_batch.tok;
+
+            rc = fds_record_iterate(&desc, &tok);
+            if (rc == FDS_SUCCESS)
+            {
+                rc = op_delete(&desc);
+                if (rc == FDS_SUCCESS)
+                {
+                    m_batch.tok = tok;
+                }
+            }
+        } break;
+    }
+
+    m_batch.queuing = false;
+
+    if (rc == FDS_SUCCESS)
+    {
+        m_batch.next++;
+    }
+
+    return rc;
+}
+
+
+/**@brief   Queue operations while there is room, and send the completion event once the batch
+ *          is finished.
+ */
+static void batch_continue(void)
+{
+    while (   (m_batch.result == FDS_SUCCESS)
+           && (m_batch.next < m_batch.count)
+           && (m_batch.in_flight_count < ((m_batch.type == FDS_BATCH_WRITE) ? WRITES_IN_FLIGHT_MAX
+                                                                             : FDS_OP_QUEUE_SIZE)))
+    {
+        ret_code_t rc = op_queue();
+
+        if (rc == FDS_ERR_NO_SPACE_IN_QUEUES)
+        {
+            /* Other users fill the queue; retry on the next event. */
+            break;
+        }
+        else if (rc == FDS_ERR_NOT_FOUND)
+        {
+            /* Delete all: no records left. */
+            m_batch.count = m_batch.next;
+        }
+        else if (rc != FDS_SUCCESS)
+        {
+            m_batch.result = rc;
+        }
+    }
+
+    if (   (m_batch.in_flight_count == 0)
+        && ((m_batch.result != FDS_SUCCESS) || (m_batch.next == m_batch.count)))
+    {
+        fds_batch_evt_t const evt =
+        {
+            .type   = m_batch.type,
+            .result = m_batch.result,
+            .done   = m_batch.done,
+            .failed = m_batch.failed
+                    + ((m_batch.type == FDS_BATCH_DELETE_ALL) ? 0 : (m_batch.count - m_batch.next)),
+        };
+
+        m_batch.active = false;
+
+        if (m_batch.evt_handler != NULL)
+        {
+            m_batch.evt_handler(&evt);
+        }
+    }
+}
+
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    if (!m_batch.active)
+    {
+        return;
+    }
+
+    if (in_flight_remove(evt_record_id(p_evt)))
+    {
+        op_done(p_evt->result);
+    }
+    else if (queuing_own(p_evt))
+    {
+        m_batch.queued_done = true;
+        op_done(p_evt->result);
+    }
+
+    /* Any completed operation, ours or not, may have freed a queue slot. The loop of
+     * batch_continue is still running if the event came from inside an FDS call of op_queue. */
+    if (!m_batch.queuing)
+    {
+        batch_continue();
+    }
+}
+
+
+/**@brief   Start a batch. */
+static ret_code_t batch_start(fds_batch_type_t          type,
+                              uint32_t                  count,
+                              fds_record_t      const * p_records,
+                              fds_record_desc_t const * p_descs)
+{
+    fds_batch_evt_handler_t const evt_handler = m_batch.evt_handler;
+
+    memset(&m_batch, 0, sizeof(m_batch));
+
+    m_batch.evt_handler = evt_handler;
+    m_batch.type        = type;
+    m_batch.count       = count;
+    m_batch.p_records   = p_records;
+    m_batch.p_descs     = p_descs;
+    m_batch.result      = FDS_SUCCESS;
+    m_batch.active      = true;
+
+    batch_continue();
+
+    return FDS_SUCCESS;
+}
+
+
+ret_code_t fds_batch_init(fds_batch_evt_handler_t evt_handler)
+{
+    memset(&m_batch, 0, sizeof(m_batch));
+    m_batch.evt_handler = evt_handler;
+
+    return fds_register(fds_evt_handler);
+}
+
+
+ret_code_t fds_batch_write(fds_record_t const * p_records, uint32_t count)
+{
+    if (m_batch.active)
+    {
+        return FDS_ERR_BUSY;
+    }
+    if (p_records == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+    if (count == 0)
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    return batch_start(FDS_BATCH_WRITE, count, p_records, NULL);
+}
+
+
+ret_code_t fds_batch_delete(fds_record_desc_t const * p_descs, uint32_t count)
+{
+    if (m_batch.active)
+    {
+        return FDS_ERR_BUSY;
+    }
+    if (p_descs == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+    if (count == 0)
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    return batch_start(FDS_BATCH_DELETE, count, NULL, p_descs);
+}
+
+
+ret_code_t fds_batch_delete_all(void)
+{
+    if (m_batch.active)
+    {
+        return FDS_ERR_BUSY;
+    }
+
+    return batch_start(FDS_BATCH_DELETE_ALL, UINT32_MAX, NULL, NULL);
+}
+
+
+bool fds_batch_in_progress(void)
+{
+    return m_batch.active;
+}
+
+
+bool fds_batch_evt_is_own(fds_evt_t const * p_evt)
+{
+    return m_batch.active
+        && ((in_flight_find(evt_record_id(p_evt)) != FDS_OP_QUEUE_SIZE) || queuing_own(p_evt));
+}
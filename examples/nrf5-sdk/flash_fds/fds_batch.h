@@ -0,0 +1,150 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup fds_batch FDS batch operations
+ * @{
+ * @brief Queue many FDS writes or deletes with one call and get one event when all are done.
+ *
+ * @details FDS accepts at most FDS_OP_QUEUE_SIZE operations at a time. A batch keeps up to that
+ *          many of its operations queued and queues the next ones from the FDS event handler as
+ *          earlier ones complete, so the whole batch runs without any help from the main loop.
+ *          Only one batch can run at a time. Operations queued by other FDS users share the queue
+ *          and are not affected. With ENERGY_MARKER_ENABLED, writes are queued one at a time, so
+ *          that the FDS write phase of each lasts from its queueing to its event.
+ *
+ *          If an operation cannot be queued for a reason other than a full queue (for example
+ *          FDS_ERR_NO_SPACE_IN_FLASH), the remaining operations are skipped and the batch
+ *          completes with that error once the queued operations have finished.
+ */
+#ifndef FDS_BATCH_H__
+#define FDS_BATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fds.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Batch types. */
+typedef enum
+{
+    FDS_BATCH_WRITE,        /**< Write new records. */
+    FDS_BATCH_DELETE,       /**< Delete records by descriptor. */
+    FDS_BATCH_DELETE_ALL,   /**< Delete every record in flash. */
+} fds_batch_type_t;
+
+/**@brief Batch completion event. */
+typedef struct
+{
+    fds_batch_type_t type;      /**< Type of the batch. */
+    ret_code_t       result;    /**< FDS_SUCCESS, or the first error of the batch. */
+    uint32_t         done;      /**< Operations completed successfully. */
+    uint32_t         failed;    /**< Operations that failed or were skipped after an error. */
+} fds_batch_evt_t;
+
+/**@brief Batch completion handler type. Called from the FDS event handler, or, with the NVMC
+ *        backend, which completes operations inside the FDS calls, from the function that
+ *        started the batch before it returns. */
+typedef void (*fds_batch_evt_handler_t)(fds_batch_evt_t const * p_evt);
+
+
+/**@brief Function for initializing the module. Registers an FDS event handler.
+ *
+ * @param[in] evt_handler  Handler called once at the end of every batch.
+ *
+ * @retval FDS_SUCCESS                 The module was initialized.
+ * @retval FDS_ERR_USER_LIMIT_REACHED  FDS_MAX_USERS handlers are already registered.
+ */
+ret_code_t fds_batch_init(fds_batch_evt_handler_t evt_handler);
+
+
+/**@brief Function for writing a batch of new records.
+ *
+ * @param[in] p_records  Records to write. The array and the data it points to must stay valid
+ *                       until the completion event.
+ * @param[in] count      Number of records.
+ *
+ * @retval FDS_SUCCESS          The batch was started.
+ * @retval FDS_ERR_BUSY         Another batch is running.
+ * @retval FDS_ERR_NULL_ARG     @p p_records is NULL.
+ * @retval FDS_ERR_INVALID_ARG  @p count is zero.
+ */
+ret_code_t fds_batch_write(fds_record_t const * p_records, uint32_t count);
+
+
+/**@brief Function for deleting a batch of records.
+ *
+ * @param[in] p_descs  Descriptors of the records to delete. Must stay valid until the completion
+ *                     event.
+ * @param[in] count    Number of records.
+ *
+ * @retval FDS_SUCCESS          The batch was started.
+ * @retval FDS_ERR_BUSY         Another batch is running.
+ * @retval FDS_ERR_NULL_ARG     @p p_descs is NULL.
+ * @retval FDS_ERR_INVALID_ARG  @p count is zero.
+ */
+ret_code_t fds_batch_delete(fds_record_desc_t const * p_descs, uint32_t count);
+
+
+/**@brief Function for deleting all records in flash.
+ *
+ * @details The records are found with fds_record_iterate while the batch runs, so no descriptor
+ *          array is needed. The completion event is sent even if there were no records.
+ *
+ * @retval FDS_SUCCESS   The batch was started.
+ * @retval FDS_ERR_BUSY  Another batch is running.
+ */
+ret_code_t fds_batch_delete_all(void);
+
+
+/**@brief Function for checking whether a batch is running. */
+bool fds_batch_in_progress(void);
+
+
+/**@brief Function for checking whether an FDS event completes an operation queued by the batch.
+ *
+ * @details Only valid in an FDS event handler registered before @ref fds_batch_init, which sees
+ *          the event before this module forgets the operation. A write that completes inside the
+ *          FDS call queuing it is recognized by its file ID and record key.
+ */
+bool fds_batch_evt_is_own(fds_evt_t const * p_evt);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FDS_BATCH_H__
+
+/** @} */
@@ -0,0 +1,393 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "fds_bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "nrf.h"
+#include "nordic_common.h"
+#include "app_error.h"
+#include "fds.h"
+#include "nrf_timer.h"
+#include "SEGGER_RTT.h"
+#include "sdk_config.h"
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_soc.h"
+#endif
+
+#define BENCH_FILE      (0x0BE0)    /**< File ID of the measured record. */
+#define BENCH_KEY       (0x0001)    /**< Key of the measured record. */
+#define FILLER_FILE     (0x0BE1)    /**< File ID of the records that fill the flash. */
+#define FILLER_WORDS    8           /**< Size of a filler record. */
+#define HEADER_WORDS    3           /**< Size of an FDS record header. */
+
+/**@brief Words available for records: one virtual page is the swap page, and each page starts
+ *        with a two-word tag. */
+#define DATA_WORDS      ((FDS_VIRTUAL_PAGES - 1) * (FDS_VIRTUAL_PAGE_SIZE - 2))
+
+#define MAX_WORDS       256
+
+/* Measured statistics of one operation. */
+typedef struct
+{
+    uint32_t n;
+    uint32_t cpu_us_sum;
+    uint32_t lat_us_min;
+    uint32_t lat_us_max;
+    uint32_t lat_us_sum;
+} bench_stat_t;
+
+typedef enum
+{
+    OP_WRITE,
+    OP_FIND,
+    OP_OPEN,
+    OP_UPDATE,
+    OP_DELETE,
+    OP_GC,
+    OP_COUNT,
+} bench_op_t;
+
+static char const * const m_op_str[OP_COUNT] =
+{
+    "write",
+    "find",
+    "open",
+    "update",
+    "delete",
+    "gc",
+};
+
+static uint16_t const m_sizes[]    = {1, 4, 16, 64, MAX_WORDS};
+static uint8_t  const m_fill_pct[] = {0, 25, 50, 75};
+
+static uint32_t m_data[MAX_WORDS];
+
+/* Last FDS event, and the TIMER value when it arrived. */
+static struct
+{
+    bool     volatile received;
+    fds_evt_id_t     id;
+    ret_code_t       result;
+    uint32_t         time_us;
+} m_evt;
+
+/* Time at the start of a measurement. */
+static uint32_t m_start_us;
+static uint32_t m_start_cycles;
+
+
+static uint32_t timer_now_us(void)
+{
+    nrf_timer_task_trigger(FDS_BENCH_TIMER, NRF_TIMER_TASK_CAPTURE0);
+    return nrf_timer_cc_read(FDS_BENCH_TIMER, NRF_TIMER_CC_CHANNEL0);
+}
+
+
+static void clocks_start(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    nrf_timer_mode_set(FDS_BENCH_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(FDS_BENCH_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(FDS_BENCH_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_task_trigger(FDS_BENCH_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(FDS_BENCH_TIMER, NRF_TIMER_TASK_START);
+}
+
+
+static void row_print(char const * p_fmt, ...)
+{
+    char    buf[96];
+    va_list args;
+
+    va_start(args, p_fmt);
+    int const len = vsnprintf(buf, sizeof(buf), p_fmt, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        (void) SEGGER_RTT_Write(FDS_BENCH_RTT_CHANNEL, buf, MIN((uint32_t)len, sizeof(buf) - 1));
+    }
+}
+
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    m_evt.time_us  = timer_now_us();
+    m_evt.id       = p_evt->id;
+    m_evt.result   = p_evt->result;
+    m_evt.received = true;
+}
+
+
+static void measure_start(void)
+{
+    m_evt.received = false;
+    m_start_us     = timer_now_us();
+    m_start_cycles = DWT->CYCCNT;
+}
+
+
+/**@brief   CPU time since @ref measure_start. */
+static uint32_t cpu_us_get(void)
+{
+    return (DWT->CYCCNT - m_start_cycles) / (SystemCoreClock / 1000000UL);
+}
+
+
+static void evt_wait(fds_evt_id_t id)
+{
+    while (!m_evt.received)
+    {
+#ifdef SOFTDEVICE_PRESENT
+        (void) sd_app_evt_wait();
+#else
+        __WFE();
+#endif
+    }
+
+    APP_ERROR_CHECK_BOOL(m_evt.id == id);
+    APP_ERROR_CHECK(m_evt.result);
+}
+
+
+static void sample_add(bench_stat_t * p_stat, uint32_t cpu_us, uint32_t lat_us)
+{
+    if (p_stat->n == 0)
+    {
+        p_stat->lat_us_min = lat_us;
+        p_stat->lat_us_max = lat_us;
+    }
+
+    p_stat->n++;
+    p_stat->cpu_us_sum += cpu_us;
+    p_stat->lat_us_sum += lat_us;
+    p_stat->lat_us_min  = MIN(p_stat->lat_us_min, lat_us);
+    p_stat->lat_us_max  = MAX(p_stat->lat_us_max, lat_us);
+}
+
+
+/**@brief   Finish measuring an operation that completes with an FDS event. */
+static void async_done(bench_stat_t * p_stat, ret_code_t rc, fds_evt_id_t id)
+{
+    uint32_t const cpu_us = cpu_us_get();
+
+    APP_ERROR_CHECK(rc);
+    evt_wait(id);
+
+    sample_add(p_stat, cpu_us, m_evt.time_us - m_start_us);
+}
+
+
+/**@brief   Finish measuring an operation that completes when the call returns. */
+static void sync_done(bench_stat_t * p_stat, ret_code_t rc)
+{
+    uint32_t const cpu_us = cpu_us_get();
+    uint32_t const lat_us = timer_now_us() - m_start_us;
+
+    APP_ERROR_CHECK(rc);
+
+    sample_add(p_stat, cpu_us, lat_us);
+}
+
+
+static void gc_run(bench_stat_t * p_stat)
+{
+    bench_stat_t unused = {0};
+
+    measure_start();
+    async_done((p_stat != NULL) ? p_stat : &unused, fds_gc(), FDS_EVT_GC);
+}
+
+
+/**@brief   Delete every record and collect the garbage. */
+static void flash_clear(void)
+{
+    bench_stat_t      unused = {0};
+    fds_record_desc_t desc   = {0};
+    fds_find_token_t  tok    = {0};
+
+    while (fds_record_iterate(&desc, &tok) == FDS_SUCCESS)
+    {
+        measure_start();
+        async_done(&unused, fds_record_delete(&desc), FDS_EVT_DEL_RECORD);
+    }
+
+    gc_run(NULL);
+}
+
+
+/**@brief   Write filler records until the given share of the flash is used. */
+static void flash_fill(uint8_t pct)
+{
+    bench_stat_t unused = {0};
+    fds_stat_t   stat   = {0};
+    uint16_t     key    = 1;
+
+    fds_record_t const rec =
+    {
+        .file_id           = FILLER_FILE,
+        .key               = 0,
+        .data.p_data       = m_data,
+        .data.length_words = FILLER_WORDS,
+    };
+
+    for (;;)
+    {
+        APP_ERROR_CHECK(fds_stat(&stat));
+        if (stat.words_used >= (DATA_WORDS * pct) / 100)
+        {
+            break;
+        }
+
+        fds_record_t filler = rec;
+        filler.key          = key++;
+
+        measure_start();
+        async_done(&unused, fds_record_write(NULL, &filler), FDS_EVT_WRITE);
+    }
+}
+
+
+static void size_run(uint8_t fill_pct, uint16_t words)
+{
+    bench_stat_t stats[OP_COUNT];
+
+    memset(stats, 0, sizeof(stats));
+
+    fds_record_t const rec =
+    {
+        .file_id           = BENCH_FILE,
+        .key               = BENCH_KEY,
+        .data.p_data       = m_data,
+        .data.length_words = words,
+    };
+
+    for (uint32_t i = 0; i < FDS_BENCH_REPEAT; i++)
+    {
+        fds_record_desc_t  desc = {0};
+        fds_find_token_t   tok  = {0};
+        fds_flash_record_t frec = {0};
+
+        /* Change the contents so that every write programs new data. */
+        m_data[0] = i;
+
+        measure_start();
+        async_done(&stats[OP_WRITE], fds_record_write(&desc, &rec), FDS_EVT_WRITE);
+
+        measure_start();
+        sync_done(&stats[OP_FIND], fds_record_find(BENCH_FILE, BENCH_KEY, &desc, &tok));
+
+        /* Includes the CRC check, if FDS_CRC_CHECK_ON_READ is enabled. */
+        measure_start();
+        sync_done(&stats[OP_OPEN], fds_record_open(&desc, &frec));
+        APP_ERROR_CHECK(fds_record_close(&desc));
+
+        measure_start();
+        async_done(&stats[OP_UPDATE], fds_record_update(&desc, &rec), FDS_EVT_UPDATE);
+
+        measure_start();
+        async_done(&stats[OP_DELETE], fds_record_delete(&desc), FDS_EVT_DEL_RECORD);
+
+        /* Reclaim the space of the record and its updated copy. */
+        gc_run(&stats[OP_GC]);
+    }
+
+    for (uint32_t op = 0; op < OP_COUNT; op++)
+    {
+        bench_stat_t const * p_stat = &stats[op];
+
+        row_print("%u,%s,%u,%u,%u,%u,%u,%u\r\n",
+                  fill_pct,
+                  m_op_str[op],
+                  words,
+                  p_stat->n,
+                  p_stat->cpu_us_sum / p_stat->n,
+                  p_stat->lat_us_min,
+                  p_stat->lat_us_sum / p_stat->n,
+                  p_stat->lat_us_max);
+    }
+}
+
+
+void fds_bench_run(void)
+{
+    ret_code_t rc;
+
+    /* Results are only useful if none are lost. */
+    (void) SEGGER_RTT_ConfigUpBuffer(FDS_BENCH_RTT_CHANNEL, NULL, NULL, 0,
+                                     SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL);
+
+    clocks_start();
+
+    for (uint32_t i = 0; i < MAX_WORDS; i++)
+    {
+        m_data[i] = 0xA5A5A5A5 ^ i;
+    }
+
+    rc = fds_register(fds_evt_handler);
+    APP_ERROR_CHECK(rc);
+
+    m_evt.received = false;
+    rc = fds_init();
+    APP_ERROR_CHECK(rc);
+    evt_wait(FDS_EVT_INIT);
+
+    row_print("fill_pct,op,words,n,cpu_us_avg,lat_us_min,lat_us_avg,lat_us_max\r\n");
+
+    for (uint32_t f = 0; f < ARRAY_SIZE(m_fill_pct); f++)
+    {
+        flash_clear();
+        flash_fill(m_fill_pct[f]);
+
+        for (uint32_t s = 0; s < ARRAY_SIZE(m_sizes); s++)
+        {
+            fds_stat_t stat = {0};
+
+            APP_ERROR_CHECK(fds_stat(&stat));
+
+            /* The record and its updated copy must both fit. */
+            if (2 * (m_sizes[s] + HEADER_WORDS) > stat.largest_contig)
+            {
+                continue;
+            }
+
+            size_run(m_fill_pct[f], m_sizes[s]);
+        }
+    }
+
+    flash_clear();
+
+    row_print("done\r\n");
+}
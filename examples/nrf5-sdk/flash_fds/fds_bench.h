@@ -0,0 +1,88 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup fds_bench FDS benchmark
+ * @{
+ * @brief Time FDS operations for a range of record sizes and flash fill levels.
+ *
+ * @details For every fill level, the flash is erased of records and filled with small records up
+ *          to that level. Then, for every record size, a record is written, found, opened,
+ *          updated and deleted, and the flash is garbage collected, FDS_BENCH_REPEAT times.
+ *
+ *          Two times are measured for every operation: the CPU time spent in the FDS call, with
+ *          the DWT cycle counter, and the time until the FDS event, with a TIMER. With the NVMC
+ *          backend flash operations complete inside the call, so both are close; with the
+ *          SoftDevice the difference is the time the operation waited for the flash.
+ *
+ *          Results are written to RTT as comma-separated values, one line per operation, record
+ *          size and fill level:
+ *
+ *          @code
+ *          fill_pct,op,words,n,cpu_us_avg,lat_us_min,lat_us_avg,lat_us_max
+ *          @endcode
+ *
+ *          The RTT channel blocks when full, so the benchmark waits for an RTT viewer to read it.
+ */
+#ifndef FDS_BENCH_H__
+#define FDS_BENCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FDS_BENCH_REPEAT
+#define FDS_BENCH_REPEAT        8           /**< Repetitions of every measurement. */
+#endif
+
+#ifndef FDS_BENCH_RTT_CHANNEL
+#define FDS_BENCH_RTT_CHANNEL   0           /**< RTT up channel for the results. */
+#endif
+
+#ifndef FDS_BENCH_TIMER
+#define FDS_BENCH_TIMER         NRF_TIMER1  /**< TIMER used to measure completion times. */
+#endif
+
+
+/**@brief Function for running the benchmark.
+ *
+ * @details Registers an FDS event handler and initializes FDS, so no other FDS user should be
+ *          registered. Erases all records. Returns when all results are written.
+ */
+void fds_bench_run(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FDS_BENCH_H__
+
+/** @} */
@@ -80,7 +80,6 @@ void delete_all_begin(void);
 void cli_init(void);
 void cli_start(void);
 void cli_process(void);
-bool record_delete_next(void);
 
 
 #endif
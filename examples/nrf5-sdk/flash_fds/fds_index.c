@@ -0,0 +1,300 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "fds_index.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_util_platform.h"
+
+#define INDEX_MASK          (FDS_INDEX_SIZE - 1)
+#define INDEX_MAX_COUNT     ((FDS_INDEX_SIZE * 3) / 4)  /**< Leave free slots so probe sequences stay short. */
+#define NO_RECORD           0                           /**< FDS never assigns record ID 0; marks a free slot. */
+#define NO_SLOT             (-1)
+
+STATIC_ASSERT(IS_POWER_OF_TWO(FDS_INDEX_SIZE));
+
+typedef struct
+{
+    uint16_t          file_id;
+    uint16_t          key;
+    fds_record_desc_t desc;     //!< desc.record_id is NO_RECORD for a free slot.
+} index_entry_t;
+
+static struct
+{
+    index_entry_t entries[FDS_INDEX_SIZE];
+    uint32_t      count;
+    bool          complete;     //!< Every record in flash is in the index.
+} m_index;
+
+
+/**@brief   First slot to probe for a file ID and key. */
+static uint32_t slot_home(uint16_t file_id, uint16_t key)
+{
+    /* Fibonacci hashing: the upper bits of the product mix all bits of the input. */
+    uint32_t const hash = ((((uint32_t)file_id) << 16) | key) * 2654435769UL;
+
+    return (hash >> 16) & INDEX_MASK;
+}
+
+
+static bool slot_is_free(uint32_t slot)
+{
+    return (m_index.entries[slot].desc.record_id == NO_RECORD);
+}
+
+
+/**@brief   Find the slot of a record.
+ *
+ * @param[in]   record_id   Record ID to match, or NO_RECORD to match any record with @p file_id
+ *                          and @p key.
+ *
+ * @return  The slot, or NO_SLOT.
+ */
+static int32_t slot_find(uint16_t file_id, uint16_t key, uint32_t record_id)
+{
+    /* The index is never full, so a free slot ends every probe sequence. */
+    for (uint32_t slot = slot_home(file_id, key); !slot_is_free(slot); slot = (slot + 1) & INDEX_MASK)
+    {
+        index_entry_t const * p_entry = &m_index.entries[slot];
+
+        if (   (p_entry->file_id == file_id)
+            && (p_entry->key     == key)
+            && ((record_id == NO_RECORD) || (p_entry->desc.record_id == record_id)))
+        {
+            return slot;
+        }
+    }
+
+    return NO_SLOT;
+}
+
+
+static void entry_add(uint16_t file_id, uint16_t key, fds_record_desc_t const * p_desc)
+{
+    if (m_index.count >= INDEX_MAX_COUNT)
+    {
+        /* Lookups of records not in the index must search flash from now on. */
+        m_index.complete = false;
+        return;
+    }
+
+    uint32_t slot = slot_home(file_id, key);
+    while (!slot_is_free(slot))
+    {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+
+    m_index.entries[slot].file_id = file_id;
+    m_index.entries[slot].key     = key;
+    m_index.entries[slot].desc    = *p_desc;
+    m_index.count++;
+}
+
+
+/**@brief   Remove the entry in a slot, moving later entries of the probe sequence back into the
+ *          hole so that no tombstones are needed.
+ */
+static void entry_remove(uint32_t slot)
+{
+    uint32_t next = slot;
+
+    for (;;)
+    {
+        next = (next + 1) & INDEX_MASK;
+        if (slot_is_free(next))
+        {
+            break;
+        }
+
+        uint32_t const home = slot_home(m_index.entries[next].file_id, m_index.entries[next].key);
+
+        /* The entry may fill the hole only if the hole is not before its home slot. */
+        if (((next - home) & INDEX_MASK) >= ((next - slot) & INDEX_MASK))
+        {
+            m_index.entries[slot] = m_index.entries[next];
+            slot = next;
+        }
+    }
+
+    memset(&m_index.entries[slot], 0, sizeof(index_entry_t));
+    m_index.count--;
+}
+
+
+/**@brief   Fill in the flash address of a descriptor that only has a record ID, so that later
+ *          operations on it do not search flash.
+ */
+static void desc_resolve(fds_record_desc_t * p_desc, uint32_t record_id)
+{
+    fds_flash_record_t frec = {0};
+
+    (void) fds_descriptor_from_rec_id(p_desc, record_id);
+
+    if (fds_record_open(p_desc, &frec) == FDS_SUCCESS)
+    {
+        (void) fds_record_close(p_desc);
+    }
+}
+
+
+/**@brief   Build the index from the records in flash. */
+static void index_build(void)
+{
+    fds_record_desc_t desc = {0};
+    fds_find_token_t  tok  = {0};
+
+    memset(&m_index, 0, sizeof(m_index));
+    m_index.complete = true;
+
+    while (fds_record_iterate(&desc, &tok) == FDS_SUCCESS)
+    {
+        /* The iterator has just located the record; read its header in place. */
+        fds_header_t const * p_header = (fds_header_t const *)(desc.p_record);
+
+        entry_add(p_header->file_id, p_header->record_key, &desc);
+    }
+}
+
+
+void fds_index_on_fds_evt(fds_evt_t const * p_evt)
+{
+    if (p_evt->result != FDS_SUCCESS)
+    {
+        return;
+    }
+
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+        case FDS_EVT_GC:
+            /* Garbage collection moves records, which invalidates the cached addresses. */
+            index_build();
+            break;
+
+        case FDS_EVT_WRITE:
+        {
+            fds_record_desc_t desc = {0};
+
+            desc_resolve(&desc, p_evt->write.record_id);
+            entry_add(p_evt->write.file_id, p_evt->write.record_key, &desc);
+        } break;
+
+        case FDS_EVT_UPDATE:
+        {
+            int32_t const slot = slot_find(p_evt->write.file_id, p_evt->write.record_key, NO_RECORD);
+
+            if (slot != NO_SLOT)
+            {
+                desc_resolve(&m_index.entries[slot].desc, p_evt->write.record_id);
+            }
+            else
+            {
+                fds_record_desc_t desc = {0};
+
+                desc_resolve(&desc, p_evt->write.record_id);
+                entry_add(p_evt->write.file_id, p_evt->write.record_key, &desc);
+            }
+        } break;
+
+        case FDS_EVT_DEL_RECORD:
+        {
+            int32_t const slot = slot_find(p_evt->del.file_id,
+                                           p_evt->del.record_key,
+                                           p_evt->del.record_id);
+            if (slot != NO_SLOT)
+            {
+                entry_remove(slot);
+            }
+        } break;
+
+        case FDS_EVT_DEL_FILE:
+        {
+            for (uint32_t slot = 0; slot < FDS_INDEX_SIZE; slot++)
+            {
+                /* Removing an entry can move another one into this slot; check it again. */
+                while (   !slot_is_free(slot)
+                       && (m_index.entries[slot].file_id == p_evt->del.file_id))
+                {
+                    entry_remove(slot);
+                }
+            }
+        } break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t fds_index_find(uint16_t file_id, uint16_t key, fds_record_desc_t * p_desc)
+{
+    ret_code_t rc = FDS_ERR_NOT_FOUND;
+    bool       complete;
+
+    if (p_desc == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    /* The index is updated from the FDS event handler. */
+    CRITICAL_REGION_ENTER();
+
+    int32_t const slot = slot_find(file_id, key, NO_RECORD);
+    if (slot != NO_SLOT)
+    {
+        *p_desc = m_index.entries[slot].desc;
+        rc      = FDS_SUCCESS;
+    }
+    complete = m_index.complete;
+
+    CRITICAL_REGION_EXIT();
+
+    if ((rc == FDS_ERR_NOT_FOUND) && !complete)
+    {
+        fds_find_token_t tok = {0};
+
+        rc = fds_record_find(file_id, key, p_desc, &tok);
+    }
+
+    return rc;
+}
+
+
+uint32_t fds_index_count(void)
+{
+    return m_index.count;
+}
+
+
+bool fds_index_is_complete(void)
+{
+    return m_index.complete;
+}
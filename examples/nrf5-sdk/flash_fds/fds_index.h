@@ -0,0 +1,103 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup fds_index FDS record index
+ * @{
+ * @brief RAM index of FDS records, for looking up records by file ID and key without walking flash.
+ *
+ * @details fds_record_find reads every page and record header in flash on each call. This module
+ *          builds a hash table of (file ID, record key) to record descriptor once, when FDS is
+ *          initialized, and keeps it up to date from the FDS events. The descriptors in the index
+ *          keep the flash address of their record, so opening a record found through the index
+ *          does not search flash either.
+ *
+ *          The index is rebuilt after garbage collection, which moves records. If there are more
+ *          records than the index can hold, the index marks itself incomplete and lookups fall
+ *          back to fds_record_find until the next rebuild.
+ *
+ *          Several records may share a file ID and key. An update replaces the first indexed
+ *          record with that file ID and key, since FDS does not report which record was replaced.
+ */
+#ifndef FDS_INDEX_H__
+#define FDS_INDEX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fds.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef FDS_INDEX_SIZE
+#define FDS_INDEX_SIZE  128     /**< Slots in the index. Must be a power of two; at most three quarters are used. */
+#endif
+
+
+/**@brief Function for updating the index from an FDS event.
+ *
+ * @details Must be called from the application FDS event handler for every event. The index is
+ *          built on FDS_EVT_INIT and rebuilt on FDS_EVT_GC.
+ *
+ * @param[in] p_evt  FDS event.
+ */
+void fds_index_on_fds_evt(fds_evt_t const * p_evt);
+
+
+/**@brief Function for finding a record by file ID and key.
+ *
+ * @param[in]  file_id  File ID.
+ * @param[in]  key      Record key.
+ * @param[out] p_desc   Descriptor of the record, ready for fds_record_open, update or delete.
+ *
+ * @retval FDS_SUCCESS        The record was found.
+ * @retval FDS_ERR_NOT_FOUND  There is no such record.
+ * @retval FDS_ERR_NULL_ARG   @p p_desc is NULL.
+ */
+ret_code_t fds_index_find(uint16_t file_id, uint16_t key, fds_record_desc_t * p_desc);
+
+
+/**@brief Function for getting the number of indexed records. */
+uint32_t fds_index_count(void);
+
+
+/**@brief Function for checking whether every record in flash is indexed. */
+bool fds_index_is_complete(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FDS_INDEX_H__
+
+/** @} */
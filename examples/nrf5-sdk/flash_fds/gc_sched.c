@@ -0,0 +1,327 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "gc_sched.h"
+
+#include <string.h>
+#include "sdk_common.h"
+#include "app_timer.h"
+#include "fds.h"
+
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_soc.h"
+#include "nrf_sdh_soc.h"
+#endif
+
+#define IDLE_TICKS  APP_TIMER_TICKS(GC_SCHED_IDLE_MS)
+
+typedef enum
+{
+    STATE_IDLE,         //!< Waiting for enough freeable words and an idle flash.
+    STATE_WAIT_WINDOW,  //!< Waiting for the radio idle window.
+    STATE_WINDOW,       //!< In a radio idle window; the main loop starts the collection.
+    STATE_RUNNING,      //!< Collection in progress.
+} gc_state_t;
+
+static struct
+{
+    gc_state_t volatile state;
+    bool       volatile check;          //!< Records changed since the last fds_stat.
+    uint32_t   volatile last_activity;  //!< app_timer ticks of the last FDS operation.
+    uint32_t            gc_start;       //!< app_timer ticks when the collection started.
+    gc_sched_stat_t     stat;
+} m_gc;
+
+static uint32_t const m_hist_bounds_ms[] = GC_SCHED_HIST_BOUNDS_MS;
+
+APP_TIMER_DEF(m_idle_timer);
+
+STATIC_ASSERT(ARRAY_SIZE(m_hist_bounds_ms) == GC_SCHED_HIST_BINS - 1);
+
+
+static uint32_t ticks_since(uint32_t ticks)
+{
+    return app_timer_cnt_diff_compute(app_timer_cnt_get(), ticks);
+}
+
+
+static uint32_t ticks_to_ms(uint32_t ticks)
+{
+    uint64_t const us = (uint64_t)ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1);
+
+    return (uint32_t)ROUNDED_DIV(us, APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**@brief   Idle timer handler. Only wakes the main loop, which then runs gc_sched_process. */
+static void idle_timer_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+}
+
+
+/**@brief   Note FDS activity, and make sure the main loop looks again once it has been idle. */
+static void activity_note(void)
+{
+    m_gc.last_activity = app_timer_cnt_get();
+    m_gc.check         = true;
+
+    (void) app_timer_stop(m_idle_timer);
+    (void) app_timer_start(m_idle_timer, IDLE_TICKS + 1, NULL);
+}
+
+
+static void duration_record(uint32_t ms)
+{
+    uint32_t bin = 0;
+
+    while ((bin < ARRAY_SIZE(m_hist_bounds_ms)) && (ms >= m_hist_bounds_ms[bin]))
+    {
+        bin++;
+    }
+
+    m_gc.stat.hist[bin]++;
+    m_gc.stat.max_ms = MAX(m_gc.stat.max_ms, ms);
+}
+
+
+static ret_code_t gc_start(bool manual)
+{
+    ret_code_t rc = fds_gc();
+
+    if (rc == FDS_SUCCESS)
+    {
+        m_gc.gc_start = app_timer_cnt_get();
+        m_gc.state    = STATE_RUNNING;
+
+        if (manual)
+        {
+            m_gc.stat.manual_runs++;
+        }
+        else
+        {
+            m_gc.stat.runs++;
+        }
+    }
+    else if (!manual)
+    {
+        /* Probably a full queue; try again when the flash is idle. */
+        m_gc.state = STATE_IDLE;
+        m_gc.check = true;
+    }
+
+    return rc;
+}
+
+
+#ifdef SOFTDEVICE_PRESENT
+
+static nrf_radio_request_t const m_window_request =
+{
+    .request_type     = NRF_RADIO_REQ_TYPE_EARLIEST,
+    .params.earliest  =
+    {
+        .hfclk        = NRF_RADIO_HFCLK_CFG_NO_GUARANTEE,
+        .priority     = NRF_RADIO_PRIORITY_NORMAL,
+        .length_us    = GC_SCHED_WINDOW_US,
+        .timeout_us   = GC_SCHED_WINDOW_TIMEOUT_US,
+    },
+};
+
+static nrf_radio_signal_callback_return_param_t m_signal_ret;
+
+
+/**@brief   Timeslot signal handler. Runs at the highest interrupt priority, where FDS must not be
+ *          called.
+ */
+static nrf_radio_signal_callback_return_param_t * radio_signal_handler(uint8_t signal_type)
+{
+    if (signal_type == NRF_RADIO_CALLBACK_SIGNAL_TYPE_START)
+    {
+        /* The radio is free. End the timeslot at once; ending it raises a SoC event
+         * (NRF_EVT_RADIO_SESSION_IDLE), which wakes the main loop to start the collection. */
+        if (m_gc.state == STATE_WAIT_WINDOW)
+        {
+            m_gc.state = STATE_WINDOW;
+        }
+        m_signal_ret.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_END;
+    }
+    else
+    {
+        m_signal_ret.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
+    }
+
+    return &m_signal_ret;
+}
+
+
+static void soc_evt_handler(uint32_t evt_id, void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    switch (evt_id)
+    {
+        case NRF_EVT_RADIO_BLOCKED:
+        case NRF_EVT_RADIO_CANCELED:
+            if (m_gc.state == STATE_WAIT_WINDOW)
+            {
+                /* Back off for an idle period before asking again. */
+                m_gc.stat.windows_missed++;
+                m_gc.state = STATE_IDLE;
+                activity_note();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+NRF_SDH_SOC_OBSERVER(m_gc_sched_soc_obs, GC_SCHED_SOC_OBSERVER_PRIO, soc_evt_handler, NULL);
+
+
+static void window_request(void)
+{
+    m_gc.state = STATE_WAIT_WINDOW;
+
+    if (sd_radio_request(&m_window_request) != NRF_SUCCESS)
+    {
+        m_gc.stat.windows_missed++;
+        m_gc.check = true;
+        m_gc.state = STATE_IDLE;
+    }
+}
+
+#else
+
+static void window_request(void)
+{
+    /* Without the SoftDevice, nothing else competes with the flash. */
+    m_gc.state = STATE_WINDOW;
+}
+
+#endif // SOFTDEVICE_PRESENT
+
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            /* There may be dirty records from before the reset. */
+            m_gc.check = true;
+            break;
+
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+        case FDS_EVT_DEL_RECORD:
+        case FDS_EVT_DEL_FILE:
+            activity_note();
+            break;
+
+        case FDS_EVT_GC:
+            if (m_gc.state == STATE_RUNNING)
+            {
+                duration_record(ticks_to_ms(ticks_since(m_gc.gc_start)));
+                m_gc.last_activity = app_timer_cnt_get();
+                m_gc.state         = STATE_IDLE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t gc_sched_init(void)
+{
+    ret_code_t rc;
+
+    memset(&m_gc, 0, sizeof(m_gc));
+
+    rc = app_timer_create(&m_idle_timer, APP_TIMER_MODE_SINGLE_SHOT, idle_timer_handler);
+    VERIFY_SUCCESS(rc);
+
+#ifdef SOFTDEVICE_PRESENT
+    rc = sd_radio_session_open(radio_signal_handler);
+    VERIFY_SUCCESS(rc);
+#endif
+
+    return fds_register(fds_evt_handler);
+}
+
+
+void gc_sched_process(void)
+{
+    switch (m_gc.state)
+    {
+        case STATE_IDLE:
+        {
+            if (!m_gc.check || (ticks_since(m_gc.last_activity) < IDLE_TICKS))
+            {
+                return;
+            }
+
+            /* fds_stat reads every page header, so only look when records changed. */
+            fds_stat_t stat = {0};
+
+            m_gc.check = false;
+            if (   (fds_stat(&stat) == FDS_SUCCESS)
+                && (stat.freeable_words >= GC_SCHED_DIRTY_WORDS))
+            {
+                window_request();
+            }
+        } break;
+
+        case STATE_WINDOW:
+            (void) gc_start(false);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t gc_sched_run_now(void)
+{
+    if (m_gc.state == STATE_RUNNING)
+    {
+        return FDS_ERR_BUSY;
+    }
+
+    return gc_start(true);
+}
+
+
+void gc_sched_stat(gc_sched_stat_t * p_stat)
+{
+    *p_stat = m_gc.stat;
+}
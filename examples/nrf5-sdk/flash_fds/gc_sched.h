@@ -0,0 +1,134 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup gc_sched FDS garbage collection scheduler
+ * @{
+ * @brief Run FDS garbage collection in the background, before flash runs out.
+ *
+ * @details Without a policy, garbage collection runs only when the application finds out that
+ *          flash is full, and the write that failed then waits for a full collection. This
+ *          module starts a collection as soon as enough words are freeable, but only once the
+ *          flash has been idle for a while, so collections do not land in the middle of a burst
+ *          of writes that would then queue up behind them.
+ *
+ *          When the SoftDevice is present, the module also waits for a radio idle window: it
+ *          requests a short timeslot and starts the collection when the timeslot is granted,
+ *          so that the flash erases are not held back by radio activity that was already
+ *          scheduled.
+ *
+ *          FDS collects all pages in one operation and cannot be paused, so a pass is kept short
+ *          by starting it early: the threshold is set well below a page worth of dirty words.
+ *          The duration of every collection is recorded in a histogram.
+ */
+#ifndef GC_SCHED_H__
+#define GC_SCHED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_config.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef GC_SCHED_DIRTY_WORDS
+#define GC_SCHED_DIRTY_WORDS        (FDS_VIRTUAL_PAGE_SIZE / 4) /**< Freeable words that trigger a collection. */
+#endif
+
+#ifndef GC_SCHED_IDLE_MS
+#define GC_SCHED_IDLE_MS            100     /**< Time without FDS activity before a collection may start. */
+#endif
+
+#ifndef GC_SCHED_WINDOW_US
+#define GC_SCHED_WINDOW_US          1000    /**< Length of the radio idle window to request. */
+#endif
+
+#ifndef GC_SCHED_WINDOW_TIMEOUT_US
+#define GC_SCHED_WINDOW_TIMEOUT_US  500000  /**< Give up waiting for a radio idle window after this long. */
+#endif
+
+#ifndef GC_SCHED_SOC_OBSERVER_PRIO
+#define GC_SCHED_SOC_OBSERVER_PRIO  1       /**< Priority of the SoC event observer. */
+#endif
+
+#define GC_SCHED_HIST_BINS          6       /**< Bins of the duration histogram. */
+
+/**@brief Upper bounds of the histogram bins, in milliseconds. The last bin has no bound. */
+#define GC_SCHED_HIST_BOUNDS_MS     {10, 25, 50, 100, 250}
+
+
+/**@brief Scheduler statistics. */
+typedef struct
+{
+    uint32_t runs;                          /**< Collections started by the scheduler. */
+    uint32_t manual_runs;                   /**< Collections started with @ref gc_sched_run_now. */
+    uint32_t windows_missed;                /**< Radio idle windows that were blocked or timed out. */
+    uint32_t max_ms;                        /**< Longest collection. */
+    uint32_t hist[GC_SCHED_HIST_BINS];      /**< Collection durations. */
+} gc_sched_stat_t;
+
+
+/**@brief Function for initializing the scheduler. Registers an FDS event handler.
+ *
+ * @details Must be called after the app_timer is initialized. With the SoftDevice, it must be
+ *          called after the SoftDevice is enabled.
+ *
+ * @retval NRF_SUCCESS                 The scheduler was initialized.
+ * @retval FDS_ERR_USER_LIMIT_REACHED  FDS_MAX_USERS handlers are already registered.
+ * @return Any error from sd_radio_session_open.
+ */
+ret_code_t gc_sched_init(void);
+
+
+/**@brief Function for running the scheduler. Call it from the main loop. */
+void gc_sched_process(void);
+
+
+/**@brief Function for starting a collection now, outside the policy. The collection is measured
+ *        like the scheduled ones.
+ *
+ * @return The result of fds_gc.
+ */
+ret_code_t gc_sched_run_now(void);
+
+
+/**@brief Function for getting the scheduler statistics. */
+void gc_sched_stat(gc_sched_stat_t * p_stat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GC_SCHED_H__
+
+/** @} */
@@ -51,12 +51,28 @@
 #include "fds.h"
 #include "app_timer.h"
 #include "app_error.h"
+#include "nrf_pwr_mgmt.h"
 #include "nrf_cli.h"
 #include "fds_example.h"
+#include "fds_batch.h"
+#include "fds_index.h"
+#include "ts_log.h"
+#include "gc_sched.h"
+#include "cfg_cache.h"
+#include "energy_marker.h"
+
+#ifndef FDS_BENCHMARK_ENABLED
+#define FDS_BENCHMARK_ENABLED   0   /* Set to 1, or build the flash_fds_bench target, to time FDS operations instead of running the example. */
+#endif
+
+#if FDS_BENCHMARK_ENABLED
+#include "fds_bench.h"
+#endif
 
 #define NRF_LOG_MODULE_NAME app
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
+#include "nrf_log_backend_bin.h"
 
 
 /* A tag identifying the SoftDevice BLE configuration. */
@@ -95,8 +111,8 @@ static char const * fds_evt_str[] =
     "FDS_EVT_GC",
 };
 
-/* Dummy configuration data. */
-static configuration_t m_dummy_cfg =
+/* Dummy configuration data, used when there is no configuration in flash. */
+static configuration_t const m_dummy_cfg =
 {
     .config1_on  = false,
     .config2_on  = true,
@@ -104,29 +120,21 @@ static configuration_t m_dummy_cfg =
     .device_name = "dummy",
 };
 
-/* A record containing dummy configuration data. */
-static fds_record_t const m_dummy_record =
-{
-    .file_id           = CONFIG_FILE,
-    .key               = CONFIG_REC_KEY,
-    .data.p_data       = &m_dummy_cfg,
-    /* The length of a record is always expressed in 4-byte units (words). */
-    .data.length_words = (sizeof(m_dummy_cfg) + 3) / sizeof(uint32_t),
-};
-
-/* Keep track of the progress of a delete_all operation. */
-static struct
-{
-    bool delete_next;   //!< Delete next record.
-    bool pending;       //!< Waiting for an fds FDS_EVT_DEL_RECORD event, to delete the next record.
-} m_delete_all;
-
 /* Flag to check fds initialization. */
 static bool volatile m_fds_initialized;
 
 
 static void fds_evt_handler(fds_evt_t const * p_evt)
 {
+    /* Keep the record index in sync before anything looks records up. */
+    fds_index_on_fds_evt(p_evt);
+
+    if (fds_batch_evt_is_own(p_evt))
+    {
+        /* Batched operations are reported once, in fds_batch_evt_handler(). */
+        return;
+    }
+
     NRF_LOG_GREEN("Event: %s received (%s)",
                   fds_evt_str[p_evt->id],
                   fds_err_str[p_evt->result]);
@@ -158,7 +166,6 @@ static void fds_evt_handler(fds_evt_t const * p_evt)
                 NRF_LOG_INFO("File ID:\t0x%04x",    p_evt->del.file_id);
                 NRF_LOG_INFO("Record key:\t0x%04x", p_evt->del.record_key);
             }
-            m_delete_all.pending = false;
         } break;
 
         default:
@@ -167,29 +174,58 @@ static void fds_evt_handler(fds_evt_t const * p_evt)
 }
 
 
-/**@brief   Begin deleting all records, one by one. */
-void delete_all_begin(void)
+static void fds_batch_evt_handler(fds_batch_evt_t const * p_evt)
 {
-    m_delete_all.delete_next = true;
+    static char const * batch_str[] =
+    {
+        "write",
+        "delete",
+        "delete all",
+    };
+
+    NRF_LOG_GREEN("Batch %s done: %u records, %u failed (%s)",
+                  batch_str[p_evt->type],
+                  p_evt->done,
+                  p_evt->failed,
+                  fds_err_str[p_evt->result]);
+
+    if ((p_evt->type == FDS_BATCH_DELETE_ALL) && (p_evt->result == FDS_SUCCESS))
+    {
+        NRF_LOG_CYAN("No records left to delete.");
+    }
+}
+
+
+static void ts_log_evt_handler(ts_log_evt_t const * p_evt)
+{
+    switch (p_evt->type)
+    {
+        case TS_LOG_EVT_READY:
+            NRF_LOG_INFO("Time-series log resumes at block %d.", p_evt->seq);
+            break;
+
+        case TS_LOG_EVT_BLOCK_WRITTEN:
+            NRF_LOG_GREEN("Time-series block %d written (%s)",
+                          p_evt->seq,
+                          fds_err_str[p_evt->result]);
+            break;
+
+        default:
+            break;
+    }
 }
 
 
-/**@brief   Process a delete all command.
+/**@brief   Begin deleting all records.
  *
- * Delete records, one by one, until no records are left.
+ * The deletes are queued as a single batch; one event is logged when they are done.
  */
-void delete_all_process(void)
+void delete_all_begin(void)
 {
-    if (   m_delete_all.delete_next
-        & !m_delete_all.pending)
+    ret_code_t rc = fds_batch_delete_all();
+    if (rc != FDS_SUCCESS)
     {
-        NRF_LOG_INFO("Deleting next record.");
-
-        m_delete_all.delete_next = record_delete_next();
-        if (!m_delete_all.delete_next)
-        {
-            NRF_LOG_CYAN("No records left to delete.");
-        }
+        NRF_LOG_INFO("Could not delete all records: %s.", fds_err_str[rc]);
     }
 }
 
@@ -239,17 +275,26 @@ static void log_init(void)
 {
     ret_code_t rc = NRF_LOG_INIT(NULL);
     APP_ERROR_CHECK(rc);
+
+#if NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN)
+    rc = nrf_log_backend_bin_init();
+    APP_ERROR_CHECK(rc);
+#endif
 }
 
 
 /**@brief   Sleep until an event is received. */
 static void power_manage(void)
 {
+    energy_phase_t phase = energy_marker_begin(ENERGY_PHASE_SLEEP);
+
 #ifdef SOFTDEVICE_PRESENT
     (void) sd_app_evt_wait();
 #else
     __WFE();
 #endif
+
+    energy_marker_end(phase);
 }
 
 
@@ -275,13 +320,48 @@ int main(void)
 
     timer_init();
     log_init();
+
+    rc = nrf_pwr_mgmt_init();
+    APP_ERROR_CHECK(rc);
+
+    energy_marker_init();
     cli_init();
 
     NRF_LOG_INFO("FDS example started.")
 
+#if FDS_BENCHMARK_ENABLED
+    /* Time FDS on its own: none of the example's FDS users are registered. */
+    NRF_LOG_INFO("Running the FDS benchmark, results on RTT channel %d.", FDS_BENCH_RTT_CHANNEL);
+    NRF_LOG_FLUSH();
+
+    fds_bench_run();
+
+    NRF_LOG_INFO("FDS benchmark done.");
+    for (;;)
+    {
+        if (!NRF_LOG_PROCESS())
+        {
+            power_manage();
+        }
+    }
+#endif
+
     /* Register first to receive an event when initialization is complete. */
     (void) fds_register(fds_evt_handler);
 
+    rc = fds_batch_init(fds_batch_evt_handler);
+    APP_ERROR_CHECK(rc);
+
+    rc = ts_log_init(ts_log_evt_handler);
+    APP_ERROR_CHECK(rc);
+
+    /* Collect garbage in the background instead of waiting for flash to fill up. */
+    rc = gc_sched_init();
+    APP_ERROR_CHECK(rc);
+
+    rc = cfg_cache_init();
+    APP_ERROR_CHECK(rc);
+
     NRF_LOG_INFO("Initializing fds...");
 
     rc = fds_init();
@@ -296,9 +376,12 @@ int main(void)
     NRF_LOG_INFO("- update\t\tupdate configuration");
     NRF_LOG_INFO("- stat\t\tshow statistics");
     NRF_LOG_INFO("- write\t\twrite a new record");
+    NRF_LOG_INFO("- write_batch\twrite many records at once");
     NRF_LOG_INFO("- delete\t\tdelete a record");
     NRF_LOG_INFO("- delete_all\tdelete all records");
     NRF_LOG_INFO("- gc\t\trun garbage collection");
+    NRF_LOG_INFO("- ts\t\tappend and read back time-series samples");
+    NRF_LOG_INFO("- shutdown\tsave the configuration and power off");
 
     NRF_LOG_INFO("Reading flash usage statistics...");
 
@@ -310,43 +393,25 @@ int main(void)
     NRF_LOG_INFO("Found %d valid records.", stat.valid_records);
     NRF_LOG_INFO("Found %d dirty records (ready to be garbage collected).", stat.dirty_records);
 
-    fds_record_desc_t desc = {0};
-    fds_find_token_t  tok  = {0};
+    NRF_LOG_INFO("Indexed %d records.", fds_index_count());
 
-    rc = fds_record_find(CONFIG_FILE, CONFIG_REC_KEY, &desc, &tok);
+    rc = cfg_cache_load(&m_dummy_cfg);
 
     if (rc == FDS_SUCCESS)
     {
         /* A config file is in flash. Let's update it. */
-        fds_flash_record_t config = {0};
-
-        /* Open the record and read its contents. */
-        rc = fds_record_open(&desc, &config);
-        APP_ERROR_CHECK(rc);
+        configuration_t cfg = *cfg_cache_get();
 
-        /* Copy the configuration from flash into m_dummy_cfg. */
-        memcpy(&m_dummy_cfg, config.p_data, sizeof(configuration_t));
+        NRF_LOG_INFO("Config file found, updating boot count to %d.", cfg.boot_count);
 
-        NRF_LOG_INFO("Config file found, updating boot count to %d.", m_dummy_cfg.boot_count);
-
-        /* Update boot count. */
-        m_dummy_cfg.boot_count++;
-
-        /* Close the record when done reading. */
-        rc = fds_record_close(&desc);
-        APP_ERROR_CHECK(rc);
-
-        /* Write the updated record to flash. */
-        rc = fds_record_update(&desc, &m_dummy_record);
-        APP_ERROR_CHECK(rc);
+        /* Update boot count. The record is written once the configuration stops changing. */
+        cfg.boot_count++;
+        cfg_cache_set(&cfg);
     }
     else
     {
-        /* System config not found; write a new one. */
+        /* System config not found; the cache writes the default one. */
         NRF_LOG_INFO("Writing config file...");
-
-        rc = fds_record_write(&desc, &m_dummy_record);
-        APP_ERROR_CHECK(rc);
     }
 
     cli_start();
@@ -359,7 +424,7 @@ int main(void)
             power_manage();
         }
         cli_process();
-        delete_all_process();
+        gc_sched_process();
     }
 }
 
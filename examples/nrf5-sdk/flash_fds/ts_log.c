@@ -0,0 +1,415 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "ts_log.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "sdk_common.h"
+#include "energy_marker.h"
+
+#define NO_RECORD       0   /**< FDS never assigns record ID 0. */
+#define VARINT_MAX_LEN  5   /**< Bytes of a 32-bit varint, at most. */
+
+STATIC_ASSERT(offsetof(ts_log_block_t, data) == 16);
+STATIC_ASSERT(sizeof(ts_log_block_t) == TS_LOG_BLOCK_WORDS * sizeof(uint32_t));
+
+static struct
+{
+    ts_log_evt_handler_t evt_handler;
+    ts_log_block_t       blocks[2];
+    uint8_t              fill;              //!< Index of the block being filled.
+    uint32_t             write_record_id;   //!< Record ID of the block being written, or NO_RECORD.
+    bool                 queuing;           //!< fds_record_write of a block is running.
+    bool                 queued_done;       //!< The block being queued was written inside the call.
+    energy_phase_t       write_phase;       //!< Phase to go back to when the block is written.
+    ts_log_sample_t      last;              //!< Last appended sample.
+    uint32_t             next_seq;
+    uint32_t             blocks_written;
+    bool                 ready;             //!< FDS is initialized and next_seq restored.
+} m_log;
+
+
+/**@brief   Map signed deltas to unsigned ones, so that small negative deltas encode short. */
+static uint32_t zigzag_encode(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+
+static int32_t zigzag_decode(uint32_t u)
+{
+    return (int32_t)((u >> 1) ^ (0 - (u & 1)));
+}
+
+
+/**@brief   Encode a value as LEB128: seven bits per byte, lowest first, high bit set on all but
+ *          the last byte.
+ *
+ * @return  Number of bytes written.
+ */
+static uint32_t varint_encode(uint8_t * p_buf, uint32_t value)
+{
+    uint32_t len = 0;
+
+    while (value >= 0x80)
+    {
+        p_buf[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p_buf[len++] = (uint8_t)value;
+
+    return len;
+}
+
+
+/**@brief   Decode a varint from a block.
+ *
+ * @return  false if the varint runs past the end of the block data.
+ */
+static bool varint_decode(ts_log_cursor_t * p_cursor, uint32_t * p_value)
+{
+    uint32_t value = 0;
+
+    for (uint32_t shift = 0; shift < 7 * VARINT_MAX_LEN; shift += 7)
+    {
+        if (p_cursor->offset >= p_cursor->p_block->len)
+        {
+            return false;
+        }
+
+        uint8_t const byte = p_cursor->p_block->data[p_cursor->offset++];
+
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *p_value = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**@brief   Queue the block being filled for writing and start filling the other one. */
+static ret_code_t block_commit(void)
+{
+    ts_log_block_t * const p_block = &m_log.blocks[m_log.fill];
+
+    if ((m_log.write_record_id != NO_RECORD) || m_log.queuing)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    fds_record_desc_t  desc = {0};
+    fds_record_t const rec  =
+    {
+        .file_id           = TS_LOG_FILE_ID,
+        .key               = TS_LOG_REC_KEY,
+        .data.p_data       = p_block,
+        /* A partly filled block is written without its unused tail. */
+        .data.length_words = (offsetof(ts_log_block_t, data) + p_block->len + 3) / sizeof(uint32_t),
+    };
+
+    /* Without a SoftDevice, FDS writes the record through the NVMC and sends its event before
+     * returning, so the blocks are switched first. */
+    m_log.next_seq++;
+    m_log.fill ^= 1;
+    m_log.blocks[m_log.fill].count = 0;
+
+    m_log.queuing     = true;
+    m_log.queued_done = false;
+
+    /* Marked until the FDS event, in case FDS only queues the write. */
+    m_log.write_phase = energy_marker_begin(ENERGY_PHASE_FDS_WRITE);
+    ret_code_t rc     = fds_record_write(&desc, &rec);
+
+    m_log.queuing = false;
+
+    if (rc != FDS_SUCCESS)
+    {
+        energy_marker_end(m_log.write_phase);
+        m_log.fill ^= 1;
+        m_log.next_seq--;
+        return rc;
+    }
+
+    if (!m_log.queued_done)
+    {
+        m_log.write_record_id = desc.record_id;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief   Continue the sequence numbers from the blocks in flash. */
+static void seq_restore(void)
+{
+    ts_log_reader_t        reader  = {0};
+    ts_log_block_t const * p_block = NULL;
+    bool                   found   = false;
+
+    m_log.next_seq = 0;
+
+    while (ts_log_reader_next(&reader, &p_block) == FDS_SUCCESS)
+    {
+        if (!found || (int32_t)(p_block->seq - m_log.next_seq) >= 0)
+        {
+            m_log.next_seq = p_block->seq + 1;
+            found          = true;
+        }
+    }
+}
+
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    ts_log_evt_t evt =
+    {
+        .result = p_evt->result,
+    };
+
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            if (p_evt->result != FDS_SUCCESS)
+            {
+                return;
+            }
+
+            seq_restore();
+            m_log.ready = true;
+
+            evt.type = TS_LOG_EVT_READY;
+            evt.seq  = m_log.next_seq;
+            break;
+
+        case FDS_EVT_WRITE:
+            if (   m_log.queuing
+                && (p_evt->write.file_id    == TS_LOG_FILE_ID)
+                && (p_evt->write.record_key == TS_LOG_REC_KEY))
+            {
+                /* The record ID is not known yet; FDS runs its queue in order, so this is it. */
+                m_log.queued_done = true;
+            }
+            else if (   (m_log.write_record_id == NO_RECORD)
+                     || (p_evt->write.record_id != m_log.write_record_id))
+            {
+                return;
+            }
+
+            m_log.write_record_id = NO_RECORD;
+            energy_marker_end(m_log.write_phase);
+            if (p_evt->result == FDS_SUCCESS)
+            {
+                m_log.blocks_written++;
+            }
+
+            evt.type = TS_LOG_EVT_BLOCK_WRITTEN;
+            evt.seq  = m_log.blocks[m_log.fill ^ 1].seq;
+            break;
+
+        default:
+            return;
+    }
+
+    if (m_log.evt_handler != NULL)
+    {
+        m_log.evt_handler(&evt);
+    }
+}
+
+
+ret_code_t ts_log_init(ts_log_evt_handler_t evt_handler)
+{
+    memset(&m_log, 0, sizeof(m_log));
+    m_log.evt_handler = evt_handler;
+
+    return fds_register(fds_evt_handler);
+}
+
+
+ret_code_t ts_log_append(uint32_t timestamp, int32_t value)
+{
+    ts_log_block_t * p_block = &m_log.blocks[m_log.fill];
+
+    if (!m_log.ready)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_block->count != 0)
+    {
+        if (timestamp < m_log.last.timestamp)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+
+        /* Wrapping arithmetic: the decoder wraps the same way. */
+        uint32_t const dt = timestamp - m_log.last.timestamp;
+        int32_t  const dv = (int32_t)((uint32_t)value - (uint32_t)m_log.last.value);
+
+        uint8_t  delta[2 * VARINT_MAX_LEN];
+        uint32_t len;
+
+        len  = varint_encode(&delta[0],   dt);
+        len += varint_encode(&delta[len], zigzag_encode(dv));
+
+        if (p_block->len + len <= TS_LOG_DATA_SIZE)
+        {
+            memcpy(&p_block->data[p_block->len], delta, len);
+            p_block->len += len;
+            p_block->count++;
+
+            m_log.last.timestamp = timestamp;
+            m_log.last.value     = value;
+
+            return NRF_SUCCESS;
+        }
+
+        /* The block is full: the sample starts the next one. */
+        ret_code_t rc = block_commit();
+        if (rc != NRF_SUCCESS)
+        {
+            return rc;
+        }
+
+        p_block = &m_log.blocks[m_log.fill];
+    }
+
+    p_block->seq   = m_log.next_seq;
+    p_block->t0    = timestamp;
+    p_block->v0    = value;
+    p_block->count = 1;
+    p_block->len   = 0;
+
+    m_log.last.timestamp = timestamp;
+    m_log.last.value     = value;
+
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t ts_log_flush(void)
+{
+    if (m_log.blocks[m_log.fill].count == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return block_commit();
+}
+
+
+ret_code_t ts_log_reader_next(ts_log_reader_t * p_reader, ts_log_block_t const ** pp_block)
+{
+    ts_log_reader_close(p_reader);
+
+    while (fds_record_find(TS_LOG_FILE_ID, TS_LOG_REC_KEY, &p_reader->desc, &p_reader->tok)
+           == FDS_SUCCESS)
+    {
+        fds_flash_record_t frec = {0};
+
+        if (fds_record_open(&p_reader->desc, &frec) != FDS_SUCCESS)
+        {
+            /* Skip blocks that fail the CRC check. */
+            continue;
+        }
+
+        p_reader->is_open = true;
+        *pp_block         = (ts_log_block_t const *)(frec.p_data);
+
+        return FDS_SUCCESS;
+    }
+
+    return FDS_ERR_NOT_FOUND;
+}
+
+
+void ts_log_reader_close(ts_log_reader_t * p_reader)
+{
+    if (p_reader->is_open)
+    {
+        (void) fds_record_close(&p_reader->desc);
+        p_reader->is_open = false;
+    }
+}
+
+
+void ts_log_cursor_init(ts_log_cursor_t * p_cursor, ts_log_block_t const * p_block)
+{
+    memset(p_cursor, 0, sizeof(ts_log_cursor_t));
+    p_cursor->p_block = p_block;
+}
+
+
+bool ts_log_cursor_next(ts_log_cursor_t * p_cursor, ts_log_sample_t * p_sample)
+{
+    ts_log_block_t const * const p_block = p_cursor->p_block;
+
+    if (p_cursor->index >= p_block->count)
+    {
+        return false;
+    }
+
+    if (p_cursor->index == 0)
+    {
+        p_cursor->sample.timestamp = p_block->t0;
+        p_cursor->sample.value     = p_block->v0;
+    }
+    else
+    {
+        uint32_t dt;
+        uint32_t dv;
+
+        if (!varint_decode(p_cursor, &dt) || !varint_decode(p_cursor, &dv))
+        {
+            return false;
+        }
+
+        p_cursor->sample.timestamp += dt;
+        p_cursor->sample.value      = (int32_t)((uint32_t)p_cursor->sample.value
+                                              + (uint32_t)zigzag_decode(dv));
+    }
+
+    p_cursor->index++;
+    *p_sample = p_cursor->sample;
+
+    return true;
+}
+
+
+void ts_log_stat(ts_log_stat_t * p_stat)
+{
+    p_stat->next_seq         = m_log.next_seq;
+    p_stat->blocks_written   = m_log.blocks_written;
+    p_stat->samples_buffered = m_log.blocks[m_log.fill].count;
+}
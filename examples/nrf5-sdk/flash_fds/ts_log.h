@@ -0,0 +1,225 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup ts_log Time-series log
+ * @{
+ * @brief Append-only log of timestamped sensor samples, stored in FDS.
+ *
+ * @details Samples are delta-encoded and packed into blocks, and each full block is written as a
+ *          single FDS record. A steady sensor stream takes about two bytes per sample instead of
+ *          the record header, CRC and padding that a record per sample costs, and the flash is
+ *          written once per block instead of once per sample.
+ *
+ *          Each block carries a sequence number, which continues after a reset from the highest
+ *          sequence number found in flash. Blocks are read back in place: the reader hands out
+ *          pointers into flash, and a cursor decodes the samples of a block one at a time.
+ *
+ *          Two block buffers are used, so samples can be appended while the previous block is
+ *          being written. Samples still in RAM are not seen by the reader until the block is
+ *          full or @ref ts_log_flush is called.
+ */
+#ifndef TS_LOG_H__
+#define TS_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fds.h"
+#include "sdk_config.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TS_LOG_FILE_ID
+#define TS_LOG_FILE_ID          (0x7501)    /**< FDS file ID of the log blocks. */
+#endif
+
+#ifndef TS_LOG_REC_KEY
+#define TS_LOG_REC_KEY          (0x7502)    /**< FDS record key of the log blocks. */
+#endif
+
+#ifndef TS_LOG_BLOCKS_PER_PAGE
+#define TS_LOG_BLOCKS_PER_PAGE  4           /**< Blocks that fit in one FDS virtual page. */
+#endif
+
+/**@brief Size of a block, in words. A virtual page has a two-word page tag and each record a
+ *        three-word header. */
+#define TS_LOG_BLOCK_WORDS      (((FDS_VIRTUAL_PAGE_SIZE - 2) / TS_LOG_BLOCKS_PER_PAGE) - 3)
+
+/**@brief Bytes of a block available for delta-encoded samples, after the 16-byte block header. */
+#define TS_LOG_DATA_SIZE        ((TS_LOG_BLOCK_WORDS * sizeof(uint32_t)) - 16)
+
+
+/**@brief A sample. */
+typedef struct
+{
+    uint32_t timestamp;     /**< Sample time, in any unit. Must not decrease. */
+    int32_t  value;         /**< Sample value. */
+} ts_log_sample_t;
+
+/**@brief A block of samples, as stored in flash. */
+typedef struct
+{
+    uint32_t seq;                       /**< Sequence number, one higher than the previous block. */
+    uint32_t t0;                        /**< Timestamp of the first sample. */
+    int32_t  v0;                        /**< Value of the first sample. */
+    uint16_t count;                     /**< Number of samples, including the first. */
+    uint16_t len;                       /**< Bytes used in @ref data. */
+    uint8_t  data[TS_LOG_DATA_SIZE];    /**< Time and value deltas of the other samples, as varints. */
+} ts_log_block_t;
+
+/**@brief Cursor over the samples of a block. */
+typedef struct
+{
+    ts_log_block_t const * p_block;
+    ts_log_sample_t        sample;      /**< Last decoded sample. */
+    uint16_t               index;       /**< Number of samples decoded. */
+    uint16_t               offset;      /**< Read position in the block data. */
+} ts_log_cursor_t;
+
+/**@brief Reader of the blocks in flash. Zero-initialize before the first call to
+ *        @ref ts_log_reader_next. */
+typedef struct
+{
+    fds_find_token_t  tok;
+    fds_record_desc_t desc;
+    bool              is_open;          /**< The last returned block is open. */
+} ts_log_reader_t;
+
+/**@brief Log statistics. */
+typedef struct
+{
+    uint32_t next_seq;                  /**< Sequence number of the block being filled. */
+    uint32_t blocks_written;            /**< Blocks written since reset. */
+    uint32_t samples_buffered;          /**< Samples in RAM, not written yet. */
+} ts_log_stat_t;
+
+/**@brief Event types. */
+typedef enum
+{
+    TS_LOG_EVT_READY,                   /**< FDS is initialized and the sequence number restored. */
+    TS_LOG_EVT_BLOCK_WRITTEN,           /**< A block write finished; see the result. */
+} ts_log_evt_type_t;
+
+/**@brief Event. */
+typedef struct
+{
+    ts_log_evt_type_t type;
+    ret_code_t        result;           /**< FDS result of the block write. */
+    uint32_t          seq;              /**< Sequence number of the block, or the next block on ready. */
+} ts_log_evt_t;
+
+/**@brief Event handler type. Called from the FDS event handler. */
+typedef void (*ts_log_evt_handler_t)(ts_log_evt_t const * p_evt);
+
+
+/**@brief Function for initializing the module. Registers an FDS event handler.
+ *
+ * @details Must be called before fds_init, so that the log sees FDS_EVT_INIT.
+ *
+ * @param[in] evt_handler  Event handler. Can be NULL.
+ *
+ * @retval FDS_SUCCESS                 The module was initialized.
+ * @retval FDS_ERR_USER_LIMIT_REACHED  FDS_MAX_USERS handlers are already registered.
+ */
+ret_code_t ts_log_init(ts_log_evt_handler_t evt_handler);
+
+
+/**@brief Function for appending a sample.
+ *
+ * @details If the sample does not fit in the current block, the block is queued for writing
+ *          and the sample starts the next one.
+ *
+ * @retval NRF_SUCCESS              The sample was added.
+ * @retval NRF_ERROR_INVALID_STATE  FDS is not initialized yet.
+ * @retval NRF_ERROR_INVALID_PARAM  The timestamp is older than the previous sample.
+ * @retval NRF_ERROR_BUSY           Both blocks are full; the previous block is still being
+ *                                  written. The sample was not added.
+ * @return Any error from fds_record_write. The sample was not added.
+ */
+ret_code_t ts_log_append(uint32_t timestamp, int32_t value);
+
+
+/**@brief Function for writing the current block even if it is not full.
+ *
+ * @retval NRF_SUCCESS     The block was queued for writing, or it was empty.
+ * @retval NRF_ERROR_BUSY  The previous block is still being written.
+ * @return Any error from fds_record_write.
+ */
+ret_code_t ts_log_flush(void);
+
+
+/**@brief Function for getting the next block in flash.
+ *
+ * @details The block is opened in place and stays valid until the next call with the same
+ *          reader, or @ref ts_log_reader_close. Blocks are returned in flash order, which is
+ *          not necessarily the order of their sequence numbers after garbage collection.
+ *
+ * @param[in,out] p_reader  Reader.
+ * @param[out]    pp_block  The block.
+ *
+ * @retval FDS_SUCCESS        A block was returned.
+ * @retval FDS_ERR_NOT_FOUND  There are no more blocks. The reader is closed.
+ */
+ret_code_t ts_log_reader_next(ts_log_reader_t * p_reader, ts_log_block_t const ** pp_block);
+
+
+/**@brief Function for closing a reader before it reaches the last block. */
+void ts_log_reader_close(ts_log_reader_t * p_reader);
+
+
+/**@brief Function for starting to decode the samples of a block. */
+void ts_log_cursor_init(ts_log_cursor_t * p_cursor, ts_log_block_t const * p_block);
+
+
+/**@brief Function for decoding the next sample of a block.
+ *
+ * @param[in,out] p_cursor  Cursor.
+ * @param[out]    p_sample  The sample.
+ *
+ * @retval true   A sample was decoded.
+ * @retval false  There are no more samples, or the block is corrupt.
+ */
+bool ts_log_cursor_next(ts_log_cursor_t * p_cursor, ts_log_sample_t * p_sample);
+
+
+/**@brief Function for getting log statistics. */
+void ts_log_stat(ts_log_stat_t * p_stat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TS_LOG_H__
+
+/** @} */
@@ -46,22 +46,71 @@
  *
  */
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include "nfc_t2t_lib.h"
-#include "nfc_uri_msg.h"
+#include "nfc_ndef_msg.h"
+#include "nfc_uri_rec.h"
+#include "nfc_text_rec.h"
 #include "boards.h"
 #include "app_error.h"
+#include "sdk_macros.h"
 #include "hardfault.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
+#define NDEF_MSG_BUF_SIZE       256                                 /**< Size of each NDEF message buffer. */
+#define STATUS_MSG_RECORDS      2                                   /**< Records in the status message: URI and text. */
+#define STATUS_FIELD_MAX_LEN    48                                  /**< Maximum length of the formatted URI and text fields. */
+
 /** @snippet [NFC URI usage_0] */
-static const uint8_t m_url[] =
-    {'m', 'a', 'k', 'e', 'r', 'd', 'i', 'a', 'r', 'y', '.', 'c', 'o', 'm'}; //URL "makerdiary.com"
+static const char m_url[] = "makerdiary.com";                       /**< Host part of the status URL. */
+static const uint8_t m_en_code[] = {'e', 'n'};                      /**< Language code of the text record. */
 
-uint8_t m_ndef_msg_buf[256];
+/**@brief NDEF message buffers.
+ *
+ * @details The front buffer holds the message the tag is emulating and is never written while it is
+ *          in use. New messages are encoded into the back buffer from thread mode and handed over
+ *          with @ref m_swap_pending. @ref nfc_callback exchanges the buffers on
+ *          @ref NFC_T2T_EVENT_FIELD_OFF, that is while no reader is present, so a reader always
+ *          sees either the old or the new message in full and emulation is only restarted while
+ *          the field is off.
+ */
+static uint8_t           m_ndef_msg_buf[2][NDEF_MSG_BUF_SIZE];
+static uint32_t          m_ndef_msg_len[2];
+static volatile uint8_t  m_front;                                   /**< Index of the buffer set as the tag payload. */
+static volatile bool     m_swap_pending;                            /**< The back buffer holds a complete message that has not been swapped in yet. */
+static volatile uint32_t m_read_count;                              /**< Number of times a reader field was detected, the live data carried by the tag. */
 /** @snippet [NFC URI usage_0] */
+
+
+/**@brief Function for swapping the back NDEF buffer in as the tag payload.
+ *
+ * @details Called on @ref NFC_T2T_EVENT_FIELD_OFF only. The T2T library accepts a new payload only
+ *          while emulation is stopped, so emulation is restarted here, before the next reader can
+ *          power the tag.
+ */
+static void ndef_buffer_swap(void)
+{
+    ret_code_t err_code;
+    uint8_t    back = m_front ^ 1;
+
+    err_code = nfc_t2t_emulation_stop();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nfc_t2t_payload_set(m_ndef_msg_buf[back], m_ndef_msg_len[back]);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nfc_t2t_emulation_start();
+    APP_ERROR_CHECK(err_code);
+
+    m_front        = back;
+    m_swap_pending = false;
+}
+
+
 /**
  * @brief Callback function for handling NFC events.
  */
@@ -72,10 +121,15 @@ static void nfc_callback(void * p_context, nfc_t2t_event_t event, const uint8_t
     switch (event)
     {
         case NFC_T2T_EVENT_FIELD_ON:
+            m_read_count++;
             bsp_board_led_on(BSP_BOARD_LED_0);
             break;
 
         case NFC_T2T_EVENT_FIELD_OFF:
+            if (m_swap_pending)
+            {
+                ndef_buffer_swap();
+            }
             bsp_board_led_off(BSP_BOARD_LED_0);
             break;
 
@@ -85,6 +139,83 @@ static void nfc_callback(void * p_context, nfc_t2t_event_t event, const uint8_t
 }
 
 
+/**@brief Function for encoding the device status message.
+ *
+ * @details Builds a message with two records: a URI record carrying the status URL, which phones
+ *          open directly, followed by a text record with the same data in readable form. Further
+ *          records are added the same way, after raising @ref STATUS_MSG_RECORDS.
+ *
+ * @param[in]     read_count Value reported in the message.
+ * @param[out]    p_buf      Buffer for the encoded message.
+ * @param[in,out] p_len      Size of the buffer on input, length of the message on output.
+ *
+ * @return NRF_SUCCESS or an error code returned by the NDEF message encoder.
+ */
+static ret_code_t status_msg_encode(uint32_t read_count, uint8_t * p_buf, uint32_t * p_len)
+{
+    ret_code_t err_code;
+    char       uri[STATUS_FIELD_MAX_LEN];
+    char       text[STATUS_FIELD_MAX_LEN];
+    int        uri_len;
+    int        text_len;
+
+    uri_len  = snprintf(uri, sizeof(uri), "%s/?reads=%lu", m_url, (unsigned long)read_count);
+    text_len = snprintf(text, sizeof(text), "Read %lu times", (unsigned long)read_count);
+    if ((uri_len >= (int)sizeof(uri)) || (text_len >= (int)sizeof(text)))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    NFC_NDEF_MSG_DEF(status_msg, STATUS_MSG_RECORDS);
+    NFC_NDEF_URI_RECORD_DESC_DEF(status_uri_rec, NFC_URI_HTTPS, (uint8_t *)uri, uri_len);
+    NFC_NDEF_TEXT_RECORD_DESC_DEF(status_text_rec, UTF_8, m_en_code, sizeof(m_en_code),
+                                  (uint8_t *)text, text_len);
+
+    /* The message descriptor is static; drop the records added by the previous call */
+    nfc_ndef_msg_clear(&NFC_NDEF_MSG(status_msg));
+
+    err_code = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(status_msg),
+                                       &NFC_NDEF_URI_RECORD_DESC(status_uri_rec));
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(status_msg),
+                                       &NFC_NDEF_TEXT_RECORD_DESC(status_text_rec));
+    VERIFY_SUCCESS(err_code);
+
+    return nfc_ndef_msg_encode(&NFC_NDEF_MSG(status_msg), p_buf, p_len);
+}
+
+
+/**@brief Function for encoding the current status into the back buffer.
+ *
+ * @details Does nothing while a previous update is still waiting for the field to go off; the
+ *          status is then encoded again once that update has been swapped in, so the tag catches
+ *          up with the latest value without the back buffer being written under the swap.
+ *
+ * @param[in,out] p_encoded_count Read count carried by the newest encoded message.
+ */
+static void status_update(uint32_t * p_encoded_count)
+{
+    ret_code_t err_code;
+    uint32_t   read_count = m_read_count;
+    uint8_t    back       = m_front ^ 1;
+
+    if (m_swap_pending || (read_count == *p_encoded_count))
+    {
+        return;
+    }
+
+    m_ndef_msg_len[back] = sizeof(m_ndef_msg_buf[back]);
+    err_code = status_msg_encode(read_count, m_ndef_msg_buf[back], &m_ndef_msg_len[back]);
+    APP_ERROR_CHECK(err_code);
+
+    *p_encoded_count = read_count;
+    m_swap_pending   = true;
+
+    NRF_LOG_INFO("Status message for %d reads queued (%d bytes).", read_count, m_ndef_msg_len[back]);
+}
+
+
 /**
  *@brief Function for initializing logging.
  */
@@ -103,6 +234,7 @@ static void log_init(void)
 int main(void)
 {
     uint32_t  err_code;
+    uint32_t  encoded_count = 0;
 
     log_init();
 
@@ -113,22 +245,13 @@ int main(void)
     err_code = nfc_t2t_setup(nfc_callback, NULL);
     APP_ERROR_CHECK(err_code);
 
-    /** @snippet [NFC URI usage_1] */
-    /* Provide information about available buffer size to encoding function */
-    uint32_t len = sizeof(m_ndef_msg_buf);
-
-    /* Encode URI message into buffer */
-    err_code = nfc_uri_msg_encode( NFC_URI_HTTPS,
-                                   m_url,
-                                   sizeof(m_url),
-                                   m_ndef_msg_buf,
-                                   &len);
-
+    /* Encode the initial status message into the front buffer */
+    m_ndef_msg_len[m_front] = sizeof(m_ndef_msg_buf[m_front]);
+    err_code = status_msg_encode(encoded_count, m_ndef_msg_buf[m_front], &m_ndef_msg_len[m_front]);
     APP_ERROR_CHECK(err_code);
-    /** @snippet [NFC URI usage_1] */
 
     /* Set created message as the NFC payload */
-    err_code = nfc_t2t_payload_set(m_ndef_msg_buf, len);
+    err_code = nfc_t2t_payload_set(m_ndef_msg_buf[m_front], m_ndef_msg_len[m_front]);
     APP_ERROR_CHECK(err_code);
 
     /* Start sensing NFC field */
@@ -137,6 +260,9 @@ int main(void)
 
     while (1)
     {
+        /* Field events wake the CPU; prepare the next message while the reader is still there */
+        status_update(&encoded_count);
+
         NRF_LOG_FLUSH();
         __WFE();
     }
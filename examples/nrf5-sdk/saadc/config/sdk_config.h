@@ -694,6 +694,42 @@
 
 // </e>
 
+// <e> NRF_CLOCK_ENABLED - nrf_drv_clock - CLOCK peripheral driver - legacy layer
+//==========================================================
+#ifndef NRF_CLOCK_ENABLED
+#define NRF_CLOCK_ENABLED 1
+#endif
+// <o> CLOCK_CONFIG_LF_SRC  - LF Clock Source
+ 
+// <0=> RC 
+// <1=> XTAL 
+// <2=> Synth 
+// <131073=> External Low Swing 
+// <196609=> External Full Swing 
+
+#ifndef CLOCK_CONFIG_LF_SRC
+#define CLOCK_CONFIG_LF_SRC 1
+#endif
+
+// <o> CLOCK_CONFIG_IRQ_PRIORITY  - Interrupt priority
+ 
+
+// <i> Priorities 0,2 (nRF51) and 0,1,4,5 (nRF52) are reserved for SoftDevice
+// <0=> 0 (highest) 
+// <1=> 1 
+// <2=> 2 
+// <3=> 3 
+// <4=> 4 
+// <5=> 5 
+// <6=> 6 
+// <7=> 7 
+
+#ifndef CLOCK_CONFIG_IRQ_PRIORITY
+#define CLOCK_CONFIG_IRQ_PRIORITY 6
+#endif
+
+// </e>
+
 // <q> PPI_ENABLED  - nrf_drv_ppi - PPI peripheral driver - legacy layer
  
 
@@ -701,6 +737,70 @@
 #define PPI_ENABLED 1
 #endif
 
+// <e> RTC_ENABLED - nrf_drv_rtc - RTC peripheral driver - legacy layer
+//==========================================================
+#ifndef RTC_ENABLED
+#define RTC_ENABLED 1
+#endif
+// <o> RTC_DEFAULT_CONFIG_FREQUENCY - Frequency  <16-32768> 
+
+
+#ifndef RTC_DEFAULT_CONFIG_FREQUENCY
+#define RTC_DEFAULT_CONFIG_FREQUENCY 32768
+#endif
+
+// <q> RTC_DEFAULT_CONFIG_RELIABLE  - Ensures safe compare event triggering
+ 
+
+#ifndef RTC_DEFAULT_CONFIG_RELIABLE
+#define RTC_DEFAULT_CONFIG_RELIABLE 0
+#endif
+
+// <o> RTC_DEFAULT_CONFIG_IRQ_PRIORITY  - Interrupt priority
+ 
+
+// <i> Priorities 0,2 (nRF51) and 0,1,4,5 (nRF52) are reserved for SoftDevice
+// <0=> 0 (highest) 
+// <1=> 1 
+// <2=> 2 
+// <3=> 3 
+// <4=> 4 
+// <5=> 5 
+// <6=> 6 
+// <7=> 7 
+
+#ifndef RTC_DEFAULT_CONFIG_IRQ_PRIORITY
+#define RTC_DEFAULT_CONFIG_IRQ_PRIORITY 6
+#endif
+
+// <q> RTC0_ENABLED  - Enable RTC0 instance
+ 
+
+#ifndef RTC0_ENABLED
+#define RTC0_ENABLED 0
+#endif
+
+// <q> RTC1_ENABLED  - Enable RTC1 instance
+ 
+
+#ifndef RTC1_ENABLED
+#define RTC1_ENABLED 0
+#endif
+
+// <q> RTC2_ENABLED  - Enable RTC2 instance
+ 
+
+#ifndef RTC2_ENABLED
+#define RTC2_ENABLED 1
+#endif
+
+// <o> NRF_MAXIMUM_LATENCY_US - Maximum possible time[us] in highest priority interrupt 
+#ifndef NRF_MAXIMUM_LATENCY_US
+#define NRF_MAXIMUM_LATENCY_US 2000
+#endif
+
+// </e>
+
 // <e> SAADC_ENABLED - nrf_drv_saadc - SAADC peripheral driver - legacy layer
 //==========================================================
 #ifndef SAADC_ENABLED
@@ -1151,6 +1251,38 @@
 // <h> nRF_Log 
 
 //==========================================================
+// <e> NRF_LOG_BACKEND_BIN_ENABLED - nrf_log_backend_bin - Binary log backend, decoded on the host
+//==========================================================
+#ifndef NRF_LOG_BACKEND_BIN_ENABLED
+#define NRF_LOG_BACKEND_BIN_ENABLED 0
+#endif
+// <q> NRF_LOG_BACKEND_BIN_USE_UART  - Send frames over UART instead of RTT
+ 
+
+// <i> The UART pin and baud rate are taken from the UART backend settings.
+// <i> The UART backend must be disabled when this option is set.
+
+#ifndef NRF_LOG_BACKEND_BIN_USE_UART
+#define NRF_LOG_BACKEND_BIN_USE_UART 0
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_RTT_CHANNEL - RTT up channel used for binary frames 
+#ifndef NRF_LOG_BACKEND_BIN_RTT_CHANNEL
+#define NRF_LOG_BACKEND_BIN_RTT_CHANNEL 1
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE - Size of the RTT up buffer for binary frames 
+#ifndef NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE
+#define NRF_LOG_BACKEND_BIN_RTT_BUFFER_SIZE 512
+#endif
+
+// <o> NRF_LOG_BACKEND_BIN_HEXDUMP_MAX - Longest hexdump sent, in bytes 
+#ifndef NRF_LOG_BACKEND_BIN_HEXDUMP_MAX
+#define NRF_LOG_BACKEND_BIN_HEXDUMP_MAX 64
+#endif
+
+// </e>
+
 // <e> NRF_LOG_BACKEND_RTT_ENABLED - nrf_log_backend_rtt - Log RTT backend
 //==========================================================
 #ifndef NRF_LOG_BACKEND_RTT_ENABLED
@@ -65,36 +65,160 @@
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
+#include "nrf_log_backend_bin.h"
+
+#include "saadc_config.h"
+#include "energy_marker.h"
+
+#ifndef SAADC_BENCHMARK_ENABLED
+#define SAADC_BENCHMARK_ENABLED     0       /**< Set to 1, or build the saadc_bench target, to run the SAADC settings benchmark. */
+#endif
+
+#if SAADC_BENCHMARK_ENABLED
+#include "saadc_bench.h"
+#endif
+
+#define SAADC_STREAMING_ENABLED     0       /**< Set to 1 to stream several inputs at a high rate instead of measuring the battery voltage. */
+
+#if SAADC_STREAMING_ENABLED
+#include "saadc_stream.h"
+
+#define SAADC_SAMPLE_PERIOD_US      500     /**< Scan period (2 kHz scan rate). */
+#define SAADC_STREAM_REPORT_BUFFERS 16      /**< Number of buffers between two summary log lines. */
+#define SAADC_STREAM_BLOCKS         8       /**< Blocks in the sample ring; the SAADC always holds two of them. */
+#define SAADC_STREAM_CONSUMERS      2       /**< Readers of the sample ring. */
+#else
+#include "battery_gauge.h"
+
+#define SAADC_SAMPLE_PERIOD_US      400000  /**< Sample period (400 ms). */
+#endif
+
+#define SAADC_TRIGGER_RTC           (!SAADC_STREAMING_ENABLED)  /**< Trigger sampling from RTC2 (LFCLK) instead of TIMER0 (HFCLK); use for low sample rates. */
+#define SAADC_STREAM_GAPLESS        1       /**< Restart streaming conversions in hardware (SAADC END to START through PPI). */
+
+#if SAADC_TRIGGER_RTC
+#include "nrf_drv_rtc.h"
+#include "nrf_drv_clock.h"
+#endif
 
 #define SAMPLES_IN_BUFFER 5
 volatile uint8_t state = 1;
 
+#if SAADC_TRIGGER_RTC
+static const nrf_drv_rtc_t   m_rtc = NRF_DRV_RTC_INSTANCE(2);
+#else
 static const nrf_drv_timer_t m_timer = NRF_DRV_TIMER_INSTANCE(0);
-static nrf_saadc_value_t     m_buffer_pool[2][SAMPLES_IN_BUFFER];
+#endif
 static nrf_ppi_channel_t     m_ppi_channel;
 static uint32_t              m_adc_evt_counter;
 
+#if SAADC_STREAMING_ENABLED
+static const nrf_saadc_input_t m_stream_inputs[] =
+{
+    NRF_SAADC_INPUT_AIN0,
+    NRF_SAADC_INPUT_AIN1,
+    NRF_SAADC_INPUT_AIN2,
+    NRF_SAADC_INPUT_AIN3,
+};
+
+#define STREAM_CHANNELS (sizeof(m_stream_inputs) / sizeof(m_stream_inputs[0]))
+
+// AIN1 is P0.03, the Grove-Button on Port#4: streaming cannot be combined with the buttons.
+BOARD_PINS_CLAIM(BOARD_AIN_MASK(0) | BOARD_AIN_MASK(1) | BOARD_AIN_MASK(2) | BOARD_AIN_MASK(3),
+                 BOARD_LEDS_PIN_MASK | BOARD_UART_PIN_MASK);
+
+SAMPLE_RING_DEF(m_sample_ring, SAADC_STREAM_BLOCK_SIZE(STREAM_CHANNELS), SAADC_STREAM_BLOCKS, SAADC_STREAM_CONSUMERS);
+
+static uint8_t           m_mean_consumer;                   /**< Ring consumer summing each channel. */
+static uint8_t           m_range_consumer;                  /**< Ring consumer tracking the range of each channel. */
+static int32_t           m_channel_sum[STREAM_CHANNELS];
+static uint32_t          m_channel_sum_blocks;              /**< Blocks added to m_channel_sum. */
+static nrf_saadc_value_t m_channel_min[STREAM_CHANNELS];
+static nrf_saadc_value_t m_channel_max[STREAM_CHANNELS];
+#else
+static nrf_saadc_value_t     m_buffer_pool[2][SAMPLES_IN_BUFFER];
+static battery_gauge_t       m_battery_gauge;
+static volatile bool         m_battery_updated;
+#endif
 
-void timer_handler(nrf_timer_event_t event_type, void * p_context)
+
+#if SAADC_TRIGGER_RTC
+void rtc_handler(nrf_drv_rtc_int_type_t int_type)
 {
 
 }
 
 
+/**@brief Function for triggering the SAADC from RTC2 through PPI.
+ *
+ * @details The RTC compare event triggers the SAMPLE task and, through a PPI fork, clears the
+ *          RTC, so the sampling period is kept in hardware with only the LFCLK running.
+ */
 void saadc_sampling_event_init(void)
 {
     ret_code_t err_code;
 
     err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = nrf_drv_clock_init();
     APP_ERROR_CHECK(err_code);
+    nrf_drv_clock_lfclk_request(NULL);
+
+    nrf_drv_rtc_config_t rtc_cfg = NRF_DRV_RTC_DEFAULT_CONFIG;
+    err_code = nrf_drv_rtc_init(&m_rtc, &rtc_cfg, rtc_handler);
+    APP_ERROR_CHECK(err_code);
+
+    /* the counter runs from 0 to CC inclusive before being cleared */
+    uint32_t ticks = (uint32_t)(((uint64_t)SAADC_SAMPLE_PERIOD_US * RTC_DEFAULT_CONFIG_FREQUENCY
+                                 + 500000) / 1000000);
+    err_code = nrf_drv_rtc_cc_set(&m_rtc, 0, MAX(ticks, 2) - 1, false);
+    APP_ERROR_CHECK(err_code);
+    nrf_drv_rtc_enable(&m_rtc);
+
+    uint32_t rtc_compare_event_addr = nrf_drv_rtc_event_address_get(&m_rtc, NRF_RTC_EVENT_COMPARE_0);
+    uint32_t rtc_clear_task_addr    = nrf_drv_rtc_task_address_get(&m_rtc, NRF_RTC_TASK_CLEAR);
+    uint32_t saadc_sample_task_addr = nrf_drv_saadc_sample_task_get();
+
+    /* setup ppi channel so that rtc compare event is triggering sample task in SAADC */
+    err_code = nrf_drv_ppi_channel_alloc(&m_ppi_channel);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_drv_ppi_channel_assign(m_ppi_channel,
+                                          rtc_compare_event_addr,
+                                          saadc_sample_task_addr);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_drv_ppi_channel_fork_assign(m_ppi_channel, rtc_clear_task_addr);
+    APP_ERROR_CHECK(err_code);
+}
+#else
+void timer_handler(nrf_timer_event_t event_type, void * p_context)
+{
+
+}
+
+
+void saadc_sampling_event_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
 
     nrf_drv_timer_config_t timer_cfg = NRF_DRV_TIMER_DEFAULT_CONFIG;
     timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
     err_code = nrf_drv_timer_init(&m_timer, &timer_cfg, timer_handler);
     APP_ERROR_CHECK(err_code);
 
-    /* setup m_timer for compare event every 400ms */
-    uint32_t ticks = nrf_drv_timer_ms_to_ticks(&m_timer, 400);
+    /* setup m_timer for compare event every SAADC_SAMPLE_PERIOD_US */
+    uint32_t ticks = nrf_drv_timer_us_to_ticks(&m_timer, SAADC_SAMPLE_PERIOD_US);
     nrf_drv_timer_extended_compare(&m_timer,
                                    NRF_TIMER_CC_CHANNEL0,
                                    ticks,
@@ -115,6 +239,7 @@ void saadc_sampling_event_init(void)
                                           saadc_sample_task_addr);
     APP_ERROR_CHECK(err_code);
 }
+#endif // SAADC_TRIGGER_RTC
 
 
 void saadc_sampling_event_enable(void)
@@ -125,27 +250,189 @@ void saadc_sampling_event_enable(void)
 }
 
 
+#if SAADC_STREAMING_ENABLED
+/**@brief Function for adding the blocks not read yet to the per-channel sums.
+ *
+ * @details The samples are summed in place in the ring. A block the SAADC took back while it was
+ *          being summed is left out.
+ */
+static void mean_consume(void)
+{
+    uint16_t const            scans = saadc_stream_scans_per_buffer();
+    nrf_saadc_value_t const * p_block;
+
+    while ((p_block = sample_ring_peek(&m_sample_ring, m_mean_consumer, NULL)) != NULL)
+    {
+        int32_t sum[STREAM_CHANNELS] = {0};
+
+        for (uint16_t scan = 0; scan < scans; scan++)
+        {
+            for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++)
+            {
+                sum[ch] += *p_block++;
+            }
+        }
+
+        if (sample_ring_release(&m_sample_ring, m_mean_consumer))
+        {
+            for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++)
+            {
+                m_channel_sum[ch] += sum[ch];
+            }
+            m_channel_sum_blocks++;
+        }
+        m_adc_evt_counter++;
+    }
+}
+
+
+/**@brief Function for widening the per-channel ranges with the blocks not read yet.
+ *
+ * @details Reads the same blocks as @ref mean_consume, through its own cursor. A block the SAADC
+ *          took back while it was being read is left out.
+ */
+static void range_consume(void)
+{
+    uint16_t const            scans = saadc_stream_scans_per_buffer();
+    nrf_saadc_value_t const * p_block;
+
+    while ((p_block = sample_ring_peek(&m_sample_ring, m_range_consumer, NULL)) != NULL)
+    {
+        nrf_saadc_value_t min[STREAM_CHANNELS];
+        nrf_saadc_value_t max[STREAM_CHANNELS];
+
+        memcpy(min, m_channel_min, sizeof(min));
+        memcpy(max, m_channel_max, sizeof(max));
+
+        for (uint16_t scan = 0; scan < scans; scan++)
+        {
+            for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++, p_block++)
+            {
+                min[ch] = MIN(min[ch], *p_block);
+                max[ch] = MAX(max[ch], *p_block);
+            }
+        }
+
+        if (sample_ring_release(&m_sample_ring, m_range_consumer))
+        {
+            memcpy(m_channel_min, min, sizeof(min));
+            memcpy(m_channel_max, max, sizeof(max));
+        }
+    }
+}
+
+
+static void channel_stats_reset(void)
+{
+    for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++)
+    {
+        m_channel_sum[ch] = 0;
+        m_channel_min[ch] = INT16_MAX;
+        m_channel_max[ch] = INT16_MIN;
+    }
+    m_channel_sum_blocks = 0;
+}
+
+
+/**@brief Function for running the ring consumers.
+ *
+ * @details Logs one summary line every @ref SAADC_STREAM_REPORT_BUFFERS blocks.
+ */
+static void saadc_stream_process(void)
+{
+    uint16_t const scans = saadc_stream_scans_per_buffer();
+
+    mean_consume();
+    range_consume();
+
+    if (m_adc_evt_counter < SAADC_STREAM_REPORT_BUFFERS)
+    {
+        return;
+    }
+
+    NRF_LOG_INFO("Blocks: %d, overruns: %d (mean), %d (range)",
+                 (int)m_sample_ring.head,
+                 (int)sample_ring_overruns_get(&m_sample_ring, m_mean_consumer),
+                 (int)sample_ring_overruns_get(&m_sample_ring, m_range_consumer));
+
+    for (uint8_t ch = 0; ch < STREAM_CHANNELS; ch++)
+    {
+        NRF_LOG_INFO("CH%d mean: %d, range: %d to %d",
+                     ch,
+                     (m_channel_sum_blocks > 0) ? (int)(m_channel_sum[ch] / (int32_t)(scans * m_channel_sum_blocks)) : 0,
+                     (int)m_channel_min[ch],
+                     (int)m_channel_max[ch]);
+    }
+
+    channel_stats_reset();
+    m_adc_evt_counter = 0;
+}
+
+
+void saadc_init(void)
+{
+    saadc_stream_config_t const config =
+    {
+        .p_inputs      = m_stream_inputs,
+        .channel_count = STREAM_CHANNELS,
+        .p_ring        = &m_sample_ring,
+        .handler       = NULL,                  // The SAADC interrupt also wakes up the main loop.
+        .gapless       = SAADC_STREAM_GAPLESS,
+    };
+    ret_code_t err_code;
+
+    channel_stats_reset();
+
+    err_code = sample_ring_consumer_add(&m_sample_ring, &m_mean_consumer);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sample_ring_consumer_add(&m_sample_ring, &m_range_consumer);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = saadc_stream_init(&config);
+    APP_ERROR_CHECK(err_code);
+}
+#else
 void saadc_callback(nrf_drv_saadc_evt_t const * p_event)
 {
     if (p_event->type == NRF_DRV_SAADC_EVT_DONE)
     {
-        ret_code_t err_code;
+        ret_code_t     err_code;
+        energy_phase_t phase = energy_marker_begin(ENERGY_PHASE_SAADC);
 
         err_code = nrf_drv_saadc_buffer_convert(p_event->data.done.p_buffer, SAMPLES_IN_BUFFER);
         APP_ERROR_CHECK(err_code);
 
-        int i;
-        int sum = 0;
-        NRF_LOG_INFO("ADC event number: %d", (int)m_adc_evt_counter);
-
-        for (i = 0; i < SAMPLES_IN_BUFFER; i++)
-        {
-            sum += p_event->data.done.p_buffer[i];
-            NRF_LOG_INFO("%d", p_event->data.done.p_buffer[i]);
-        }
-        /* Print voltage of the battery mounted on Base Dock */
-        NRF_LOG_INFO("Battery Voltage = %d mV", 2*(sum/SAMPLES_IN_BUFFER)*3600/1024);
+        /* Filter the voltage of the battery mounted on Base Dock; it is printed from the main loop */
+        battery_gauge_buffer_add(&m_battery_gauge, p_event->data.done.p_buffer, SAMPLES_IN_BUFFER);
         m_adc_evt_counter++;
+        m_battery_updated = true;
+
+        energy_marker_end(phase);
+    }
+}
+
+
+/**@brief Function for printing the filtered battery voltage after each SAADC event. */
+static void battery_report(void)
+{
+    if (!m_battery_updated)
+    {
+        return;
+    }
+    m_battery_updated = false;
+
+    NRF_LOG_INFO("ADC event number: %d", (int)m_adc_evt_counter);
+
+    if (battery_gauge_is_valid(&m_battery_gauge))
+    {
+        NRF_LOG_INFO("Battery Voltage = %d mV (%d%%)",
+                     battery_gauge_mv_get(&m_battery_gauge),
+                     battery_gauge_level_get(&m_battery_gauge));
+    }
+    else
+    {
+        NRF_LOG_INFO("No plausible battery reading.");
     }
 }
 
@@ -153,13 +440,21 @@ void saadc_callback(nrf_drv_saadc_evt_t const * p_event)
 void saadc_init(void)
 {
     ret_code_t err_code;
-    nrf_saadc_channel_config_t channel_config =
-        NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_AIN2);
+    battery_gauge_config_t const gauge_config = BATTERY_GAUGE_DEFAULT_CONFIG;
 
-    err_code = nrf_drv_saadc_init(NULL, saadc_callback);
-    APP_ERROR_CHECK(err_code);
+    /* average 4 conversions in hardware, back to back on each SAMPLE task */
+    saadc_config_t saadc_config =
+    {
+        .resolution    = NRF_SAADC_RESOLUTION_10BIT,
+        .oversample    = NRF_SAADC_OVERSAMPLE_4X,
+        .channel_count = 1,
+        .channels      = { SAADC_CONFIG_CHANNEL_SE(NRF_SAADC_INPUT_AIN2) },
+    };
+    saadc_config.channels[0].burst = true;
 
-    err_code = nrf_drv_saadc_channel_init(0, &channel_config);
+    battery_gauge_init(&m_battery_gauge, &gauge_config);
+
+    err_code = saadc_config_apply(&saadc_config, saadc_callback);
     APP_ERROR_CHECK(err_code);
 
     err_code = nrf_drv_saadc_buffer_convert(m_buffer_pool[0], SAMPLES_IN_BUFFER);
@@ -169,6 +464,7 @@ void saadc_init(void)
     APP_ERROR_CHECK(err_code);
 
 }
+#endif // SAADC_STREAMING_ENABLED
 
 
 /**
@@ -179,11 +475,26 @@ int main(void)
     uint32_t err_code = NRF_LOG_INIT(NULL);
     APP_ERROR_CHECK(err_code);
 
+#if NRF_MODULE_ENABLED(NRF_LOG_BACKEND_BIN)
+    err_code = nrf_log_backend_bin_init();
+    APP_ERROR_CHECK(err_code);
+#else
     NRF_LOG_DEFAULT_BACKENDS_INIT();
+#endif
 
     ret_code_t ret_code = nrf_pwr_mgmt_init();
     APP_ERROR_CHECK(ret_code);
 
+    energy_marker_init();
+
+#if SAADC_BENCHMARK_ENABLED
+    saadc_bench_run();
+    while (1)
+    {
+        nrf_pwr_mgmt_run();
+    }
+#endif
+
     saadc_init();
     saadc_sampling_event_init();
     saadc_sampling_event_enable();
@@ -191,7 +502,14 @@ int main(void)
 
     while (1)
     {
+        energy_phase_t phase = energy_marker_begin(ENERGY_PHASE_SLEEP);
         nrf_pwr_mgmt_run();
+        energy_marker_end(phase);
+#if SAADC_STREAMING_ENABLED
+        saadc_stream_process();
+#else
+        battery_report();
+#endif
         NRF_LOG_FLUSH();
     }
 }
@@ -0,0 +1,171 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "saadc_bench.h"
+
+#include <math.h>
+#include "nrf.h"
+#include "nordic_common.h"
+#include "app_error.h"
+#include "saadc_config.h"
+
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+#define BENCH_SETTING(_res, _os, _burst, _tacq)                  \
+{                                                                \
+    .resolution    = NRF_SAADC_RESOLUTION_ ## _res,              \
+    .oversample    = NRF_SAADC_OVERSAMPLE_ ## _os,               \
+    .channel_count = 1,                                          \
+    .channels      =                                             \
+    {{                                                           \
+        .input     = SAADC_BENCH_INPUT,                          \
+        .gain      = NRF_SAADC_GAIN1_6,                          \
+        .reference = NRF_SAADC_REFERENCE_INTERNAL,               \
+        .acq_time  = NRF_SAADC_ACQTIME_ ## _tacq,                \
+        .burst     = (_burst),                                   \
+    }},                                                          \
+}
+
+static const saadc_config_t m_settings[] =
+{
+    BENCH_SETTING(10BIT, DISABLED, false, 10US),
+    BENCH_SETTING(12BIT, DISABLED, false, 3US),
+    BENCH_SETTING(12BIT, DISABLED, false, 10US),
+    BENCH_SETTING(12BIT, DISABLED, false, 40US),
+    BENCH_SETTING(12BIT, 4X,       true,  10US),
+    BENCH_SETTING(12BIT, 16X,      true,  10US),
+    BENCH_SETTING(12BIT, 64X,      true,  10US),
+    BENCH_SETTING(12BIT, 256X,     true,  10US),
+    BENCH_SETTING(14BIT, 16X,      true,  10US),
+    BENCH_SETTING(14BIT, 256X,     true,  10US),
+};
+
+static nrf_saadc_value_t m_results[SAADC_BENCH_RESULTS];
+
+
+static void cycle_counter_start(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+/**@brief Function for computing the effective number of bits from the result noise, times 100.
+ *
+ * @details Uses ENOB = N - log2(sigma * sqrt(12)), where sigma is the standard deviation in LSB;
+ *          a noise-free input is reported at the nominal resolution.
+ */
+static uint32_t enob_x100_compute(uint8_t resolution_bits)
+{
+    int64_t sum    = 0;
+    int64_t sum_sq = 0;
+
+    for (uint32_t i = 0; i < SAADC_BENCH_RESULTS; i++)
+    {
+        sum    += m_results[i];
+        sum_sq += (int64_t)m_results[i] * m_results[i];
+    }
+
+    float const mean     = (float)sum / SAADC_BENCH_RESULTS;
+    float const variance = ((float)sum_sq / SAADC_BENCH_RESULTS) - (mean * mean);
+    float const noise    = sqrtf(MAX(variance, 0.0f) * 12.0f);
+    float       enob     = (float)resolution_bits;
+
+    if (noise > 1.0f)
+    {
+        enob -= log2f(noise);
+    }
+
+    return (uint32_t)(enob * 100.0f + 0.5f);
+}
+
+
+/**@brief SAADC event handler of the benchmark, which never gets an event.
+ *
+ * @details The driver requires a handler, but the samples are taken with the blocking
+ *          nrf_drv_saadc_sample_convert, which does not use it.
+ */
+static void saadc_bench_evt_handler(nrf_drv_saadc_evt_t const * p_event)
+{
+    UNUSED_PARAMETER(p_event);
+}
+
+
+static void setting_run(saadc_config_t const * p_setting)
+{
+    ret_code_t err_code;
+    uint32_t   cycles;
+
+    err_code = saadc_config_apply(p_setting, saadc_bench_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    uint32_t const start = DWT->CYCCNT;
+
+    for (uint32_t i = 0; i < SAADC_BENCH_RESULTS; i++)
+    {
+        err_code = nrf_drv_saadc_sample_convert(0, &m_results[i]);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    cycles = DWT->CYCCNT - start;
+    nrf_drv_saadc_uninit();
+
+    uint32_t const us_per_result = cycles / (SystemCoreClock / 1000000UL) / SAADC_BENCH_RESULTS;
+    uint32_t const nc_per_result = (us_per_result * SAADC_BENCH_ACTIVE_CURRENT_UA) / 1000UL;
+
+    NRF_LOG_RAW_INFO("%d,%d,%d,%d,%d,",
+                     saadc_config_resolution_bits(p_setting),
+                     saadc_config_oversample_factor(p_setting),
+                     p_setting->channels[0].burst,
+                     saadc_config_acq_time_us(p_setting, 0),
+                     p_setting->channels[0].gain);
+    NRF_LOG_RAW_INFO("%d,%d,%d\r\n",
+                     enob_x100_compute(saadc_config_resolution_bits(p_setting)),
+                     us_per_result,
+                     nc_per_result);
+    NRF_LOG_FLUSH();
+}
+
+
+void saadc_bench_run(void)
+{
+    cycle_counter_start();
+
+    NRF_LOG_RAW_INFO("res,oversample,burst,tacq_us,gain,enob_x100,us_per_result,nc_per_result\r\n");
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_settings); i++)
+    {
+        setting_run(&m_settings[i]);
+    }
+
+    NRF_LOG_RAW_INFO("done\r\n");
+    NRF_LOG_FLUSH();
+}
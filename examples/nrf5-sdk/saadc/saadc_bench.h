@@ -0,0 +1,72 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup saadc_bench SAADC settings benchmark
+ * @{
+ * @ingroup nrf_adc_example
+ * @brief Effective resolution against SAADC active time for a table of settings.
+ *
+ * @details For each setting, @ref SAADC_BENCH_RESULTS results of a steady input are converted in
+ *          blocking mode. The noise of the results gives the effective number of bits, the DWT
+ *          cycle counter gives the time spent per result, and the charge per result is estimated
+ *          from @ref SAADC_BENCH_ACTIVE_CURRENT_UA. One table row is logged per setting:
+ *
+ *          res,oversample,burst,tacq_us,gain,enob_x100,us_per_result,nc_per_result
+ */
+#ifndef SAADC_BENCH_H__
+#define SAADC_BENCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SAADC_BENCH_INPUT
+#define SAADC_BENCH_INPUT               NRF_SAADC_INPUT_AIN2    /**< Input measured by the benchmark; should carry a steady voltage. */
+#endif
+
+#ifndef SAADC_BENCH_RESULTS
+#define SAADC_BENCH_RESULTS             256                     /**< Results converted per setting. */
+#endif
+
+#ifndef SAADC_BENCH_ACTIVE_CURRENT_UA
+#define SAADC_BENCH_ACTIVE_CURRENT_UA   700                     /**< SAADC current while converting, in uA. Replace with a value measured on the board. */
+#endif
+
+/**@brief Function for running the benchmark over every setting and logging the results. */
+void saadc_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAADC_BENCH_H__
+
+/** @} */
@@ -0,0 +1,124 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "saadc_config.h"
+
+#include <stddef.h>
+#include "nordic_common.h"
+
+#define SAADC_CONVERSION_TIME_US    2   /**< Conversion time following the acquisition time (tCONV). */
+
+
+ret_code_t saadc_config_apply(saadc_config_t const * p_config, nrf_drv_saadc_event_handler_t handler)
+{
+    ret_code_t err_code;
+
+    if ((p_config == NULL) ||
+        (p_config->channel_count == 0) ||
+        (p_config->channel_count > NRF_SAADC_CHANNEL_COUNT))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if ((p_config->oversample != NRF_SAADC_OVERSAMPLE_DISABLED) && (p_config->channel_count > 1))
+    {
+        for (uint8_t i = 0; i < p_config->channel_count; i++)
+        {
+            if (!p_config->channels[i].burst)
+            {
+                return NRF_ERROR_INVALID_PARAM;
+            }
+        }
+    }
+
+    nrf_drv_saadc_config_t const drv_config =
+    {
+        .resolution         = p_config->resolution,
+        .oversample         = p_config->oversample,
+        .interrupt_priority = SAADC_CONFIG_IRQ_PRIORITY,
+        .low_power_mode     = SAADC_CONFIG_LP_MODE,
+    };
+
+    err_code = nrf_drv_saadc_init(&drv_config, handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    for (uint8_t i = 0; i < p_config->channel_count; i++)
+    {
+        saadc_config_channel_t const * p_channel = &p_config->channels[i];
+        nrf_saadc_channel_config_t     channel_config =
+            NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(p_channel->input);
+
+        channel_config.gain      = p_channel->gain;
+        channel_config.reference = p_channel->reference;
+        channel_config.acq_time  = p_channel->acq_time;
+        channel_config.burst     = p_channel->burst ? NRF_SAADC_BURST_ENABLED
+                                                    : NRF_SAADC_BURST_DISABLED;
+
+        err_code = nrf_drv_saadc_channel_init(i, &channel_config);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint8_t saadc_config_resolution_bits(saadc_config_t const * p_config)
+{
+    return 8 + 2 * (uint8_t)p_config->resolution;
+}
+
+
+uint16_t saadc_config_oversample_factor(saadc_config_t const * p_config)
+{
+    return (uint16_t)(1UL << (uint8_t)p_config->oversample);
+}
+
+
+uint8_t saadc_config_acq_time_us(saadc_config_t const * p_config, uint8_t channel)
+{
+    static const uint8_t m_acq_time_us[] = {3, 5, 10, 15, 20, 40};
+    nrf_saadc_acqtime_t const acq_time   = p_config->channels[channel].acq_time;
+
+    return (acq_time < ARRAY_SIZE(m_acq_time_us)) ? m_acq_time_us[acq_time] : 40;
+}
+
+
+uint32_t saadc_config_result_time_us(saadc_config_t const * p_config, uint8_t channel)
+{
+    uint32_t const per_conversion = saadc_config_acq_time_us(p_config, channel)
+                                    + SAADC_CONVERSION_TIME_US;
+
+    return per_conversion * saadc_config_oversample_factor(p_config);
+}
@@ -0,0 +1,122 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup saadc_config SAADC configuration
+ * @{
+ * @ingroup nrf_adc_example
+ * @brief Resolution, hardware averaging and per-channel analog settings for the SAADC.
+ *
+ * @details Groups the settings that @ref nrf_drv_saadc_init and @ref nrf_drv_saadc_channel_init
+ *          otherwise take from sdk_config.h and NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE. With
+ *          OVERSAMPLE set, the SAADC averages 2^n conversions into one result in hardware; with
+ *          BURST set on a channel, a single SAMPLE task runs all of them back to back, so the CPU
+ *          is only woken once per averaged result.
+ */
+#ifndef SAADC_CONFIG_H__
+#define SAADC_CONFIG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_drv_saadc.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Single-ended channel on @p _input with the settings of
+ *        NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE.
+ */
+#define SAADC_CONFIG_CHANNEL_SE(_input)                 \
+{                                                       \
+    .input     = (_input),                              \
+    .gain      = NRF_SAADC_GAIN1_6,                     \
+    .reference = NRF_SAADC_REFERENCE_INTERNAL,          \
+    .acq_time  = NRF_SAADC_ACQTIME_10US,                \
+    .burst     = false,                                 \
+}
+
+/**@brief Per-channel settings. */
+typedef struct
+{
+    nrf_saadc_input_t     input;     /**< Positive input; the channel is single ended. */
+    nrf_saadc_gain_t      gain;      /**< Input gain. */
+    nrf_saadc_reference_t reference; /**< Reference voltage. */
+    nrf_saadc_acqtime_t   acq_time;  /**< Acquisition time. */
+    bool                  burst;     /**< Run all oversampled conversions on one SAMPLE task. */
+} saadc_config_channel_t;
+
+/**@brief SAADC settings. */
+typedef struct
+{
+    nrf_saadc_resolution_t resolution;                        /**< Result resolution. */
+    nrf_saadc_oversample_t oversample;                        /**< Number of conversions averaged per result. */
+    uint8_t                channel_count;                     /**< Number of entries used in channels. */
+    saadc_config_channel_t channels[NRF_SAADC_CHANNEL_COUNT]; /**< Channel settings, in channel order. */
+} saadc_config_t;
+
+/**@brief Function for initializing the SAADC driver and its channels from a configuration.
+ *
+ * @details The SAADC applies oversampling to every sample, not per channel. When more than one
+ *          channel is used, oversampling therefore requires burst mode on every channel, or
+ *          results from different inputs would be averaged together.
+ *
+ * @param[in] p_config  SAADC settings.
+ * @param[in] handler   SAADC event handler. The driver requires one even if only the blocking
+ *                      nrf_drv_saadc_sample_convert is used.
+ *
+ * @retval NRF_SUCCESS              If the SAADC was initialized.
+ * @retval NRF_ERROR_INVALID_PARAM  If the configuration is not supported by the SAADC.
+ * @return Other error codes returned by the SAADC driver.
+ */
+ret_code_t saadc_config_apply(saadc_config_t const * p_config, nrf_drv_saadc_event_handler_t handler);
+
+/**@brief Function for getting the resolution of a result, in bits. */
+uint8_t saadc_config_resolution_bits(saadc_config_t const * p_config);
+
+/**@brief Function for getting the number of conversions averaged into one result. */
+uint16_t saadc_config_oversample_factor(saadc_config_t const * p_config);
+
+/**@brief Function for getting the acquisition time of a channel, in microseconds. */
+uint8_t saadc_config_acq_time_us(saadc_config_t const * p_config, uint8_t channel);
+
+/**@brief Function for estimating the time the SAADC is converting for one result of a channel,
+ *        in microseconds.
+ */
+uint32_t saadc_config_result_time_us(saadc_config_t const * p_config, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAADC_CONFIG_H__
+
+/** @} */
@@ -0,0 +1,222 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+#include "saadc_stream.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "nrf.h"
+#include "nrf_drv_ppi.h"
+#include "app_error.h"
+#include "nrf_assert.h"
+
+#define DRIVER_BLOCKS   2                   /**< The SAADC holds a current and a next buffer. */
+
+static sample_ring_t        * m_p_ring;
+static uint16_t               m_buffer_size;      /**< Samples per block, scans times channel count. */
+static saadc_stream_handler_t m_handler;
+static bool                   m_gapless;
+static nrf_ppi_channel_t      m_restart_ppi;      /**< Gapless mode: SAADC END to SAADC START. */
+
+
+static nrf_saadc_value_t * block_get(uint32_t ahead)
+{
+    return (nrf_saadc_value_t *)sample_ring_write_get(m_p_ring, ahead);
+}
+
+
+/**@brief Function for publishing the block the SAADC has just filled.
+ *
+ * @details Once published, the block after the next one belongs to the SAADC again.
+ */
+static void block_publish(void)
+{
+    uint32_t seq = m_p_ring->head;
+
+    sample_ring_publish(m_p_ring);
+
+    if (m_handler != NULL)
+    {
+        m_handler(seq);
+    }
+}
+
+
+/**@brief Function for latching the buffer used by the next START task.
+ *
+ * @details RESULT.PTR is double buffered: it can be written again as soon as the STARTED event
+ *          of the current buffer has been generated.
+ */
+static void next_buffer_latch(nrf_saadc_value_t * p_buffer)
+{
+    while (!nrf_saadc_event_check(NRF_SAADC_EVENT_STARTED))
+    {
+        // The START task was triggered by PPI on END; STARTED follows immediately.
+    }
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_STARTED);
+
+    nrf_saadc_buffer_init(p_buffer, m_buffer_size);
+}
+
+
+/**@brief Function for handling an END event in gapless mode.
+ *
+ * @details The next conversion has already been started by PPI into the next block, so this only
+ *          has to latch a new next block before the current one fills up.
+ */
+static void gapless_end_handle(void)
+{
+    block_publish();
+    next_buffer_latch(block_get(1));
+}
+
+
+static ret_code_t gapless_start(void)
+{
+    ret_code_t err_code;
+
+    nrf_saadc_buffer_init(block_get(0), m_buffer_size);
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_STARTED);
+    nrf_saadc_task_trigger(NRF_SAADC_TASK_START);
+
+    next_buffer_latch(block_get(1));
+
+    err_code = nrf_drv_ppi_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED))
+    {
+        return err_code;
+    }
+
+    err_code = nrf_drv_ppi_channel_alloc(&m_restart_ppi);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = nrf_drv_ppi_channel_assign(m_restart_ppi,
+                                          nrf_saadc_event_address_get(NRF_SAADC_EVENT_END),
+                                          nrf_saadc_task_address_get(NRF_SAADC_TASK_START));
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return nrf_drv_ppi_channel_enable(m_restart_ppi);
+}
+
+
+static void saadc_stream_callback(nrf_drv_saadc_evt_t const * p_event)
+{
+    ret_code_t err_code;
+
+    if (p_event->type != NRF_DRV_SAADC_EVT_DONE)
+    {
+        return;
+    }
+
+    if (m_gapless)
+    {
+        // The driver holds no buffers in this mode; the event only signals END.
+        gapless_end_handle();
+        return;
+    }
+
+    // The driver has already moved on to the next block.
+    ASSERT(p_event->data.done.p_buffer == block_get(0));
+    block_publish();
+
+    err_code = nrf_drv_saadc_buffer_convert(block_get(1), m_buffer_size);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+ret_code_t saadc_stream_init(saadc_stream_config_t const * p_config)
+{
+    ret_code_t err_code;
+
+    if ((p_config == NULL)                                                      ||
+        (p_config->p_ring == NULL)                                              ||
+        (p_config->channel_count == 0)                                          ||
+        (p_config->channel_count > SAADC_STREAM_MAX_CHANNELS)                   ||
+        (p_config->p_ring->block_size < SAADC_STREAM_BLOCK_SIZE(p_config->channel_count)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = sample_ring_reserve_set(p_config->p_ring, DRIVER_BLOCKS);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_p_ring      = p_config->p_ring;
+    m_handler     = p_config->handler;
+    m_buffer_size = SAADC_STREAM_SCANS_PER_BUFFER * p_config->channel_count;
+    m_gapless     = p_config->gapless;
+
+    err_code = nrf_drv_saadc_init(NULL, saadc_stream_callback);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    for (uint8_t i = 0; i < p_config->channel_count; i++)
+    {
+        nrf_saadc_channel_config_t channel_config =
+            NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(p_config->p_inputs[i]);
+
+        err_code = nrf_drv_saadc_channel_init(i, &channel_config);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    if (m_gapless)
+    {
+        return gapless_start();
+    }
+
+    for (uint32_t i = 0; i < DRIVER_BLOCKS; i++)
+    {
+        err_code = nrf_drv_saadc_buffer_convert(block_get(i), m_buffer_size);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint16_t saadc_stream_scans_per_buffer(void)
+{
+    return SAADC_STREAM_SCANS_PER_BUFFER;
+}
@@ -0,0 +1,118 @@
+/**
+* Copyright (c) 2018 makerdiary
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* * Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+*   copyright notice, this list of conditions and the following
+*   disclaimer in the documentation and/or other materials provided
+*   with the distribution.
+
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+/** @file
+ *
+ * @defgroup saadc_stream SAADC streaming
+ * @{
+ * @ingroup nrf_adc_example
+ * @brief Multi-channel SAADC streaming into a @ref sample_ring.
+ *
+ * @details The SAADC is configured in scan mode over up to @ref SAADC_STREAM_MAX_CHANNELS
+ *          inputs. EasyDMA writes the results straight into the blocks of the ring. The
+ *          driver always holds the two blocks after the last published one, the current and the next
+ *          buffer. Each full block is published to the consumers of the ring, which read it in place.
+ *          The SAADC never waits for them: a consumer that falls behind loses the oldest blocks,
+ *          and the ring counts them as overruns for that consumer.
+ *
+ *          Samples in a block are interleaved in channel order, that is
+ *          p_block[scan * channel_count + channel].
+ */
+#ifndef SAADC_STREAM_H__
+#define SAADC_STREAM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_drv_saadc.h"
+#include "sample_ring.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAADC_STREAM_MAX_CHANNELS       NRF_SAADC_CHANNEL_COUNT     /**< Maximum number of scanned inputs. */
+
+#ifndef SAADC_STREAM_SCANS_PER_BUFFER
+#define SAADC_STREAM_SCANS_PER_BUFFER   128                         /**< Number of scans (one sample per channel) held by each buffer. */
+#endif
+
+/**@brief Size of a ring block for a given number of channels, in bytes. */
+#define SAADC_STREAM_BLOCK_SIZE(_channel_count) \
+    (SAADC_STREAM_SCANS_PER_BUFFER * (_channel_count) * sizeof(nrf_saadc_value_t))
+
+/**@brief Block-published handler.
+ *
+ * @details Called in SAADC interrupt context, after a block was published to the ring, for
+ *          example to wake up the consumers.
+ *
+ * @param[in] seq  Sequence number of the block.
+ */
+typedef void (*saadc_stream_handler_t)(uint32_t seq);
+
+/**@brief Streaming configuration. */
+typedef struct
+{
+    nrf_saadc_input_t const * p_inputs;      /**< Inputs to scan, in channel order. */
+    uint8_t                   channel_count; /**< Number of entries in p_inputs (1 to @ref SAADC_STREAM_MAX_CHANNELS). */
+    sample_ring_t           * p_ring;        /**< Ring the samples are written into, with blocks of at least @ref SAADC_STREAM_BLOCK_SIZE. */
+    saadc_stream_handler_t    handler;       /**< Block-published handler. Can be NULL. */
+    bool                      gapless;       /**< Restart conversion in hardware, see @ref saadc_stream_init. */
+} saadc_stream_config_t;
+
+/**@brief Function for initializing the SAADC in scan mode and queuing the first two buffers.
+ *
+ * @details Sampling is triggered externally, for example by a TIMER or RTC compare event
+ *          connected through PPI to @ref nrf_drv_saadc_sample_task_get.
+ *
+ *          In gapless mode, a PPI channel connects the SAADC END event to its START task, so the
+ *          next buffer is started in hardware with no window in which SAMPLE tasks are lost.
+ *          The CPU only has to latch a new next buffer once per full buffer. The SAADC driver
+ *          then only serves as the interrupt dispatcher; @ref nrf_drv_saadc_buffer_convert and
+ *          @ref nrf_drv_saadc_sample must not be used while streaming.
+ *
+ * @param[in] p_config  Streaming configuration.
+ *
+ * @retval NRF_SUCCESS              If the SAADC was initialized.
+ * @retval NRF_ERROR_INVALID_PARAM  If the channel count is invalid, or the ring blocks are too
+ *                                  small or fewer than three.
+ * @return Other error codes returned by the SAADC driver.
+ */
+ret_code_t saadc_stream_init(saadc_stream_config_t const * p_config);
+
+/**@brief Function for getting the number of scans held by each block. */
+uint16_t saadc_stream_scans_per_buffer(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAADC_STREAM_H__
+
+/** @} */
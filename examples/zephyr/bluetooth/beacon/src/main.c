@@ -14,6 +14,26 @@
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/hci.h>
 
+#if defined(RTOS_BENCH)
+#include <zephyr.h>
+#include <board.h>
+#include <gpio.h>
+
+#ifndef LED0_GPIO_CONTROLLER
+#define LED0_GPIO_CONTROLLER LED0_GPIO_PORT
+#endif
+
+/* The nRF52832 has one GPIO port, the one the LEDs are on */
+#define BENCH_GPIO_PORT LED0_GPIO_CONTROLLER
+
+#define BENCH_REPORT(key, value) printk("BENCH " key " %u\n", (value))
+#include "rtos_bench.h"
+
+static K_SEM_DEFINE(bench_adv_sem, 0, 1);
+static K_SEM_DEFINE(bench_wake_sem, 0, 1);
+static struct gpio_callback bench_cb;
+#endif
+
 #define DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
 
@@ -58,12 +78,58 @@ static void bt_ready(int err)
 	}
 
 	printk("Beacon started\n");
+
+#if defined(RTOS_BENCH)
+	bench_adv_started();
+	k_sem_give(&bench_adv_sem);
+#endif
 }
 
+#if defined(RTOS_BENCH)
+static void bench_pin_handler(struct device *port, struct gpio_callback *cb,
+			      u32_t pins)
+{
+	bench_isr();
+	k_sem_give(&bench_wake_sem);
+}
+
+/* The latency test of tools/rtos_bench, run by the main thread */
+static void bench_run(void)
+{
+	struct device *port = device_get_binding(BENCH_GPIO_PORT);
+
+	gpio_pin_configure(port, BENCH_STIM_IN_PIN, GPIO_DIR_IN | GPIO_INT |
+			   GPIO_INT_EDGE | GPIO_INT_ACTIVE_HIGH |
+			   GPIO_PUD_PULL_DOWN);
+	gpio_init_callback(&bench_cb, bench_pin_handler,
+			   BIT(BENCH_STIM_IN_PIN));
+	gpio_add_callback(port, &bench_cb);
+	gpio_pin_enable_callback(port, BENCH_STIM_IN_PIN);
+
+	k_sem_take(&bench_adv_sem, K_FOREVER);
+
+	do {
+		k_sleep(BENCH_GAP_MS);
+		bench_stimulus();
+		k_sem_take(&bench_wake_sem, K_FOREVER);
+	} while (!bench_thread());
+
+	gpio_pin_disable_callback(port, BENCH_STIM_IN_PIN);
+	bench_report();
+
+	/* Idle phase: nothing left running. */
+	bt_le_adv_stop();
+}
+#endif
+
 void main(void)
 {
 	int err;
 
+#if defined(RTOS_BENCH)
+	bench_main_entry();
+#endif
+
 	printk("Starting Beacon Demo\n");
 
 	/* Initialize the Bluetooth Subsystem */
@@ -71,4 +137,8 @@ void main(void)
 	if (err) {
 		printk("Bluetooth init failed (err %d)\n", err);
 	}
+
+#if defined(RTOS_BENCH)
+	bench_run();
+#endif
 }
@@ -0,0 +1,287 @@
+/** @file
+ *  @brief Eddystone-EID ephemeral identifier generation
+ */
+
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <misc/byteorder.h>
+#include <zephyr.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/crypto.h>
+
+#include <mbedtls/ecdh.h>
+#include <mbedtls/md.h>
+#include <mbedtls/aes.h>
+
+#include "eid.h"
+
+static eid_update_t eid_update;
+
+static u8_t identity_key[EID_KEY_LEN];
+static u8_t rotation_exp;
+static s64_t clock_base;
+static bool registered;
+
+/* EID being advertised, and the one for the next epoch, computed as
+ * soon as the previous rotation is done
+ */
+static u8_t eid_now[EID_LEN];
+static u8_t eid_next[EID_LEN];
+static u32_t next_epoch;
+
+static struct k_delayed_work rotate_work;
+
+static int eid_compute(u32_t clock, u8_t eid[EID_LEN])
+{
+	u8_t block[16] = {};
+	u8_t temp_key[16];
+	u8_t out[16];
+	int err;
+
+	/*
+	 * AES runs in the controller, which uses the ECB peripheral, so
+	 * the CPU only waits for two blocks of hardware encryption.
+	 */
+
+	/* Temporary key: AES(identity key, 0^11 | 0xff | 0^2 | clock[31:16]) */
+	block[11] = 0xff;
+	sys_put_be16(clock >> 16, &block[14]);
+	err = bt_encrypt_be(identity_key, block, temp_key);
+	if (err) {
+		return err;
+	}
+
+	/* EID: AES(temporary key, 0^11 | K | clock with bits K-1..0 clear) */
+	memset(block, 0, sizeof(block));
+	block[11] = rotation_exp;
+	sys_put_be32(clock & ~(BIT(rotation_exp) - 1), &block[12]);
+	err = bt_encrypt_be(temp_key, block, out);
+	if (err) {
+		return err;
+	}
+
+	memcpy(eid, out, EID_LEN);
+
+	return 0;
+}
+
+u32_t eid_clock(void)
+{
+	return (k_uptime_get() - clock_base) / MSEC_PER_SEC;
+}
+
+static void eid_schedule(void)
+{
+	s64_t due = clock_base + (s64_t)next_epoch * MSEC_PER_SEC;
+	s64_t delay = due - k_uptime_get();
+
+	k_delayed_work_submit(&rotate_work, max(delay, 0));
+}
+
+static void eid_rotate(struct k_work *work)
+{
+	if (!registered) {
+		return;
+	}
+
+	/* The advertising path only swaps in the precomputed value. */
+	memcpy(eid_now, eid_next, EID_LEN);
+	eid_update(eid_now);
+
+	next_epoch += BIT(rotation_exp);
+	if (eid_compute(next_epoch, eid_next)) {
+		printk("EID precompute failed\n");
+	}
+
+	eid_schedule();
+}
+
+static int eid_start(u8_t exponent)
+{
+	u32_t clock;
+	int err;
+
+	if (exponent > EID_EXPONENT_MAX) {
+		return -EINVAL;
+	}
+
+	k_delayed_work_cancel(&rotate_work);
+
+	rotation_exp = exponent;
+	clock_base = k_uptime_get();
+	clock = 0;
+
+	err = eid_compute(clock, eid_now);
+	if (err) {
+		return err;
+	}
+
+	next_epoch = BIT(rotation_exp);
+	err = eid_compute(next_epoch, eid_next);
+	if (err) {
+		return err;
+	}
+
+	registered = true;
+	eid_update(eid_now);
+	eid_schedule();
+
+	return 0;
+}
+
+static int eid_rng(void *ctx, unsigned char *buf, size_t len)
+{
+	return bt_rand(buf, len) ? MBEDTLS_ERR_ECP_RANDOM_FAILED : 0;
+}
+
+/* Curve25519 keys are little-endian, mbedTLS numbers big-endian. */
+static int mpi_read_le(mbedtls_mpi *x, const u8_t *buf, size_t len)
+{
+	u8_t be[EID_ECDH_KEY_LEN];
+
+	sys_memcpy_swap(be, buf, len);
+
+	return mbedtls_mpi_read_binary(x, be, len);
+}
+
+static int mpi_write_le(const mbedtls_mpi *x, u8_t *buf, size_t len)
+{
+	u8_t be[EID_ECDH_KEY_LEN];
+	int err;
+
+	err = mbedtls_mpi_write_binary(x, be, len);
+	if (!err) {
+		sys_memcpy_swap(buf, be, len);
+	}
+
+	return err;
+}
+
+int eid_register_ecdh(const u8_t service_pub[EID_ECDH_KEY_LEN],
+		      u8_t exponent, u8_t beacon_pub[EID_ECDH_KEY_LEN])
+{
+	const mbedtls_md_info_t *sha256;
+	u8_t shared[EID_ECDH_KEY_LEN];
+	u8_t salt[2 * EID_ECDH_KEY_LEN];
+	u8_t prk[32];
+	u8_t okm[32];
+	const u8_t one = 0x01;
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_point q, qp;
+	mbedtls_mpi d, z;
+	int err;
+
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_ecp_point_init(&q);
+	mbedtls_ecp_point_init(&qp);
+	mbedtls_mpi_init(&d);
+	mbedtls_mpi_init(&z);
+
+	/*
+	 * The key exchange happens once per registration, so it is done
+	 * in software; only the per-epoch AES is performance sensitive.
+	 */
+	err = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_CURVE25519);
+	err = err ? err : mbedtls_ecdh_gen_public(&grp, &d, &q, eid_rng, NULL);
+	err = err ? err : mpi_read_le(&qp.X, service_pub, EID_ECDH_KEY_LEN);
+	err = err ? err : mbedtls_mpi_lset(&qp.Z, 1);
+	err = err ? err : mbedtls_ecdh_compute_shared(&grp, &z, &qp, &d,
+						      eid_rng, NULL);
+	err = err ? err : mpi_write_le(&z, shared, sizeof(shared));
+	err = err ? err : mpi_write_le(&q.X, beacon_pub, EID_ECDH_KEY_LEN);
+	if (err) {
+		goto out;
+	}
+
+	/* Identity key: HKDF-SHA256(salt = service_pub | beacon_pub,
+	 * input = shared secret, info = empty), first 16 bytes.
+	 */
+	memcpy(salt, service_pub, EID_ECDH_KEY_LEN);
+	memcpy(&salt[EID_ECDH_KEY_LEN], beacon_pub, EID_ECDH_KEY_LEN);
+
+	sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+	err = mbedtls_md_hmac(sha256, salt, sizeof(salt), shared,
+			      sizeof(shared), prk);
+	err = err ? err : mbedtls_md_hmac(sha256, prk, sizeof(prk), &one,
+					  sizeof(one), okm);
+	if (err) {
+		goto out;
+	}
+
+	memcpy(identity_key, okm, EID_KEY_LEN);
+	err = eid_start(exponent);
+
+out:
+	mbedtls_mpi_free(&z);
+	mbedtls_mpi_free(&d);
+	mbedtls_ecp_point_free(&qp);
+	mbedtls_ecp_point_free(&q);
+	mbedtls_ecp_group_free(&grp);
+
+	/* Do not leave key material behind on the stack. */
+	memset(shared, 0, sizeof(shared));
+	memset(prk, 0, sizeof(prk));
+
+	return err ? -EIO : 0;
+}
+
+int eid_register_key(const u8_t key_enc[EID_KEY_LEN],
+		     const u8_t lock[EID_KEY_LEN], u8_t exponent)
+{
+	mbedtls_aes_context aes;
+	int err;
+
+	/* The ECB peripheral only encrypts; decrypting once is cheap. */
+	mbedtls_aes_init(&aes);
+	err = mbedtls_aes_setkey_dec(&aes, lock, 128);
+	err = err ? err : mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_DECRYPT,
+						key_enc, identity_key);
+	mbedtls_aes_free(&aes);
+	if (err) {
+		return -EIO;
+	}
+
+	return eid_start(exponent);
+}
+
+void eid_stop(void)
+{
+	registered = false;
+	k_delayed_work_cancel(&rotate_work);
+}
+
+int eid_identity_key_get(const u8_t lock[EID_KEY_LEN],
+			 u8_t key_enc[EID_KEY_LEN])
+{
+	if (!registered) {
+		return -ENOENT;
+	}
+
+	return bt_encrypt_be(lock, identity_key, key_enc);
+}
+
+u8_t eid_exponent(void)
+{
+	return rotation_exp;
+}
+
+void eid_current(u8_t eid[EID_LEN])
+{
+	memcpy(eid, eid_now, EID_LEN);
+}
+
+void eid_init(eid_update_t update)
+{
+	eid_update = update;
+	k_delayed_work_init(&rotate_work, eid_rotate);
+}
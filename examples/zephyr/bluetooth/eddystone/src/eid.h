@@ -0,0 +1,62 @@
+/** @file
+ *  @brief Eddystone-EID ephemeral identifier generation
+ */
+
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EID_H__
+#define EID_H__
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EID_KEY_LEN 16
+#define EID_ECDH_KEY_LEN 32
+#define EID_LEN 8
+
+/* Largest rotation period exponent: 2^15 s, about 9 hours */
+#define EID_EXPONENT_MAX 15
+
+/* Called from the system work queue with the EID of the new epoch. */
+typedef void (*eid_update_t)(const u8_t eid[EID_LEN]);
+
+void eid_init(eid_update_t update);
+
+/* Register with a resolver by key exchange: derive the identity key
+ * from the resolver's Curve25519 @p service_pub, and return the public
+ * key of the beacon in @p beacon_pub.
+ */
+int eid_register_ecdh(const u8_t service_pub[EID_ECDH_KEY_LEN],
+		      u8_t exponent, u8_t beacon_pub[EID_ECDH_KEY_LEN]);
+
+/* Register with an identity key encrypted with the lock code. */
+int eid_register_key(const u8_t key_enc[EID_KEY_LEN],
+		     const u8_t lock[EID_KEY_LEN], u8_t exponent);
+
+/* Stop rotating; the EID slot has been cleared or reconfigured. */
+void eid_stop(void);
+
+/* Return the identity key encrypted with the lock code. */
+int eid_identity_key_get(const u8_t lock[EID_KEY_LEN],
+			 u8_t key_enc[EID_KEY_LEN]);
+
+/* Beacon time counter, in seconds since registration. */
+u32_t eid_clock(void);
+
+u8_t eid_exponent(void);
+
+/* Copy the EID currently advertised. */
+void eid_current(u8_t eid[EID_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EID_H__ */
@@ -21,15 +21,60 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 
-#define NUMBER_OF_SLOTS 1
+#include "eid.h"
+
+#define NUMBER_OF_SLOTS 4
 #define EDS_VERSION 0x00
 #define EDS_URL_READ_OFFSET 2
-#define EDS_URL_WRITE_OFFSET 4
 #define EDS_IDLE_TIMEOUT K_SECONDS(30)
 
+/* Longest ADV Slot Data write: 34 bytes (EID with a public ECDH key) */
+#define EDS_SLOT_DATA_MAX 34
+/* Longest URL write: frame type, URL scheme and 17 bytes of URL */
+#define EDS_URL_WRITE_MAX 19
+/* UID write: frame type, 10-byte namespace and 6-byte instance */
+#define EDS_UID_WRITE_LEN 17
+/* TLM write: the frame type alone */
+#define EDS_TLM_WRITE_LEN 1
+/* Eddystone UUID, frame type and Tx power, then the frame data; the UID
+ * frame is the longest with its two reserved bytes
+ */
+#define EDS_FRAME_MAX (2 + 1 + 1 + 16 + 2)
+/* EID writes: frame type, resolver public key and rotation exponent,
+ * or frame type, encrypted identity key and rotation exponent
+ */
+#define EDS_EID_ECDH_WRITE_LEN (1 + EID_ECDH_KEY_LEN + 1)
+#define EDS_EID_KEY_WRITE_LEN (1 + EID_KEY_LEN + 1)
+/* Eddystone UUID, frame type, Tx power and EID */
+#define EDS_EID_FRAME_LEN (2 + 1 + 1 + EID_LEN)
+/* Eddystone UUID and the unencrypted TLM frame */
+#define EDS_TLM_FRAME_LEN (2 + 1 + 1 + 2 + 2 + 4 + 4)
+
+/* Slots take turns on the radio: each due slot advertises for one burst
+ * that is long enough for a single advertising event.
+ */
+#define EDS_SCHED_ADV_INT BT_GAP_ADV_FAST_INT_MIN_1
+#define EDS_SCHED_BURST_MS 40
+/* Shortest slot interval accepted, in ms */
+#define EDS_SCHED_INTERVAL_MIN 100
+/* Slot interval until a client writes one, in ms like the characteristic */
+#define EDS_SCHED_INTERVAL_DEFAULT 100
+/* Period of the per-slot airtime report */
+#define EDS_SCHED_REPORT_MS K_SECONDS(60)
+
 /* Idle timer */
 struct k_delayed_work idle_work;
 
+/* Applies staged ADV Slot Data once a (long) write has completed */
+static struct k_work commit_work;
+static u8_t eds_commit_slot;
+
+/* Slot scheduler */
+static struct k_delayed_work sched_work;
+static int sched_current = -1;
+static s64_t sched_report_time;
+static u32_t eds_adv_count;
+
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
 	/* Eddystone Service UUID a3c87500-8ed3-4bdf-8a39-a01bebede295 */
@@ -131,7 +176,7 @@ struct eds_capabilities {
 static struct eds_capabilities eds_caps = {
 	.version = EDS_VERSION,
 	.slots = NUMBER_OF_SLOTS,
-	.slot_types = EDS_SLOT_URL, /* TODO: Add support for other slot types */
+	.slot_types = EDS_SLOT_UID | EDS_SLOT_URL | EDS_SLOT_TLM | EDS_SLOT_EID,
 };
 
 u8_t eds_active_slot;
@@ -152,31 +197,67 @@ struct eds_slot {
 	u8_t lock[16];
 	u8_t challenge[16];
 	struct bt_data ad[3];
+	/* Service data advertised in ad[2] */
+	u8_t frame[EDS_FRAME_MAX];
+	u8_t frame_len;
+	/* Scheduler state and airtime statistics */
+	s64_t next_due;
+	u32_t bursts;
+	u32_t airtime_us;
+	/* ADV Slot Data being written, applied by commit_work */
+	u8_t staging[EDS_SLOT_DATA_MAX];
+	u8_t staging_len;
+	/* A part of the write was rejected, commit_work leaves the slot */
+	bool staging_rejected;
 };
 
 static struct eds_slot eds_slots[NUMBER_OF_SLOTS] = {
 	[0 ... (NUMBER_OF_SLOTS - 1)] = {
 		.type = EDS_TYPE_NONE,  /* Start as disabled */
 		.state = EDS_UNLOCKED, /* Start unlocked */
-		.interval = sys_cpu_to_be16(BT_GAP_ADV_FAST_INT_MIN_2),
+		.interval = sys_cpu_to_be16(EDS_SCHED_INTERVAL_DEFAULT),
 		.lock = { 'Z', 'e', 'p', 'h', 'y', 'r', ' ', 'E', 'd', 'd',
 			  'y', 's', 't', 'o', 'n', 'e' },
 		.challenge = {},
 		.ad = {
 			BT_DATA_BYTES(BT_DATA_FLAGS, BT_LE_AD_NO_BREDR),
 			BT_DATA_BYTES(BT_DATA_UUID16_ALL, 0xaa, 0xfe),
-			BT_DATA_BYTES(BT_DATA_SVC_DATA16,
-				      0xaa, 0xfe, /* Eddystone UUID */
-				      0x10, /* Eddystone-URL frame type */
-				      0x00, /* Calibrated Tx power at 0m */
-				      0x00, /* URL Scheme Prefix http://www. */
-				      'z', 'e', 'p', 'h', 'y', 'r',
-				      'p', 'r', 'o', 'j', 'e', 'c', 't',
-				      0x08) /* .org */
+			/* ad[2] points at .frame, see eds_slots_init() */
 		},
+		.frame = {
+			0xaa, 0xfe, /* Eddystone UUID */
+		},
+		.frame_len = 2,
 	},
 };
 
+/* Default frame of slot 0, advertised once configuration mode ends */
+static const u8_t eds_url_default[] = {
+	0xaa, 0xfe, /* Eddystone UUID */
+	0x10, /* Eddystone-URL frame type */
+	0x00, /* Calibrated Tx power at 0m */
+	0x00, /* URL Scheme Prefix http://www. */
+	'z', 'e', 'p', 'h', 'y', 'r',
+	'p', 'r', 'o', 'j', 'e', 'c', 't',
+	0x08 /* .org */
+};
+
+static void eds_slots_init(void)
+{
+	int i;
+
+	memcpy(eds_slots[0].frame, eds_url_default, sizeof(eds_url_default));
+	eds_slots[0].frame_len = sizeof(eds_url_default);
+
+	for (i = 0; i < NUMBER_OF_SLOTS; i++) {
+		struct eds_slot *slot = &eds_slots[i];
+
+		slot->ad[2].type = BT_DATA_SVC_DATA16;
+		slot->ad[2].data = slot->frame;
+		slot->ad[2].data_len = slot->frame_len;
+	}
+}
+
 static ssize_t read_caps(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			 void *buf, u16_t len, u16_t offset)
 {
@@ -297,6 +378,35 @@ static ssize_t read_interval(struct bt_conn *conn,
 				 sizeof(slot->interval));
 }
 
+static ssize_t write_interval(struct bt_conn *conn,
+			      const struct bt_gatt_attr *attr,
+			      const void *buf, u16_t len, u16_t offset,
+			      u8_t flags)
+{
+	struct eds_slot *slot = &eds_slots[eds_active_slot];
+	u16_t interval;
+
+	if (slot->state == EDS_LOCKED) {
+		return BT_GATT_ERR(BT_ATT_ERR_WRITE_NOT_PERMITTED);
+	}
+
+	if (offset) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (len != sizeof(slot->interval)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	/* The beacon adjusts values it cannot honor; the client reads back
+	 * the interval actually used.
+	 */
+	interval = max(sys_get_be16(buf), EDS_SCHED_INTERVAL_MIN);
+	slot->interval = sys_cpu_to_be16(interval);
+
+	return len;
+}
+
 static ssize_t read_lock(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			 void *buf, u16_t len, u16_t offset)
 {
@@ -379,7 +489,11 @@ static ssize_t write_unlock(struct bt_conn *conn,
 	return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
 }
 
-static u8_t eds_ecdh[32] = {}; /* TODO: Add ECDH key */
+/* Public ECDH key of the beacon, set by an EID key exchange */
+static u8_t eds_ecdh[EID_ECDH_KEY_LEN] = {};
+
+/* Slot broadcasting the EID, if any */
+static int eds_eid_slot = -1;
 
 static ssize_t read_ecdh(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			 void *buf, u16_t len, u16_t offset)
@@ -390,13 +504,24 @@ static ssize_t read_ecdh(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 				 sizeof(eds_ecdh));
 }
 
-static u8_t eds_eid[16] = {}; /* TODO: Add EID key */
+static u8_t eds_eid[EID_KEY_LEN] = {};
 
 static ssize_t read_eid(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			void *buf, u16_t len, u16_t offset)
 {
+	struct eds_slot *slot = &eds_slots[eds_active_slot];
 	u8_t *value = attr->user_data;
 
+	if (slot->state == EDS_LOCKED) {
+		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
+	}
+
+	/* The identity key is only ever read encrypted with the lock code.
+	 */
+	if (eid_identity_key_get(slot->lock, value)) {
+		memset(value, 0, sizeof(eds_eid));
+	}
+
 	return bt_gatt_attr_read(conn, attr, buf, len, offset, value,
 				 sizeof(eds_eid));
 }
@@ -418,25 +543,167 @@ static ssize_t read_adv_data(struct bt_conn *conn,
 		return 0;
 	}
 
+	/* EID: frame type, exponent, beacon clock and current EID */
+	if (slot->type == EDS_TYPE_EID) {
+		u8_t data[1 + 1 + 4 + EID_LEN];
+
+		data[0] = EDS_TYPE_EID;
+		data[1] = eid_exponent();
+		sys_put_be32(eid_clock(), &data[2]);
+		eid_current(&data[6]);
+
+		return bt_gatt_attr_read(conn, attr, buf, len, offset, data,
+					 sizeof(data));
+	}
+
 	return bt_gatt_attr_read(conn, attr, buf, len, offset,
-				 slot->ad[2].data + EDS_URL_READ_OFFSET,
-				 slot->ad[2].data_len - EDS_URL_READ_OFFSET);
+				 slot->frame + EDS_URL_READ_OFFSET,
+				 slot->frame_len - EDS_URL_READ_OFFSET);
+}
+
+/* Air time of one advertising event of @p slot, in microseconds */
+static u32_t eds_slot_event_us(const struct eds_slot *slot)
+{
+	u32_t len = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(slot->ad); i++) {
+		len += 2 + slot->ad[i].data_len;
+	}
+
+	/* Preamble, access address, header, AdvA, AD and CRC at 1 Mbit/s,
+	 * sent on each of the three primary advertising channels.
+	 */
+	return 3 * (1 + 4 + 2 + 6 + len + 3) * 8;
+}
+
+static void eds_tlm_update(struct eds_slot *slot)
+{
+	u8_t *tlm = &slot->frame[2];
+
+	tlm[0] = EDS_TYPE_TLM;
+	tlm[1] = 0x00; /* Unencrypted TLM version */
+	sys_put_be16(0, &tlm[2]); /* Battery voltage: not supported */
+	sys_put_be16(0x8000, &tlm[4]); /* Temperature: not supported */
+	sys_put_be32(eds_adv_count, &tlm[6]);
+	sys_put_be32(k_uptime_get() / 100, &tlm[10]); /* 0.1 s since boot */
+
+	slot->frame_len = EDS_TLM_FRAME_LEN;
+	slot->ad[2].data_len = slot->frame_len;
+}
+
+static void eds_sched_report(void)
+{
+	s64_t elapsed = k_uptime_delta(&sched_report_time);
+	int i;
+
+	for (i = 0; i < NUMBER_OF_SLOTS; i++) {
+		struct eds_slot *slot = &eds_slots[i];
+
+		if (slot->type == EDS_TYPE_NONE) {
+			continue;
+		}
+
+		printk("Slot %d type 0x%02x: %u events, %u us on air (%u ppm)\n",
+		       i, slot->type, slot->bursts, slot->airtime_us,
+		       (u32_t)((u64_t)slot->airtime_us * 1000 / elapsed));
+		slot->bursts = 0;
+		slot->airtime_us = 0;
+	}
+}
+
+/*
+ * Legacy advertising can only carry one slot at a time, so the slots
+ * share the radio: every due slot gets a burst of one advertising event
+ * and is then due again one slot interval later.
+ */
+static void eds_sched(struct k_work *work)
+{
+	s64_t now = k_uptime_get();
+	struct eds_slot *next = NULL;
+	int i;
+
+	if (sched_current >= 0) {
+		struct eds_slot *slot = &eds_slots[sched_current];
+
+		bt_le_adv_stop();
+		slot->bursts++;
+		slot->airtime_us += eds_slot_event_us(slot);
+		eds_adv_count++;
+		sched_current = -1;
+	}
+
+	if (now - sched_report_time >= EDS_SCHED_REPORT_MS) {
+		eds_sched_report();
+	}
+
+	/* Most overdue slot first */
+	for (i = 0; i < NUMBER_OF_SLOTS; i++) {
+		struct eds_slot *slot = &eds_slots[i];
+
+		if (slot->type != EDS_TYPE_NONE &&
+		    (!next || slot->next_due < next->next_due)) {
+			next = slot;
+		}
+	}
+
+	if (!next) {
+		return;
+	}
+
+	if (next->next_due > now) {
+		k_delayed_work_submit(&sched_work, next->next_due - now);
+		return;
+	}
+
+	if (next->type == EDS_TYPE_TLM) {
+		eds_tlm_update(next);
+	}
+
+	if (bt_le_adv_start(BT_LE_ADV_PARAM(0, EDS_SCHED_ADV_INT,
+					    EDS_SCHED_ADV_INT),
+			    next->ad, ARRAY_SIZE(next->ad), NULL, 0)) {
+		printk("Slot %d failed to start\n", (int)(next - eds_slots));
+	} else {
+		sched_current = next - eds_slots;
+	}
+
+	/* A slot that fell behind does not try to catch up. */
+	next->next_due += sys_be16_to_cpu(next->interval);
+	if (next->next_due < now) {
+		next->next_due = now + sys_be16_to_cpu(next->interval);
+	}
+
+	k_delayed_work_submit(&sched_work, EDS_SCHED_BURST_MS);
 }
 
 static int eds_slot_restart(struct eds_slot *slot, u8_t type)
 {
-	int err;
+	s64_t now = k_uptime_get();
+	bool active = false;
+	int err = 0;
+	int i;
+
+	slot->type = type;
 
 	/* Restart advertising */
+	k_delayed_work_cancel(&sched_work);
 	bt_le_adv_stop();
+	sched_current = -1;
+
+	for (i = 0; i < NUMBER_OF_SLOTS; i++) {
+		if (eds_slots[i].type != EDS_TYPE_NONE) {
+			eds_slots[i].next_due = now;
+			active = true;
+		}
+	}
 
-	if (type == EDS_TYPE_NONE) {
-		/* Restore connectable if slot */
+	if (active) {
+		k_delayed_work_submit(&sched_work, K_NO_WAIT);
+	} else {
+		/* Restore connectable if no slot is broadcasting */
 		err = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad),
 				      NULL, 0);
-	} else {
-		err = bt_le_adv_start(BT_LE_ADV_NCONN_NAME, slot->ad,
-				      ARRAY_SIZE(slot->ad), NULL, 0);
 	}
 
 	if (err) {
@@ -444,67 +711,230 @@ static int eds_slot_restart(struct eds_slot *slot, u8_t type)
 		return err;
 	}
 
-	slot->type = type;
-
 	return 0;
 }
 
-static ssize_t write_adv_data(struct bt_conn *conn,
-			      const struct bt_gatt_attr *attr,
-			      const void *buf, u16_t len, u16_t offset,
-			      u8_t flags)
+/* Called by the EID module at every rotation, already precomputed */
+static void eds_eid_update(const u8_t eid[EID_LEN])
 {
-	struct eds_slot *slot = &eds_slots[eds_active_slot];
-	u8_t type;
+	struct eds_slot *slot;
 
-	if (slot->state == EDS_LOCKED) {
-		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
+	if (eds_eid_slot < 0) {
+		return;
 	}
 
-	if (offset) {
-		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	slot = &eds_slots[eds_eid_slot];
+	slot->frame[2] = EDS_TYPE_EID;
+	slot->frame[3] = slot->adv_tx_power;
+	memcpy(&slot->frame[4], eid, EID_LEN);
+	slot->frame_len = EDS_EID_FRAME_LEN;
+	slot->ad[2].data_len = slot->frame_len;
+}
+
+static void eds_slot_commit_eid(struct eds_slot *slot, u8_t len)
+{
+	int err;
+
+	/* Only one slot rotates an EID at a time. */
+	if (eds_eid_slot >= 0 && eds_eid_slot != slot - eds_slots) {
+		eds_slots[eds_eid_slot].type = EDS_TYPE_NONE;
+	}
+
+	eds_eid_slot = slot - eds_slots;
+
+	if (len == EDS_EID_ECDH_WRITE_LEN) {
+		err = eid_register_ecdh(&slot->staging[1],
+					slot->staging[1 + EID_ECDH_KEY_LEN],
+					eds_ecdh);
+	} else if (len == EDS_EID_KEY_WRITE_LEN) {
+		err = eid_register_key(&slot->staging[1], slot->lock,
+				       slot->staging[1 + EID_KEY_LEN]);
+	} else {
+		printk("EID slot data has %u bytes\n", len);
+		err = -EINVAL;
+	}
+
+	if (err) {
+		printk("EID registration failed (err %d)\n", err);
+		eds_eid_slot = -1;
+		eid_stop();
+		eds_slot_restart(slot, EDS_TYPE_NONE);
+		return;
+	}
+
+	eds_slot_restart(slot, EDS_TYPE_EID);
+}
+
+static void eds_slot_commit(struct k_work *work)
+{
+	struct eds_slot *slot = &eds_slots[eds_commit_slot];
+	u8_t len = slot->staging_len;
+
+	/* The client was answered with an error for part of the write. */
+	if (slot->staging_rejected) {
+		return;
+	}
+
+	/* Reconfiguring the EID slot stops its rotation. */
+	if (eds_eid_slot == eds_commit_slot &&
+	    (!len || slot->staging[0] != EDS_TYPE_EID)) {
+		eds_eid_slot = -1;
+		eid_stop();
 	}
 
 	/* Writing an empty array, clears the slot and stops Tx. */
 	if (!len) {
 		eds_slot_restart(slot, EDS_TYPE_NONE);
-		return len;
+		return;
 	}
 
-	/* Write length: 17 bytes (UID), 19 bytes (URL), 1 byte (TLM), 34 or
-	 * 18 bytes (EID)
-	 */
-	if (len > 19) {
-		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
-	}
+	switch (slot->staging[0]) {
+	case EDS_TYPE_EID:
+		eds_slot_commit_eid(slot, len);
+		break;
+	case EDS_TYPE_UID:
+		if (len != EDS_UID_WRITE_LEN) {
+			printk("UID slot data has %u bytes\n", len);
+			return;
+		}
 
-	memcpy(&type, buf, sizeof(type));
+		slot->frame[2] = EDS_TYPE_UID;
+		slot->frame[3] = slot->adv_tx_power;
+		memcpy(&slot->frame[4], &slot->staging[1], len - 1);
+		slot->frame[4 + len - 1] = 0x00; /* RFU */
+		slot->frame[4 + len] = 0x00; /* RFU */
+		slot->frame_len = EDS_FRAME_MAX;
+		slot->ad[2].data_len = slot->frame_len;
 
-	switch (type) {
+		eds_slot_restart(slot, EDS_TYPE_UID);
+		break;
+	case EDS_TYPE_TLM:
+		/* The beacon fills the TLM frame itself at every burst. */
+		eds_tlm_update(slot);
+		eds_slot_restart(slot, EDS_TYPE_TLM);
+		break;
 	case EDS_TYPE_URL:
+		if (len > EDS_URL_WRITE_MAX) {
+			printk("URL slot data too long (%u bytes)\n", len);
+			return;
+		}
+
 		/* written data is just the frame type and any ID-related
 		 * information, and doesn't include the Tx power since that is
 		 * controlled by characteristics 4 (Radio Tx Power) and
 		 * 5 (Advertised Tx Power).
 		 */
-		slot->ad[2].data_len = min(slot->ad[2].data_len,
-					   len + EDS_URL_WRITE_OFFSET);
-		memcpy(&slot->ad[2].data + EDS_URL_WRITE_OFFSET, buf,
-		       slot->ad[2].data_len - EDS_URL_WRITE_OFFSET);
+		slot->frame[2] = EDS_TYPE_URL;
+		slot->frame[3] = slot->adv_tx_power;
+		memcpy(&slot->frame[4], &slot->staging[1], len - 1);
+		slot->frame_len = len + 3;
+		slot->ad[2].data_len = slot->frame_len;
 
 		/* Restart slot */
-		if (eds_slot_restart(slot, type) < 0) {
-			return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
-		}
+		eds_slot_restart(slot, EDS_TYPE_URL);
+		break;
+	default:
+		/* Rejected by write_adv_data() */
+		break;
+	}
+}
 
-		return len;
+/* Longest ADV Slot Data write of a frame type */
+static u8_t eds_slot_data_max(u8_t type)
+{
+	switch (type) {
 	case EDS_TYPE_UID:
+		return EDS_UID_WRITE_LEN;
+	case EDS_TYPE_URL:
+		return EDS_URL_WRITE_MAX;
 	case EDS_TYPE_TLM:
+		return EDS_TLM_WRITE_LEN;
 	case EDS_TYPE_EID:
+		return EDS_EID_ECDH_WRITE_LEN;
 	default:
-		/* TODO: Add support for other types. */
-		return BT_GATT_ERR(BT_ATT_ERR_WRITE_NOT_PERMITTED);
+		return 0;
+	}
+}
+
+static ssize_t write_adv_data(struct bt_conn *conn,
+			      const struct bt_gatt_attr *attr,
+			      const void *buf, u16_t len, u16_t offset,
+			      u8_t flags)
+{
+	struct eds_slot *slot = &eds_slots[eds_active_slot];
+
+	if (slot->state == EDS_LOCKED) {
+		return BT_GATT_ERR(BT_ATT_ERR_READ_NOT_PERMITTED);
+	}
+
+	/* Write length: 17 bytes (UID), 19 bytes (URL), 1 byte (TLM), 34 or
+	 * 18 bytes (EID)
+	 */
+	if (offset > sizeof(slot->staging)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
 	}
+
+	if (offset + len > sizeof(slot->staging)) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	/* The first byte is the frame type. */
+	if (!offset && len) {
+		switch (*(const u8_t *)buf) {
+		case EDS_TYPE_UID:
+		case EDS_TYPE_URL:
+		case EDS_TYPE_TLM:
+		case EDS_TYPE_EID:
+			break;
+		default:
+			/* TODO: Add support for other types. */
+			return BT_GATT_ERR(BT_ATT_ERR_WRITE_NOT_PERMITTED);
+		}
+	}
+
+	/* A plain write, or the first part of an executed long write. */
+	if (!offset && !(flags & BT_GATT_WRITE_FLAG_PREPARE)) {
+		slot->staging_len = 0;
+		slot->staging_rejected = false;
+	}
+
+	/*
+	 * Data longer than its frame type takes is refused here, so the
+	 * client gets the error: a plain write, a Prepare Write of the first
+	 * part and, on Execute Write, every part against the type staged
+	 * from the first. A plain write cannot be told from the first part
+	 * of a long write, so a write shorter than its type needs is only
+	 * dropped by commit_work.
+	 */
+	if (len && (!offset || !(flags & BT_GATT_WRITE_FLAG_PREPARE))) {
+		u8_t type = offset ? slot->staging[0] : *(const u8_t *)buf;
+
+		if (offset + len > eds_slot_data_max(type)) {
+			if (!(flags & BT_GATT_WRITE_FLAG_PREPARE)) {
+				slot->staging_rejected = true;
+			}
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+	}
+
+	/* Prepare Write: the stack queues the data until Execute Write. */
+	if (flags & BT_GATT_WRITE_FLAG_PREPARE) {
+		return 0;
+	}
+
+	memcpy(&slot->staging[offset], buf, len);
+	slot->staging_len = max(slot->staging_len, offset + len);
+
+	/*
+	 * An executed long write calls this once per part from the
+	 * cooperative RX thread without yielding in between, so the work
+	 * item only runs once every part is staged and advertising is
+	 * restarted once per write rather than once per part.
+	 */
+	eds_commit_slot = eds_active_slot;
+	k_work_submit(&commit_work);
+
+	return len;
 }
 
 static ssize_t write_reset(struct bt_conn *conn,
@@ -568,8 +998,10 @@ static struct bt_gatt_attr eds_attrs[] = {
 			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
 			       read_slot, write_slot, NULL),
 	/* Advertising Interval: Must be unlocked for both read and write. */
-	BT_GATT_CHARACTERISTIC(&eds_intv_uuid.uuid, BT_GATT_CHRC_READ,
-			       BT_GATT_PERM_READ, read_interval, NULL, NULL),
+	BT_GATT_CHARACTERISTIC(&eds_intv_uuid.uuid,
+			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+			       read_interval, write_interval, NULL),
 	/* Radio TX Power: Must be unlocked for both read and write. */
 	BT_GATT_CHARACTERISTIC(&eds_tx_uuid.uuid,
 			       BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
@@ -644,10 +1076,17 @@ static void bt_ready(int err)
 
 static void idle_timeout(struct k_work *work)
 {
-	if (eds_slots[eds_active_slot].type == EDS_TYPE_NONE) {
-		printk("Switching to Beacon mode.\n");
-		eds_slot_restart(&eds_slots[eds_active_slot], EDS_TYPE_URL);
+	int i;
+
+	for (i = 0; i < NUMBER_OF_SLOTS; i++) {
+		if (eds_slots[i].type != EDS_TYPE_NONE) {
+			return;
+		}
 	}
+
+	/* Nothing configured: broadcast the default URL of slot 0. */
+	printk("Switching to Beacon mode.\n");
+	eds_slot_restart(&eds_slots[0], EDS_TYPE_URL);
 }
 
 static void connected(struct bt_conn *conn, u8_t err)
@@ -680,8 +1119,13 @@ void main(void)
 {
 	int err;
 
+	eds_slots_init();
+	eid_init(eds_eid_update);
+
 	bt_conn_cb_register(&conn_callbacks);
 	k_delayed_work_init(&idle_work, idle_timeout);
+	k_work_init(&commit_work, eds_slot_commit);
+	k_delayed_work_init(&sched_work, eds_sched);
 
 	/* Initialize the Bluetooth Subsystem */
 	err = bt_enable(bt_ready);
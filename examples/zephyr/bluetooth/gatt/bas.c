@@ -22,14 +22,39 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 
+#include "bas.h"
+#include "notify.h"
+
 static struct bt_gatt_ccc_cfg  blvl_ccc_cfg[BT_GATT_CCC_MAX] = {};
 static u8_t simulate_blvl;
 static u8_t battery = 100;
 
+/* runs the simulation only while a client is subscribed */
+static struct k_delayed_work simulate_work;
+
+static struct notify_src blvl_src;
+
 static void blvl_ccc_cfg_changed(const struct bt_gatt_attr *attr,
 				 u16_t value)
 {
 	simulate_blvl = (value == BT_GATT_CCC_NOTIFY) ? 1 : 0;
+
+	if (simulate_blvl) {
+		k_delayed_work_submit(&simulate_work, BAS_SIMULATE_INTERVAL);
+	} else {
+		k_delayed_work_cancel(&simulate_work);
+	}
+
+	notify_src_subscription_changed(&blvl_src);
+}
+
+static void simulate_work_handler(struct k_work *work)
+{
+	bas_notify();
+
+	if (simulate_blvl) {
+		k_delayed_work_submit(&simulate_work, BAS_SIMULATE_INTERVAL);
+	}
 }
 
 static ssize_t read_blvl(struct bt_conn *conn, const struct bt_gatt_attr *attr,
@@ -52,8 +77,14 @@ static struct bt_gatt_attr attrs[] = {
 
 static struct bt_gatt_service bas_svc = BT_GATT_SERVICE(attrs);
 
+static struct notify_src blvl_src = NOTIFY_SRC_INITIALIZER(&attrs[1],
+							   blvl_ccc_cfg);
+
 void bas_init(void)
 {
+	k_delayed_work_init(&simulate_work, simulate_work_handler);
+
+	notify_src_register(&blvl_src);
 	bt_gatt_service_register(&bas_svc);
 }
 
@@ -69,5 +100,5 @@ void bas_notify(void)
 		battery = 100;
 	}
 
-	bt_gatt_notify(NULL, &attrs[1], &battery, sizeof(battery));
+	notify_src_set(&blvl_src, &battery, sizeof(battery));
 }
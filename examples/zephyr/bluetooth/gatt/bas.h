@@ -12,7 +12,14 @@
 extern "C" {
 #endif
 
+/* interval of the simulated battery level while a client is subscribed */
+#define BAS_SIMULATE_INTERVAL K_SECONDS(1)
+
 void bas_init(void);
+
+/* Notify the next simulated battery level. This is called once per
+ * BAS_SIMULATE_INTERVAL while a client is subscribed.
+ */
 void bas_notify(void);
 
 #ifdef __cplusplus
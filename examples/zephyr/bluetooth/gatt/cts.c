@@ -15,6 +15,8 @@
 #include <misc/printk.h>
 #include <misc/byteorder.h>
 #include <zephyr.h>
+#include <irq.h>
+#include <hal/nrf_rtc.h>
 
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/hci.h>
@@ -22,36 +24,238 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 
+#include "cts.h"
+#include "notify.h"
+
+/*
+ * The time is kept by RTC2 and recomputed from its counter whenever it
+ * is read, so nothing runs while the time is unused. A prescaler of 128
+ * gives the 1/256 s resolution of 'Exact Time 256'; the 24-bit counter
+ * then wraps every 18.2 hours, which is the only interrupt taken.
+ */
+#define CTS_RTC NRF_RTC2
+#define CTS_RTC_IRQ_PRIO 1
+#define CTS_RTC_PRESCALER 127
+#define CTS_RTC_BITS 24
+
+/* Time is counted in 1/256 s since 1970-01-01 00:00:00 */
+#define CTS_SUBSEC 256
+
+/*
+ * A drift estimate needs two writes far enough apart for the write
+ * latency and the 1/256 s resolution not to dominate. An estimate above
+ * CTS_DRIFT_MAX_PPM is not crystal drift but the user setting the clock.
+ */
+#define CTS_DRIFT_MIN_SECS 3600
+#define CTS_DRIFT_MAX_PPM 500
+
+/* Adjust Reason bits */
+#define CTS_ADJUST_MANUAL BIT(0)
+#define CTS_ADJUST_EXTERNAL_REF BIT(1)
+#define CTS_ADJUST_TIME_ZONE BIT(2)
+#define CTS_ADJUST_DST BIT(3)
+
+/* CTS application error for a value it cannot take */
+#define CTS_ERR_DATA_FIELD_IGNORED 0x80
+
+#define CTS_LEN 10
+
 static struct bt_gatt_ccc_cfg ct_ccc_cfg[BT_GATT_CCC_MAX] = {};
-static u8_t ct[10];
-static u8_t ct_update;
+
+static volatile u32_t rtc_overflows;
+
+/* Time at base_ticks, and correction of the RTC rate in ppm */
+static s64_t base_time;
+static u64_t base_ticks;
+static s32_t drift_ppm;
+static bool synced;
+static u8_t adjust_reason;
+
+static struct notify_src ct_src;
+
+static void rtc_isr(void *arg)
+{
+	if (nrf_rtc_event_pending(CTS_RTC, NRF_RTC_EVENT_OVERFLOW)) {
+		nrf_rtc_event_clear(CTS_RTC, NRF_RTC_EVENT_OVERFLOW);
+		rtc_overflows++;
+	}
+}
+
+static u64_t rtc_ticks(void)
+{
+	unsigned int key;
+	u32_t overflows;
+	u32_t counter;
+
+	key = irq_lock();
+	overflows = rtc_overflows;
+	counter = nrf_rtc_counter_get(CTS_RTC);
+
+	/* Wrapped but the interrupt has not run yet */
+	if (nrf_rtc_event_pending(CTS_RTC, NRF_RTC_EVENT_OVERFLOW)) {
+		counter = nrf_rtc_counter_get(CTS_RTC);
+		overflows++;
+	}
+	irq_unlock(key);
+
+	return ((u64_t)overflows << CTS_RTC_BITS) | counter;
+}
+
+static s64_t time_at(u64_t ticks)
+{
+	s64_t elapsed = ticks - base_ticks;
+
+	return base_time + elapsed + (elapsed * drift_ppm) / 1000000;
+}
+
+static s64_t time_now(void)
+{
+	unsigned int key;
+	s64_t now;
+
+	key = irq_lock();
+	now = time_at(rtc_ticks());
+	irq_unlock(key);
+
+	return now;
+}
+
+/* Days since 1970-01-01 of a proleptic Gregorian date */
+static s32_t days_from_date(s32_t y, u32_t m, u32_t d)
+{
+	u32_t era, yoe, doy, doe;
+
+	y -= (m <= 2);
+	era = y / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+static void date_from_days(s32_t days, u16_t *y, u8_t *m, u8_t *d)
+{
+	u32_t z = days + 719468;
+	u32_t era = z / 146097;
+	u32_t doe = z - era * 146097;
+	u32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	u32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	u32_t mp = (5 * doy + 2) / 153;
+
+	*d = doy - (153 * mp + 2) / 5 + 1;
+	*m = mp < 10 ? mp + 3 : mp - 9;
+	*y = yoe + era * 400 + (*m <= 2);
+}
 
 static void ct_ccc_cfg_changed(const struct bt_gatt_attr *attr, u16_t value)
 {
-	/* TODO: Handle value */
+	/* Subscriptions are tracked per connection by the scheduler. */
+	notify_src_subscription_changed(&ct_src);
+}
+
+static void generate_current_time(u8_t *buf)
+{
+	s64_t now = time_now();
+	s32_t days = now / (CTS_SUBSEC * 86400);
+	u32_t secs = (now / CTS_SUBSEC) % 86400;
+	u16_t year;
+
+	/* 'Exact Time 256' contains 'Day Date Time' which contains
+	 * 'Date Time' - characteristic contains fields for:
+	 * year, month, day, hours, minutes and seconds.
+	 */
+
+	date_from_days(days, &year, &buf[2], &buf[3]);
+	year = sys_cpu_to_le16(year);
+	memcpy(buf,  &year, 2); /* year */
+	buf[4] = secs / 3600; /* hours */
+	buf[5] = (secs / 60) % 60; /* minutes */
+	buf[6] = secs % 60; /* seconds */
+
+	/* 'Day of Week' part of 'Day Date Time', 1970-01-01 was a Thursday */
+	buf[7] = (days + 3) % 7 + 1; /* day of week starting from 1 */
+
+	/* 'Fractions 256 part of 'Exact Time 256' */
+	buf[8] = now % CTS_SUBSEC;
+
+	/* Adjust reason */
+	buf[9] = adjust_reason;
 }
 
 static ssize_t read_ct(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 		       void *buf, u16_t len, u16_t offset)
 {
-	const char *value = attr->user_data;
+	u8_t value[CTS_LEN];
+
+	generate_current_time(value);
 
 	return bt_gatt_attr_read(conn, attr, buf, len, offset, value,
-				 sizeof(ct));
+				 sizeof(value));
+}
+
+static void time_set(s64_t time, u8_t reason)
+{
+	unsigned int key;
+	u64_t ticks;
+	s64_t elapsed;
+	s64_t ppm;
+
+	key = irq_lock();
+	ticks = rtc_ticks();
+	elapsed = ticks - base_ticks;
+
+	/*
+	 * The error accumulated since the last write is what the current
+	 * correction missed. A time zone or daylight saving change moves
+	 * the local time on purpose and tells nothing about the crystal.
+	 */
+	if (synced && elapsed >= CTS_DRIFT_MIN_SECS * CTS_SUBSEC &&
+	    !(reason & (CTS_ADJUST_TIME_ZONE | CTS_ADJUST_DST))) {
+		ppm = drift_ppm + ((time - time_at(ticks)) * 1000000) / elapsed;
+		if (ppm >= -CTS_DRIFT_MAX_PPM && ppm <= CTS_DRIFT_MAX_PPM) {
+			drift_ppm = ppm;
+		}
+	}
+
+	base_time = time;
+	base_ticks = ticks;
+	adjust_reason = reason;
+	synced = true;
+	irq_unlock(key);
 }
 
 static ssize_t write_ct(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			const void *buf, u16_t len, u16_t offset,
 			u8_t flags)
 {
-	u8_t *value = attr->user_data;
+	const u8_t *value = buf;
+	u16_t year;
+	s64_t time;
 
-	if (offset + len > sizeof(ct)) {
+	if (offset) {
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
 	}
 
-	memcpy(value + offset, buf, len);
-	ct_update = 1;
+	if (len != CTS_LEN) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	year = sys_get_le16(value);
+	if (year < 1970 || value[2] < 1 || value[2] > 12 ||
+	    value[3] < 1 || value[3] > 31 || value[4] > 23 ||
+	    value[5] > 59 || value[6] > 59) {
+		return BT_GATT_ERR(CTS_ERR_DATA_FIELD_IGNORED);
+	}
+
+	time = days_from_date(year, value[2], value[3]);
+	time = time * 86400 + value[4] * 3600 + value[5] * 60 + value[6];
+	time = time * CTS_SUBSEC + value[8];
+
+	time_set(time, value[9]);
+
+	/* Current Time Service notifies only when time is changed */
+	cts_notify();
 
 	return len;
 }
@@ -62,53 +266,57 @@ static struct bt_gatt_attr attrs[] = {
 	BT_GATT_CHARACTERISTIC(BT_UUID_CTS_CURRENT_TIME, BT_GATT_CHRC_READ |
 			       BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE,
 			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
-			       read_ct, write_ct, ct),
+			       read_ct, write_ct, NULL),
 	BT_GATT_CCC(ct_ccc_cfg, ct_ccc_cfg_changed),
 };
 
 static struct bt_gatt_service cts_svc = BT_GATT_SERVICE(attrs);
 
-static void generate_current_time(u8_t *buf)
-{
-	u16_t year;
+static struct notify_src ct_src = NOTIFY_SRC_INITIALIZER(&attrs[1],
+							 ct_ccc_cfg);
 
-	/* 'Exact Time 256' contains 'Day Date Time' which contains
-	 * 'Date Time' - characteristic contains fields for:
-	 * year, month, day, hours, minutes and seconds.
-	 */
+void cts_init(void)
+{
+	/* Until a client sets the time, count from 2015-05-30 12:45:30. */
+	base_time = (s64_t)(days_from_date(2015, 5, 30) * 86400 +
+			    12 * 3600 + 45 * 60 + 30) * CTS_SUBSEC;
 
-	year = sys_cpu_to_le16(2015);
-	memcpy(buf,  &year, 2); /* year */
-	buf[2] = 5; /* months starting from 1 */
-	buf[3] = 30; /* day */
-	buf[4] = 12; /* hours */
-	buf[5] = 45; /* minutes */
-	buf[6] = 30; /* seconds */
+	nrf_rtc_prescaler_set(CTS_RTC, CTS_RTC_PRESCALER);
+	nrf_rtc_event_clear(CTS_RTC, NRF_RTC_EVENT_OVERFLOW);
+	nrf_rtc_int_enable(CTS_RTC, NRF_RTC_INT_OVERFLOW_MASK);
 
-	/* 'Day of Week' part of 'Day Date Time' */
-	buf[7] = 1; /* day of week starting from 1 */
+	IRQ_CONNECT(RTC2_IRQn, CTS_RTC_IRQ_PRIO, rtc_isr, NULL, 0);
+	irq_enable(RTC2_IRQn);
 
-	/* 'Fractions 256 part of 'Exact Time 256' */
-	buf[8] = 0;
+	/* RTC1 runs the kernel clock, so LFCLK is already up. */
+	nrf_rtc_task_trigger(CTS_RTC, NRF_RTC_TASK_CLEAR);
+	nrf_rtc_task_trigger(CTS_RTC, NRF_RTC_TASK_START);
+	base_ticks = 0;
 
-	/* Adjust reason */
-	buf[9] = 0; /* No update, change, etc */
+	notify_src_register(&ct_src);
+	bt_gatt_service_register(&cts_svc);
 }
 
-void cts_init(void)
+void cts_notify(void)
 {
-	/* Simulate current time for Current Time Service */
-	generate_current_time(ct);
+	u8_t value[CTS_LEN];
 
-	bt_gatt_service_register(&cts_svc);
+	generate_current_time(value);
+	notify_src_set(&ct_src, value, sizeof(value));
 }
 
-void cts_notify(void)
-{	/* Current Time Service updates only when time is changed */
-	if (!ct_update) {
-		return;
+u32_t cts_time_get(u8_t *fraction)
+{
+	s64_t now = time_now();
+
+	if (fraction) {
+		*fraction = now % CTS_SUBSEC;
 	}
 
-	ct_update = 0;
-	bt_gatt_notify(NULL, &attrs[1], &ct, sizeof(ct));
+	return now / CTS_SUBSEC;
+}
+
+s32_t cts_drift_ppm(void)
+{
+	return drift_ppm;
 }
@@ -12,9 +12,24 @@
 extern "C" {
 #endif
 
+#include <zephyr/types.h>
+
 void cts_init(void);
+
+/* Notify the current time to every subscribed connection. Call when the
+ * time has been changed.
+ */
 void cts_notify(void);
 
+/* Seconds since 1970-01-01 00:00:00 in the client's local time, with
+ * the 1/256 s fraction in @p fraction if not NULL. Cheap enough to
+ * timestamp every sample: it only reads RTC2.
+ */
+u32_t cts_time_get(u8_t *fraction);
+
+/* RTC rate correction estimated from successive time writes, in ppm */
+s32_t cts_drift_ppm(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,27 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 
+#include "hog.h"
+
+/*
+ * Pending input reports. A queued report that has not gone out yet
+ * absorbs the motion of later reports with the same buttons, so the
+ * queue only grows on button changes and a slow link adds no latency
+ * beyond the reports already waiting.
+ */
+#define HOG_REPORT_QUEUE_LEN 8
+
+/* 7.5 ms, the shortest interval allowed, for one report every event */
+#define HOG_HIGH_RATE_PARAM BT_LE_CONN_PARAM(6, 6, 0, 400)
+/* 30-50 ms when there is no need to keep up with fast motion */
+#define HOG_LOW_RATE_PARAM BT_LE_CONN_PARAM(24, 40, 0, 400)
+
+struct hog_report {
+	u8_t buttons;
+	s8_t x;
+	s8_t y;
+} __packed;
+
 enum {
 	HIDS_REMOTE_WAKE = BIT(0),
 	HIDS_NORMALLY_CONNECTABLE = BIT(1),
@@ -56,7 +77,15 @@ static struct hids_report input = {
 };
 
 static struct bt_gatt_ccc_cfg input_ccc_cfg[BT_GATT_CCC_MAX] = {};
-static u8_t simulate_input;
+static struct hog_report report_queue[HOG_REPORT_QUEUE_LEN];
+static u8_t report_head;
+static u8_t report_count;
+static struct hog_report last_report;
+static bool report_inflight;
+static u32_t reports_merged;
+
+static struct bt_conn *hog_conn;
+static bool high_rate;
 static u8_t ctrl_point;
 static u8_t report_map[] = {
 	0x05, 0x01, /* Usage Page (Generic Desktop Ctrls) */
@@ -112,16 +141,37 @@ static ssize_t read_report(struct bt_conn *conn,
 				 sizeof(struct hids_report));
 }
 
+static void send_work_handler(struct k_work *work);
+static K_WORK_DEFINE(send_work, send_work_handler);
+
 static void input_ccc_changed(const struct bt_gatt_attr *attr, u16_t value)
 {
-	simulate_input = (value == BT_GATT_CCC_NOTIFY) ? 1 : 0;
+	unsigned int key;
+
+	if (value & BT_GATT_CCC_NOTIFY) {
+		k_work_submit(&send_work);
+		return;
+	}
+
+	/* Reports queued for a host that no longer listens are stale. */
+	key = irq_lock();
+	report_count = 0;
+	irq_unlock(key);
 }
 
 static ssize_t read_input_report(struct bt_conn *conn,
 				 const struct bt_gatt_attr *attr, void *buf,
 				 u16_t len, u16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, NULL, 0);
+	struct hog_report report;
+	unsigned int key;
+
+	key = irq_lock();
+	report = last_report;
+	irq_unlock(key);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &report,
+				 sizeof(report));
 }
 
 static ssize_t write_ctrl_point(struct bt_conn *conn,
@@ -162,7 +212,215 @@ static struct bt_gatt_attr attrs[] = {
 
 static struct bt_gatt_service hog_svc = BT_GATT_SERVICE(attrs);
 
+static bool input_subscribed(struct bt_conn *conn)
+{
+	const bt_addr_le_t *dst = bt_conn_get_dst(conn);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(input_ccc_cfg); i++) {
+		if (!bt_addr_le_cmp(&input_ccc_cfg[i].peer, dst) &&
+		    (input_ccc_cfg[i].value & BT_GATT_CCC_NOTIFY)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void conn_param_request(void)
+{
+	int err;
+
+	if (!hog_conn) {
+		return;
+	}
+
+	err = bt_conn_le_param_update(hog_conn, high_rate ?
+				      HOG_HIGH_RATE_PARAM :
+				      HOG_LOW_RATE_PARAM);
+	if (err && err != -EALREADY) {
+		printk("HoG connection parameter update failed (err %d)\n",
+		       err);
+	}
+}
+
+static void report_complete(struct bt_conn *conn)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	report_inflight = false;
+	irq_unlock(key);
+
+	k_work_submit(&send_work);
+}
+
+static void send_work_handler(struct k_work *work)
+{
+	struct hog_report report;
+	unsigned int key;
+
+	/*
+	 * Only one report is in flight. Its completion comes once the
+	 * controller has sent it, so the next one leaves on the following
+	 * connection event and the host sees one report per event.
+	 */
+	key = irq_lock();
+	if (!hog_conn || report_inflight || !report_count) {
+		irq_unlock(key);
+		return;
+	}
+	report = report_queue[report_head];
+	report_head = (report_head + 1) % HOG_REPORT_QUEUE_LEN;
+	report_count--;
+	report_inflight = true;
+	irq_unlock(key);
+
+	if (!input_subscribed(hog_conn) ||
+	    bt_gatt_notify_cb(hog_conn, &attrs[5], &report, sizeof(report),
+			      report_complete)) {
+		key = irq_lock();
+		report_inflight = false;
+		irq_unlock(key);
+		return;
+	}
+
+	key = irq_lock();
+	last_report = report;
+	irq_unlock(key);
+}
+
+static void connected(struct bt_conn *conn, u8_t err)
+{
+	if (err || hog_conn) {
+		return;
+	}
+
+	hog_conn = bt_conn_ref(conn);
+	report_inflight = false;
+	conn_param_request();
+}
+
+static void disconnected(struct bt_conn *conn, u8_t reason)
+{
+	unsigned int key;
+
+	if (conn != hog_conn) {
+		return;
+	}
+
+	key = irq_lock();
+	hog_conn = NULL;
+	report_count = 0;
+	report_inflight = false;
+	irq_unlock(key);
+
+	bt_conn_unref(conn);
+}
+
+static void le_param_updated(struct bt_conn *conn, u16_t interval,
+			     u16_t latency, u16_t timeout)
+{
+	if (conn != hog_conn) {
+		return;
+	}
+
+	printk("HoG connection interval %u.%02u ms, latency %u\n",
+	       (interval * 125) / 100, (interval * 125) % 100, latency);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+};
+
+static s8_t delta_add(s8_t a, s8_t b, bool *overflow)
+{
+	int sum = a + b;
+
+	*overflow = (sum > 127 || sum < -127);
+
+	return *overflow ? a : sum;
+}
+
+int hog_input_report(u8_t buttons, s8_t dx, s8_t dy)
+{
+	struct hog_report *tail;
+	unsigned int key;
+	bool ox, oy;
+	int err = 0;
+
+	/* -128 is outside the logical range of the report map */
+	dx = max(dx, -127);
+	dy = max(dy, -127);
+
+	key = irq_lock();
+
+	if (!hog_conn) {
+		irq_unlock(key);
+		return -ENOTCONN;
+	}
+
+	/*
+	 * Fold the motion into the newest report still waiting unless
+	 * the buttons changed, which the host must see as its own report.
+	 */
+	if (report_count) {
+		tail = &report_queue[(report_head + report_count - 1) %
+				     HOG_REPORT_QUEUE_LEN];
+		if (tail->buttons == buttons) {
+			s8_t x = delta_add(tail->x, dx, &ox);
+			s8_t y = delta_add(tail->y, dy, &oy);
+
+			if (!ox && !oy) {
+				tail->x = x;
+				tail->y = y;
+				reports_merged++;
+				goto done;
+			}
+		}
+	}
+
+	if (report_count == HOG_REPORT_QUEUE_LEN) {
+		err = -ENOMEM;
+		goto done;
+	}
+
+	tail = &report_queue[(report_head + report_count) %
+			     HOG_REPORT_QUEUE_LEN];
+	tail->buttons = buttons;
+	tail->x = dx;
+	tail->y = dy;
+	report_count++;
+
+done:
+	irq_unlock(key);
+
+	if (!err) {
+		k_work_submit(&send_work);
+	}
+
+	return err;
+}
+
+void hog_high_rate_set(bool enable)
+{
+	if (high_rate == enable) {
+		return;
+	}
+
+	high_rate = enable;
+	conn_param_request();
+}
+
+u32_t hog_reports_merged(void)
+{
+	return reports_merged;
+}
+
 void hog_init(void)
 {
+	bt_conn_cb_register(&conn_callbacks);
 	bt_gatt_service_register(&hog_svc);
 }
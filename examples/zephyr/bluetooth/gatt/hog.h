@@ -12,8 +12,36 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <zephyr/types.h>
+
 void hog_init(void);
 
+/**
+ * Queue a mouse input report for the connected host.
+ *
+ * Reports go out one per connection event. While reports are waiting,
+ * relative motion with unchanged buttons is summed into the newest
+ * one instead of taking another slot.
+ *
+ * @param buttons Button bitmap, bits 0-2.
+ * @param dx Relative X motion.
+ * @param dy Relative Y motion.
+ *
+ * @return 0 on success, -ENOTCONN without a host or -ENOMEM if the
+ *         queue is full of button changes.
+ */
+int hog_input_report(u8_t buttons, s8_t dx, s8_t dy);
+
+/**
+ * Ask the host for a 7.5 ms connection interval, so a 125 Hz report
+ * stream keeps up, or go back to a slower power-saving interval.
+ */
+void hog_high_rate_set(bool enable);
+
+/** Number of reports absorbed into an earlier queued report. */
+u32_t hog_reports_merged(void);
+
 #ifdef __cplusplus
 }
 #endif
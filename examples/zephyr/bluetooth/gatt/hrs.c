@@ -9,6 +9,7 @@
  */
 
 #include <zephyr/types.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 #include <errno.h>
@@ -22,15 +23,58 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 
+#include "hrs.h"
+#include "notify.h"
+
+/* Heart Rate Measurement flags */
+#define HRM_FLAG_HR_U16		BIT(0)
+#define HRM_FLAG_CONTACT	BIT(1)
+#define HRM_FLAG_CONTACT_SUP	BIT(2)
+#define HRM_FLAG_ENERGY		BIT(3)
+#define HRM_FLAG_RR		BIT(4)
+
+/* flags, 16-bit heart rate, energy expended and RR intervals */
+#define HRM_MAX_LEN		(1 + 2 + 2 + 2 * HRS_RR_MAX)
+
+BUILD_ASSERT(HRM_MAX_LEN <= NOTIFY_VALUE_MAX);
+
 static struct bt_gatt_ccc_cfg hrmc_ccc_cfg[BT_GATT_CCC_MAX] = {};
 static u8_t simulate_hrm;
 static u8_t heartrate = 90;
 static u8_t hrs_blsc;
 
+/* last measurement published, as encoded */
+static u8_t hrm_buf[HRM_MAX_LEN];
+static u16_t hrm_len;
+
+static struct notify_src hrm_src;
+
+/* runs the simulation only while a client is subscribed */
+static struct k_delayed_work simulate_work;
+
 static void hrmc_ccc_cfg_changed(const struct bt_gatt_attr *attr,
 				 u16_t value)
 {
 	simulate_hrm = (value == BT_GATT_CCC_NOTIFY) ? 1 : 0;
+
+	if (simulate_hrm) {
+		k_delayed_work_submit(&simulate_work, K_NO_WAIT);
+	} else {
+		/* The last subscriber left: nothing wakes up any more. */
+		k_delayed_work_cancel(&simulate_work);
+	}
+
+	/* A new subscriber is sent the current value right away. */
+	notify_src_subscription_changed(&hrm_src);
+}
+
+static void simulate_work_handler(struct k_work *work)
+{
+	hrs_notify();
+
+	if (simulate_hrm) {
+		k_delayed_work_submit(&simulate_work, HRS_SIMULATE_INTERVAL);
+	}
 }
 
 static ssize_t read_blsc(struct bt_conn *conn, const struct bt_gatt_attr *attr,
@@ -54,16 +98,93 @@ static struct bt_gatt_attr attrs[] = {
 
 static struct bt_gatt_service hrs_svc = BT_GATT_SERVICE(attrs);
 
+static struct notify_src hrm_src = NOTIFY_SRC_INITIALIZER(&attrs[1],
+							  hrmc_ccc_cfg);
+
+static u16_t hrm_encode(u8_t *buf, const struct hrs_measurement *hrm)
+{
+	u8_t flags = 0;
+	u16_t len = 1;
+	int i;
+
+	if (hrm->contact_supported) {
+		flags |= HRM_FLAG_CONTACT_SUP;
+		if (hrm->contact) {
+			flags |= HRM_FLAG_CONTACT;
+		}
+	}
+
+	if (hrm->bpm > 0xff) {
+		flags |= HRM_FLAG_HR_U16;
+		sys_put_le16(hrm->bpm, &buf[len]);
+		len += 2;
+	} else {
+		buf[len++] = hrm->bpm;
+	}
+
+	if (hrm->energy_present) {
+		flags |= HRM_FLAG_ENERGY;
+		sys_put_le16(hrm->energy, &buf[len]);
+		len += 2;
+	}
+
+	if (hrm->rr_count) {
+		flags |= HRM_FLAG_RR;
+		for (i = 0; i < min(hrm->rr_count, HRS_RR_MAX); i++) {
+			sys_put_le16(hrm->rr[i], &buf[len]);
+			len += 2;
+		}
+	}
+
+	buf[0] = flags;
+
+	return len;
+}
+
 void hrs_init(u8_t blsc)
 {
 	hrs_blsc = blsc;
 
+	k_delayed_work_init(&simulate_work, simulate_work_handler);
+
+	notify_src_register(&hrm_src);
 	bt_gatt_service_register(&hrs_svc);
 }
 
+void hrs_measurement_set(const struct hrs_measurement *hrm)
+{
+	u8_t buf[HRM_MAX_LEN];
+	unsigned int key;
+	bool changed;
+	u16_t len;
+
+	len = hrm_encode(buf, hrm);
+
+	/*
+	 * Only a different encoding is a new value. RR intervals are new
+	 * data every time, so a measurement carrying them is only equal to
+	 * the last one when it is really repeated.
+	 */
+	key = irq_lock();
+	changed = len != hrm_len || memcmp(buf, hrm_buf, len);
+	if (changed) {
+		memcpy(hrm_buf, buf, len);
+		hrm_len = len;
+	}
+	irq_unlock(key);
+
+	if (changed) {
+		notify_src_set(&hrm_src, buf, len);
+	}
+}
+
 void hrs_notify(void)
 {
-	static u8_t hrm[2];
+	struct hrs_measurement hrm = {
+		.contact_supported = true,
+		.contact = true,
+		.rr_count = 1,
+	};
 
 	/* Heartrate measurements simulation */
 	if (!simulate_hrm) {
@@ -75,8 +196,8 @@ void hrs_notify(void)
 		heartrate = 90;
 	}
 
-	hrm[0] = 0x06; /* uint8, sensor contact */
-	hrm[1] = heartrate;
+	hrm.bpm = heartrate;
+	hrm.rr[0] = (60 * 1024) / heartrate;
 
-	bt_gatt_notify(NULL, &attrs[1], &hrm, sizeof(hrm));
+	hrs_measurement_set(&hrm);
 }
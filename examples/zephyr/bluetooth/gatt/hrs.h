@@ -8,11 +8,44 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* RR intervals that fit in one measurement with the default ATT MTU */
+#define HRS_RR_MAX 7
+
+/* interval of the simulated measurements while a client is subscribed */
+#define HRS_SIMULATE_INTERVAL K_SECONDS(1)
+
+struct hrs_measurement {
+	u16_t bpm;
+	/* sensor contact is supported / currently detected */
+	bool contact_supported;
+	bool contact;
+	/* energy expended in kJ, only sent when energy_present is set */
+	bool energy_present;
+	u16_t energy;
+	/* RR intervals in 1/1024 s, oldest first */
+	u8_t rr_count;
+	u16_t rr[HRS_RR_MAX];
+};
+
 void hrs_init(u8_t blsc);
+
+/* Publish a new measurement to every subscribed connection.
+ *
+ * The measurement is encoded once and sent only if it differs from the
+ * last one. Each connection has at most one measurement in flight and
+ * is sent the latest one when it completes, see notify.h.
+ */
+void hrs_measurement_set(const struct hrs_measurement *hrm);
+
+/* Publish the next simulated measurement. This is called once per
+ * HRS_SIMULATE_INTERVAL while a client is subscribed.
+ */
 void hrs_notify(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,275 @@
+/** @file
+ *  @brief Per-connection GATT notification scheduler
+ */
+
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <zephyr.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
+
+#include "notify.h"
+
+/*
+ * Every connection can hold NOTIFY_CREDITS ATT PDUs, so with enough TX
+ * buffers for all of them allocating a PDU never blocks the work queue.
+ */
+BUILD_ASSERT(NOTIFY_CREDITS * CONFIG_BT_MAX_CONN <=
+	     CONFIG_BT_L2CAP_TX_BUF_COUNT);
+
+struct notify_conn {
+	struct bt_conn *conn;
+	u16_t mtu;
+
+	/* source ids of the notifications in flight, oldest first */
+	u8_t inflight[NOTIFY_CREDITS];
+	u8_t inflight_head;
+	u8_t inflight_count;
+	u32_t inflight_mask;
+
+	/* source to look at first, so sources take turns */
+	u8_t next_src;
+	u32_t sent_seq[NOTIFY_SRC_MAX];
+};
+
+static struct notify_src *srcs[NOTIFY_SRC_MAX];
+static u8_t src_count;
+
+static struct notify_conn conns[CONFIG_BT_MAX_CONN];
+
+/* connection to look at first, so connections take turns */
+static u8_t next_conn;
+
+static void send_work_handler(struct k_work *work);
+static K_WORK_DEFINE(send_work, send_work_handler);
+
+static struct notify_conn *conn_find(struct bt_conn *conn)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(conns); i++) {
+		if (conns[i].conn == conn) {
+			return &conns[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void connected(struct bt_conn *conn, u8_t err)
+{
+	struct notify_conn *nc;
+
+	if (err) {
+		return;
+	}
+
+	nc = conn_find(NULL);
+	if (!nc) {
+		return;
+	}
+
+	memset(nc, 0, sizeof(*nc));
+	nc->mtu = bt_gatt_get_mtu(conn);
+	nc->conn = bt_conn_ref(conn);
+}
+
+static void disconnected(struct bt_conn *conn, u8_t reason)
+{
+	struct notify_conn *nc = conn_find(conn);
+	unsigned int key;
+
+	if (!nc) {
+		return;
+	}
+
+	bt_conn_unref(nc->conn);
+
+	key = irq_lock();
+	nc->conn = NULL;
+	irq_unlock(key);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+static void notify_complete(struct bt_conn *conn)
+{
+	struct notify_conn *nc = conn_find(conn);
+	unsigned int key;
+
+	if (!nc) {
+		return;
+	}
+
+	/* A connection completes its notifications in order. */
+	key = irq_lock();
+	if (nc->inflight_count) {
+		nc->inflight_mask &= ~BIT(nc->inflight[nc->inflight_head]);
+		nc->inflight_head = (nc->inflight_head + 1) % NOTIFY_CREDITS;
+		nc->inflight_count--;
+	}
+	irq_unlock(key);
+
+	/* The freed credit may let a waiting value go out. */
+	k_work_submit(&send_work);
+}
+
+bool notify_src_subscribed(const struct notify_src *src,
+			   struct bt_conn *conn)
+{
+	const bt_addr_le_t *dst = bt_conn_get_dst(conn);
+	int i;
+
+	for (i = 0; i < src->ccc_count; i++) {
+		if (!bt_addr_le_cmp(&src->ccc[i].peer, dst) &&
+		    (src->ccc[i].value & BT_GATT_CCC_NOTIFY)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Send one waiting value to @p nc. Return true if something was sent. */
+static bool conn_send_one(struct notify_conn *nc)
+{
+	u8_t value[NOTIFY_VALUE_MAX];
+	struct notify_src *src = NULL;
+	unsigned int key;
+	u32_t seq;
+	u16_t len;
+	int i;
+
+	if (nc->inflight_count == NOTIFY_CREDITS) {
+		return false;
+	}
+
+	for (i = 0; i < src_count; i++) {
+		struct notify_src *s = srcs[(nc->next_src + i) % src_count];
+
+		if (s->seq != nc->sent_seq[s->id] &&
+		    !(nc->inflight_mask & BIT(s->id)) &&
+		    notify_src_subscribed(s, nc->conn)) {
+			src = s;
+			break;
+		}
+	}
+
+	if (!src) {
+		return false;
+	}
+
+	nc->next_src = (src->id + 1) % src_count;
+
+	key = irq_lock();
+	seq = src->seq;
+	len = src->len;
+	memcpy(value, src->value, len);
+	irq_unlock(key);
+
+	/* The MTU can only grow after the exchange, so keep the latest. */
+	nc->mtu = bt_gatt_get_mtu(nc->conn);
+	len = min(len, nc->mtu - 3);
+
+	key = irq_lock();
+	nc->inflight[(nc->inflight_head + nc->inflight_count) %
+		     NOTIFY_CREDITS] = src->id;
+	nc->inflight_count++;
+	nc->inflight_mask |= BIT(src->id);
+	irq_unlock(key);
+
+	if (bt_gatt_notify_cb(nc->conn, src->attr, value, len,
+			      notify_complete)) {
+		key = irq_lock();
+		nc->inflight_count--;
+		nc->inflight_mask &= ~BIT(src->id);
+		irq_unlock(key);
+		return false;
+	}
+
+	nc->sent_seq[src->id] = seq;
+
+	return true;
+}
+
+static void send_work_handler(struct k_work *work)
+{
+	bool sent;
+	int i;
+
+	/*
+	 * Round robin: each round gives every connection at most one
+	 * notification, starting from a different connection each time,
+	 * and a connection with no credit left is simply skipped, so a
+	 * slow central cannot hold up the others.
+	 */
+	do {
+		sent = false;
+
+		for (i = 0; i < ARRAY_SIZE(conns); i++) {
+			struct notify_conn *nc =
+				&conns[(next_conn + i) % ARRAY_SIZE(conns)];
+
+			if (nc->conn && conn_send_one(nc)) {
+				sent = true;
+			}
+		}
+
+		next_conn = (next_conn + 1) % ARRAY_SIZE(conns);
+	} while (sent);
+}
+
+int notify_src_register(struct notify_src *src)
+{
+	if (src_count == ARRAY_SIZE(srcs)) {
+		return -ENOMEM;
+	}
+
+	if (!src_count) {
+		bt_conn_cb_register(&conn_callbacks);
+	}
+
+	src->id = src_count;
+	src->seq = 0;
+	src->len = 0;
+	srcs[src_count++] = src;
+
+	return 0;
+}
+
+void notify_src_set(struct notify_src *src, const void *data, u16_t len)
+{
+	unsigned int key;
+
+	len = min(len, sizeof(src->value));
+
+	key = irq_lock();
+	memcpy(src->value, data, len);
+	src->len = len;
+	src->seq++;
+	irq_unlock(key);
+
+	k_work_submit(&send_work);
+}
+
+void notify_src_subscription_changed(struct notify_src *src)
+{
+	k_work_submit(&send_work);
+}
@@ -0,0 +1,74 @@
+/** @file
+ *  @brief Per-connection GATT notification scheduler
+ */
+
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOTIFY_H__
+#define NOTIFY_H__
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* maximum number of characteristics that can be registered */
+#define NOTIFY_SRC_MAX 8
+
+/* largest value a characteristic can notify */
+#define NOTIFY_VALUE_MAX 20
+
+/* notifications that can be in flight on one connection at once */
+#define NOTIFY_CREDITS 2
+
+/* A notifying characteristic.
+ *
+ * The scheduler keeps the latest value of every source and, for every
+ * connection, the sequence number of the value it was last sent. A
+ * connection that is subscribed and behind is sent the latest value
+ * once it has a free credit, so intermediate values are skipped for a
+ * slow central instead of queueing up.
+ */
+struct notify_src {
+	const struct bt_gatt_attr *attr;
+	const struct bt_gatt_ccc_cfg *ccc;
+	size_t ccc_count;
+
+	u8_t id;
+	u32_t seq;
+	u16_t len;
+	u8_t value[NOTIFY_VALUE_MAX];
+};
+
+#define NOTIFY_SRC_INITIALIZER(_attr, _ccc)			\
+	{							\
+		.attr = _attr,					\
+		.ccc = _ccc,					\
+		.ccc_count = ARRAY_SIZE(_ccc),			\
+	}
+
+/* Register a source. Must be called before the first connection. */
+int notify_src_register(struct notify_src *src);
+
+/* Publish a new value of the source to every subscribed connection. */
+void notify_src_set(struct notify_src *src, const void *data, u16_t len);
+
+/* Call from the CCC changed callback so a new subscriber is sent the
+ * current value.
+ */
+void notify_src_subscription_changed(struct notify_src *src);
+
+/* Return true if the peer of @p conn has enabled notifications. */
+bool notify_src_subscribed(const struct notify_src *src,
+			   struct bt_conn *conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NOTIFY_H__ */
@@ -0,0 +1,228 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <misc/byteorder.h>
+#include <zephyr.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/conn.h>
+
+#include <net/socket.h>
+
+#include <gatt/ipss.h>
+
+/* Datagrams sent back unchanged, for round-trip measurements */
+#define ECHO_PORT 4242
+/* Datagrams counted and dropped, for goodput measurements */
+#define SINK_PORT 4243
+
+/* Largest UDP payload in one 1280-byte IPSP SDU: 1280 - 40 - 8 */
+#define UDP_PAYLOAD_MAX 1232
+
+#define SERVER_STACK_SIZE 1024
+#define SERVER_PRIORITY 7
+
+/* 7.5-15 ms: several link layer packets per event at 2M PHY */
+#define THROUGHPUT_CONN_PARAM BT_LE_CONN_PARAM(6, 12, 0, 400)
+
+struct sink_report {
+	u32_t datagrams;
+	u32_t bytes;
+	u32_t elapsed_ms;
+} __packed;
+
+static void connected(struct bt_conn *conn, u8_t err)
+{
+	if (err) {
+		return;
+	}
+
+	err = bt_conn_le_param_update(conn, THROUGHPUT_CONN_PARAM);
+	if (err) {
+		printk("Connection parameter update failed (err %d)\n", err);
+	}
+}
+
+static void disconnected(struct bt_conn *conn, u8_t reason)
+{
+	int err;
+
+	err = ipss_advertise();
+	if (err) {
+		printk("Advertising failed to start (err %d)\n", err);
+	}
+}
+
+static void le_param_updated(struct bt_conn *conn, u16_t interval,
+			     u16_t latency, u16_t timeout)
+{
+	printk("Connection interval %u.%02u ms\n",
+	       (interval * 125) / 100, (interval * 125) % 100);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+};
+
+static int udp_bind(u16_t port)
+{
+	struct sockaddr_in6 addr = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(port),
+		.sin6_addr = IN6ADDR_ANY_INIT,
+	};
+	int sock;
+
+	sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) {
+		printk("UDP socket failed (err %d)\n", errno);
+		return -1;
+	}
+
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		printk("UDP bind to port %u failed (err %d)\n", port, errno);
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+static u8_t echo_buf[UDP_PAYLOAD_MAX];
+
+static void echo_server(void)
+{
+	struct sockaddr_in6 peer;
+	socklen_t peer_len;
+	ssize_t len;
+	int sock;
+
+	sock = udp_bind(ECHO_PORT);
+	if (sock < 0) {
+		return;
+	}
+
+	while (1) {
+		peer_len = sizeof(peer);
+		len = recvfrom(sock, echo_buf, sizeof(echo_buf), 0,
+			       (struct sockaddr *)&peer, &peer_len);
+		if (len < 0) {
+			continue;
+		}
+
+		sendto(sock, echo_buf, len, 0, (struct sockaddr *)&peer,
+		       peer_len);
+	}
+}
+
+static u8_t sink_buf[UDP_PAYLOAD_MAX];
+
+/*
+ * The sink counts every datagram of a run. An empty datagram ends the
+ * run: the counts go back to the sender, so it can compute the goodput
+ * that actually arrived, and to the console.
+ */
+static void sink_server(void)
+{
+	struct sink_report report;
+	struct sockaddr_in6 peer;
+	socklen_t peer_len;
+	u32_t datagrams = 0;
+	u32_t bytes = 0;
+	s64_t first = 0;
+	s64_t last = 0;
+	ssize_t len;
+	int sock;
+
+	sock = udp_bind(SINK_PORT);
+	if (sock < 0) {
+		return;
+	}
+
+	while (1) {
+		peer_len = sizeof(peer);
+		len = recvfrom(sock, sink_buf, sizeof(sink_buf), 0,
+			       (struct sockaddr *)&peer, &peer_len);
+		if (len < 0) {
+			continue;
+		}
+
+		if (len > 0) {
+			last = k_uptime_get();
+			if (!datagrams) {
+				first = last;
+			}
+			datagrams++;
+			bytes += len;
+			continue;
+		}
+
+		report.datagrams = sys_cpu_to_le32(datagrams);
+		report.bytes = sys_cpu_to_le32(bytes);
+		report.elapsed_ms = sys_cpu_to_le32((u32_t)(last - first));
+
+		if (last > first) {
+			printk("Sink: %u datagrams, %u bytes in %u ms, "
+			       "%u kbit/s\n", datagrams, bytes,
+			       (u32_t)(last - first),
+			       (u32_t)(((u64_t)bytes * 8) / (last - first)));
+		}
+
+		sendto(sock, &report, sizeof(report), 0,
+		       (struct sockaddr *)&peer, peer_len);
+
+		datagrams = 0;
+		bytes = 0;
+	}
+}
+
+K_THREAD_DEFINE(echo_thread, SERVER_STACK_SIZE, echo_server, NULL, NULL,
+		NULL, SERVER_PRIORITY, 0, K_NO_WAIT);
+K_THREAD_DEFINE(sink_thread, SERVER_STACK_SIZE, sink_server, NULL, NULL,
+		NULL, SERVER_PRIORITY, 0, K_NO_WAIT);
+
+static void bt_ready(int err)
+{
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+
+	printk("Bluetooth initialized\n");
+
+	ipss_init();
+
+	err = ipss_advertise();
+	if (err) {
+		printk("Advertising failed to start (err %d)\n", err);
+		return;
+	}
+
+	printk("Advertising successfully started\n");
+}
+
+void main(void)
+{
+	int err;
+
+	err = bt_enable(bt_ready);
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+
+	bt_conn_cb_register(&conn_callbacks);
+}
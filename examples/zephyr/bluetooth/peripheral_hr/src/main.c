@@ -24,20 +24,39 @@
 #include <gatt/dis.h>
 #include <gatt/bas.h>
 
-struct bt_conn *default_conn;
+static u8_t conn_count;
 
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
 	BT_DATA_BYTES(BT_DATA_UUID16_ALL, 0x0d, 0x18, 0x0f, 0x18, 0x05, 0x18),
 };
 
+static void adv_start(void)
+{
+	int err;
+
+	err = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad), NULL, 0);
+	if (err) {
+		printk("Advertising failed to start (err %d)\n", err);
+		return;
+	}
+
+	printk("Advertising successfully started\n");
+}
+
 static void connected(struct bt_conn *conn, u8_t err)
 {
 	if (err) {
 		printk("Connection failed (err %u)\n", err);
-	} else {
-		default_conn = bt_conn_ref(conn);
-		printk("Connected\n");
+		return;
+	}
+
+	conn_count++;
+	printk("Connected (%u/%u)\n", conn_count, CONFIG_BT_MAX_CONN);
+
+	/* Advertising stops on connection; keep accepting centrals. */
+	if (conn_count < CONFIG_BT_MAX_CONN) {
+		adv_start();
 	}
 }
 
@@ -45,9 +64,8 @@ static void disconnected(struct bt_conn *conn, u8_t reason)
 {
 	printk("Disconnected (reason %u)\n", reason);
 
-	if (default_conn) {
-		bt_conn_unref(default_conn);
-		default_conn = NULL;
+	if (conn_count-- == CONFIG_BT_MAX_CONN) {
+		adv_start();
 	}
 }
 
@@ -69,13 +87,7 @@ static void bt_ready(int err)
 	bas_init();
 	dis_init(CONFIG_SOC, "Manufacturer");
 
-	err = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad), NULL, 0);
-	if (err) {
-		printk("Advertising failed to start (err %d)\n", err);
-		return;
-	}
-
-	printk("Advertising successfully started\n");
+	adv_start();
 }
 
 static void auth_cancel(struct bt_conn *conn)
@@ -104,16 +116,8 @@ void main(void)
 	bt_conn_cb_register(&conn_callbacks);
 	bt_conn_auth_cb_register(&auth_cb_display);
 
-	/* Implement notification. At the moment there is no suitable way
-	 * of starting delayed work so we do it here
+	/* The services simulate their values from delayed work that is
+	 * only scheduled while a client is subscribed, so there is nothing
+	 * left to do here.
 	 */
-	while (1) {
-		k_sleep(MSEC_PER_SEC);
-
-		/* Heartrate measurements simulation */
-		hrs_notify();
-
-		/* Battery level simulation */
-		bas_notify();
-	}
 }
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <irq.h>
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_gpiote.h>
+
+#include "button.h"
+
+#define BUTTON_IRQ_PRIO 1
+
+enum button_state {
+	STATE_IDLE,		/* released, nothing pending */
+	STATE_DOWN,		/* first press, waiting for long press */
+	STATE_LONG,		/* long press reported, waiting for release */
+	STATE_WAIT_DOUBLE,	/* released, waiting for a second press */
+	STATE_DOUBLE,		/* double press reported, waiting for release */
+};
+
+static u32_t button_pin;
+static bool button_active_high;
+static struct k_msgq *button_msgq;
+
+/*
+ * Everything below is only touched from the timer expiry functions,
+ * which all run in the system clock interrupt, so it needs no locking.
+ */
+static bool pressed;
+static enum button_state state;
+static u32_t press_time;
+
+static struct k_timer debounce_timer;
+static struct k_timer gesture_timer;
+
+static void sense_arm(bool for_press)
+{
+	bool level = for_press ? button_active_high : !button_active_high;
+
+	nrf_gpio_cfg_sense_set(button_pin, level ? NRF_GPIO_PIN_SENSE_HIGH :
+						   NRF_GPIO_PIN_SENSE_LOW);
+}
+
+static void evt_put(enum button_evt_type type)
+{
+	struct button_evt evt = {
+		.type = type,
+		.timestamp = press_time,
+	};
+
+	/* Drop the event rather than block in interrupt context. */
+	(void)k_msgq_put(button_msgq, &evt, K_NO_WAIT);
+}
+
+static void on_press(void)
+{
+	switch (state) {
+	case STATE_WAIT_DOUBLE:
+		k_timer_stop(&gesture_timer);
+		evt_put(BUTTON_EVT_DOUBLE);
+		state = STATE_DOUBLE;
+		break;
+	default:
+		press_time = k_uptime_get_32();
+		k_timer_start(&gesture_timer, K_MSEC(BUTTON_LONG_MS), 0);
+		state = STATE_DOWN;
+		break;
+	}
+}
+
+static void on_release(void)
+{
+	switch (state) {
+	case STATE_DOWN:
+		k_timer_start(&gesture_timer, K_MSEC(BUTTON_DOUBLE_MS), 0);
+		state = STATE_WAIT_DOUBLE;
+		break;
+	default:
+		state = STATE_IDLE;
+		break;
+	}
+}
+
+static void gesture_expiry(struct k_timer *timer)
+{
+	switch (state) {
+	case STATE_DOWN:
+		evt_put(BUTTON_EVT_LONG);
+		state = STATE_LONG;
+		break;
+	case STATE_WAIT_DOUBLE:
+		evt_put(BUTTON_EVT_SHORT);
+		state = STATE_IDLE;
+		break;
+	default:
+		break;
+	}
+}
+
+static void debounce_expiry(struct k_timer *timer)
+{
+	bool active = (nrf_gpio_pin_read(button_pin) != 0) ==
+		      button_active_high;
+
+	if (active != pressed) {
+		pressed = active;
+		if (pressed) {
+			on_press();
+		} else {
+			on_release();
+		}
+	}
+
+	/*
+	 * Wait for the opposite level. If the pin is already there the
+	 * DETECT signal rises at once and raises a new PORT event.
+	 */
+	sense_arm(!pressed);
+}
+
+static void button_isr(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+
+	/*
+	 * Stop sensing while the contacts bounce; the debounce timer
+	 * samples the pin once they have settled.
+	 */
+	nrf_gpio_cfg_sense_set(button_pin, NRF_GPIO_PIN_NOSENSE);
+	k_timer_start(&debounce_timer, K_MSEC(BUTTON_DEBOUNCE_MS), 0);
+}
+
+void button_init(u32_t pin, nrf_gpio_pin_pull_t pull, bool active_high,
+		 struct k_msgq *msgq)
+{
+	button_pin = pin;
+	button_active_high = active_high;
+	button_msgq = msgq;
+
+	k_timer_init(&debounce_timer, debounce_expiry, NULL);
+	k_timer_init(&gesture_timer, gesture_expiry, NULL);
+
+	nrf_gpio_cfg_sense_input(pin, pull, NRF_GPIO_PIN_NOSENSE);
+
+	/* A button held during start-up is only seen once released. */
+	pressed = (nrf_gpio_pin_read(pin) != 0) == active_high;
+	state = pressed ? STATE_LONG : STATE_IDLE;
+
+	IRQ_CONNECT(GPIOTE_IRQn, BUTTON_IRQ_PRIO, button_isr, NULL, 0);
+
+	nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+	nrf_gpiote_int_enable(NRF_GPIOTE_INT_PORT_MASK);
+	irq_enable(GPIOTE_IRQn);
+
+	sense_arm(!pressed);
+}
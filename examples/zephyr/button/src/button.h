@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BUTTON_H__
+#define BUTTON_H__
+
+#include <zephyr.h>
+#include <stdbool.h>
+#include <hal/nrf_gpio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* time the contacts are left to settle after the first edge */
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS	20
+#endif
+
+/* a press held at least this long is a long press */
+#ifndef BUTTON_LONG_MS
+#define BUTTON_LONG_MS		1000
+#endif
+
+/* a second press within this time of a release is a double press */
+#ifndef BUTTON_DOUBLE_MS
+#define BUTTON_DOUBLE_MS	300
+#endif
+
+enum button_evt_type {
+	BUTTON_EVT_SHORT,	/* pressed and released once */
+	BUTTON_EVT_DOUBLE,	/* pressed twice in a row */
+	BUTTON_EVT_LONG,	/* held for BUTTON_LONG_MS */
+};
+
+struct button_evt {
+	u32_t type;		/* enum button_evt_type */
+	u32_t timestamp;	/* uptime in ms of the (first) press */
+};
+
+/*
+ * Start watching @p pin and put a struct button_evt into @p msgq for
+ * every press that is recognised.
+ *
+ * The pin is watched with the GPIO SENSE mechanism and the GPIOTE PORT
+ * event rather than a GPIOTE IN channel, so no high-frequency clock is
+ * kept running while waiting. Debouncing and press classification use
+ * one-shot kernel timers that are only armed while the button is in
+ * use, so nothing wakes the CPU while it is idle.
+ *
+ * Only one button is supported and the driver owns the GPIOTE
+ * interrupt, so the Zephyr GPIO driver must be disabled.
+ *
+ * @param pin         GPIO pin of the button.
+ * @param pull        Pull resistor to enable on the pin.
+ * @param active_high Set if the pin reads high while the button is held.
+ * @param msgq        Message queue of struct button_evt.
+ */
+void button_init(u32_t pin, nrf_gpio_pin_pull_t pull, bool active_high,
+		 struct k_msgq *msgq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BUTTON_H__ */
@@ -49,10 +49,45 @@
 #endif
 #define PULL_UP SW0_GPIO_FLAGS
 
-/* Sleep time */
-#define SLEEP_TIME	500
+#if defined(CONFIG_SOC_FAMILY_NRF) && !defined(CONFIG_GPIO)
+#include "button.h"
 
+/* number of button events that can be waiting at once */
+#define EVT_COUNT 8
 
+K_MSGQ_DEFINE(button_msgq, sizeof(struct button_evt), EVT_COUNT, 4);
+
+static const char * const evt_names[] = {
+	[BUTTON_EVT_SHORT] = "short",
+	[BUTTON_EVT_DOUBLE] = "double",
+	[BUTTON_EVT_LONG] = "long",
+};
+
+void main(void)
+{
+	nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_NOPULL;
+
+	if ((PULL_UP & GPIO_PUD_MASK) == GPIO_PUD_PULL_UP) {
+		pull = NRF_GPIO_PIN_PULLUP;
+	} else if ((PULL_UP & GPIO_PUD_MASK) == GPIO_PUD_PULL_DOWN) {
+		pull = NRF_GPIO_PIN_PULLDOWN;
+	}
+
+	printk("Press the user defined button on the board\n");
+
+	button_init(PIN, pull, (EDGE & GPIO_INT_ACTIVE_HIGH) != 0,
+		    &button_msgq);
+
+	while (1) {
+		struct button_evt evt;
+
+		/* Sleeps until the driver reports a press. */
+		k_msgq_get(&button_msgq, &evt, K_FOREVER);
+		printk("Button %s press at %u ms\n", evt_names[evt.type],
+		       evt.timestamp);
+	}
+}
+#else
 void button_pressed(struct device *gpiob, struct gpio_callback *cb,
 		    u32_t pins)
 {
@@ -80,10 +115,6 @@ void main(void)
 	gpio_add_callback(gpiob, &gpio_cb);
 	gpio_pin_enable_callback(gpiob, PIN);
 
-	while (1) {
-		u32_t val = 0;
-
-		gpio_pin_read(gpiob, PIN, &val);
-		k_sleep(SLEEP_TIME);
-	}
+	/* Nothing to poll: the callback reports every press. */
 }
+#endif
@@ -16,6 +16,8 @@
 #include <pwm.h>
 #include <board.h>
 
+#include "pwm_fade.h"
+
 #if defined(CONFIG_SOC_STM32F401XE) || defined(CONFIG_SOC_STM32L476XG)
 #define PWM_DRIVER CONFIG_PWM_STM32_2_DEV_NAME
 #define PWM_CHANNEL 1
@@ -25,6 +27,10 @@
 #elif defined(CONFIG_SOC_QUARK_SE_C1000) || defined(CONFIG_SOC_QUARK_D2000)
 #define PWM_DRIVER CONFIG_PWM_QMSI_DEV_NAME
 #define PWM_CHANNEL 0
+#elif defined(CONFIG_SOC_SERIES_NRF52X)
+/* PWM0 plays the whole fade on its own, see pwm_fade.c */
+#define PWM_FADE_HW
+#define PWM_CHANNEL LED0_GPIO_PIN
 #elif defined(CONFIG_SOC_FAMILY_NRF)
 #include <board.h>
 #define PWM_DRIVER CONFIG_PWM_NRF5_SW_0_DEV_NAME
@@ -48,6 +54,30 @@
 /* in micro second */
 #define FADESTEP	2000
 
+/* in milli second, matches FADESTEP every second */
+#define FADE_RAMP_MS	(MSEC_PER_SEC * PERIOD / FADESTEP)
+
+#ifdef PWM_FADE_HW
+void main(void)
+{
+	int err;
+
+	printk("PWM demo app-fade LED\n");
+
+	/* The LEDs on the nRF52832-MDK are active low. */
+	err = pwm_fade_start(PWM_CHANNEL, true, PERIOD, FADE_RAMP_MS);
+	if (err) {
+		printk("pwm fade start fails (err %d)\n", err);
+		return;
+	}
+
+	/*
+	 * Nothing left to do: PWM0 keeps fading the LED while the CPU
+	 * stays in the idle thread.
+	 */
+}
+#else
+
 void main(void)
 {
 	struct device *pwm_dev;
@@ -88,3 +118,4 @@ void main(void)
 		k_sleep(MSEC_PER_SEC);
 	}
 }
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_pwm.h>
+
+#include "pwm_fade.h"
+
+/* 16 MHz / 16: one counter tick per microsecond */
+#define PWM_FADE_CLOCK	NRF_PWM_CLK_1MHz
+
+#define PWM_FADE_TOP_MAX	0x7FFF
+
+/* bit 15 of each value: the first edge in the period is falling */
+#define PWM_FADE_FALLING	BIT(15)
+
+/* up ramp followed by the mirrored down ramp; must stay in RAM */
+static u16_t fade_table[2 * PWM_FADE_STEPS];
+
+static bool running;
+
+int pwm_fade_start(u32_t pin, bool active_low, u32_t period_us,
+		   u32_t ramp_ms)
+{
+	u32_t pins[NRF_PWM_CHANNEL_COUNT] = {
+		pin,
+		NRF_PWM_PIN_NOT_CONNECTED,
+		NRF_PWM_PIN_NOT_CONNECTED,
+		NRF_PWM_PIN_NOT_CONNECTED,
+	};
+	nrf_pwm_sequence_t seq = {
+		.values.p_common = fade_table,
+		.length = ARRAY_SIZE(fade_table),
+		.repeats = 0,
+		.end_delay = 0,
+	};
+	u32_t step_periods;
+	u16_t polarity;
+	int i;
+
+	if (running || period_us == 0 || period_us > PWM_FADE_TOP_MAX) {
+		return -EINVAL;
+	}
+
+	/*
+	 * With a falling first edge the pin is high for the first
+	 * "value" ticks of each period, so an active-low LED needs the
+	 * opposite polarity, a rising first edge, to be lit for those
+	 * ticks instead.
+	 */
+	polarity = active_low ? 0 : PWM_FADE_FALLING;
+
+	/*
+	 * Square the step index so the curve is roughly linear in
+	 * perceived brightness rather than in duty cycle.
+	 */
+	for (i = 0; i < PWM_FADE_STEPS; i++) {
+		u16_t duty = (u64_t)period_us * i * i /
+			     ((PWM_FADE_STEPS - 1) * (PWM_FADE_STEPS - 1));
+
+		fade_table[i] = duty | polarity;
+		fade_table[ARRAY_SIZE(fade_table) - 1 - i] = duty | polarity;
+	}
+
+	/* Each value plays once plus "repeats" more periods. */
+	step_periods = (u64_t)ramp_ms * USEC_PER_MSEC /
+		       ((u64_t)period_us * PWM_FADE_STEPS);
+	if (step_periods > 0) {
+		seq.repeats = min(step_periods - 1, PWM_SEQ_REFRESH_REFRESH_Msk);
+	}
+
+	nrf_gpio_pin_write(pin, active_low ? 1 : 0);
+	nrf_gpio_cfg_output(pin);
+
+	nrf_pwm_pins_set(NRF_PWM0, pins);
+	nrf_pwm_enable(NRF_PWM0);
+	nrf_pwm_configure(NRF_PWM0, PWM_FADE_CLOCK, NRF_PWM_MODE_UP,
+			  period_us);
+	nrf_pwm_decoder_set(NRF_PWM0, NRF_PWM_LOAD_COMMON, NRF_PWM_STEP_AUTO);
+
+	/*
+	 * Both sequences play the same table. LOOP makes sequence 0 and 1
+	 * play back to back, and the LOOPSDONE short starts sequence 0
+	 * again, so the hardware repeats the fade without any interrupt.
+	 */
+	nrf_pwm_sequence_set(NRF_PWM0, 0, &seq);
+	nrf_pwm_sequence_set(NRF_PWM0, 1, &seq);
+	nrf_pwm_loop_set(NRF_PWM0, 1);
+	nrf_pwm_shorts_set(NRF_PWM0, NRF_PWM_SHORT_LOOPSDONE_SEQSTART0_MASK);
+	nrf_pwm_int_set(NRF_PWM0, 0);
+
+	nrf_pwm_event_clear(NRF_PWM0, NRF_PWM_EVENT_STOPPED);
+	nrf_pwm_task_trigger(NRF_PWM0, NRF_PWM_TASK_SEQSTART0);
+	running = true;
+
+	return 0;
+}
+
+void pwm_fade_stop(void)
+{
+	if (!running) {
+		return;
+	}
+
+	nrf_pwm_shorts_set(NRF_PWM0, 0);
+	nrf_pwm_task_trigger(NRF_PWM0, NRF_PWM_TASK_STOP);
+
+	while (!nrf_pwm_event_check(NRF_PWM0, NRF_PWM_EVENT_STOPPED)) {
+	}
+
+	nrf_pwm_disable(NRF_PWM0);
+	running = false;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PWM_FADE_H__
+#define PWM_FADE_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* number of brightness steps in each half of the fade */
+#define PWM_FADE_STEPS 100
+
+/*
+ * Fade @p pin up and back down forever using the PWM0 peripheral.
+ *
+ * The whole curve is computed once into a RAM table that PWM0 plays
+ * through EasyDMA, holding each step for as many periods as needed for
+ * a ramp of @p ramp_ms, and restarts on its own when the table is done,
+ * so the CPU is not woken again while the LED fades.
+ *
+ * @param pin        GPIO pin the LED is connected to.
+ * @param active_low Set if the LED lights up when the pin is low.
+ * @param period_us  PWM period in microseconds, at most 32767.
+ * @param ramp_ms    Duration of each of the fade in and the fade out.
+ *
+ * @return 0 on success, -EINVAL if the period cannot be generated or a
+ *         fade is already running.
+ */
+int pwm_fade_start(u32_t pin, bool active_low, u32_t period_us,
+		   u32_t ramp_ms);
+
+/* Stop the fade and release the PWM0 peripheral. */
+void pwm_fade_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PWM_FADE_H__ */
@@ -10,7 +10,10 @@
 #include <misc/printk.h>
 #include <misc/__assert.h>
 #include <board.h>
-#include <string.h>
+#include <atomic.h>
+#include <uart.h>
+
+#include "thread_stats.h"
 
 /* size of stack area used by each thread */
 #define STACKSIZE 1024
@@ -34,18 +37,59 @@
 #define LED0    LED0_GPIO_PIN
 #define LED1    LED1_GPIO_PIN
 
+/* number of messages that can be waiting for uart_out at once */
+#define MSG_COUNT 16
+
+/* print the message pool statistics every this many messages */
+#define STATS_INTERVAL 100
+
+/* print the thread statistics every this many seconds */
+#define REPORT_PERIOD_S 10
+
 struct printk_data_t {
 	void *fifo_reserved; /* 1st word reserved for use by fifo */
 	u32_t led;
 	u32_t cnt;
+	u32_t put_cycles; /* when the message was queued */
 };
 
 K_FIFO_DEFINE(printk_fifo);
 
+/*
+ * Messages are taken from a fixed slab instead of the heap: allocation
+ * and release take constant time, cannot fragment, and running out is
+ * counted rather than going unnoticed.
+ */
+K_MEM_SLAB_DEFINE(printk_slab, sizeof(struct printk_data_t), MSG_COUNT, 4);
+
+static atomic_t alloc_failures;
+static atomic_t high_water;
+
+static void high_water_update(void)
+{
+	atomic_val_t used = k_mem_slab_num_used_get(&printk_slab);
+	atomic_val_t max;
+
+	do {
+		max = atomic_get(&high_water);
+		if (used <= max) {
+			return;
+		}
+	} while (!atomic_cas(&high_water, max, used));
+}
+
+static struct thread_stats blink_stats[2];
+static struct thread_stats uart_out_stats;
+
 void blink(const char *port, u32_t sleep_ms, u32_t led, u32_t id)
 {
 	int cnt = 0;
 	struct device *gpio_dev;
+	struct thread_stats *stats = &blink_stats[id];
+	u32_t sleep_cycles = (u64_t)sleep_ms * sys_clock_hw_cycles_per_sec /
+			     MSEC_PER_SEC;
+
+	thread_stats_register(stats, id ? "blink2" : "blink1");
 
 	gpio_dev = device_get_binding(port);
 	__ASSERT_NO_MSG(gpio_dev != NULL);
@@ -55,17 +99,26 @@ void blink(const char *port, u32_t sleep_ms, u32_t led, u32_t id)
 	while (1) {
 		gpio_pin_write(gpio_dev, led, cnt % 2);
 
-		struct printk_data_t tx_data = { .led = id, .cnt = cnt };
+		struct printk_data_t *tx_data;
 
-		size_t size = sizeof(struct printk_data_t);
-		char *mem_ptr = k_malloc(size);
-		__ASSERT_NO_MSG(mem_ptr != 0);
+		/* Never block the LED timing on a slow consumer: drop instead. */
+		if (k_mem_slab_alloc(&printk_slab, (void **)&tx_data,
+				     K_NO_WAIT) == 0) {
+			high_water_update();
 
-		memcpy(mem_ptr, &tx_data, size);
+			tx_data->led = id;
+			tx_data->cnt = cnt;
+			tx_data->put_cycles = k_cycle_get_32();
+			k_fifo_put(&printk_fifo, tx_data);
+		} else {
+			atomic_inc(&alloc_failures);
+		}
 
-		k_fifo_put(&printk_fifo, mem_ptr);
+		u32_t due = k_cycle_get_32() + sleep_cycles;
 
+		thread_stats_sleeping(stats);
 		k_sleep(sleep_ms);
+		thread_stats_woken(stats, due);
 		cnt++;
 	}
 }
@@ -80,12 +133,119 @@ void blink2(void)
 	blink(PORT1, 1000, LED1, 1);
 }
 
+/*
+ * uart_out() formats every message that is waiting into one buffer and
+ * hands the whole buffer to the UART at once, so it wakes up once per
+ * batch instead of once per message.
+ */
+
+/* size of the batch buffer */
+#define BATCH_BUF_SIZE 768
+
+/* longest formatted line */
+#define LINE_MAX 96
+
+static char batch_buf[BATCH_BUF_SIZE];
+
+#ifndef CONFIG_CONSOLE_SHELL
+static volatile size_t tx_len;
+static volatile size_t tx_pos;
+
+K_SEM_DEFINE(tx_done, 0, 1);
+
+static void uart_isr(struct device *dev)
+{
+	uart_irq_update(dev);
+
+	if (!uart_irq_tx_ready(dev)) {
+		return;
+	}
+
+	if (tx_pos < tx_len) {
+		tx_pos += uart_fifo_fill(dev, (const u8_t *)&batch_buf[tx_pos],
+					 tx_len - tx_pos);
+	} else {
+		uart_irq_tx_disable(dev);
+		k_sem_give(&tx_done);
+	}
+}
+#endif
+
+static void batch_send(struct device *uart_dev, size_t len)
+{
+#ifdef CONFIG_CONSOLE_SHELL
+	/* The shell owns the UART interrupt, so go through printk instead. */
+	ARG_UNUSED(uart_dev);
+	batch_buf[len] = '\0';
+	printk("%s", batch_buf);
+#else
+	tx_pos = 0;
+	tx_len = len;
+
+	/* The ISR fills the UART FIFO until the whole batch is out. */
+	uart_irq_tx_enable(uart_dev);
+	thread_stats_sleeping(&uart_out_stats);
+	k_sem_take(&tx_done, K_FOREVER);
+	thread_stats_resumed(&uart_out_stats);
+#endif
+}
+
 void uart_out(void)
 {
+	struct device *uart_dev;
+	u32_t received = 0;
+	u32_t batches = 0;
+
+	uart_dev = device_get_binding(CONFIG_UART_CONSOLE_ON_DEV_NAME);
+	__ASSERT_NO_MSG(uart_dev != NULL);
+
+#ifndef CONFIG_CONSOLE_SHELL
+	uart_irq_callback_set(uart_dev, uart_isr);
+#endif
+
+	thread_stats_register(&uart_out_stats, "uart_out");
+	thread_stats_queue_set(&printk_slab, &high_water);
+	thread_stats_report_period_set(REPORT_PERIOD_S);
+
 	while (1) {
-		struct printk_data_t *rx_data = k_fifo_get(&printk_fifo, K_FOREVER);
-		printk("Toggle USR%d LED: Counter = %d\n", rx_data->led, rx_data->cnt);
-		k_free(rx_data);
+		struct printk_data_t *rx_data;
+		size_t len = 0;
+
+		thread_stats_sleeping(&uart_out_stats);
+		rx_data = k_fifo_get(&printk_fifo, K_FOREVER);
+		thread_stats_woken(&uart_out_stats, rx_data->put_cycles);
+
+		/*
+		 * Drain the FIFO while there is room for another message
+		 * and a statistics line.
+		 */
+		while (rx_data != NULL) {
+			len += snprintk(&batch_buf[len], BATCH_BUF_SIZE - len,
+					"Toggle USR%d LED: Counter = %d\n",
+					rx_data->led, rx_data->cnt);
+			k_mem_slab_free(&printk_slab, (void **)&rx_data);
+
+			if (++received % STATS_INTERVAL == 0) {
+				len += snprintk(&batch_buf[len], BATCH_BUF_SIZE - len,
+						"Message pool: high-water %d/%d, %d allocation failures, %d messages per batch\n",
+						(int)atomic_get(&high_water), MSG_COUNT,
+						(int)atomic_get(&alloc_failures),
+						(int)(received / (batches + 1)));
+			}
+
+			rx_data = NULL;
+			if (BATCH_BUF_SIZE - len >= 2 * LINE_MAX) {
+				rx_data = k_fifo_get(&printk_fifo, K_NO_WAIT);
+			}
+		}
+
+		batch_send(uart_dev, len);
+		batches++;
+
+		/* The UART is idle now, so the report cannot interleave. */
+		if (thread_stats_report_pending()) {
+			thread_stats_report();
+		}
 	}
 }
 
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <init.h>
+#include <kernel_structs.h>
+#include <misc/printk.h>
+#include <misc/stack.h>
+#include <atomic.h>
+#include <stdlib.h>
+
+#ifdef CONFIG_CONSOLE_SHELL
+#include <shell/shell.h>
+#endif
+
+#include "thread_stats.h"
+
+static struct thread_stats *registered[THREAD_STATS_MAX];
+static atomic_t registered_count;
+
+static struct k_mem_slab *queue_slab;
+static atomic_t *queue_high_water;
+
+static s64_t start_ms;
+static u32_t report_period_s;
+static struct k_delayed_work report_work;
+static atomic_t report_due;
+
+int thread_stats_register(struct thread_stats *stats, const char *name)
+{
+	atomic_val_t idx = atomic_inc(&registered_count);
+
+	/* The count stays above the limit; the report clamps it. */
+	if (idx >= THREAD_STATS_MAX) {
+		return -ENOMEM;
+	}
+
+	stats->name = name;
+	stats->tid = k_current_get();
+	stats->run_start = k_cycle_get_32();
+	stats->run_cycles = 0;
+	stats->wakeups = 0;
+	stats->latency_sum = 0;
+	stats->latency_max = 0;
+
+	registered[idx] = stats;
+
+	return 0;
+}
+
+void thread_stats_woken(struct thread_stats *stats, u32_t due)
+{
+	u32_t now = k_cycle_get_32();
+	u32_t latency = now - due;
+
+	/* "due" can be slightly in the future when the wake-up was early. */
+	if ((s32_t)latency < 0) {
+		latency = 0;
+	}
+
+	stats->run_start = now;
+	stats->wakeups++;
+	stats->latency_sum += latency;
+	if (latency > stats->latency_max) {
+		stats->latency_max = latency;
+	}
+}
+
+void thread_stats_sleeping(struct thread_stats *stats)
+{
+	stats->run_cycles += k_cycle_get_32() - stats->run_start;
+}
+
+void thread_stats_resumed(struct thread_stats *stats)
+{
+	stats->run_start = k_cycle_get_32();
+}
+
+void thread_stats_queue_set(struct k_mem_slab *slab, atomic_t *high_water)
+{
+	queue_slab = slab;
+	queue_high_water = high_water;
+}
+
+static u32_t cycles_to_us(u64_t cycles)
+{
+	return (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC);
+}
+
+static size_t stack_unused(k_tid_t tid)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+	return stack_unused_space_get((const char *)tid->stack_info.start,
+				      tid->stack_info.size);
+#else
+	ARG_UNUSED(tid);
+	return 0;
+#endif
+}
+
+static size_t stack_size(k_tid_t tid)
+{
+#ifdef CONFIG_THREAD_STACK_INFO
+	return tid->stack_info.size;
+#else
+	ARG_UNUSED(tid);
+	return 0;
+#endif
+}
+
+void thread_stats_report(void)
+{
+	atomic_val_t count = atomic_get(&registered_count);
+	u32_t elapsed_ms = (u32_t)(k_uptime_get() - start_ms);
+	atomic_val_t i;
+
+	if (count > THREAD_STATS_MAX) {
+		count = THREAD_STATS_MAX;
+	}
+
+	printk("%-10s %7s %8s %9s %9s %11s\n",
+	       "thread", "cpu%", "wakeups", "lat avg", "lat max", "stack");
+
+	for (i = 0; i < count; i++) {
+		const struct thread_stats *s = registered[i];
+
+		/* Counted, but not stored yet by thread_stats_register() */
+		if (s == NULL) {
+			continue;
+		}
+
+		u32_t run_us = cycles_to_us(s->run_cycles);
+		u32_t wakeups = s->wakeups;
+		u32_t lat_avg = wakeups ?
+			cycles_to_us(s->latency_sum / wakeups) : 0;
+		size_t size = stack_size(s->tid);
+		/* run_us / (elapsed_ms * 1000) * 100%, in hundredths */
+		u32_t cpu = elapsed_ms ?
+			(u32_t)((u64_t)run_us * 10 / elapsed_ms) : 0;
+
+		printk("%-10s %4u.%02u %8u %6uus %6uus %5u/%-5u\n",
+		       s->name, cpu / 100, cpu % 100, wakeups,
+		       lat_avg, cycles_to_us(s->latency_max),
+		       (unsigned int)(size - stack_unused(s->tid)),
+		       (unsigned int)size);
+	}
+
+	if (queue_slab != NULL) {
+		printk("queue: %u in use, high-water %u/%u\n",
+		       k_mem_slab_num_used_get(queue_slab),
+		       (unsigned int)atomic_get(queue_high_water),
+		       queue_slab->num_blocks);
+	}
+}
+
+static void report_work_handler(struct k_work *work)
+{
+	atomic_set(&report_due, 1);
+
+	if (report_period_s != 0) {
+		k_delayed_work_submit(&report_work, K_SECONDS(report_period_s));
+	}
+}
+
+void thread_stats_report_period_set(u32_t period_s)
+{
+	static bool initialized;
+
+	if (!initialized) {
+		k_delayed_work_init(&report_work, report_work_handler);
+		initialized = true;
+	}
+
+	report_period_s = period_s;
+	k_delayed_work_cancel(&report_work);
+
+	if (period_s != 0) {
+		k_delayed_work_submit(&report_work, K_SECONDS(period_s));
+	}
+}
+
+bool thread_stats_report_pending(void)
+{
+	return atomic_clear(&report_due) != 0;
+}
+
+#ifdef CONFIG_CONSOLE_SHELL
+static int shell_cmd_report(int argc, char *argv[])
+{
+	thread_stats_report();
+
+	return 0;
+}
+
+static int shell_cmd_period(int argc, char *argv[])
+{
+	if (argc < 2) {
+		printk("Report period: %u s\n", report_period_s);
+		return 0;
+	}
+
+	thread_stats_report_period_set(strtoul(argv[1], NULL, 10));
+
+	return 0;
+}
+
+static struct shell_cmd commands[] = {
+	{ "report", shell_cmd_report, "print the thread statistics" },
+	{ "period", shell_cmd_period,
+	  "<seconds> print the statistics periodically, 0 to stop" },
+	{ NULL, NULL, NULL }
+};
+
+SHELL_REGISTER("stats", commands);
+#endif
+
+static int thread_stats_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	start_ms = k_uptime_get();
+
+	return 0;
+}
+
+SYS_INIT(thread_stats_init, APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
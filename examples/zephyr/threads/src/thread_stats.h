@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef THREAD_STATS_H__
+#define THREAD_STATS_H__
+
+#include <zephyr.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* maximum number of threads that can be registered */
+#define THREAD_STATS_MAX 8
+
+/*
+ * Per-thread counters. A thread owns its own entry and is the only
+ * writer; the reporter only reads it, so no locking is needed beyond
+ * accepting a slightly torn snapshot.
+ */
+struct thread_stats {
+	const char *name;
+	k_tid_t tid;
+	u32_t run_start;	/* cycle count at the last wake-up */
+	u64_t run_cycles;	/* cycles spent between wake-up and sleep */
+	u32_t wakeups;
+	u64_t latency_sum;	/* cycles from "due" to actually running */
+	u32_t latency_max;
+};
+
+/*
+ * Register the calling thread under the given name. Call once from the
+ * thread itself before its main loop.
+ *
+ * @return 0, or -ENOMEM if THREAD_STATS_MAX threads are registered already.
+ */
+int thread_stats_register(struct thread_stats *stats, const char *name);
+
+/*
+ * Record that the thread has started running. @p due is the cycle count
+ * at which it became ready to run (its sleep expired or work was queued
+ * for it), used to compute the wake-to-run latency.
+ */
+void thread_stats_woken(struct thread_stats *stats, u32_t due);
+
+/* Record that the thread is about to sleep or block. */
+void thread_stats_sleeping(struct thread_stats *stats);
+
+/*
+ * Record that the thread is running again after blocking on something
+ * without a deadline, such as its own I/O completing. Unlike
+ * thread_stats_woken() this neither counts a wake-up nor a latency.
+ */
+void thread_stats_resumed(struct thread_stats *stats);
+
+/*
+ * Report the depth of a message queue next to the thread table: the
+ * blocks in use in @p slab and its recorded @p high_water mark are read
+ * on every report.
+ */
+void thread_stats_queue_set(struct k_mem_slab *slab, atomic_t *high_water);
+
+/* Print the statistics of every registered thread. */
+void thread_stats_report(void);
+
+/*
+ * Request a report every @p period_s seconds; 0 stops the reports. The
+ * report is not printed from the timer: the thread that owns the
+ * console polls thread_stats_report_pending() and prints it when the
+ * UART is idle.
+ */
+void thread_stats_report_period_set(u32_t period_s);
+
+/* Return true, once, when a periodic report is due. */
+bool thread_stats_report_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREAD_STATS_H__ */
@@ -0,0 +1,433 @@
+#!/usr/bin/env python3
+"""Measure BLE goodput, round-trip latency and packets per connection event.
+
+The peer is the throughput service of ble_app_blinky built with `make TPUT=1`
+(examples/nrf5-sdk/ble_app_blinky/ble_tput.h) or of the mbed BLE_Throughput
+example. Both have the same characteristics under the base UUID
+7a2f0000-a1c4-4e5b-9f0d-3c6b8e1d2a47: a control point (0002), a data
+characteristic (0003) and the statistics of the current run (0004).
+
+  scan     Lists the advertisers in range.
+  run      Connects and, for every PHY and connection interval asked for,
+           has the peripheral request the link parameters (BlueZ does not let
+           the host choose them), then measures:
+
+             rtt     --echo round trips of an ECHO command, written without
+                     response and answered by notification
+             notify  the peripheral notifies --bytes in notifications of each
+                     --length; goodput is what the host received
+             write   the host writes --bytes without response in each
+                     --length; goodput is what the peripheral received
+
+           Lengths longer than the ATT MTU - 3 that was negotiated are
+           skipped: the ATT MTU is set by the central stack, so a sweep of the
+           ATT payload length stands in for a sweep of the MTU. Packets per
+           connection event come from the peripheral, exactly for
+           notifications and estimated for writes. With --csv every
+           measurement is appended as a row, labelled with --label.
+  compare  Lines up the rows of two CSV files with the same configuration and
+           prints the goodput and latency changes, for regressions between
+           SDK versions.
+
+Requires bleak (pip install bleak) for scan and run.
+
+Usage:
+    ble_bench.py scan
+    ble_bench.py run C3:4F:2A:11:0B:7E --phy 1,2 --interval 7.5,30 --length 20,244 \\
+        --csv results.csv --label sdk-15.2
+    ble_bench.py compare baseline.csv results.csv
+"""
+
+import argparse
+import asyncio
+import csv
+import os
+import struct
+import sys
+import time
+
+BASE_UUID = '7a2f%04x-a1c4-4e5b-9f0d-3c6b8e1d2a47'
+CONTROL_UUID = BASE_UUID % 0x0002
+DATA_UUID = BASE_UUID % 0x0003
+STATS_UUID = BASE_UUID % 0x0004
+
+OP_RESET = 0x01
+OP_NOTIFY = 0x02
+OP_ECHO = 0x03
+OP_LINK = 0x04
+OP_REPLY = 0x80
+
+STATUS = {0: 'success', 1: 'unsupported', 2: 'invalid', 3: 'busy', 4: 'failed'}
+
+STATS_FORMAT = '<8I4H2B'
+STATS_FIELDS = ('rx_bytes', 'rx_packets', 'rx_elapsed_us', 'rx_events',
+                'tx_bytes', 'tx_packets', 'tx_elapsed_us', 'tx_events',
+                'interval', 'slave_latency', 'att_mtu', 'data_length',
+                'tx_phy', 'rx_phy')
+
+PHY_NAMES = {1: '1M', 2: '2M', 4: 'coded'}
+
+CSV_FIELDS = ('label', 'phy', 'interval_ms', 'mode', 'length', 'att_mtu',
+              'data_length', 'tx_phy', 'rx_phy', 'granted_interval_ms',
+              'bytes', 'packets', 'lost', 'elapsed_ms', 'goodput_kbps',
+              'packets_per_event', 'rtt_p50_ms', 'rtt_p90_ms', 'rtt_p99_ms',
+              'rtt_max_ms')
+
+# Columns that identify a configuration in compare.
+KEY_FIELDS = ('phy', 'interval_ms', 'mode', 'length')
+
+
+class BenchError(Exception):
+    pass
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def parse_stats(data):
+    if len(data) < struct.calcsize(STATS_FORMAT):
+        raise BenchError('statistics are %d bytes, expected %d' % (
+            len(data), struct.calcsize(STATS_FORMAT)))
+    return dict(zip(STATS_FIELDS, struct.unpack_from(STATS_FORMAT, data)))
+
+
+def parse_list(text, kind=int):
+    return [kind(v, 0) if kind is int else kind(v) for v in text.split(',') if v]
+
+
+def interval_units(ms):
+    """Connection interval in units of 1.25 ms."""
+    return int(round(ms / 1.25))
+
+
+def link_row(stats):
+    return {
+        'att_mtu': stats['att_mtu'],
+        'data_length': stats['data_length'],
+        'tx_phy': PHY_NAMES.get(stats['tx_phy'], stats['tx_phy']),
+        'rx_phy': PHY_NAMES.get(stats['rx_phy'], stats['rx_phy']),
+        'granted_interval_ms': stats['interval'] * 1.25,
+    }
+
+
+def kbps(nbytes, seconds):
+    return round(nbytes * 8 / seconds / 1000, 1) if seconds > 0 else ''
+
+
+class Peer:
+    """Throughput service of a connected peripheral."""
+
+    def __init__(self, client):
+        self.client = client
+        self.replies = {}
+        self.received = []
+
+    async def start(self):
+        await self.client.start_notify(CONTROL_UUID, self._on_control)
+        await self.client.start_notify(DATA_UUID, self._on_data)
+
+    def _on_control(self, sender, data):
+        if len(data) >= 2 and data[0] & OP_REPLY:
+            future = self.replies.pop(data[0] & ~OP_REPLY, None)
+            if future is not None and not future.done():
+                future.set_result(bytes(data))
+
+    def _on_data(self, sender, data):
+        self.received.append((time.perf_counter(), len(data), data[:4]))
+
+    async def command(self, op, params=b'', response=True, timeout=5.0):
+        future = asyncio.get_running_loop().create_future()
+        self.replies[op] = future
+        await self.client.write_gatt_char(CONTROL_UUID, bytes([op]) + params, response=response)
+        try:
+            reply = await asyncio.wait_for(future, timeout)
+        finally:
+            self.replies.pop(op, None)
+        if reply[1] != 0:
+            raise BenchError('command 0x%02x: %s' % (op, STATUS.get(reply[1], reply[1])))
+        return reply[2:]
+
+    async def stats(self):
+        return parse_stats(await self.client.read_gatt_char(STATS_UUID))
+
+    async def reset(self):
+        await self.command(OP_RESET)
+        self.received = []
+
+    async def link(self, phy, interval, latency=0, settle=10.0):
+        """Requests a PHY and interval and waits for the link to take them."""
+        await self.command(OP_LINK, struct.pack('<BHH', phy, interval, latency))
+        deadline = time.perf_counter() + settle
+        while True:
+            stats = await self.stats()
+            if stats['interval'] == interval and stats['tx_phy'] in (phy, 0):
+                return stats
+            if time.perf_counter() > deadline:
+                return stats
+            await asyncio.sleep(0.5)
+
+    async def rtt(self, count, timeout):
+        samples = []
+        lost = 0
+        for token in range(count):
+            start = time.perf_counter()
+            try:
+                await self.command(OP_ECHO, struct.pack('<I', token), response=False,
+                                   timeout=timeout)
+            except asyncio.TimeoutError:
+                lost += 1
+                continue
+            samples.append((time.perf_counter() - start) * 1000)
+        return samples, lost
+
+    async def notify_run(self, nbytes, length, timeout):
+        await self.reset()
+        await self.command(OP_NOTIFY, struct.pack('<IH', nbytes, length))
+        expected = (nbytes + length - 1) // length
+        last = time.perf_counter()
+        seen = 0
+        while len(self.received) < expected:
+            await asyncio.sleep(0.05)
+            if len(self.received) != seen:
+                seen = len(self.received)
+                last = time.perf_counter()
+            elif time.perf_counter() - last > timeout:
+                break
+        stats = await self.stats()
+
+        received = self.received
+        seqs = {struct.unpack('<I', bytes(r[2]))[0] for r in received if len(r[2]) == 4}
+        total = sum(r[1] for r in received)
+        elapsed = received[-1][0] - received[0][0] if len(received) > 1 else 0
+        # The first notification opens the window, so its bytes are not part of it.
+        window_bytes = total - received[0][1] if received else 0
+        return {
+            'bytes': total,
+            'packets': len(received),
+            'lost': expected - len(seqs),
+            'elapsed_ms': round(elapsed * 1000, 1),
+            'goodput_kbps': kbps(window_bytes, elapsed),
+            'packets_per_event': (round(stats['tx_packets'] / stats['tx_events'], 2)
+                                  if stats['tx_events'] else ''),
+        }, stats
+
+    async def write_run(self, nbytes, length, timeout):
+        await self.reset()
+        payload = bytes(i & 0xFF for i in range(length))
+        sent = 0
+        packets = 0
+        while sent < nbytes:
+            chunk = payload[:min(length, nbytes - sent)]
+            await self.client.write_gatt_char(DATA_UUID, chunk, response=False)
+            sent += len(chunk)
+            packets += 1
+
+        # Writes without response may still be queued in the host stack.
+        deadline = time.perf_counter() + timeout
+        while True:
+            stats = await self.stats()
+            if stats['rx_packets'] >= packets or time.perf_counter() > deadline:
+                break
+            await asyncio.sleep(0.2)
+
+        elapsed = stats['rx_elapsed_us'] / 1e6
+        window_bytes = stats['rx_bytes'] - min(length, stats['rx_bytes'])
+        return {
+            'bytes': stats['rx_bytes'],
+            'packets': stats['rx_packets'],
+            'lost': packets - stats['rx_packets'],
+            'elapsed_ms': round(elapsed * 1000, 1),
+            'goodput_kbps': kbps(window_bytes, elapsed),
+            'packets_per_event': (round(stats['rx_packets'] / stats['rx_events'], 2)
+                                  if stats['rx_events'] else ''),
+        }, stats
+
+
+def print_row(row):
+    rtt = ''
+    if row['rtt_p50_ms'] != '':
+        rtt = '  rtt p50 %s p90 %s p99 %s ms' % (row['rtt_p50_ms'], row['rtt_p90_ms'],
+                                                 row['rtt_p99_ms'])
+    print('%-3s %6s ms %-6s %3d B: %8s kbit/s  %5s pkt/event  %d lost%s' % (
+        row['phy'], row['interval_ms'], row['mode'], row['length'], row['goodput_kbps'],
+        row['packets_per_event'], row['lost'], rtt))
+
+
+def write_csv(path, rows):
+    new = not os.path.exists(path) or os.path.getsize(path) == 0
+    with open(path, 'a', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+        if new:
+            writer.writeheader()
+        writer.writerows(rows)
+
+
+async def run_async(args):
+    from bleak import BleakClient
+
+    rows = []
+    async with BleakClient(args.address, timeout=args.timeout * 4) as client:
+        peer = Peer(client)
+        await peer.start()
+
+        for phy in args.phy:
+            for interval_ms in args.interval:
+                try:
+                    stats = await peer.link(phy, interval_units(interval_ms), args.latency)
+                except BenchError as e:
+                    print('%s %s ms: link refused, %s' % (PHY_NAMES.get(phy, phy), interval_ms, e))
+                    continue
+                if stats['interval'] != interval_units(interval_ms):
+                    print('%s %s ms: got %.2f ms' % (PHY_NAMES.get(phy, phy), interval_ms,
+                                                     stats['interval'] * 1.25))
+
+                base = {'label': args.label, 'phy': PHY_NAMES.get(phy, phy),
+                        'interval_ms': interval_ms}
+                base.update(link_row(stats))
+
+                rtt = {}
+                if args.echo:
+                    samples, lost = await peer.rtt(args.echo, args.timeout)
+                    if samples:
+                        rtt = {'rtt_p50_ms': round(percentile(samples, 50), 1),
+                               'rtt_p90_ms': round(percentile(samples, 90), 1),
+                               'rtt_p99_ms': round(percentile(samples, 99), 1),
+                               'rtt_max_ms': round(max(samples), 1)}
+                    row = dict.fromkeys(CSV_FIELDS, '')
+                    row.update(base)
+                    row.update(rtt)
+                    row.update({'mode': 'rtt', 'length': 5, 'packets': len(samples),
+                                'lost': lost})
+                    rows.append(row)
+                    print_row(row)
+
+                for mode in args.mode:
+                    for length in args.length:
+                        if length > stats['att_mtu'] - 3:
+                            continue
+                        run = peer.notify_run if mode == 'notify' else peer.write_run
+                        try:
+                            result, after = await run(args.bytes, length, args.timeout)
+                        except BenchError as e:
+                            print('%s %d B: %s' % (mode, length, e))
+                            continue
+                        row = dict.fromkeys(CSV_FIELDS, '')
+                        row.update(base)
+                        row.update(link_row(after))
+                        row.update(result)
+                        row.update({'mode': mode, 'length': length})
+                        rows.append(row)
+                        print_row(row)
+
+    if args.csv and rows:
+        write_csv(args.csv, rows)
+        print('%d rows appended to %s' % (len(rows), args.csv))
+    return 0 if rows else 1
+
+
+def run(args):
+    for mode in args.mode:
+        if mode not in ('notify', 'write'):
+            sys.exit('--mode takes notify and write')
+    if min(args.length) < 4:
+        sys.exit('--length must be at least 4, for the sequence number')
+    return asyncio.run(run_async(args))
+
+
+def scan(args):
+    from bleak import BleakScanner
+
+    devices = asyncio.run(BleakScanner.discover(timeout=args.timeout))
+    for device in devices:
+        print('%s  %s' % (device.address, device.name or ''))
+    return 0
+
+
+def read_rows(path):
+    with open(path, newline='') as f:
+        return list(csv.DictReader(f))
+
+
+def compare(args):
+    def key(row):
+        return tuple(row[k] for k in KEY_FIELDS)
+
+    def number(value):
+        try:
+            return float(value)
+        except (TypeError, ValueError):
+            return None
+
+    base = {}
+    for row in read_rows(args.baseline):
+        base[key(row)] = row    # the last run of a configuration counts
+
+    regressions = 0
+    print('%-5s %8s %-6s %6s  %-22s %-22s' % ('phy', 'interval', 'mode', 'length',
+                                              'goodput kbit/s', 'rtt p90 ms'))
+    for row in read_rows(args.results):
+        old = base.get(key(row))
+        if old is None:
+            continue
+        cells = []
+        for field, higher_is_better in (('goodput_kbps', True), ('rtt_p90_ms', False)):
+            a, b = number(old[field]), number(row[field])
+            if a is None or b is None:
+                cells.append('')
+                continue
+            change = (b - a) / a * 100 if a else 0
+            worse = (change < -args.threshold) if higher_is_better else (change > args.threshold)
+            regressions += worse
+            cells.append('%.1f -> %.1f %+.0f%%%s' % (a, b, change, ' !' if worse else ''))
+        print('%-5s %8s %-6s %6s  %-22s %-22s' % (row['phy'], row['interval_ms'], row['mode'],
+                                                  row['length'], cells[0], cells[1]))
+
+    if regressions:
+        print('%d regressions beyond %.0f%%' % (regressions, args.threshold))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('scan', help='list the advertisers in range')
+    p.add_argument('--timeout', type=float, default=5.0)
+    p.set_defaults(func=scan)
+
+    p = sub.add_parser('run', help='sweep the link parameters and measure')
+    p.add_argument('address')
+    p.add_argument('--phy', type=parse_list, default=[1, 2],
+                   help='PHYs to sweep, 1 for 1M and 2 for 2M (default 1,2)')
+    p.add_argument('--interval', type=lambda s: parse_list(s, float), default=[7.5, 15, 30, 50],
+                   help='connection intervals in ms (default 7.5,15,30,50)')
+    p.add_argument('--latency', type=int, default=0, help='slave latency to request')
+    p.add_argument('--mode', type=lambda s: s.split(','), default=['notify', 'write'])
+    p.add_argument('--length', type=parse_list, default=[20, 64, 128, 182, 244],
+                   help='ATT payload lengths (default 20,64,128,182,244)')
+    p.add_argument('--bytes', type=int, default=50000, help='bytes per measurement')
+    p.add_argument('--echo', type=int, default=50, help='round trips per link, 0 to skip')
+    p.add_argument('--timeout', type=float, default=3.0)
+    p.add_argument('--csv', help='append the results to this CSV file')
+    p.add_argument('--label', default='', help='label of the rows, e.g. the SDK version')
+    p.set_defaults(func=run)
+
+    p = sub.add_parser('compare', help='compare two CSV files of results')
+    p.add_argument('baseline')
+    p.add_argument('results')
+    p.add_argument('--threshold', type=float, default=10.0,
+                   help='change in percent reported as a regression (default 10)')
+    p.set_defaults(func=compare)
+
+    args = parser.parse_args()
+    try:
+        sys.exit(args.func(args) or 0)
+    except BenchError as e:
+        sys.exit(str(e))
+
+
+if __name__ == '__main__':
+    main()
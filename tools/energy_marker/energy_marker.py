@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""Charge and energy per operation from a capture of the energy markers.
+
+The firmware side is examples/nrf5-sdk/common/energy_marker.h, built in with
+`make ENERGY=1` (saadc, flash_fds and ble_app_hrs are instrumented). Wire the
+markers to the digital inputs of the capture:
+
+  P0.14        radio marker, high from RADIO READY to DISABLED (driven by PPI)
+  P0.15-P0.17  phase ID, P0.15 its least significant bit
+
+Phase IDs are those of energy_phase_t: 1 saadc, 2 fds_write, 3 notify,
+4 sleep, 5-7 free for the application (name them with --names). ID 0 is
+code that marks no phase.
+
+The input is a CSV export with a time column, optionally a current column,
+and the digital channels:
+
+  Power Profiler Kit II   Timestamp(ms),Current(uA),D0-D7 with the channels
+                          as a string of bits, D0 first
+  Logic analyzer          Time [s],D0,D1,... or Channel 0,Channel 1,...
+                          (sigrok-cli -O csv:time=true, Saleae export);
+                          durations only
+
+The units of time and current are read from the column titles. A
+sample counts from its time to the time of the next one. Samples with the
+radio marker high are counted as radio, whatever the phase. Phase changes
+shorter than --glitch are dropped, as they are the firmware's two stores
+setting an ID. An outer phase, such as sleep, that resumes after an inner
+one ends is counted again.
+
+Usage:
+    energy_marker.py ppk2_export.csv
+    energy_marker.py capture.csv --radio-ch 0 --id-ch 1,2,3 --voltage 3.0 \\
+        --names 5=adv_update --csv energy.csv
+"""
+
+import argparse
+import csv
+import re
+import sys
+
+PHASES = {0: 'none', 1: 'saadc', 2: 'fds_write', 3: 'notify', 4: 'sleep',
+          5: 'app_1', 6: 'app_2', 7: 'app_3'}
+
+TIME_UNITS = {'s': 1.0, 'ms': 1e-3, 'us': 1e-6, 'µs': 1e-6, 'ns': 1e-9}
+CURRENT_UNITS = {'a': 1.0, 'ma': 1e-3, 'ua': 1e-6, 'µa': 1e-6, 'na': 1e-9}
+
+UNIT_RE = re.compile(r'[\(\[]\s*([^\)\]]+?)\s*[\)\]]')
+CHANNEL_RE = re.compile(r'^(?:d|ch|channel)\s*(\d+)$')
+BITS_RE = re.compile(r'^d(\d+)\s*-\s*d(\d+)$')
+
+
+class CaptureError(Exception):
+    pass
+
+
+def parse_list(text):
+    return [int(x) for x in text.split(',') if x]
+
+
+def parse_names(text):
+    names = {}
+    for item in text.split(','):
+        phase, _, name = item.partition('=')
+        names[int(phase)] = name
+    return names
+
+
+def column_unit(title, units):
+    m = UNIT_RE.search(title)
+    if m:
+        return units.get(m.group(1).lower())
+    return None
+
+
+class Layout:
+    """Where the time, current and digital channels are in the rows of an export."""
+
+    def __init__(self, header):
+        self.time = None
+        self.time_scale = 1.0
+        self.current = None
+        self.current_scale = 1e-6
+        self.bits = None            # (column, first channel) of a PPK bit string
+        self.channels = {}          # channel -> column
+
+        for col, title in enumerate(header):
+            name = UNIT_RE.sub('', title).strip().lower()
+            if self.time is None and 'time' in name:
+                self.time = col
+                self.time_scale = column_unit(title, TIME_UNITS) or 1.0
+            elif self.current is None and 'current' in name:
+                self.current = col
+                self.current_scale = column_unit(title, CURRENT_UNITS) or 1e-6
+            elif BITS_RE.match(name):
+                self.bits = (col, int(BITS_RE.match(name).group(1)))
+            elif CHANNEL_RE.match(name):
+                self.channels[int(CHANNEL_RE.match(name).group(1))] = col
+
+        if self.time is None:
+            raise CaptureError('no time column in the header: %s' % ','.join(header))
+        if self.bits is None and not self.channels:
+            raise CaptureError('no digital channels in the header: %s' % ','.join(header))
+
+    def channel_reader(self, channel):
+        if self.bits is not None:
+            col, first = self.bits
+            return lambda row: row[col][channel - first] == '1'
+        if channel not in self.channels:
+            raise CaptureError('no column for digital channel %d' % channel)
+        col = self.channels[channel]
+        return lambda row: float(row[col]) != 0
+
+
+def read_samples(path, radio_ch, id_ch):
+    """(time s, current A or None, radio, phase ID) of every sample of the export."""
+    with open(path, newline='', errors='replace') as f:
+        reader = csv.reader(f)
+        layout = None
+        for row in reader:
+            if not row or row[0].startswith(';'):
+                continue
+            if layout is None:
+                layout = Layout(row)
+                radio = layout.channel_reader(radio_ch) if radio_ch >= 0 else (lambda row: False)
+                ids = [layout.channel_reader(ch) for ch in id_ch]
+                continue
+            try:
+                t = float(row[layout.time]) * layout.time_scale
+                i = None
+                if layout.current is not None:
+                    i = float(row[layout.current]) * layout.current_scale
+                phase = 0
+                for bit, read in enumerate(ids):
+                    if read(row):
+                        phase |= 1 << bit
+                yield t, i, radio(row), phase
+            except (ValueError, IndexError):
+                continue
+
+
+def segments(samples):
+    """Runs of samples with the same radio state and phase: [key, start, end, charge C or None].
+
+    The key is 'radio' or the phase ID. A sample lasts until the next one starts.
+    """
+    result = []
+    prev = None
+    for t, i, radio, phase in samples:
+        if prev is not None:
+            pt, pi, pkey = prev
+            if result and result[-1][0] == pkey and result[-1][2] == pt:
+                seg = result[-1]
+            else:
+                seg = [pkey, pt, pt, 0.0 if pi is not None else None]
+                result.append(seg)
+            seg[2] = t
+            if seg[3] is not None and pi is not None:
+                seg[3] += pi * (t - pt)
+        prev = (t, i, 'radio' if radio else phase)
+    return result
+
+
+def deglitch(segs, glitch):
+    """Merge phase segments shorter than glitch into the next one, then join equal neighbours."""
+    result = []
+    pending = None
+    for n, seg in enumerate(segs):
+        seg = list(seg)
+        if pending is not None:
+            seg[1] = pending[1]
+            if seg[3] is not None:
+                seg[3] += pending[3]
+            pending = None
+        if seg[0] != 'radio' and seg[2] - seg[1] < glitch and n < len(segs) - 1:
+            pending = seg
+            continue
+        if result and result[-1][0] == seg[0]:
+            result[-1][2] = seg[2]
+            if seg[3] is not None:
+                result[-1][3] += seg[3]
+        else:
+            result.append(seg)
+    return result
+
+
+def summarize(segs, voltage, names):
+    """One row per phase and for the radio, and the total."""
+    stats = {}
+    for key, start, end, charge in segs:
+        s = stats.setdefault(key, {'count': 0, 'time': 0.0, 'charge': None})
+        s['count'] += 1
+        s['time'] += end - start
+        if charge is not None:
+            s['charge'] = (s['charge'] or 0.0) + charge
+
+    total_time = sum(s['time'] for s in stats.values())
+    has_current = any(s['charge'] is not None for s in stats.values())
+    total_charge = sum(s['charge'] or 0.0 for s in stats.values())
+
+    order = sorted((k for k in stats if k != 'radio'), key=int) + \
+        (['radio'] if 'radio' in stats else [])
+    rows = []
+    for key in order:
+        s = stats[key]
+        row = {
+            'phase': 'radio' if key == 'radio' else names.get(key, 'id_%d' % key),
+            'count': s['count'],
+            'mean_us': s['time'] / s['count'] * 1e6,
+            'time_pct': s['time'] / total_time * 100 if total_time else 0.0,
+        }
+        if has_current:
+            charge = s['charge'] or 0.0
+            row['mean_ua'] = charge / s['time'] * 1e6 if s['time'] else 0.0
+            row['uc_per_op'] = charge / s['count'] * 1e6
+            row['uj_per_op'] = charge * voltage / s['count'] * 1e6
+            row['energy_pct'] = charge / total_charge * 100 if total_charge else 0.0
+        rows.append(row)
+
+    total = {'phase': 'total', 'count': sum(s['count'] for s in stats.values()),
+             'time_s': total_time}
+    if has_current:
+        total['mean_ua'] = total_charge / total_time * 1e6 if total_time else 0.0
+        total['uj'] = total_charge * voltage * 1e6
+    return rows, total
+
+
+COLUMNS = (
+    ('phase', 'phase', '%s'),
+    ('count', 'count', '%d'),
+    ('mean_us', 'mean us', '%.1f'),
+    ('time_pct', 'time %', '%.1f'),
+    ('mean_ua', 'mean uA', '%.1f'),
+    ('uc_per_op', 'uC/op', '%.3f'),
+    ('uj_per_op', 'uJ/op', '%.3f'),
+    ('energy_pct', 'energy %', '%.1f'),
+)
+
+
+def print_table(rows):
+    columns = [c for c in COLUMNS if any(c[0] in r for r in rows)]
+    table = [[title for _, title, _ in columns]]
+    for r in rows:
+        table.append([fmt % r[key] if key in r else '-' for key, _, fmt in columns])
+    widths = [max(len(r[i]) for r in table) for i in range(len(columns))]
+    for row in table:
+        print('  '.join(v.rjust(w) if i else v.ljust(w)
+                        for i, (v, w) in enumerate(zip(row, widths))))
+
+
+def write_csv(path, rows):
+    keys = [key for key, _, _ in COLUMNS if any(key in r for r in rows)]
+    with open(path, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=keys, extrasaction='ignore')
+        writer.writeheader()
+        for r in rows:
+            writer.writerow({k: ('%.6g' % r[k] if isinstance(r[k], float) else r[k])
+                             for k in keys if k in r})
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('capture', help='CSV export of the current and the markers')
+    parser.add_argument('--radio-ch', type=int, default=0,
+                        help='digital channel of the radio marker, -1 if not captured (default 0)')
+    parser.add_argument('--id-ch', type=parse_list, default=[1, 2, 3],
+                        help='digital channels of the phase ID, least significant first (default 1,2,3)')
+    parser.add_argument('--voltage', type=float, default=3.0,
+                        help='supply voltage for the energy, in V (default 3.0)')
+    parser.add_argument('--glitch', type=float, default=1.0,
+                        help='phase changes shorter than this are dropped, in us (default 1)')
+    parser.add_argument('--names', type=parse_names, default={},
+                        help='names of phase IDs, e.g. 5=adv_update,6=crypto')
+    parser.add_argument('--csv', help='also write the table to this CSV file')
+    args = parser.parse_args()
+
+    names = dict(PHASES)
+    names.update(args.names)
+
+    try:
+        segs = segments(read_samples(args.capture, args.radio_ch, args.id_ch))
+    except CaptureError as e:
+        sys.exit('%s: %s' % (args.capture, e))
+    if not segs:
+        sys.exit('%s: no samples' % args.capture)
+
+    rows, total = summarize(deglitch(segs, args.glitch * 1e-6), args.voltage, names)
+    print_table(rows)
+    line = '%.3f s captured' % total['time_s']
+    if 'uj' in total:
+        line += ', %.1f uA mean, %.1f uJ at %.2f V' % (total['mean_ua'], total['uj'], args.voltage)
+    print(line)
+
+    if args.csv:
+        write_csv(args.csv, rows)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Measure UDP round-trip latency and goodput to the Zephyr IPSP sample.
+
+The sample (examples/zephyr/bluetooth/ipsp) runs two UDP servers over the
+IPSP L2CAP channel:
+
+  port 4242  echoes every datagram back unchanged
+  port 4243  counts datagrams until an empty one ends the run, then answers
+             with the datagrams, bytes and milliseconds it saw (3 x u32 LE)
+
+  rtt      Sends --count datagrams of --size bytes to the echo server one at
+           a time and prints the round-trip percentiles.
+  goodput  Sends to the sink for --seconds at up to --rate datagrams per
+           second (0 for as fast as the host can) and prints the offered
+           rate and the goodput the node actually received.
+
+Connect the node first with the Linux 6LoWPAN module, for instance:
+
+    echo 1 > /sys/kernel/debug/bluetooth/6lowpan_enable
+    echo "connect <node address> 2" > /sys/kernel/debug/bluetooth/6lowpan_control
+
+Usage:
+    ipsp_bench.py rtt fe80::<node>%bt0 --size 64 --count 200
+    ipsp_bench.py goodput fe80::<node>%bt0 --size 1232 --seconds 10
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+ECHO_PORT = 4242
+SINK_PORT = 4243
+PAYLOAD_MAX = 1232          # 1280-byte IPSP SDU - IPv6 - UDP headers
+
+
+def address(host, port):
+    return socket.getaddrinfo(host, port, socket.AF_INET6, socket.SOCK_DGRAM)[0][4]
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def rtt(args):
+    sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    peer = address(args.host, ECHO_PORT)
+    samples = []
+    lost = 0
+
+    for seq in range(args.count):
+        payload = struct.pack('<I', seq) + bytes(args.size - 4)
+        start = time.perf_counter()
+        sock.sendto(payload, peer)
+        try:
+            while True:
+                data, _ = sock.recvfrom(PAYLOAD_MAX)
+                if data[:4] == payload[:4]:
+                    break
+        except socket.timeout:
+            lost += 1
+            continue
+        samples.append((time.perf_counter() - start) * 1000)
+
+    if not samples:
+        sys.exit('no reply from %s' % args.host)
+
+    print('%d bytes: %d replies, %d lost' % (args.size, len(samples), lost))
+    print('rtt ms: min %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f' % (
+        min(samples), percentile(samples, 50), percentile(samples, 90),
+        percentile(samples, 99), max(samples)))
+
+
+def goodput(args):
+    sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+    peer = address(args.host, SINK_PORT)
+    payload = bytes(args.size)
+    gap = 1.0 / args.rate if args.rate else 0
+    sent = 0
+
+    start = time.perf_counter()
+    end = start + args.seconds
+    next_send = start
+    while time.perf_counter() < end:
+        try:
+            sock.sendto(payload, peer)
+            sent += 1
+        except BlockingIOError:
+            pass
+        if gap:
+            next_send += gap
+            delay = next_send - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+    elapsed = time.perf_counter() - start
+
+    # Let the queued datagrams drain before ending the run.
+    time.sleep(args.timeout)
+    sock.settimeout(args.timeout)
+    for _ in range(3):
+        sock.sendto(b'', peer)
+        try:
+            data, _ = sock.recvfrom(64)
+            break
+        except socket.timeout:
+            continue
+    else:
+        sys.exit('no report from %s' % args.host)
+
+    datagrams, received, elapsed_ms = struct.unpack('<III', data[:12])
+    print('offered: %d datagrams of %d bytes, %.1f kbit/s' % (
+        sent, args.size, sent * args.size * 8 / elapsed / 1000))
+    if elapsed_ms:
+        print('goodput: %d datagrams (%.1f%%), %.1f kbit/s' % (
+            datagrams, 100.0 * datagrams / max(sent, 1),
+            received * 8 / elapsed_ms))
+    else:
+        print('goodput: %d datagrams received' % datagrams)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('rtt', help='round-trip latency through the echo server')
+    p.add_argument('host')
+    p.add_argument('--size', type=int, default=64)
+    p.add_argument('--count', type=int, default=100)
+    p.add_argument('--timeout', type=float, default=1.0)
+    p.set_defaults(func=rtt)
+
+    p = sub.add_parser('goodput', help='received throughput at the sink')
+    p.add_argument('host')
+    p.add_argument('--size', type=int, default=PAYLOAD_MAX)
+    p.add_argument('--seconds', type=float, default=10.0)
+    p.add_argument('--rate', type=float, default=0, help='datagrams per second, 0 for unpaced')
+    p.add_argument('--timeout', type=float, default=1.0)
+    p.set_defaults(func=goodput)
+
+    args = parser.parse_args()
+    if not 4 <= args.size <= PAYLOAD_MAX:
+        parser.error('--size must be between 4 and %d' % PAYLOAD_MAX)
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
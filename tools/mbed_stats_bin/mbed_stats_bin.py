@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Decode the system report frames streamed by the mbed blinky example (stats_stream.h).
+
+Full frames carry every field; delta frames only the fields and thread entries
+that changed, so the decoder keeps the last known value of each. Thread names
+are sent as addresses and are resolved from the ELF file when one is given.
+
+Usage:
+    mbed_stats_bin.py capture.bin
+    mbed_stats_bin.py --serial /dev/ttyACM0 --baud 115200 --elf BUILD/NRF52832_MDK/GCC_ARM/blinky.elf
+    JLinkSWOViewerCL -device NRF52832_XXAA -itmport 0 | mbed_stats_bin.py
+
+Requires pyserial for --serial and pyelftools for --elf.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = 0xA5
+KIND_FULL = 0x12
+KIND_DELTA = 0x13
+HEADER_SIZE = 4
+
+FIELDS = ('period_us', 'idle_us', 'sleep_us', 'deep_sleep_us',
+          'heap_current', 'heap_max', 'heap_alloc_count', 'heap_alloc_fails', 'thread_count',
+          'deep_sleep_locked')
+THREAD = struct.Struct('<IIBBHH')
+
+# rtx thread states, as reported by mbed_stats_thread_get_each.
+STATES = {0: 'inactive', 1: 'ready', 2: 'running', 3: 'blocked', 4: 'terminated'}
+
+
+class Names:
+    """Thread name lookup in the loadable sections of an ELF file."""
+
+    def __init__(self, path=None):
+        self._segments = []
+        if path is None:
+            return
+        from elftools.elf.elffile import ELFFile
+        with open(path, 'rb') as f:
+            for section in ELFFile(f).iter_sections():
+                if section['sh_type'] == 'SHT_PROGBITS' and section['sh_addr']:
+                    self._segments.append((section['sh_addr'], section.data()))
+
+    def get(self, addr):
+        for base, data in self._segments:
+            if base <= addr < base + len(data):
+                end = data.find(b'\0', addr - base)
+                return data[addr - base:end].decode('ascii', 'replace')
+        return '0x%08x' % addr
+
+
+class State:
+    def __init__(self):
+        self.fields = None
+        self.threads = []
+
+    def apply(self, kind, payload):
+        """Update from one frame; returns False if a delta arrives before any full frame."""
+        if kind == KIND_FULL:
+            self.fields = list(struct.unpack_from('<%dI' % len(FIELDS), payload))
+            offset = 4 * len(FIELDS)
+            self.threads = [THREAD.unpack_from(payload, offset + i * THREAD.size)
+                            for i in range(self.fields[FIELDS.index('thread_count')])]
+            return True
+
+        if self.fields is None:
+            return False
+        field_mask, = struct.unpack_from('<H', payload)
+        offset = 2
+        for i in range(len(FIELDS)):
+            if field_mask & (1 << i):
+                self.fields[i], = struct.unpack_from('<I', payload, offset)
+                offset += 4
+        thread_mask = payload[offset]
+        offset += 1
+        for i in range(len(self.threads)):
+            if thread_mask & (1 << i):
+                self.threads[i] = THREAD.unpack_from(payload, offset)
+                offset += THREAD.size
+        return True
+
+
+def render(state, names, sequence):
+    f = dict(zip(FIELDS, state.fields))
+    idle = 100.0 * f['idle_us'] / f['period_us'] if f['period_us'] else 0.0
+    lines = ['#%03d cpu usage %5.1f%% (idle %d sleep %d deep %d us of %d) heap %d/%d allocs %d fails %d' % (
+        sequence, 100.0 - idle, f['idle_us'], f['sleep_us'], f['deep_sleep_us'], f['period_us'],
+        f['heap_current'], f['heap_max'], f['heap_alloc_count'], f['heap_alloc_fails'])]
+    if f['deep_sleep_locked']:
+        lines[0] += ' deep sleep locked for %d samples' % f['deep_sleep_locked']
+    for tid, name, st, prio, size, space in state.threads:
+        lines.append('     %-16s 0x%08x %-10s prio %3d stack %5d/%5d used' % (
+            names.get(name), tid, STATES.get(st, st), prio, size - space, size))
+    return '\n'.join(lines)
+
+
+def decode(stream, out, names, follow=False):
+    read = getattr(stream, 'read1', stream.read)
+    state = State()
+    buf = bytearray()
+    while True:
+        chunk = read(256)
+        if not chunk:
+            if follow:
+                continue
+            break
+        buf += chunk
+        while True:
+            start = buf.find(bytes([SYNC]))
+            if start < 0:
+                buf.clear()
+                break
+            del buf[:start]
+            if len(buf) < HEADER_SIZE:
+                break
+            total = HEADER_SIZE + buf[2] + 1
+            if len(buf) < total:
+                break
+            frame = bytes(buf[:total])
+            if sum(frame) & 0xFF or frame[1] not in (KIND_FULL, KIND_DELTA):
+                # Not a frame boundary, e.g. the text printed at boot: resynchronise.
+                del buf[:1]
+                continue
+            del buf[:total]
+            if state.apply(frame[1], frame[HEADER_SIZE:-1]):
+                out.write(render(state, names, frame[3]) + '\n')
+                out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('input', nargs='?', help='binary capture; standard input if omitted')
+    parser.add_argument('--elf', help='ELF file of the running firmware, to resolve thread names')
+    parser.add_argument('--serial', help='read frames from this serial port instead')
+    parser.add_argument('--baud', type=int, default=115200)
+    opts = parser.parse_args()
+
+    names = Names(opts.elf)
+    if opts.serial:
+        import serial
+        stream = serial.Serial(opts.serial, opts.baud, timeout=0.1)
+    elif opts.input:
+        stream = open(opts.input, 'rb')
+    else:
+        stream = sys.stdin.buffer
+    try:
+        decode(stream, sys.stdout, names, follow=bool(opts.serial))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,471 @@
+#!/usr/bin/env python3
+"""Make and check delta images of an nRF5 SDK application against a base release.
+
+A delta rebuilds the new application from the base one already in flash, so
+a release that changes a few kB ships as little more than those kB. Both
+images are taken from Intel HEX files: the armgcc output or the merged
+hex/*.hex of a release, of which only the application region is used (from
+--start, the FLASH origin of the linker scripts, up to the last byte of the
+image below the bootloader).
+
+The delta is built page by page (4 kB, the flash page of the nRF52832), so
+the device can rebuild one page in RAM, check it against the page CRC of the
+delta, write it to a scratch bank and read it back before going on to the
+next one (examples/nrf5-sdk/common/delta_apply.c). Before anything is written
+the CRC of the base in flash is checked against the one the delta was made
+for.
+
+Format, little endian:
+
+    header   magic "NDLT", version, log2(page size), 2 reserved bytes,
+             start address, base size, base CRC32, new size, new CRC32,
+             body size, body CRC32, header CRC32 (of the 36 bytes before it)
+    body     for each page of the new image: operations that fill exactly
+             that page, then the CRC32 of the page
+
+    0x01 COPY   offset, length              bytes copied from the base
+    0x02 PATCH  offset, length, count,      bytes copied from the base, with
+                count x (gap, byte)         single bytes replaced
+    0x03 LIT    length, bytes               bytes given in full
+    0x04 FILL   length, byte                one byte repeated
+
+Offsets are from the start of the base image, gaps from the previous
+replaced byte (or the start of the operation); numbers are LEB128.
+Operations never cross a page boundary. PATCH is what keeps the delta small
+when code moves: the moved code differs from the base only in the few bytes
+of its branch and literal pool offsets.
+
+Usage:
+    nrf_delta.py make hex/app_s132.hex _build/nrf52832_xxaa.hex -o _build/nrf52832_xxaa.delta
+    nrf_delta.py info _build/nrf52832_xxaa.delta
+    nrf_delta.py apply hex/app_s132.hex _build/nrf52832_xxaa.delta -o new.hex
+    nrf_delta.py check hex/app_s132.hex _build/nrf52832_xxaa.hex _build/nrf52832_xxaa.delta
+"""
+
+import argparse
+import collections
+import struct
+import sys
+import zlib
+
+MAGIC = b'NDLT'
+VERSION = 1
+PAGE_SHIFT = 12
+PAGE_SIZE = 1 << PAGE_SHIFT
+HEADER = struct.Struct('<4sBBH8I')
+
+APP_START = 0x26000         # FLASH origin with S132 6.1
+APP_END = 0x78000           # start of the bootloader, if there is one
+
+OP_COPY = 0x01
+OP_PATCH = 0x02
+OP_LIT = 0x03
+OP_FILL = 0x04
+
+SEED = 8                    # bytes that must match exactly to start a copy
+MIN_COPY = 12               # shortest copy worth an operation
+MAX_CANDIDATES = 32         # seed positions tried, most recent first
+WINDOW = 32                 # a patched copy ends when more than
+WINDOW_MISMATCHES = 4       # this many bytes of the last WINDOW differ
+MIN_FILL = 16
+
+
+def crc32(data):
+    return zlib.crc32(data) & 0xFFFFFFFF
+
+
+def read_hex(path, start, end):
+    """Bytes of an Intel HEX file from start up to its last byte below end, gaps as 0xFF."""
+    image = {}
+    base = 0
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            if not line.startswith(':'):
+                sys.exit('%s:%d: not an Intel HEX record' % (path, number))
+            record = bytes.fromhex(line[1:])
+            if sum(record) & 0xFF:
+                sys.exit('%s:%d: bad checksum' % (path, number))
+            count, address, kind = record[0], (record[1] << 8) | record[2], record[3]
+            payload = record[4:4 + count]
+            if kind == 0x00:
+                for i, b in enumerate(payload):
+                    image[base + address + i] = b
+            elif kind == 0x01:
+                break
+            elif kind == 0x02:
+                base = int.from_bytes(payload, 'big') << 4
+            elif kind == 0x04:
+                base = int.from_bytes(payload, 'big') << 16
+    addresses = [a for a in image if start <= a < end]
+    if not addresses:
+        sys.exit('%s: no data from 0x%08x' % (path, start))
+    data = bytearray(b'\xff' * (max(addresses) + 1 - start))
+    for a in addresses:
+        data[a - start] = image[a]
+    return bytes(data)
+
+
+def write_hex(path, start, data):
+    with open(path, 'w') as f:
+        upper = None
+        for offset in range(0, len(data), 16):
+            address = start + offset
+            if address >> 16 != upper:
+                upper = address >> 16
+                record = bytes((2, 0, 0, 4)) + upper.to_bytes(2, 'big')
+                f.write(':%s%02X\n' % (record.hex().upper(), -sum(record) & 0xFF))
+            chunk = data[offset:offset + 16]
+            record = bytes((len(chunk), (address >> 8) & 0xFF, address & 0xFF, 0)) + chunk
+            f.write(':%s%02X\n' % (record.hex().upper(), -sum(record) & 0xFF))
+        f.write(':00000001FF\n')
+
+
+def leb128(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+class Reader:
+    def __init__(self, data, pos=0):
+        self.data = data
+        self.pos = pos
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise ValueError('delta truncated')
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def number(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            if not byte & 0x80:
+                return value
+            shift += 7
+            if shift > 28:
+                raise ValueError('number too long')
+
+    def take(self, count):
+        if self.pos + count > len(self.data):
+            raise ValueError('delta truncated')
+        self.pos += count
+        return self.data[self.pos - count:self.pos]
+
+
+# Building. Operations are (kind, destination, length, argument) over the
+# whole image, and are split at page boundaries when written out.
+
+def extend(base, new, src, dst):
+    """Length and replaced bytes of the patched copy of base[src:] to new[dst:]."""
+    limit = min(len(base) - src, len(new) - dst)
+    fixes = []
+    recent = collections.deque()
+    length = 0          # end of the last matching byte
+    j = 0
+    while j < limit:
+        # Skip equal stretches 16 bytes at a time.
+        if base[src + j:src + j + 16] == new[dst + j:dst + j + 16]:
+            j += 16
+            length = j
+            continue
+        if base[src + j] == new[dst + j]:
+            j += 1
+            length = j
+            continue
+        while recent and recent[0] <= j - WINDOW:
+            recent.popleft()
+        if len(recent) >= WINDOW_MISMATCHES:
+            break
+        recent.append(j)
+        fixes.append(j)
+        j += 1
+    length = min(length, limit)
+    return length, [f for f in fixes if f < length]
+
+
+def literal_ops(new, dst, end):
+    """LIT and FILL operations for new[dst:end]."""
+    ops = []
+    lit = dst
+    i = dst
+    while i < end:
+        run = i + 1
+        while run < end and new[run] == new[i]:
+            run += 1
+        if run - i >= MIN_FILL:
+            if lit < i:
+                ops.append((OP_LIT, lit, i - lit, None))
+            ops.append((OP_FILL, i, run - i, new[i]))
+            lit = run
+        i = run
+    if lit < end:
+        ops.append((OP_LIT, lit, end - lit, None))
+    return ops
+
+
+def diff(base, new):
+    seeds = collections.defaultdict(list)
+    for i in range(len(base) - SEED + 1):
+        seeds[base[i:i + SEED]].append(i)
+
+    ops = []
+    lit = 0
+    i = 0
+    shift = 0           # src - dst of the last copy: moved code keeps moving by the same amount
+    while i < len(new):
+        best = None
+        candidates = [i + shift] if 0 <= i + shift < len(base) else []
+        candidates += seeds.get(new[i:i + SEED], [])[-MAX_CANDIDATES:]
+        for src in candidates:
+            length, fixes = extend(base, new, src, i)
+            score = length - 2 * len(fixes)
+            if length >= MIN_COPY and (best is None or score > best[0]):
+                best = (score, src, length, fixes)
+        if best is None or best[0] < MIN_COPY:
+            i += 1
+            continue
+
+        _, src, length, fixes = best
+        ops += literal_ops(new, lit, i)
+        if fixes:
+            ops.append((OP_PATCH, i, length, (src, [(f, new[i + f]) for f in fixes])))
+        else:
+            ops.append((OP_COPY, i, length, src))
+        shift = src - i
+        i += length
+        lit = i
+    ops += literal_ops(new, lit, len(new))
+    return ops
+
+
+def split(op, page_end):
+    """Part of op before page_end, and the rest (or None)."""
+    kind, dst, length, arg = op
+    if dst + length <= page_end:
+        return op, None
+    cut = page_end - dst
+    if kind == OP_COPY:
+        return (kind, dst, cut, arg), (kind, page_end, length - cut, arg + cut)
+    if kind == OP_PATCH:
+        src, fixes = arg
+        head = [(f, b) for f, b in fixes if f < cut]
+        tail = [(f - cut, b) for f, b in fixes if f >= cut]
+        first = (OP_PATCH, dst, cut, (src, head)) if head else (OP_COPY, dst, cut, src)
+        rest = (OP_PATCH, page_end, length - cut, (src + cut, tail)) if tail else \
+            (OP_COPY, page_end, length - cut, src + cut)
+        return first, rest
+    return (kind, dst, cut, arg), (kind, page_end, length - cut, arg)
+
+
+def encode(op, new):
+    kind, dst, length, arg = op
+    if kind == OP_COPY:
+        return bytes((kind,)) + leb128(arg) + leb128(length)
+    if kind == OP_PATCH:
+        src, fixes = arg
+        out = bytearray((kind,)) + leb128(src) + leb128(length) + leb128(len(fixes))
+        previous = 0
+        for f, b in fixes:
+            out += leb128(f - previous) + bytes((b,))
+            previous = f
+        return bytes(out)
+    if kind == OP_LIT:
+        return bytes((kind,)) + leb128(length) + new[dst:dst + length]
+    return bytes((kind,)) + leb128(length) + bytes((arg,))
+
+
+def make(base, new, start):
+    body = bytearray()
+    pending = collections.deque(diff(base, new))
+    for page in range(0, len(new), PAGE_SIZE):
+        page_end = min(page + PAGE_SIZE, len(new))
+        while pending and pending[0][1] < page_end:
+            op, rest = split(pending.popleft(), page_end)
+            body += encode(op, new)
+            if rest:
+                pending.appendleft(rest)
+        body += struct.pack('<I', crc32(new[page:page_end]))
+
+    header = HEADER.pack(MAGIC, VERSION, PAGE_SHIFT, 0, start,
+                         len(base), crc32(base), len(new), crc32(new),
+                         len(body), crc32(body), 0)
+    header = header[:-4] + struct.pack('<I', crc32(header[:-4]))
+    return header + bytes(body)
+
+
+# Applying, the way the device does it.
+
+def parse_header(delta):
+    if len(delta) < HEADER.size:
+        raise ValueError('delta truncated')
+    fields = HEADER.unpack_from(delta)
+    magic, version, page_shift = fields[:3]
+    if magic != MAGIC or version != VERSION:
+        raise ValueError('not a version %d delta' % VERSION)
+    if crc32(delta[:HEADER.size - 4]) != fields[-1]:
+        raise ValueError('header CRC mismatch')
+    header = dict(zip(('start', 'base_size', 'base_crc', 'new_size', 'new_crc',
+                       'body_size', 'body_crc'), fields[4:11]))
+    header['page_size'] = 1 << page_shift
+    body = delta[HEADER.size:]
+    if len(body) != header['body_size'] or crc32(body) != header['body_crc']:
+        raise ValueError('body size or CRC mismatch')
+    return header
+
+
+def apply(base, delta):
+    """New image and the number of operations of each kind."""
+    header = parse_header(delta)
+    if len(base) < header['base_size'] or crc32(base[:header['base_size']]) != header['base_crc']:
+        raise ValueError('the base is not the one the delta was made against')
+    base = base[:header['base_size']]
+
+    reader = Reader(delta, HEADER.size)
+    counts = collections.Counter()
+    new = bytearray()
+    for page in range(0, header['new_size'], header['page_size']):
+        page_len = min(header['page_size'], header['new_size'] - page)
+        buf = bytearray()
+        while len(buf) < page_len:
+            kind = reader.byte()
+            counts[kind] += 1
+            if kind in (OP_COPY, OP_PATCH):
+                src = reader.number()
+                length = reader.number()
+                if src + length > len(base) or len(buf) + length > page_len:
+                    raise ValueError('page %d: copy out of range' % (page // header['page_size']))
+                start = len(buf)
+                buf += base[src:src + length]
+                if kind == OP_PATCH:
+                    offset = 0
+                    for _ in range(reader.number()):
+                        offset += reader.number()
+                        if offset >= length:
+                            raise ValueError('page %d: patch out of range' % (page // header['page_size']))
+                        buf[start + offset] = reader.byte()
+            elif kind in (OP_LIT, OP_FILL):
+                length = reader.number()
+                if len(buf) + length > page_len:
+                    raise ValueError('page %d: operation crosses the page' % (page // header['page_size']))
+                buf += reader.take(length) if kind == OP_LIT else bytes((reader.byte(),)) * length
+            else:
+                raise ValueError('page %d: unknown operation 0x%02x' % (page // header['page_size'], kind))
+        if struct.unpack('<I', reader.take(4))[0] != crc32(buf):
+            raise ValueError('page %d: CRC mismatch' % (page // header['page_size']))
+        new += buf
+
+    if reader.pos != len(delta):
+        raise ValueError('data after the last page')
+    if crc32(new) != header['new_crc']:
+        raise ValueError('image CRC mismatch')
+    return bytes(new), counts
+
+
+def cmd_make(args):
+    base = read_hex(args.base, args.start, args.end)
+    new = read_hex(args.new, args.start, args.end)
+    delta = make(base, new, args.start)
+    apply(base, delta)      # never write a delta that does not rebuild the image
+    with open(args.output, 'wb') as f:
+        f.write(delta)
+    print('%s: %d bytes for a %d byte image (%.1f %%), base %d bytes' %
+          (args.output, len(delta), len(new), 100.0 * len(delta) / len(new), len(base)))
+
+
+def cmd_info(args):
+    with open(args.delta, 'rb') as f:
+        delta = f.read()
+    try:
+        header = parse_header(delta)
+    except ValueError as e:
+        sys.exit('%s: %s' % (args.delta, e))
+    print('start      0x%08x' % header['start'])
+    print('base       %d bytes, CRC32 0x%08x' % (header['base_size'], header['base_crc']))
+    print('new        %d bytes, CRC32 0x%08x' % (header['new_size'], header['new_crc']))
+    print('delta      %d bytes, %d pages of %d bytes' %
+          (len(delta), -(-header['new_size'] // header['page_size']), header['page_size']))
+
+
+def cmd_apply(args):
+    with open(args.delta, 'rb') as f:
+        delta = f.read()
+    try:
+        start = parse_header(delta)['start']
+        new, counts = apply(read_hex(args.base, start, args.end), delta)
+    except ValueError as e:
+        sys.exit('%s: %s' % (args.delta, e))
+    write_hex(args.output, start, new)
+    print('%s: %d bytes from %d copies, %d patched copies, %d literals, %d fills' %
+          (args.output, len(new), counts[OP_COPY], counts[OP_PATCH], counts[OP_LIT], counts[OP_FILL]))
+
+
+def cmd_check(args):
+    with open(args.delta, 'rb') as f:
+        delta = f.read()
+    try:
+        start = parse_header(delta)['start']
+        new, _ = apply(read_hex(args.base, start, args.end), delta)
+    except ValueError as e:
+        print('%s: %s' % (args.delta, e))
+        return 1
+    if new != read_hex(args.new, start, args.end):
+        print('%s: does not rebuild %s' % (args.delta, args.new))
+        return 1
+    print('%s: rebuilds %s' % (args.delta, args.new))
+    return 0
+
+
+def number(text):
+    return int(text, 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('make', help='make a delta from a base and a new image')
+    p.add_argument('base')
+    p.add_argument('new')
+    p.add_argument('-o', '--output', required=True)
+    p.add_argument('--start', type=number, default=APP_START, help='application start address')
+    p.add_argument('--end', type=number, default=APP_END, help='end of the application region')
+    p.set_defaults(func=cmd_make)
+
+    p = sub.add_parser('info', help='print the header of a delta')
+    p.add_argument('delta')
+    p.set_defaults(func=cmd_info)
+
+    p = sub.add_parser('apply', help='rebuild the new image from the base and a delta')
+    p.add_argument('base')
+    p.add_argument('delta')
+    p.add_argument('-o', '--output', required=True)
+    p.add_argument('--end', type=number, default=APP_END, help='end of the application region')
+    p.set_defaults(func=cmd_apply)
+
+    p = sub.add_parser('check', help='check that a delta rebuilds the new image')
+    p.add_argument('base')
+    p.add_argument('new')
+    p.add_argument('delta')
+    p.add_argument('--end', type=number, default=APP_END, help='end of the application region')
+    p.set_defaults(func=cmd_check)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args) or 0)
+
+
+if __name__ == '__main__':
+    main()
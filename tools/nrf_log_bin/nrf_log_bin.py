@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Decode the frames written by the nrf_log binary backend (nrf_log_backend_bin).
+
+The device only sends the address of each format string and the raw 32-bit
+arguments. This tool looks the strings and module names up in the ELF file of
+the running firmware and prints the formatted log lines.
+
+Usage:
+    nrf_log_bin.py firmware.out capture.bin
+    JLinkRTTLogger -Device NRF52832_XXAA -RTTChannel 1 /dev/stdout | nrf_log_bin.py firmware.out
+    nrf_log_bin.py firmware.out --serial /dev/ttyACM0 --baud 115200
+
+Requires pyelftools (and pyserial for --serial).
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+SYNC = 0xA5
+HEADER_SIZE = 12
+KIND_STD = 0
+KIND_HEXDUMP = 1
+
+SEVERITY = {1: '<error>', 2: '<warning>', 3: '<info>', 4: '<debug>'}
+
+# printf conversion: flags, width, precision, length modifier, conversion.
+SPEC_RE = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGcspn%])')
+
+
+class Image:
+    """Read-only view of the loadable sections of an ELF file."""
+
+    def __init__(self, path):
+        self._segments = []
+        self._modules = []
+        with open(path, 'rb') as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                if section['sh_type'] == 'SHT_PROGBITS' and section['sh_addr']:
+                    self._segments.append((section['sh_addr'], section.data()))
+            self._load_modules(elf)
+
+    def _load_modules(self, elf):
+        symtab = elf.get_section_by_name('.symtab')
+        const = elf.get_section_by_name('.log_const_data')
+        if symtab is None or const is None:
+            return
+        start = const['sh_addr']
+        end = start + const['sh_size']
+        entries = sorted({s['st_value'] for s in symtab.iter_symbols()
+                          if start <= s['st_value'] < end and s['st_size'] and
+                          s['st_info']['type'] == 'STT_OBJECT'})
+        for addr in entries:
+            # The first member of every log_const_data entry is the module name.
+            self._modules.append(self.cstring(self.u32(addr)))
+
+    def read(self, addr, size):
+        for base, data in self._segments:
+            if base <= addr and addr + size <= base + len(data):
+                return data[addr - base:addr - base + size]
+        return None
+
+    def u32(self, addr):
+        raw = self.read(addr, 4)
+        return struct.unpack('<I', raw)[0] if raw else 0
+
+    def cstring(self, addr):
+        for base, data in self._segments:
+            if base <= addr < base + len(data):
+                end = data.find(b'\0', addr - base)
+                if end < 0:
+                    end = len(data)
+                return data[addr - base:end].decode('ascii', 'replace')
+        return None
+
+    def module_name(self, module_id):
+        if module_id < len(self._modules):
+            return self._modules[module_id]
+        return 'module_%d' % module_id
+
+
+def format_c(image, fmt, args):
+    """Format a C printf string with 32-bit arguments, the way nrf_log does on the device."""
+    args = list(args)
+
+    def next_arg():
+        return args.pop(0) if args else 0
+
+    def convert(m):
+        flags, width, precision, _, conv = m.groups()
+        if conv == '%':
+            return '%'
+        if width == '*':
+            width = str(struct.unpack('<i', struct.pack('<I', next_arg()))[0])
+        if precision == '*':
+            precision = str(next_arg())
+        spec = '%' + flags + (width or '') + ('.' + precision if precision else '')
+        value = next_arg()
+        if conv in 'di':
+            return (spec + 'd') % struct.unpack('<i', struct.pack('<I', value))[0]
+        if conv in 'ouxX':
+            return (spec + conv.replace('u', 'd')) % value
+        if conv in 'eEfFgG':
+            # Floats are passed with NRF_LOG_FLOAT() as two integers; plain floats cannot be sent.
+            return (spec + conv) % struct.unpack('<f', struct.pack('<I', value))[0]
+        if conv == 'c':
+            return chr(value & 0xFF)
+        if conv == 'p':
+            return '0x%08x' % value
+        if conv == 's':
+            text = image.cstring(value)
+            return (spec + 's') % (text if text is not None else '<ram@0x%08x>' % value)
+        return m.group(0)
+
+    return SPEC_RE.sub(convert, fmt)
+
+
+def decode(image, stream, out, follow=False):
+    read = getattr(stream, 'read1', stream.read)
+    buf = bytearray()
+    while True:
+        chunk = read(256)
+        if not chunk:
+            if follow:
+                continue
+            break
+        buf += chunk
+        while True:
+            start = buf.find(bytes([SYNC]))
+            if start < 0:
+                buf.clear()
+                break
+            del buf[:start]
+            if len(buf) < HEADER_SIZE:
+                break
+            length = buf[3]
+            total = HEADER_SIZE + length + 1
+            if len(buf) < total:
+                break
+            frame = bytes(buf[:total])
+            if sum(frame) & 0xFF or frame[1] not in (KIND_STD, KIND_HEXDUMP):
+                # Not a frame boundary: resynchronise on the next sync byte.
+                del buf[:1]
+                continue
+            del buf[:total]
+            out.write(render(image, frame) + '\n')
+            out.flush()
+
+
+def render(image, frame):
+    kind, severity, length = frame[1], frame[2], frame[3]
+    module_id, dropped, timestamp = struct.unpack_from('<HHI', frame, 4)
+    payload = frame[HEADER_SIZE:HEADER_SIZE + length]
+
+    prefix = ''
+    if dropped:
+        prefix += '(%d dropped) ' % dropped
+    if timestamp:
+        prefix += '[%08d] ' % timestamp
+    prefix += '%s %s: ' % (SEVERITY.get(severity, '<%d>' % severity), image.module_name(module_id))
+
+    if kind == KIND_HEXDUMP:
+        return prefix + ' '.join('%02x' % b for b in payload)
+
+    words = struct.unpack('<%dI' % (length // 4), payload)
+    fmt = image.cstring(words[0])
+    if fmt is None:
+        return prefix + '<unknown format @0x%08x> %s' % (words[0], ' '.join('0x%x' % a for a in words[1:]))
+    return prefix + format_c(image, fmt, words[1:]).rstrip('\r\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('elf', help='ELF file (_build/<target>.out) of the running firmware')
+    parser.add_argument('input', nargs='?', help='binary capture; standard input if omitted')
+    parser.add_argument('--serial', help='read frames from this serial port instead')
+    parser.add_argument('--baud', type=int, default=115200)
+    opts = parser.parse_args()
+
+    image = Image(opts.elf)
+    if opts.serial:
+        import serial
+        stream = serial.Serial(opts.serial, opts.baud, timeout=0.1)
+    elif opts.input:
+        stream = open(opts.input, 'rb')
+    else:
+        stream = sys.stdin.buffer
+    try:
+        decode(image, stream, sys.stdout, follow=bool(opts.serial))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""Fit the RAM region of an nRF5 SDK linker script to the SoftDevice configuration.
+
+The RAM the SoftDevice needs depends on its configuration in sdk_config.h
+(link counts, event length, MTU, attribute table size, vendor UUIDs, ...) and
+only the SoftDevice itself can work it out: sd_ble_enable() hands back the
+lowest application RAM start it can run with. The BLE examples log that value
+at start-up ("Application RAM can start at 0x..."); when the linker script
+reserves too little the SDK logs "Change the RAM start location from 0x... to
+0x..." before failing, and when it reserves too much "RAM starts at 0x..., can be
+adjusted to 0x...".
+
+  set     Takes the value from such a log (or from --ram-start) and rewrites
+          the RAM line of the linker script. The SoftDevice configuration it
+          was measured with is recorded in a comment above the line.
+  check   Compares the recorded configuration with sdk_config.h and says
+          whether the RAM start must be measured again.
+  report  Prints the RAM layout of a linked image from its map file: the
+          SoftDevice reserve, static data, heap, stack and what is left free.
+
+Usage:
+    nrf_ram_layout.py set app_gcc_nrf52.ld ../config/sdk_config.h --log rtt.txt
+    nrf_ram_layout.py set app_gcc_nrf52.ld ../config/sdk_config.h --ram-start 0x20002a98
+    nrf_ram_layout.py check app_gcc_nrf52.ld ../config/sdk_config.h
+    nrf_ram_layout.py report _build/nrf52832_xxaa.map
+"""
+
+import argparse
+import re
+import sys
+
+RAM_BASE = 0x20000000
+RAM_END = 0x20010000        # nRF52832, 64 kB
+
+# sdk_config.h options that change the SoftDevice RAM requirement.
+CONFIG_KEYS = (
+    'NRF_SDH_BLE_GAP_DATA_LENGTH',
+    'NRF_SDH_BLE_PERIPHERAL_LINK_COUNT',
+    'NRF_SDH_BLE_CENTRAL_LINK_COUNT',
+    'NRF_SDH_BLE_TOTAL_LINK_COUNT',
+    'NRF_SDH_BLE_GAP_EVENT_LENGTH',
+    'NRF_SDH_BLE_GATT_MAX_MTU_SIZE',
+    'NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE',
+    'NRF_SDH_BLE_VS_UUID_COUNT',
+    'NRF_SDH_BLE_SERVICE_CHANGED',
+)
+
+LOG_RES = (
+    re.compile(r'Application RAM can start at 0x([0-9a-fA-F]+)'),
+    re.compile(r'Change the RAM start location from 0x[0-9a-fA-F]+ to 0x([0-9a-fA-F]+)'),
+    re.compile(r'RAM starts at 0x[0-9a-fA-F]+, can be adjusted to 0x([0-9a-fA-F]+)'),
+)
+RAM_LINE_RE = re.compile(r'^(\s*RAM \(rwx\) :\s*ORIGIN = )0x[0-9a-fA-F]+(, LENGTH = )0x[0-9a-fA-F]+',
+                         re.MULTILINE)
+STAMP_RE = re.compile(r'^\s*/\* SoftDevice RAM measured with: (.*) \*/\r?\n', re.MULTILINE)
+
+
+def sdk_config(path):
+    """SoftDevice configuration from sdk_config.h, as 'KEY=value' strings."""
+    with open(path) as f:
+        text = f.read()
+    values = []
+    for key in CONFIG_KEYS:
+        m = re.search(r'^#define %s\s+(\S+)' % key, text, re.MULTILINE)
+        values.append('%s=%s' % (key, m.group(1) if m else '?'))
+    return values
+
+
+def ram_start_from_log(path):
+    """Last RAM start reported in a device log."""
+    found = None
+    with open(path, errors='replace') as f:
+        for line in f:
+            for regex in LOG_RES:
+                m = regex.search(line)
+                if m:
+                    found = int(m.group(1), 16)
+    if found is None:
+        sys.exit('%s: no RAM start reported; is NRF_LOG enabled at info level?' % path)
+    return found
+
+
+def cmd_set(args):
+    ram_start = int(args.ram_start, 0) if args.ram_start else ram_start_from_log(args.log)
+    if not RAM_BASE <= ram_start < RAM_END or ram_start % 4:
+        sys.exit('0x%08x is not a valid RAM start' % ram_start)
+
+    with open(args.ld, newline='') as f:
+        text = f.read()
+    eol = '\r\n' if '\r\n' in text else '\n'
+
+    m = RAM_LINE_RE.search(text)
+    if not m:
+        sys.exit('%s: no RAM (rwx) line' % args.ld)
+    old = int(re.search(r'ORIGIN = (0x[0-9a-fA-F]+)', m.group(0)).group(1), 16)
+
+    text = STAMP_RE.sub('', text)
+    m = RAM_LINE_RE.search(text)
+    indent = re.match(r'\s*', m.group(1)).group(0)
+    stamp = '%s/* SoftDevice RAM measured with: %s */%s' % (indent, ' '.join(sdk_config(args.config)), eol)
+    line = '%s0x%08x%s0x%x' % (m.group(1), ram_start, m.group(2), RAM_END - ram_start)
+    text = text[:m.start()] + stamp + line + text[m.end():]
+
+    with open(args.ld, 'w', newline='') as f:
+        f.write(text)
+
+    print('%s: RAM start 0x%08x -> 0x%08x (%+d bytes for the application)' %
+          (args.ld, old, ram_start, old - ram_start))
+
+
+def cmd_check(args):
+    with open(args.ld, newline='') as f:
+        text = f.read()
+    m = STAMP_RE.search(text)
+    current = sdk_config(args.config)
+    if not m:
+        print('%s: the RAM start has not been measured; run the application once and use "set".' % args.ld)
+        return 1
+    recorded = m.group(1).split()
+    changed = [c for c in current if c not in recorded]
+    if changed:
+        print('%s: the SoftDevice configuration changed since the RAM start was measured:' % args.ld)
+        for c in changed:
+            print('    %s' % c)
+        return 1
+    print('%s: RAM start matches the SoftDevice configuration.' % args.ld)
+    return 0
+
+
+def map_symbols(path):
+    symbols = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'^\s+0x([0-9a-fA-F]+)\s+(__\w+)\s*=', line)
+            if m:
+                symbols[m.group(2)] = int(m.group(1), 16)
+    return symbols
+
+
+def cmd_report(args):
+    symbols = map_symbols(args.map)
+    with open(args.map) as f:
+        m = re.search(r'^RAM\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)', f.read(), re.MULTILINE)
+    if not m:
+        sys.exit('%s: no RAM region' % args.map)
+    origin = int(m.group(1), 16)
+    end = origin + int(m.group(2), 16)
+
+    needed = ('__bss_end__', '__HeapBase', '__HeapLimit', '__StackLimit', '__StackTop')
+    missing = [s for s in needed if s not in symbols]
+    if missing:
+        sys.exit('%s: symbols not found: %s' % (args.map, ', '.join(missing)))
+
+    rows = (
+        ('SoftDevice', RAM_BASE, origin),
+        ('data + bss', origin, symbols['__bss_end__']),
+        ('heap', symbols['__HeapBase'], symbols['__HeapLimit']),
+        ('free', symbols['__HeapLimit'], symbols['__StackLimit']),
+        ('stack', symbols['__StackLimit'], symbols['__StackTop']),
+    )
+    for name, start, stop in rows:
+        print('%-12s 0x%08x - 0x%08x  %6d bytes' % (name, start, stop, stop - start))
+    if symbols['__StackTop'] != end:
+        print('note: the stack does not end at the top of the RAM region (0x%08x)' % end)
+    return 0 if symbols['__StackLimit'] >= symbols['__HeapLimit'] else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('set', help='rewrite the RAM region from a measured RAM start')
+    p.add_argument('ld')
+    p.add_argument('config')
+    source = p.add_mutually_exclusive_group(required=True)
+    source.add_argument('--log', help='device log with the RAM start reported at start-up')
+    source.add_argument('--ram-start', help='RAM start address')
+    p.set_defaults(func=cmd_set)
+
+    p = sub.add_parser('check', help='check the RAM region against sdk_config.h')
+    p.add_argument('ld')
+    p.add_argument('config')
+    p.set_defaults(func=cmd_check)
+
+    p = sub.add_parser('report', help='print the RAM layout from a map file')
+    p.add_argument('map')
+    p.set_defaults(func=cmd_report)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args) or 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""Print the flash and RAM used by each module of an nRF5 SDK build.
+
+Reads the map file written by the linker and adds up the input sections of
+every object file, then prints them largest first. The totals are shown next
+to the FLASH and RAM regions of the linker script, so the headroom left
+beside the SoftDevice can be read directly.
+
+With link time optimization the code is linked from ltrans objects that no
+longer say which source file it came from. With -ffunction-sections and
+-fdata-sections each input section is still named after its symbol, so given
+the object directory of the build the symbols are looked up in the LTO objects
+(with gcc-nm, which reads the LTO IR) and charged to their source file. Static
+symbols defined in more than one file and symbols that cannot be found are
+reported as "(lto)".
+
+Usage:
+    nrf_size_report.py _build/nrf52832_xxaa.map
+    nrf_size_report.py _build_lto/nrf52832_xxaa.map --objects _build_lto/nrf52832_xxaa \\
+        --nm arm-none-eabi-gcc-nm
+"""
+
+import argparse
+import collections
+import glob
+import os
+import re
+import subprocess
+import sys
+
+# Output sections that take no room in flash.
+NOBITS = ('.bss', '.heap', '.stack_dummy', '.noinit')
+
+MEMORY_RE = re.compile(r'^(\w+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+OUTPUT_RE = re.compile(r'^(\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?')
+INPUT_RE = re.compile(r'^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(.*))?)?$')
+CONT_RE = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(.*))?$')
+# Suffixes GCC adds to clones and LTO-promoted statics.
+CLONE_RE = re.compile(r'\.(lto_priv|constprop|isra|part|cold)\.\d+.*$')
+
+
+class Region:
+    def __init__(self, name, origin, length):
+        self.name = name
+        self.origin = origin
+        self.length = length
+
+    def contains(self, addr):
+        return self.origin <= addr < self.origin + self.length
+
+
+def module_name(obj):
+    """Short name of the object an input section came from."""
+    obj = obj.strip()
+    archive = re.match(r'(.*)\((.*)\)$', obj)
+    if archive:
+        return '%s(%s)' % (os.path.basename(archive.group(1)), archive.group(2))
+    name = os.path.basename(obj)
+    if name.endswith('.ltrans.o'):
+        return None
+    return name[:-2] if name.endswith('.o') else name
+
+
+def symbol_index(objects, nm):
+    """Map each symbol defined in the LTO objects of a build to its source file."""
+    index = {}
+    for path in sorted(glob.glob(os.path.join(objects, '*.o'))):
+        try:
+            out = subprocess.run([nm, '--defined-only', path], stdout=subprocess.PIPE,
+                                 stderr=subprocess.DEVNULL, universal_newlines=True).stdout
+        except OSError as e:
+            sys.exit('cannot run %s: %s' % (nm, e))
+        module = module_name(path)
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) >= 2:
+                symbol = fields[-1]
+                # Several files defining the same static symbol: ambiguous.
+                index[symbol] = module if index.get(symbol, module) == module else None
+    return index
+
+
+def lto_module(section, index):
+    """Source file of an ltrans input section such as .text.ble_lbs_init."""
+    for prefix in ('.text.', '.rodata.', '.data.', '.bss.'):
+        if section.startswith(prefix):
+            symbol = CLONE_RE.sub('', section[len(prefix):])
+            module = index.get(symbol)
+            if module:
+                return module
+    return '(lto)'
+
+
+def parse(path, index):
+    regions = []
+    sizes = collections.defaultdict(lambda: [0, 0, 0])  # text, data, bss
+    output = None
+    output_addr = 0
+    pending = None
+    pending_output = False
+    in_memory = False
+
+    with open(path) as f:
+        lines = f.read().splitlines()
+
+    def add(section, addr, size, obj):
+        if size == 0 or output is None:
+            return
+        if not any(r.contains(output_addr) for r in regions):
+            return  # debug information and discarded sections
+        if section == '*fill*':
+            module = '(fill)'
+        else:
+            module = module_name(obj)
+            if module is None:
+                module = lto_module(section, index)
+        if output in NOBITS:
+            sizes[module][2] += size
+        elif any(r.name == 'RAM' and r.contains(output_addr) for r in regions):
+            sizes[module][1] += size
+        else:
+            sizes[module][0] += size
+
+    for line in lines:
+        if line.startswith('Memory Configuration'):
+            in_memory = True
+            continue
+        if line.startswith('Linker script and memory map'):
+            in_memory = False
+            continue
+        if in_memory:
+            m = MEMORY_RE.match(line)
+            if m and m.group(1) != 'Name':
+                regions.append(Region(m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+            continue
+
+        if pending:
+            # Address and size continue on the next line for long names.
+            m = CONT_RE.match(line)
+            if m and pending_output:
+                output_addr = int(m.group(1), 16)
+            elif m:
+                add(pending, int(m.group(1), 16), int(m.group(2), 16), m.group(3) or '')
+            pending = None
+            pending_output = False
+            continue
+
+        if line and not line[0].isspace():
+            m = OUTPUT_RE.match(line)
+            output = m.group(1) if m else None
+            output_addr = 0
+            if m and m.group(2):
+                output_addr = int(m.group(2), 16)
+            elif m:
+                pending = output
+                pending_output = True
+            continue
+
+        m = INPUT_RE.match(line)
+        if m and output and not m.group(1).startswith(('*(', 'KEEP(', 'SORT(')):
+            if m.group(2) is None:
+                pending = m.group(1)
+            else:
+                add(m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4) or '')
+
+    return regions, sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('map', help='map file written by the linker')
+    parser.add_argument('--objects', help='object directory of the build, to attribute LTO code')
+    parser.add_argument('--nm', default='arm-none-eabi-gcc-nm', help='nm that reads LTO objects')
+    parser.add_argument('--top', type=int, default=0, help='only print the largest N modules')
+    args = parser.parse_args()
+
+    index = symbol_index(args.objects, args.nm) if args.objects else {}
+    regions, sizes = parse(args.map, index)
+    if not regions:
+        sys.exit('%s: no memory configuration found' % args.map)
+
+    rows = sorted(sizes.items(), key=lambda kv: (kv[1][0] + kv[1][1], kv[1][2]), reverse=True)
+    if args.top:
+        rows = rows[:args.top]
+
+    print('%-40s %8s %8s %8s %8s %8s' % ('module', 'text', 'data', 'bss', 'flash', 'ram'))
+    for module, (text, data, bss) in rows:
+        print('%-40s %8d %8d %8d %8d %8d' % (module, text, data, bss, text + data, data + bss))
+
+    text = sum(s[0] for s in sizes.values())
+    data = sum(s[1] for s in sizes.values())
+    bss = sum(s[2] for s in sizes.values())
+    print('%-40s %8d %8d %8d %8d %8d' % ('total', text, data, bss, text + data, data + bss))
+    print()
+
+    used = {'FLASH': text + data, 'RAM': data + bss}
+    for region in regions:
+        if region.name in used:
+            print('%-5s 0x%08x  %7d of %7d bytes used, %7d free' %
+                  (region.name, region.origin, used[region.name], region.length,
+                   region.length - used[region.name]))
+
+
+if __name__ == '__main__':
+    main()
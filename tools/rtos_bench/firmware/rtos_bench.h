@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2018 makerdiary
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Boot time and wake latency benchmark shared by every RTOS port.
+ *
+ * The same scenario runs on the nRF5 SDK, Zephyr, mbed OS and Mynewt:
+ *
+ * - The first statement of main() drives BENCH_MARKER_PIN high and starts
+ *   the DWT cycle counter. A logic analyzer on nRESET and the marker sees
+ *   reset to main as the first marker edge.
+ * - Once advertising is started the marker goes low again: reset to first
+ *   advertisement is the falling edge, and main to advertising is also
+ *   counted in cycles.
+ * - The firmware then raises BENCH_STIM_OUT_PIN, wired to BENCH_STIM_IN_PIN,
+ *   BENCH_SAMPLES times. The port's GPIO interrupt calls bench_isr() and
+ *   wakes a thread that calls bench_thread(); both are timed in cycles
+ *   from the moment the pin was raised.
+ * - The results are printed, advertising stops and the marker stays low
+ *   while the board idles, which is when the idle current is measured.
+ *
+ * Results are printed as "BENCH <key> <value>" lines through
+ * BENCH_REPORT(key, value), which the port defines before including this
+ * file. tools/rtos_bench/rtos_bench.py collects them into one table.
+ *
+ * The state is static: include this file from one source file only.
+ */
+
+#ifndef RTOS_BENCH_H__
+#define RTOS_BENCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nrf.h"
+
+#ifndef BENCH_REPORT
+#error "Define BENCH_REPORT(key, value) before including rtos_bench.h"
+#endif
+
+#define BENCH_MARKER_PIN    11      /**< Boot and wake marker, to the logic analyzer. */
+#define BENCH_STIM_OUT_PIN  12      /**< Stimulus, wired to BENCH_STIM_IN_PIN. */
+#define BENCH_STIM_IN_PIN   13      /**< Interrupt input of the latency test. */
+
+#define BENCH_SAMPLES       64      /**< Stimulus edges in the latency test. */
+#define BENCH_GAP_MS        10      /**< Pause between two stimulus edges. */
+
+typedef struct
+{
+    uint32_t          stim;                     /**< CYCCNT when the stimulus was raised. */
+    volatile uint32_t isr;                      /**< CYCCNT in the interrupt handler. */
+    uint32_t          isr_cycles[BENCH_SAMPLES];
+    uint32_t          thread_cycles[BENCH_SAMPLES];
+    uint16_t          count;
+} bench_t;
+
+static bench_t m_bench;
+
+static inline uint32_t bench_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**@brief Call as the very first thing in main(). */
+static inline void bench_main_entry(void)
+{
+    NRF_GPIO->OUTSET = (1UL << BENCH_MARKER_PIN);
+    NRF_GPIO->DIRSET = (1UL << BENCH_MARKER_PIN);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    NRF_GPIO->OUTCLR = (1UL << BENCH_STIM_OUT_PIN);
+    NRF_GPIO->DIRSET = (1UL << BENCH_STIM_OUT_PIN);
+}
+
+/**@brief Call once advertising has been started. */
+static inline void bench_adv_started(void)
+{
+    uint32_t cycles = bench_cycles();
+
+    NRF_GPIO->OUTCLR = (1UL << BENCH_MARKER_PIN);
+    BENCH_REPORT("main_to_adv_cycles", cycles);
+}
+
+/**@brief Raise the stimulus; call from the thread that waits for the wakeup. */
+static inline void bench_stimulus(void)
+{
+    m_bench.isr  = 0;
+    m_bench.stim = bench_cycles();
+    NRF_GPIO->OUTSET = (1UL << BENCH_STIM_OUT_PIN);
+}
+
+/**@brief Call first thing in the stimulus interrupt handler. */
+static inline void bench_isr(void)
+{
+    m_bench.isr = bench_cycles();
+}
+
+/**@brief Call first thing in the woken thread.
+ *
+ * @return true once BENCH_SAMPLES edges have been timed.
+ */
+static inline bool bench_thread(void)
+{
+    uint32_t now = bench_cycles();
+
+    NRF_GPIO->OUT ^= (1UL << BENCH_MARKER_PIN);
+    NRF_GPIO->OUTCLR = (1UL << BENCH_STIM_OUT_PIN);
+
+    if (m_bench.count < BENCH_SAMPLES)
+    {
+        m_bench.isr_cycles[m_bench.count]    = m_bench.isr - m_bench.stim;
+        m_bench.thread_cycles[m_bench.count] = now - m_bench.stim;
+        m_bench.count++;
+    }
+
+    return m_bench.count == BENCH_SAMPLES;
+}
+
+static inline void bench_sort(uint32_t * p_values, uint16_t count)
+{
+    for (uint16_t i = 1; i < count; i++)
+    {
+        uint32_t value = p_values[i];
+        uint16_t j     = i;
+
+        for (; j > 0 && p_values[j - 1] > value; j--)
+        {
+            p_values[j] = p_values[j - 1];
+        }
+        p_values[j] = value;
+    }
+}
+
+/**@brief Print the latency results and leave the marker low for the idle phase. */
+static inline void bench_report(void)
+{
+    uint16_t n = m_bench.count;
+
+    NRF_GPIO->OUTCLR = (1UL << BENCH_MARKER_PIN);
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    bench_sort(m_bench.isr_cycles, n);
+    bench_sort(m_bench.thread_cycles, n);
+
+    BENCH_REPORT("samples", n);
+    BENCH_REPORT("irq_to_isr_p50_cycles", m_bench.isr_cycles[n / 2]);
+    BENCH_REPORT("irq_to_isr_p99_cycles", m_bench.isr_cycles[(n * 99) / 100]);
+    BENCH_REPORT("irq_to_isr_max_cycles", m_bench.isr_cycles[n - 1]);
+    BENCH_REPORT("irq_to_thread_p50_cycles", m_bench.thread_cycles[n / 2]);
+    BENCH_REPORT("irq_to_thread_p99_cycles", m_bench.thread_cycles[(n * 99) / 100]);
+    BENCH_REPORT("irq_to_thread_max_cycles", m_bench.thread_cycles[n - 1]);
+    BENCH_REPORT("idle", 1);
+}
+
+#endif // RTOS_BENCH_H__
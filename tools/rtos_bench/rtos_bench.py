@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Collect the tools/rtos_bench results of every RTOS port into one table.
+
+Every port runs the scenario of firmware/rtos_bench.h: the marker pin
+(P0.11) goes high first thing in main() and low once advertising is
+started. The stimulus pin (P0.12, wired to P0.13) is then raised 64 times
+for the interrupt latency test, and the board finally idles with
+advertising stopped.
+
+The scenario is built into the beacon example of each stack:
+
+  nRF5 SDK  examples/nrf5-sdk/ble_app_beacon/armgcc: make RTOS_BENCH=1
+  Zephyr    examples/zephyr/bluetooth/beacon: cmake -DRTOS_BENCH=1 ...
+  mbed OS   examples/mbedos5/mbed-os-example-ble/BLE_Beacon:
+            mbed compile -DRTOS_BENCH --source . --source ../../../../tools/rtos_bench/firmware
+  Mynewt    examples/mynewt/blinky: newt build nrf52_rtos_bench
+
+Give one directory per build; its name is the row label. It may hold:
+
+  log.txt      console output of the build (UART or RTT), with its
+               "BENCH <key> <value>" lines
+  capture.csv  logic analyzer export of nRESET and the marker: a time
+               column in seconds, then one column per channel (Saleae
+               export, or sigrok-cli -O csv:time=true)
+  current.csv  power analyzer export taken during the idle phase: time,
+               then current in uA (Power Profiler Kit export); the mean
+               is reported
+
+Usage:
+    rtos_bench.py results/nrf5 results/zephyr results/mbed results/mynewt
+    rtos_bench.py results/* --reset-col 1 --marker-col 2 --markdown
+"""
+
+import argparse
+import csv
+import os
+import re
+import sys
+
+CPU_HZ = 64000000
+
+BENCH_RE = re.compile(r'BENCH (\w+) (\d+)')
+
+COLUMNS = (
+    ('reset_to_main_ms', 'reset->main ms'),
+    ('reset_to_adv_ms', 'reset->adv ms'),
+    ('main_to_adv_ms', 'main->adv ms'),
+    ('isr_p50_us', 'IRQ->ISR p50 us'),
+    ('isr_p99_us', 'IRQ->ISR p99 us'),
+    ('thread_p50_us', 'IRQ->thread p50 us'),
+    ('thread_p99_us', 'IRQ->thread p99 us'),
+    ('thread_max_us', 'IRQ->thread max us'),
+    ('idle_ua', 'idle uA'),
+)
+
+
+def read_log(path):
+    """The BENCH values of a console log, as a dict of ints."""
+    values = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            m = BENCH_RE.search(line)
+            if m:
+                values[m.group(1)] = int(m.group(2))
+    return values
+
+
+def numeric_rows(path):
+    """Rows of a CSV export whose fields are all numbers; headers and comments are skipped."""
+    with open(path, newline='') as f:
+        for row in csv.reader(f):
+            if not row or row[0].startswith(';'):
+                continue
+            try:
+                yield [float(x) for x in row]
+            except ValueError:
+                continue
+
+
+def read_capture(path, reset_col, marker_col):
+    """Reset to main and reset to advertising, in seconds, from the marker edges."""
+    t_reset = t_main = t_adv = None
+    prev_reset = prev_marker = None
+
+    for row in numeric_rows(path):
+        t, reset, marker = row[0], int(row[reset_col]), int(row[marker_col])
+
+        if t_reset is None:
+            if prev_reset == 0 and reset == 1:
+                t_reset = t
+        elif t_main is None:
+            if prev_marker == 0 and marker == 1:
+                t_main = t
+        elif t_adv is None:
+            if marker == 0:
+                t_adv = t
+                break
+        prev_reset, prev_marker = reset, marker
+
+    result = {}
+    if t_reset is not None and t_main is not None:
+        result['reset_to_main_ms'] = (t_main - t_reset) * 1000
+    if t_reset is not None and t_adv is not None:
+        result['reset_to_adv_ms'] = (t_adv - t_reset) * 1000
+    return result
+
+
+def read_current(path):
+    samples = [row[1] for row in numeric_rows(path) if len(row) > 1]
+    return sum(samples) / len(samples) if samples else None
+
+
+def collect(directory, args):
+    result = {}
+
+    log = os.path.join(directory, 'log.txt')
+    if os.path.exists(log):
+        values = read_log(log)
+        cycles = [('main_to_adv_ms', 'main_to_adv_cycles', 1000),
+                  ('isr_p50_us', 'irq_to_isr_p50_cycles', 1e6),
+                  ('isr_p99_us', 'irq_to_isr_p99_cycles', 1e6),
+                  ('thread_p50_us', 'irq_to_thread_p50_cycles', 1e6),
+                  ('thread_p99_us', 'irq_to_thread_p99_cycles', 1e6),
+                  ('thread_max_us', 'irq_to_thread_max_cycles', 1e6)]
+        for column, key, scale in cycles:
+            if key in values:
+                result[column] = values[key] * scale / CPU_HZ
+        if 'idle' not in values:
+            print('%s: the latency test did not finish' % directory, file=sys.stderr)
+
+    capture = os.path.join(directory, 'capture.csv')
+    if os.path.exists(capture):
+        result.update(read_capture(capture, args.reset_col, args.marker_col))
+
+    current = os.path.join(directory, 'current.csv')
+    if os.path.exists(current):
+        idle = read_current(current)
+        if idle is not None:
+            result['idle_ua'] = idle
+
+    return result
+
+
+def cell(value):
+    if value is None:
+        return '-'
+    return '%.1f' % value if value < 100 else '%.0f' % value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('results', nargs='+', help='one result directory per build')
+    parser.add_argument('--reset-col', type=int, default=1, help='nRESET column of capture.csv')
+    parser.add_argument('--marker-col', type=int, default=2, help='marker column of capture.csv')
+    parser.add_argument('--markdown', action='store_true', help='print a Markdown table')
+    args = parser.parse_args()
+
+    header = ['stack'] + [title for _, title in COLUMNS]
+    rows = []
+    for directory in args.results:
+        result = collect(directory, args)
+        name = os.path.basename(os.path.normpath(directory))
+        rows.append([name] + [cell(result.get(key)) for key, _ in COLUMNS])
+
+    if args.markdown:
+        print('| ' + ' | '.join(header) + ' |')
+        print('|' + '|'.join('---' for _ in header) + '|')
+        for row in rows:
+            print('| ' + ' | '.join(row) + ' |')
+        return
+
+    widths = [max(len(r[i]) for r in [header] + rows) for i in range(len(header))]
+    for row in [header] + rows:
+        print('  '.join(v.rjust(w) if i else v.ljust(w)
+                        for i, (v, w) in enumerate(zip(row, widths))))
+
+
+if __name__ == '__main__':
+    main()